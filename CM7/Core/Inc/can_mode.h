@@ -13,5 +13,6 @@ void CAN_Mode_Enter(void);
 uint8_t CAN_Mode_HandleLine(char *line);
 uint8_t CAN_Mode_HandleChar(char ch);
 void CAN_Mode_Poll(void);
+void CAN_Mode_Exit(void);               // listen und Sim aus
 
 #endif /* INC_CAN_MODE_H_ */
@@ -0,0 +1,49 @@
+/*
+ * can_sim.h
+ *
+ *  ECU response simulator: table-driven auto-replies from the FDCAN RX ISR.
+ */
+#ifndef INC_CAN_SIM_H_
+#define INC_CAN_SIM_H_
+
+#include <stdint.h>
+#include "stm32h7xx_hal.h"
+
+#define CAN_SIM_MAX_ENTRIES   (256u)
+#define CAN_SIM_MAX_DATA      (8u)
+#define CAN_SIM_MAX_DELAYED   (16u)
+
+// Eintrag anlegen.
+//   rx_id/tx_id: > 0x7FF => Extended ID
+//   value/mask:  match_len Bytes, Byte i passt wenn (data[i] & mask[i]) == value[i]
+//   tpl:         Antwort-Template, Tokens ohne Trenner:
+//                  HH  - festes Byte (hex)
+//                  Rn  - Byte n (0..7) aus der Anfrage kopieren
+//                  +n  - Zaehler-Byte, nach jeder Antwort um n (hex) erhoeht
+//   delay_ms:    0 = sofort aus der ISR, sonst ueber SysTick
+// return: Index (>= 0) oder -1 bei Fehler
+int CAN_Sim_Add(uint32_t rx_id,
+                const uint8_t *value,
+                const uint8_t *mask,
+                uint8_t match_len,
+                uint32_t tx_id,
+                const char *tpl,
+                uint16_t delay_ms);
+
+HAL_StatusTypeDef CAN_Sim_Delete(uint16_t idx);
+void CAN_Sim_Clear(void);
+
+void CAN_Sim_Enable(uint8_t enable);
+uint8_t CAN_Sim_IsEnabled(void);
+
+void CAN_Sim_PrintTable(void);
+void CAN_Sim_ResetStats(void);
+
+// Aus HAL_FDCAN_RxFifo0Callback (ISR) pro empfangenem Frame
+// return 1 wenn ein Eintrag gepasst hat
+uint8_t CAN_Sim_OnRx(const FDCAN_RxHeaderTypeDef *rx, const uint8_t *data);
+
+// Aus SysTick_Handler (1 ms) fuer verzoegerte Antworten
+void CAN_Sim_Tick(void);
+
+#endif /* INC_CAN_SIM_H_ */
@@ -28,6 +28,7 @@ void CLI_OnUsbConnect(uint8_t connected);
 // Ausgabe über USB CDC
 void cli_printf(const char *fmt, ...);
 void cli_printf_debug(const char *fmt, ...);
+void cli_write(const char *data, uint16_t len);
 
 
 
@@ -0,0 +1,25 @@
+/*
+ * crc_util.h
+ *
+ *  CRC helpers shared by the protocol engines.
+ */
+#ifndef INC_CRC_UTIL_H_
+#define INC_CRC_UTIL_H_
+
+#include <stdint.h>
+
+#define CRC16_MODBUS_INIT   (0xFFFFu)
+
+// CRC-16/MODBUS (Poly 0x8005 reflektiert, Init 0xFFFF), Tabelle
+uint16_t CRC16_Modbus_Update(uint16_t crc, const uint8_t *data, uint16_t len);
+uint16_t CRC16_Modbus(const uint8_t *data, uint16_t len);
+
+#define CRC32_INIT          (0xFFFFFFFFu)
+#define CRC32_XOROUT        (0xFFFFFFFFu)
+
+// CRC-32 (zlib/crc32, Poly 0x04C11DB7 reflektiert), Tabelle.
+// Update ohne Endwert-XOR: crc = CRC32_INIT, ..., Ergebnis ^ CRC32_XOROUT
+uint32_t CRC32_Update(uint32_t crc, const uint8_t *data, uint32_t len);
+uint32_t CRC32(const uint8_t *data, uint32_t len);
+
+#endif /* INC_CRC_UTIL_H_ */
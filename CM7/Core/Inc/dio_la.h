@@ -0,0 +1,89 @@
+/*
+ * dio_la.h
+ *
+ *  8-channel logic analyzer on Digital_IN_0..7 (TIM8-triggered DMA of GPIOE->IDR).
+ */
+#ifndef INC_DIO_LA_H_
+#define INC_DIO_LA_H_
+
+#include <stdint.h>
+#include "stm32h7xx_hal.h"
+
+#define DIOLA_SEG_SIZE        (32768u)  // Samples pro DMA Segment (NDTR ist 16 Bit)
+#define DIOLA_SEGS            (4u)      // Segmente im Ring, Zweierpotenz
+#define DIOLA_BUF_SIZE        (DIOLA_SEG_SIZE * DIOLA_SEGS)   // Ring in D2 SRAM
+#define DIOLA_DEPTH_MAX       (DIOLA_BUF_SIZE - DIOLA_SEG_SIZE) // pre + post, Rest ist Reserve fuer die Suche
+#define DIOLA_TIM_CLK_HZ      (32000000u)   // TIM8: 2 x PCLK2
+#define DIOLA_RATE_MAX_HZ     (4000000u)    // DMA GPIO -> D2 bei HCLK 32 MHz
+#define DIOLA_DMA_IRQ_PRIO    (5u)
+
+// Binaer-Header vor 'rle' (little endian):
+//   [0]      DIOLA_SYNC
+//   [1]      DIOLA_F_x
+//   [2..5]   Abtastrate Hz (tatsaechlich, ganzzahlig gerundet)
+//   [6..9]   Samples
+//   [10..13] Trigger Sample (Index ab 0)
+//   [14..15] 0
+// danach Laeufe: Wert (Bit n = DIn), Laenge als LEB128 (7 Bit pro Byte,
+// Bit 7 = es folgt noch ein Byte); Summe der Laengen = Samples
+#define DIOLA_SYNC            (0xA8u)
+#define DIOLA_HDR_LEN         (16u)
+
+#define DIOLA_F_RLE           (0x01u)
+#define DIOLA_F_TRIG          (0x02u)   // Trigger erkannt (sonst force/none)
+#define DIOLA_F_PRE_CUT       (0x04u)   // weniger Pre-Trigger Samples als eingestellt
+#define DIOLA_F_MISS          (0x08u)   // DMA hat Timer Anforderungen verpasst
+#define DIOLA_F_LOST          (0x10u)   // Trigger schon ueberschrieben, keine Aufnahme
+
+typedef enum {
+    DIOLA_TRIG_NONE = 0,      // sofort, erste pre + post Samples
+    DIOLA_TRIG_RISE,
+    DIOLA_TRIG_FALL,
+    DIOLA_TRIG_EDGE,          // beide Flanken
+    DIOLA_TRIG_PATTERN,       // (DI & mask) == value wird wahr
+} diola_trig_t;
+
+typedef struct {
+    uint32_t rate_hz;
+    uint32_t pre;             // Samples vor dem Trigger
+    uint32_t post;            // Samples ab dem Trigger (inkl.)
+    diola_trig_t trig;
+    uint8_t ch;               // DI Kanal fuer RISE/FALL/EDGE
+    uint8_t mask;             // PATTERN, Bit n = DIn
+    uint8_t value;
+} diola_cfg_t;
+
+typedef enum {
+    DIOLA_S_IDLE = 0,
+    DIOLA_S_ARMED,            // laeuft, Pre-Trigger fuellen / Trigger suchen
+    DIOLA_S_POST,             // Trigger da, Post-Trigger fuellen
+    DIOLA_S_DONE,             // gestoppt, Daten lesbar
+} diola_state_t;
+
+typedef enum {
+    DIOLA_FMT_RAW = 0,        // 1 Byte pro Sample, sigrok 'binary' Input
+    DIOLA_FMT_RLE,            // Header + Laeufe
+    DIOLA_FMT_VCD,            // Text, sigrok/PulseView/GTKWave
+} diola_fmt_t;
+
+// rate_hz wird auf DIOLA_TIM_CLK_HZ / n gerundet; tatsaechliche Rate
+// steht danach in DIOLA_GetConfig
+HAL_StatusTypeDef DIOLA_SetConfig(const diola_cfg_t *cfg);
+void DIOLA_GetConfig(diola_cfg_t *cfg);
+
+HAL_StatusTypeDef DIOLA_Arm(void);
+void DIOLA_Force(void);             // Trigger jetzt
+void DIOLA_Stop(void);              // Abbruch, auch Ausgabe
+diola_state_t DIOLA_GetState(void);
+uint32_t DIOLA_Samples(void);       // nach DONE: Samples im Fenster
+
+// Fenster (Bits in DI Reihenfolge) per usb_stream ausgeben
+HAL_StatusTypeDef DIOLA_Dump(diola_fmt_t fmt);
+uint8_t DIOLA_IsDumping(void);
+
+void DIOLA_Poll(void);              // Trigger Suche, Stop, Ausgabe
+void DIOLA_PrintStatus(void);
+
+void DIOLA_DmaIRQHandler(void);     // DMA2 Stream 0 (Segment fertig)
+
+#endif /* INC_DIO_LA_H_ */
@@ -6,5 +6,11 @@
 void    DIO_Mode_Enter(void);
 uint8_t DIO_Mode_HandleLine(char *line);
 uint8_t DIO_Mode_HandleChar(char ch);
+void    DIO_Mode_Poll(void);            // Logic Analyzer
+void    DIO_Mode_Exit(void);            // Logic Analyzer stoppen
+
+// ein Digital OUT Bit setzen (val 0/1) oder umschalten (val 2), BSRR,
+// auch aus ISRs (Trigger Aktionen)
+void DIO_WriteOut(uint8_t bit, uint8_t val);
 
 #endif /* INC_DIO_MODE_H_ */
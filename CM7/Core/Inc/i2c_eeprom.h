@@ -0,0 +1,47 @@
+/*
+ * i2c_eeprom.h
+ *
+ *  24Cxx EEPROM engine on the I2C1 queue (page writes, ACK polling, CRC32).
+ */
+#ifndef INC_I2C_EEPROM_H_
+#define INC_I2C_EEPROM_H_
+
+#include <stdint.h>
+#include "stm32h7xx_hal.h"
+
+#define EEP_SIZE_MAX          (65536u)  // 512 Kbit
+#define EEP_PAGE_MAX          (256u)
+#define EEP_SLOTS             (8u)      // Page Puffer zwischen USB und EEPROM
+#define EEP_RD_CHUNK          (256u)    // Bytes pro Lese-Transaktion
+#define EEP_RD_INFLIGHT       (4u)      // Lese-Transaktionen gleichzeitig in der Queue
+#define EEP_WR_TIMEOUT_MS     (25u)     // tWR (max. 5..10 ms) + Reserve, ACK Polling
+#define EEP_IDLE_TIMEOUT_MS   (3000u)   // write: keine Daten vom Host
+
+typedef struct {
+    uint32_t size;                      // Bytes
+    uint16_t page;                      // Page Write Puffer des Chips
+    uint8_t addr7;                      // Basisadresse (A2..A0 Pins)
+    uint8_t a16;                        // 1 = 16 Bit Wortadresse, 0 = 8 Bit + Blockbits
+} eep_cfg_t;
+
+// Typ aus Namen (24c01 .. 24c512), addr7 bleibt
+HAL_StatusTypeDef EEP_Preset(const char *name, eep_cfg_t *cfg);
+HAL_StatusTypeDef EEP_SetCfg(const eep_cfg_t *cfg);
+const eep_cfg_t *EEP_GetCfg(void);
+void EEP_PrintCfg(void);
+
+// alle Operationen laufen in EEP_Poll weiter; Ergebnis als Zeile
+HAL_StatusTypeDef EEP_Read(uint32_t addr, uint32_t len);       // binaer zum Host
+HAL_StatusTypeDef EEP_Crc(uint32_t addr, uint32_t len);
+HAL_StatusTypeDef EEP_Write(uint32_t addr, uint32_t len, uint8_t verify);
+void EEP_Stop(void);
+uint8_t EEP_IsActive(void);
+
+// write: Rohdaten vom Host (MODES_HandleRaw)
+uint8_t EEP_IsRawActive(void);
+uint16_t EEP_Feed(const uint8_t *data, uint16_t len);
+
+// vor der CLI Ausgabe der Queue aufrufen (holt I2CQ_TAG_EEP Ergebnisse)
+void EEP_Poll(void);
+
+#endif /* INC_I2C_EEPROM_H_ */
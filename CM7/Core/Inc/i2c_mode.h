@@ -6,5 +6,9 @@
 void I2C_Mode_Enter(void);
 uint8_t I2C_Mode_HandleLine(char *line);
 uint8_t I2C_Mode_HandleChar(char ch);   // <--- NEU
+uint16_t I2C_Mode_HandleRaw(const uint8_t *data, uint16_t len);   // ee write
+uint8_t I2C_Mode_IsRawActive(void);
+void I2C_Mode_Poll(void);               // Queue Ergebnisse ausgeben
+void I2C_Mode_Exit(void);               // watch/target/ee stoppen
 
 #endif /* INC_I2C_MODE_H_ */
@@ -0,0 +1,70 @@
+/*
+ * i2c_queue.h
+ *
+ *  Non-blocking I2C1 transaction queue (interrupt driven, repeated start).
+ */
+#ifndef INC_I2C_QUEUE_H_
+#define INC_I2C_QUEUE_H_
+
+#include <stdint.h>
+#include "stm32h7xx_hal.h"
+
+#define I2CQ_DEPTH            (8u)      // Transaktionen, Zweierpotenz
+#define I2CQ_SEG_MAX          (8u)      // Segmente pro Transaktion
+#define I2CQ_DATA_MAX         (512u)    // Schreib- + Lesebytes pro Transaktion
+#define I2CQ_TIMEOUT_MS       (25u)     // + 1 ms pro Byte (deckt 10 kHz ab)
+#define I2CQ_IRQ_PRIO         (5u)
+#define I2CQ_DMA_MIN          (16u)     // Lesesegmente ab hier per DMA1 Stream 6
+
+#define I2CQ_TAG_CLI          (0u)      // Ergebnis an die CLI (I2C_Mode_Poll)
+#define I2CQ_TAG_EEP          (1u)      // i2c_eeprom.c holt selbst ab
+
+typedef enum {
+    I2CQ_OK = 0,
+    I2CQ_NACK,                // Adresse oder Datenbyte nicht bestaetigt
+    I2CQ_ARLO,                // Arbitration verloren
+    I2CQ_BERR,                // Start/Stop an falscher Stelle
+    I2CQ_TIMEOUT,             // SCL zu lange gehalten, Controller zurueckgesetzt
+} i2cq_status_t;
+
+typedef struct {
+    uint8_t  addr;            // 7 Bit
+    uint8_t  read;            // 1 = lesen, 0 = schreiben
+    uint16_t len;             // 0 erlaubt (nur Adresse)
+    uint16_t off;             // Position in data[]
+} i2cq_seg_t;
+
+// Segmente laufen mit Repeated Start direkt hintereinander, STOP nur
+// nach dem letzten; Schreibdaten und Lesepuffer liegen in data[]
+typedef struct {
+    uint16_t id;              // von Submit vergeben
+    uint8_t  tag;             // I2CQ_TAG_x, wer das Ergebnis abholt
+    uint8_t  nseg;
+    uint8_t  status;          // i2cq_status_t
+    uint8_t  err_seg;         // Segment mit dem Fehler
+    uint16_t err_pos;         // Bytes in diesem Segment bis zum Fehler
+    uint32_t t_start;         // us, TIM2
+    uint32_t t_end;
+    i2cq_seg_t seg[I2CQ_SEG_MAX];
+    uint8_t  data[I2CQ_DATA_MAX];
+} i2cq_xfer_t;
+
+// Segment anhaengen; read = 1: len Bytes Platz reservieren, sonst tx kopieren
+HAL_StatusTypeDef I2CQ_AddSeg(i2cq_xfer_t *x, uint8_t addr, uint8_t read, const uint8_t *tx, uint16_t len);
+
+// in die Queue (Kopie), startet sofort wenn der Bus frei ist;
+// HAL_BUSY = Queue voll, out_id optional
+HAL_StatusTypeDef I2CQ_Submit(const i2cq_xfer_t *x, uint16_t *out_id);
+
+// fertige Transaktionen in Submit Reihenfolge: Peek liefert die aelteste
+// (oder NULL), Pop gibt den Platz frei
+const i2cq_xfer_t *I2CQ_Peek(void);
+void I2CQ_Pop(void);
+
+uint8_t I2CQ_IsActive(void);    // Transaktion laeuft oder wartet
+void I2CQ_Poll(void);           // Timeout Ueberwachung
+void I2CQ_IRQHandler(void);     // I2C1_EV / I2C1_ER
+
+const char *I2CQ_StatusStr(uint8_t status);
+
+#endif /* INC_I2C_QUEUE_H_ */
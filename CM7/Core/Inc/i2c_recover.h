@@ -0,0 +1,56 @@
+/*
+ * i2c_recover.h
+ *
+ *  I2C bus recovery: SCL clocking for a stuck SDA, STOP, PE reset; counters per cause.
+ */
+#ifndef INC_I2C_RECOVER_H_
+#define INC_I2C_RECOVER_H_
+
+#include <stdint.h>
+#include "stm32h7xx_hal.h"
+
+#define I2CR_PULSES_MAX       (9u)      // SCL Takte bis SDA frei
+#define I2CR_HALF_US          (5u)      // halbe SCL Periode beim Freitakten (100 kHz)
+#define I2CR_SCL_WAIT_US      (1000u)   // Slave darf SCL so lange strecken
+
+typedef enum {
+    I2CR_CAUSE_STATE = 0,     // HAL Handle nicht READY
+    I2CR_CAUSE_TIMEOUT,       // Transfer Timeout (SCL gehalten)
+    I2CR_CAUSE_ARLO,          // Arbitration verloren
+    I2CR_CAUSE_BERR,          // Start/Stop an falscher Stelle
+    I2CR_CAUSE_BUSY,          // BUSY ohne eigene Transaktion
+    I2CR_CAUSE_SDA_LOW,       // Slave haelt SDA -> freitakten
+    I2CR_CAUSE_USER,          // 'recover' Befehl
+    I2CR_CAUSE_COUNT
+} i2cr_cause_t;
+
+typedef struct {
+    uint32_t cause[I2CR_CAUSE_COUNT];
+    uint32_t pulses;          // SCL Takte gesamt
+    uint32_t sda_freed;       // SDA nach dem Freitakten wieder high
+    uint32_t sda_stuck;       // SDA auch nach 9 Takten low
+    uint32_t scl_stuck;       // SCL dauerhaft low, nicht behebbar
+    uint32_t last_us;         // Dauer der letzten Recovery
+} i2cr_stats_t;
+
+// nur den Controller zuruecksetzen (PE = 0 -> 1), ISR-fest, zaehlt cause
+void I2CR_ResetPE(I2C_TypeDef *inst, i2cr_cause_t cause);
+
+// vollstaendig: Leitungen pruefen, ggf. freitakten + STOP, PE Reset,
+// Handle auf READY; HAL_ERROR = SCL bleibt low / SDA nicht frei
+HAL_StatusTypeDef I2CR_Recover(I2C_HandleTypeDef *hi2c, i2cr_cause_t cause);
+
+// vor blockierenden HAL Aufrufen: schnell, wenn alles in Ordnung ist;
+// ErrorCode nach NACK wird nur geloescht. HAL_BUSY = Handle gehoert
+// gerade einer anderen Engine (BUSY/LISTEN)
+HAL_StatusTypeDef I2CR_Ensure(I2C_HandleTypeDef *hi2c);
+
+// 1 = SDA und SCL high (Pins lesen, auch im AF Modus)
+uint8_t I2CR_LinesIdle(const I2C_TypeDef *inst);
+
+const i2cr_stats_t *I2CR_GetStats(const I2C_TypeDef *inst);
+void I2CR_ResetStats(void);
+void I2CR_PrintStats(void);
+const char *I2CR_CauseStr(i2cr_cause_t cause);
+
+#endif /* INC_I2C_RECOVER_H_ */
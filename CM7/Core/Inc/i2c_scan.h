@@ -0,0 +1,42 @@
+/*
+ * i2c_scan.h
+ *
+ *  Interrupt-driven I2C address scanner (I2C1 / I2C4, address-only probes).
+ */
+#ifndef INC_I2C_SCAN_H_
+#define INC_I2C_SCAN_H_
+
+#include <stdint.h>
+#include "stm32h7xx_hal.h"
+
+#define I2CSCAN_FIRST         (0x03u)   // wie i2cdetect
+#define I2CSCAN_LAST          (0x77u)
+#define I2CSCAN_TIMEOUT_MS    (400u)    // ganzer Scan (10 kHz: ~130 ms)
+#define I2CSCAN_IRQ_PRIO      (5u)
+#define I2CSCAN_TABLE_SIZE    (600u)    // i2cdetect Tabelle als Text
+
+typedef enum {
+    I2CSCAN_NONE = 0,         // NACK
+    I2CSCAN_ACK,
+    I2CSCAN_ERR,              // Arbitration/Bus Error bei dieser Adresse
+    I2CSCAN_SKIP,             // nicht geprueft
+} i2cscan_res_t;
+
+typedef struct {
+    uint8_t res[128];         // i2cscan_res_t pro 7 Bit Adresse
+    uint8_t found;
+    uint8_t errors;
+    uint32_t us;              // Dauer des Scans
+} i2cscan_t;
+
+// alle Adressen first..last nacheinander, Start+Adresse(W)+Stop, NACK per
+// Hardware; blockiert nur bis der IRQ den letzten Probe meldet
+HAL_StatusTypeDef I2CSCAN_Run(I2C_HandleTypeDef *hi2c, uint8_t first, uint8_t last, i2cscan_t *out);
+
+// i2cdetect Tabelle in buf, return = Laenge
+uint16_t I2CSCAN_Format(const i2cscan_t *scan, const char *name, char *buf, uint16_t size);
+
+// aus I2C1_EV/ER bzw. I2C4_EV/ER IRQHandler
+void I2CSCAN_IRQHandler(I2C_TypeDef *inst);
+
+#endif /* INC_I2C_SCAN_H_ */
@@ -0,0 +1,83 @@
+/*
+ * i2c_slave.h
+ *
+ *  I2C1 as bus target: RAM register file with auto-increment pointer, access log.
+ */
+#ifndef INC_I2C_SLAVE_H_
+#define INC_I2C_SLAVE_H_
+
+#include <stdint.h>
+#include "stm32h7xx_hal.h"
+
+#define I2CSL_FILE_SIZE       (65536u)  // Registerdatei (16 Bit Zeiger)
+#define I2CSL_TARGETS         (2u)      // OAR1 + OAR2
+#define I2CSL_SCRIPTS         (8u)
+#define I2CSL_SCRIPT_MAX      (16u)     // Werte pro Skript
+#define I2CSL_LOG_SIZE        (128u)    // Zugriffe im Log, Zweierpotenz
+#define I2CSL_LOG_DATA        (16u)     // Bytes pro Zugriff im Log
+#define I2CSL_IRQ_PRIO        (5u)
+#define I2CSL_LOAD_TIMEOUT_MS (3000u)   // load: keine Daten vom Host
+
+// Zeiger 8 Bit: Fenster 256 Bytes, Target 0 ab 0x0000, Target 1 ab 0x0100;
+// Zeiger 16 Bit: ganze Datei (zwei 16 Bit Targets teilen sie sich)
+typedef struct {
+    uint8_t addr[I2CSL_TARGETS];        // 7 Bit, 0xFF = Target aus
+    uint8_t a16[I2CSL_TARGETS];         // 1 = 16 Bit Registerzeiger
+} i2csl_cfg_t;
+
+#define I2CSL_ADDR_OFF        (0xFFu)
+
+// Log-Eintrag: ein Abschnitt zwischen Adresse und Repeated Start/STOP
+#define I2CSL_L_READ          (0x01u)   // Host liest
+#define I2CSL_L_NACK          (0x02u)   // Host hat mit NACK beendet (normal beim Lesen)
+#define I2CSL_L_SCRIPT        (0x04u)   // Antwort aus einem Skript
+#define I2CSL_L_RO            (0x08u)   // Schreibzugriff auf geschuetzte Bytes ignoriert
+#define I2CSL_L_ERR           (0x10u)   // BERR/OVR
+#define I2CSL_L_TRUNC         (0x20u)   // mehr Bytes als I2CSL_LOG_DATA
+
+typedef struct {
+    uint32_t t_us;            // Adresse erkannt (TIM2)
+    uint8_t target;
+    uint8_t flags;            // I2CSL_L_x
+    uint16_t ptr;             // Registerzeiger zu Beginn der Daten
+    uint16_t len;             // Datenbytes (ohne Zeigerbytes beim Schreiben)
+    uint8_t data[I2CSL_LOG_DATA];
+} i2csl_log_t;
+
+// Registerdatei von der Superloop aus (auch waehrend der Emulation)
+void I2CSL_Fill(uint8_t value);
+HAL_StatusTypeDef I2CSL_Set(uint32_t off, const uint8_t *data, uint32_t len);
+HAL_StatusTypeDef I2CSL_Get(uint32_t off, uint8_t *data, uint32_t len);
+// Schreibschutz fuer den Host (Bytes in der Datei, nicht pro Target)
+HAL_StatusTypeDef I2CSL_SetReadOnly(uint32_t off, uint32_t len, uint8_t on);
+uint8_t I2CSL_IsReadOnly(uint32_t off);
+uint32_t I2CSL_TargetBase(uint8_t target);
+
+// Skript: liest der Host Register reg von target, kommt das erste Byte
+// nacheinander aus values[] (und wird in die Datei uebernommen);
+// once = 1: danach ist das Skript aus, sonst wieder von vorne
+HAL_StatusTypeDef I2CSL_SetScript(uint8_t slot, uint8_t target, uint16_t reg,
+                                  const uint8_t *values, uint8_t n, uint8_t once);
+void I2CSL_ClearScripts(void);
+
+// Datei per Rohdaten vom Host fuellen (MODES_HandleRaw)
+HAL_StatusTypeDef I2CSL_Load(uint32_t off, uint32_t len);
+uint8_t I2CSL_IsRawActive(void);
+uint16_t I2CSL_Feed(const uint8_t *data, uint16_t len);
+void I2CSL_Poll(void);              // load Timeout
+
+// I2C1 muss vorher mit passendem TIMINGR laufen (SDADEL/SCLDEL, FM+)
+HAL_StatusTypeDef I2CSL_Start(const i2csl_cfg_t *cfg);
+void I2CSL_Stop(void);
+uint8_t I2CSL_IsActive(void);
+
+// Log: aeltester zuerst, Ring ueberschreibt; 0 = nichts mehr
+uint8_t I2CSL_LogRead(i2csl_log_t *out);
+void I2CSL_LogClear(void);
+
+void I2CSL_PrintStatus(void);
+void I2CSL_PrintScripts(void);
+
+void I2CSL_IRQHandler(void);        // I2C1_EV / I2C1_ER
+
+#endif /* INC_I2C_SLAVE_H_ */
@@ -0,0 +1,58 @@
+/*
+ * i2c_timing.h
+ *
+ *  TIMINGR solver for the I2C v2 peripheral (Standard/Fast/Fast-mode Plus).
+ */
+#ifndef INC_I2C_TIMING_H_
+#define INC_I2C_TIMING_H_
+
+#include <stdint.h>
+#include "stm32h7xx_hal.h"
+
+#define I2CT_FREQ_MIN_HZ      (10000u)
+#define I2CT_FREQ_MAX_HZ      (1000000u)
+#define I2CT_RISE_NS_DEFAULT  (100u)    // Pull-up ~2k2 bei wenigen 10 pF
+#define I2CT_FALL_NS_DEFAULT  (10u)
+#define I2CT_DNF_MAX          (15u)
+#define I2CT_RATE_MIN_PCT     (80u)     // Ergebnis liegt in [80 %, 100 %] der Zielfrequenz
+
+typedef struct {
+    uint32_t freq_hz;         // Ziel, 10 kHz .. 1 MHz
+    uint16_t rise_ns;         // tr SCL/SDA am Bus
+    uint16_t fall_ns;         // tf
+    uint8_t  analog;          // 1 = Analogfilter an (50..260 ns)
+    uint8_t  dnf;             // Digitalfilter in I2CCLK Takten, 0..15
+} i2ct_cfg_t;
+
+typedef struct {
+    uint32_t timingr;         // fertig fuer hi2c->Init.Timing
+    uint32_t kernel_hz;
+    uint32_t actual_hz;       // erreichte SCL Frequenz
+    uint32_t t_low_ns;        // SCL low inkl. Sync/Filter
+    uint32_t t_high_ns;
+    uint8_t  presc;
+    uint8_t  scldel;
+    uint8_t  sdadel;
+    uint8_t  sclh;
+    uint8_t  scll;
+    uint8_t  fmp;             // 1 = Fast-mode Plus Treiber (20 mA) noetig
+    uint8_t  analog;          // Analogfilter tatsaechlich an
+    uint8_t  hsi;             // 1 = Kernel Takt auf HSI umgeschaltet
+} i2ct_res_t;
+
+void I2CT_DefaultCfg(i2ct_cfg_t *cfg, uint32_t freq_hz);
+
+// I2C Kernel Takt aus RCC (I2C123SEL bzw. I2C4SEL)
+uint32_t I2CT_KernelHz(const I2C_TypeDef *inst);
+
+// reine Rechnung, HAL_ERROR wenn kein Satz die Spezifikation erfuellt
+// (tr/tf zu gross fuer den Mode, Takt zu langsam/zu schnell)
+HAL_StatusTypeDef I2CT_Compute(uint32_t kernel_hz, const i2ct_cfg_t *cfg, i2ct_res_t *res);
+
+// Peripherie neu initialisieren, mit dem Kernel Takt aus RCC rechnen,
+// TIMINGR, Filter und FM+ Treiber setzen;
+// reicht der Kernel Takt aus MspInit (PCLK) nicht, wird auf HSI gewechselt,
+// als letztes der Analogfilter abgeschaltet (siehe res->hsi / res->analog)
+HAL_StatusTypeDef I2CT_Apply(I2C_HandleTypeDef *hi2c, const i2ct_cfg_t *cfg, i2ct_res_t *res);
+
+#endif /* INC_I2C_TIMING_H_ */
@@ -0,0 +1,65 @@
+/*
+ * i2c_watch.h
+ *
+ *  Timer-scheduled I2C1 register watch list with change detection.
+ */
+#ifndef INC_I2C_WATCH_H_
+#define INC_I2C_WATCH_H_
+
+#include <stdint.h>
+#include "stm32h7xx_hal.h"
+
+#define I2CW_ENTRIES          (32u)
+#define I2CW_LEN_MAX          (16u)     // Bytes pro Register-Lesung
+#define I2CW_TICK_US          (100u)    // TIM7 Raster fuer die Perioden
+#define I2CW_EVQ_SIZE         (256u)    // Ereignisse ISR -> Superloop, Zweierpotenz
+#define I2CW_XFER_TIMEOUT_MS  (5u)      // eine Lesung (SCL gehalten) -> PE Reset
+#define I2CW_IRQ_PRIO         (5u)      // TIM7 und I2C1 gleich, kein Verdraengen
+
+// Binaer-Record (little endian), Aufbau wie uart_trace:
+//   [0]     I2CW_SYNC
+//   [1]     I2CW_F_x
+//   [2..5]  t us (STOP der Lesung, TIM2)
+//   [6]     Eintrag
+//   [7]     Adresse 7 Bit
+//   [8..9]  Register
+//   [10..11] Laenge, danach die Bytes (0 bei NACK/Fehler)
+#define I2CW_SYNC             (0xA7u)
+#define I2CW_HDR_LEN          (12u)
+
+#define I2CW_F_CHG            (0x01u)   // Wert geaendert (oder erste Lesung)
+#define I2CW_F_SMP            (0x02u)   // dezimiertes Sample
+#define I2CW_F_ERR            (0x04u)   // NACK/Busfehler (nur beim Wechsel OK -> Fehler)
+#define I2CW_F_NACK           (0x08u)   // mit I2CW_F_ERR: Ursache war ein NACK
+#define I2CW_F_LOST           (0x80u)   // Ereignisse davor verloren (Queue voll)
+
+typedef enum {
+    I2CW_FMT_HEX = 0,
+    I2CW_FMT_BIN,
+} i2cw_fmt_t;
+
+// reg_len 0 = ohne Registeradresse (nur lesen), 1 oder 2 Byte (MSB zuerst);
+// period_us 0 = so oft wie moeglich, sonst auf I2CW_TICK_US gerundet.
+// Rueckgabe Eintrag oder -1 (Liste voll / Parameter)
+int I2CW_Add(uint8_t addr, uint16_t reg, uint8_t reg_len, uint8_t len, uint32_t period_us);
+HAL_StatusTypeDef I2CW_Del(uint8_t idx);
+void I2CW_Clear(void);
+
+// dec = N: jede N-te Lesung eines Eintrags zusaetzlich als Sample, 0 = aus
+void I2CW_SetDecim(uint32_t dec);
+void I2CW_SetFormat(i2cw_fmt_t fmt);
+
+// Start braucht den Bus exklusiv (Queue leer); waehrenddessen steht
+// hi2c1.State auf BUSY
+HAL_StatusTypeDef I2CW_Start(void);
+void I2CW_Stop(void);
+uint8_t I2CW_IsActive(void);       // auch fuer das I2C1 IRQ Routing
+
+void I2CW_PrintList(void);
+void I2CW_PrintStats(void);
+
+void I2CW_Poll(void);               // Ereignisse zum Host, Wachhund
+void I2CW_TimerIRQHandler(void);    // TIM7
+void I2CW_IRQHandler(void);         // I2C1_EV / I2C1_ER
+
+#endif /* INC_I2C_WATCH_H_ */
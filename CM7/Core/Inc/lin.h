@@ -0,0 +1,64 @@
+/*
+ * lin.h
+ *
+ *  LIN master (schedule table), slave responder and bus monitor on a UART.
+ */
+#ifndef INC_LIN_H_
+#define INC_LIN_H_
+
+#include <stdint.h>
+#include "stm32h7xx_hal.h"
+#include "uart_stream.h"
+
+#define LIN_SCHED_MAX         (16u)
+#define LIN_SLAVE_MAX         (16u)
+#define LIN_DATA_MAX          (8u)
+#define LIN_BAUD_DEF          (19200u)
+#define LIN_SLOT_MIN_US       (1000u)
+#define LIN_SLOT_MAX_US       (650000u)  // > 65535 us: 10 us Aufloesung
+
+typedef enum {
+    LIN_DIR_SUB = 0,       // Master sendet nur den Header, Antwort vom Slave
+    LIN_DIR_PUB,           // Master sendet Header + Daten
+} lin_dir_t;
+
+typedef enum {
+    LIN_CS_ENH = 0,        // LIN 2.x: PID + Daten
+    LIN_CS_CLS,            // LIN 1.x / Diagnose 0x3C/0x3D: nur Daten
+} lin_cs_t;
+
+HAL_StatusTypeDef LIN_Start(uarts_ch_t ch, uint32_t baud);
+void LIN_Stop(void);
+uint8_t LIN_IsActive(void);
+uarts_ch_t LIN_Channel(void);
+
+void LIN_SetMonitor(uint8_t on);
+
+// Schedule Tabelle; return Index, -1 = voll, -2 = ungueltig
+int LIN_SchedAdd(uint8_t id, lin_dir_t dir, uint8_t len, uint32_t slot_us,
+                 lin_cs_t cs, const uint8_t *data);
+HAL_StatusTypeDef LIN_SchedDelete(uint8_t idx);
+void LIN_SchedClear(void);
+HAL_StatusTypeDef LIN_SchedRun(uint8_t on);
+void LIN_PrintSched(void);
+
+// Slave Antworttabelle (pro ID), laeuft auch ohne Schedule
+HAL_StatusTypeDef LIN_SlaveSet(uint8_t id, uint8_t len, lin_cs_t cs, const uint8_t *data);
+HAL_StatusTypeDef LIN_SlaveDelete(uint8_t id);
+void LIN_SlaveClear(void);
+void LIN_PrintSlaves(void);
+
+void LIN_PrintStats(void);
+void LIN_ResetStats(void);
+
+// Helfer
+uint8_t LIN_Pid(uint8_t id);
+uint8_t LIN_Checksum(uint8_t pid, const uint8_t *data, uint8_t len, lin_cs_t cs);
+
+// aus der Superloop (UART_Mode_Poll)
+void LIN_Poll(void);
+
+// aus TIM6_DAC_IRQHandler (Slot Takt)
+void LIN_TimerIRQHandler(void);
+
+#endif /* INC_LIN_H_ */
@@ -46,7 +46,9 @@ extern "C" {
 
 /* Exported macro ------------------------------------------------------------*/
 /* USER CODE BEGIN EM */
-
+// DMA Puffer in D2 SRAM (SRAM1/2, Section .ram_d2 im Linker Script);
+// D2 liegt in derselben Domain wie DMA1/DMA2, kein Umweg ueber die AXI Matrix
+#define D2_RAM __attribute__((section(".ram_d2"), aligned(32)))
 /* USER CODE END EM */
 
 /* Exported functions prototypes ---------------------------------------------*/
@@ -0,0 +1,48 @@
+/*
+ * modbus.h
+ *
+ *  Modbus RTU master and passive sniffer on the RS485 port (UART4).
+ */
+#ifndef INC_MODBUS_H_
+#define INC_MODBUS_H_
+
+#include <stdint.h>
+#include "stm32h7xx_hal.h"
+
+#define MB_FRAME_MAX          (256u)
+#define MB_POLL_MAX           (32u)
+#define MB_TIMEOUT_DEF_MS     (200u)
+#define MB_REGS_MAX           (123u)   // FC16 Limit, FC03/04 max. 125
+
+// Engine an UART4 haengen: RTO = t3.5 aus den aktuellen Line Settings
+HAL_StatusTypeDef MB_Start(void);
+void MB_Stop(void);
+uint8_t MB_IsActive(void);
+
+// Sniffer: jeder Frame mit Zeitstempel + CRC Status an USB
+void MB_SetSniff(uint8_t on);
+// Poll-Antworten ausgeben
+void MB_SetWatch(uint8_t on);
+void MB_SetTimeout(uint16_t ms);
+
+// Einzelauftrag (FC 1,2,3,4,5,6,16). Ergebnis kommt ueber MB_Poll().
+//   count:  Anzahl Coils/Register (FC 1-4, 16)
+//   values: FC5/6 values[0], FC16 values[0..count-1]
+HAL_StatusTypeDef MB_Request(uint8_t slave, uint8_t fc, uint16_t addr,
+                             uint16_t count, const uint16_t *values);
+
+// Poll-Liste (nur lesende FCs 1-4)
+int MB_PollAdd(uint8_t slave, uint8_t fc, uint16_t addr, uint16_t count);
+HAL_StatusTypeDef MB_PollDelete(uint8_t idx);
+void MB_PollClear(void);
+// cycle_ms = 0: Liste ohne Pause am Stueck
+void MB_PollRun(uint8_t on, uint32_t cycle_ms);
+void MB_PrintPoll(void);
+
+void MB_PrintStats(void);
+void MB_ResetStats(void);
+
+// aus der Superloop (UART_Mode_Poll)
+void MB_Poll(void);
+
+#endif /* INC_MODBUS_H_ */
@@ -41,6 +41,10 @@ void MODES_ExitToRoot(void);
 
 uint8_t MODES_HandleChar(char ch);
 
+// Raw-Modus (Tunnel): ganzer Block statt Einzelzeichen
+// return = verbrauchte Bytes (0 = Ziel voll, spaeter erneut)
+uint16_t MODES_HandleRaw(const uint8_t *data, uint16_t len);
+
 void MODES_Poll(void);
 
 #endif /* INC_MODES_H_ */
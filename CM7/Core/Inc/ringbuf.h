@@ -23,6 +23,12 @@ bool ringbuf_put(ringbuf_t *rb, uint8_t data);
 int  ringbuf_get(ringbuf_t *rb); // -1 wenn leer
 bool ringbuf_is_empty(ringbuf_t *rb);
 
+uint16_t ringbuf_count(ringbuf_t *rb);
+uint16_t ringbuf_free(ringbuf_t *rb);
+// zusammenhaengender Block ab tail (ohne Kopie), danach ringbuf_drop()
+uint16_t ringbuf_peek(ringbuf_t *rb, const uint8_t **data);
+void ringbuf_drop(ringbuf_t *rb, uint16_t len);
+
 
 
 #endif /* INC_RINGBUF_H_ */
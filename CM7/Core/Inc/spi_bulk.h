@@ -0,0 +1,61 @@
+/*
+ * spi_bulk.h
+ *
+ *  DMA streaming of long SPI2 transfers (USB <-> SPI, ping-pong in D2 SRAM).
+ */
+#ifndef INC_SPI_BULK_H_
+#define INC_SPI_BULK_H_
+
+#include <stdint.h>
+#include "stm32h7xx_hal.h"
+
+#define SPIB_CHUNK            (4096u)   // Bytes pro Ping-Pong Puffer
+#define SPIB_PRE_MAX          (16u)     // Prefix (Befehl + Adresse) bei SPIB_SRC_FILL
+#define SPIB_IDLE_TIMEOUT_MS  (3000u)   // kein Fortschritt -> Abbruch
+#define SPIB_DMA_IRQ_PRIO     (5u)
+
+// Software-CS (SPI2_NSS Pin als GPIO, aktiv low)
+#define SPIB_CS_PORT          GPIOI
+#define SPIB_CS_PIN           GPIO_PIN_0
+
+// RX Ziel statt Host (z.B. CRC ueber Flash-Inhalt), aus der Superloop
+typedef void (*spib_sink_t)(const uint8_t *data, uint16_t len);
+
+typedef enum {
+    SPIB_SRC_USB = 0,         // TX Daten roh vom Host (SPIB_Feed)
+    SPIB_SRC_FILL,            // Prefix, danach Fuellbyte (Lesen)
+} spib_src_t;
+
+// CS Pin als GPIO Ausgang (inaktiv); nach jedem HAL_SPI_Init aufrufen,
+// die MSP setzt den Pin wieder auf AF
+void SPIB_CsInit(void);
+void SPIB_Cs(uint8_t active);
+
+// total Bytes auf dem Bus takten (8 Bit Frames, Clock/Mode wie HAL Init).
+//   pre/plen nur fuer SPIB_SRC_FILL, die RX Bytes des Prefix gehen nicht
+//   an den Host; capture = MISO per USBS_Write zum Host; hold = CS nach
+//   dem Transfer aktiv lassen
+HAL_StatusTypeDef SPIB_Start(spib_src_t src, uint32_t total, const uint8_t *pre,
+                             uint8_t plen, uint8_t fill, uint8_t capture, uint8_t hold);
+void SPIB_Stop(void);
+uint8_t SPIB_IsActive(void);
+
+// capture an sink statt USBS_Write; mit Sink keine Abschlusszeile, das
+// Ergebnis meldet der Aufrufer (SPIB_LastAborted). NULL = Host
+void SPIB_SetSink(spib_sink_t sink);
+uint8_t SPIB_LastAborted(void);
+
+// Rohdaten-Pfad (MODES_HandleRaw): aktiv solange SPIB_SRC_USB noch Bytes
+// erwartet; return = uebernommene Bytes (0 = beide Puffer belegt)
+uint8_t SPIB_IsRawActive(void);
+uint16_t SPIB_Feed(const uint8_t *data, uint16_t len);
+
+// aus der Superloop: Puffer weiterreichen, RX zum Host, Ende erkennen
+void SPIB_Poll(void);
+
+void SPIB_PrintStats(void);
+
+// DMA1 Stream 4 (RX, tx = 0) / Stream 5 (TX, tx = 1)
+void SPIB_DmaIRQHandler(uint8_t tx);
+
+#endif /* INC_SPI_BULK_H_ */
@@ -0,0 +1,28 @@
+/*
+ * spi_cyc.h
+ *
+ *  Periodic SPI2 sampler: one transaction template fired by TIM3, streamed in blocks.
+ */
+#ifndef INC_SPI_CYC_H_
+#define INC_SPI_CYC_H_
+
+#include <stdint.h>
+#include "stm32h7xx_hal.h"
+
+#define SPCYC_SYNC            (0x5AA5u)
+#define SPCYC_HDR_SIZE        (8u)      // u16 sync, u16 Samples, u32 seq erstes Sample
+#define SPCYC_BLOCK_MAX       (1024u)   // Nutzdaten pro Block
+#define SPCYC_FLUSH_MS        (20u)     // angefangenen Block spaetestens dann senden
+
+// Vorlage: tx (frames * width Bytes) geht bei jedem Timer Tick raus,
+// die RX Bytes kommen als ein Sample in den Block
+HAL_StatusTypeDef SPCYC_Start(uint32_t hz, const uint8_t *tx, uint16_t frames, uint8_t width,
+                              uint8_t hw_cs);
+void SPCYC_Stop(void);
+uint8_t SPCYC_IsActive(void);
+
+// aus der Superloop: fertige Samples blockweise per usb_stream zum Host
+void SPCYC_Poll(void);
+void SPCYC_PrintStats(void);
+
+#endif /* INC_SPI_CYC_H_ */
@@ -0,0 +1,62 @@
+/*
+ * spi_flash.h
+ *
+ *  SPI NOR flash engine on SPI2 (JEDEC/SFDP probe, read, erase, program, CRC32).
+ */
+#ifndef INC_SPI_FLASH_H_
+#define INC_SPI_FLASH_H_
+
+#include <stdint.h>
+#include "stm32h7xx_hal.h"
+
+#define SNOR_SLOTS            (8u)      // Page Puffer zwischen USB und Flash
+#define SNOR_PAGE_MAX         (512u)
+#define SNOR_ERASE_TYPES      (4u)
+#define SNOR_SPI_TIMEOUT_MS   (100u)
+#define SNOR_PP_TIMEOUT_MS    (20u)     // WIP nach Page Program
+#define SNOR_ERASE_TIMEOUT_MS (5000u)   // pro Sektor/Block
+#define SNOR_CHIP_TIMEOUT_MS  (400000u)
+#define SNOR_IDLE_TIMEOUT_MS  (3000u)   // write: keine Daten vom Host
+
+typedef struct {
+    uint32_t size;
+    uint8_t op;
+} snor_erase_t;
+
+typedef struct {
+    uint8_t valid;
+    uint8_t jedec[3];
+    uint8_t sfdp;                       // Parameter aus SFDP (sonst JEDEC Defaults)
+    uint8_t sfdp_major;
+    uint8_t sfdp_minor;
+    uint32_t size;                      // Bytes
+    uint16_t page;
+    uint8_t addr_bytes;                 // 3 / 4
+    uint8_t en4b;                       // 4 Byte per EN4B statt eigener Opcodes
+    uint8_t op_read;                    // Fast Read 1-1-1
+    uint8_t read_dummy;                 // Dummy Bytes nach der Adresse
+    uint8_t op_pp;
+    uint8_t n_erase;
+    snor_erase_t erase[SNOR_ERASE_TYPES];   // aufsteigend
+} snor_info_t;
+
+// JEDEC ID + SFDP lesen, Parameter ableiten (SPI2 muss 8 Bit haben)
+HAL_StatusTypeDef SNOR_Probe(void);
+const snor_info_t *SNOR_Info(void);
+void SNOR_PrintInfo(void);
+
+// alle Operationen laufen in SNOR_Poll weiter; Ergebnis als Zeile
+HAL_StatusTypeDef SNOR_Read(uint32_t addr, uint32_t len);      // binaer zum Host
+HAL_StatusTypeDef SNOR_Crc(uint32_t addr, uint32_t len);
+HAL_StatusTypeDef SNOR_Erase(uint32_t addr, uint32_t len);     // len 0 = Chip Erase
+HAL_StatusTypeDef SNOR_Write(uint32_t addr, uint32_t len, uint8_t verify);
+void SNOR_Stop(void);
+uint8_t SNOR_IsActive(void);
+
+// write: Rohdaten vom Host (MODES_HandleRaw)
+uint8_t SNOR_IsRawActive(void);
+uint16_t SNOR_Feed(const uint8_t *data, uint16_t len);
+
+void SNOR_Poll(void);
+
+#endif /* INC_SPI_FLASH_H_ */
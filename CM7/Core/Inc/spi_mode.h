@@ -7,4 +7,10 @@ void SPI_Mode_Enter(void);
 uint8_t SPI_Mode_HandleLine(char *line);
 uint8_t SPI_Mode_HandleChar(char ch);
 
+// bulk tx / flash write: Rohdaten vom Host direkt in die SPI Puffer
+uint16_t SPI_Mode_HandleRaw(const uint8_t *data, uint16_t len);
+uint8_t SPI_Mode_IsRawActive(void);
+void SPI_Mode_Poll(void);
+void SPI_Mode_Exit(void);               // bulk/flash/cyc/target stoppen
+
 #endif /* INC_SPI_MODE_H_ */
@@ -0,0 +1,64 @@
+/*
+ * spi_slave.h
+ *
+ *  SPI2 as bus target: preloaded MISO response, NSS-framed MOSI capture to USB.
+ */
+#ifndef INC_SPI_SLAVE_H_
+#define INC_SPI_SLAVE_H_
+
+#include <stdint.h>
+#include "stm32h7xx_hal.h"
+
+#define SPSL_RING_SIZE        (32768u)  // MOSI Ring in D2 SRAM
+#define SPSL_RESP_MAX         (256u)    // Antwort auf MISO
+#define SPSL_EVQ_SIZE         (64u)     // Frames zwischen ISR und Superloop
+#define SPSL_REC_MAX          (1024u)   // Nutzbytes pro Record
+#define SPSL_POLL_RECORDS     (8u)
+#define SPSL_IRQ_PRIO         (5u)      // EXTI0 und DMA gleich, kein Verdraengen
+
+// Binaer-Record (little endian), Aufbau wie uart_trace:
+//   [0]     SPSL_SYNC
+//   [1]     SPSL_F_x
+//   [2..5]  t_start us (NSS fallend, TIM2)
+//   [6..9]  t_end us (NSS steigend)
+//   [10..11] Laenge, danach die MOSI Bytes
+#define SPSL_SYNC             (0xA6u)
+#define SPSL_HDR_LEN          (12u)
+
+#define SPSL_F_CONT           (0x10u)   // Frame geht im naechsten Record weiter
+#define SPSL_F_UDR            (0x20u)   // Antwort zu kurz, Master hat Fuellbytes gelesen
+#define SPSL_F_OVR            (0x40u)   // SPI Overrun im Frame
+#define SPSL_F_LOST           (0x80u)   // Bytes davor verloren (Ring/Queue voll)
+
+typedef enum {
+    SPSL_TARGET = 0,          // MISO antwortet mit dem Antwortpuffer
+    SPSL_SNIFF,               // nur mithoeren, MISO bleibt Eingang
+} spsl_role_t;
+
+typedef struct {
+    uint8_t role;             // spsl_role_t
+    uint8_t mode;             // SPI Mode 0..3 des Masters
+    uint8_t msb;              // 1 = MSB first
+    uint8_t loop;             // Antwort endlos statt pro Frame von vorne
+    uint8_t fill;             // MISO nach dem Antwortende (Underrun)
+} spsl_cfg_t;
+
+// Antwortpuffer setzen (append = anhaengen); gilt ab dem naechsten Frame,
+// HAL_BUSY solange ein Target mit loop laeuft
+HAL_StatusTypeDef SPSL_SetResponse(const uint8_t *data, uint16_t len, uint8_t append);
+uint16_t SPSL_ResponseLen(void);
+
+// SPI2 als Slave (NSS Hardware an PI0), 8 Bit Frames
+HAL_StatusTypeDef SPSL_Start(const spsl_cfg_t *cfg);
+void SPSL_Stop(void);
+uint8_t SPSL_IsActive(void);
+
+// aus der Superloop: Frames als Records an usb_stream
+void SPSL_Poll(void);
+void SPSL_PrintStats(void);
+
+// EXTI0 (PI0 = NSS, beide Flanken) / DMA1 Stream 4 (RX Ring)
+void SPSL_ExtiIRQHandler(void);
+void SPSL_DmaIRQHandler(void);
+
+#endif /* INC_SPI_SLAVE_H_ */
@@ -0,0 +1,54 @@
+/*
+ * spi_trig.h
+ *
+ *  Timer-triggered SPI2 transactions (TIM3 + DMA) into a circular RX ring.
+ */
+#ifndef INC_SPI_TRIG_H_
+#define INC_SPI_TRIG_H_
+
+#include <stdint.h>
+#include "stm32h7xx_hal.h"
+
+#define SPTRG_RING_SIZE       (16384u)  // RX Ring in D2 SRAM
+#define SPTRG_TX_MAX          (64u)     // Bytes TX Vorlage
+#define SPTRG_TIM_CLK_HZ      (16000000u)   // TIM3: 2 x PCLK1
+#define SPTRG_PERIOD_MIN_US   (10u)     // 100 kHz
+#define SPTRG_PERIOD_MAX_US   (65536u)
+#define SPTRG_GUARD_TICKS     (8u)      // Flags loeschen 8 Timer Ticks vor dem naechsten Start
+#define SPTRG_DMA_IRQ_PRIO    (5u)
+
+typedef struct {
+    uint32_t period_us;
+    uint16_t frames;          // Frames pro Transaktion (TSIZE)
+    uint8_t width;            // Bytes pro Frame im Speicher: 1 / 2 / 4 (DSIZE)
+    const uint8_t *tx;        // frames * width Bytes, NULL = nur RX (Simplex)
+    uint8_t hw_cs;            // NSS (PI0) per Hardware, aktiv je Transaktion
+} sptrg_cfg_t;
+
+typedef struct {
+    uint32_t records;         // im Ring angekommen
+    uint32_t expected;        // Trigger seit Start (aus TIM2)
+    uint32_t ring_drops;      // Leser zu langsam, verworfen
+} sptrg_stats_t;
+
+// SPI2 muss vorher per HAL_SPI_Init passend konfiguriert sein (Master,
+// DSIZE, Clock, Richtung). Der Timer startet sofort.
+HAL_StatusTypeDef SPTRG_Start(const sptrg_cfg_t *cfg);
+void SPTRG_Stop(void);
+uint8_t SPTRG_IsActive(void);
+
+// fertige Transaktionen (Records zu frames * width Bytes); Peek liefert
+// den zusammenhaengenden Teil bis zum Ringende
+uint32_t SPTRG_Available(void);
+const uint8_t *SPTRG_Peek(uint32_t *records);
+void SPTRG_Drop(uint32_t records);
+uint16_t SPTRG_RecordSize(void);
+
+// Drops seit dem letzten Aufruf (Ring Overrun), setzt zurueck
+uint32_t SPTRG_TakeDrops(void);
+void SPTRG_GetStats(sptrg_stats_t *st);
+
+// DMA1 Stream 4 (RX Ring, HT/TC)
+void SPTRG_DmaIRQHandler(void);
+
+#endif /* INC_SPI_TRIG_H_ */
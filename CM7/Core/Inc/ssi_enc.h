@@ -0,0 +1,74 @@
+/*
+ * ssi_enc.h
+ *
+ *  SSI absolute encoder reader on SPI2 (receive-only master, timer-triggered DMA).
+ */
+#ifndef INC_SSI_ENC_H_
+#define INC_SSI_ENC_H_
+
+#include <stdint.h>
+#include "stm32h7xx_hal.h"
+
+#define SSI_BITS_MAX          (32u)     // lead + bits + err + par (DSIZE)
+#define SSI_ERR_BITS_MAX      (2u)
+#define SSI_MONO_DEFAULT_US   (25u)
+#define SSI_CLK_DEFAULT_HZ    (500000u)
+#define SSI_TRIG_LATENCY_US   (2u)      // CSTART per DMA bis erste Flanke, Reserve
+#define SSI_POLL_RECORDS      (64u)     // pro SSI_Poll
+#define SSI_READ_TIMEOUT_MS   (10u)
+
+// Binaer Record zum Host (run rec), little endian
+#define SSI_REC_SYNC          (0xA5u)
+#define SSI_REC_SIZE          (8u)      // sync, flags, u16 seq, u32 pos
+#define SSI_F_ERR_MASK        (0x03u)   // Fehlerbits wie vom Geber
+#define SSI_F_PARITY          (0x40u)   // Parity falsch
+#define SSI_F_DROP            (0x80u)   // Luecke davor (seq springt)
+
+typedef enum {
+    SSI_PAR_NONE = 0,
+    SSI_PAR_EVEN,
+    SSI_PAR_ODD,
+} ssi_parity_t;
+
+typedef enum {
+    SSI_OUT_REC = 0,          // ein Binaer Record pro Sample
+    SSI_OUT_STAT,             // min/max/Geschwindigkeit pro Fenster als Text
+} ssi_out_t;
+
+// Frame: [lead][bits (MSB first)][err][par], Parity ueber bits + err
+typedef struct {
+    uint8_t bits;             // Positionsbits 1..32
+    uint8_t err_bits;         // 0..SSI_ERR_BITS_MAX
+    uint8_t parity;           // ssi_parity_t
+    uint8_t gray;             // 1 = Gray Code -> binaer
+    uint8_t lead;             // Bits vor der Position verwerfen
+    uint8_t mode;             // SPI Mode 0..3 (SSI ueblich 3)
+    uint32_t clk_hz;          // gewuenscht, Prescaler rundet ab
+    uint32_t mono_us;         // Monoflop Zeit des Gebers
+} ssi_cfg_t;
+
+typedef struct {
+    uint32_t pos;
+    uint32_t raw;
+    uint8_t err;
+    uint8_t par_fail;
+} ssi_sample_t;
+
+void SSI_DefaultCfg(ssi_cfg_t *cfg);
+
+// SPI2 fuer SSI initialisieren (RX-only Master, CPOL/CPHA aus mode)
+HAL_StatusTypeDef SSI_Apply(const ssi_cfg_t *cfg);
+uint32_t SSI_ClockHz(void);
+uint32_t SSI_MinPeriodUs(void);
+
+// Einzelmessung, wartet die Monoflop Zeit seit dem letzten Frame ab
+HAL_StatusTypeDef SSI_Read(ssi_sample_t *s);
+
+// Timer getriggerte Messung (spi_trig.c), Auswertung in SSI_Poll
+HAL_StatusTypeDef SSI_Run(uint32_t hz, ssi_out_t out, uint32_t stat_ms);
+void SSI_Stop(void);
+uint8_t SSI_IsActive(void);
+void SSI_Poll(void);
+void SSI_PrintStats(void);
+
+#endif /* INC_SSI_ENC_H_ */
@@ -0,0 +1,14 @@
+#ifndef INC_SSI_MODE_H_
+#define INC_SSI_MODE_H_
+
+#include <stdint.h>
+
+void SSI_Mode_Enter(void);
+uint8_t SSI_Mode_HandleLine(char *line);
+uint8_t SSI_Mode_HandleChar(char ch);
+
+// run: Samples aus dem Ring dekodieren und ausgeben
+void SSI_Mode_Poll(void);
+void SSI_Mode_Exit(void);               // run stoppen
+
+#endif /* INC_SSI_MODE_H_ */
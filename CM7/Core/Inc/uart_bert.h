@@ -0,0 +1,44 @@
+/*
+ * uart_bert.h
+ *
+ *  PRBS bit-error-rate test and baud/slew-rate sweep on UART4 (RS485).
+ */
+#ifndef INC_UART_BERT_H_
+#define INC_UART_BERT_H_
+
+#include <stdint.h>
+#include "stm32h7xx_hal.h"
+#include "uart_stream.h"
+
+#define BERT_SWEEP_MAX        (16u)     // Baudraten pro Sweep
+#define BERT_DWELL_DEF_MS     (2000u)
+#define BERT_SETTLE_MS        (20u)     // nach Umschalten nicht auswerten
+
+// ITU-T O.150 Polynome, Wert = Registerlaenge
+typedef enum {
+    BERT_PRBS7 = 7,           // x^7 + x^6 + 1
+    BERT_PRBS15 = 15,         // x^15 + x^14 + 1
+    BERT_PRBS23 = 23,         // x^23 + x^18 + 1
+} bert_prbs_t;
+
+// Dauerlauf mit den aktuellen Line Settings (8 Datenbits); TX immer
+// UART4, RX ueber UART4 (Echo des Transceivers / externe Schleife) oder
+// UART8. Laeuft bis BERT_Stop.
+HAL_StatusTypeDef BERT_Start(bert_prbs_t prbs, uarts_ch_t rx);
+
+// Sweep: jede Baudrate mit jeder SLR Einstellung aus slr_mask (Bit 0 =
+// SLR aus, Bit 1 = SLR an) fuer dwell_ms, Ergebnis pro Schritt
+HAL_StatusTypeDef BERT_Sweep(bert_prbs_t prbs, uarts_ch_t rx, const uint32_t *bauds,
+                             uint8_t n, uint8_t slr_mask, uint32_t dwell_ms);
+
+void BERT_Stop(void);
+uint8_t BERT_IsActive(void);
+
+void BERT_PrintStats(void);
+void BERT_PrintResults(void);
+void BERT_ResetStats(void);
+
+// aus der Superloop (UART_Mode_Poll): TX Ring fuellen, RX pruefen
+void BERT_Poll(void);
+
+#endif /* INC_UART_BERT_H_ */
@@ -0,0 +1,43 @@
+/*
+ * uart_bridge.h
+ *
+ *  UART4 + UART8 multiplexed over the USB CDC link with channel framing.
+ */
+#ifndef INC_UART_BRIDGE_H_
+#define INC_UART_BRIDGE_H_
+
+#include <stdint.h>
+#include "stm32h7xx_hal.h"
+
+// Frame (beide Richtungen): <UBRG_HDR | kanal> <len 1..255> <len Bytes>
+//   kanal 0 = UART4, 1 = UART8, UBRG_CH_CTRL = Steuerung
+//   9 Datenbits: 16 Bit LE pro Zeichen, len gerade
+// ESC (0x1B) an Stelle eines Kopfbytes beendet die Bridge.
+#define UBRG_HDR              (0xB0u)
+#define UBRG_HDR_MASK         (0xF0u)
+#define UBRG_CH_CTRL          (0x0Fu)
+#define UBRG_PAYLOAD_MAX      (255u)
+
+// Steuer-Payload (Host -> Geraet), erstes Byte:
+//   UBRG_CTRL_EXIT
+//   UBRG_CTRL_LINE  <ch> <baud:4 LE> <data_bits> <'N'|'E'|'O'> <stop 0/1/2>
+//   UBRG_CTRL_STAT  <ch>  -> Antwort UBRG_CTRL_STAT <ch> <rx:4> <tx:4> <lost:4> <err:4>
+//   UBRG_CTRL_LINE Antwort: UBRG_CTRL_LINE <ch> <status 0 = ok> <baud real:4>
+#define UBRG_CTRL_EXIT        (0x00u)
+#define UBRG_CTRL_LINE        (0x01u)
+#define UBRG_CTRL_STAT        (0x02u)
+
+HAL_StatusTypeDef UBRG_Start(void);
+void UBRG_Stop(void);
+uint8_t UBRG_IsActive(void);
+
+// Host -> UARTs; return = verbrauchte Bytes (TX Ring voll -> weniger)
+uint16_t UBRG_HandleRaw(const uint8_t *data, uint16_t len);
+
+// UARTs -> Host, aus der Superloop
+void UBRG_Poll(void);
+
+void UBRG_PrintStats(void);
+void UBRG_ResetStats(void);
+
+#endif /* INC_UART_BRIDGE_H_ */
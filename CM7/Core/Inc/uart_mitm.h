@@ -0,0 +1,39 @@
+/*
+ * uart_mitm.h
+ *
+ *  UART4 <-> UART8 man-in-the-middle proxy with timestamped logging.
+ */
+#ifndef INC_UART_MITM_H_
+#define INC_UART_MITM_H_
+
+#include <stdint.h>
+#include "stm32h7xx_hal.h"
+
+#define MITM_RULE_MAX         (8u)
+#define MITM_PAT_MAX          (8u)      // Muster- und Ersatzlaenge
+
+// Richtungen (Bitmaske fuer Regeln, Index fuer MITM_DmaIRQHandler)
+#define MITM_DIR_48           (0x01u)   // UART4 -> UART8
+#define MITM_DIR_84           (0x02u)   // UART8 -> UART4
+
+// Weiterleitung UART4 <-> UART8 mit den aktuellen Line Settings (8 Bit),
+// Mitschnitt beider Richtungen ueber uart_trace.c
+HAL_StatusTypeDef MITM_Start(void);
+void MITM_Stop(void);
+uint8_t MITM_IsActive(void);
+
+// Regel: pat (1..MITM_PAT_MAX) wird durch rep ersetzt, rlen = 0 verwirft.
+// Richtungen ohne Regel laufen DMA -> DMA, mit Regel ueber den DMA TC IRQ.
+int MITM_RuleAdd(uint8_t dirs, const uint8_t *pat, uint8_t plen,
+                 const uint8_t *rep, uint8_t rlen);
+HAL_StatusTypeDef MITM_RuleDelete(uint8_t idx);
+void MITM_RuleClear(void);
+void MITM_PrintRules(void);
+
+void MITM_PrintStats(void);
+void MITM_ResetStats(void);
+
+// aus DMA2_Stream1_IRQHandler (0) / DMA2_Stream2_IRQHandler (1)
+void MITM_DmaIRQHandler(uint8_t dir);
+
+#endif /* INC_UART_MITM_H_ */
@@ -8,7 +8,9 @@ void UART_Mode_StartTunnel(uint8_t use_uart8);
 uint8_t UART_Mode_HandleLine(char *line);
 uint8_t UART_Mode_HandleChar(char ch);
 uint8_t UART_Mode_IsRawActive(void);
+uint16_t UART_Mode_HandleRaw(const uint8_t *data, uint16_t len);
 void UART_Mode_Poll(void);
+void UART_Mode_Exit(void);              // Engines, Trigger, Tunnel, RX DMA stoppen
 
 
 #endif /* INC_UART_MODE_H_ */
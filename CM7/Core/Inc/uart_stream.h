@@ -0,0 +1,148 @@
+/*
+ * uart_stream.h
+ *
+ *  DMA based UART receive/transmit engine (UART4 / UART8).
+ */
+#ifndef INC_UART_STREAM_H_
+#define INC_UART_STREAM_H_
+
+#include <stdint.h>
+#include "stm32h7xx_hal.h"
+
+#define UARTS_RX_BUF_SIZE     (4096u)   // pro Kanal, Zweierpotenz
+#define UARTS_RTO_BITS_DEF    (20u)     // Receiver Timeout: 2 Zeichen 8N1
+#define UARTS_TX_BUF_SIZE     (2048u)   // pro Kanal, Zweierpotenz
+
+// RS485 Driver-Enable fuer UART4:
+//   1 = USART Hardware-DE (CR3.DEM, DEAT/DEDT), braucht UART4_DE auf
+//       PA15/PB14 (AF8)
+//   0 = UART_TX_EN als GPIO, Freigabe im TC-Interrupt (diese Platine:
+//       PC12 hat keine UART4_DE Funktion)
+#ifndef UARTS_UART4_HW_DE
+#define UARTS_UART4_HW_DE     0
+#endif
+#define UARTS_DE_TIME_DEF     (8u)      // DEAT/DEDT: 1/2 Bit bei 16x Oversampling
+
+typedef enum {
+    UARTS_CH_UART4 = 0,
+    UARTS_CH_UART8,
+    UARTS_CH_COUNT
+} uarts_ch_t;
+
+// RX Events fuer Protokoll-Engines (aus der UART ISR)
+#define UARTS_EV_IDLE         (1u)
+#define UARTS_EV_RTO          (2u)
+#define UARTS_EV_BREAK        (3u)      // LIN Break erkannt (LBDF)
+
+// Stoppbits, Werte wie bCharFormat der CDC Line Coding
+#define UARTS_STOP_1          (0u)
+#define UARTS_STOP_1_5        (1u)
+#define UARTS_STOP_2          (2u)
+
+typedef struct {
+    uint32_t baud;
+    uint8_t data_bits;    // 7, 8, 9 (ohne Paritaetsbit)
+    char parity;          // 'N', 'E', 'O'
+    uint8_t stop;         // UARTS_STOP_x
+} uarts_line_t;
+
+typedef struct {
+    uint32_t rx_bytes;
+    uint32_t rx_lost;     // Ring ueberlaufen (Host/USB zu langsam)
+    uint32_t ore;         // Overrun
+    uint32_t fe;          // Framing Error
+    uint32_t ne;          // Noise
+    uint32_t pe;          // Parity Error
+    uint32_t idle;        // Idle-Line Events
+    uint32_t rto;         // Receiver-Timeout Events
+    uint32_t brk;         // LIN Break erkannt
+    uint32_t tx_bytes;
+    uint32_t tx_bursts;   // DE-Zyklen (assert..release)
+    uint32_t tx_dma_err;
+} uarts_stats_t;
+
+// head = absoluter Schreibzeiger nach dem Event (Frame-Ende bei RTO)
+typedef void (*uarts_rx_event_cb_t)(uarts_ch_t ch, uint8_t ev, uint32_t head);
+// neue RX Bytes bis head (ISR bzw. mit gesperrten IRQs), Mitleser wie
+// uart_trig.c, unabhaengig vom Ring-Leser
+typedef void (*uarts_rx_tap_t)(uarts_ch_t ch, uint32_t head);
+// TX fertig, DE freigegeben (UART IRQ Kontext)
+typedef void (*uarts_tx_done_cb_t)(uarts_ch_t ch);
+
+UART_HandleTypeDef *UARTS_Handle(uarts_ch_t ch);
+
+// Startet Circular-DMA RX + IDLE/RTO/Error Interrupts (FIFO an)
+HAL_StatusTypeDef UARTS_Start(uarts_ch_t ch);
+void UARTS_Stop(uarts_ch_t ch);
+uint8_t UARTS_IsRunning(uarts_ch_t ch);
+
+// Receiver Timeout in Bitzeiten (0 = aus)
+void UARTS_SetRxTimeout(uarts_ch_t ch, uint32_t bits);
+
+// RX Ring lesen
+uint16_t UARTS_RxAvailable(uarts_ch_t ch);
+// zusammenhaengender Block ab Lesezeiger (ohne Kopie)
+uint16_t UARTS_RxPeek(uarts_ch_t ch, const uint8_t **data);
+void UARTS_RxConsume(uarts_ch_t ch, uint16_t len);
+uint16_t UARTS_Read(uarts_ch_t ch, uint8_t *dst, uint16_t max);
+void UARTS_RxFlush(uarts_ch_t ch);
+// absoluter Lesezeiger (passend zu head der RX Events)
+uint32_t UARTS_RxPos(uarts_ch_t ch);
+// NULL = aus; laeuft im UART IRQ Kontext
+void UARTS_SetRxEventCb(uarts_ch_t ch, uarts_rx_event_cb_t cb);
+void UARTS_SetRxTap(uarts_ch_t ch, uarts_rx_tap_t tap);
+// RX Ring (UARTS_RX_BUF_SIZE), Index = absolute Position & (Groesse - 1)
+const uint8_t *UARTS_RxBuf(uarts_ch_t ch);
+
+// TX: Daten in den TX Ring, DMA laeuft bis der Ring leer ist (Bloecke
+// werden im DMA TC nahtlos nachgeladen), DE wird erst nach TC freigegeben
+// return = uebernommene Bytes
+uint16_t UARTS_Write(uarts_ch_t ch, const uint8_t *data, uint16_t len);
+uint16_t UARTS_TxFree(uarts_ch_t ch);
+uint8_t UARTS_TxBusy(uarts_ch_t ch);
+// TX sofort abbrechen (vor Re-Init), Ring verwerfen, DE freigeben
+void UARTS_TxAbort(uarts_ch_t ch);
+
+// TDR wird von aussen beschrieben (DMA eines Proxys): DE setzen bzw. nach
+// dem naechsten TC freigeben, wie bei einem eigenen TX Burst
+void UARTS_ExtTxBegin(uarts_ch_t ch);
+void UARTS_ExtTxEnd(uarts_ch_t ch);
+void UARTS_SetTxDoneCb(uarts_ch_t ch, uarts_tx_done_cb_t cb);
+// USART FIFO an/aus (aus: RDR bleibt ein Zeichen lang gueltig)
+HAL_StatusTypeDef UARTS_SetFifo(uarts_ch_t ch, uint8_t on);
+
+// DE Assertion/Deassertion Zeit in Sample-Zeiten (1/16 bzw. 1/8 Bit, 0..31)
+// return HAL_ERROR wenn der Kanal kein Hardware-DE hat
+HAL_StatusTypeDef UARTS_SetDeTiming(uarts_ch_t ch, uint8_t assert_t, uint8_t deassert_t);
+void UARTS_GetDeTiming(uarts_ch_t ch, uint8_t *assert_t, uint8_t *deassert_t);
+uint8_t UARTS_HasHwDe(uarts_ch_t ch);
+
+// Line Settings ohne HAL_UART_DeInit/Init. SetBaud schreibt nur BRR/OVER8,
+// SetLine zusaetzlich Wortlaenge/Paritaet/Stoppbits (9 Datenbits: RX/TX
+// Ringe mit 16 Bit LE pro Zeichen, DMA wird umkonfiguriert)
+HAL_StatusTypeDef UARTS_SetBaud(uarts_ch_t ch, uint32_t baud);
+HAL_StatusTypeDef UARTS_SetLine(uarts_ch_t ch, const uarts_line_t *line);
+void UARTS_GetLine(uarts_ch_t ch, uarts_line_t *line);
+uint32_t UARTS_GetRealBaud(uarts_ch_t ch);     // aus BRR zurueckgerechnet
+uint32_t UARTS_KernelClock(uarts_ch_t ch);
+uint8_t UARTS_IsWide(uarts_ch_t ch);
+
+// Autobaud (ABRMOD: 0 = Startbit, 1 = Flanke, 2 = 0x7F, 3 = 0x55)
+// Poll: 0 = laeuft, 1 = fertig (*baud gesetzt), -1 = Fehler
+HAL_StatusTypeDef UARTS_AutoBaudStart(uarts_ch_t ch, uint8_t mode);
+int8_t UARTS_AutoBaudPoll(uarts_ch_t ch, uint32_t *baud);
+void UARTS_AutoBaudCancel(uarts_ch_t ch);
+
+// LIN Mode: CR2.LINEN + 11 Bit Break-Erkennung (UARTS_EV_BREAK), nur 8N1
+HAL_StatusTypeDef UARTS_SetLin(uarts_ch_t ch, uint8_t on);
+uint8_t UARTS_IsLin(uarts_ch_t ch);
+// Break senden (vor den Bytes aus einem folgenden UARTS_Write), DE wie TX
+void UARTS_SendBreak(uarts_ch_t ch);
+
+const uarts_stats_t *UARTS_GetStats(uarts_ch_t ch);
+void UARTS_ResetStats(uarts_ch_t ch);
+
+// aus UART4_IRQHandler / UART8_IRQHandler
+void UARTS_IRQHandler(uarts_ch_t ch);
+
+#endif /* INC_UART_STREAM_H_ */
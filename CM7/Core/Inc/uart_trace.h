@@ -0,0 +1,68 @@
+/*
+ * uart_trace.h
+ *
+ *  Timestamped two-channel receive sniffer (UART4 + UART8).
+ */
+#ifndef INC_UART_TRACE_H_
+#define INC_UART_TRACE_H_
+
+#include <stdint.h>
+#include "stm32h7xx_hal.h"
+
+#define UTRACE_GAP_DEF_US     (100u)    // Burst-Ende nach dieser Ruhezeit
+#define UTRACE_REC_MAX        (256u)    // max. Nutzbytes pro Record
+#define UTRACE_EVQ_SIZE       (32u)     // Bursts pro Kanal in der Queue
+
+// Binaer-Record (little endian):
+//   [0]     UTRACE_SYNC
+//   [1]     Bit 0..3 Kanal (0 = UART4, 1 = UART8), Bit 4..7 UTRACE_F_x
+//   [2..5]  t_start us (TIM2)
+//   [6..9]  t_end us (Ende Stoppbit letztes Zeichen)
+//   [10..11] Laenge, danach die Bytes (9 Bit: 16 Bit LE pro Zeichen)
+#define UTRACE_SYNC           (0xA5u)
+#define UTRACE_HDR_LEN        (12u)
+
+#define UTRACE_F_CONT         (0x10u)   // Burst geht im naechsten Record weiter
+#define UTRACE_F_ERR          (0x20u)   // FE/PE/NE/ORE im Burst
+#define UTRACE_F_EST          (0x40u)   // t_start geschaetzt (kein Startbit-Stempel)
+#define UTRACE_F_LOST         (0x80u)   // Bytes davor verloren (RX Ring/Queue voll)
+
+// Burst-Hook (ISR Kontext): start = 1 erstes Startbit (EXTI),
+// start = 0 Burst-Ende (RTO)
+typedef void (*utrace_hook_t)(uint8_t ch, uint8_t start);
+
+typedef enum {
+    UTRACE_FMT_HEX = 0,
+    UTRACE_FMT_BIN,
+} utrace_fmt_t;
+
+// beide UARTs mit den aktuellen Line Settings starten und mitschneiden
+HAL_StatusTypeDef UTRACE_Start(void);
+void UTRACE_Stop(void);
+uint8_t UTRACE_IsActive(void);
+
+// Burst-Trennung: Ruhezeit in us (wird pro Kanal auf RTO Bitzeiten gerundet)
+HAL_StatusTypeDef UTRACE_SetGap(uint32_t gap_us);
+uint32_t UTRACE_GetGap(void);
+void UTRACE_SetFormat(utrace_fmt_t fmt);
+utrace_fmt_t UTRACE_GetFormat(void);
+// nach Aenderung der Line Settings (Baudrate -> RTO/Zeichenzeit)
+void UTRACE_UpdateTiming(void);
+// Ausgabe an/aus ohne den Mitschnitt anzuhalten (ISR-fest, uart_trig.c);
+// aus: Records werden verworfen, der Record mit dem Umschaltpunkt zaehlt
+// schon zur neuen Einstellung
+void UTRACE_SetCapture(uint8_t on);
+uint8_t UTRACE_GetCapture(void);
+// z.B. uart_mitm.c (DE Steuerung); wird von UTRACE_Stop geloescht
+void UTRACE_SetHook(utrace_hook_t hook);
+
+void UTRACE_PrintStats(void);
+void UTRACE_ResetStats(void);
+
+// aus der Superloop (UART_Mode_Poll)
+void UTRACE_Poll(void);
+
+// aus EXTI9_5_IRQHandler / EXTI15_10_IRQHandler (Startbit der RX Pins)
+void UTRACE_ExtiIRQHandler(void);
+
+#endif /* INC_UART_TRACE_H_ */
@@ -0,0 +1,51 @@
+/*
+ * uart_trig.h
+ *
+ *  Multi-pattern trigger (Aho-Corasick) on the UART4/UART8 RX streams.
+ */
+#ifndef INC_UART_TRIG_H_
+#define INC_UART_TRIG_H_
+
+#include <stdint.h>
+#include "stm32h7xx_hal.h"
+
+#define UTRIG_PAT_MAX         (16u)     // Muster gleichzeitig
+#define UTRIG_PAT_LEN_MAX     (32u)
+#define UTRIG_STATE_MAX       (255u)    // Automat: Summe Musterlaengen < 255
+#define UTRIG_CLASS_MAX       (64u)     // verschiedene Bytewerte + 1
+#define UTRIG_LOG_SIZE        (32u)     // Treffer-Log (Ring)
+
+// Kanal-Maske
+#define UTRIG_CH_UART4        (0x01u)
+#define UTRIG_CH_UART8        (0x02u)
+
+typedef enum {
+    UTRIG_ACT_MARK = 0,       // nur Log (trig log)
+    UTRIG_ACT_NOTIFY,         // Log + Zeile an den Host
+    UTRIG_ACT_CAP_START,      // Trace Ausgabe an (UTRACE_SetCapture)
+    UTRIG_ACT_CAP_STOP,       // Trace Ausgabe aus
+    UTRIG_ACT_DO,             // Digital OUT setzen/loeschen/umschalten
+} utrig_act_t;
+
+// Muster anlegen; Automat wird sofort neu gebaut. Return Index oder -1.
+//   do_bit/do_val nur fuer UTRIG_ACT_DO (val 0/1, 2 = umschalten)
+int UTRIG_Add(uint8_t chans, const uint8_t *pat, uint8_t len, utrig_act_t act,
+              uint8_t do_bit, uint8_t do_val);
+HAL_StatusTypeDef UTRIG_Delete(uint8_t idx);
+void UTRIG_Clear(void);
+
+// Scharf schalten: Mitlesen auf den RX Streams (startet die UARTs bei
+// Bedarf), Erkennung im UART/DMA IRQ, Aktionen sofort dort
+HAL_StatusTypeDef UTRIG_Arm(uint8_t on);
+uint8_t UTRIG_IsArmed(void);
+
+void UTRIG_PrintList(void);
+void UTRIG_PrintLog(void);
+void UTRIG_PrintStats(void);
+void UTRIG_ResetStats(void);
+
+// aus der Superloop: Notify-Zeilen ausgeben (quiet = Raw-Datenstrom
+// aktiv, nur Log), zieht ausserdem die RX Schreibzeiger nach
+void UTRIG_Poll(uint8_t quiet);
+
+#endif /* INC_UART_TRIG_H_ */
@@ -0,0 +1,25 @@
+/*
+ * usb_stream.h
+ *
+ *  Non-blocking bulk output to the USB CDC IN endpoint.
+ */
+#ifndef INC_USB_STREAM_H_
+#define INC_USB_STREAM_H_
+
+#include <stdint.h>
+
+#define USBS_TX_BUF_SIZE    (8192u)   // Zweierpotenz
+#define USBS_CHUNK_MAX      (2048u)   // max. Bytes pro CDC_Transmit_HS
+
+// Daten in den TX Ring legen; return = uebernommene Bytes
+uint16_t USBS_Write(const uint8_t *data, uint16_t len);
+uint16_t USBS_Free(void);
+uint16_t USBS_Pending(void);
+
+// aus der Superloop: naechsten Block an den CDC IN Endpoint geben
+void USBS_Poll(void);
+
+// warten bis alles raus ist (max. timeout_ms), z.B. vor cli_printf
+void USBS_Flush(uint32_t timeout_ms);
+
+#endif /* INC_USB_STREAM_H_ */
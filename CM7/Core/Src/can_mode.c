@@ -5,6 +5,7 @@
  *      Author: emmethsg
  */
 #include "can_mode.h"
+#include "can_sim.h"
 #include "cli.h"
 #include "fdcan.h"
 #include "main.h"
@@ -20,12 +21,28 @@
 //
 // Setup (s):
 //   - LDO3 Voltage/Enable
-//   - Baudrate (125/250/500 kbit, prescaler 8/4/2)
+//   - Baudrate (125/250/500/1000 kbit oder Auto-Erkennung)
 //   - 120R termination (PG6, high = enabled)
 //   - Optical interface disable (PG7, high = enabled)
 //
 // Listen (l):
 //   - start/stop listen output in terminal
+//
+// Auto (auto):
+//   - Bitrate-Erkennung im Bus-Monitoring Mode (kein ACK, keine
+//     Error-Frames): Kandidatenliste durchprobieren, pro Rate das
+//     Protocol Status Register (LEC) auswerten, erste fehlerfreie Rate
+//     mit empfangenen Frames wird uebernommen
+//
+// Bit-Timing wird fuer jede Bitrate aus dem FDCAN Kernel-Takt berechnet
+// (Sample Point ~80 %).
+//
+// ECU Sim (ecu ...):
+//   - Antworttabelle, Matching in der FDCAN RX ISR (siehe can_sim.c)
+//
+// RX laeuft komplett ueber die ISR: FIFO0 wird dort geleert, jede
+// Nachricht geht zuerst an den ECU Sim und dann in einen Software-Ring,
+// aus dem CAN_Mode_Poll() die Listen-Ausgabe erzeugt.
 // ============================================================
 
 typedef enum {
@@ -42,8 +59,27 @@ static can_setup_state_t g_setup_state = CAN_SETUP_NONE;
 static uint16_t g_ldo3_mv = 0;
 static uint8_t  g_ldo3_en = 0;
 
-static uint16_t g_can_baud_kbps = 500;
-static uint16_t g_can_prescaler = 2;
+typedef struct {
+    uint16_t prescaler;
+    uint16_t seg1;
+    uint8_t  seg2;
+    uint8_t  sjw;
+    uint32_t bitrate;   // tatsaechlich erreichte Bitrate (bps)
+} can_timing_t;
+
+#define CAN_SAMPLE_POINT_PERMILLE 800u
+#define CAN_BITRATE_TOL_PPM       5000u   // 0.5 %
+#define CAN_AUTO_WINDOW_MS        40u
+
+// Reihenfolge = Wahrscheinlichkeit (Fahrzeug/Industrie zuerst)
+static const uint32_t g_can_auto_rates[] = {
+    500000u, 250000u, 125000u, 1000000u, 100000u, 800000u,
+    83333u, 50000u, 33333u, 20000u, 10000u,
+};
+
+static uint32_t g_can_bitrate = 125000u;
+static uint16_t g_can_prescaler = 0u;
+static volatile uint32_t g_can_rx_count = 0u;
 static uint8_t g_can_listen = 0;
 
 static uint8_t g_can_120r_enabled = 0;
@@ -56,7 +92,18 @@ static uint8_t g_can_ws_active = 0;
 static char g_can_ws_buf[CAN_WS_MAX];
 static size_t g_can_ws_len = 0u;
 
-static volatile uint8_t g_can_rx_pending = 0u;
+#define CAN_RX_RING_LEN 32u
+
+typedef struct {
+    uint32_t id;
+    uint8_t  len;
+    uint8_t  data[16];
+} can_rx_frame_t;
+
+static can_rx_frame_t g_can_rx_ring[CAN_RX_RING_LEN];
+static volatile uint16_t g_can_rx_head = 0u;
+static volatile uint16_t g_can_rx_tail = 0u;
+static volatile uint32_t g_can_rx_lost = 0u;
 
 static int can_hex_nibble(char c)
 {
@@ -144,13 +191,49 @@ static void can_refresh_rail(void)
     }
 }
 
-static uint16_t can_prescaler_to_baud(uint16_t prescaler)
+static uint32_t can_kernel_clock_hz(void)
 {
-    switch (prescaler) {
-        case 2: return 500;
-        case 4: return 250;
-        case 8: return 125;
-        default: return 0;
+    return HAL_RCCEx_GetPeriphCLKFreq(RCC_PERIPHCLK_FDCAN);
+}
+
+// Kleinsten Prescaler suchen, bei dem die Bitzeit in Nominal-Grenzen passt
+// (1 + SEG1 <= 257, SEG2 <= 128) und die Rate innerhalb der Toleranz liegt.
+static uint8_t can_calc_timing(uint32_t bitrate, can_timing_t *t)
+{
+    uint32_t clk = can_kernel_clock_hz();
+    if (bitrate == 0u || clk == 0u || !t) return 0;
+
+    for (uint32_t pre = 1u; pre <= 512u; pre++) {
+        uint32_t tq = (clk + (pre * bitrate) / 2u) / (pre * bitrate);
+        if (tq > 385u) continue;
+        if (tq < 8u) break;
+
+        uint32_t actual = clk / (pre * tq);
+        uint32_t diff = (actual > bitrate) ? (actual - bitrate) : (bitrate - actual);
+        if ((uint64_t)diff * 1000000u > (uint64_t)bitrate * CAN_BITRATE_TOL_PPM) continue;
+
+        uint32_t seg1 = (tq * CAN_SAMPLE_POINT_PERMILLE + 500u) / 1000u - 1u;
+        uint32_t seg2 = tq - 1u - seg1;
+        if (seg2 > 128u) { seg2 = 128u; seg1 = tq - 1u - seg2; }
+        if (seg2 < 2u)   { seg2 = 2u;   seg1 = tq - 1u - seg2; }
+        if (seg1 < 1u || seg1 > 256u) continue;
+
+        t->prescaler = (uint16_t)pre;
+        t->seg1 = (uint16_t)seg1;
+        t->seg2 = (uint8_t)seg2;
+        t->sjw = (uint8_t)seg2;
+        t->bitrate = actual;
+        return 1;
+    }
+    return 0;
+}
+
+static void can_format_bitrate(char *buf, size_t len, uint32_t bps)
+{
+    if ((bps % 1000u) == 0u) {
+        snprintf(buf, len, "%lu kbit", (unsigned long)(bps / 1000u));
+    } else {
+        snprintf(buf, len, "%lu.%03lu kbit", (unsigned long)(bps / 1000u), (unsigned long)(bps % 1000u));
     }
 }
 
@@ -187,22 +270,17 @@ static uint8_t can_dlc_to_len(uint32_t dlc)
     }
 }
 
-static void can_apply_baud(uint16_t prescaler)
+static HAL_StatusTypeDef can_apply_timing(const can_timing_t *t, uint32_t mode)
 {
-    if (prescaler == 0u) return;
-
-    g_can_prescaler = prescaler;
-    g_can_baud_kbps = can_prescaler_to_baud(prescaler);
-
     hfdcan1.Init.FrameFormat = FDCAN_FRAME_CLASSIC;
-    hfdcan1.Init.Mode = FDCAN_MODE_NORMAL;
+    hfdcan1.Init.Mode = mode;
     hfdcan1.Init.AutoRetransmission = DISABLE;
     hfdcan1.Init.TransmitPause = DISABLE;
     hfdcan1.Init.ProtocolException = DISABLE;
-    hfdcan1.Init.NominalPrescaler = prescaler;
-    hfdcan1.Init.NominalSyncJumpWidth = 4;
-    hfdcan1.Init.NominalTimeSeg1 = 60;
-    hfdcan1.Init.NominalTimeSeg2 = 14;
+    hfdcan1.Init.NominalPrescaler = t->prescaler;
+    hfdcan1.Init.NominalSyncJumpWidth = t->sjw;
+    hfdcan1.Init.NominalTimeSeg1 = t->seg1;
+    hfdcan1.Init.NominalTimeSeg2 = t->seg2;
     hfdcan1.Init.DataPrescaler = 1;
     hfdcan1.Init.DataSyncJumpWidth = 1;
     hfdcan1.Init.DataTimeSeg1 = 1;
@@ -225,8 +303,7 @@ static void can_apply_baud(uint16_t prescaler)
 
     (void)HAL_FDCAN_DeInit(&hfdcan1);
     if (HAL_FDCAN_Init(&hfdcan1) != HAL_OK) {
-        cli_printf("\r\nFDCAN re-init FEHLER\r\n");
-        return;
+        return HAL_ERROR;
     }
 
     FDCAN_FilterTypeDef filter = {0};
@@ -246,15 +323,125 @@ static void can_apply_baud(uint16_t prescaler)
 
     (void)HAL_FDCAN_ConfigRxFifoOverwrite(&hfdcan1, FDCAN_RX_FIFO0, FDCAN_RX_FIFO_BLOCKING);
 
-    if (HAL_FDCAN_Start(&hfdcan1) == HAL_OK) {
-    	(void)HAL_FDCAN_ActivateNotification(&hfdcan1, FDCAN_IT_RX_FIFO0_NEW_MESSAGE, 0);
-        cli_printf("\r\nFDCAN1 re-init OK (%u kbit, prescaler %u)\r\n",
-                   (unsigned)g_can_baud_kbps, (unsigned)g_can_prescaler);
+    if (HAL_FDCAN_Start(&hfdcan1) != HAL_OK) {
+        return HAL_ERROR;
+    }
+    (void)HAL_FDCAN_ActivateNotification(&hfdcan1, FDCAN_IT_RX_FIFO0_NEW_MESSAGE, 0);
+    return HAL_OK;
+}
+
+static void can_apply_bitrate(uint32_t bitrate)
+{
+    can_timing_t t;
+    char br[24];
+
+    if (!can_calc_timing(bitrate, &t)) {
+        can_format_bitrate(br, sizeof(br), bitrate);
+        cli_printf("\r\nFDCAN1: %s mit %lu Hz Kernel-Takt nicht einstellbar\r\n",
+                   br, (unsigned long)can_kernel_clock_hz());
+        return;
+    }
+
+    g_can_bitrate = bitrate;
+    g_can_prescaler = t.prescaler;
+
+    can_format_bitrate(br, sizeof(br), t.bitrate);
+    if (can_apply_timing(&t, FDCAN_MODE_NORMAL) == HAL_OK) {
+        cli_printf("\r\nFDCAN1 re-init OK (%s, prescaler %u, tq %u+%u+1)\r\n",
+                   br, (unsigned)t.prescaler, (unsigned)t.seg1, (unsigned)t.seg2);
     } else {
-        cli_printf("\r\nFDCAN1 start FEHLER\r\n");
+        cli_printf("\r\nFDCAN1 re-init FEHLER\r\n");
     }
 }
 
+// Ein Fenster lang mithoeren: 1 = Frames ohne Fehler, 0 = Fehler/kein Verkehr
+static uint8_t can_auto_probe(uint32_t bitrate, uint32_t *frames, uint32_t *errors)
+{
+    can_timing_t t;
+
+    *frames = 0u;
+    *errors = 0u;
+
+    if (!can_calc_timing(bitrate, &t)) return 0;
+    if (can_apply_timing(&t, FDCAN_MODE_BUS_MONITORING) != HAL_OK) return 0;
+
+    FDCAN_ProtocolStatusTypeDef ps;
+    (void)HAL_FDCAN_GetProtocolStatus(&hfdcan1, &ps);   // LEC zuruecksetzen
+    g_can_rx_count = 0u;
+
+    uint32_t start = HAL_GetTick();
+    while ((HAL_GetTick() - start) < CAN_AUTO_WINDOW_MS) {
+        (void)HAL_FDCAN_GetProtocolStatus(&hfdcan1, &ps);
+        switch (ps.LastErrorCode) {
+            case FDCAN_PROTOCOL_ERROR_STUFF:
+            case FDCAN_PROTOCOL_ERROR_FORM:
+            case FDCAN_PROTOCOL_ERROR_CRC:
+            case FDCAN_PROTOCOL_ERROR_BIT0:
+            case FDCAN_PROTOCOL_ERROR_BIT1:
+                (*errors)++;
+                break;
+            default:
+                break;
+        }
+        *frames = g_can_rx_count;
+
+        // falsche Rate faellt praktisch beim ersten Frame auf -> sofort weiter
+        if (*errors != 0u) return 0;
+        // zwei saubere Frames reichen als Bestaetigung
+        if (*frames >= 2u) return 1;
+    }
+
+    *frames = g_can_rx_count;
+    return (*frames != 0u && *errors == 0u) ? 1u : 0u;
+}
+
+static void can_auto_detect(void)
+{
+    uint8_t sim_was_on = CAN_Sim_IsEnabled();
+    uint8_t listen_was_on = g_can_listen;
+    uint32_t t0 = HAL_GetTick();
+    char br[24];
+
+    CAN_Sim_Enable(0u);
+    g_can_listen = 0u;
+
+    cli_printf("\r\nCAN auto: Bus-Monitoring, %u Kandidaten a %u ms\r\n",
+               (unsigned)(sizeof(g_can_auto_rates) / sizeof(g_can_auto_rates[0])),
+               (unsigned)CAN_AUTO_WINDOW_MS);
+
+    uint32_t found = 0u;
+    for (size_t i = 0; i < sizeof(g_can_auto_rates) / sizeof(g_can_auto_rates[0]); i++) {
+        uint32_t frames = 0u, errors = 0u;
+        uint32_t rate = g_can_auto_rates[i];
+
+        uint8_t ok = can_auto_probe(rate, &frames, &errors);
+        if (CLI_IsDebugEnabled()) {
+            can_format_bitrate(br, sizeof(br), rate);
+            cli_printf("  %-14s frames=%lu err=%lu\r\n", br,
+                       (unsigned long)frames, (unsigned long)errors);
+        }
+        if (ok) {
+            found = rate;
+            break;
+        }
+    }
+
+    uint32_t dt = HAL_GetTick() - t0;
+
+    if (found != 0u) {
+        can_format_bitrate(br, sizeof(br), found);
+        cli_printf("CAN auto: %s erkannt (%lu ms)\r\n", br, (unsigned long)dt);
+        can_apply_bitrate(found);
+    } else {
+        cli_printf("CAN auto: keine Bitrate erkannt (%lu ms, kein Verkehr?)\r\n", (unsigned long)dt);
+        can_apply_bitrate(g_can_bitrate);
+    }
+
+    g_can_rx_tail = g_can_rx_head;
+    g_can_listen = listen_was_on;
+    CAN_Sim_Enable(sim_was_on);
+}
+
 static void can_print_setting_summary(void)
 {
     can_refresh_rail();
@@ -265,8 +452,10 @@ static void can_print_setting_summary(void)
     else cli_printf("%umV", g_ldo3_mv);
     cli_printf("  EN=%u\r\n", (unsigned)g_ldo3_en);
 
-    cli_printf("  Baudrate: %u kbit (prescaler %u)\r\n",
-               (unsigned)g_can_baud_kbps,
+    char br[24];
+    can_format_bitrate(br, sizeof(br), g_can_bitrate);
+    cli_printf("  Baudrate: %s (prescaler %u)\r\n",
+               br,
                (unsigned)g_can_prescaler);
 
     cli_printf("  120R Termination: %s\r\n",
@@ -313,13 +502,17 @@ static void can_setup_show_baud(void)
 {
     g_setup_state = CAN_SETUP_BAUD;
 
+    char br[24];
+    can_format_bitrate(br, sizeof(br), g_can_bitrate);
     cli_printf("\r\n[CAN Setup] Baudrate\r\n");
-    cli_printf("Aktuell: %u kbit (prescaler %u)\r\n\r\n",
-               (unsigned)g_can_baud_kbps, (unsigned)g_can_prescaler);
-
-    cli_printf("  1 - 125 kbit (prescaler 8)\r\n");
-    cli_printf("  2 - 250 kbit (prescaler 4)\r\n");
-    cli_printf("  3 - 500 kbit (prescaler 2)\r\n");
+    cli_printf("Aktuell: %s (prescaler %u)\r\n\r\n",
+               br, (unsigned)g_can_prescaler);
+
+    cli_printf("  1 - 125 kbit\r\n");
+    cli_printf("  2 - 250 kbit\r\n");
+    cli_printf("  3 - 500 kbit\r\n");
+    cli_printf("  4 - 1000 kbit\r\n");
+    cli_printf("  a - Auto-Erkennung (Bus-Monitoring)\r\n");
     cli_printf("  q - back\r\n");
     cli_printf("\r\nAuswahl: ");
 }
@@ -361,7 +554,13 @@ static void can_print_help(void)
     cli_printf("CAN Mode Befehle:\r\n");
     cli_printf("  s           - Setup\r\n");
     cli_printf("  l           - Listen start/stop\r\n");
+    cli_printf("  auto        - Bitrate erkennen (Bus-Monitoring, kein ACK)\r\n");
     cli_printf("  w<ID>#DATAp - Send (HEX), z.B. w123#1122p\r\n");
+    cli_printf("  ecu add <RXID> <VAL>[/MASK] <TXID> <TPL> [ms]\r\n");
+    cli_printf("              - Antwort-Eintrag, TPL: HH=Byte Rn=Anfragebyte n +n=Zaehler\r\n");
+    cli_printf("                z.B. ecu add 7E0 0322F190 7E8 0662R2R3+1AABB\r\n");
+    cli_printf("  ecu del <IDX> | clear | on | off | reset\r\n");
+    cli_printf("  ecu         - Tabelle + Zaehler\r\n");
     cli_printf("  ?           - diese Hilfe\r\n");
 }
 
@@ -378,7 +577,8 @@ static void can_list_toggle(void)
 {
     g_can_listen = g_can_listen ? 0u : 1u;
     if (g_can_listen) {
-    	g_can_rx_pending = 0u;
+        g_can_rx_tail = g_can_rx_head;
+        g_can_rx_lost = 0u;
         can_print_list_header();
     } else {
         cli_printf("\r\n(CAN listen stopped)\r\n");
@@ -482,15 +682,20 @@ static void can_send_frame(const char *line)
        }
 
        uint32_t free_level = HAL_FDCAN_GetTxFifoFreeLevel(&hfdcan1);
-       if (free_level < hfdcan1.Init.TxFifoQueueElmtsNbr) {
+       if (free_level == 0u) {
            cli_printf("\r\nCAN TX busy (fifo=%lu/%lu)\r\n",
                       (unsigned long)free_level,
                       (unsigned long)hfdcan1.Init.TxFifoQueueElmtsNbr);
            return;
        }
 
+    // ECU Sim schreibt aus der ISR in dieselbe TX FIFO
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    HAL_StatusTypeDef tx_st = HAL_FDCAN_AddMessageToTxFifoQ(&hfdcan1, &tx, payload);
+    __set_PRIMASK(primask);
 
-    if (HAL_FDCAN_AddMessageToTxFifoQ(&hfdcan1, &tx, payload) == HAL_OK) {
+    if (tx_st == HAL_OK) {
         cli_printf("\r\nCAN TX OK (ID=0x%lX, DLC=%u)\r\n",
                    (unsigned long)tx.Identifier, (unsigned)payload_len);
         uint32_t start = HAL_GetTick();
@@ -507,21 +712,124 @@ static void can_send_frame(const char *line)
     }
 }
 
+static uint8_t can_parse_u32_hex(const char *s, uint32_t *out)
+{
+    char *end = NULL;
+    if (!s || !*s) return 0;
+    uint32_t v = strtoul(s, &end, 16);
+    if (end == s || *end != '\0') return 0;
+    *out = v;
+    return 1;
+}
+
+static void can_ecu_command(char *args)
+{
+    char *save = NULL;
+    char *sub = strtok_r(args, " \t", &save);
+
+    if (!sub) {
+        CAN_Sim_PrintTable();
+        return;
+    }
+
+    if (strcmp(sub, "on") == 0) {
+        CAN_Sim_Enable(1u);
+        cli_printf("\r\nECU Sim ON\r\n");
+        return;
+    }
+    if (strcmp(sub, "off") == 0) {
+        CAN_Sim_Enable(0u);
+        cli_printf("\r\nECU Sim OFF\r\n");
+        return;
+    }
+    if (strcmp(sub, "clear") == 0) {
+        CAN_Sim_Clear();
+        cli_printf("\r\nECU Sim Tabelle geleert\r\n");
+        return;
+    }
+    if (strcmp(sub, "reset") == 0) {
+        CAN_Sim_ResetStats();
+        cli_printf("\r\nECU Sim Zaehler zurueckgesetzt\r\n");
+        return;
+    }
+    if (strcmp(sub, "del") == 0) {
+        char *tok = strtok_r(NULL, " \t", &save);
+        char *end = NULL;
+        unsigned long idx = tok ? strtoul(tok, &end, 10) : 0u;
+        if (!tok || *end != '\0' || CAN_Sim_Delete((uint16_t)idx) != HAL_OK) {
+            cli_printf("\r\nUsage: ecu del <IDX>\r\n");
+            return;
+        }
+        cli_printf("\r\nECU Sim Eintrag %lu geloescht\r\n", idx);
+        return;
+    }
+    if (strcmp(sub, "add") == 0) {
+        char *t_rx  = strtok_r(NULL, " \t", &save);
+        char *t_val = strtok_r(NULL, " \t", &save);
+        char *t_tx  = strtok_r(NULL, " \t", &save);
+        char *t_tpl = strtok_r(NULL, " \t", &save);
+        char *t_dly = strtok_r(NULL, " \t", &save);
+
+        uint32_t rx_id = 0, tx_id = 0;
+        if (!t_rx || !t_val || !t_tx || !t_tpl ||
+            !can_parse_u32_hex(t_rx, &rx_id) || !can_parse_u32_hex(t_tx, &tx_id)) {
+            cli_printf("\r\nUsage: ecu add <RXID> <VAL>[/MASK] <TXID> <TPL> [ms]\r\n");
+            return;
+        }
+
+        uint8_t val[CAN_SIM_MAX_DATA] = {0};
+        uint8_t msk[CAN_SIM_MAX_DATA] = {0};
+        uint8_t val_len = 0, msk_len = 0;
+
+        char *slash = strchr(t_val, '/');
+        if (slash) *slash = '\0';
+        if (strcmp(t_val, "*") != 0 &&
+            !can_parse_hex_bytes(t_val, val, sizeof(val), &val_len)) {
+            cli_printf("\r\necu add: VAL zu lang (max 8 Bytes)\r\n");
+            return;
+        }
+        if (slash) {
+            if (!can_parse_hex_bytes(slash + 1, msk, sizeof(msk), &msk_len) || msk_len != val_len) {
+                cli_printf("\r\necu add: MASK muss so lang wie VAL sein\r\n");
+                return;
+            }
+        }
+
+        uint16_t delay = 0;
+        if (t_dly) {
+            char *end = NULL;
+            unsigned long d = strtoul(t_dly, &end, 10);
+            if (*end != '\0' || d > 60000u) {
+                cli_printf("\r\necu add: ungueltige Verzoegerung\r\n");
+                return;
+            }
+            delay = (uint16_t)d;
+        }
+
+        int idx = CAN_Sim_Add(rx_id, val, slash ? msk : NULL, val_len, tx_id, t_tpl, delay);
+        if (idx == -2) {
+            cli_printf("\r\necu add: ungueltiges Template (max 8 Bytes, HH/Rn/+n)\r\n");
+        } else if (idx < 0) {
+            cli_printf("\r\necu add: Tabelle voll (%u)\r\n", (unsigned)CAN_SIM_MAX_ENTRIES);
+        } else {
+            cli_printf("\r\nECU Sim Eintrag %d angelegt%s\r\n", idx,
+                       CAN_Sim_IsEnabled() ? "" : " (Sim ist OFF -> 'ecu on')");
+        }
+        return;
+    }
+
+    cli_printf("\r\nUsage: ecu [add|del|clear|on|off|reset]\r\n");
+}
+
 void CAN_Mode_Enter(void)
 {
     g_setup_state = CAN_SETUP_NONE;
     g_can_listen = 0;
     can_ws_reset();
 
-    if (hfdcan1.Init.NominalPrescaler != 0u) {
-        g_can_prescaler = (uint16_t)hfdcan1.Init.NominalPrescaler;
-        uint16_t baud = can_prescaler_to_baud(g_can_prescaler);
-        if (baud != 0u) g_can_baud_kbps = baud;
-    }
-
     can_refresh_rail();
     can_refresh_gpio_state();
-    can_apply_baud(g_can_prescaler);
+    can_apply_bitrate(g_can_bitrate);
 
     if (CLI_IsDebugEnabled()) {
         can_print_help();
@@ -555,6 +863,16 @@ uint8_t CAN_Mode_HandleLine(char *line)
         return 1;
     }
 
+    if (strcmp(line, "auto") == 0) {
+        can_auto_detect();
+        return 1;
+    }
+
+    if (strncmp(line, "ecu", 3) == 0 && (line[3] == '\0' || line[3] == ' ')) {
+        can_ecu_command(line + 3);
+        return 1;
+    }
+
     return 0;
 }
 
@@ -585,9 +903,11 @@ uint8_t CAN_Mode_HandleChar(char ch)
         }
 
         if (g_setup_state == CAN_SETUP_BAUD) {
-            if (ch == '1') { can_apply_baud(8); can_setup_show_baud(); return 1; }
-            if (ch == '2') { can_apply_baud(4); can_setup_show_baud(); return 1; }
-            if (ch == '3') { can_apply_baud(2); can_setup_show_baud(); return 1; }
+            if (ch == '1') { can_apply_bitrate(125000u); can_setup_show_baud(); return 1; }
+            if (ch == '2') { can_apply_bitrate(250000u); can_setup_show_baud(); return 1; }
+            if (ch == '3') { can_apply_bitrate(500000u); can_setup_show_baud(); return 1; }
+            if (ch == '4') { can_apply_bitrate(1000000u); can_setup_show_baud(); return 1; }
+            if (ch == 'a' || ch == 'A') { can_auto_detect(); can_setup_show_baud(); return 1; }
             if (ch == 'q' || ch == 'Q') { can_setup_show_main(); return 1; }
             return 1;
         }
@@ -667,40 +987,32 @@ uint8_t CAN_Mode_HandleChar(char ch)
     return 1;
 }
 
-void CAN_Mode_Poll(void)
+// Sim antwortet aus der ISR und wuerde ausserhalb des Modes weiterlaufen
+void CAN_Mode_Exit(void)
 {
-    if (!g_can_listen) return;
+    CAN_Sim_Enable(0u);
+    g_can_listen = 0u;
+}
 
-    if (!g_can_rx_pending &&
-        HAL_FDCAN_GetRxFifoFillLevel(&hfdcan1, FDCAN_RX_FIFO0) == 0u) {
+void CAN_Mode_Poll(void)
+{
+    if (!g_can_listen) {
+        g_can_rx_tail = g_can_rx_head;
         return;
     }
 
+    if (g_can_rx_lost != 0u) {
+        cli_printf("(CAN RX: %lu Frames verloren)\r\n", (unsigned long)g_can_rx_lost);
+        g_can_rx_lost = 0u;
+    }
 
-    uint8_t retry_guard = 0u;
-
-    while (HAL_FDCAN_GetRxFifoFillLevel(&hfdcan1, FDCAN_RX_FIFO0) > 0u) {
-        FDCAN_RxHeaderTypeDef rx = {0};
-        uint8_t data[64] = {0};
-        if (HAL_FDCAN_GetRxMessage(&hfdcan1, FDCAN_RX_FIFO0, &rx, data) != HAL_OK) {
-            uint32_t err = HAL_FDCAN_GetError(&hfdcan1);
-            if ((err & HAL_FDCAN_ERROR_FIFO_EMPTY) != 0u) {
-                break;
-            }
-            retry_guard++;
-            if (retry_guard > 2u) {
-                break;
-            }
-            continue;
-        }
-        retry_guard = 0u;
-
-        uint8_t len = can_dlc_to_len(rx.DataLength);
-        uint32_t id = rx.Identifier;
+    while (g_can_rx_tail != g_can_rx_head) {
+        const can_rx_frame_t *f = &g_can_rx_ring[g_can_rx_tail];
+        uint8_t len = f->len;
         char line[128];
         size_t used = 0u;
         int wrote = snprintf(line + used, sizeof(line) - used, "%08lX#-%2u-#",
-                             (unsigned long)id,
+                             (unsigned long)f->id,
                              (unsigned)len);
         if (wrote > 0) {
             used += (size_t)wrote;
@@ -712,7 +1024,7 @@ void CAN_Mode_Poll(void)
         for (uint8_t i = 0; i < 16u; i++)
         {
             if (i < len) {
-                wrote = snprintf(line + used, sizeof(line) - used, "%02X ", data[i]);
+                wrote = snprintf(line + used, sizeof(line) - used, "%02X ", f->data[i]);
             } else {
                 wrote = snprintf(line + used, sizeof(line) - used, "   ");
             }
@@ -736,13 +1048,9 @@ void CAN_Mode_Poll(void)
             line[sizeof(line) - 1u] = '\0';
         }
 
+        g_can_rx_tail = (uint16_t)((g_can_rx_tail + 1u) % CAN_RX_RING_LEN);
         cli_printf("%s", line);
     }
-
-    if (HAL_FDCAN_GetRxFifoFillLevel(&hfdcan1, FDCAN_RX_FIFO0) == 0u)
-    {
-        g_can_rx_pending = 0u;
-    }
 }
 
 void HAL_FDCAN_RxFifo0Callback(FDCAN_HandleTypeDef *hfdcan, uint32_t RxFifo0ITs)
@@ -750,11 +1058,32 @@ void HAL_FDCAN_RxFifo0Callback(FDCAN_HandleTypeDef *hfdcan, uint32_t RxFifo0ITs)
     if (hfdcan->Instance != FDCAN1) {
         return;
     }
-    if ((RxFifo0ITs & FDCAN_IT_RX_FIFO0_NEW_MESSAGE) != 0u) {
-        g_can_rx_pending = 1u;
+    if ((RxFifo0ITs & FDCAN_IT_RX_FIFO0_NEW_MESSAGE) == 0u) {
+        return;
     }
-}
 
+    // FIFO komplett leeren: ECU Sim antwortet direkt, Rest in den Listen-Ring
+    while (HAL_FDCAN_GetRxFifoFillLevel(hfdcan, FDCAN_RX_FIFO0) > 0u) {
+        FDCAN_RxHeaderTypeDef rx;
+        uint8_t data[64];
+        if (HAL_FDCAN_GetRxMessage(hfdcan, FDCAN_RX_FIFO0, &rx, data) != HAL_OK) {
+            break;
+        }
 
+        g_can_rx_count++;
+        (void)CAN_Sim_OnRx(&rx, data);
 
+        uint16_t next = (uint16_t)((g_can_rx_head + 1u) % CAN_RX_RING_LEN);
+        if (next == g_can_rx_tail) {
+            g_can_rx_lost++;
+            continue;
+        }
 
+        can_rx_frame_t *f = &g_can_rx_ring[g_can_rx_head];
+        f->id = rx.Identifier;
+        f->len = can_dlc_to_len(rx.DataLength);
+        if (f->len > sizeof(f->data)) f->len = sizeof(f->data);
+        memcpy(f->data, data, f->len);
+        g_can_rx_head = next;
+    }
+}
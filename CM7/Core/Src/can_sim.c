@@ -0,0 +1,414 @@
+/*
+ * can_sim.c
+ *
+ *  ECU response simulator: table-driven auto-replies from the FDCAN RX ISR.
+ */
+#include "can_sim.h"
+#include "cli.h"
+#include "fdcan.h"
+#include <string.h>
+#include <stdio.h>
+
+// ============================================================
+// ECU SIMULATOR
+//
+// - Tabelle mit bis zu 256 Eintraegen (ID + Maske/Wert -> Antwort)
+// - Matching direkt in HAL_FDCAN_RxFifo0Callback, Antwort sofort in
+//   die TX FIFO (deterministische Latenz, kein USB/CLI dazwischen)
+// - Eintraege sind ueber 64 ID-Buckets verkettet, damit die ISR nur
+//   die Kandidaten mit passender ID anschaut
+// - Verzoegerte Antworten laufen ueber CAN_Sim_Tick() (SysTick, 1 ms)
+// ============================================================
+
+#define CAN_SIM_BUCKETS       (64u)
+#define CAN_SIM_NONE          (0xFFFFu)
+
+typedef enum {
+    SIM_SRC_CONST = 0,
+    SIM_SRC_REQ,
+    SIM_SRC_CTR,
+} sim_src_t;
+
+typedef struct {
+    uint8_t  used;
+    uint8_t  rx_ext;
+    uint8_t  tx_ext;
+    uint8_t  match_len;
+    uint32_t rx_id;
+    uint32_t tx_id;
+    uint8_t  mask[CAN_SIM_MAX_DATA];
+    uint8_t  value[CAN_SIM_MAX_DATA];
+    uint8_t  tx_len;
+    uint8_t  src[CAN_SIM_MAX_DATA];   // sim_src_t
+    uint8_t  arg[CAN_SIM_MAX_DATA];   // Konstante / Anfrage-Index / Zaehler-Schritt
+    uint8_t  ctr[CAN_SIM_MAX_DATA];   // laufende Zaehler pro Byte
+    uint16_t delay_ms;
+    uint16_t next;
+    volatile uint32_t hits;
+} sim_entry_t;
+
+typedef struct {
+    uint8_t  used;
+    uint32_t due;
+    FDCAN_TxHeaderTypeDef hdr;
+    uint8_t  data[CAN_SIM_MAX_DATA];
+} sim_delayed_t;
+
+static sim_entry_t g_sim_tab[CAN_SIM_MAX_ENTRIES];
+static uint16_t g_sim_bucket[CAN_SIM_BUCKETS];
+static uint8_t g_sim_bucket_init = 0u;
+
+static sim_delayed_t g_sim_delayed[CAN_SIM_MAX_DELAYED];
+static volatile uint8_t g_sim_delayed_cnt = 0u;
+
+static volatile uint8_t g_sim_enabled = 0u;
+
+static volatile uint32_t g_sim_tx_ok = 0u;
+static volatile uint32_t g_sim_tx_drop = 0u;
+
+static int sim_hex_nibble(char c)
+{
+    if (c >= '0' && c <= '9') return (c - '0');
+    if (c >= 'a' && c <= 'f') return (c - 'a' + 10);
+    if (c >= 'A' && c <= 'F') return (c - 'A' + 10);
+    return -1;
+}
+
+static uint16_t sim_bucket_of(uint32_t id)
+{
+    return (uint16_t)((id ^ (id >> 6) ^ (id >> 12)) & (CAN_SIM_BUCKETS - 1u));
+}
+
+static uint32_t sim_dlc(uint8_t len)
+{
+    static const uint32_t dlc[9] = {
+        FDCAN_DLC_BYTES_0, FDCAN_DLC_BYTES_1, FDCAN_DLC_BYTES_2,
+        FDCAN_DLC_BYTES_3, FDCAN_DLC_BYTES_4, FDCAN_DLC_BYTES_5,
+        FDCAN_DLC_BYTES_6, FDCAN_DLC_BYTES_7, FDCAN_DLC_BYTES_8,
+    };
+    return dlc[(len <= 8u) ? len : 8u];
+}
+
+// Die Buckets werden nur ausserhalb der ISR umgebaut; FDCAN IRQ solange aus.
+static void sim_lock(void)
+{
+    HAL_NVIC_DisableIRQ(FDCAN1_IT0_IRQn);
+}
+
+static void sim_unlock(void)
+{
+    HAL_NVIC_EnableIRQ(FDCAN1_IT0_IRQn);
+}
+
+static void sim_rebuild_buckets(void)
+{
+    for (uint16_t b = 0; b < CAN_SIM_BUCKETS; b++) {
+        g_sim_bucket[b] = CAN_SIM_NONE;
+    }
+
+    // rueckwaerts einhaengen, damit die Kette in Tabellenreihenfolge laeuft
+    for (int i = (int)CAN_SIM_MAX_ENTRIES - 1; i >= 0; i--) {
+        sim_entry_t *e = &g_sim_tab[i];
+        if (!e->used) continue;
+        uint16_t b = sim_bucket_of(e->rx_id);
+        e->next = g_sim_bucket[b];
+        g_sim_bucket[b] = (uint16_t)i;
+    }
+    g_sim_bucket_init = 1u;
+}
+
+// TX FIFO wird aus FDCAN ISR, SysTick und der CLI befuellt -> kurz global sperren
+static void sim_queue_tx(const FDCAN_TxHeaderTypeDef *hdr, const uint8_t *data)
+{
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    HAL_StatusTypeDef st = HAL_FDCAN_AddMessageToTxFifoQ(&hfdcan1, hdr, data);
+    __set_PRIMASK(primask);
+
+    if (st == HAL_OK) g_sim_tx_ok++;
+    else g_sim_tx_drop++;
+}
+
+static uint8_t sim_parse_template(sim_entry_t *e, const char *tpl)
+{
+    uint8_t n = 0;
+
+    if (!tpl) return 0;
+
+    while (*tpl) {
+        if (*tpl == ' ' || *tpl == ':' || *tpl == '.') {
+            tpl++;
+            continue;
+        }
+        if (tpl[1] == '\0') return 0;
+        if (n >= CAN_SIM_MAX_DATA) return 0;
+
+        char k = *tpl;
+        int v = sim_hex_nibble(tpl[1]);
+        if (v < 0) return 0;
+
+        if (k == 'R' || k == 'r') {
+            if (v >= (int)CAN_SIM_MAX_DATA) return 0;
+            e->src[n] = SIM_SRC_REQ;
+            e->arg[n] = (uint8_t)v;
+        } else if (k == '+') {
+            e->src[n] = SIM_SRC_CTR;
+            e->arg[n] = (uint8_t)v;
+        } else {
+            int hi = sim_hex_nibble(k);
+            if (hi < 0) return 0;
+            e->src[n] = SIM_SRC_CONST;
+            e->arg[n] = (uint8_t)((hi << 4) | v);
+        }
+        e->ctr[n] = 0u;
+        n++;
+        tpl += 2;
+    }
+
+    e->tx_len = n;
+    return 1;
+}
+
+int CAN_Sim_Add(uint32_t rx_id,
+                const uint8_t *value,
+                const uint8_t *mask,
+                uint8_t match_len,
+                uint32_t tx_id,
+                const char *tpl,
+                uint16_t delay_ms)
+{
+    if (match_len > CAN_SIM_MAX_DATA) return -1;
+
+    int idx = -1;
+    for (uint16_t i = 0; i < CAN_SIM_MAX_ENTRIES; i++) {
+        if (!g_sim_tab[i].used) { idx = (int)i; break; }
+    }
+    if (idx < 0) return -1;
+
+    sim_entry_t e;
+    memset(&e, 0, sizeof(e));
+
+    e.rx_ext = (rx_id > 0x7FFu) ? 1u : 0u;
+    e.rx_id = rx_id & (e.rx_ext ? 0x1FFFFFFFu : 0x7FFu);
+    e.tx_ext = (tx_id > 0x7FFu) ? 1u : 0u;
+    e.tx_id = tx_id & (e.tx_ext ? 0x1FFFFFFFu : 0x7FFu);
+    e.delay_ms = delay_ms;
+
+    for (uint8_t i = 0; i < match_len; i++) {
+        uint8_t m = mask ? mask[i] : 0xFFu;
+        e.mask[i] = m;
+        e.value[i] = (uint8_t)(value[i] & m);
+        if (m != 0u) e.match_len = (uint8_t)(i + 1u);
+    }
+
+    if (!sim_parse_template(&e, tpl)) return -2;
+
+    e.used = 1u;
+
+    sim_lock();
+    g_sim_tab[idx] = e;
+    sim_rebuild_buckets();
+    sim_unlock();
+
+    return idx;
+}
+
+HAL_StatusTypeDef CAN_Sim_Delete(uint16_t idx)
+{
+    if (idx >= CAN_SIM_MAX_ENTRIES || !g_sim_tab[idx].used) return HAL_ERROR;
+
+    sim_lock();
+    g_sim_tab[idx].used = 0u;
+    sim_rebuild_buckets();
+    sim_unlock();
+    return HAL_OK;
+}
+
+void CAN_Sim_Clear(void)
+{
+    sim_lock();
+    memset(g_sim_tab, 0, sizeof(g_sim_tab));
+    sim_rebuild_buckets();
+    sim_unlock();
+
+    __disable_irq();
+    memset(g_sim_delayed, 0, sizeof(g_sim_delayed));
+    g_sim_delayed_cnt = 0u;
+    __enable_irq();
+}
+
+void CAN_Sim_Enable(uint8_t enable)
+{
+    if (!g_sim_bucket_init) {
+        sim_lock();
+        sim_rebuild_buckets();
+        sim_unlock();
+    }
+    g_sim_enabled = enable ? 1u : 0u;
+}
+
+uint8_t CAN_Sim_IsEnabled(void)
+{
+    return g_sim_enabled;
+}
+
+void CAN_Sim_ResetStats(void)
+{
+    for (uint16_t i = 0; i < CAN_SIM_MAX_ENTRIES; i++) {
+        g_sim_tab[i].hits = 0u;
+    }
+    g_sim_tx_ok = 0u;
+    g_sim_tx_drop = 0u;
+}
+
+void CAN_Sim_PrintTable(void)
+{
+    uint16_t count = 0;
+
+    cli_printf("\r\nECU Sim: %s  tx=%lu drop=%lu\r\n",
+               g_sim_enabled ? "ON" : "OFF",
+               (unsigned long)g_sim_tx_ok,
+               (unsigned long)g_sim_tx_drop);
+    cli_printf("Idx  RX-ID     Value/Mask                          TX-ID     Template          Delay  Hits\r\n");
+
+    for (uint16_t i = 0; i < CAN_SIM_MAX_ENTRIES; i++) {
+        const sim_entry_t *e = &g_sim_tab[i];
+        if (!e->used) continue;
+        count++;
+
+        char vm[40];
+        size_t p = 0;
+        for (uint8_t b = 0; b < e->match_len; b++) {
+            p += (size_t)snprintf(vm + p, sizeof(vm) - p, "%02X", e->value[b]);
+        }
+        if (p < sizeof(vm) - 1u) vm[p++] = '/';
+        for (uint8_t b = 0; b < e->match_len && p < sizeof(vm) - 2u; b++) {
+            p += (size_t)snprintf(vm + p, sizeof(vm) - p, "%02X", e->mask[b]);
+        }
+        vm[(p < sizeof(vm)) ? p : sizeof(vm) - 1u] = '\0';
+
+        char tp[20];
+        size_t q = 0;
+        for (uint8_t b = 0; b < e->tx_len; b++) {
+            if (e->src[b] == SIM_SRC_REQ) tp[q++] = 'R';
+            else if (e->src[b] == SIM_SRC_CTR) tp[q++] = '+';
+            if (e->src[b] == SIM_SRC_CONST) {
+                q += (size_t)snprintf(tp + q, sizeof(tp) - q, "%02X", e->arg[b]);
+            } else {
+                q += (size_t)snprintf(tp + q, sizeof(tp) - q, "%X", e->arg[b]);
+            }
+        }
+        tp[q] = '\0';
+
+        cli_printf("%3u  %08lX  %-34s  %08lX  %-16s  %5u  %lu\r\n",
+                   (unsigned)i,
+                   (unsigned long)e->rx_id,
+                   vm,
+                   (unsigned long)e->tx_id,
+                   tp,
+                   (unsigned)e->delay_ms,
+                   (unsigned long)e->hits);
+    }
+
+    if (count == 0u) {
+        cli_printf("  (leer)\r\n");
+    }
+}
+
+static void sim_build_reply(sim_entry_t *e, const uint8_t *req, uint8_t req_len,
+                            FDCAN_TxHeaderTypeDef *hdr, uint8_t *out)
+{
+    for (uint8_t i = 0; i < e->tx_len; i++) {
+        switch (e->src[i]) {
+            case SIM_SRC_REQ:
+                out[i] = (e->arg[i] < req_len) ? req[e->arg[i]] : 0u;
+                break;
+            case SIM_SRC_CTR:
+                out[i] = e->ctr[i];
+                e->ctr[i] = (uint8_t)(e->ctr[i] + e->arg[i]);
+                break;
+            default:
+                out[i] = e->arg[i];
+                break;
+        }
+    }
+
+    hdr->Identifier = e->tx_id;
+    hdr->IdType = e->tx_ext ? FDCAN_EXTENDED_ID : FDCAN_STANDARD_ID;
+    hdr->TxFrameType = FDCAN_DATA_FRAME;
+    hdr->DataLength = sim_dlc(e->tx_len);
+    hdr->ErrorStateIndicator = FDCAN_ESI_ACTIVE;
+    hdr->BitRateSwitch = FDCAN_BRS_OFF;
+    hdr->FDFormat = FDCAN_CLASSIC_CAN;
+    hdr->TxEventFifoControl = FDCAN_NO_TX_EVENTS;
+    hdr->MessageMarker = 0;
+}
+
+uint8_t CAN_Sim_OnRx(const FDCAN_RxHeaderTypeDef *rx, const uint8_t *data)
+{
+    if (!g_sim_enabled || !rx || !data) return 0u;
+    if (rx->RxFrameType != FDCAN_DATA_FRAME) return 0u;
+
+    uint8_t ext = (rx->IdType == FDCAN_EXTENDED_ID) ? 1u : 0u;
+    uint8_t len = (rx->DataLength > CAN_SIM_MAX_DATA) ? CAN_SIM_MAX_DATA : (uint8_t)rx->DataLength;
+
+    uint16_t i = g_sim_bucket[sim_bucket_of(rx->Identifier)];
+    while (i != CAN_SIM_NONE) {
+        sim_entry_t *e = &g_sim_tab[i];
+        i = e->next;
+
+        if (e->rx_id != rx->Identifier || e->rx_ext != ext) continue;
+        if (len < e->match_len) continue;
+
+        uint8_t ok = 1u;
+        for (uint8_t b = 0; b < e->match_len; b++) {
+            if ((data[b] & e->mask[b]) != e->value[b]) { ok = 0u; break; }
+        }
+        if (!ok) continue;
+
+        e->hits++;
+
+        if (e->delay_ms == 0u) {
+            FDCAN_TxHeaderTypeDef hdr;
+            uint8_t out[CAN_SIM_MAX_DATA];
+            sim_build_reply(e, data, len, &hdr, out);
+            sim_queue_tx(&hdr, out);
+            return 1u;
+        }
+
+        // verzoegert: Antwort jetzt bauen (Anfrage-Bytes), spaeter senden
+        for (uint8_t s = 0; s < CAN_SIM_MAX_DELAYED; s++) {
+            sim_delayed_t *d = &g_sim_delayed[s];
+            if (d->used) continue;
+            sim_build_reply(e, data, len, &d->hdr, d->data);
+            d->due = HAL_GetTick() + e->delay_ms;
+            d->used = 1u;
+            g_sim_delayed_cnt++;
+            return 1u;
+        }
+        g_sim_tx_drop++;
+        return 1u;
+    }
+
+    return 0u;
+}
+
+void CAN_Sim_Tick(void)
+{
+    if (g_sim_delayed_cnt == 0u) return;
+
+    uint32_t now = HAL_GetTick();
+    for (uint8_t s = 0; s < CAN_SIM_MAX_DELAYED; s++) {
+        sim_delayed_t *d = &g_sim_delayed[s];
+        if (!d->used) continue;
+        if ((int32_t)(now - d->due) < 0) continue;
+
+        sim_queue_tx(&d->hdr, d->data);
+
+        uint32_t primask = __get_PRIMASK();
+        __disable_irq();
+        d->used = 0u;
+        g_sim_delayed_cnt--;
+        __set_PRIMASK(primask);
+    }
+}
@@ -10,6 +10,7 @@
 #include "usbd_cdc_if.h"
 #include "pmic.h"
 #include "modes.h"
+#include "usb_stream.h"
 
 #include <stdarg.h>
 #include <stdio.h>
@@ -81,6 +82,9 @@ static void cli_vprintf_send(const char *fmt, va_list args)
     if (len <= 0) return;
     if (len > (int)sizeof(cli_tx_buf)) len = sizeof(cli_tx_buf);
 
+    // gestreamte Daten zuerst raus, sonst ueberholt der Text sie
+    USBS_Flush(50u);
+
     uint8_t result;
     do {
         result = CDC_Transmit_HS((uint8_t*)cli_tx_buf, (uint16_t)len);
@@ -106,6 +110,18 @@ void cli_printf_debug(const char *fmt, ...)
     va_end(args);
 }
 
+// fertiger Text am Stueck (z.B. Tabellen), ohne Laengengrenze von cli_printf
+void cli_write(const char *data, uint16_t len)
+{
+    while (len > 0u) {
+        uint16_t n = USBS_Write((const uint8_t *)data, len);
+        data += n;
+        len = (uint16_t)(len - n);
+        USBS_Flush(50u);
+        if (n == 0u) break;     // Host liest nicht
+    }
+}
+
 // ----------------------------- Banner -----------------------------
 static void CLI_PrintBanner(void)
 {
@@ -472,6 +488,7 @@ void CLI_OnUsbConnect(uint8_t connected)
 void CLI_Process(void)
 {
     MODES_Poll();
+    USBS_Poll();
 
 	if (cli_connect_event && !cli_banner_printed) {
         cli_connect_event = 0;
@@ -480,8 +497,21 @@ void CLI_Process(void)
         cli_banner_printed = 1;
     }
 
-    int c;
-    while ((c = ringbuf_get(&g_rx_ringbuf)) != -1) {
+    for (;;) {
+        // ---- Raw Mode (Tunnel): ganze USB Pakete am Stueck weitergeben ----
+        if (MODES_IsRawActive()) {
+            const uint8_t *p = NULL;
+            uint16_t n = ringbuf_peek(&g_rx_ringbuf, &p);
+            if (n == 0u) break;
+
+            uint16_t done = MODES_HandleRaw(p, n);
+            ringbuf_drop(&g_rx_ringbuf, done);
+            if (done == 0u) break;   // Ziel voll -> naechster Durchlauf
+            continue;
+        }
+
+        int c = ringbuf_get(&g_rx_ringbuf);
+        if (c == -1) break;
         uint8_t ch = (uint8_t)c;
 
         // ---- MENU Mode: Single-Key sofort verarbeiten ----
@@ -495,12 +525,6 @@ void CLI_Process(void)
             continue;
         }
 
-        if (MODES_IsRawActive()) {
-                  if (MODES_HandleChar((char)ch)) {
-                      continue;
-                  }
-              }
-
         // ---- ESC sequence parsing for arrows ----
         if (esc_state == 0) {
             if (ch == 0x1B) { esc_state = 1; continue; }
@@ -573,7 +597,8 @@ void CLI_Process(void)
         }
 
         // ---- Mode kann Zeichen "schlucken" (z.B. w...z...p) ----
-        if (MODES_HandleChar((char)ch)) {
+        // nur am Zeilenanfang, sonst landen Hotkeys mitten in Zeilenkommandos
+        if (cli_line_pos == 0u && MODES_HandleChar((char)ch)) {
             // nicht in cli_line übernehmen
             continue;
         }
@@ -602,4 +627,7 @@ void CLI_Process(void)
             cli_line[cli_line_pos] = '\0';
         }
     }
+
+    // Ring wieder leer genug -> USB OUT Endpoint freigeben
+    CDC_ResumeRx_HS();
 }
@@ -0,0 +1,720 @@
+/*
+ * dio_la.c
+ *
+ *  8-channel logic analyzer on Digital_IN_0..7 (TIM8-triggered DMA of GPIOE->IDR).
+ */
+#include "dio_la.h"
+#include "usb_stream.h"
+#include "cli.h"
+#include "main.h"
+#include "tim.h"
+#include <string.h>
+#include <stdio.h>
+
+// ============================================================
+// DIO LOGIC ANALYZER (Digital_IN_0..7 = PE8..PE15)
+//
+//   - TIM8 Update -> DMA2 Stream 0 liest das obere Byte von GPIOE->IDR,
+//     alle acht Eingaenge in einem Zugriff, keine CPU Arbeit pro Sample
+//   - Ring DIOLA_BUF_SIZE in D2 SRAM aus DIOLA_SEGS Segmenten: NDTR hat
+//     nur 16 Bit, daher Double Buffer Mode; im TC IRQ bekommt der gerade
+//     freie Speicherzeiger (M0AR/M1AR) das uebernaechste Segment
+//   - gespeichert wird das rohe IDR Byte; die Umsortierung nach DI0..7
+//     (Bestueckung: DI0 = PE10, DI7 = PE8, ...) passiert erst bei der
+//     Ausgabe ueber eine 256er Tabelle, der Trigger wird vorher auf rohe
+//     Bits umgerechnet
+//   - Trigger Suche in der Superloop auf dem Ring: alle Trigger brauchen
+//     einen Wechsel, unveraenderte Worte werden zu viert uebersprungen.
+//     Gesucht wird erst ab pre Samples, das Pre-Trigger Fenster ist also
+//     immer voll. Nach dem Trigger stoppt Poll den Timer, sobald post
+//     Samples da sind; was danach noch kommt, ueberschreibt nur Reserve
+//   - DMA FIFO (Byte -> Wort): im Lauf bis zu 3 Samples noch im FIFO,
+//     die Suche bleibt DIOLA_GUARD Samples hinter dem Schreibzeiger
+//   - verpasste Timer Anforderungen (DMA zu langsam) sind am Zaehler
+//     nicht sichtbar, daher Vergleich mit der Zeit aus TIM2 -> DIOLA_F_MISS
+// ============================================================
+
+#define DIOLA_TIM             TIM8
+#define DIOLA_DMA             DMA2_Stream0
+#define DIOLA_MUX             DMAMUX1_Channel8      // DMA2 Stream 0
+#define DIOLA_DMA_FLAGS      (DMA_LISR_FEIF0 | DMA_LISR_DMEIF0 | DMA_LISR_TEIF0 | \
+                               DMA_LISR_HTIF0 | DMA_LISR_TCIF0)
+#define DIOLA_PORT            GPIOE
+#define DIOLA_PORT_SHIFT      (8u)      // PE8..PE15 -> IDR Byte 1
+#define DIOLA_MASK            (DIOLA_BUF_SIZE - 1u)
+#define DIOLA_GUARD           (8u)      // Samples evtl. noch im DMA FIFO
+#define DIOLA_SCAN_CHUNK      (16384u)  // Samples pro Poll, Superloop bleibt bedienbar
+#define DIOLA_OUT_CHUNK       (256u)    // Bytes pro USBS_Write
+#define DIOLA_VCD_LINE        (112u)
+
+static GPIO_TypeDef* const g_diola_port[8] = {
+    Digital_IN_0_GPIO_Port, Digital_IN_1_GPIO_Port, Digital_IN_2_GPIO_Port, Digital_IN_3_GPIO_Port,
+    Digital_IN_4_GPIO_Port, Digital_IN_5_GPIO_Port, Digital_IN_6_GPIO_Port, Digital_IN_7_GPIO_Port,
+};
+static const uint16_t g_diola_pin[8] = {
+    Digital_IN_0_Pin, Digital_IN_1_Pin, Digital_IN_2_Pin, Digital_IN_3_Pin,
+    Digital_IN_4_Pin, Digital_IN_5_Pin, Digital_IN_6_Pin, Digital_IN_7_Pin,
+};
+
+typedef struct {
+    volatile diola_state_t state;
+    diola_cfg_t cfg;
+    uint32_t psc;
+    uint32_t arr;
+    uint32_t ticks;                 // Timer Takte pro Sample
+
+    // Trigger auf rohen IDR Bits
+    uint8_t t_pat;
+    uint8_t t_chg;
+    uint8_t t_mask;
+    uint8_t t_value;
+
+    volatile uint32_t segs;         // fertige Segmente (IRQ)
+    volatile uint32_t dma_err;
+    uint32_t head;                  // geschriebene Samples, absolut
+    uint32_t scan;                  // naechstes zu pruefendes Sample
+    uint8_t prev;                   // Sample davor (roh)
+    uint32_t scan_lost;             // Suche zu langsam, nicht geprueft
+    uint32_t trig;                  // absolut
+    uint32_t t0_us;
+    uint32_t run_us;
+
+    // Ergebnis
+    uint32_t first;                 // erstes Sample im Fenster, absolut
+    uint32_t count;
+    uint32_t pre_eff;
+    uint32_t expected;
+    uint8_t flags;
+
+    // Ausgabe
+    uint8_t dumping;
+    uint8_t hdr_done;
+    diola_fmt_t fmt;
+    uint32_t out;                   // naechstes Sample im Fenster
+    uint8_t run_val;
+    uint32_t run_len;
+} diola_t;
+
+static uint8_t g_diola_buf[DIOLA_BUF_SIZE] D2_RAM;
+
+static uint8_t g_diola_map[256];    // IDR Byte -> Bit n = DIn
+static uint8_t g_diola_raw[8];      // DIn -> Bit im IDR Byte
+static uint8_t g_diola_map_ok;
+
+static diola_t g_la = {
+    .cfg = { .rate_hz = 1000000u, .pre = 4096u, .post = 28672u, .trig = DIOLA_TRIG_NONE },
+    .psc = 0u,
+    .arr = 31u,
+    .ticks = 32u,
+};
+
+// ---------------- Bitzuordnung ----------------
+static HAL_StatusTypeDef diola_build_map(void)
+{
+    if (g_diola_map_ok) return HAL_OK;
+
+    for (uint8_t i = 0u; i < 8u; i++) {
+        if (g_diola_port[i] != DIOLA_PORT) return HAL_ERROR;
+        uint32_t pos = POSITION_VAL(g_diola_pin[i]);
+        if (pos < DIOLA_PORT_SHIFT || pos >= DIOLA_PORT_SHIFT + 8u) return HAL_ERROR;
+        g_diola_raw[i] = (uint8_t)(pos - DIOLA_PORT_SHIFT);
+    }
+    for (uint32_t v = 0u; v < 256u; v++) {
+        uint8_t di = 0u;
+        for (uint8_t i = 0u; i < 8u; i++) {
+            if (v & (1u << g_diola_raw[i])) di |= (uint8_t)(1u << i);
+        }
+        g_diola_map[v] = di;
+    }
+    g_diola_map_ok = 1u;
+    return HAL_OK;
+}
+
+static uint8_t diola_to_raw(uint8_t di)
+{
+    uint8_t raw = 0u;
+    for (uint8_t i = 0u; i < 8u; i++) {
+        if (di & (1u << i)) raw |= (uint8_t)(1u << g_diola_raw[i]);
+    }
+    return raw;
+}
+
+// ---------------- Konfiguration ----------------
+HAL_StatusTypeDef DIOLA_SetConfig(const diola_cfg_t *cfg)
+{
+    if (!cfg) return HAL_ERROR;
+    if (g_la.state == DIOLA_S_ARMED || g_la.state == DIOLA_S_POST || g_la.dumping) return HAL_BUSY;
+    if (cfg->rate_hz == 0u || cfg->rate_hz > DIOLA_RATE_MAX_HZ) return HAL_ERROR;
+    if (cfg->post == 0u || cfg->pre > DIOLA_DEPTH_MAX || cfg->post > DIOLA_DEPTH_MAX - cfg->pre) return HAL_ERROR;
+    if (cfg->trig > DIOLA_TRIG_PATTERN || cfg->ch >= 8u) return HAL_ERROR;
+    if (cfg->trig == DIOLA_TRIG_PATTERN && cfg->mask == 0u) return HAL_ERROR;
+
+    // Takte pro Sample gerundet; ueber 16 Bit mit Prescaler
+    uint32_t n = (DIOLA_TIM_CLK_HZ + cfg->rate_hz / 2u) / cfg->rate_hz;
+    if (n < 2u) n = 2u;
+    uint32_t psc = (n - 1u) / 65536u;
+    uint32_t arr = (n + (psc + 1u) / 2u) / (psc + 1u);
+    if (arr < 2u) arr = 2u;
+    if (arr > 65536u) arr = 65536u;
+
+    g_la.cfg = *cfg;
+    g_la.cfg.mask = (cfg->trig == DIOLA_TRIG_PATTERN) ? cfg->mask : 0u;
+    g_la.cfg.value = (uint8_t)(cfg->value & g_la.cfg.mask);
+    g_la.psc = psc;
+    g_la.arr = arr - 1u;
+    g_la.ticks = (psc + 1u) * arr;
+    g_la.cfg.rate_hz = (DIOLA_TIM_CLK_HZ + g_la.ticks / 2u) / g_la.ticks;
+    return HAL_OK;
+}
+
+void DIOLA_GetConfig(diola_cfg_t *cfg)
+{
+    if (cfg) *cfg = g_la.cfg;
+}
+
+// ---------------- DMA Ring ----------------
+static void diola_stream_off(void)
+{
+    CLEAR_BIT(DIOLA_DMA->CR, DMA_SxCR_EN);
+    for (uint32_t i = 0u; i < 10000u && (DIOLA_DMA->CR & DMA_SxCR_EN); i++) { }
+}
+
+// Segment fertig: freien Zeiger auf das uebernaechste Segment
+static void diola_seg_done(void)
+{
+    DMA2->LIFCR = DMA_LIFCR_CTCIF0;
+    g_la.segs++;
+
+    uint8_t *next = &g_diola_buf[((g_la.segs + 1u) % DIOLA_SEGS) * DIOLA_SEG_SIZE];
+    if (DIOLA_DMA->CR & DMA_SxCR_CT) DIOLA_DMA->M0AR = (uint32_t)next;
+    else DIOLA_DMA->M1AR = (uint32_t)next;
+}
+
+// Schreibzeiger aus Segmenten + NDTR (gesperrt oder IRQ)
+static void diola_update_head(void)
+{
+    for (;;) {
+        if (DMA2->LISR & DMA_LISR_TCIF0) diola_seg_done();
+        uint32_t n = DIOLA_DMA->NDTR;
+        if (!(DMA2->LISR & DMA_LISR_TCIF0)) {
+            g_la.head = g_la.segs * DIOLA_SEG_SIZE + (DIOLA_SEG_SIZE - n);
+            return;
+        }
+    }
+}
+
+static void diola_update_head_locked(void)
+{
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    diola_update_head();
+    __set_PRIMASK(primask);
+}
+
+static void diola_hw_stop(void)
+{
+    DIOLA_TIM->DIER = 0u;
+    CLEAR_BIT(DIOLA_TIM->CR1, TIM_CR1_CEN);
+    g_la.run_us = TIM_Micros() - g_la.t0_us;
+
+    // Zaehlerstand vor dem Abschalten: EN = 0 leert den FIFO, setzt aber TCIF
+    HAL_NVIC_DisableIRQ(DMA2_Stream0_IRQn);
+    diola_update_head();
+    diola_stream_off();
+    DMA2->LIFCR = DIOLA_DMA_FLAGS;
+    NVIC_ClearPendingIRQ(DMA2_Stream0_IRQn);
+}
+
+HAL_StatusTypeDef DIOLA_Arm(void)
+{
+    if (g_la.state == DIOLA_S_ARMED || g_la.state == DIOLA_S_POST || g_la.dumping) return HAL_BUSY;
+    if (diola_build_map() != HAL_OK) return HAL_ERROR;
+
+    const diola_cfg_t *c = &g_la.cfg;
+    uint8_t bit = (uint8_t)(1u << g_diola_raw[c->ch]);
+
+    g_la.t_pat = 0u;
+    g_la.t_chg = bit;
+    g_la.t_mask = 0u;
+    g_la.t_value = 0u;
+    switch (c->trig) {
+        case DIOLA_TRIG_RISE:    g_la.t_mask = bit; g_la.t_value = bit; break;
+        case DIOLA_TRIG_FALL:    g_la.t_mask = bit; break;
+        case DIOLA_TRIG_EDGE:    break;
+        case DIOLA_TRIG_PATTERN:
+            g_la.t_pat = 1u;
+            g_la.t_mask = diola_to_raw(c->mask);
+            g_la.t_value = diola_to_raw(c->value);
+            break;
+        default:                 break;
+    }
+
+    g_la.segs = 0u;
+    g_la.dma_err = 0u;
+    g_la.head = 0u;
+    g_la.scan = 0u;
+    g_la.prev = 0u;
+    g_la.scan_lost = 0u;
+    g_la.first = 0u;
+    g_la.count = 0u;
+    g_la.pre_eff = 0u;
+    g_la.expected = 0u;
+    g_la.flags = 0u;
+    g_la.run_us = 0u;
+
+    // ohne Trigger: die ersten pre + post Samples
+    g_la.trig = c->pre;
+    g_la.state = (c->trig == DIOLA_TRIG_NONE) ? DIOLA_S_POST : DIOLA_S_ARMED;
+
+    // DMA2 S0: IDR Byte 1 -> Ring, Double Buffer ueber die Segmente
+    __HAL_RCC_DMA2_CLK_ENABLE();
+    diola_stream_off();
+    DMA2->LIFCR = DIOLA_DMA_FLAGS;
+    DIOLA_MUX->CCR = DMA_REQUEST_TIM8_UP;
+    DIOLA_DMA->CR = DMA_SxCR_DBM | DMA_SxCR_CIRC | DMA_SxCR_MINC | DMA_SxCR_PL_0 | DMA_SxCR_PL_1 |
+                    DMA_SxCR_MSIZE_1 | DMA_SxCR_TCIE | DMA_SxCR_TEIE;
+    DIOLA_DMA->PAR = (uint32_t)&DIOLA_PORT->IDR + (DIOLA_PORT_SHIFT / 8u);
+    DIOLA_DMA->M0AR = (uint32_t)&g_diola_buf[0];
+    DIOLA_DMA->M1AR = (uint32_t)&g_diola_buf[DIOLA_SEG_SIZE];
+    DIOLA_DMA->NDTR = DIOLA_SEG_SIZE;
+    DIOLA_DMA->FCR = DMA_SxFCR_DMDIS;           // FIFO, Schwelle 1/4 = ein Wort
+    SET_BIT(DIOLA_DMA->CR, DMA_SxCR_EN);
+
+    HAL_NVIC_SetPriority(DMA2_Stream0_IRQn, DIOLA_DMA_IRQ_PRIO, 0);
+    HAL_NVIC_EnableIRQ(DMA2_Stream0_IRQn);
+
+    // TIM8: nur Update DMA, keine Ausgaenge
+    __HAL_RCC_TIM8_CLK_ENABLE();
+    DIOLA_TIM->CR1 = 0u;
+    DIOLA_TIM->CR2 = 0u;
+    DIOLA_TIM->SMCR = 0u;
+    DIOLA_TIM->RCR = 0u;
+    DIOLA_TIM->PSC = g_la.psc;
+    DIOLA_TIM->ARR = g_la.arr;
+    DIOLA_TIM->CNT = 0u;
+    DIOLA_TIM->EGR = TIM_EGR_UG;
+    DIOLA_TIM->SR = 0u;
+    DIOLA_TIM->DIER = TIM_DIER_UDE;
+    g_la.t0_us = TIM_Micros();
+    SET_BIT(DIOLA_TIM->CR1, TIM_CR1_CEN);
+    return HAL_OK;
+}
+
+// Fenster festlegen, Ring hält die letzten DIOLA_BUF_SIZE Samples vor head
+static void diola_finish(void)
+{
+    diola_hw_stop();
+
+    uint32_t end = g_la.trig + g_la.cfg.post;
+    if (end > g_la.head) end = g_la.head;
+    if (g_la.trig > end) g_la.trig = end;
+
+    uint32_t oldest = (g_la.head > DIOLA_BUF_SIZE) ? g_la.head - DIOLA_BUF_SIZE : 0u;
+    if (g_la.trig < oldest || end <= oldest) {
+        // Superloop stand zu lange: Trigger schon ueberschrieben, lieber
+        // keine Aufnahme als neuere Daten an falscher Stelle
+        g_la.flags |= DIOLA_F_LOST;
+        g_la.first = oldest;
+        g_la.pre_eff = 0u;
+        g_la.count = 0u;
+    } else {
+        uint32_t pre = g_la.cfg.pre;
+        if (pre > g_la.trig - oldest) {
+            pre = g_la.trig - oldest;
+            g_la.flags |= DIOLA_F_PRE_CUT;
+        }
+        g_la.first = g_la.trig - pre;
+        g_la.pre_eff = pre;
+        g_la.count = end - g_la.first;
+    }
+
+    // erwartete Samples aus der Laufzeit; 1 % + 2 Toleranz fuer Start/Stop
+    g_la.expected = (uint32_t)(((uint64_t)g_la.run_us * DIOLA_TIM_CLK_HZ) / ((uint64_t)g_la.ticks * 1000000u));
+    if (g_la.head + g_la.head / 100u + 2u < g_la.expected) g_la.flags |= DIOLA_F_MISS;
+
+    g_la.state = DIOLA_S_DONE;
+}
+
+void DIOLA_Force(void)
+{
+    if (g_la.state != DIOLA_S_ARMED) return;
+
+    diola_update_head_locked();
+    g_la.trig = (g_la.head > DIOLA_GUARD) ? g_la.head - DIOLA_GUARD : 0u;
+    g_la.state = DIOLA_S_POST;
+}
+
+void DIOLA_Stop(void)
+{
+    if (g_la.state == DIOLA_S_ARMED || g_la.state == DIOLA_S_POST) {
+        diola_hw_stop();
+        g_la.state = DIOLA_S_IDLE;
+    }
+    g_la.dumping = 0u;
+}
+
+diola_state_t DIOLA_GetState(void)
+{
+    return g_la.state;
+}
+
+uint32_t DIOLA_Samples(void)
+{
+    return (g_la.state == DIOLA_S_DONE) ? g_la.count : 0u;
+}
+
+// ---------------- Trigger Suche ----------------
+static uint8_t diola_match(uint8_t prev, uint8_t cur)
+{
+    if (g_la.t_pat) {
+        return ((cur & g_la.t_mask) == g_la.t_value && (prev & g_la.t_mask) != g_la.t_value) ? 1u : 0u;
+    }
+    return (((prev ^ cur) & g_la.t_chg) && (cur & g_la.t_mask) == g_la.t_value) ? 1u : 0u;
+}
+
+static void diola_scan(void)
+{
+    if (g_la.head <= DIOLA_GUARD) return;
+
+    uint32_t end = g_la.head - DIOLA_GUARD;
+    uint32_t start = (g_la.cfg.pre > 0u) ? g_la.cfg.pre : 1u;
+
+    if (g_la.scan < start) {
+        if (end <= start) return;
+        g_la.scan = start;
+        g_la.prev = g_diola_buf[(start - 1u) & DIOLA_MASK];
+    }
+    // Suche zu weit hinten: ueberschriebene Samples ueberspringen
+    if (end - g_la.scan > DIOLA_DEPTH_MAX) {
+        uint32_t skip = end - DIOLA_DEPTH_MAX - g_la.scan;
+        g_la.scan_lost += skip;
+        g_la.scan += skip;
+        g_la.prev = g_diola_buf[(g_la.scan - 1u) & DIOLA_MASK];
+    }
+    if (end - g_la.scan > DIOLA_SCAN_CHUNK) end = g_la.scan + DIOLA_SCAN_CHUNK;
+
+    while (g_la.scan < end) {
+        uint32_t pos = g_la.scan & DIOLA_MASK;
+        uint32_t n = end - g_la.scan;
+        if (n > DIOLA_BUF_SIZE - pos) n = DIOLA_BUF_SIZE - pos;
+
+        const uint8_t *p = &g_diola_buf[pos];
+        uint8_t prev = g_la.prev;
+        uint32_t i = 0u;
+
+        while (i < n) {
+            // unveraendert: vier Samples auf einmal
+            if (((pos + i) & 3u) == 0u && (n - i) >= 4u &&
+                *(const uint32_t *)&p[i] == (uint32_t)prev * 0x01010101u) {
+                i += 4u;
+                continue;
+            }
+            uint8_t cur = p[i];
+            if (cur != prev) {
+                if (diola_match(prev, cur)) {
+                    g_la.trig = g_la.scan + i;
+                    g_la.flags |= DIOLA_F_TRIG;
+                    g_la.state = DIOLA_S_POST;
+                    return;
+                }
+                prev = cur;
+            }
+            i++;
+        }
+        g_la.prev = prev;
+        g_la.scan += n;
+    }
+}
+
+// ---------------- Ausgabe ----------------
+static inline uint8_t diola_sample(uint32_t idx)
+{
+    return g_diola_map[g_diola_buf[(g_la.first + idx) & DIOLA_MASK]];
+}
+
+static void diola_put_u32(uint8_t *p, uint32_t v)
+{
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+    p[2] = (uint8_t)(v >> 16);
+    p[3] = (uint8_t)(v >> 24);
+}
+
+static uint16_t diola_u64_str(char *s, uint64_t v)
+{
+    char tmp[21];
+    uint16_t n = 0u;
+    do {
+        tmp[n++] = (char)('0' + (v % 10u));
+        v /= 10u;
+    } while (v != 0u);
+    for (uint16_t i = 0u; i < n; i++) s[i] = tmp[n - 1u - i];
+    return n;
+}
+
+// Zeitstempel in 10 ps: TIM8 Takt 31,25 ns = 3125 x 10 ps
+static uint64_t diola_vcd_time(uint32_t idx)
+{
+    return (uint64_t)idx * g_la.ticks * (100000000000ull / DIOLA_TIM_CLK_HZ);
+}
+
+static void diola_dump_raw(void)
+{
+    uint8_t buf[DIOLA_OUT_CHUNK];
+
+    while (g_la.out < g_la.count && USBS_Free() >= DIOLA_OUT_CHUNK) {
+        uint32_t n = g_la.count - g_la.out;
+        if (n > DIOLA_OUT_CHUNK) n = DIOLA_OUT_CHUNK;
+        for (uint32_t i = 0u; i < n; i++) buf[i] = diola_sample(g_la.out + i);
+        (void)USBS_Write(buf, (uint16_t)n);
+        g_la.out += n;
+    }
+    if (g_la.out >= g_la.count) g_la.dumping = 0u;
+}
+
+static uint16_t diola_rle_run(uint8_t *p, uint8_t val, uint32_t len)
+{
+    uint16_t n = 0u;
+    p[n++] = val;
+    do {
+        uint8_t b = (uint8_t)(len & 0x7Fu);
+        len >>= 7;
+        p[n++] = len ? (uint8_t)(b | 0x80u) : b;
+    } while (len);
+    return n;
+}
+
+static void diola_dump_rle(void)
+{
+    uint8_t buf[DIOLA_OUT_CHUNK];
+    uint16_t n = 0u;
+
+    if (!g_la.hdr_done) {
+        if (USBS_Free() < DIOLA_HDR_LEN) return;
+        memset(buf, 0, DIOLA_HDR_LEN);
+        buf[0] = DIOLA_SYNC;
+        buf[1] = (uint8_t)(g_la.flags | DIOLA_F_RLE);
+        diola_put_u32(&buf[2], g_la.cfg.rate_hz);
+        diola_put_u32(&buf[6], g_la.count);
+        diola_put_u32(&buf[10], g_la.pre_eff);
+        (void)USBS_Write(buf, DIOLA_HDR_LEN);
+        g_la.hdr_done = 1u;
+        g_la.run_val = diola_sample(0u);
+        g_la.run_len = 0u;
+    }
+
+    // Wert + max. 5 Bytes LEB128 pro Lauf, Platz fuer den letzten Lauf
+    while (g_la.out < g_la.count && USBS_Free() >= DIOLA_OUT_CHUNK) {
+        n = 0u;
+        while (g_la.out < g_la.count && n <= DIOLA_OUT_CHUNK - 12u) {
+            uint8_t v = diola_sample(g_la.out);
+            if (v != g_la.run_val) {
+                n = (uint16_t)(n + diola_rle_run(&buf[n], g_la.run_val, g_la.run_len));
+                g_la.run_val = v;
+                g_la.run_len = 0u;
+            }
+            g_la.run_len++;
+            g_la.out++;
+        }
+        if (g_la.out >= g_la.count) {
+            n = (uint16_t)(n + diola_rle_run(&buf[n], g_la.run_val, g_la.run_len));
+        }
+        (void)USBS_Write(buf, n);
+    }
+    if (g_la.out >= g_la.count) g_la.dumping = 0u;
+}
+
+static void diola_vcd_header(void)
+{
+    char line[DIOLA_VCD_LINE];
+    int len = snprintf(line, sizeof(line),
+                       "$comment STM32H745 DIO LA, %lu Hz, %lu Samples, Trigger bei %lu%s $end\r\n"
+                       "$timescale 10 ps $end\r\n$scope module la $end\r\n",
+                       (unsigned long)g_la.cfg.rate_hz, (unsigned long)g_la.count,
+                       (unsigned long)g_la.pre_eff, (g_la.flags & DIOLA_F_TRIG) ? "" : " (force)");
+    (void)USBS_Write((const uint8_t *)line, (uint16_t)len);
+    for (uint8_t i = 0u; i < 8u; i++) {
+        len = snprintf(line, sizeof(line), "$var wire 1 %c DI%u $end\r\n", (char)('!' + i), (unsigned)i);
+        (void)USBS_Write((const uint8_t *)line, (uint16_t)len);
+    }
+    len = snprintf(line, sizeof(line), "$upscope $end\r\n$enddefinitions $end\r\n");
+    (void)USBS_Write((const uint8_t *)line, (uint16_t)len);
+}
+
+// "#t" + geaenderte Bits; first = alle Kanaele
+static void diola_vcd_change(uint32_t idx, uint8_t val, uint8_t chg)
+{
+    char line[DIOLA_VCD_LINE];
+    uint16_t n = 0u;
+
+    line[n++] = '#';
+    n = (uint16_t)(n + diola_u64_str(&line[n], diola_vcd_time(idx)));
+    for (uint8_t i = 0u; i < 8u; i++) {
+        if (!(chg & (1u << i))) continue;
+        line[n++] = ' ';
+        line[n++] = (val & (1u << i)) ? '1' : '0';
+        line[n++] = (char)('!' + i);
+    }
+    line[n++] = '\r';
+    line[n++] = '\n';
+    (void)USBS_Write((const uint8_t *)line, n);
+}
+
+static void diola_dump_vcd(void)
+{
+    if (!g_la.hdr_done) {
+        if (USBS_Free() < 512u) return;
+        diola_vcd_header();
+        g_la.run_val = diola_sample(0u);
+        diola_vcd_change(0u, g_la.run_val, 0xFFu);
+        g_la.out = 1u;
+        g_la.hdr_done = 1u;
+    }
+
+    while (g_la.out < g_la.count && USBS_Free() >= DIOLA_VCD_LINE) {
+        // bis zum naechsten Wechsel, Budget pro Poll begrenzt
+        uint32_t budget = DIOLA_SCAN_CHUNK;
+        uint8_t v = g_la.run_val;
+        while (g_la.out < g_la.count && budget-- > 0u && (v = diola_sample(g_la.out)) == g_la.run_val) {
+            g_la.out++;
+        }
+        if (g_la.out >= g_la.count || v == g_la.run_val) break;
+        diola_vcd_change(g_la.out, v, (uint8_t)(v ^ g_la.run_val));
+        g_la.run_val = v;
+        g_la.out++;
+    }
+    // Ende markieren, damit der letzte Zustand eine Laenge hat
+    if (g_la.out >= g_la.count && USBS_Free() >= DIOLA_VCD_LINE) {
+        char line[DIOLA_VCD_LINE];
+        uint16_t n = 0u;
+        line[n++] = '#';
+        n = (uint16_t)(n + diola_u64_str(&line[n], diola_vcd_time(g_la.count)));
+        line[n++] = '\r';
+        line[n++] = '\n';
+        (void)USBS_Write((const uint8_t *)line, n);
+        g_la.dumping = 0u;
+    }
+}
+
+HAL_StatusTypeDef DIOLA_Dump(diola_fmt_t fmt)
+{
+    if (g_la.state != DIOLA_S_DONE || g_la.count == 0u) return HAL_ERROR;
+    if (g_la.dumping) return HAL_BUSY;
+
+    g_la.fmt = fmt;
+    g_la.out = 0u;
+    g_la.hdr_done = 0u;
+    g_la.dumping = 1u;
+    return HAL_OK;
+}
+
+uint8_t DIOLA_IsDumping(void)
+{
+    return g_la.dumping;
+}
+
+// ---------------- Superloop ----------------
+void DIOLA_Poll(void)
+{
+    if (g_la.state == DIOLA_S_ARMED || g_la.state == DIOLA_S_POST) {
+        diola_update_head_locked();
+
+        if (g_la.dma_err) {
+            diola_hw_stop();
+            g_la.state = DIOLA_S_IDLE;
+            cli_printf("\r\nla: DMA Fehler, Aufnahme abgebrochen\r\n");
+            return;
+        }
+        if (g_la.state == DIOLA_S_ARMED) diola_scan();
+        if (g_la.state == DIOLA_S_POST && g_la.head >= g_la.trig + g_la.cfg.post) {
+            diola_finish();
+            if (g_la.flags & DIOLA_F_LOST) {
+                cli_printf("\r\nla: FEHLER, Trigger-Daten schon ueberschrieben (Poll zu spaet)\r\n");
+                return;
+            }
+            cli_printf("\r\nla: fertig, %lu Samples, Trigger bei %lu%s\r\n",
+                       (unsigned long)g_la.count, (unsigned long)g_la.pre_eff,
+                       (g_la.flags & DIOLA_F_MISS) ? " (WARNUNG: Samples verpasst, Rate zu hoch)" : "");
+        }
+    }
+
+    if (g_la.dumping) {
+        if (g_la.fmt == DIOLA_FMT_RLE) diola_dump_rle();
+        else if (g_la.fmt == DIOLA_FMT_VCD) diola_dump_vcd();
+        else diola_dump_raw();
+    }
+}
+
+// ---------------- Status ----------------
+static const char *diola_state_str(diola_state_t s)
+{
+    switch (s) {
+        case DIOLA_S_IDLE:  return "aus";
+        case DIOLA_S_ARMED: return "wartet auf Trigger";
+        case DIOLA_S_POST:  return "Post-Trigger";
+        case DIOLA_S_DONE:  return "fertig";
+        default:            return "?";
+    }
+}
+
+void DIOLA_PrintStatus(void)
+{
+    const diola_cfg_t *c = &g_la.cfg;
+
+    if (g_la.state == DIOLA_S_ARMED || g_la.state == DIOLA_S_POST) diola_update_head_locked();
+
+    cli_printf("\r\nLA: %s, %lu Hz (TIM8 PSC=%lu ARR=%lu), pre=%lu post=%lu\r\n",
+               diola_state_str(g_la.state), (unsigned long)c->rate_hz,
+               (unsigned long)g_la.psc, (unsigned long)g_la.arr,
+               (unsigned long)c->pre, (unsigned long)c->post);
+
+    cli_printf("  Trigger: ");
+    switch (c->trig) {
+        case DIOLA_TRIG_RISE:    cli_printf("steigend DI%u\r\n", (unsigned)c->ch); break;
+        case DIOLA_TRIG_FALL:    cli_printf("fallend DI%u\r\n", (unsigned)c->ch); break;
+        case DIOLA_TRIG_EDGE:    cli_printf("Flanke DI%u\r\n", (unsigned)c->ch); break;
+        case DIOLA_TRIG_PATTERN: {
+            char pat[9];
+            for (uint8_t i = 0u; i < 8u; i++) {
+                uint8_t b = (uint8_t)(1u << (7u - i));
+                pat[i] = (c->mask & b) ? ((c->value & b) ? '1' : '0') : 'x';
+            }
+            pat[8] = '\0';
+            cli_printf("Muster %s (DI7..DI0)\r\n", pat);
+            break;
+        }
+        default:                 cli_printf("keiner\r\n"); break;
+    }
+
+    if (g_la.state == DIOLA_S_ARMED || g_la.state == DIOLA_S_POST) {
+        cli_printf("  Samples=%lu geprueft=%lu", (unsigned long)g_la.head, (unsigned long)g_la.scan);
+        if (g_la.scan_lost) cli_printf(" nicht geprueft=%lu", (unsigned long)g_la.scan_lost);
+        cli_printf("\r\n");
+    } else if (g_la.state == DIOLA_S_DONE) {
+        cli_printf("  Fenster=%lu Samples, Trigger bei %lu (%s)%s\r\n",
+                   (unsigned long)g_la.count, (unsigned long)g_la.pre_eff,
+                   (g_la.flags & DIOLA_F_TRIG) ? "erkannt" : "force/keiner",
+                   (g_la.flags & DIOLA_F_LOST) ? ", Daten ueberschrieben" :
+                   (g_la.flags & DIOLA_F_PRE_CUT) ? ", Pre-Trigger gekuerzt" : "");
+        cli_printf("  aufgenommen=%lu erwartet=%lu%s", (unsigned long)g_la.head, (unsigned long)g_la.expected,
+                   (g_la.flags & DIOLA_F_MISS) ? " -> Samples verpasst" : "");
+        if (g_la.scan_lost) cli_printf(" nicht geprueft=%lu", (unsigned long)g_la.scan_lost);
+        cli_printf("\r\n");
+    }
+    if (g_la.dumping) {
+        cli_printf("  Ausgabe: %lu/%lu\r\n", (unsigned long)g_la.out, (unsigned long)g_la.count);
+    }
+}
+
+// ---------------- IRQ ----------------
+void DIOLA_DmaIRQHandler(void)
+{
+    uint32_t isr = DMA2->LISR & DIOLA_DMA_FLAGS;
+
+    if (isr & DMA_LISR_TEIF0) {
+        g_la.dma_err++;
+        CLEAR_BIT(DIOLA_DMA->CR, DMA_SxCR_TCIE | DMA_SxCR_TEIE);
+    }
+    DMA2->LIFCR = isr & ~DMA_LISR_TCIF0;
+    if (isr & DMA_LISR_TCIF0) diola_seg_done();
+}
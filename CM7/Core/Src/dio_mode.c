@@ -1,4 +1,5 @@
 #include "dio_mode.h"
+#include "dio_la.h"
 #include "cli.h"
 #include "hexstream.h"
 #include "pmic.h"
@@ -21,6 +22,8 @@
 //
 // Readback: 4 Hex-Zeichen: OUT(2) + IN(2) + \r\n
 //
+// Logic Analyzer (la ...): DI0..7 per TIM8 + DMA, siehe dio_la.c
+//
 // Setup (s):
 //   - BUCK3 Voltage/Enable  (Digital OUT IV Block)
 //   - BUCK4 Voltage/Enable  (Digital IN  IV Block)
@@ -89,6 +92,17 @@ static void dio_apply_outputs(uint8_t out)
     g_out_state = out;
 }
 
+void DIO_WriteOut(uint8_t bit, uint8_t val)
+{
+    if (bit >= 8u) return;
+    uint8_t mask = (uint8_t)(1u << bit);
+    if (val == 2u) val = (g_out_state & mask) ? 0u : 1u;
+
+    g_do_port[bit]->BSRR = val ? (uint32_t)g_do_pin[bit] : ((uint32_t)g_do_pin[bit] << 16);
+    if (val) g_out_state |= mask;
+    else g_out_state &= (uint8_t)~mask;
+}
+
 static uint8_t dio_read_inputs(void)
 {
     uint8_t in = 0;
@@ -300,6 +314,123 @@ static void dio_setup_show_bufs(void)
     dio_refresh_rails();
 }*/
 
+// ---------------- Logic Analyzer ----------------
+static void dio_la_usage(void)
+{
+    cli_printf("\r\nla                          - Status\r\n");
+    cli_printf("la cfg [rate=HZ] [pre=N] [post=N] - Rate bis %lu Hz (k/M Suffix), pre + post <= %lu\r\n",
+               (unsigned long)DIOLA_RATE_MAX_HZ, (unsigned long)DIOLA_DEPTH_MAX);
+    cli_printf("la trig none | rise|fall|edge <DI> | pat <DI7..DI0 aus 0/1/x>\r\n");
+    cli_printf("la arm | force | stop       - Aufnahme starten, Trigger erzwingen, abbrechen\r\n");
+    cli_printf("la dump raw|rle|vcd         - Fenster ausgeben (Bit n = DIn)\r\n");
+    cli_printf("  raw: 1 Byte pro Sample, ohne Header (sigrok-cli -I binary:numchannels=8:samplerate=HZ)\r\n");
+    cli_printf("  rle: Header A8 + Wert/Laenge (LEB128), vcd: Text fuer PulseView/GTKWave\r\n");
+}
+
+// 2M, 500k, 100000
+static uint8_t dio_la_parse_rate(const char *s, uint32_t *hz)
+{
+    char *end = NULL;
+    uint32_t v = strtoul(s, &end, 10);
+    if (end == s) return 0u;
+    if (*end == 'k' || *end == 'K') { v *= 1000u; end++; }
+    else if (*end == 'M') { v *= 1000000u; end++; }
+    if (*end != '\0') return 0u;
+    *hz = v;
+    return 1u;
+}
+
+static void dio_cmd_la(void)
+{
+    char *sub = strtok(NULL, " \t");
+    diola_cfg_t cfg;
+    DIOLA_GetConfig(&cfg);
+
+    if (!sub || strcmp(sub, "stat") == 0) {
+        DIOLA_PrintStatus();
+        return;
+    }
+    if (strcmp(sub, "?") == 0) {
+        dio_la_usage();
+        return;
+    }
+
+    if (strcmp(sub, "cfg") == 0) {
+        char *tok;
+        while ((tok = strtok(NULL, " \t")) != NULL) {
+            if (strncmp(tok, "rate=", 5) == 0 && dio_la_parse_rate(tok + 5, &cfg.rate_hz)) continue;
+            if (strncmp(tok, "pre=", 4) == 0) { cfg.pre = strtoul(tok + 4, NULL, 0); continue; }
+            if (strncmp(tok, "post=", 5) == 0) { cfg.post = strtoul(tok + 5, NULL, 0); continue; }
+            dio_la_usage();
+            return;
+        }
+    } else if (strcmp(sub, "trig") == 0) {
+        char *t = strtok(NULL, " \t");
+        char *a = strtok(NULL, " \t");
+        if (!t) { dio_la_usage(); return; }
+
+        if (strcmp(t, "none") == 0) {
+            cfg.trig = DIOLA_TRIG_NONE;
+        } else if (strcmp(t, "pat") == 0) {
+            if (!a || strlen(a) != 8u) { dio_la_usage(); return; }
+            cfg.mask = 0u;
+            cfg.value = 0u;
+            for (uint8_t i = 0u; i < 8u; i++) {
+                uint8_t b = (uint8_t)(1u << (7u - i));
+                if (a[i] == '1') { cfg.mask |= b; cfg.value |= b; }
+                else if (a[i] == '0') cfg.mask |= b;
+                else if (a[i] != 'x' && a[i] != 'X') { dio_la_usage(); return; }
+            }
+            cfg.trig = DIOLA_TRIG_PATTERN;
+        } else {
+            if (strcmp(t, "rise") == 0) cfg.trig = DIOLA_TRIG_RISE;
+            else if (strcmp(t, "fall") == 0) cfg.trig = DIOLA_TRIG_FALL;
+            else if (strcmp(t, "edge") == 0) cfg.trig = DIOLA_TRIG_EDGE;
+            else { dio_la_usage(); return; }
+            if (!a) { dio_la_usage(); return; }
+            cfg.ch = (uint8_t)strtoul(a, NULL, 10);
+        }
+    } else if (strcmp(sub, "arm") == 0) {
+        HAL_StatusTypeDef st = DIOLA_Arm();
+        if (st == HAL_OK) cli_printf("\r\nla: aktiv, %lu Hz\r\n", (unsigned long)cfg.rate_hz);
+        else cli_printf("\r\nla arm: %s\r\n", (st == HAL_BUSY) ? "laeuft schon" : "FEHLER (Pins nicht auf GPIOE 8..15)");
+        return;
+    } else if (strcmp(sub, "force") == 0) {
+        DIOLA_Force();
+        return;
+    } else if (strcmp(sub, "stop") == 0) {
+        DIOLA_Stop();
+        cli_printf("\r\nla: aus\r\n");
+        return;
+    } else if (strcmp(sub, "dump") == 0) {
+        char *f = strtok(NULL, " \t");
+        diola_fmt_t fmt = DIOLA_FMT_RAW;
+        if (f && strcmp(f, "rle") == 0) fmt = DIOLA_FMT_RLE;
+        else if (f && strcmp(f, "vcd") == 0) fmt = DIOLA_FMT_VCD;
+        else if (f && strcmp(f, "raw") != 0) { dio_la_usage(); return; }
+
+        if (DIOLA_Dump(fmt) != HAL_OK) {
+            cli_printf("\r\nla dump: keine fertige Aufnahme\r\n");
+            return;
+        }
+        // raw hat keinen Header: Anzahl steht hier, Bytes folgen nach dem Prompt
+        cli_printf("\r\nla dump: %lu Samples @ %lu Hz\r\n",
+                   (unsigned long)DIOLA_Samples(), (unsigned long)cfg.rate_hz);
+        return;
+    } else {
+        dio_la_usage();
+        return;
+    }
+
+    HAL_StatusTypeDef st = DIOLA_SetConfig(&cfg);
+    if (st != HAL_OK) {
+        cli_printf("\r\nla: %s\r\n", (st == HAL_BUSY) ? "erst 'la stop'" : "FEHLER (Parameter)");
+        dio_la_usage();
+        return;
+    }
+    DIOLA_PrintStatus();
+}
+
 // ---------------- Help ----------------
 static void dio_print_help(void)
 {
@@ -312,6 +443,7 @@ static void dio_print_help(void)
     cli_printf("  s        - Setup\r\n");
     cli_printf("  wp       - Readback (OUT+IN as 4 hex chars)\r\n");
     cli_printf("  w<OO>p   - Set OUT (1 byte) + Readback\r\n");
+    cli_printf("  la ...   - Logic Analyzer DI0..7 (la ?)\r\n");
     cli_printf("  ?        - diese Hilfe\r\n");
 }
 
@@ -342,6 +474,11 @@ uint8_t DIO_Mode_HandleLine(char *line)
         return 1;
     }
 
+    if (strcmp(cmd, "la") == 0) {
+        dio_cmd_la();
+        return 1;
+    }
+
     if (strcmp(cmd, "vi") == 0 || strcmp(cmd, "voltage inputs") == 0)
     {
         cli_printf("Hinweis: vi <mv> ist deprecated, nutze Setup (s).\r\n");
@@ -493,3 +630,14 @@ uint8_t DIO_Mode_HandleChar(char ch)
 
     return 1;
 }
+
+void DIO_Mode_Poll(void)
+{
+    DIOLA_Poll();
+}
+
+// Aufnahme abbrechen, fertige Daten bleiben fuer 'la dump'
+void DIO_Mode_Exit(void)
+{
+    DIOLA_Stop();
+}
@@ -0,0 +1,464 @@
+/*
+ * i2c_eeprom.c
+ *
+ *  24Cxx EEPROM engine on the I2C1 queue (page writes, ACK polling, CRC32).
+ */
+#include "i2c_eeprom.h"
+#include "i2c_queue.h"
+#include "usb_stream.h"
+#include "cli.h"
+#include "crc_util.h"
+#include <string.h>
+
+// ============================================================
+// I2C EEPROM (24Cxx an I2C1)
+//
+//   - 8 Bit Wortadresse (24C01..24C16, Adressbits A8..A10 in der
+//     Geraeteadresse) oder 16 Bit (24C32..24C512)
+//   - alle Zugriffe als Transaktionen in i2c_queue.c (Tag EEP):
+//     read/crc: Wortadresse + Repeated Start + 256 Byte Lesen per DMA,
+//     bis zu EEP_RD_INFLIGHT Bloecke gleichzeitig in der Queue
+//   - write: Rohdaten vom Host laufen in Page-Slots (an Page Grenzen
+//     geschnitten), waehrend der Chip programmiert kommen die naechsten
+//     USB Pakete. Nach jeder Page ACK Polling statt fester 5 ms: die
+//     naechste Page wird sofort gesendet, NACK auf die Adresse heisst
+//     "Schreibzyklus laeuft noch" -> nochmal, bis tWR + Reserve
+//   - CRC32 laeuft beim Empfang mit, Verify = CRC ueber den EEPROM
+//     Inhalt auf dem Geraet, kein Readback ueber USB
+// ============================================================
+
+typedef enum {
+    EEP_OP_IDLE = 0,
+    EEP_OP_READ,
+    EEP_OP_CRC,
+    EEP_OP_WRITE,
+    EEP_OP_VERIFY,                  // CRC Readback nach write
+} eep_op_t;
+
+typedef struct {
+    uint32_t addr;
+    uint16_t len;                   // 0 = Slot frei
+    uint16_t pos;
+    uint8_t data[EEP_PAGE_MAX];
+} eep_slot_t;
+
+typedef struct {
+    eep_op_t op;
+    uint8_t verify;
+    uint8_t pending;                // write: Transaktion in der Queue
+    uint8_t probe;                  // pending ist der abschliessende ACK Poll
+    uint8_t inflight;               // read: Bloecke in der Queue
+    uint32_t start;
+    uint32_t end;
+    uint32_t addr;                  // read: naechster Block
+    uint32_t done;                  // read: bis hier abgeholt
+    uint32_t fed;                   // write: naechste Adresse vom Host
+    uint32_t crc;                   // write: ueber die Host-Daten
+    uint32_t crc_rd;                // Readback
+    uint32_t t_start;
+    uint32_t t_ready;               // letzte Page bestaetigt (ACK Polling ab hier)
+    uint32_t t_progress;
+    uint32_t pages;
+    uint32_t polls;                 // NACK waehrend tWR
+    uint8_t wr;
+    uint8_t rd;
+    uint8_t count;
+} eep_job_t;
+
+typedef struct {
+    const char *name;
+    uint32_t size;
+    uint16_t page;
+    uint8_t a16;
+} eep_type_t;
+
+static const eep_type_t g_eep_types[] = {
+    { "24c01",    128u,   8u, 0u },
+    { "24c02",    256u,   8u, 0u },
+    { "24c04",    512u,  16u, 0u },
+    { "24c08",   1024u,  16u, 0u },
+    { "24c16",   2048u,  16u, 0u },
+    { "24c32",   4096u,  32u, 1u },
+    { "24c64",   8192u,  32u, 1u },
+    { "24c128", 16384u,  64u, 1u },
+    { "24c256", 32768u,  64u, 1u },
+    { "24c512", 65536u, 128u, 1u },
+};
+
+static eep_cfg_t g_eep = { 0u, 0u, 0x50u, 0u };
+static eep_job_t g_job;
+static eep_slot_t g_eep_slot[EEP_SLOTS];
+static i2cq_xfer_t g_eep_x;         // Aufbau, Submit kopiert
+static uint8_t g_eep_wbuf[2u + EEP_PAGE_MAX];
+
+// ---------------- Konfiguration ----------------
+HAL_StatusTypeDef EEP_Preset(const char *name, eep_cfg_t *cfg)
+{
+    if (!name || !cfg) return HAL_ERROR;
+
+    for (uint32_t i = 0u; i < sizeof(g_eep_types) / sizeof(g_eep_types[0]); i++) {
+        const eep_type_t *t = &g_eep_types[i];
+        if (strcmp(name, t->name) == 0 || strcmp(name, t->name + 2) == 0) {
+            cfg->size = t->size;
+            cfg->page = t->page;
+            cfg->a16 = t->a16;
+            return HAL_OK;
+        }
+    }
+    return HAL_ERROR;
+}
+
+HAL_StatusTypeDef EEP_SetCfg(const eep_cfg_t *cfg)
+{
+    if (!cfg || g_job.op != EEP_OP_IDLE) return HAL_BUSY;
+    if (cfg->size == 0u || cfg->size > EEP_SIZE_MAX || cfg->addr7 > 0x7Fu) return HAL_ERROR;
+    if (cfg->page == 0u || cfg->page > EEP_PAGE_MAX || (cfg->page & (cfg->page - 1u)) != 0u) return HAL_ERROR;
+    // 8 Bit Adresse: max. 8 Bloecke a 256 Byte ueber A8..A10
+    if (!cfg->a16 && (cfg->size > 2048u || (cfg->addr7 & (uint8_t)((cfg->size - 1u) >> 8)) != 0u)) {
+        return HAL_ERROR;
+    }
+    g_eep = *cfg;
+    return HAL_OK;
+}
+
+const eep_cfg_t *EEP_GetCfg(void)
+{
+    return &g_eep;
+}
+
+void EEP_PrintCfg(void)
+{
+    if (g_eep.size == 0u) {
+        cli_printf("\r\nee: nicht konfiguriert (ee cfg <24cXX>)\r\n");
+        return;
+    }
+    cli_printf("\r\nEEPROM: %lu Byte (%lu Kbit), Page %u, %s Adresse, @%02X\r\n",
+               (unsigned long)g_eep.size, (unsigned long)(g_eep.size / 128u), (unsigned)g_eep.page,
+               g_eep.a16 ? "16 Bit" : "8 Bit", (unsigned)g_eep.addr7);
+}
+
+// ---------------- Transaktionen ----------------
+static uint8_t eep_dev(uint32_t addr)
+{
+    if (g_eep.a16) return g_eep.addr7;
+    return (uint8_t)(g_eep.addr7 | ((addr >> 8) & 0x7u));
+}
+
+static uint8_t eep_word(uint32_t addr, uint8_t *b)
+{
+    if (!g_eep.a16) { b[0] = (uint8_t)addr; return 1u; }
+    b[0] = (uint8_t)(addr >> 8);
+    b[1] = (uint8_t)addr;
+    return 2u;
+}
+
+static void eep_xfer_init(void)
+{
+    g_eep_x.nseg = 0u;
+    g_eep_x.tag = I2CQ_TAG_EEP;
+}
+
+static void eep_issue_reads(void)
+{
+    while (g_job.inflight < EEP_RD_INFLIGHT && g_job.addr < g_job.end) {
+        uint8_t w[2];
+        uint32_t n = EEP_RD_CHUNK - (g_job.addr % EEP_RD_CHUNK);   // nie ueber eine 256er Grenze
+        if (n > g_job.end - g_job.addr) n = g_job.end - g_job.addr;
+
+        eep_xfer_init();
+        (void)I2CQ_AddSeg(&g_eep_x, eep_dev(g_job.addr), 0u, w, eep_word(g_job.addr, w));
+        (void)I2CQ_AddSeg(&g_eep_x, eep_dev(g_job.addr), 1u, NULL, (uint16_t)n);
+        if (I2CQ_Submit(&g_eep_x, NULL) != HAL_OK) return;     // Queue voll, spaeter
+
+        g_job.addr += n;
+        g_job.inflight++;
+    }
+}
+
+static void eep_issue_write(void)
+{
+    if (g_job.pending) return;
+
+    eep_xfer_init();
+    if (g_job.count > 0u) {
+        eep_slot_t *s = &g_eep_slot[g_job.rd];
+        uint8_t wl = eep_word(s->addr, g_eep_wbuf);
+
+        memcpy(&g_eep_wbuf[wl], s->data, s->len);
+        (void)I2CQ_AddSeg(&g_eep_x, eep_dev(s->addr), 0u, g_eep_wbuf, (uint16_t)(wl + s->len));
+        g_job.probe = 0u;
+    } else if (g_job.fed >= g_job.end) {
+        // letzter Schreibzyklus: nur Adresse, bis der Chip wieder ACKt
+        (void)I2CQ_AddSeg(&g_eep_x, g_eep.addr7, 0u, NULL, 0u);
+        g_job.probe = 1u;
+    } else {
+        return;
+    }
+
+    if (I2CQ_Submit(&g_eep_x, NULL) == HAL_OK) g_job.pending = 1u;
+}
+
+// ---------------- Job Verwaltung ----------------
+static uint8_t eep_check(uint32_t addr, uint32_t len)
+{
+    if (g_job.op != EEP_OP_IDLE || g_job.inflight || g_job.pending) {
+        cli_printf("\r\nee: belegt\r\n");
+        return 0u;
+    }
+    if (g_eep.size == 0u) {
+        cli_printf("\r\nee: erst Typ setzen (ee cfg <24cXX>)\r\n");
+        return 0u;
+    }
+    if (len == 0u || addr >= g_eep.size || len > g_eep.size - addr) {
+        cli_printf("\r\nee: Bereich ausserhalb (Groesse %lu)\r\n", (unsigned long)g_eep.size);
+        return 0u;
+    }
+    return 1u;
+}
+
+static void eep_done(const char *msg)
+{
+    uint32_t ms = HAL_GetTick() - g_job.t_start;
+
+    if (msg) cli_printf("\r\nee: %s\r\n", msg);
+    cli_printf("\r\nee: %lu ms\r\n", (unsigned long)ms);
+    g_job.op = EEP_OP_IDLE;
+    CLI_PrintPrompt();
+}
+
+static void eep_fail(const char *msg, uint32_t addr)
+{
+    cli_printf("\r\nee: FEHLER %s @ 0x%05lX\r\n", msg, (unsigned long)addr);
+    eep_done(NULL);
+}
+
+static void eep_start_read(eep_op_t op, uint32_t addr, uint32_t len)
+{
+    g_job.start = addr;
+    g_job.addr = addr;
+    g_job.done = addr;
+    g_job.end = addr + len;
+    g_job.crc_rd = CRC32_INIT;
+    g_job.op = op;
+    eep_issue_reads();
+}
+
+HAL_StatusTypeDef EEP_Read(uint32_t addr, uint32_t len)
+{
+    if (!eep_check(addr, len)) return HAL_ERROR;
+
+    memset(&g_job, 0, sizeof(g_job));
+    g_job.t_start = HAL_GetTick();
+    cli_printf("\r\nee read: 0x%05lX %lu Bytes\r\n", (unsigned long)addr, (unsigned long)len);
+    USBS_Flush(50u);
+    eep_start_read(EEP_OP_READ, addr, len);
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef EEP_Crc(uint32_t addr, uint32_t len)
+{
+    if (!eep_check(addr, len)) return HAL_ERROR;
+
+    memset(&g_job, 0, sizeof(g_job));
+    g_job.t_start = HAL_GetTick();
+    eep_start_read(EEP_OP_CRC, addr, len);
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef EEP_Write(uint32_t addr, uint32_t len, uint8_t verify)
+{
+    if (!eep_check(addr, len)) return HAL_ERROR;
+
+    memset(&g_job, 0, sizeof(g_job));
+    for (uint8_t i = 0u; i < EEP_SLOTS; i++) g_eep_slot[i].len = 0u;
+    g_job.start = addr;
+    g_job.fed = addr;
+    g_job.end = addr + len;
+    g_job.crc = CRC32_INIT;
+    g_job.verify = verify ? 1u : 0u;
+    g_job.t_start = HAL_GetTick();
+    g_job.t_ready = g_job.t_start;
+    g_job.t_progress = g_job.t_start;
+    g_job.op = EEP_OP_WRITE;
+    return HAL_OK;
+}
+
+void EEP_Stop(void)
+{
+    if (g_job.op == EEP_OP_IDLE) return;
+    eep_done("abgebrochen");        // Ergebnisse in der Queue verwirft EEP_Poll
+}
+
+uint8_t EEP_IsActive(void)
+{
+    return (g_job.op != EEP_OP_IDLE) ? 1u : 0u;
+}
+
+uint8_t EEP_IsRawActive(void)
+{
+    return (g_job.op == EEP_OP_WRITE && g_job.fed < g_job.end) ? 1u : 0u;
+}
+
+uint16_t EEP_Feed(const uint8_t *data, uint16_t len)
+{
+    uint16_t done = 0u;
+
+    if (!EEP_IsRawActive()) return len;
+
+    while (done < len && g_job.fed < g_job.end && g_job.count < EEP_SLOTS) {
+        eep_slot_t *s = &g_eep_slot[g_job.wr];
+        if (s->len == 0u) {
+            uint32_t n = g_eep.page - (g_job.fed % g_eep.page);
+            if (n > g_job.end - g_job.fed) n = g_job.end - g_job.fed;
+            s->addr = g_job.fed;
+            s->len = (uint16_t)n;
+            s->pos = 0u;
+        }
+
+        uint16_t n = (uint16_t)(s->len - s->pos);
+        if (n > (uint16_t)(len - done)) n = (uint16_t)(len - done);
+        memcpy(&s->data[s->pos], &data[done], n);
+        g_job.crc = CRC32_Update(g_job.crc, &data[done], n);
+        s->pos = (uint16_t)(s->pos + n);
+        g_job.fed += n;
+        done = (uint16_t)(done + n);
+
+        if (s->pos == s->len) {
+            g_job.wr = (uint8_t)((g_job.wr + 1u) % EEP_SLOTS);
+            g_job.count++;
+        }
+    }
+    if (done > 0u) g_job.t_progress = HAL_GetTick();
+    return done;
+}
+
+// ---------------- Ergebnisse ----------------
+// 0 = noch nicht abholbar (USB voll), 1 = verarbeitet
+static uint8_t eep_read_result(const i2cq_xfer_t *x)
+{
+    const i2cq_seg_t *s = &x->seg[1];
+
+    g_job.inflight--;
+    if (x->status != I2CQ_OK) {
+        eep_fail(I2CQ_StatusStr(x->status), g_job.done);
+        return 1u;
+    }
+
+    g_job.crc_rd = CRC32_Update(g_job.crc_rd, &x->data[s->off], s->len);
+    if (g_job.op == EEP_OP_READ) (void)USBS_Write(&x->data[s->off], s->len);
+    g_job.done += s->len;
+
+    if (g_job.done < g_job.end) {
+        eep_issue_reads();
+        return 1u;
+    }
+
+    g_job.crc_rd ^= CRC32_XOROUT;
+    if (g_job.op == EEP_OP_READ) {
+        cli_printf("\r\nee read: %lu Bytes, CRC32 %08lX\r\n",
+                   (unsigned long)(g_job.end - g_job.start), (unsigned long)g_job.crc_rd);
+        eep_done(NULL);
+    } else if (g_job.op == EEP_OP_CRC) {
+        cli_printf("\r\nee crc: 0x%05lX +%lu CRC32 %08lX\r\n", (unsigned long)g_job.start,
+                   (unsigned long)(g_job.end - g_job.start), (unsigned long)g_job.crc_rd);
+        eep_done(NULL);
+    } else {
+        eep_done((g_job.crc_rd == g_job.crc) ? "Verify OK" : "Verify FEHLER (CRC)");
+    }
+    return 1u;
+}
+
+static void eep_write_finished(void)
+{
+    uint32_t len = g_job.end - g_job.start;
+    uint32_t ms = HAL_GetTick() - g_job.t_start;
+
+    g_job.crc ^= CRC32_XOROUT;
+    cli_printf("\r\nee write: %lu Bytes, %lu Pages, %lu ACK Polls, CRC32 %08lX",
+               (unsigned long)len, (unsigned long)g_job.pages, (unsigned long)g_job.polls,
+               (unsigned long)g_job.crc);
+    if (ms > 0u) cli_printf(", %lu B/s", (unsigned long)((len * 1000u) / ms));
+    cli_printf("\r\n");
+
+    if (!g_job.verify) {
+        eep_done(NULL);
+        return;
+    }
+    eep_start_read(EEP_OP_VERIFY, g_job.start, len);
+}
+
+static void eep_write_result(const i2cq_xfer_t *x)
+{
+    uint32_t now = HAL_GetTick();
+    uint32_t addr = g_job.probe ? g_job.end : g_eep_slot[g_job.rd].addr;
+
+    g_job.pending = 0u;
+
+    if (x->status == I2CQ_OK) {
+        g_job.t_ready = now;
+        if (g_job.probe) {
+            eep_write_finished();
+            return;
+        }
+        g_eep_slot[g_job.rd].len = 0u;
+        g_job.rd = (uint8_t)((g_job.rd + 1u) % EEP_SLOTS);
+        g_job.count--;
+        g_job.pages++;
+        g_job.t_progress = now;
+        return;
+    }
+
+    // Adresse nicht bestaetigt: Schreibzyklus laeuft noch -> gleiche Page nochmal
+    if (x->status == I2CQ_NACK && x->err_seg == 0u && x->err_pos == 0u) {
+        if ((now - g_job.t_ready) > EEP_WR_TIMEOUT_MS) {
+            eep_fail(g_job.pages ? "ACK Polling Timeout" : "kein ACK (Adresse?)", addr);
+            return;
+        }
+        g_job.polls++;
+        return;
+    }
+
+    eep_fail((x->status == I2CQ_NACK) ? "NACK auf Daten (WP?)" : I2CQ_StatusStr(x->status), addr);
+}
+
+void EEP_Poll(void)
+{
+    const i2cq_xfer_t *x;
+
+    while ((x = I2CQ_Peek()) != NULL && x->tag == I2CQ_TAG_EEP) {
+        eep_op_t op = g_job.op;
+
+        if (x->nseg == 2u && x->seg[1].read) {
+            if (op == EEP_OP_IDLE) {
+                g_job.inflight--;                   // nach Stop/Fehler verwerfen
+            } else {
+                if (op == EEP_OP_READ && x->status == I2CQ_OK && USBS_Free() < x->seg[1].len) break;
+                (void)eep_read_result(x);
+            }
+        } else {
+            if (op == EEP_OP_WRITE) eep_write_result(x);
+            else g_job.pending = 0u;
+        }
+        I2CQ_Pop();
+    }
+
+    switch (g_job.op) {
+        case EEP_OP_READ:
+        case EEP_OP_CRC:
+        case EEP_OP_VERIFY:
+            eep_issue_reads();
+            break;
+
+        case EEP_OP_WRITE:
+            if (!g_job.pending && g_job.count == 0u && g_job.fed < g_job.end &&
+                (HAL_GetTick() - g_job.t_progress) > EEP_IDLE_TIMEOUT_MS) {
+                eep_fail("Timeout (Host Daten)", g_job.fed);
+                break;
+            }
+            eep_issue_write();
+            break;
+
+        default:
+            break;
+    }
+}
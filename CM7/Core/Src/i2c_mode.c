@@ -1,6 +1,13 @@
 #include "i2c_mode.h"
 #include "cli.h"
 #include "pmic.h"
+#include "i2c_scan.h"
+#include "i2c_timing.h"
+#include "i2c_queue.h"
+#include "i2c_eeprom.h"
+#include "i2c_watch.h"
+#include "i2c_slave.h"
+#include "i2c_recover.h"
 #include "usbd_cdc_if.h"   // CDC_Transmit_HS
 #include "setup_utils.h"
 
@@ -9,6 +16,7 @@
 #include <stdlib.h>
 
 extern I2C_HandleTypeDef hi2c1;   // I2C1 am Controller
+extern I2C_HandleTypeDef hi2c4;   // I2C4 intern (PMIC)
 
 // ============================================================
 // I2C MODE (Tool-Port)
@@ -20,34 +28,34 @@ extern I2C_HandleTypeDef hi2c1;   // I2C1 am Controller
 //          NUR 7-bit erlaubt: 0x00..0x7F
 //          Beispiel: w50AABBp  -> addr=0x50, data=AA BB
 //
-// - z: Segmentmarker ("no-stop" für später). Aktuell: nur Echo/Trennung.
-// - p: finalisieren + alles in EINEM I2C-Transmit senden (Stop am Ende)
+// - z: Segmentende, danach Repeated Start (kein STOP) zum naechsten Segment
+// - p: finalisieren, als EINE Transaktion in die Queue (i2c_queue.c),
+//      Stop erst am Ende; Ergebnis kommt aus I2C_Mode_Poll
+//
+// tx Befehl: mehrere Segmente an verschiedene Adressen, ohne Warten
+//   tx @50 w0010 r04 @68 w3B r06 ; @20 w0100
+//   '@AA' Adresse, 'wHEX' schreiben, 'rLEN' lesen (Hex, rb/rw/rh),
+//   ';' STOP und neue Transaktion
+//
+// ee Befehl: 24Cxx EEPROM (i2c_eeprom.c), laeuft ebenfalls ueber die
+//   Queue; write nimmt Rohdaten vom Host, ACK Polling statt fester tWR
+//
+// watch Befehl: Registerliste (i2c_watch.c), TIM7 plant die Lesungen,
+//   ausgegeben werden nur Aenderungen (+ optional jedes N-te Sample)
+//
+// target Befehl: I2C1 als Slave (i2c_slave.c) mit Registerdatei,
+//   Skripten und Zugriffslog; Master Funktionen bis 'target stop' gesperrt
 //
 // - Odd nibble: falls ein Nibble fehlt, wird automatisch '0' vorne eingefuegt
-// - 's' (nur im I2C Mode): i2cdetect-style Scan
+// - 'c' / scan [4]: i2cdetect-style Scan, IRQ getrieben (i2c_scan.c),
+//   Tabelle erst nach dem letzten Probe am Stueck
 // - 'x' soll global wirken: Write-Capture wird abgebrochen, 'x' wird NICHT konsumiert
 // ============================================================
 
 #define I2C_TX_TIMEOUT_MS     (100u)
 
-/*
- * Runtime-configurable I2C settings for the Tool-Port.
- * NOTE: The I2C speed is set via the TIMING register (hi2c1.Init.Timing).
- * To make 10/100/400kHz work reliably, copy the TIMING values from CubeMX
- * (I2C1 -> Parameter Settings) into these macros (or pass them as compiler defines).
- * If a timing macro is left as 0, the code falls back to the current TIMING value
- * (menu works, but speed does not change).
- */
-#ifndef I2C1_TIMING_10KHZ
-#define I2C1_TIMING_10KHZ  		0x200009FE
-#endif
-#ifndef I2C1_TIMING_100KHZ
-#define I2C1_TIMING_100KHZ  	0x20000215
-#endif
-#ifndef I2C1_TIMING_400KHZ
-#define I2C1_TIMING_400KHZ  	0x0000020B
-#endif
-
+// I2C1 Takt: TIMINGR wird zur Laufzeit aus Kernel Takt, tr/tf und Filtern
+// berechnet (i2c_timing.c), 10 kHz .. 1 MHz, ueber 400 kHz mit FM+ Treiber
 
 // ---------------- Write stream state ----------------
 static uint8_t  ws_active     = 0;
@@ -61,6 +69,8 @@ static uint8_t  ws_tx[256];
 static uint16_t ws_tx_len     = 0;
 
 static uint32_t ws_seg_idx    = 0;
+static uint16_t ws_seg_end[I2CQ_SEG_MAX];   // ws_tx Grenzen an 'z'
+static uint8_t  ws_seg_cnt    = 0;
 
 // ---------------- Read extension ----------------
 // After 'r' inside a write-stream, we switch into read-mode.
@@ -93,11 +103,10 @@ static uint16_t g_ldo1_mv   = 0;   // 0 = unknown
 static uint8_t  g_ldo1_en   = 0;
 static uint32_t g_i2c_khz   = 0;   // 0 = unknown
 
-// Timing presets (loaded lazily)
-static uint8_t  g_timings_inited = 0;
-static uint32_t g_timing_10k  = 0;
-static uint32_t g_timing_100k = 0;
-static uint32_t g_timing_400k = 0;
+// Timing Parameter (clk Befehl), beim ersten Zugriff auf 100 kHz
+static uint8_t    g_timing_inited = 0;
+static i2ct_cfg_t g_timing_cfg;
+static i2ct_res_t g_timing_res;
 
 
 // ---------------- Helpers ----------------
@@ -117,6 +126,7 @@ static void ws_reset(void)
     ws_nib_len = 0;
     ws_tx_len = 0;
     ws_seg_idx = 0;
+    ws_seg_cnt = 0;
 
     memset(ws_nibbles, 0, sizeof(ws_nibbles));
 }
@@ -158,10 +168,8 @@ static void i2c_dump_device(uint8_t addr7)
     cli_printf("     00 01 02 03 04 05 06 07 08 09 0A 0B 0C 0D 0E 0F  |ASCII|\r\n");
 
     for (uint16_t offset = 0; offset < 0x100u; offset += 16u) {
-        if (HAL_I2C_GetState(&hi2c1) != HAL_I2C_STATE_READY) {
-            (void)HAL_I2C_DeInit(&hi2c1);
-            (void)HAL_I2C_Init(&hi2c1);
-        }
+        // nach Timeout/Busfehler der Zeile davor: PE Reset bzw. Freitakten
+        (void)I2CR_Ensure(&hi2c1);
 
         HAL_StatusTypeDef st = HAL_I2C_Mem_Read(
                 &hi2c1,
@@ -174,10 +182,8 @@ static void i2c_dump_device(uint8_t addr7)
         );
 
         i2c_dump_print_line((uint8_t)offset, row, (st == HAL_OK));
-
-        // ErrorCode löschen, damit der nächste Versuch sauber ist
-        hi2c1.ErrorCode = HAL_I2C_ERROR_NONE;
     }
+    (void)I2CR_Ensure(&hi2c1);
 
     cli_printf("\r\n");
 }
@@ -241,20 +247,17 @@ static HAL_StatusTypeDef ws_finalize_segment_and_append(uint16_t *out_new_start,
 // ---------------- Setup helpers ----------------
 static void i2c_init_timings_if_needed(void)
 {
-    if (g_timings_inited) return;
+    if (g_timing_inited) return;
 
-    // If macros are 0, fall back to current timing (no speed change).
-    uint32_t cur = hi2c1.Init.Timing;
-
-    g_timing_10k  = (I2C1_TIMING_10KHZ  != 0u) ? I2C1_TIMING_10KHZ  : cur;
-    g_timing_100k = (I2C1_TIMING_100KHZ != 0u) ? I2C1_TIMING_100KHZ : cur;
-    g_timing_400k = (I2C1_TIMING_400KHZ != 0u) ? I2C1_TIMING_400KHZ : cur;
+    // Defaults wie CubeMX Init (100 kHz, Analogfilter an, DNF 0)
+    I2CT_DefaultCfg(&g_timing_cfg, 100000u);
+    memset(&g_timing_res, 0, sizeof(g_timing_res));
 
     if (g_i2c_khz == 0u) {
         g_i2c_khz = 100u; // best-effort default
     }
 
-    g_timings_inited = 1;
+    g_timing_inited = 1;
 }
 
 // ---------------- Read helpers ----------------
@@ -342,96 +345,750 @@ static void i2c_setup_show_clock(void)
     cli_printf("  1 - 10 kHz\r\n");
     cli_printf("  2 - 100 kHz\r\n");
     cli_printf("  3 - 400 kHz\r\n");
+    cli_printf("  4 - 1000 kHz (Fast-mode Plus)\r\n");
     cli_printf("  q - back\r\n");
     cli_printf("\r\nAuswahl: ");
 }
 
 
 
-static void i2c_reinit_with_timing(uint32_t timing, uint32_t khz)
+static void i2c_print_timing(const i2ct_res_t *r)
 {
-    (void)HAL_I2C_DeInit(&hi2c1);
-    hi2c1.Init.Timing = timing;
-    HAL_StatusTypeDef st = HAL_I2C_Init(&hi2c1);
+    cli_printf("  TIMINGR=0x%08lX (PRESC=%u SCLDEL=%u SDADEL=%u SCLH=%u SCLL=%u)\r\n",
+               (unsigned long)r->timingr, (unsigned)r->presc, (unsigned)r->scldel,
+               (unsigned)r->sdadel, (unsigned)r->sclh, (unsigned)r->scll);
+    cli_printf("  Kernel %lu Hz%s, ist %lu Hz, tLOW=%lu ns tHIGH=%lu ns, AF %s, DNF %u%s\r\n",
+               (unsigned long)r->kernel_hz, r->hsi ? " (HSI)" : "",
+               (unsigned long)r->actual_hz, (unsigned long)r->t_low_ns, (unsigned long)r->t_high_ns,
+               r->analog ? "an" : "aus", (unsigned)g_timing_cfg.dnf, r->fmp ? ", FM+" : "");
+}
 
-    if (st == HAL_OK) {
-        g_i2c_khz = khz;
-        cli_printf("\r\nI2C clk set to %lu kHz\r\n", (unsigned long)khz);
+// neue Parameter uebernehmen; bei Fehler bleibt der alte Takt aktiv
+static void i2c_apply_timing(const i2ct_cfg_t *cfg)
+{
+    i2ct_res_t res;
+    HAL_StatusTypeDef st = I2CT_Apply(&hi2c1, cfg, &res);
 
-        if ((khz == 10u  && I2C1_TIMING_10KHZ  == 0u) ||
-            (khz == 100u && I2C1_TIMING_100KHZ == 0u) ||
-            (khz == 400u && I2C1_TIMING_400KHZ == 0u)) {
-            cli_printf("WARN: TIMING macro for %lu kHz is 0 -> using current timing (no real change).\r\n",
-                       (unsigned long)khz);
+    if (st == HAL_OK) {
+        g_timing_cfg = *cfg;
+        g_timing_res = res;
+        g_i2c_khz = (res.actual_hz + 500u) / 1000u;
+        cli_printf("\r\nI2C clk set to %lu kHz\r\n", (unsigned long)g_i2c_khz);
+        i2c_print_timing(&res);
+        if (cfg->analog && !res.analog) {
+            cli_printf("WARN: Analogfilter aus, sonst tVD;DAT nicht einhaltbar\r\n");
         }
+        return;
+    }
+
+    if (HAL_I2C_GetState(&hi2c1) == HAL_I2C_STATE_READY) {
+        cli_printf("\r\nI2C clk: keine Loesung fuer %lu Hz (tr=%u tf=%u ns, Spec Grenzen)\r\n",
+                   (unsigned long)cfg->freq_hz, (unsigned)cfg->rise_ns, (unsigned)cfg->fall_ns);
     } else {
-        cli_printf("\r\nI2C re-init FEHLER (timing=0x%08lX)\r\n", (unsigned long)timing);
+        cli_printf("\r\nI2C re-init FEHLER\r\n");
     }
 }
 
 static void i2c_setup_set_clock_choice(uint8_t choice)
 {
+    static const uint32_t khz[4] = { 10u, 100u, 400u, 1000u };
+    i2c_init_timings_if_needed();
+    if (choice < 1u || choice > 4u) return;
+    if (I2CQ_IsActive() || EEP_IsActive() || I2CW_IsActive() || I2CSL_IsActive()) {
+        cli_printf("\r\nI2C: belegt, Takt unveraendert\r\n");
+        return;
+    }
+
+    i2ct_cfg_t cfg = g_timing_cfg;
+    cfg.freq_hz = khz[choice - 1u] * 1000u;
+    i2c_apply_timing(&cfg);
+}
+
+static void i2c_clk_usage(void)
+{
+    cli_printf("\r\nclk <kHz> [rise=NS] [fall=NS] [dnf=0..15] [af|noaf]\r\n");
+    cli_printf("  10..1000 kHz, TIMINGR nach I2C Spec aus Kernel Takt, tr/tf und Filtern\r\n");
+    cli_printf("  ohne Argument: aktuelle Werte\r\n");
+}
+
+static void i2c_cmd_clk(void)
+{
+    char *tok = strtok(NULL, " \t");
     i2c_init_timings_if_needed();
-    switch (choice) {
-        case 1: i2c_reinit_with_timing(g_timing_10k,  10u);  break;
-        case 2: i2c_reinit_with_timing(g_timing_100k, 100u); break;
-        case 3: i2c_reinit_with_timing(g_timing_400k, 400u); break;
-        default: break;
+
+    if (!tok) {
+        if (g_timing_res.timingr == 0u) {
+            cli_printf("\r\nI2C clk: CubeMX Init, TIMINGR=0x%08lX\r\n", (unsigned long)hi2c1.Init.Timing);
+        } else {
+            cli_printf("\r\nI2C clk: %lu kHz (tr=%u tf=%u ns)\r\n", (unsigned long)(g_timing_cfg.freq_hz / 1000u),
+                       (unsigned)g_timing_cfg.rise_ns, (unsigned)g_timing_cfg.fall_ns);
+            i2c_print_timing(&g_timing_res);
+        }
+        return;
+    }
+    if (strcmp(tok, "?") == 0) { i2c_clk_usage(); return; }
+
+    i2ct_cfg_t cfg = g_timing_cfg;
+    cfg.freq_hz = strtoul(tok, NULL, 10) * 1000u;
+
+    while ((tok = strtok(NULL, " \t")) != NULL) {
+        if (strncmp(tok, "rise=", 5) == 0) cfg.rise_ns = (uint16_t)strtoul(tok + 5, NULL, 10);
+        else if (strncmp(tok, "fall=", 5) == 0) cfg.fall_ns = (uint16_t)strtoul(tok + 5, NULL, 10);
+        else if (strncmp(tok, "dnf=", 4) == 0) cfg.dnf = (uint8_t)strtoul(tok + 4, NULL, 10);
+        else if (strcmp(tok, "af") == 0) cfg.analog = 1u;
+        else if (strcmp(tok, "noaf") == 0) cfg.analog = 0u;
+        else {
+            cli_printf("\r\nclk: unbekannt '%s'\r\n", tok);
+            i2c_clk_usage();
+            return;
+        }
+    }
+    if (cfg.freq_hz < I2CT_FREQ_MIN_HZ || cfg.freq_hz > I2CT_FREQ_MAX_HZ || cfg.dnf > I2CT_DNF_MAX) {
+        i2c_clk_usage();
+        return;
     }
+    i2c_apply_timing(&cfg);
 }
 
 // ---------------- i2cdetect style scan ----------------
-static void I2C_PrintDetectTable(void)
+static void I2C_PrintDetectTable(uint8_t bus)
+{
+    static i2cscan_t scan;
+    static char text[I2CSCAN_TABLE_SIZE];
+    I2C_HandleTypeDef *hi2c = (bus == 4u) ? &hi2c4 : &hi2c1;
+
+    // Falls I2C in einem komischen Zustand hängt, einmal recovern
+    (void)I2CR_Ensure(hi2c);
+
+    HAL_StatusTypeDef st = I2CSCAN_Run(hi2c, I2CSCAN_FIRST, I2CSCAN_LAST, &scan);
+    if (st == HAL_BUSY && I2CR_Recover(hi2c, I2CR_CAUSE_BUSY) == HAL_OK) {
+        st = I2CSCAN_Run(hi2c, I2CSCAN_FIRST, I2CSCAN_LAST, &scan);
+    }
+    if (st == HAL_BUSY) {
+        cli_printf("\r\nI2C%u scan: Bus belegt (SDA/SCL low?)\r\n", (unsigned)bus);
+        return;
+    }
+    if (st != HAL_OK) {
+        cli_printf("\r\nI2C%u scan: Timeout, Controller zurueckgesetzt\r\n", (unsigned)bus);
+        return;
+    }
+
+    uint16_t n = I2CSCAN_Format(&scan, (bus == 4u) ? "I2C4" : "I2C1", text, (uint16_t)sizeof(text));
+    cli_write(text, n);
+}
+
+// ---------------- Queue ----------------
+static i2cq_xfer_t g_xfer;      // Aufbau, Submit kopiert
+
+static uint8_t i2c_queue_busy(void)
+{
+    if (I2CSL_IsActive()) {
+        cli_printf("\r\nI2C1 ist Target, erst 'target stop'\r\n");
+        return 1;
+    }
+    if (I2CW_IsActive()) {
+        cli_printf("\r\nI2C: watch laeuft (watch stop)\r\n");
+        return 1;
+    }
+    if (!I2CQ_IsActive() && !EEP_IsActive()) return 0;
+    cli_printf("\r\nI2C: Queue aktiv, spaeter nochmal\r\n");
+    return 1;
+}
+
+// Stream -> Transaktion: je 'z' ein Schreibsegment, Rest als letztes
+// Schreibsegment, rd_len > 0 haengt ein Lesesegment an (Repeated Start)
+static HAL_StatusTypeDef ws_submit(uint16_t rd_len, uint16_t *id)
 {
-    // Scan-Parameter (konservativ, analyzer-friendly)
-    const uint32_t trials   = 1;
-    const uint32_t timeout  = 10;  // ms
-    const uint32_t delay_ms = 1;   // pause zwischen probes
+    HAL_StatusTypeDef st = HAL_OK;
+    uint16_t start = 0;
 
-    cli_printf("\r\n     ");
-    for (uint8_t x = 0; x < 16u; x++) {
-        cli_printf("%02x ", x);
+    g_xfer.nseg = 0;
+    for (uint8_t i = 0; i < ws_seg_cnt && st == HAL_OK; i++) {
+        st = I2CQ_AddSeg(&g_xfer, ws_addr7, 0u, &ws_tx[start], (uint16_t)(ws_seg_end[i] - start));
+        start = ws_seg_end[i];
     }
-    cli_printf("\r\n");
+    if (st == HAL_OK && (ws_tx_len > start || (g_xfer.nseg == 0u && rd_len == 0u))) {
+        st = I2CQ_AddSeg(&g_xfer, ws_addr7, 0u, &ws_tx[start], (uint16_t)(ws_tx_len - start));
+    }
+    if (st == HAL_OK && rd_len > 0u) {
+        st = I2CQ_AddSeg(&g_xfer, ws_addr7, 1u, NULL, rd_len);
+    }
+    if (st != HAL_OK) return st;
+    if (!I2CQ_IsActive()) (void)I2CR_Ensure(&hi2c1);
+    return I2CQ_Submit(&g_xfer, id);
+}
 
-    for (uint8_t row = 0; row < 8u; row++) {
-        uint8_t base = (uint8_t)(row << 4);
-        cli_printf("%02x: ", base);
+static void i2c_print_result(const i2cq_xfer_t *x)
+{
+    uint32_t us = x->t_end - x->t_start;
 
-        for (uint8_t col = 0; col < 16u; col++) {
-            uint8_t addr = (uint8_t)(base + col);
+    if (x->status == I2CQ_OK) {
+        cli_printf("\r\nI2C [%u] OK (%lu us)\r\n", (unsigned)x->id, (unsigned long)us);
+    } else {
+        const i2cq_seg_t *e = &x->seg[x->err_seg];
+        cli_printf("\r\nI2C [%u] %s: Segment %u @%02X, nach %u Byte (%lu us)\r\n",
+                   (unsigned)x->id, I2CQ_StatusStr(x->status), (unsigned)x->err_seg,
+                   (unsigned)e->addr, (unsigned)x->err_pos, (unsigned long)us);
+    }
 
-            // wie i2cdetect: nur 0x03..0x77
-            if (addr < 0x03u || addr > 0x77u) {
-                cli_printf("   ");
-                continue;
-            }
+    for (uint8_t i = 0; i < x->nseg; i++) {
+        const i2cq_seg_t *s = &x->seg[i];
+        if (!s->read) continue;
+        if (x->status != I2CQ_OK && i >= x->err_seg) break;
+        cli_printf("  @%02X r%u: ", (unsigned)s->addr, (unsigned)s->len);
+        print_bytes(&x->data[s->off], s->len);
+        cli_printf("\r\n");
+    }
+}
 
-            // Falls I2C in einem komischen Zustand hängt, einmal recovern
-            if (HAL_I2C_GetState(&hi2c1) != HAL_I2C_STATE_READY) {
-                (void)HAL_I2C_DeInit(&hi2c1);
-                (void)HAL_I2C_Init(&hi2c1);
-            }
+// Hex Bytes eines 'w' Tokens, odd nibble mit fuehrender 0
+static int i2c_parse_hex(const char *h, uint8_t *out, uint16_t max)
+{
+    size_t n = strlen(h);
+    uint16_t cnt = 0;
+    size_t i = 0;
+
+    if (n & 1u) {
+        int lo = hex_nibble(h[0]);
+        if (lo < 0 || max == 0u) return -1;
+        out[cnt++] = (uint8_t)lo;
+        i = 1;
+    }
+    for (; i < n; i += 2u) {
+        int a = hex_nibble(h[i]);
+        int b = hex_nibble(h[i + 1u]);
+        if (a < 0 || b < 0 || cnt >= max) return -1;
+        out[cnt++] = (uint8_t)((a << 4) | b);
+    }
+    return (int)cnt;
+}
+
+static void i2c_tx_usage(void)
+{
+    cli_printf("\r\ntx @AA wHEX.. rLEN .. [; @AA ..]\r\n");
+    cli_printf("  Segmente mit Repeated Start, STOP am Ende und bei ';' (neue Transaktion)\r\n");
+    cli_printf("  rLEN Hex oder rb/rw/rh, max. %u Segmente / %u Byte pro Transaktion\r\n",
+               (unsigned)I2CQ_SEG_MAX, (unsigned)I2CQ_DATA_MAX);
+    cli_printf("  Beispiel: tx @50 w0010 r04 @68 w3B r06\r\n");
+}
+
+static void i2c_tx_flush(uint8_t *queued)
+{
+    uint16_t id = 0;
+    if (g_xfer.nseg == 0u) return;
+
+    if (!I2CQ_IsActive()) (void)I2CR_Ensure(&hi2c1);
+    HAL_StatusTypeDef st = I2CQ_Submit(&g_xfer, &id);
+    if (st == HAL_OK) {
+        (*queued)++;
+    } else {
+        cli_printf("\r\ntx: %s\r\n", (st == HAL_BUSY) ? "Queue voll/Bus belegt" : "FEHLER");
+    }
+    g_xfer.nseg = 0;
+}
+
+static void i2c_cmd_tx(void)
+{
+    static uint8_t buf[I2CQ_DATA_MAX];
+    int addr = -1;
+    uint8_t queued = 0;
+    char *tok;
+
+    g_xfer.nseg = 0;
+    while ((tok = strtok(NULL, " \t")) != NULL) {
+        HAL_StatusTypeDef st = HAL_OK;
+
+        if (tok[0] == '@') {
+            char *end = NULL;
+            unsigned long a = strtoul(tok + 1, &end, 16);
+            if (end == tok + 1 || *end != '\0' || a > 0x7Fu) { i2c_tx_usage(); return; }
+            addr = (int)a;
+            continue;
+        }
+        if (strcmp(tok, ";") == 0) {
+            i2c_tx_flush(&queued);
+            continue;
+        }
+        if (addr < 0) { i2c_tx_usage(); return; }
+
+        if (tok[0] == 'w' || tok[0] == 'W') {
+            int n = i2c_parse_hex(tok + 1, buf, (uint16_t)sizeof(buf));
+            if (n < 0) { i2c_tx_usage(); return; }
+            st = I2CQ_AddSeg(&g_xfer, (uint8_t)addr, 0u, buf, (uint16_t)n);
+        } else if (tok[0] == 'r' || tok[0] == 'R') {
+            unsigned long len;
+            if (strcmp(tok + 1, "b") == 0) len = 1u;
+            else if (strcmp(tok + 1, "w") == 0) len = 2u;
+            else if (strcmp(tok + 1, "h") == 0) len = 4u;
+            else len = strtoul(tok + 1, NULL, 16);
+            if (len == 0u || len > I2CQ_DATA_MAX) { i2c_tx_usage(); return; }
+            st = I2CQ_AddSeg(&g_xfer, (uint8_t)addr, 1u, NULL, (uint16_t)len);
+        } else {
+            cli_printf("\r\ntx: unbekannt '%s'\r\n", tok);
+            i2c_tx_usage();
+            return;
+        }
+
+        if (st != HAL_OK) {
+            cli_printf("\r\ntx: zu viele Segmente/Bytes (max. %u / %u)\r\n",
+                       (unsigned)I2CQ_SEG_MAX, (unsigned)I2CQ_DATA_MAX);
+            return;
+        }
+    }
+    i2c_tx_flush(&queued);
+
+    if (queued == 0u) i2c_tx_usage();
+    else cli_printf("\r\ntx: %u Transaktion(en) queued\r\n", (unsigned)queued);
+}
+
+// ---------------- ee (24Cxx EEPROM) ----------------
+static void i2c_ee_usage(void)
+{
+    cli_printf("\r\nee                          - Konfiguration anzeigen\r\n");
+    cli_printf("ee cfg <24cXX> [addr=AA]    - Typ (24c01..24c512), Adresse 7 Bit (Default 50)\r\n");
+    cli_printf("ee cfg <SIZE> <PAGE> a8|a16 [addr=AA] - freie Geometrie\r\n");
+    cli_printf("ee read <ADDR> <LEN>        - binaer zum Host\r\n");
+    cli_printf("ee crc <ADDR> <LEN>         - CRC32 auf dem Geraet\r\n");
+    cli_printf("ee write <ADDR> <LEN> [noverify] - LEN Bytes roh vom Host, danach CRC Verify\r\n");
+    cli_printf("ee stop\r\n");
+    cli_printf("  ADDR/LEN mit 0x bzw. k, Zeile bei write nur mit CR abschliessen\r\n");
+}
+
+static uint8_t i2c_parse_num(const char *s, uint32_t *out)
+{
+    char *end = NULL;
+    if (!s || !*s) return 0u;
+    uint32_t v = strtoul(s, &end, 0);
+    if (end == s) return 0u;
+    if (*end == 'k' || *end == 'K') { v *= 1024u; end++; }
+    if (*end != '\0') return 0u;
+    *out = v;
+    return 1u;
+}
+
+static void i2c_ee_cfg(void)
+{
+    eep_cfg_t cfg = *EEP_GetCfg();
+    char *tok = strtok(NULL, " \t");
+    uint32_t size = 0u, page = 0u;
+
+    if (!tok) { i2c_ee_usage(); return; }
+    if (EEP_Preset(tok, &cfg) != HAL_OK) {
+        char *pg = strtok(NULL, " \t");
+        char *aw = strtok(NULL, " \t");
+        if (!i2c_parse_num(tok, &size) || !i2c_parse_num(pg, &page) || !aw ||
+            (strcmp(aw, "a8") != 0 && strcmp(aw, "a16") != 0)) {
+            i2c_ee_usage();
+            return;
+        }
+        cfg.size = size;
+        cfg.page = (uint16_t)((page > 0xFFFFu) ? 0u : page);
+        cfg.a16 = (strcmp(aw, "a16") == 0) ? 1u : 0u;
+    }
+
+    while ((tok = strtok(NULL, " \t")) != NULL) {
+        char *end = NULL;
+        unsigned long a;
+        if (strncmp(tok, "addr=", 5) != 0) { i2c_ee_usage(); return; }
+        a = strtoul(tok + 5, &end, 16);
+        if (end == tok + 5 || *end != '\0' || a > 0x7Fu) { i2c_ee_usage(); return; }
+        cfg.addr7 = (uint8_t)a;
+    }
 
-            HAL_StatusTypeDef st = HAL_I2C_IsDeviceReady(
-                    &hi2c1,
-                    (uint16_t)(addr << 1),
-                    trials,
-                    timeout);
+    HAL_StatusTypeDef st = EEP_SetCfg(&cfg);
+    if (st == HAL_OK) EEP_PrintCfg();
+    else if (st == HAL_BUSY) cli_printf("\r\nee: belegt\r\n");
+    else cli_printf("\r\nee: Geometrie ungueltig (Page 2^n <= %u, 8 Bit max. 2K, Blockbits frei)\r\n",
+                    (unsigned)EEP_PAGE_MAX);
+}
 
-            // ErrorCode löschen, damit der nächste Probe sauber läuft
-            hi2c1.ErrorCode = HAL_I2C_ERROR_NONE;
+static void i2c_cmd_ee(void)
+{
+    char *sub = strtok(NULL, " \t");
+    uint32_t addr = 0u, len = 0u;
 
-            if (st == HAL_OK) cli_printf("%02x ", addr);
-            else              cli_printf("-- ");
+    if (!sub) { EEP_PrintCfg(); return; }
+    if (strcmp(sub, "?") == 0) { i2c_ee_usage(); return; }
+    if (strcmp(sub, "stop") == 0) { EEP_Stop(); return; }
+    if (strcmp(sub, "cfg") == 0) { i2c_ee_cfg(); return; }
 
-            if (delay_ms) HAL_Delay(delay_ms);
+    if (!i2c_parse_num(strtok(NULL, " \t"), &addr) ||
+        !i2c_parse_num(strtok(NULL, " \t"), &len) || len == 0u) {
+        i2c_ee_usage();
+        return;
+    }
+    if (I2CSL_IsActive() || I2CW_IsActive() || (I2CQ_IsActive() && !EEP_IsActive())) {
+        (void)i2c_queue_busy();
+        return;
+    }
+
+    if (strcmp(sub, "read") == 0) {
+        (void)EEP_Read(addr, len);
+    } else if (strcmp(sub, "crc") == 0) {
+        (void)EEP_Crc(addr, len);
+    } else if (strcmp(sub, "write") == 0) {
+        char *o = strtok(NULL, " \t");
+        uint8_t verify = (o && strcmp(o, "noverify") == 0) ? 0u : 1u;
+        if (EEP_Write(addr, len, verify) == HAL_OK) {
+            cli_printf("\r\nee write: 0x%05lX %lu Bytes, warte auf Daten\r\n",
+                       (unsigned long)addr, (unsigned long)len);
         }
+    } else {
+        i2c_ee_usage();
+    }
+}
+
+// ---------------- watch (Registerbeobachtung) ----------------
+static void i2c_watch_usage(void)
+{
+    cli_printf("\r\nwatch                       - Liste anzeigen\r\n");
+    cli_printf("watch add @AA rRR|rRRRR|r- LEN <PERIODE> - Eintrag (max. %u), LEN 1..%u\r\n",
+               (unsigned)I2CW_ENTRIES, (unsigned)I2CW_LEN_MAX);
+    cli_printf("  PERIODE in us, mit ms-Suffix in ms, 0 = Dauerlauf (Raster %u us)\r\n",
+               (unsigned)I2CW_TICK_US);
+    cli_printf("  rRR = 8 Bit Register, rRRRR = 16 Bit, r- = ohne Register\r\n");
+    cli_printf("watch del <N> | clear\r\n");
+    cli_printf("watch start | stop | stat\r\n");
+    cli_printf("watch dec <N>               - zusaetzlich jede N-te Lesung als Sample, 0 = aus\r\n");
+    cli_printf("watch fmt hex|bin\r\n");
+    cli_printf("  Zeile: W<N> t_us @AA rRR C/S/E/L Daten (C = Aenderung, S = Sample, E = Fehler, L = verloren)\r\n");
+}
+
+static uint8_t i2c_parse_period(const char *s, uint32_t *out)
+{
+    char *end = NULL;
+    if (!s || !*s) return 0u;
+    uint32_t v = strtoul(s, &end, 0);
+    if (end == s) return 0u;
+    if (strcmp(end, "ms") == 0) { v *= 1000u; end += 2; }
+    else if (strcmp(end, "us") == 0) end += 2;
+    if (*end != '\0') return 0u;
+    *out = v;
+    return 1u;
+}
+
+static void i2c_watch_add(void)
+{
+    char *a = strtok(NULL, " \t");
+    char *r = strtok(NULL, " \t");
+    char *l = strtok(NULL, " \t");
+    char *p = strtok(NULL, " \t");
+    unsigned long addr, reg = 0u, len;
+    uint8_t reg_len = 0u;
+    uint32_t period = 0u;
+    char *end = NULL;
+
+    if (!a || !r || !l || a[0] != '@' || (r[0] != 'r' && r[0] != 'R') ||
+        !i2c_parse_period(p, &period)) {
+        i2c_watch_usage();
+        return;
+    }
+    addr = strtoul(a + 1, &end, 16);
+    if (end == a + 1 || *end != '\0' || addr > 0x7Fu) { i2c_watch_usage(); return; }
+
+    if (strcmp(r + 1, "-") != 0) {
+        size_t digits = strlen(r + 1);
+        reg = strtoul(r + 1, &end, 16);
+        if (end == r + 1 || *end != '\0' || digits > 4u) { i2c_watch_usage(); return; }
+        reg_len = (digits > 2u) ? 2u : 1u;
+    }
+    len = strtoul(l, &end, 0);
+    if (end == l || *end != '\0' || len == 0u || len > I2CW_LEN_MAX) { i2c_watch_usage(); return; }
+
+    int idx = I2CW_Add((uint8_t)addr, (uint16_t)reg, reg_len, (uint8_t)len, period);
+    if (idx < 0) cli_printf("\r\nwatch: Liste voll oder watch laeuft\r\n");
+    else cli_printf("\r\nwatch: #%02d\r\n", idx);
+}
+
+static void i2c_cmd_watch(void)
+{
+    char *sub = strtok(NULL, " \t");
+
+    if (!sub) { I2CW_PrintList(); return; }
+    if (strcmp(sub, "?") == 0) { i2c_watch_usage(); return; }
+    if (strcmp(sub, "add") == 0) { i2c_watch_add(); return; }
+    if (strcmp(sub, "stat") == 0) { I2CW_PrintStats(); return; }
+    if (strcmp(sub, "clear") == 0) { I2CW_Clear(); return; }
 
+    if (strcmp(sub, "stop") == 0) {
+        I2CW_Stop();
+        I2CW_PrintStats();
+        return;
+    }
+    if (strcmp(sub, "start") == 0) {
+        if (I2CSL_IsActive() || I2CQ_IsActive() || EEP_IsActive()) { (void)i2c_queue_busy(); return; }
+        HAL_StatusTypeDef st = I2CW_Start();
+        if (st == HAL_OK) cli_printf("\r\nwatch: laeuft\r\n");
+        else cli_printf("\r\nwatch: %s\r\n", (st == HAL_BUSY) ? "I2C1 belegt" : "Liste leer");
+        return;
+    }
+    if (strcmp(sub, "del") == 0) {
+        char *n = strtok(NULL, " \t");
+        char *end = NULL;
+        unsigned long idx = n ? strtoul(n, &end, 0) : 0u;
+        if (!n || end == n || *end != '\0') { i2c_watch_usage(); return; }
+        HAL_StatusTypeDef st = I2CW_Del((uint8_t)((idx > 0xFFu) ? 0xFFu : idx));
+        if (st == HAL_BUSY) cli_printf("\r\nwatch: erst stoppen\r\n");
+        else if (st != HAL_OK) cli_printf("\r\nwatch: #%lu nicht belegt\r\n", idx);
+        return;
+    }
+    if (strcmp(sub, "dec") == 0) {
+        char *n = strtok(NULL, " \t");
+        char *end = NULL;
+        unsigned long dec = n ? strtoul(n, &end, 0) : 0u;
+        if (!n || end == n || *end != '\0') { i2c_watch_usage(); return; }
+        I2CW_SetDecim((uint32_t)dec);
+        return;
+    }
+    if (strcmp(sub, "fmt") == 0) {
+        char *f = strtok(NULL, " \t");
+        if (f && strcmp(f, "hex") == 0) I2CW_SetFormat(I2CW_FMT_HEX);
+        else if (f && strcmp(f, "bin") == 0) I2CW_SetFormat(I2CW_FMT_BIN);
+        else i2c_watch_usage();
+        return;
+    }
+    i2c_watch_usage();
+}
+
+// ---------------- target (I2C1 Slave) ----------------
+static void i2c_target_usage(void)
+{
+    cli_printf("\r\ntarget start @AA [a16] [@BB [a16]] [clk=kHz] - I2C1 als Slave (OAR1/OAR2), Default 1000 kHz Timing\r\n");
+    cli_printf("target stop | stat\r\n");
+    cli_printf("target log [clear]          - Zugriffe (Ring %u), aeltester zuerst\r\n", (unsigned)I2CSL_LOG_SIZE);
+    cli_printf("target fill <XX>            - ganze Datei fuellen\r\n");
+    cli_printf("target set <OFF> <HEX>      - Datei beschreiben\r\n");
+    cli_printf("target get <OFF> [LEN]      - Datei anzeigen (Default 64)\r\n");
+    cli_printf("target ro <OFF> <LEN> on|off - Schreibschutz fuer den Host\r\n");
+    cli_printf("target script <N> <T> <REG> <HEX>|off [once] - Lesewerte fuer REG nacheinander\r\n");
+    cli_printf("target load <OFF> <LEN>     - LEN Bytes roh vom Host in die Datei\r\n");
+    cli_printf("  8 Bit Zeiger: Target 0 ab 0x0000, Target 1 ab 0x0100 (je 256 Bytes)\r\n");
+    cli_printf("  16 Bit Zeiger: ganze Datei (%lu Bytes), OFF = Position in der Datei\r\n",
+               (unsigned long)I2CSL_FILE_SIZE);
+}
+
+static uint8_t i2c_target_addr(const char *tok, uint8_t *out)
+{
+    char *end = NULL;
+    unsigned long a;
+
+    if (!tok || tok[0] != '@') return 0u;
+    a = strtoul(tok + 1, &end, 16);
+    if (end == tok + 1 || *end != '\0' || a > 0x7Fu) return 0u;
+    *out = (uint8_t)a;
+    return 1u;
+}
+
+static void i2c_target_start(void)
+{
+    i2csl_cfg_t cfg;
+    uint32_t khz = 1000u;
+    uint8_t n = 0u;
+    char *tok;
+
+    cfg.addr[0] = I2CSL_ADDR_OFF;
+    cfg.addr[1] = I2CSL_ADDR_OFF;
+    cfg.a16[0] = 0u;
+    cfg.a16[1] = 0u;
+    while ((tok = strtok(NULL, " \t")) != NULL) {
+        if (tok[0] == '@' && n < I2CSL_TARGETS) {
+            if (!i2c_target_addr(tok, &cfg.addr[n])) { i2c_target_usage(); return; }
+            n++;
+            continue;
+        }
+        if (strcmp(tok, "a16") == 0 && n > 0u) { cfg.a16[n - 1u] = 1u; continue; }
+        if (strncmp(tok, "clk=", 4) == 0 && i2c_parse_num(tok + 4, &khz) && khz > 0u) continue;
+        i2c_target_usage();
+        return;
+    }
+    if (n == 0u) { i2c_target_usage(); return; }
+    if (i2c_queue_busy()) return;
+
+    // SDADEL/SCLDEL + FM+ Treiber wie fuer einen Master mit diesem Takt
+    i2ct_cfg_t tc = g_timing_cfg;
+    i2ct_res_t res;
+    tc.freq_hz = khz * 1000u;
+    if (I2CT_Apply(&hi2c1, &tc, &res) != HAL_OK) {
+        cli_printf("\r\ntarget: keine Timing Loesung fuer %lu kHz\r\n", (unsigned long)khz);
+        i2c_apply_timing(&g_timing_cfg);
+        return;
+    }
+
+    HAL_StatusTypeDef st = I2CSL_Start(&cfg);
+    if (st != HAL_OK) {
+        cli_printf("\r\ntarget: FEHLER (%s)\r\n", (st == HAL_BUSY) ? "I2C1 belegt" : "Adressen");
+        i2c_apply_timing(&g_timing_cfg);
+        return;
+    }
+    cli_printf("\r\ntarget: I2C1 Slave bis %lu kHz%s\r\n", (unsigned long)khz, res.fmp ? " (FM+)" : "");
+    I2CSL_PrintStatus();
+}
+
+static void i2c_target_log(void)
+{
+    i2csl_log_t r;
+    uint32_t n = 0u;
+
+    while (I2CSL_LogRead(&r)) {
+        cli_printf("  %10lu T%u %c 0x%04X %3u %c%c%c%c:", (unsigned long)r.t_us, (unsigned)r.target,
+                   (r.flags & I2CSL_L_READ) ? 'R' : 'W', (unsigned)r.ptr, (unsigned)r.len,
+                   (r.flags & I2CSL_L_SCRIPT) ? 'S' : '-', (r.flags & I2CSL_L_RO) ? 'P' : '-',
+                   (r.flags & I2CSL_L_ERR) ? 'E' : '-', (r.flags & I2CSL_L_TRUNC) ? '+' : '-');
+        uint16_t k = (r.len > I2CSL_LOG_DATA) ? I2CSL_LOG_DATA : r.len;
+        for (uint16_t i = 0u; i < k; i++) cli_printf(" %02X", r.data[i]);
         cli_printf("\r\n");
+        n++;
     }
+    if (n == 0u) cli_printf("\r\ntarget log: leer\r\n");
+    else cli_printf("  (t_us, Target, R/W, Zeiger, Bytes, S=Skript P=geschuetzt E=Fehler +=gekuerzt)\r\n");
+}
+
+static void i2c_target_get(uint32_t off, uint32_t len)
+{
+    uint8_t row[16];
+
+    if (len > 1024u) len = 1024u;
+    if (off >= I2CSL_FILE_SIZE) return;
+    if (len > I2CSL_FILE_SIZE - off) len = I2CSL_FILE_SIZE - off;
 
     cli_printf("\r\n");
+    for (uint32_t a = off; a < off + len; a += 16u) {
+        uint32_t k = (off + len - a > 16u) ? 16u : (off + len - a);
+        (void)I2CSL_Get(a, row, k);
+        cli_printf("%04lX:", (unsigned long)a);
+        for (uint32_t i = 0u; i < k; i++) {
+            cli_printf(" %02X%c", row[i], I2CSL_IsReadOnly(a + i) ? '*' : ' ');
+        }
+        cli_printf("\r\n");
+    }
+}
+
+static void i2c_target_script(void)
+{
+    static uint8_t buf[I2CSL_SCRIPT_MAX];
+    uint32_t slot, t, reg;
+    char *s_slot = strtok(NULL, " \t");
+    char *s_t = strtok(NULL, " \t");
+    char *s_reg = strtok(NULL, " \t");
+    char *hex = strtok(NULL, " \t");
+    char *opt = strtok(NULL, " \t");
+
+    if (!s_slot) { I2CSL_PrintScripts(); return; }
+    if (!i2c_parse_num(s_slot, &slot) || slot >= I2CSL_SCRIPTS) { i2c_target_usage(); return; }
+    if (s_t && strcmp(s_t, "off") == 0) {
+        (void)I2CSL_SetScript((uint8_t)slot, 0u, 0u, NULL, 0u, 0u);
+        return;
+    }
+    if (!i2c_parse_num(s_t, &t) || !i2c_parse_num(s_reg, &reg) || !hex || reg > 0xFFFFu) {
+        i2c_target_usage();
+        return;
+    }
+
+    int n = i2c_parse_hex(hex, buf, (uint16_t)sizeof(buf));
+    uint8_t once = (opt && strcmp(opt, "once") == 0) ? 1u : 0u;
+    if (n <= 0 || I2CSL_SetScript((uint8_t)slot, (uint8_t)t, (uint16_t)reg, buf, (uint8_t)n, once) != HAL_OK) {
+        i2c_target_usage();
+        return;
+    }
+    I2CSL_PrintScripts();
+}
+
+static void i2c_cmd_target(void)
+{
+    static uint8_t buf[I2CQ_DATA_MAX];
+    char *sub = strtok(NULL, " \t");
+    uint32_t off = 0u, len = 0u;
+
+    if (!sub) { I2CSL_PrintStatus(); return; }
+    if (strcmp(sub, "?") == 0) { i2c_target_usage(); return; }
+    if (strcmp(sub, "start") == 0) { i2c_target_start(); return; }
+    if (strcmp(sub, "stat") == 0) { I2CSL_PrintStatus(); return; }
+    if (strcmp(sub, "script") == 0) { i2c_target_script(); return; }
+
+    if (strcmp(sub, "stop") == 0) {
+        if (!I2CSL_IsActive()) {
+            cli_printf("\r\ntarget: nicht aktiv\r\n");
+            return;
+        }
+        I2CSL_Stop();
+        I2CSL_PrintStatus();
+        i2c_apply_timing(&g_timing_cfg);        // zurueck als Master
+        return;
+    }
+    if (strcmp(sub, "log") == 0) {
+        char *o = strtok(NULL, " \t");
+        if (o && strcmp(o, "clear") == 0) I2CSL_LogClear();
+        else i2c_target_log();
+        return;
+    }
+    if (strcmp(sub, "fill") == 0) {
+        char *v = strtok(NULL, " \t");
+        if (!v || i2c_parse_hex(v, buf, 1u) != 1) { i2c_target_usage(); return; }
+        I2CSL_Fill(buf[0]);
+        return;
+    }
+
+    if (!i2c_parse_num(strtok(NULL, " \t"), &off)) { i2c_target_usage(); return; }
+
+    if (strcmp(sub, "get") == 0) {
+        char *l = strtok(NULL, " \t");
+        if (!l) len = 64u;
+        else if (!i2c_parse_num(l, &len) || len == 0u) { i2c_target_usage(); return; }
+        i2c_target_get(off, len);
+    } else if (strcmp(sub, "set") == 0) {
+        char *hex = strtok(NULL, " \t");
+        int n = hex ? i2c_parse_hex(hex, buf, (uint16_t)sizeof(buf)) : -1;
+        if (n <= 0 || I2CSL_Set(off, buf, (uint32_t)n) != HAL_OK) { i2c_target_usage(); return; }
+        i2c_target_get(off, (uint32_t)n);
+    } else if (strcmp(sub, "ro") == 0) {
+        char *o = NULL;
+        if (!i2c_parse_num(strtok(NULL, " \t"), &len) || (o = strtok(NULL, " \t")) == NULL ||
+            (strcmp(o, "on") != 0 && strcmp(o, "off") != 0) ||
+            I2CSL_SetReadOnly(off, len, (strcmp(o, "on") == 0) ? 1u : 0u) != HAL_OK) {
+            i2c_target_usage();
+        }
+    } else if (strcmp(sub, "load") == 0) {
+        if (!i2c_parse_num(strtok(NULL, " \t"), &len) || I2CSL_Load(off, len) != HAL_OK) {
+            i2c_target_usage();
+            return;
+        }
+        cli_printf("\r\ntarget load: 0x%04lX %lu Bytes, warte auf Daten\r\n",
+                   (unsigned long)off, (unsigned long)len);
+    } else {
+        i2c_target_usage();
+    }
+}
+
+// ---------------- recover ----------------
+static void i2c_recover_usage(void)
+{
+    cli_printf("\r\nrecover [4]            - Bus freitakten (SDA low) + STOP, PE Reset; 4 = I2C4\r\n");
+    cli_printf("recover stat [reset]   - Zaehler pro Ursache\r\n");
+}
+
+static void i2c_cmd_recover(void)
+{
+    char *sub = strtok(NULL, " \t");
+
+    if (sub && strcmp(sub, "stat") == 0) {
+        char *o = strtok(NULL, " \t");
+        if (o && strcmp(o, "reset") == 0) I2CR_ResetStats();
+        I2CR_PrintStats();
+        return;
+    }
+    if (sub && strcmp(sub, "?") == 0) {
+        i2c_recover_usage();
+        return;
+    }
+
+    uint8_t bus = (sub && strcmp(sub, "4") == 0) ? 4u : 1u;
+    I2C_HandleTypeDef *hi2c = (bus == 4u) ? &hi2c4 : &hi2c1;
+    if (bus == 1u && i2c_queue_busy()) return;
+
+    HAL_StatusTypeDef st = I2CR_Recover(hi2c, I2CR_CAUSE_USER);
+    cli_printf("\r\nI2C%u recover: %s (%lu us)\r\n", (unsigned)bus,
+               (st == HAL_OK) ? "Bus frei" : "FEHLER, SDA/SCL bleibt low",
+               (unsigned long)I2CR_GetStats(hi2c->Instance)->last_us);
 }
 
 // ---------------- Help ----------------
@@ -443,10 +1100,18 @@ static void i2c_print_help(void)
     }
     cli_printf("I2C Mode Befehle:\r\n");
     cli_printf("  v <mv>      - LDO1 Spannung setzen (500..3300mV) und enable\r\n");
-    cli_printf("  s           - I2C scan (i2cdetect-style)\r\n");
+    cli_printf("  s           - Setup (Spannung, Takt)\r\n");
+    cli_printf("  c | scan [4]- I2C scan (i2cdetect-style), 4 = I2C4 (PMIC Bus)\r\n");
+    cli_printf("  clk [kHz ..]- I2C1 Takt 10..1000 kHz, TIMINGR berechnet (clk ?)\r\n");
+    cli_printf("  recover [4] - Bus Recovery (9 SCL Takte + STOP, PE Reset), recover stat\r\n");
     cli_printf("  dump <addr> - Dump 0x00..0xFF (Byteformat + ASCII)\r\n");
     cli_printf("  w..z..p     - Write Stream: w(ADDR7)(DATA..)(zDATA..)*p\r\n");
-    cli_printf("  w..r..p     - Read Stream : w(ADDR7)(REG..)(rLEN|rb|rw|rh)p\r\n");
+    cli_printf("  w..r..p     - Read Stream : w(ADDR7)(REG..)(zREG..)*(rLEN|rb|rw|rh)p\r\n");
+    cli_printf("               z = Repeated Start, alles laeuft ueber die Queue\r\n");
+    cli_printf("  tx ...      - Segmentkette an mehrere Adressen, ohne Warten (tx ?)\r\n");
+    cli_printf("  ee ...      - 24Cxx EEPROM read/crc/write, Page Writes + ACK Polling (ee ?)\r\n");
+    cli_printf("  watch ...   - Register zyklisch lesen, nur Aenderungen ausgeben (watch ?)\r\n");
+    cli_printf("  target ...  - I2C1 als Slave: Registerdatei, Skripte, Zugriffslog (target ?)\r\n");
     cli_printf("               Beispiel: w3c57r01p (read 1 byte ab reg 0x57)\r\n");
     cli_printf("               ADDR7 muss 0x00..0x7F sein (z.B. w50AABBp)\r\n");
     cli_printf("  ?  	      - diese Hilfe\r\n");
@@ -463,6 +1128,43 @@ void I2C_Mode_Enter(void)
     i2c_print_help();
 }
 
+uint16_t I2C_Mode_HandleRaw(const uint8_t *data, uint16_t len)
+{
+    if (I2CSL_IsRawActive()) return I2CSL_Feed(data, len);
+    return EEP_Feed(data, len);
+}
+
+uint8_t I2C_Mode_IsRawActive(void)
+{
+    return (EEP_IsRawActive() || I2CSL_IsRawActive()) ? 1u : 0u;
+}
+
+// beim Verlassen des Modes: ohne I2C_Mode_Poll laeuft die Watch in
+// ev_lost, das Target haelt den DUT Bus, ee haengt an der Queue
+void I2C_Mode_Exit(void)
+{
+    if (I2CW_IsActive()) I2CW_Stop();
+    EEP_Stop();
+    if (I2CSL_IsActive()) {
+        I2CSL_Stop();
+        i2c_apply_timing(&g_timing_cfg);        // zurueck als Master
+    }
+}
+
+void I2C_Mode_Poll(void)
+{
+    const i2cq_xfer_t *x;
+
+    I2CSL_Poll();
+    I2CW_Poll();
+    I2CQ_Poll();
+    EEP_Poll();
+    while ((x = I2CQ_Peek()) != NULL && x->tag == I2CQ_TAG_CLI) {
+        i2c_print_result(x);
+        I2CQ_Pop();
+    }
+}
+
 uint8_t I2C_Mode_HandleLine(char *line)
 {
     // trim leading spaces
@@ -481,8 +1183,34 @@ uint8_t I2C_Mode_HandleLine(char *line)
 
     // Scan als Line-Command: 'scan'
     if (strcmp(cmd, "scan") == 0) {
-        cli_printf("\r\nI2C scan (0x03..0x77):\r\n");
-        I2C_PrintDetectTable();
+        char *bus_s = strtok(NULL, " \t");
+        if (i2c_queue_busy()) return 1;
+        I2C_PrintDetectTable((bus_s && strcmp(bus_s, "4") == 0) ? 4u : 1u);
+        return 1;
+    }
+    if (strcmp(cmd, "tx") == 0) {
+        i2c_cmd_tx();
+        return 1;
+    }
+    if (strcmp(cmd, "recover") == 0) {
+        i2c_cmd_recover();
+        return 1;
+    }
+    if (strcmp(cmd, "target") == 0) {
+        i2c_cmd_target();
+        return 1;
+    }
+    if (strcmp(cmd, "watch") == 0) {
+        i2c_cmd_watch();
+        return 1;
+    }
+    if (strcmp(cmd, "ee") == 0) {
+        i2c_cmd_ee();
+        return 1;
+    }
+    if (strcmp(cmd, "clk") == 0) {
+        if (i2c_queue_busy()) return 1;
+        i2c_cmd_clk();
         return 1;
     }
     if (strcmp(cmd, "dump") == 0) {
@@ -497,6 +1225,7 @@ uint8_t I2C_Mode_HandleLine(char *line)
             cli_printf("dump: FEHLER (addr 0x00..0x7F)\r\n");
             return 1;
         }
+        if (i2c_queue_busy()) return 1;
         i2c_dump_device((uint8_t)addr);
         return 1;
     }
@@ -559,6 +1288,7 @@ uint8_t I2C_Mode_HandleChar(char ch)
                 if (ch == '1') { i2c_setup_set_clock_choice(1); i2c_setup_show_clock(); return 1; }
                 if (ch == '2') { i2c_setup_set_clock_choice(2); i2c_setup_show_clock(); return 1; }
                 if (ch == '3') { i2c_setup_set_clock_choice(3); i2c_setup_show_clock(); return 1; }
+                if (ch == '4') { i2c_setup_set_clock_choice(4); i2c_setup_show_clock(); return 1; }
                 if (ch == 'q' || ch == 'Q') { i2c_setup_show_main(); return 1; }
                 return 1;
             }
@@ -569,8 +1299,7 @@ uint8_t I2C_Mode_HandleChar(char ch)
 
         // Scan per Taste 'c'
         if (ch == 'c' || ch == 'C') {
-            cli_printf("\r\nI2C scan (0x03..0x77):\r\n");
-            I2C_PrintDetectTable();
+            if (!i2c_queue_busy()) I2C_PrintDetectTable(1u);
             return 1;
         }
 
@@ -580,6 +1309,7 @@ uint8_t I2C_Mode_HandleChar(char ch)
         	 ws_nib_len = 0;
         	 ws_tx_len  = 0;
         	 ws_seg_idx = 0;
+        	 ws_seg_cnt = 0;
         	 ws_have_addr = 0;
         	 ws_addr7 = 0;
 
@@ -706,6 +1436,16 @@ uint8_t I2C_Mode_HandleChar(char ch)
             return 1;
         }
 
+        if (ws_have_addr && new_len > 0u) {
+            // letzter Platz bleibt fuer Rest und Lesesegment
+            if (ws_seg_cnt >= (uint8_t)(I2CQ_SEG_MAX - 2u)) {
+                cli_printf("\r\nwrite: FEHLER (max. %u Segmente)\r\n", (unsigned)(I2CQ_SEG_MAX - 1u));
+                ws_reset();
+                return 1;
+            }
+            ws_seg_end[ws_seg_cnt++] = ws_tx_len;
+        }
+
         if (!ws_have_addr) {
             cli_printf("\r\nwrite(seg%lu, no-stop): (addr missing)\r\nwrite: ",
                        (unsigned long)ws_seg_idx);
@@ -725,9 +1465,10 @@ uint8_t I2C_Mode_HandleChar(char ch)
     // p = final (stop + send)  oder final read
     // ------------------------------------------------------------
     if (ch == 'p' || ch == 'P') {
+        uint16_t len = 0;
+
         if (rs_active) {
             // READ finalisieren
-            uint16_t len = 0;
             if (rs_parse_len(&len) != HAL_OK) {
                 cli_printf("\r\nread: FEHLER (len missing/hex)\r\n");
                 ws_reset();
@@ -743,114 +1484,35 @@ uint8_t I2C_Mode_HandleChar(char ch)
                        ws_addr7, (uint8_t)(ws_addr7 << 1));
             print_bytes(ws_tx, ws_tx_len);
             cli_printf("  len=%u\r\n", (unsigned)len);
-
-            HAL_StatusTypeDef st = HAL_ERROR;
-
-            if (ws_tx_len == 0) {
-                // Direktes Lesen ohne Register-Pointer
-                st = HAL_I2C_Master_Receive(
-                        &hi2c1,
-                        (uint16_t)(ws_addr7 << 1),
-                        ws_rx,
-                        (uint16_t)len,
-                        I2C_TX_TIMEOUT_MS
-                );
-            } else if (ws_tx_len == 1) {
-                uint16_t mem = ws_tx[0];
-                st = HAL_I2C_Mem_Read(
-                        &hi2c1,
-                        (uint16_t)(ws_addr7 << 1),
-                        mem,
-                        I2C_MEMADD_SIZE_8BIT,
-                        ws_rx,
-                        (uint16_t)len,
-                        I2C_TX_TIMEOUT_MS
-                );
-            } else if (ws_tx_len == 2) {
-                uint16_t mem = (uint16_t)((ws_tx[0] << 8) | ws_tx[1]);
-                st = HAL_I2C_Mem_Read(
-                        &hi2c1,
-                        (uint16_t)(ws_addr7 << 1),
-                        mem,
-                        I2C_MEMADD_SIZE_16BIT,
-                        ws_rx,
-                        (uint16_t)len,
-                        I2C_TX_TIMEOUT_MS
-                );
-            } else {
-                cli_printf("read: FEHLER (prewrite len=%u nicht unterstuetzt, nur 0/1/2)\r\n",
-                           (unsigned)ws_tx_len);
+        } else {
+            // WRITE finalisieren
+            HAL_StatusTypeDef fst = ws_finalize_segment_and_append(NULL, NULL);
+            if (fst != HAL_OK) {
+                cli_printf("\r\nwrite: FEHLER (addr>0x7F oder hex/len)\r\n");
                 ws_reset();
                 return 1;
             }
 
-            uint32_t err   = HAL_I2C_GetError(&hi2c1);
-            uint32_t state = HAL_I2C_GetState(&hi2c1);
-
-            if (st == HAL_OK) {
-                cli_printf("I2C RX OK: ");
-                print_bytes(ws_rx, (uint16_t)len);
-                cli_printf("\r\n");
-            } else {
-                cli_printf("I2C RX FEHLER: st=%lu, err=0x%08lX, state=%lu\r\n",
-                           (unsigned long)st,
-                           (unsigned long)err,
-                           (unsigned long)state);
+            if (!ws_have_addr) {
+                cli_printf("\r\nwrite: FEHLER (addr missing)\r\n");
+                ws_reset();
+                return 1;
             }
 
-            // ErrorCode löschen, damit der nächste Versuch sauber ist
-            hi2c1.ErrorCode = HAL_I2C_ERROR_NONE;
-
-            ws_reset();
-            return 1;
-        }
-
-        // WRITE finalisieren
-        uint16_t new_start = 0, new_len = 0;
-        (void)new_start;
-        (void)new_len;
-
-        HAL_StatusTypeDef fst = ws_finalize_segment_and_append(&new_start, &new_len);
-        if (fst != HAL_OK) {
-            cli_printf("\r\nwrite: FEHLER (addr>0x7F oder hex/len)\r\n");
-            ws_reset();
-            return 1;
-        }
-
-        if (!ws_have_addr) {
-            cli_printf("\r\nwrite: FEHLER (addr missing)\r\n");
-            ws_reset();
-            return 1;
+            cli_printf("\r\nwrite(final, stop): addr7=0x%02X (bus=0x%02X) data=",
+                       ws_addr7, (uint8_t)(ws_addr7 << 1));
+            print_bytes(ws_tx, ws_tx_len);
+            cli_printf("\r\n");
         }
 
-        cli_printf("\r\nwrite(final, stop): addr7=0x%02X (bus=0x%02X) data=",
-                   ws_addr7, (uint8_t)(ws_addr7 << 1));
-        print_bytes(ws_tx, ws_tx_len);
-        cli_printf("\r\n");
-
-        HAL_StatusTypeDef st = HAL_I2C_Master_Transmit(
-                &hi2c1,
-                (uint16_t)(ws_addr7 << 1),
-                ws_tx,
-                ws_tx_len,
-                I2C_TX_TIMEOUT_MS
-        );
-
-        uint32_t err   = HAL_I2C_GetError(&hi2c1);
-        uint32_t state = HAL_I2C_GetState(&hi2c1);
-
+        uint16_t id = 0;
+        HAL_StatusTypeDef st = ws_submit(len, &id);
         if (st == HAL_OK) {
-            cli_printf("I2C TX OK\r\n");
+            cli_printf("I2C [%u] queued\r\n", (unsigned)id);
         } else {
-            cli_printf("I2C TX FEHLER: st=%lu, err=0x%08lX, state=%lu\r\n",
-                       (unsigned long)st,
-                       (unsigned long)err,
-                       (unsigned long)state);
+            cli_printf("I2C FEHLER: %s\r\n", (st == HAL_BUSY) ? "Queue voll/Bus belegt" : "Segmente");
         }
 
-        // ErrorCode löschen, damit der nächste Versuch sauber ist
-        hi2c1.ErrorCode = HAL_I2C_ERROR_NONE;
-
         ws_reset();
         return 1;
     }
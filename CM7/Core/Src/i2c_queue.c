@@ -0,0 +1,310 @@
+/*
+ * i2c_queue.c
+ *
+ *  Non-blocking I2C1 transaction queue (interrupt driven, repeated start).
+ */
+#include "i2c_queue.h"
+#include "i2c_recover.h"
+#include "tim.h"
+#include <string.h>
+
+extern I2C_HandleTypeDef hi2c1;
+
+// ============================================================
+// I2C QUEUE (I2C1 Master)
+//
+//   - Transaktion = Kette von Segmenten (schreiben/lesen, auch an
+//     verschiedene Adressen); zwischen den Segmenten Repeated Start
+//     (TC -> neues CR2 mit START), STOP erst nach dem letzten
+//   - Schreiben: pro Byte ein IRQ (TXIS); Lesesegmente ab I2CQ_DMA_MIN
+//     per DMA1 Stream 6 direkt in data[] (AXI SRAM, kein D-Cache), die
+//     CPU sieht nur noch TC; NBYTES > 255 per RELOAD (TCR)
+//   - Ring mit I2CQ_DEPTH Plaetzen: Submit -> laeuft -> fertig -> Pop;
+//     Ergebnisse kommen in Submit Reihenfolge zurueck, die Superloop
+//     wartet nie auf den Bus
+//   - waehrend die Queue laeuft steht hi2c1.State auf BUSY, blockierende
+//     HAL Aufrufe (dump, scan, PMIC) bekommen HAL_BUSY statt zu stoeren
+//   - Timeout nur als Wachhund in I2CQ_Poll (SCL haengt), dann PE Reset
+// ============================================================
+
+#define I2CQ_I2C              I2C1
+#define I2CQ_CR1_IRQS         (I2C_CR1_TXIE | I2C_CR1_RXIE | I2C_CR1_TCIE | I2C_CR1_STOPIE | \
+                               I2C_CR1_NACKIE | I2C_CR1_ERRIE)
+#define I2CQ_ICR_ALL          (I2C_ICR_NACKCF | I2C_ICR_STOPCF | I2C_ICR_BERRCF | I2C_ICR_ARLOCF | \
+                               I2C_ICR_OVRCF | I2C_ICR_TIMOUTCF)
+#define I2CQ_NBYTES_MAX       (255u)
+#define I2CQ_DMA              DMA1_Stream6
+#define I2CQ_DMA_FLAGS        (DMA_HISR_FEIF6 | DMA_HISR_DMEIF6 | DMA_HISR_TEIF6 | \
+                               DMA_HISR_HTIF6 | DMA_HISR_TCIF6)
+
+typedef struct {
+    i2cq_xfer_t slot[I2CQ_DEPTH];
+    volatile uint8_t head;          // naechster freier Platz (Submit)
+    volatile uint8_t run;           // naechster/aktueller auszufuehrender
+    volatile uint8_t tail;          // aeltester nicht abgeholter
+
+    // ISR: laufende Transaktion
+    i2cq_xfer_t *cur;
+    volatile uint8_t busy;
+    uint8_t seg;
+    uint16_t pos;                   // Bytes im Segment uebertragen
+    uint16_t left;                  // Bytes noch nicht in NBYTES programmiert
+    uint8_t dma;                    // Segment laeuft per DMA
+    uint32_t tick0;
+    uint32_t timeout_ms;
+
+    uint16_t next_id;
+} i2cq_ctx_t;
+
+static i2cq_ctx_t g_q;
+
+const char *I2CQ_StatusStr(uint8_t status)
+{
+    switch (status) {
+        case I2CQ_OK:      return "OK";
+        case I2CQ_NACK:    return "NACK";
+        case I2CQ_ARLO:    return "ARLO";
+        case I2CQ_BERR:    return "BERR";
+        case I2CQ_TIMEOUT: return "TIMEOUT";
+        default:           return "?";
+    }
+}
+
+HAL_StatusTypeDef I2CQ_AddSeg(i2cq_xfer_t *x, uint8_t addr, uint8_t read, const uint8_t *tx, uint16_t len)
+{
+    if (!x || addr > 0x7Fu || x->nseg >= I2CQ_SEG_MAX) return HAL_ERROR;
+
+    uint16_t off = 0u;
+    if (x->nseg > 0u) {
+        const i2cq_seg_t *last = &x->seg[x->nseg - 1u];
+        off = (uint16_t)(last->off + last->len);
+    }
+    if ((uint32_t)off + len > I2CQ_DATA_MAX) return HAL_ERROR;
+    if (!read && len > 0u) {
+        if (!tx) return HAL_ERROR;
+        memcpy(&x->data[off], tx, len);
+    }
+
+    i2cq_seg_t *s = &x->seg[x->nseg++];
+    s->addr = addr;
+    s->read = read ? 1u : 0u;
+    s->len = len;
+    s->off = off;
+    return HAL_OK;
+}
+
+// ---------------- ISR Seite ----------------
+static void i2cq_stream_off(DMA_Stream_TypeDef *st)
+{
+    CLEAR_BIT(st->CR, DMA_SxCR_EN);
+    for (uint32_t i = 0u; i < 10000u && (st->CR & DMA_SxCR_EN); i++) { }
+}
+
+static void i2cq_dma_rx(uint8_t *dst, uint16_t len)
+{
+    i2cq_stream_off(I2CQ_DMA);
+    DMA1->HIFCR = I2CQ_DMA_FLAGS;
+    DMAMUX1_Channel6->CCR = DMA_REQUEST_I2C1_RX;
+    I2CQ_DMA->CR = DMA_SxCR_MINC | DMA_SxCR_PL_1;  // Peripherie -> Speicher, 8 Bit
+    I2CQ_DMA->PAR = (uint32_t)&I2CQ_I2C->RXDR;
+    I2CQ_DMA->M0AR = (uint32_t)dst;
+    I2CQ_DMA->NDTR = len;
+    I2CQ_DMA->FCR = 0u;
+    SET_BIT(I2CQ_DMA->CR, DMA_SxCR_EN);
+
+    MODIFY_REG(I2CQ_I2C->CR1, I2C_CR1_RXIE, I2C_CR1_RXDMAEN);
+    g_q.dma = 1u;
+}
+
+// DMA Segment beenden, pos = tatsaechlich gelesene Bytes
+static void i2cq_dma_end(void)
+{
+    if (!g_q.dma) return;
+
+    const i2cq_seg_t *s = &g_q.cur->seg[g_q.seg];
+    i2cq_stream_off(I2CQ_DMA);
+    g_q.pos = (uint16_t)(s->len - I2CQ_DMA->NDTR);
+    DMA1->HIFCR = I2CQ_DMA_FLAGS;
+    MODIFY_REG(I2CQ_I2C->CR1, I2C_CR1_RXDMAEN, I2C_CR1_RXIE);
+    g_q.dma = 0u;
+}
+
+static void i2cq_seg_start(void)
+{
+    const i2cq_seg_t *s = &g_q.cur->seg[g_q.seg];
+    uint32_t n = (s->len > I2CQ_NBYTES_MAX) ? I2CQ_NBYTES_MAX : s->len;
+
+    g_q.pos = 0u;
+    g_q.left = (uint16_t)(s->len - n);
+    if (s->read && s->len >= I2CQ_DMA_MIN) i2cq_dma_rx(&g_q.cur->data[s->off], s->len);
+
+    // START bei TC (Segment davor fertig) = Repeated Start
+    I2CQ_I2C->CR2 = ((uint32_t)s->addr << 1) |
+                    (s->read ? I2C_CR2_RD_WRN : 0u) |
+                    (n << I2C_CR2_NBYTES_Pos) |
+                    (g_q.left ? I2C_CR2_RELOAD : 0u) |
+                    I2C_CR2_START;
+}
+
+static void i2cq_kick(void)
+{
+    if (g_q.busy || g_q.run == g_q.head) return;
+
+    i2cq_xfer_t *x = &g_q.slot[g_q.run & (I2CQ_DEPTH - 1u)];
+    uint32_t bytes = 0u;
+    for (uint8_t i = 0; i < x->nseg; i++) bytes += x->seg[i].len;
+
+    g_q.cur = x;
+    g_q.busy = 1u;
+    g_q.seg = 0u;
+    g_q.tick0 = HAL_GetTick();
+    g_q.timeout_ms = I2CQ_TIMEOUT_MS + bytes;
+    x->t_start = TIM_Micros();
+    hi2c1.State = HAL_I2C_STATE_BUSY;
+
+    I2CQ_I2C->ICR = I2CQ_ICR_ALL;
+    I2CQ_I2C->ISR = I2C_ISR_TXE;            // TXDR leeren
+    SET_BIT(I2CQ_I2C->CR1, I2CQ_CR1_IRQS);
+    i2cq_seg_start();
+}
+
+static void i2cq_finish(uint8_t status)
+{
+    i2cq_xfer_t *x = g_q.cur;
+
+    i2cq_dma_end();
+    CLEAR_BIT(I2CQ_I2C->CR1, I2CQ_CR1_IRQS);
+    x->status = status;
+    x->t_end = TIM_Micros();
+    if (status != I2CQ_OK) {
+        x->err_seg = g_q.seg;
+        x->err_pos = g_q.pos;
+    }
+
+    g_q.cur = NULL;
+    g_q.busy = 0u;
+    g_q.run++;
+    hi2c1.State = HAL_I2C_STATE_READY;
+    i2cq_kick();
+}
+
+void I2CQ_IRQHandler(void)
+{
+    if (!g_q.busy) return;
+
+    i2cq_xfer_t *x = g_q.cur;
+    const i2cq_seg_t *s = &x->seg[g_q.seg];
+    uint32_t isr = I2CQ_I2C->ISR;
+
+    if (isr & (I2C_ISR_ARLO | I2C_ISR_BERR)) {
+        // Controller haengt: PE = 0 setzt die State Machine zurueck
+        I2CR_ResetPE(I2CQ_I2C, (isr & I2C_ISR_ARLO) ? I2CR_CAUSE_ARLO : I2CR_CAUSE_BERR);
+        i2cq_finish((isr & I2C_ISR_ARLO) ? I2CQ_ARLO : I2CQ_BERR);
+        return;
+    }
+
+    if (isr & I2C_ISR_NACKF) {
+        // ohne AUTOEND kommt STOP nicht von selbst; Abschluss bei STOPF
+        I2CQ_I2C->ICR = I2C_ICR_NACKCF;
+        x->status = I2CQ_NACK;
+        I2CQ_I2C->CR2 |= I2C_CR2_STOP;
+    }
+
+    if (isr & I2C_ISR_STOPF) {
+        I2CQ_I2C->ICR = I2C_ICR_STOPCF;
+        i2cq_finish(x->status);
+        return;
+    }
+
+    if ((isr & I2C_ISR_RXNE) && s->read && !g_q.dma) {
+        uint8_t b = (uint8_t)I2CQ_I2C->RXDR;
+        if (g_q.pos < s->len) x->data[s->off + g_q.pos] = b;
+        g_q.pos++;
+    }
+
+    if ((isr & I2C_ISR_TXIS) && !s->read) {
+        I2CQ_I2C->TXDR = (g_q.pos < s->len) ? x->data[s->off + g_q.pos] : 0xFFu;
+        g_q.pos++;
+    }
+
+    if (isr & I2C_ISR_TCR) {
+        uint32_t n = (g_q.left > I2CQ_NBYTES_MAX) ? I2CQ_NBYTES_MAX : g_q.left;
+        g_q.left = (uint16_t)(g_q.left - n);
+        MODIFY_REG(I2CQ_I2C->CR2, I2C_CR2_NBYTES | I2C_CR2_RELOAD,
+                   (n << I2C_CR2_NBYTES_Pos) | (g_q.left ? I2C_CR2_RELOAD : 0u));
+    }
+
+    if (isr & I2C_ISR_TC) {
+        if (g_q.dma) {
+            // letztes Byte kann TC um wenige Takte vorauslaufen
+            for (uint32_t i = 0u; i < 1000u && I2CQ_DMA->NDTR != 0u; i++) { }
+            i2cq_dma_end();
+        }
+        if ((uint8_t)(g_q.seg + 1u) < x->nseg) {
+            g_q.seg++;
+            i2cq_seg_start();
+        } else {
+            I2CQ_I2C->CR2 |= I2C_CR2_STOP;
+        }
+    }
+}
+
+// ---------------- Superloop Seite ----------------
+HAL_StatusTypeDef I2CQ_Submit(const i2cq_xfer_t *x, uint16_t *out_id)
+{
+    if (!x || x->nseg == 0u) return HAL_ERROR;
+    if ((uint8_t)(g_q.head - g_q.tail) >= I2CQ_DEPTH) return HAL_BUSY;
+
+    // Handle nicht bereit (Re-Init, Fehlerzustand eines HAL Aufrufs)
+    if (!g_q.busy && hi2c1.State != HAL_I2C_STATE_READY) return HAL_BUSY;
+
+    i2cq_xfer_t *slot = &g_q.slot[g_q.head & (I2CQ_DEPTH - 1u)];
+    *slot = *x;
+    slot->id = g_q.next_id++;
+    slot->status = I2CQ_OK;
+    slot->err_seg = 0u;
+    slot->err_pos = 0u;
+    if (out_id) *out_id = slot->id;
+
+    HAL_NVIC_SetPriority(I2C1_EV_IRQn, I2CQ_IRQ_PRIO, 0);
+    HAL_NVIC_SetPriority(I2C1_ER_IRQn, I2CQ_IRQ_PRIO, 0);
+    HAL_NVIC_EnableIRQ(I2C1_EV_IRQn);
+    HAL_NVIC_EnableIRQ(I2C1_ER_IRQn);
+
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    g_q.head++;
+    i2cq_kick();
+    __set_PRIMASK(primask);
+    return HAL_OK;
+}
+
+const i2cq_xfer_t *I2CQ_Peek(void)
+{
+    if (g_q.tail == g_q.run) return NULL;
+    return &g_q.slot[g_q.tail & (I2CQ_DEPTH - 1u)];
+}
+
+void I2CQ_Pop(void)
+{
+    if (g_q.tail != g_q.run) g_q.tail++;
+}
+
+uint8_t I2CQ_IsActive(void)
+{
+    return (g_q.busy || g_q.run != g_q.head) ? 1u : 0u;
+}
+
+void I2CQ_Poll(void)
+{
+    if (!g_q.busy) return;
+    if ((HAL_GetTick() - g_q.tick0) <= g_q.timeout_ms) return;
+
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    if (g_q.busy && (HAL_GetTick() - g_q.tick0) > g_q.timeout_ms) {
+        I2CR_ResetPE(I2CQ_I2C, I2CR_CAUSE_TIMEOUT);
+        i2cq_finish(I2CQ_TIMEOUT);
+    }
+    __set_PRIMASK(primask);
+}
@@ -0,0 +1,257 @@
+/*
+ * i2c_recover.c
+ *
+ *  I2C bus recovery: SCL clocking for a stuck SDA, STOP, PE reset; counters per cause.
+ */
+#include "i2c_recover.h"
+#include "cli.h"
+#include "tim.h"
+#include <string.h>
+
+// ============================================================
+// I2C RECOVERY (I2C1, I2C4)
+//
+//   - statt HAL_I2C_DeInit/Init (MspDeInit, GPIO, Takt, einige 100 us):
+//     PE = 0 setzt nur die State Machine und die Flags zurueck, TIMINGR,
+//     Filter und OARx bleiben -> wenige APB Takte
+//   - haelt ein Slave SDA low (Reset mitten im Lesen), hilft kein PE
+//     Reset: Pins kurz als GPIO (Open Drain), bis zu 9 SCL Takte bis
+//     SDA frei ist, dann STOP, danach zurueck auf AF (UM10204 3.1.16)
+//   - SCL dauerhaft low ist nicht behebbar, wird nur gezaehlt
+//   - Zaehler pro Ursache und Bus, I2CR_PrintStats ('recover stat')
+// ============================================================
+
+#define I2CR_ICR_ALL          (I2C_ICR_ADDRCF | I2C_ICR_NACKCF | I2C_ICR_STOPCF | I2C_ICR_BERRCF | \
+                               I2C_ICR_ARLOCF | I2C_ICR_OVRCF | I2C_ICR_TIMOUTCF)
+
+typedef struct {
+    const I2C_TypeDef *inst;
+    GPIO_TypeDef *port;
+    uint8_t scl;              // Pin Nummer
+    uint8_t sda;
+    const char *name;
+} i2cr_bus_t;
+
+// Pins wie in i2c.c (MspInit)
+static const i2cr_bus_t g_i2cr_bus[2] = {
+    { I2C1, GPIOB, 8u, 9u, "I2C1" },
+    { I2C4, GPIOB, 6u, 7u, "I2C4" },
+};
+
+static i2cr_stats_t g_i2cr_stats[2];
+
+static int i2cr_index(const I2C_TypeDef *inst)
+{
+    if (inst == I2C1) return 0;
+    if (inst == I2C4) return 1;
+    return -1;
+}
+
+const char *I2CR_CauseStr(i2cr_cause_t cause)
+{
+    switch (cause) {
+        case I2CR_CAUSE_STATE:   return "State";
+        case I2CR_CAUSE_TIMEOUT: return "Timeout";
+        case I2CR_CAUSE_ARLO:    return "ARLO";
+        case I2CR_CAUSE_BERR:    return "BERR";
+        case I2CR_CAUSE_BUSY:    return "BUSY";
+        case I2CR_CAUSE_SDA_LOW: return "SDA low";
+        case I2CR_CAUSE_USER:    return "manuell";
+        default:                 return "?";
+    }
+}
+
+static void i2cr_count(const I2C_TypeDef *inst, i2cr_cause_t cause)
+{
+    int i = i2cr_index(inst);
+    if (i < 0 || cause >= I2CR_CAUSE_COUNT) return;
+    g_i2cr_stats[i].cause[cause]++;
+}
+
+void I2CR_ResetPE(I2C_TypeDef *inst, i2cr_cause_t cause)
+{
+    // PE muss mindestens 3 APB Takte low sein, Ruecklesen reicht dafuer
+    CLEAR_BIT(inst->CR1, I2C_CR1_PE);
+    while (inst->CR1 & I2C_CR1_PE) { }
+    inst->ICR = I2CR_ICR_ALL;
+    SET_BIT(inst->CR1, I2C_CR1_PE);
+    i2cr_count(inst, cause);
+}
+
+// ---------------- Leitungen ----------------
+static uint8_t i2cr_pin(const i2cr_bus_t *b, uint8_t pin)
+{
+    return (uint8_t)((b->port->IDR >> pin) & 1u);
+}
+
+static void i2cr_drive(const i2cr_bus_t *b, uint8_t pin, uint8_t high)
+{
+    b->port->BSRR = high ? (1u << pin) : (1u << (pin + 16u));
+}
+
+static void i2cr_mode(const i2cr_bus_t *b, uint8_t pin, uint32_t mode)
+{
+    MODIFY_REG(b->port->MODER, 3u << (pin * 2u), mode << (pin * 2u));
+}
+
+static void i2cr_delay_us(uint32_t us)
+{
+    uint32_t t0 = TIM_Micros();
+    while ((TIM_Micros() - t0) < us) { }
+}
+
+// SCL freigeben und auf high warten (Clock Stretching des Slaves)
+static uint8_t i2cr_scl_release(const i2cr_bus_t *b)
+{
+    i2cr_drive(b, b->scl, 1u);
+    uint32_t t0 = TIM_Micros();
+    while (!i2cr_pin(b, b->scl)) {
+        if ((TIM_Micros() - t0) > I2CR_SCL_WAIT_US) return 0u;
+    }
+    return 1u;
+}
+
+uint8_t I2CR_LinesIdle(const I2C_TypeDef *inst)
+{
+    int i = i2cr_index(inst);
+    if (i < 0) return 0u;
+    const i2cr_bus_t *b = &g_i2cr_bus[i];
+    return (i2cr_pin(b, b->scl) && i2cr_pin(b, b->sda)) ? 1u : 0u;
+}
+
+// PE = 0 erwartet; 1 = Bus frei
+static uint8_t i2cr_clock_free(const i2cr_bus_t *b, i2cr_stats_t *st)
+{
+    uint8_t ok = 1u;
+
+    i2cr_drive(b, b->scl, 1u);
+    i2cr_drive(b, b->sda, 1u);
+    i2cr_mode(b, b->scl, 1u);               // Ausgang, OTYPER bleibt Open Drain
+    i2cr_mode(b, b->sda, 1u);
+
+    if (!i2cr_scl_release(b)) {
+        st->scl_stuck++;
+        ok = 0u;
+    } else {
+        for (uint8_t n = 0u; n < I2CR_PULSES_MAX && !i2cr_pin(b, b->sda); n++) {
+            i2cr_drive(b, b->scl, 0u);
+            i2cr_delay_us(I2CR_HALF_US);
+            if (!i2cr_scl_release(b)) break;
+            i2cr_delay_us(I2CR_HALF_US);
+            st->pulses++;
+        }
+
+        // STOP: SDA low -> high waehrend SCL high
+        i2cr_drive(b, b->scl, 0u);
+        i2cr_delay_us(I2CR_HALF_US);
+        i2cr_drive(b, b->sda, 0u);
+        i2cr_delay_us(I2CR_HALF_US);
+        (void)i2cr_scl_release(b);
+        i2cr_delay_us(I2CR_HALF_US);
+        i2cr_drive(b, b->sda, 1u);
+        i2cr_delay_us(I2CR_HALF_US);
+
+        if (!i2cr_pin(b, b->scl)) {
+            st->scl_stuck++;
+            ok = 0u;
+        } else if (i2cr_pin(b, b->sda)) {
+            st->sda_freed++;
+        } else {
+            st->sda_stuck++;
+            ok = 0u;
+        }
+    }
+
+    i2cr_mode(b, b->scl, 2u);               // zurueck auf AF
+    i2cr_mode(b, b->sda, 2u);
+    return ok;
+}
+
+// ---------------- Recovery ----------------
+HAL_StatusTypeDef I2CR_Recover(I2C_HandleTypeDef *hi2c, i2cr_cause_t cause)
+{
+    if (!hi2c) return HAL_ERROR;
+    int i = i2cr_index(hi2c->Instance);
+    if (i < 0) return HAL_ERROR;
+
+    const i2cr_bus_t *b = &g_i2cr_bus[i];
+    i2cr_stats_t *st = &g_i2cr_stats[i];
+    I2C_TypeDef *inst = hi2c->Instance;
+    uint32_t t0 = TIM_Micros();
+    uint8_t ok = 1u;
+
+    CLEAR_BIT(inst->CR1, I2C_CR1_PE);
+    while (inst->CR1 & I2C_CR1_PE) { }
+
+    if (!i2cr_pin(b, b->sda) || !i2cr_pin(b, b->scl)) {
+        st->cause[I2CR_CAUSE_SDA_LOW]++;
+        ok = i2cr_clock_free(b, st);
+    }
+
+    inst->ICR = I2CR_ICR_ALL;
+    SET_BIT(inst->CR1, I2C_CR1_PE);
+    i2cr_count(inst, cause);
+
+    hi2c->ErrorCode = HAL_I2C_ERROR_NONE;
+    hi2c->State = HAL_I2C_STATE_READY;
+    hi2c->PreviousState = 0u;
+    hi2c->Mode = HAL_I2C_MODE_NONE;
+    __HAL_UNLOCK(hi2c);
+
+    st->last_us = TIM_Micros() - t0;
+    return ok ? HAL_OK : HAL_ERROR;
+}
+
+HAL_StatusTypeDef I2CR_Ensure(I2C_HandleTypeDef *hi2c)
+{
+    if (!hi2c) return HAL_ERROR;
+
+    HAL_I2C_StateTypeDef state = hi2c->State;
+    uint32_t err = hi2c->ErrorCode;
+
+    if (state == HAL_I2C_STATE_RESET) return HAL_I2C_Init(hi2c);
+    // BUSY_x/LISTEN: Handle gehoert einer Engine (Queue/Watch/Target/IT Transfer)
+    if (state != HAL_I2C_STATE_READY && ((uint32_t)state & 0xF0u) == 0x20u) return HAL_BUSY;
+
+    if (state == HAL_I2C_STATE_READY) {
+        if ((err & ~(uint32_t)HAL_I2C_ERROR_AF) == 0u && !(hi2c->Instance->ISR & I2C_ISR_BUSY)) {
+            hi2c->ErrorCode = HAL_I2C_ERROR_NONE;   // NACK: kein Recovery noetig
+            return HAL_OK;
+        }
+        if (err & HAL_I2C_ERROR_ARLO) return I2CR_Recover(hi2c, I2CR_CAUSE_ARLO);
+        if (err & HAL_I2C_ERROR_BERR) return I2CR_Recover(hi2c, I2CR_CAUSE_BERR);
+        if (err & HAL_I2C_ERROR_TIMEOUT) return I2CR_Recover(hi2c, I2CR_CAUSE_TIMEOUT);
+        return I2CR_Recover(hi2c, I2CR_CAUSE_BUSY);
+    }
+    return I2CR_Recover(hi2c, I2CR_CAUSE_STATE);
+}
+
+// ---------------- Statistik ----------------
+const i2cr_stats_t *I2CR_GetStats(const I2C_TypeDef *inst)
+{
+    int i = i2cr_index(inst);
+    return (i < 0) ? NULL : &g_i2cr_stats[i];
+}
+
+void I2CR_ResetStats(void)
+{
+    memset(g_i2cr_stats, 0, sizeof(g_i2cr_stats));
+}
+
+void I2CR_PrintStats(void)
+{
+    for (uint8_t i = 0u; i < 2u; i++) {
+        const i2cr_bus_t *b = &g_i2cr_bus[i];
+        const i2cr_stats_t *st = &g_i2cr_stats[i];
+
+        cli_printf("\r\n%s Recovery: SCL=%u SDA=%u, letzte %lu us\r\n", b->name,
+                   (unsigned)i2cr_pin(b, b->scl), (unsigned)i2cr_pin(b, b->sda), (unsigned long)st->last_us);
+        cli_printf("  ");
+        for (uint8_t c = 0u; c < I2CR_CAUSE_COUNT; c++) {
+            cli_printf("%s=%lu ", I2CR_CauseStr((i2cr_cause_t)c), (unsigned long)st->cause[c]);
+        }
+        cli_printf("\r\n  Takte=%lu SDA frei=%lu SDA haengt=%lu SCL haengt=%lu\r\n",
+                   (unsigned long)st->pulses, (unsigned long)st->sda_freed,
+                   (unsigned long)st->sda_stuck, (unsigned long)st->scl_stuck);
+    }
+}
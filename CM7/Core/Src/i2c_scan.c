@@ -0,0 +1,168 @@
+/*
+ * i2c_scan.c
+ *
+ *  Interrupt-driven I2C address scanner (I2C1 / I2C4, address-only probes).
+ */
+#include "i2c_scan.h"
+#include "i2c_recover.h"
+#include "tim.h"
+#include <stdio.h>
+#include <string.h>
+
+// ============================================================
+// I2C SCAN
+//
+//   - pro Adresse ein Probe: START + Adresse(W), NBYTES = 0, AUTOEND ->
+//     der Controller erzeugt STOP selbst, NACK meldet die Hardware
+//     (NACKF), kein HAL Timeout und kein Delay pro Adresse
+//   - der STOPF IRQ wertet aus und startet sofort die naechste Adresse,
+//     die Probes laufen also direkt hintereinander (400 kHz: ~30 us)
+//   - Ergebnis erst komplett sammeln, dann eine Tabelle am Stueck
+//   - HAL Handle bleibt READY, nur die IRQ Enables werden fuer die Dauer
+//     des Scans gesetzt und danach zurueckgenommen
+// ============================================================
+
+#define I2CSCAN_IRQ_MASK      (I2C_CR1_NACKIE | I2C_CR1_STOPIE | I2C_CR1_ERRIE)
+#define I2CSCAN_ERR_FLAGS     (I2C_ISR_BERR | I2C_ISR_ARLO | I2C_ISR_OVR | I2C_ISR_TIMEOUT)
+
+typedef struct {
+    I2C_TypeDef *inst;
+    i2cscan_t *out;
+    uint8_t addr;
+    uint8_t last;
+    volatile uint8_t done;
+    uint8_t nack;
+    uint8_t err;
+} i2cscan_ctx_t;
+
+static i2cscan_ctx_t g_scan;
+
+static void i2cscan_irqs(I2C_TypeDef *inst, uint8_t on)
+{
+    IRQn_Type ev = (inst == I2C4) ? I2C4_EV_IRQn : I2C1_EV_IRQn;
+    IRQn_Type er = (inst == I2C4) ? I2C4_ER_IRQn : I2C1_ER_IRQn;
+
+    if (on) {
+        HAL_NVIC_SetPriority(ev, I2CSCAN_IRQ_PRIO, 0);
+        HAL_NVIC_SetPriority(er, I2CSCAN_IRQ_PRIO, 0);
+        HAL_NVIC_EnableIRQ(ev);
+        HAL_NVIC_EnableIRQ(er);
+        SET_BIT(inst->CR1, I2CSCAN_IRQ_MASK);
+    } else {
+        CLEAR_BIT(inst->CR1, I2CSCAN_IRQ_MASK);
+        HAL_NVIC_DisableIRQ(ev);
+        HAL_NVIC_DisableIRQ(er);
+    }
+}
+
+static void i2cscan_probe(uint8_t addr)
+{
+    g_scan.addr = addr;
+    g_scan.nack = 0u;
+    g_scan.err = 0u;
+    g_scan.inst->CR2 = ((uint32_t)addr << 1) | I2C_CR2_AUTOEND | I2C_CR2_START;
+}
+
+HAL_StatusTypeDef I2CSCAN_Run(I2C_HandleTypeDef *hi2c, uint8_t first, uint8_t last, i2cscan_t *out)
+{
+    if (!hi2c || !out || first > last || last > 0x7Fu) return HAL_ERROR;
+    if (HAL_I2C_GetState(hi2c) != HAL_I2C_STATE_READY) return HAL_BUSY;
+
+    I2C_TypeDef *inst = hi2c->Instance;
+    if (inst != I2C1 && inst != I2C4) return HAL_ERROR;
+    if (inst->ISR & I2C_ISR_BUSY) return HAL_BUSY;      // SDA/SCL low -> Recovery
+
+    memset(out, 0, sizeof(*out));
+    memset(out->res, I2CSCAN_SKIP, sizeof(out->res));
+
+    inst->ICR = I2C_ICR_NACKCF | I2C_ICR_STOPCF | I2C_ICR_BERRCF | I2C_ICR_ARLOCF |
+                I2C_ICR_OVRCF | I2C_ICR_TIMOUTCF;
+    g_scan.inst = inst;
+    g_scan.out = out;
+    g_scan.last = last;
+    g_scan.done = 0u;
+
+    uint32_t t0 = TIM_Micros();
+    uint32_t tick0 = HAL_GetTick();
+    i2cscan_irqs(inst, 1u);
+    i2cscan_probe(first);
+
+    while (!g_scan.done) {
+        if ((HAL_GetTick() - tick0) > I2CSCAN_TIMEOUT_MS) break;
+    }
+    out->us = TIM_Micros() - t0;
+    i2cscan_irqs(inst, 0u);
+
+    if (!g_scan.done) {
+        // SCL haengt: Controller per PE zuruecksetzen
+        I2CR_ResetPE(inst, I2CR_CAUSE_TIMEOUT);
+        g_scan.inst = NULL;
+        return HAL_TIMEOUT;
+    }
+    g_scan.inst = NULL;
+    hi2c->ErrorCode = HAL_I2C_ERROR_NONE;
+    return HAL_OK;
+}
+
+void I2CSCAN_IRQHandler(I2C_TypeDef *inst)
+{
+    if (inst != g_scan.inst || g_scan.done) return;
+
+    uint32_t isr = inst->ISR;
+
+    if (isr & I2C_ISR_NACKF) {
+        inst->ICR = I2C_ICR_NACKCF;
+        g_scan.nack = 1u;
+    }
+    if (isr & I2CSCAN_ERR_FLAGS) {
+        inst->ICR = I2C_ICR_BERRCF | I2C_ICR_ARLOCF | I2C_ICR_OVRCF | I2C_ICR_TIMOUTCF;
+        g_scan.err = 1u;
+        // nach Arbitration Lost kommt kein STOP von uns
+        if (isr & I2C_ISR_ARLO) isr |= I2C_ISR_STOPF;
+    }
+    if ((isr & I2C_ISR_STOPF) == 0u) return;
+    inst->ICR = I2C_ICR_STOPCF;
+
+    i2cscan_t *out = g_scan.out;
+    uint8_t r = g_scan.err ? I2CSCAN_ERR : (g_scan.nack ? I2CSCAN_NONE : I2CSCAN_ACK);
+    out->res[g_scan.addr] = r;
+    if (r == I2CSCAN_ACK) out->found++;
+    if (r == I2CSCAN_ERR) out->errors++;
+
+    if (g_scan.addr >= g_scan.last) {
+        g_scan.done = 1u;
+        return;
+    }
+    i2cscan_probe((uint8_t)(g_scan.addr + 1u));
+}
+
+uint16_t I2CSCAN_Format(const i2cscan_t *scan, const char *name, char *buf, uint16_t size)
+{
+    int n = 0;
+
+#define I2CSCAN_PUT(...) \
+    do { if (n < (int)size) n += snprintf(&buf[n], (size_t)(size - (uint16_t)n), __VA_ARGS__); } while (0)
+
+    I2CSCAN_PUT("\r\n%s scan: %u gefunden", name ? name : "I2C", (unsigned)scan->found);
+    if (scan->errors) I2CSCAN_PUT(", %u Busfehler", (unsigned)scan->errors);
+    I2CSCAN_PUT(" (%lu us)\r\n     ", (unsigned long)scan->us);
+    for (uint8_t x = 0; x < 16u; x++) I2CSCAN_PUT("%02x ", x);
+    I2CSCAN_PUT("\r\n");
+
+    for (uint8_t row = 0; row < 8u; row++) {
+        I2CSCAN_PUT("%02x: ", (unsigned)(row << 4));
+        for (uint8_t col = 0; col < 16u; col++) {
+            uint8_t addr = (uint8_t)((row << 4) + col);
+            switch (scan->res[addr]) {
+                case I2CSCAN_ACK:  I2CSCAN_PUT("%02x ", addr); break;
+                case I2CSCAN_NONE: I2CSCAN_PUT("-- "); break;
+                case I2CSCAN_ERR:  I2CSCAN_PUT("EE "); break;
+                default:           I2CSCAN_PUT("   "); break;
+            }
+        }
+        I2CSCAN_PUT("\r\n");
+    }
+#undef I2CSCAN_PUT
+
+    return (uint16_t)((n < (int)size) ? n : (int)size - 1);
+}
@@ -0,0 +1,509 @@
+/*
+ * i2c_slave.c
+ *
+ *  I2C1 as bus target: RAM register file with auto-increment pointer, access log.
+ */
+#include "i2c_slave.h"
+#include "cli.h"
+#include "tim.h"
+#include "crc_util.h"
+#include <string.h>
+
+extern I2C_HandleTypeDef hi2c1;
+
+// ============================================================
+// I2C TARGET (I2C1 Slave, Sensor/EEPROM Emulation)
+//
+//   - OAR1 + optional OAR2, Listen Mode ueber IRQ; Clock Stretching
+//     bleibt an (NOSTRETCH = 0): SCL steht bis ADDR quittiert bzw.
+//     TXDR beschrieben ist -> bei 1 MHz kein Timing im IRQ noetig
+//   - Protokoll wie 24Cxx/Sensoren: erste 1 oder 2 Bytes eines Writes
+//     setzen den Registerzeiger, weitere Bytes schreiben mit
+//     Auto-Inkrement; Read (auch nach Repeated Start) liest ab Zeiger
+//   - Slave TX: ein Byte liegt immer vorab in TXDR. Beendet der Host mit
+//     NACK, war dieses Byte nicht auf dem Bus -> Zeiger wieder zurueck
+//   - Schreibschutz als Bitmaske pro Byte, Skripte ersetzen das erste
+//     gelesene Byte eines Registers (Status-/Zaehlerregister)
+//   - jeder Abschnitt (Adresse bis Repeated Start/STOP) kommt ins Log,
+//     Ring ueberschreibt den aeltesten Eintrag
+// ============================================================
+
+#define I2CSL_I2C             I2C1
+#define I2CSL_CR1_IRQS        (I2C_CR1_ADDRIE | I2C_CR1_TXIE | I2C_CR1_RXIE | I2C_CR1_STOPIE | \
+                               I2C_CR1_NACKIE | I2C_CR1_ERRIE)
+#define I2CSL_ICR_ALL         (I2C_ICR_ADDRCF | I2C_ICR_NACKCF | I2C_ICR_STOPCF | I2C_ICR_BERRCF | \
+                               I2C_ICR_ARLOCF | I2C_ICR_OVRCF)
+
+typedef enum {
+    I2CSL_IDLE = 0,
+    I2CSL_RX,                       // Host schreibt
+    I2CSL_TX,                       // Host liest
+} i2csl_state_t;
+
+typedef struct {
+    uint8_t used;
+    uint8_t target;
+    uint8_t n;
+    uint8_t pos;
+    uint8_t once;
+    uint16_t reg;
+    uint8_t values[I2CSL_SCRIPT_MAX];
+} i2csl_script_t;
+
+typedef struct {
+    volatile uint8_t active;
+    i2csl_cfg_t cfg;
+    uint8_t state;
+    uint8_t target;
+    uint8_t pcnt;                   // Zeigerbytes im aktuellen Write
+    uint16_t ptr[I2CSL_TARGETS];
+    i2csl_log_t rec;                // laufender Abschnitt
+    uint8_t rec_open;
+
+    uint16_t log_head;
+    uint16_t log_tail;
+    uint32_t log_over;
+
+    uint32_t reads;                 // Abschnitte
+    uint32_t writes;
+    uint32_t rx_bytes;
+    uint32_t tx_bytes;
+    uint32_t ro_hits;
+    uint32_t errors;
+
+    // load
+    uint8_t load;
+    uint32_t load_off;
+    uint32_t load_end;
+    uint32_t load_crc;
+    uint32_t load_t0;
+    uint32_t load_progress;
+} i2csl_ctx_t;
+
+static uint8_t g_i2csl_file[I2CSL_FILE_SIZE];
+static uint8_t g_i2csl_ro[I2CSL_FILE_SIZE / 8u];
+static i2csl_script_t g_i2csl_script[I2CSL_SCRIPTS];
+static i2csl_log_t g_i2csl_log[I2CSL_LOG_SIZE];
+static i2csl_ctx_t g_sl;
+
+// ---------------- Registerdatei ----------------
+uint32_t I2CSL_TargetBase(uint8_t target)
+{
+    if (target >= I2CSL_TARGETS || g_sl.cfg.a16[target]) return 0u;
+    return (uint32_t)target * 256u;
+}
+
+static uint16_t i2csl_mask(uint8_t target)
+{
+    return g_sl.cfg.a16[target] ? 0xFFFFu : 0x00FFu;
+}
+
+void I2CSL_Fill(uint8_t value)
+{
+    memset(g_i2csl_file, value, sizeof(g_i2csl_file));
+}
+
+HAL_StatusTypeDef I2CSL_Set(uint32_t off, const uint8_t *data, uint32_t len)
+{
+    if (!data || off >= I2CSL_FILE_SIZE || len > I2CSL_FILE_SIZE - off) return HAL_ERROR;
+    memcpy(&g_i2csl_file[off], data, len);
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef I2CSL_Get(uint32_t off, uint8_t *data, uint32_t len)
+{
+    if (!data || off >= I2CSL_FILE_SIZE || len > I2CSL_FILE_SIZE - off) return HAL_ERROR;
+    memcpy(data, &g_i2csl_file[off], len);
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef I2CSL_SetReadOnly(uint32_t off, uint32_t len, uint8_t on)
+{
+    if (off >= I2CSL_FILE_SIZE || len > I2CSL_FILE_SIZE - off) return HAL_ERROR;
+
+    for (uint32_t i = off; i < off + len; i++) {
+        if (on) g_i2csl_ro[i >> 3] |= (uint8_t)(1u << (i & 7u));
+        else g_i2csl_ro[i >> 3] &= (uint8_t)~(1u << (i & 7u));
+    }
+    return HAL_OK;
+}
+
+uint8_t I2CSL_IsReadOnly(uint32_t off)
+{
+    if (off >= I2CSL_FILE_SIZE) return 1u;
+    return (g_i2csl_ro[off >> 3] >> (off & 7u)) & 1u;
+}
+
+// ---------------- Skripte ----------------
+HAL_StatusTypeDef I2CSL_SetScript(uint8_t slot, uint8_t target, uint16_t reg,
+                                  const uint8_t *values, uint8_t n, uint8_t once)
+{
+    if (slot >= I2CSL_SCRIPTS || target >= I2CSL_TARGETS || n > I2CSL_SCRIPT_MAX) return HAL_ERROR;
+    if (n > 0u && !values) return HAL_ERROR;
+
+    i2csl_script_t s;
+    memset(&s, 0, sizeof(s));
+    s.used = (n > 0u) ? 1u : 0u;
+    s.target = target;
+    s.reg = reg;
+    s.n = n;
+    s.once = once ? 1u : 0u;
+    if (n) memcpy(s.values, values, n);
+
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    g_i2csl_script[slot] = s;
+    __set_PRIMASK(primask);
+    return HAL_OK;
+}
+
+void I2CSL_ClearScripts(void)
+{
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    memset(g_i2csl_script, 0, sizeof(g_i2csl_script));
+    __set_PRIMASK(primask);
+}
+
+void I2CSL_PrintScripts(void)
+{
+    uint8_t n = 0u;
+
+    cli_printf("\r\nSkripte:\r\n");
+    for (uint8_t i = 0u; i < I2CSL_SCRIPTS; i++) {
+        const i2csl_script_t *s = &g_i2csl_script[i];
+        if (!s->used) continue;
+        n++;
+        cli_printf("  #%u T%u r%04X %s pos=%u:", (unsigned)i, (unsigned)s->target, (unsigned)s->reg,
+                   s->once ? "once" : "loop", (unsigned)s->pos);
+        for (uint8_t k = 0u; k < s->n; k++) cli_printf(" %02X", s->values[k]);
+        cli_printf("\r\n");
+    }
+    if (n == 0u) cli_printf("  (keine)\r\n");
+}
+
+// ---------------- Load (Rohdaten vom Host) ----------------
+HAL_StatusTypeDef I2CSL_Load(uint32_t off, uint32_t len)
+{
+    if (g_sl.load) return HAL_BUSY;
+    if (len == 0u || off >= I2CSL_FILE_SIZE || len > I2CSL_FILE_SIZE - off) return HAL_ERROR;
+
+    g_sl.load_off = off;
+    g_sl.load_end = off + len;
+    g_sl.load_crc = CRC32_INIT;
+    g_sl.load_t0 = HAL_GetTick();
+    g_sl.load_progress = g_sl.load_t0;
+    g_sl.load = 1u;
+    return HAL_OK;
+}
+
+uint8_t I2CSL_IsRawActive(void)
+{
+    return g_sl.load;
+}
+
+uint16_t I2CSL_Feed(const uint8_t *data, uint16_t len)
+{
+    if (!g_sl.load) return len;
+
+    uint32_t n = g_sl.load_end - g_sl.load_off;
+    if (n > len) n = len;
+    memcpy(&g_i2csl_file[g_sl.load_off], data, n);
+    g_sl.load_crc = CRC32_Update(g_sl.load_crc, data, n);
+    g_sl.load_off += n;
+    g_sl.load_progress = HAL_GetTick();
+
+    if (g_sl.load_off >= g_sl.load_end) {
+        g_sl.load = 0u;
+        cli_printf("\r\ntarget load: fertig, CRC32 %08lX, %lu ms\r\n",
+                   (unsigned long)(g_sl.load_crc ^ CRC32_XOROUT),
+                   (unsigned long)(HAL_GetTick() - g_sl.load_t0));
+        CLI_PrintPrompt();
+    }
+    return (uint16_t)n;
+}
+
+void I2CSL_Poll(void)
+{
+    if (!g_sl.load) return;
+    if ((HAL_GetTick() - g_sl.load_progress) <= I2CSL_LOAD_TIMEOUT_MS) return;
+
+    g_sl.load = 0u;
+    cli_printf("\r\ntarget load: FEHLER Timeout (Host Daten) @ 0x%04lX\r\n", (unsigned long)g_sl.load_off);
+    CLI_PrintPrompt();
+}
+
+// ---------------- Log ----------------
+static void i2csl_rec_close(void)
+{
+    if (!g_sl.rec_open) return;
+    g_sl.rec_open = 0u;
+
+    if ((uint16_t)(g_sl.log_head - g_sl.log_tail) >= I2CSL_LOG_SIZE) {
+        g_sl.log_tail++;                    // aeltesten ueberschreiben
+        g_sl.log_over++;
+    }
+    g_i2csl_log[g_sl.log_head & (I2CSL_LOG_SIZE - 1u)] = g_sl.rec;
+    g_sl.log_head++;
+}
+
+static void i2csl_rec_byte(uint8_t b)
+{
+    if (g_sl.rec.len < I2CSL_LOG_DATA) g_sl.rec.data[g_sl.rec.len] = b;
+    else g_sl.rec.flags |= I2CSL_L_TRUNC;
+    g_sl.rec.len++;
+}
+
+uint8_t I2CSL_LogRead(i2csl_log_t *out)
+{
+    uint8_t ok = 0u;
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    if (g_sl.log_tail != g_sl.log_head) {
+        *out = g_i2csl_log[g_sl.log_tail & (I2CSL_LOG_SIZE - 1u)];
+        g_sl.log_tail++;
+        ok = 1u;
+    }
+    __set_PRIMASK(primask);
+    return ok;
+}
+
+void I2CSL_LogClear(void)
+{
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    g_sl.log_tail = g_sl.log_head;
+    g_sl.log_over = 0u;
+    __set_PRIMASK(primask);
+}
+
+// ---------------- ISR Seite ----------------
+// erstes Byte eines Reads: Skript fuer dieses Register?
+static void i2csl_script_apply(uint8_t target, uint16_t reg)
+{
+    for (uint8_t i = 0u; i < I2CSL_SCRIPTS; i++) {
+        i2csl_script_t *s = &g_i2csl_script[i];
+        if (!s->used || s->target != target || s->reg != reg) continue;
+
+        g_i2csl_file[I2CSL_TargetBase(target) + reg] = s->values[s->pos++];
+        if (s->pos >= s->n) {
+            s->pos = 0u;
+            if (s->once) s->used = 0u;
+        }
+        g_sl.rec.flags |= I2CSL_L_SCRIPT;
+        return;
+    }
+}
+
+static void i2csl_addr_match(uint32_t isr)
+{
+    uint8_t code = (uint8_t)((isr & I2C_ISR_ADDCODE) >> I2C_ISR_ADDCODE_Pos);
+    uint8_t t = (code == g_sl.cfg.addr[0]) ? 0u : 1u;
+
+    i2csl_rec_close();                      // Repeated Start
+    memset(&g_sl.rec, 0, sizeof(g_sl.rec));
+    g_sl.rec.t_us = TIM_Micros();
+    g_sl.rec.target = t;
+    g_sl.rec_open = 1u;
+    g_sl.target = t;
+
+    if (isr & I2C_ISR_DIR) {
+        g_sl.state = I2CSL_TX;
+        g_sl.reads++;
+        g_sl.rec.flags = I2CSL_L_READ;
+        g_sl.rec.ptr = g_sl.ptr[t];
+        i2csl_script_apply(t, g_sl.ptr[t]);
+        I2CSL_I2C->ISR = I2C_ISR_TXE;       // altes Vorab-Byte verwerfen
+    } else {
+        g_sl.state = I2CSL_RX;
+        g_sl.writes++;
+        g_sl.pcnt = 0u;
+        g_sl.rec.ptr = g_sl.ptr[t];
+    }
+    I2CSL_I2C->ICR = I2C_ICR_ADDRCF;        // SCL frei
+}
+
+static void i2csl_rx_byte(uint8_t b)
+{
+    uint8_t t = g_sl.target;
+    uint8_t plen = g_sl.cfg.a16[t] ? 2u : 1u;
+
+    g_sl.rx_bytes++;
+    if (g_sl.pcnt < plen) {
+        if (plen == 2u && g_sl.pcnt == 0u) g_sl.ptr[t] = (uint16_t)((uint16_t)b << 8);
+        else if (plen == 2u) g_sl.ptr[t] = (uint16_t)(g_sl.ptr[t] | b);
+        else g_sl.ptr[t] = b;
+        g_sl.pcnt++;
+        g_sl.rec.ptr = g_sl.ptr[t];
+        return;
+    }
+
+    uint32_t off = I2CSL_TargetBase(t) + g_sl.ptr[t];
+    if (I2CSL_IsReadOnly(off)) {
+        g_sl.rec.flags |= I2CSL_L_RO;
+        g_sl.ro_hits++;
+    } else {
+        g_i2csl_file[off] = b;
+    }
+    i2csl_rec_byte(b);
+    g_sl.ptr[t] = (uint16_t)((g_sl.ptr[t] + 1u) & i2csl_mask(t));
+}
+
+static void i2csl_tx_byte(void)
+{
+    uint8_t t = g_sl.target;
+    uint8_t b = g_i2csl_file[I2CSL_TargetBase(t) + g_sl.ptr[t]];
+
+    I2CSL_I2C->TXDR = b;
+    i2csl_rec_byte(b);
+    g_sl.tx_bytes++;
+    g_sl.ptr[t] = (uint16_t)((g_sl.ptr[t] + 1u) & i2csl_mask(t));
+}
+
+// Vorab-Byte in TXDR nicht gesendet: Zeiger/Log/Zaehler zurueck
+static void i2csl_tx_unwind(uint32_t isr)
+{
+    uint8_t t = g_sl.target;
+
+    if (g_sl.state != I2CSL_TX || (isr & I2C_ISR_TXE) || g_sl.rec.len == 0u) return;
+    g_sl.ptr[t] = (uint16_t)((g_sl.ptr[t] - 1u) & i2csl_mask(t));
+    g_sl.rec.len--;
+    g_sl.tx_bytes--;
+    I2CSL_I2C->ISR = I2C_ISR_TXE;
+}
+
+void I2CSL_IRQHandler(void)
+{
+    uint32_t isr = I2CSL_I2C->ISR;
+
+    if (!g_sl.active) {
+        I2CSL_I2C->ICR = I2CSL_ICR_ALL;
+        return;
+    }
+
+    if (isr & (I2C_ISR_BERR | I2C_ISR_OVR | I2C_ISR_ARLO)) {
+        I2CSL_I2C->ICR = I2C_ICR_BERRCF | I2C_ICR_OVRCF | I2C_ICR_ARLOCF;
+        g_sl.errors++;
+        g_sl.rec.flags |= I2CSL_L_ERR;
+    }
+
+    // RXNE vor ADDR/STOP: letztes Datenbyte gehoert noch zum alten Abschnitt
+    if (isr & I2C_ISR_RXNE) {
+        i2csl_rx_byte((uint8_t)I2CSL_I2C->RXDR);
+    }
+
+    if (isr & I2C_ISR_NACKF) {
+        I2CSL_I2C->ICR = I2C_ICR_NACKCF;
+        g_sl.rec.flags |= I2CSL_L_NACK;
+        i2csl_tx_unwind(isr);
+        if (g_sl.state == I2CSL_TX) g_sl.state = I2CSL_IDLE;   // bis STOP/Repeated Start
+    }
+
+    if (isr & I2C_ISR_STOPF) {
+        I2CSL_I2C->ICR = I2C_ICR_STOPCF;
+        i2csl_tx_unwind(I2CSL_I2C->ISR);
+        i2csl_rec_close();
+        g_sl.state = I2CSL_IDLE;
+        I2CSL_I2C->ISR = I2C_ISR_TXE;
+        return;
+    }
+
+    if (isr & I2C_ISR_ADDR) {
+        i2csl_addr_match(isr);
+        return;
+    }
+
+    if (isr & I2C_ISR_TXIS) {
+        if (g_sl.state == I2CSL_TX) i2csl_tx_byte();
+        else I2CSL_I2C->TXDR = 0xFFu;       // nach NACK, wird beim naechsten ADDR verworfen
+    }
+}
+
+// ---------------- Start / Stop ----------------
+HAL_StatusTypeDef I2CSL_Start(const i2csl_cfg_t *cfg)
+{
+    if (!cfg || g_sl.active) return HAL_BUSY;
+    if (cfg->addr[0] > 0x7Fu) return HAL_ERROR;
+    if (cfg->addr[1] != I2CSL_ADDR_OFF && (cfg->addr[1] > 0x7Fu || cfg->addr[1] == cfg->addr[0])) {
+        return HAL_ERROR;
+    }
+    if (hi2c1.State != HAL_I2C_STATE_READY) return HAL_BUSY;
+
+    g_sl.cfg = *cfg;
+    if (cfg->addr[1] == I2CSL_ADDR_OFF) g_sl.cfg.a16[1] = 0u;
+    g_sl.state = I2CSL_IDLE;
+    g_sl.rec_open = 0u;
+    g_sl.ptr[0] = 0u;
+    g_sl.ptr[1] = 0u;
+    g_sl.reads = 0u;
+    g_sl.writes = 0u;
+    g_sl.rx_bytes = 0u;
+    g_sl.tx_bytes = 0u;
+    g_sl.ro_hits = 0u;
+    g_sl.errors = 0u;
+
+    hi2c1.State = HAL_I2C_STATE_LISTEN;
+
+    // OARx nur mit OAxEN = 0 aendern, NOSTRETCH/GCEN/SBC aus
+    CLEAR_BIT(I2CSL_I2C->CR1, I2C_CR1_PE);
+    CLEAR_BIT(I2CSL_I2C->CR1, I2C_CR1_NOSTRETCH | I2C_CR1_GCEN | I2C_CR1_SBC | I2C_CR1_TXDMAEN |
+                              I2C_CR1_RXDMAEN | I2C_CR1_TCIE | I2CSL_CR1_IRQS);
+    I2CSL_I2C->OAR1 = 0u;
+    I2CSL_I2C->OAR2 = 0u;
+    I2CSL_I2C->OAR1 = ((uint32_t)cfg->addr[0] << 1) | I2C_OAR1_OA1EN;
+    if (cfg->addr[1] != I2CSL_ADDR_OFF) {
+        I2CSL_I2C->OAR2 = ((uint32_t)cfg->addr[1] << 1) | I2C_OAR2_OA2EN;
+    }
+    I2CSL_I2C->CR2 = 0u;
+    SET_BIT(I2CSL_I2C->CR1, I2C_CR1_PE);
+
+    HAL_NVIC_SetPriority(I2C1_EV_IRQn, I2CSL_IRQ_PRIO, 0);
+    HAL_NVIC_SetPriority(I2C1_ER_IRQn, I2CSL_IRQ_PRIO, 0);
+    HAL_NVIC_EnableIRQ(I2C1_EV_IRQn);
+    HAL_NVIC_EnableIRQ(I2C1_ER_IRQn);
+
+    I2CSL_I2C->ICR = I2CSL_ICR_ALL;
+    g_sl.active = 1u;
+    SET_BIT(I2CSL_I2C->CR1, I2CSL_CR1_IRQS);
+    return HAL_OK;
+}
+
+void I2CSL_Stop(void)
+{
+    if (!g_sl.active) return;
+
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    CLEAR_BIT(I2CSL_I2C->CR1, I2CSL_CR1_IRQS);
+    CLEAR_BIT(I2CSL_I2C->CR1, I2C_CR1_PE);  // gibt SCL frei, falls gerade gestreckt
+    I2CSL_I2C->OAR1 = 0u;
+    I2CSL_I2C->OAR2 = 0u;
+    i2csl_rec_close();
+    g_sl.state = I2CSL_IDLE;
+    g_sl.active = 0u;
+    hi2c1.State = HAL_I2C_STATE_READY;
+    __set_PRIMASK(primask);
+    // Master Takt/Filter setzt der Aufrufer neu (I2CT_Apply -> HAL_I2C_Init)
+}
+
+uint8_t I2CSL_IsActive(void)
+{
+    return g_sl.active;
+}
+
+void I2CSL_PrintStatus(void)
+{
+    cli_printf("\r\ntarget: %s\r\n", g_sl.active ? "aktiv" : "aus");
+    for (uint8_t t = 0u; t < I2CSL_TARGETS; t++) {
+        if (!g_sl.active || g_sl.cfg.addr[t] == I2CSL_ADDR_OFF) continue;
+        cli_printf("  T%u @%02X  Zeiger %s  Fenster 0x%04lX..0x%04lX  ptr=0x%04X\r\n",
+                   (unsigned)t, (unsigned)g_sl.cfg.addr[t], g_sl.cfg.a16[t] ? "16 Bit" : "8 Bit",
+                   (unsigned long)I2CSL_TargetBase(t),
+                   (unsigned long)(I2CSL_TargetBase(t) + i2csl_mask(t)), (unsigned)g_sl.ptr[t]);
+    }
+    cli_printf("  Writes: %lu (%lu Bytes, %lu RO)  Reads: %lu (%lu Bytes)  Fehler: %lu\r\n",
+               (unsigned long)g_sl.writes, (unsigned long)g_sl.rx_bytes, (unsigned long)g_sl.ro_hits,
+               (unsigned long)g_sl.reads, (unsigned long)g_sl.tx_bytes, (unsigned long)g_sl.errors);
+    cli_printf("  Log: %u Eintraege, %lu ueberschrieben\r\n",
+               (unsigned)(uint16_t)(g_sl.log_head - g_sl.log_tail), (unsigned long)g_sl.log_over);
+}
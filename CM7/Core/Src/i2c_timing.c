@@ -0,0 +1,235 @@
+/*
+ * i2c_timing.c
+ *
+ *  TIMINGR solver for the I2C v2 peripheral (Standard/Fast/Fast-mode Plus).
+ */
+#include "i2c_timing.h"
+
+// ============================================================
+// I2C TIMING
+//
+//   - Rechnung nach RM0399 "I2C timings" in Pikosekunden, damit krumme
+//     Kernel Takte (HSI 64 MHz, PLL3) nicht auf ns gerundet werden
+//   - pro PRESC zuerst SCLDEL/SDADEL (Setup/Hold gegen tr/tf/Filter),
+//     dann SCLL/SCLH mit kleinstem Abstand zur Zielperiode
+//   - erreichte Frequenz nie ueber dem Ziel, nicht unter 80 %
+//   - Grenzwerte aus der I2C Spezifikation (UM10204, Tabelle 10)
+//   - ueber 400 kHz Fast-mode Plus: Treiber an SCL/SDA per SYSCFG
+//   - MspInit stellt den Kernel Takt auf PCLK (8 MHz); damit sind
+//     400 kHz mit Analogfilter und 1 MHz nicht spezifikationsgerecht ->
+//     Apply weicht auf HSI aus (I2C123 gilt auch fuer I2C2/3, ungenutzt)
+// ============================================================
+
+#define I2CT_PS_PER_NS        (1000u)
+#define I2CT_AF_MIN_PS        (50000)   // Analogfilter Verzoegerung
+#define I2CT_AF_MAX_PS        (260000)
+
+typedef struct {
+    uint32_t freq_max;
+    int32_t hddat_min;        // alle Zeiten in ps
+    int32_t vddat_max;
+    int32_t sudat_min;
+    int32_t low_min;
+    int32_t high_min;
+    int32_t rise_max;
+    int32_t fall_max;
+} i2ct_spec_t;
+
+static const i2ct_spec_t g_i2ct_spec[3] = {
+    // Standard-mode
+    { 100000u,  0, 3450000, 250000, 4700000, 4000000, 1000000, 300000 },
+    // Fast-mode
+    { 400000u,  0,  900000, 100000, 1300000,  600000,  300000, 300000 },
+    // Fast-mode Plus
+    { 1000000u, 0,  450000,  50000,  500000,  260000,  120000, 120000 },
+};
+
+void I2CT_DefaultCfg(i2ct_cfg_t *cfg, uint32_t freq_hz)
+{
+    if (!cfg) return;
+    cfg->freq_hz = freq_hz;
+    cfg->rise_ns = I2CT_RISE_NS_DEFAULT;
+    cfg->fall_ns = I2CT_FALL_NS_DEFAULT;
+    cfg->analog = 1u;
+    cfg->dnf = 0u;
+}
+
+static uint32_t i2ct_hsi_hz(void)
+{
+    return HSI_VALUE >> ((RCC->CR & RCC_CR_HSIDIV) >> RCC_CR_HSIDIV_Pos);
+}
+
+uint32_t I2CT_KernelHz(const I2C_TypeDef *inst)
+{
+    uint32_t sel;
+    PLL3_ClocksTypeDef pll3;
+
+    if (inst == I2C4) {
+        sel = (RCC->D3CCIPR & RCC_D3CCIPR_I2C4SEL) >> RCC_D3CCIPR_I2C4SEL_Pos;
+        if (sel == 0u) return HAL_RCCEx_GetD3PCLK1Freq();
+    } else {
+        sel = (RCC->D2CCIP2R & RCC_D2CCIP2R_I2C123SEL) >> RCC_D2CCIP2R_I2C123SEL_Pos;
+        if (sel == 0u) return HAL_RCC_GetPCLK1Freq();
+    }
+
+    switch (sel) {
+        case 1u:
+            HAL_RCCEx_GetPLL3ClockFreq(&pll3);
+            return pll3.PLL3_R_Frequency;
+        case 2u:
+            return i2ct_hsi_hz();
+        default:
+            return CSI_VALUE;
+    }
+}
+
+HAL_StatusTypeDef I2CT_Compute(uint32_t kernel_hz, const i2ct_cfg_t *cfg, i2ct_res_t *res)
+{
+    if (!cfg || !res || kernel_hz == 0u) return HAL_ERROR;
+    if (cfg->freq_hz < I2CT_FREQ_MIN_HZ || cfg->freq_hz > I2CT_FREQ_MAX_HZ) return HAL_ERROR;
+    if (cfg->dnf > I2CT_DNF_MAX) return HAL_ERROR;
+
+    const i2ct_spec_t *spec = &g_i2ct_spec[2];
+    if (cfg->freq_hz <= g_i2ct_spec[0].freq_max) spec = &g_i2ct_spec[0];
+    else if (cfg->freq_hz <= g_i2ct_spec[1].freq_max) spec = &g_i2ct_spec[1];
+
+    const int32_t rise = (int32_t)cfg->rise_ns * (int32_t)I2CT_PS_PER_NS;
+    const int32_t fall = (int32_t)cfg->fall_ns * (int32_t)I2CT_PS_PER_NS;
+    if (rise > spec->rise_max || fall > spec->fall_max) return HAL_ERROR;
+
+    const int32_t clk = (int32_t)(1000000000000ull / kernel_hz);
+    const int32_t af_min = cfg->analog ? I2CT_AF_MIN_PS : 0;
+    const int32_t af_max = cfg->analog ? I2CT_AF_MAX_PS : 0;
+    const int32_t dnf = (int32_t)cfg->dnf * clk;
+
+    // Datenhaltezeit (SDADEL) und Setupzeit (SCLDEL)
+    int32_t sdadel_min = spec->hddat_min + fall - af_min - ((int32_t)cfg->dnf + 3) * clk;
+    int32_t sdadel_max = spec->vddat_max - rise - af_max - ((int32_t)cfg->dnf + 4) * clk;
+    const int32_t scldel_min = rise + spec->sudat_min;
+    if (sdadel_min < 0) sdadel_min = 0;
+    if (sdadel_max < 0) sdadel_max = 0;
+
+    // Periodengrenzen: Ziel (kuerzeste) bis 80 % Frequenz (laengste)
+    const int32_t period = (int32_t)(1000000000000ull / cfg->freq_hz);
+    const int32_t period_max = (int32_t)((1000000000000ull * 100u) / ((uint64_t)cfg->freq_hz * I2CT_RATE_MIN_PCT));
+    const int32_t tsync = af_min + dnf + 2 * clk;
+
+    int32_t best_err = INT32_MAX;
+    i2ct_res_t best = { 0 };
+
+    for (uint32_t p = 0u; p < 16u; p++) {
+        const int32_t tpresc = (int32_t)(p + 1u) * clk;
+
+        int32_t l = 0;
+        while (l < 16 && (l + 1) * tpresc < scldel_min) l++;
+        if (l >= 16) continue;
+
+        int32_t a = 0;
+        while (a < 16) {
+            int32_t t = a * tpresc + clk;
+            if (t >= sdadel_min && t <= sdadel_max) break;
+            if (t > sdadel_max) { a = 16; break; }
+            a++;
+        }
+        if (a >= 16) continue;
+
+        for (int32_t lo = 0; lo < 256; lo++) {
+            const int32_t t_low = (lo + 1) * tpresc + tsync;
+            if (t_low < spec->low_min) continue;
+            if (clk >= (t_low - af_min - dnf) / 4) continue;
+            if (t_low + tsync + rise + fall > period_max) break;
+
+            for (int32_t hi = 0; hi < 256; hi++) {
+                const int32_t t_high = (hi + 1) * tpresc + tsync;
+                const int32_t t_scl = t_low + t_high + rise + fall;
+                if (t_scl > period_max) break;
+                if (t_scl < period || t_high < spec->high_min || clk >= t_high) continue;
+
+                const int32_t err = t_scl - period;
+                if (err < best_err) {
+                    best_err = err;
+                    best.presc = (uint8_t)p;
+                    best.scldel = (uint8_t)l;
+                    best.sdadel = (uint8_t)a;
+                    best.scll = (uint8_t)lo;
+                    best.sclh = (uint8_t)hi;
+                    best.t_low_ns = (uint32_t)t_low / I2CT_PS_PER_NS;
+                    best.t_high_ns = (uint32_t)t_high / I2CT_PS_PER_NS;
+                    best.actual_hz = (uint32_t)(1000000000000ull / (uint32_t)t_scl);
+                }
+                break;          // hoeheres SCLH wird nur laenger
+            }
+        }
+    }
+
+    if (best_err == INT32_MAX) return HAL_ERROR;
+
+    best.kernel_hz = kernel_hz;
+    best.analog = cfg->analog ? 1u : 0u;
+    best.fmp = (spec == &g_i2ct_spec[2]) ? 1u : 0u;
+    best.timingr = ((uint32_t)best.presc << I2C_TIMINGR_PRESC_Pos) |
+                   ((uint32_t)best.scldel << I2C_TIMINGR_SCLDEL_Pos) |
+                   ((uint32_t)best.sdadel << I2C_TIMINGR_SDADEL_Pos) |
+                   ((uint32_t)best.sclh << I2C_TIMINGR_SCLH_Pos) |
+                   ((uint32_t)best.scll << I2C_TIMINGR_SCLL_Pos);
+    *res = best;
+    return HAL_OK;
+}
+
+static uint32_t i2ct_fmp_bits(const I2C_TypeDef *inst)
+{
+    if (inst == I2C4) return I2C_FASTMODEPLUS_I2C4 | I2C_FASTMODEPLUS_PB6 | I2C_FASTMODEPLUS_PB7;
+    return I2C_FASTMODEPLUS_I2C1 | I2C_FASTMODEPLUS_PB8 | I2C_FASTMODEPLUS_PB9;
+}
+
+// kern[0]: Kernel Takt wie er gerade am Mux steht (nach HAL_I2C_Init: PCLK)
+static HAL_StatusTypeDef i2ct_solve(const I2C_TypeDef *inst, const i2ct_cfg_t *cfg, i2ct_res_t *res)
+{
+    uint32_t kern[2] = { I2CT_KernelHz(inst), 0u };
+    if (RCC->CR & RCC_CR_HSIRDY) kern[1] = i2ct_hsi_hz();
+
+    i2ct_cfg_t c = *cfg;
+    for (uint32_t pass = 0u; pass < 2u; pass++) {
+        for (uint32_t k = 0u; k < 2u; k++) {
+            if (kern[k] == 0u) continue;
+            if (I2CT_Compute(kern[k], &c, res) == HAL_OK) {
+                res->hsi = (k == 1u) ? 1u : 0u;
+                return HAL_OK;
+            }
+        }
+        if (!c.analog) break;
+        c.analog = 0u;
+    }
+    return HAL_ERROR;
+}
+
+HAL_StatusTypeDef I2CT_Apply(I2C_HandleTypeDef *hi2c, const i2ct_cfg_t *cfg, i2ct_res_t *res)
+{
+    if (!hi2c || !cfg || !res) return HAL_ERROR;
+
+    // zuerst Init: MspInit setzt Pins und Kernel Mux, danach wird der
+    // tatsaechliche Takt aus RCC gelesen und nicht angenommen
+    (void)HAL_I2C_DeInit(hi2c);
+    HAL_StatusTypeDef st = HAL_I2C_Init(hi2c);
+    if (st != HAL_OK) return st;
+
+    st = i2ct_solve(hi2c->Instance, cfg, res);
+    if (st != HAL_OK) return st;
+
+    // TIMINGR und Kernel Mux nur bei PE = 0
+    __HAL_I2C_DISABLE(hi2c);
+    hi2c->Init.Timing = res->timingr;
+    hi2c->Instance->TIMINGR = res->timingr;
+    if (res->hsi) {
+        if (hi2c->Instance == I2C4) __HAL_RCC_I2C4_CONFIG(RCC_I2C4CLKSOURCE_HSI);
+        else __HAL_RCC_I2C123_CONFIG(RCC_I2C123CLKSOURCE_HSI);
+    }
+    __HAL_I2C_ENABLE(hi2c);
+
+    st = HAL_I2CEx_ConfigAnalogFilter(hi2c, res->analog ? I2C_ANALOGFILTER_ENABLE : I2C_ANALOGFILTER_DISABLE);
+    if (st == HAL_OK) st = HAL_I2CEx_ConfigDigitalFilter(hi2c, cfg->dnf);
+
+    if (res->fmp) HAL_I2CEx_EnableFastModePlus(i2ct_fmp_bits(hi2c->Instance));
+    else HAL_I2CEx_DisableFastModePlus(i2ct_fmp_bits(hi2c->Instance));
+    return st;
+}
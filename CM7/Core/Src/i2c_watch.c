@@ -0,0 +1,539 @@
+/*
+ * i2c_watch.c
+ *
+ *  Timer-scheduled I2C1 register watch list with change detection.
+ */
+#include "i2c_watch.h"
+#include "i2c_recover.h"
+#include "usb_stream.h"
+#include "cli.h"
+#include "tim.h"
+#include <string.h>
+#include <stdio.h>
+
+extern I2C_HandleTypeDef hi2c1;
+
+// ============================================================
+// I2C WATCH (I2C1 Master, Registerbeobachtung)
+//
+//   - bis zu I2CW_ENTRIES Eintraege (Adresse, Register, Laenge, Periode)
+//   - TIM7 tickt alle I2CW_TICK_US und markiert faellige Eintraege;
+//     die Lesungen laufen danach direkt hintereinander im I2C1 IRQ
+//     (Register schreiben, Repeated Start, lesen, AUTOEND), ohne Umweg
+//     ueber die Superloop -> bei 1 MHz einige 10k Lesungen/s
+//   - Vergleich mit der Schattenkopie im IRQ; nur Aenderungen (und
+//     optional jedes N-te Sample) gehen in die Ereignis-Queue
+//   - Periode 0 = Dauerlauf, fuellt die Luecken zwischen faelligen
+//     Eintraegen; Eintrag noch faellig beim naechsten Termin -> missed
+//   - eigener Zustandsautomat statt i2c_queue.c: die Queue liefert jedes
+//     Ergebnis an die Superloop, hier bleibt alles Unveraenderte im IRQ.
+//     Bus exklusiv: Start nur bei leerer Queue, hi2c1.State = BUSY
+// ============================================================
+
+#define I2CW_I2C              I2C1
+#define I2CW_TIM              TIM7
+#define I2CW_TIM_CLK_HZ       (16000000u)   // TIM7: 2 x PCLK1
+#define I2CW_CR1_IRQS         (I2C_CR1_TXIE | I2C_CR1_RXIE | I2C_CR1_TCIE | I2C_CR1_STOPIE | \
+                               I2C_CR1_NACKIE | I2C_CR1_ERRIE)
+#define I2CW_ICR_ALL          (I2C_ICR_NACKCF | I2C_ICR_STOPCF | I2C_ICR_BERRCF | I2C_ICR_ARLOCF | \
+                               I2C_ICR_OVRCF | I2C_ICR_TIMOUTCF)
+#define I2CW_NONE             (0xFFu)
+#define I2CW_HEX_LINE_MAX     (48u)
+
+typedef struct {
+    uint8_t used;
+    uint8_t addr;
+    uint8_t reg_len;
+    uint8_t len;
+    uint16_t reg;
+    uint32_t period_us;
+    uint32_t next_due;              // TIM2 us
+    uint32_t dcnt;
+    uint8_t valid;                  // shadow gueltig
+    uint8_t err;                    // letzte Lesung fehlgeschlagen
+    uint8_t shadow[I2CW_LEN_MAX];
+    uint32_t reads;
+    uint32_t changes;
+    uint32_t errors;
+    uint32_t missed;
+} i2cw_entry_t;
+
+typedef struct {
+    uint32_t t_us;
+    uint8_t idx;
+    uint8_t flags;
+    uint8_t len;
+    uint8_t data[I2CW_LEN_MAX];
+} i2cw_event_t;
+
+typedef struct {
+    volatile uint8_t active;
+    volatile uint8_t busy;          // Lesung laeuft
+    uint8_t cur;
+    uint8_t phase;                  // 0 = Register schreiben, 1 = lesen
+    uint8_t pos;
+    uint8_t status;                 // I2CW_F_ERR (| I2CW_F_NACK) waehrend der Lesung
+    uint8_t rr;                     // Round Robin Startpunkt
+    uint8_t lost_flag;
+    volatile uint32_t pending;      // faellig, Bit pro Eintrag
+    uint32_t cont;                  // Periode 0
+    uint32_t tick0;                 // HAL Tick beim Start der Lesung
+    uint8_t rx[I2CW_LEN_MAX];
+
+    volatile uint16_t ev_head;
+    volatile uint16_t ev_tail;
+    uint32_t ev_lost;
+    uint32_t usb_wait;
+    uint32_t timeouts;
+    uint32_t t_run;                 // Startzeit fuer die Rate
+    uint32_t reads;
+} i2cw_ctx_t;
+
+static i2cw_entry_t g_i2cw[I2CW_ENTRIES];
+static i2cw_event_t g_i2cw_ev[I2CW_EVQ_SIZE];
+static i2cw_ctx_t g_w;
+static uint32_t g_i2cw_decim = 0u;
+static i2cw_fmt_t g_i2cw_fmt = I2CW_FMT_HEX;
+
+// ---------------- Liste ----------------
+int I2CW_Add(uint8_t addr, uint16_t reg, uint8_t reg_len, uint8_t len, uint32_t period_us)
+{
+    if (g_w.active) return -1;
+    if (addr > 0x7Fu || reg_len > 2u || len == 0u || len > I2CW_LEN_MAX) return -1;
+    if (reg_len == 1u && reg > 0xFFu) return -1;
+
+    for (uint8_t i = 0u; i < I2CW_ENTRIES; i++) {
+        i2cw_entry_t *e = &g_i2cw[i];
+        if (e->used) continue;
+
+        memset(e, 0, sizeof(*e));
+        e->used = 1u;
+        e->addr = addr;
+        e->reg = reg;
+        e->reg_len = reg_len;
+        e->len = len;
+        if (period_us != 0u && period_us < I2CW_TICK_US) period_us = I2CW_TICK_US;
+        e->period_us = ((period_us + I2CW_TICK_US / 2u) / I2CW_TICK_US) * I2CW_TICK_US;
+        return (int)i;
+    }
+    return -1;
+}
+
+HAL_StatusTypeDef I2CW_Del(uint8_t idx)
+{
+    if (g_w.active) return HAL_BUSY;
+    if (idx >= I2CW_ENTRIES || !g_i2cw[idx].used) return HAL_ERROR;
+    g_i2cw[idx].used = 0u;
+    return HAL_OK;
+}
+
+void I2CW_Clear(void)
+{
+    I2CW_Stop();
+    memset(g_i2cw, 0, sizeof(g_i2cw));
+}
+
+void I2CW_SetDecim(uint32_t dec)
+{
+    g_i2cw_decim = dec;
+}
+
+void I2CW_SetFormat(i2cw_fmt_t fmt)
+{
+    g_i2cw_fmt = fmt;
+}
+
+uint8_t I2CW_IsActive(void)
+{
+    // busy: nach Stop laeuft die letzte Lesung noch, IRQ gehoert uns
+    return (g_w.active || g_w.busy) ? 1u : 0u;
+}
+
+// ---------------- ISR Seite ----------------
+static void i2cw_push(uint8_t idx, uint8_t flags, const uint8_t *data, uint8_t len)
+{
+    if ((uint16_t)(g_w.ev_head - g_w.ev_tail) >= I2CW_EVQ_SIZE) {
+        g_w.ev_lost++;
+        g_w.lost_flag = 1u;
+        return;
+    }
+
+    i2cw_event_t *ev = &g_i2cw_ev[g_w.ev_head & (I2CW_EVQ_SIZE - 1u)];
+    ev->t_us = TIM_Micros();
+    ev->idx = idx;
+    ev->flags = flags;
+    if (g_w.lost_flag) {
+        ev->flags |= I2CW_F_LOST;
+        g_w.lost_flag = 0u;
+    }
+    ev->len = len;
+    if (len) memcpy(ev->data, data, len);
+    g_w.ev_head++;
+}
+
+static void i2cw_phase_start(void)
+{
+    const i2cw_entry_t *e = &g_i2cw[g_w.cur];
+
+    g_w.pos = 0u;
+    if (g_w.phase == 0u) {
+        // Registeradresse, danach TC -> Repeated Start
+        I2CW_I2C->CR2 = ((uint32_t)e->addr << 1) |
+                        ((uint32_t)e->reg_len << I2C_CR2_NBYTES_Pos) |
+                        I2C_CR2_START;
+    } else {
+        I2CW_I2C->CR2 = ((uint32_t)e->addr << 1) | I2C_CR2_RD_WRN |
+                        ((uint32_t)e->len << I2C_CR2_NBYTES_Pos) |
+                        I2C_CR2_AUTOEND | I2C_CR2_START;
+    }
+}
+
+static uint8_t i2cw_pick(void)
+{
+    uint32_t m = g_w.pending;
+    if (m == 0u) m = g_w.cont;
+    if (m == 0u) return I2CW_NONE;
+
+    for (uint8_t k = 0u; k < I2CW_ENTRIES; k++) {
+        uint8_t i = (uint8_t)((g_w.rr + k) % I2CW_ENTRIES);
+        if (m & (1u << i)) {
+            g_w.rr = (uint8_t)((i + 1u) % I2CW_ENTRIES);
+            return i;
+        }
+    }
+    return I2CW_NONE;
+}
+
+// naechste Lesung starten (IRQ Kontext oder gesperrt)
+static void i2cw_kick(void)
+{
+    if (!g_w.active || g_w.busy) return;
+
+    uint8_t i = i2cw_pick();
+    if (i == I2CW_NONE) return;
+
+    g_w.pending &= ~(1u << i);
+    g_w.cur = i;
+    g_w.phase = g_i2cw[i].reg_len ? 0u : 1u;
+    g_w.status = 0u;
+    g_w.busy = 1u;
+    g_w.tick0 = HAL_GetTick();
+
+    I2CW_I2C->ICR = I2CW_ICR_ALL;
+    I2CW_I2C->ISR = I2C_ISR_TXE;
+    i2cw_phase_start();
+}
+
+static void i2cw_done(void)
+{
+    i2cw_entry_t *e = &g_i2cw[g_w.cur];
+
+    g_w.busy = 0u;
+    g_w.reads++;
+    e->reads++;
+
+    if (g_w.status) {
+        e->errors++;
+        e->valid = 0u;
+        if (!e->err) i2cw_push(g_w.cur, g_w.status, NULL, 0u);
+        e->err = 1u;
+    } else {
+        uint8_t flags = 0u;
+
+        e->err = 0u;
+        if (!e->valid || memcmp(e->shadow, g_w.rx, e->len) != 0) {
+            memcpy(e->shadow, g_w.rx, e->len);
+            e->valid = 1u;
+            e->changes++;
+            flags |= I2CW_F_CHG;
+        }
+        if (g_i2cw_decim && ++e->dcnt >= g_i2cw_decim) {
+            e->dcnt = 0u;
+            flags |= I2CW_F_SMP;
+        }
+        if (flags) i2cw_push(g_w.cur, flags, g_w.rx, e->len);
+    }
+    i2cw_kick();
+}
+
+void I2CW_IRQHandler(void)
+{
+    if (!g_w.busy) {
+        I2CW_I2C->ICR = I2CW_ICR_ALL;
+        return;
+    }
+
+    const i2cw_entry_t *e = &g_i2cw[g_w.cur];
+    uint32_t isr = I2CW_I2C->ISR;
+
+    if (isr & (I2C_ISR_ARLO | I2C_ISR_BERR)) {
+        // Controller haengt: PE = 0 setzt die State Machine zurueck
+        I2CR_ResetPE(I2CW_I2C, (isr & I2C_ISR_ARLO) ? I2CR_CAUSE_ARLO : I2CR_CAUSE_BERR);
+        g_w.status = I2CW_F_ERR;
+        i2cw_done();
+        return;
+    }
+
+    if (isr & I2C_ISR_NACKF) {
+        I2CW_I2C->ICR = I2C_ICR_NACKCF;
+        g_w.status = I2CW_F_ERR | I2CW_F_NACK;
+        if (g_w.phase == 0u) I2CW_I2C->CR2 |= I2C_CR2_STOP;
+    }
+
+    // RXNE vor STOPF: mit AUTOEND folgt der STOP ~1 us auf das letzte Byte,
+    // beide Flags stehen oft gleichzeitig an; RXDR muss leer sein, bevor
+    // die naechste Lesung startet
+    if (isr & I2C_ISR_RXNE) {
+        uint8_t b = (uint8_t)I2CW_I2C->RXDR;
+        if (g_w.phase == 1u) {
+            if (g_w.pos < I2CW_LEN_MAX) g_w.rx[g_w.pos] = b;
+            g_w.pos++;
+        }
+    }
+
+    if (isr & I2C_ISR_STOPF) {
+        I2CW_I2C->ICR = I2C_ICR_STOPCF;
+        // zu wenige Bytes (STOP ohne NACK, z.B. Busfehler am Slave): kein Wert
+        if (g_w.phase != 1u || g_w.pos != e->len) g_w.status |= I2CW_F_ERR;
+        i2cw_done();
+        return;
+    }
+
+    if ((isr & I2C_ISR_TXIS) && g_w.phase == 0u) {
+        uint8_t b = (e->reg_len == 2u && g_w.pos == 0u) ? (uint8_t)(e->reg >> 8) : (uint8_t)e->reg;
+        I2CW_I2C->TXDR = b;
+        g_w.pos++;
+    }
+
+    if ((isr & I2C_ISR_TC) && g_w.phase == 0u) {
+        g_w.phase = 1u;
+        i2cw_phase_start();
+    }
+}
+
+void I2CW_TimerIRQHandler(void)
+{
+    if ((I2CW_TIM->SR & TIM_SR_UIF) == 0u) return;
+    I2CW_TIM->SR = ~(uint32_t)TIM_SR_UIF;
+    if (!g_w.active) return;
+
+    uint32_t now = TIM_Micros();
+    for (uint8_t i = 0u; i < I2CW_ENTRIES; i++) {
+        i2cw_entry_t *e = &g_i2cw[i];
+        if (!e->used || e->period_us == 0u) continue;
+        if ((int32_t)(now - e->next_due) < 0) continue;
+
+        if (g_w.pending & (1u << i)) e->missed++;
+        g_w.pending |= (1u << i);
+        e->next_due += e->period_us;
+        // weit hinterher (Bus langsamer als die Summe der Perioden): neu aufsetzen
+        if ((int32_t)(now - e->next_due) >= 0) e->next_due = now + e->period_us;
+    }
+    i2cw_kick();
+}
+
+// ---------------- Start / Stop ----------------
+HAL_StatusTypeDef I2CW_Start(void)
+{
+    uint32_t now = TIM_Micros();
+    uint8_t n = 0u;
+
+    if (g_w.active) return HAL_OK;
+    if (hi2c1.State != HAL_I2C_STATE_READY) return HAL_BUSY;
+
+    memset(&g_w, 0, sizeof(g_w));
+    for (uint8_t i = 0u; i < I2CW_ENTRIES; i++) {
+        i2cw_entry_t *e = &g_i2cw[i];
+        if (!e->used) continue;
+        e->valid = 0u;
+        e->err = 0u;
+        e->dcnt = 0u;
+        e->reads = 0u;
+        e->changes = 0u;
+        e->errors = 0u;
+        e->missed = 0u;
+        e->next_due = now;
+        if (e->period_us == 0u) g_w.cont |= (1u << i);
+        n++;
+    }
+    if (n == 0u) return HAL_ERROR;
+
+    hi2c1.State = HAL_I2C_STATE_BUSY;
+    HAL_NVIC_SetPriority(I2C1_EV_IRQn, I2CW_IRQ_PRIO, 0);
+    HAL_NVIC_SetPriority(I2C1_ER_IRQn, I2CW_IRQ_PRIO, 0);
+    HAL_NVIC_EnableIRQ(I2C1_EV_IRQn);
+    HAL_NVIC_EnableIRQ(I2C1_ER_IRQn);
+    SET_BIT(I2CW_I2C->CR1, I2CW_CR1_IRQS);
+
+    __HAL_RCC_TIM7_CLK_ENABLE();
+    I2CW_TIM->CR1 = 0u;
+    I2CW_TIM->PSC = (I2CW_TIM_CLK_HZ / 1000000u) - 1u;
+    I2CW_TIM->ARR = I2CW_TICK_US - 1u;
+    I2CW_TIM->CNT = 0u;
+    SET_BIT(I2CW_TIM->CR1, TIM_CR1_URS);
+    I2CW_TIM->EGR = TIM_EGR_UG;
+    I2CW_TIM->SR = 0u;
+    I2CW_TIM->DIER = TIM_DIER_UIE;
+    HAL_NVIC_SetPriority(TIM7_IRQn, I2CW_IRQ_PRIO, 0);
+    HAL_NVIC_EnableIRQ(TIM7_IRQn);
+
+    g_w.t_run = now;
+    g_w.active = 1u;
+    SET_BIT(I2CW_TIM->CR1, TIM_CR1_CEN);
+    return HAL_OK;
+}
+
+void I2CW_Stop(void)
+{
+    if (!g_w.active) return;
+
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    g_w.active = 0u;
+    I2CW_TIM->DIER = 0u;
+    CLEAR_BIT(I2CW_TIM->CR1, TIM_CR1_CEN);
+    __set_PRIMASK(primask);
+    HAL_NVIC_DisableIRQ(TIM7_IRQn);
+
+    // laufende Lesung noch zu Ende (AUTOEND), sonst hart zuruecksetzen
+    uint32_t t0 = HAL_GetTick();
+    while (g_w.busy && (HAL_GetTick() - t0) <= I2CW_XFER_TIMEOUT_MS) { }
+    primask = __get_PRIMASK();
+    __disable_irq();
+    if (g_w.busy) {
+        I2CR_ResetPE(I2CW_I2C, I2CR_CAUSE_TIMEOUT);
+        g_w.busy = 0u;
+    }
+    CLEAR_BIT(I2CW_I2C->CR1, I2CW_CR1_IRQS);
+    I2CW_I2C->ICR = I2CW_ICR_ALL;
+    hi2c1.State = HAL_I2C_STATE_READY;
+    __set_PRIMASK(primask);
+}
+
+// ---------------- Ausgabe ----------------
+static uint16_t i2cw_record_size(uint8_t n)
+{
+    if (g_i2cw_fmt == I2CW_FMT_BIN) return (uint16_t)(I2CW_HDR_LEN + n);
+    return (uint16_t)(I2CW_HEX_LINE_MAX + n * 3u + 2u);
+}
+
+static void i2cw_emit(const i2cw_event_t *ev)
+{
+    const i2cw_entry_t *e = &g_i2cw[ev->idx];
+
+    if (g_i2cw_fmt == I2CW_FMT_BIN) {
+        uint8_t hdr[I2CW_HDR_LEN];
+        hdr[0] = I2CW_SYNC;
+        hdr[1] = ev->flags;
+        hdr[2] = (uint8_t)ev->t_us;
+        hdr[3] = (uint8_t)(ev->t_us >> 8);
+        hdr[4] = (uint8_t)(ev->t_us >> 16);
+        hdr[5] = (uint8_t)(ev->t_us >> 24);
+        hdr[6] = ev->idx;
+        hdr[7] = e->addr;
+        hdr[8] = (uint8_t)e->reg;
+        hdr[9] = (uint8_t)(e->reg >> 8);
+        hdr[10] = ev->len;
+        hdr[11] = 0u;
+        (void)USBS_Write(hdr, I2CW_HDR_LEN);
+        if (ev->len) (void)USBS_Write(ev->data, ev->len);
+        return;
+    }
+
+    char line[I2CW_HEX_LINE_MAX];
+    char fs[5];
+    uint8_t k = 0u;
+    if (ev->flags & I2CW_F_CHG)  fs[k++] = 'C';
+    if (ev->flags & I2CW_F_SMP)  fs[k++] = 'S';
+    if (ev->flags & I2CW_F_ERR)  fs[k++] = 'E';
+    if (ev->flags & I2CW_F_LOST) fs[k++] = 'L';
+    fs[k] = '\0';
+
+    int len;
+    if (e->reg_len == 2u) {
+        len = snprintf(line, sizeof(line), "W%02u %10lu @%02X r%04X %-3s", (unsigned)ev->idx,
+                       (unsigned long)ev->t_us, (unsigned)e->addr, (unsigned)e->reg, fs);
+    } else if (e->reg_len == 1u) {
+        len = snprintf(line, sizeof(line), "W%02u %10lu @%02X r%02X   %-3s", (unsigned)ev->idx,
+                       (unsigned long)ev->t_us, (unsigned)e->addr, (unsigned)e->reg, fs);
+    } else {
+        len = snprintf(line, sizeof(line), "W%02u %10lu @%02X r--   %-3s", (unsigned)ev->idx,
+                       (unsigned long)ev->t_us, (unsigned)e->addr, fs);
+    }
+    (void)USBS_Write((const uint8_t *)line, (uint16_t)len);
+
+    if (ev->flags & I2CW_F_NACK) {
+        (void)USBS_Write((const uint8_t *)" NACK", 5u);
+    } else if (ev->flags & I2CW_F_ERR) {
+        (void)USBS_Write((const uint8_t *)" ERR", 4u);
+    }
+    for (uint8_t i = 0u; i < ev->len; i++) {
+        len = snprintf(line, sizeof(line), " %02X", ev->data[i]);
+        (void)USBS_Write((const uint8_t *)line, (uint16_t)len);
+    }
+    (void)USBS_Write((const uint8_t *)"\r\n", 2u);
+}
+
+void I2CW_Poll(void)
+{
+    if (g_w.active && g_w.busy && (HAL_GetTick() - g_w.tick0) > I2CW_XFER_TIMEOUT_MS) {
+        uint32_t primask = __get_PRIMASK();
+        __disable_irq();
+        if (g_w.busy && (HAL_GetTick() - g_w.tick0) > I2CW_XFER_TIMEOUT_MS) {
+            I2CR_ResetPE(I2CW_I2C, I2CR_CAUSE_TIMEOUT);
+            SET_BIT(I2CW_I2C->CR1, I2CW_CR1_IRQS);
+            g_w.timeouts++;
+            g_w.status = I2CW_F_ERR;
+            i2cw_done();
+        }
+        __set_PRIMASK(primask);
+    }
+
+    while (g_w.ev_tail != g_w.ev_head) {
+        const i2cw_event_t *ev = &g_i2cw_ev[g_w.ev_tail & (I2CW_EVQ_SIZE - 1u)];
+        if (USBS_Free() < i2cw_record_size(ev->len)) {
+            g_w.usb_wait++;
+            break;
+        }
+        i2cw_emit(ev);
+        g_w.ev_tail++;
+    }
+}
+
+void I2CW_PrintList(void)
+{
+    uint8_t n = 0u;
+
+    cli_printf("\r\nWatch: %s  dec=%lu  fmt=%s  Raster %u us\r\n", g_w.active ? "laeuft" : "aus",
+               (unsigned long)g_i2cw_decim, (g_i2cw_fmt == I2CW_FMT_BIN) ? "bin" : "hex",
+               (unsigned)I2CW_TICK_US);
+    for (uint8_t i = 0u; i < I2CW_ENTRIES; i++) {
+        const i2cw_entry_t *e = &g_i2cw[i];
+        if (!e->used) continue;
+        n++;
+        if (e->reg_len == 0u) cli_printf("  #%02u @%02X r--   ", (unsigned)i, (unsigned)e->addr);
+        else if (e->reg_len == 1u) cli_printf("  #%02u @%02X r%02X   ", (unsigned)i, (unsigned)e->addr, (unsigned)e->reg);
+        else cli_printf("  #%02u @%02X r%04X ", (unsigned)i, (unsigned)e->addr, (unsigned)e->reg);
+        if (e->period_us == 0u) cli_printf("len=%-2u  Dauerlauf\r\n", (unsigned)e->len);
+        else cli_printf("len=%-2u  %lu us\r\n", (unsigned)e->len, (unsigned long)e->period_us);
+    }
+    if (n == 0u) cli_printf("  (leer)\r\n");
+}
+
+void I2CW_PrintStats(void)
+{
+    uint32_t us = TIM_Micros() - g_w.t_run;
+    uint32_t rate = (us > 0u) ? (uint32_t)(((uint64_t)g_w.reads * 1000000u) / us) : 0u;
+
+    cli_printf("\r\nWatch: %s  reads=%lu (%lu/s)  ev_lost=%lu  usb_wait=%lu  timeouts=%lu\r\n",
+               g_w.active ? "laeuft" : "aus", (unsigned long)g_w.reads,
+               (unsigned long)(g_w.active ? rate : 0u), (unsigned long)g_w.ev_lost,
+               (unsigned long)g_w.usb_wait, (unsigned long)g_w.timeouts);
+    for (uint8_t i = 0u; i < I2CW_ENTRIES; i++) {
+        const i2cw_entry_t *e = &g_i2cw[i];
+        if (!e->used) continue;
+        cli_printf("  #%02u reads=%lu changes=%lu err=%lu missed=%lu\r\n", (unsigned)i,
+                   (unsigned long)e->reads, (unsigned long)e->changes,
+                   (unsigned long)e->errors, (unsigned long)e->missed);
+    }
+}
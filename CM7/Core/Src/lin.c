@@ -0,0 +1,712 @@
+/*
+ * lin.c
+ *
+ *  LIN master (schedule table), slave responder and bus monitor on a UART.
+ */
+#include "lin.h"
+#include "usb_stream.h"
+#include "tim.h"
+#include "cli.h"
+#include <string.h>
+#include <stdio.h>
+
+// ============================================================
+// LIN
+//
+// - USART im LIN Mode (uart_stream.c): Break-Erkennung (LBD) und
+//   Receiver Timeout = 1 Bit kommen als RX Events mit TIM2 Stempel; alle
+//   Bytes zwischen zwei Events liegen lueckenlos hintereinander, daraus
+//   ergibt sich der Zeitstempel jedes einzelnen Bytes (Sync, PID, Daten)
+// - Das Break-Zeichen (0x00 + FE) ist immer das letzte Byte vor dem
+//   Break-Event und wird verworfen
+// - Master: TIM6 Update = Slot Start, Header (Break + Sync + PID) bzw.
+//   ganzer Frame direkt aus der ISR; ARR/PSC sind gepuffert und werden
+//   eine Slot-Laenge im Voraus geschrieben -> Jitter = ISR Latenz
+// - Slave: erstes RTO nach dem Break (1 Bit nach dem Stoppbit der PID)
+//   liest Sync + PID direkt aus dem RX Ring und schreibt die Antwort noch
+//   in der UART ISR in den TX Ring -> Antwortpause = RTO + ISR Latenz,
+//   unabhaengig von Superloop und CLI Ausgaben; Monitor/Statistik weiter
+//   ueber LIN_Poll
+// - Checksumme classic/enhanced auf dem Geraet; der Monitor prueft auch
+//   Frames mit unbekannter Laenge (letztes Byte = Checksumme)
+// ============================================================
+
+#define LIN_EVQ_SIZE          (32u)
+#define LIN_SLOT_NONE         (0xFFu)
+#define LIN_RESP_TIMEOUT_CH   (6u)       // Ruhe nach dem letzten Byte in Zeichen
+#define LIN_BREAK_BITS        (11u)      // LBDL = 11 Bit Erkennung
+
+typedef struct {
+    uint8_t type;          // UARTS_EV_RTO / UARTS_EV_BREAK
+    uint32_t head;
+    uint32_t t_us;
+} lin_event_t;
+
+typedef struct {
+    uint8_t used;
+    uint8_t id;
+    uint8_t dir;
+    uint8_t len;
+    uint8_t cs;
+    uint32_t slot_us;
+    uint8_t data[LIN_DATA_MAX];
+    uint32_t ok;
+    uint32_t err;
+    uint32_t no_resp;
+} lin_sched_t;
+
+typedef struct {
+    uint8_t used;
+    uint8_t id;
+    uint8_t len;
+    uint8_t cs;
+    uint8_t data[LIN_DATA_MAX];
+    uint32_t hits;
+} lin_slave_t;
+
+typedef enum {
+    LIN_F_SYNC = 0,
+    LIN_F_PID,
+    LIN_F_DATA,
+} lin_fstate_t;
+
+typedef struct {
+    uint8_t open;
+    lin_fstate_t state;
+    uint8_t pid;
+    uint8_t pid_ok;
+    int8_t expect;         // Datenlaenge, -1 = unbekannt
+    uint8_t cs;
+    uint8_t n;             // Bytes nach der PID (Daten + Checksumme)
+    uint8_t buf[LIN_DATA_MAX + 1u];
+    uint32_t t_brk;
+    uint32_t t_sync;
+    uint32_t t_pid;
+    uint32_t t_first;
+    uint32_t t_last;
+} lin_frame_t;
+
+typedef struct {
+    uint32_t frames;
+    uint32_t ok;
+    uint32_t cs_err;
+    uint32_t no_resp;
+    uint32_t sync_err;
+    uint32_t pid_err;
+    uint32_t stray;
+    uint32_t slave_tx;
+    uint32_t evq_lost;
+    uint32_t usb_drop;
+} lin_stats_t;
+
+static volatile lin_event_t g_lin_evq[LIN_EVQ_SIZE];
+static volatile uint8_t g_lin_evq_head = 0u;
+static volatile uint8_t g_lin_evq_tail = 0u;
+
+static uint8_t g_lin_active = 0u;
+static uarts_ch_t g_lin_ch = UARTS_CH_UART8;
+static uint8_t g_lin_mon = 1u;
+static uint32_t g_lin_bit_q4 = 0u;       // 1/16 us
+static uint32_t g_lin_char_q4 = 0u;
+
+static lin_sched_t g_lin_sched[LIN_SCHED_MAX];
+static volatile uint8_t g_lin_sched_run = 0u;
+static volatile uint8_t g_lin_slot = LIN_SLOT_NONE;
+static lin_slave_t g_lin_slave[LIN_SLAVE_MAX];
+
+static lin_frame_t g_lin_frame;
+static lin_stats_t g_lin_stats;
+
+static uint32_t g_lin_isr_brk_head = 0u;  // RX Position beim letzten Break
+static uint8_t g_lin_isr_hdr = 0u;        // Break gesehen, noch kein RTO
+
+uint8_t LIN_Pid(uint8_t id)
+{
+    id &= 0x3Fu;
+    uint8_t p0 = (uint8_t)(((id >> 0) ^ (id >> 1) ^ (id >> 2) ^ (id >> 4)) & 1u);
+    uint8_t p1 = (uint8_t)(~((id >> 1) ^ (id >> 3) ^ (id >> 4) ^ (id >> 5)) & 1u);
+    return (uint8_t)(id | (p0 << 6) | (p1 << 7));
+}
+
+uint8_t LIN_Checksum(uint8_t pid, const uint8_t *data, uint8_t len, lin_cs_t cs)
+{
+    // Diagnose-Frames (0x3C..0x3F) immer classic
+    uint16_t sum = (cs == LIN_CS_ENH && (pid & 0x3Fu) < 0x3Cu) ? pid : 0u;
+    for (uint8_t i = 0; i < len; i++) {
+        sum = (uint16_t)(sum + data[i]);
+        if (sum > 0xFFu) sum = (uint16_t)(sum - 0xFFu);
+    }
+    return (uint8_t)~sum;
+}
+
+static uint32_t lin_q4_us(uint32_t n, uint32_t q4)
+{
+    return (n * q4) >> 4;
+}
+
+static void lin_slave_respond(uint8_t pid);
+
+// UART ISR, erstes RTO nach dem Break: genau Sync + PID seit dem Break
+// (Break-Zeichen liegt je nach DMA Zeitpunkt vor oder nach brk_head)
+static void lin_isr_header(uarts_ch_t ch, uint32_t head)
+{
+    const uint8_t *ring = UARTS_RxBuf(ch);
+    uint32_t n = head - g_lin_isr_brk_head;
+
+    if (ring == NULL || n < 2u || n > 3u) return;
+    if (ring[(head - 2u) & (UARTS_RX_BUF_SIZE - 1u)] != 0x55u) return;
+
+    uint8_t pid = ring[(head - 1u) & (UARTS_RX_BUF_SIZE - 1u)];
+    if (LIN_Pid(pid) == pid) lin_slave_respond(pid);
+}
+
+// UART ISR: Break bzw. Ruhe nach einem Byte
+static void lin_rx_event(uarts_ch_t ch, uint8_t ev, uint32_t head)
+{
+    if (ev != UARTS_EV_RTO && ev != UARTS_EV_BREAK) return;
+
+    if (ev == UARTS_EV_BREAK) {
+        g_lin_isr_brk_head = head;
+        g_lin_isr_hdr = 1u;
+    } else if (g_lin_isr_hdr) {
+        g_lin_isr_hdr = 0u;
+        lin_isr_header(ch, head);
+    }
+
+    uint8_t next = (uint8_t)((g_lin_evq_head + 1u) % LIN_EVQ_SIZE);
+    if (next == g_lin_evq_tail) {
+        g_lin_stats.evq_lost++;
+        return;
+    }
+    g_lin_evq[g_lin_evq_head].type = ev;
+    g_lin_evq[g_lin_evq_head].head = head;
+    g_lin_evq[g_lin_evq_head].t_us = TIM_Micros();
+    g_lin_evq_head = next;
+}
+
+static uint8_t lin_sched_next(uint8_t cur)
+{
+    for (uint8_t i = 1u; i <= LIN_SCHED_MAX; i++) {
+        uint8_t j = (uint8_t)((cur + i) % LIN_SCHED_MAX);
+        if (g_lin_sched[j].used) return j;
+    }
+    return LIN_SLOT_NONE;
+}
+
+static void lin_timer_preload(uint32_t slot_us)
+{
+    // 1 us bis 65.5 ms, darueber 10 us Takt (PSC wirkt erst beim Update)
+    if (slot_us <= 65536u) {
+        TIM6->PSC = 15u;
+        TIM6->ARR = slot_us - 1u;
+    } else {
+        TIM6->PSC = 159u;
+        TIM6->ARR = (slot_us / 10u) - 1u;
+    }
+}
+
+// Slot Start: aus der TIM6 ISR (oder mit gesperrten IRQs)
+static void lin_slot_start(void)
+{
+    uint8_t slot = g_lin_slot;
+    if (slot >= LIN_SCHED_MAX || !g_lin_sched[slot].used) {
+        slot = lin_sched_next(slot >= LIN_SCHED_MAX ? (uint8_t)(LIN_SCHED_MAX - 1u) : slot);
+        if (slot == LIN_SLOT_NONE) return;
+    }
+
+    const lin_sched_t *e = &g_lin_sched[slot];
+    uint8_t tx[3u + LIN_DATA_MAX];
+    uint8_t n = 0u;
+
+    tx[n++] = 0x55u;
+    tx[n++] = LIN_Pid(e->id);
+    if (e->dir == LIN_DIR_PUB) {
+        memcpy(&tx[n], e->data, e->len);
+        n = (uint8_t)(n + e->len);
+        tx[n++] = LIN_Checksum(tx[1], e->data, e->len, (lin_cs_t)e->cs);
+    }
+
+    UARTS_SendBreak(g_lin_ch);
+    (void)UARTS_Write(g_lin_ch, tx, n);
+
+    uint8_t next = lin_sched_next(slot);
+    if (next == LIN_SLOT_NONE) next = slot;
+    lin_timer_preload(g_lin_sched[next].slot_us);
+    g_lin_slot = next;
+}
+
+void LIN_TimerIRQHandler(void)
+{
+    if ((TIM6->SR & TIM_SR_UIF) == 0u) return;
+    TIM6->SR = ~(uint32_t)TIM_SR_UIF;
+
+    if (g_lin_sched_run) lin_slot_start();
+}
+
+static void lin_timing_update(void)
+{
+    uint32_t baud = UARTS_GetRealBaud(g_lin_ch);
+    if (baud == 0u) baud = LIN_BAUD_DEF;
+    g_lin_bit_q4 = 16000000u / baud;
+    g_lin_char_q4 = 10u * g_lin_bit_q4;
+}
+
+HAL_StatusTypeDef LIN_Start(uarts_ch_t ch, uint32_t baud)
+{
+    if (ch >= UARTS_CH_COUNT) return HAL_ERROR;
+    LIN_Stop();
+
+    uarts_line_t line = { baud, 8u, 'N', UARTS_STOP_1 };
+    if (UARTS_SetLine(ch, &line) != HAL_OK) return HAL_ERROR;
+    if (!UARTS_IsRunning(ch) && UARTS_Start(ch) != HAL_OK) return HAL_ERROR;
+    if (UARTS_SetLin(ch, 1u) != HAL_OK) return HAL_ERROR;
+
+    g_lin_ch = ch;
+    UARTS_SetRxEventCb(ch, NULL);
+    g_lin_evq_head = 0u;
+    g_lin_evq_tail = 0u;
+    g_lin_isr_hdr = 0u;
+    UARTS_RxFlush(ch);
+    memset(&g_lin_frame, 0, sizeof(g_lin_frame));
+
+    lin_timing_update();
+    UARTS_SetRxTimeout(ch, 1u);
+    g_lin_active = 1u;
+    UARTS_SetRxEventCb(ch, lin_rx_event);
+    return HAL_OK;
+}
+
+void LIN_Stop(void)
+{
+    if (!g_lin_active) return;
+
+    (void)LIN_SchedRun(0u);
+    UARTS_SetRxEventCb(g_lin_ch, NULL);
+    (void)UARTS_SetLin(g_lin_ch, 0u);
+    UARTS_SetRxTimeout(g_lin_ch, UARTS_RTO_BITS_DEF);
+    g_lin_active = 0u;
+}
+
+uint8_t LIN_IsActive(void)
+{
+    return g_lin_active;
+}
+
+uarts_ch_t LIN_Channel(void)
+{
+    return g_lin_ch;
+}
+
+void LIN_SetMonitor(uint8_t on)
+{
+    g_lin_mon = on ? 1u : 0u;
+}
+
+int LIN_SchedAdd(uint8_t id, lin_dir_t dir, uint8_t len, uint32_t slot_us,
+                 lin_cs_t cs, const uint8_t *data)
+{
+    if (id > 0x3Fu || len == 0u || len > LIN_DATA_MAX) return -2;
+    if (slot_us < LIN_SLOT_MIN_US || slot_us > LIN_SLOT_MAX_US) return -2;
+    if (dir == LIN_DIR_PUB && data == NULL) return -2;
+
+    for (uint8_t i = 0; i < LIN_SCHED_MAX; i++) {
+        lin_sched_t *e = &g_lin_sched[i];
+        if (e->used) continue;
+
+        uint32_t primask = __get_PRIMASK();
+        __disable_irq();
+        memset(e, 0, sizeof(*e));
+        e->id = id;
+        e->dir = (uint8_t)dir;
+        e->len = len;
+        e->cs = (uint8_t)cs;
+        e->slot_us = slot_us;
+        if (data) memcpy(e->data, data, len);
+        e->used = 1u;
+        __set_PRIMASK(primask);
+        return (int)i;
+    }
+    return -1;
+}
+
+HAL_StatusTypeDef LIN_SchedDelete(uint8_t idx)
+{
+    if (idx >= LIN_SCHED_MAX || !g_lin_sched[idx].used) return HAL_ERROR;
+    g_lin_sched[idx].used = 0u;
+    if (lin_sched_next(idx) == LIN_SLOT_NONE) (void)LIN_SchedRun(0u);
+    return HAL_OK;
+}
+
+void LIN_SchedClear(void)
+{
+    (void)LIN_SchedRun(0u);
+    memset(g_lin_sched, 0, sizeof(g_lin_sched));
+}
+
+HAL_StatusTypeDef LIN_SchedRun(uint8_t on)
+{
+    CLEAR_BIT(TIM6->DIER, TIM_DIER_UIE);
+    CLEAR_BIT(TIM6->CR1, TIM_CR1_CEN);
+    g_lin_sched_run = 0u;
+    if (!on) return HAL_OK;
+
+    if (!g_lin_active) return HAL_ERROR;
+    uint8_t first = lin_sched_next((uint8_t)(LIN_SCHED_MAX - 1u));
+    if (first == LIN_SLOT_NONE) return HAL_ERROR;
+
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    // Slot 0 sofort, Laenge ueber UG in die Schattenregister
+    lin_timer_preload(g_lin_sched[first].slot_us);
+    TIM6->CNT = 0u;
+    SET_BIT(TIM6->CR1, TIM_CR1_URS);
+    TIM6->EGR = TIM_EGR_UG;
+    TIM6->SR = 0u;
+    g_lin_slot = first;
+    g_lin_sched_run = 1u;
+    lin_slot_start();
+    SET_BIT(TIM6->DIER, TIM_DIER_UIE);
+    SET_BIT(TIM6->CR1, TIM_CR1_CEN);
+    __set_PRIMASK(primask);
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef LIN_SlaveSet(uint8_t id, uint8_t len, lin_cs_t cs, const uint8_t *data)
+{
+    if (id > 0x3Fu || len == 0u || len > LIN_DATA_MAX || data == NULL) return HAL_ERROR;
+
+    lin_slave_t *free_e = NULL;
+    for (uint8_t i = 0; i < LIN_SLAVE_MAX; i++) {
+        lin_slave_t *s = &g_lin_slave[i];
+        if (s->used && s->id == id) { free_e = s; break; }
+        if (!s->used && free_e == NULL) free_e = s;
+    }
+    if (free_e == NULL) return HAL_ERROR;
+
+    // UART ISR antwortet aus der Tabelle
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    free_e->id = id;
+    free_e->len = len;
+    free_e->cs = (uint8_t)cs;
+    memcpy(free_e->data, data, len);
+    free_e->used = 1u;
+    __set_PRIMASK(primask);
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef LIN_SlaveDelete(uint8_t id)
+{
+    for (uint8_t i = 0; i < LIN_SLAVE_MAX; i++) {
+        if (g_lin_slave[i].used && g_lin_slave[i].id == id) {
+            g_lin_slave[i].used = 0u;
+            return HAL_OK;
+        }
+    }
+    return HAL_ERROR;
+}
+
+void LIN_SlaveClear(void)
+{
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    memset(g_lin_slave, 0, sizeof(g_lin_slave));
+    __set_PRIMASK(primask);
+}
+
+static lin_sched_t *lin_sched_find(uint8_t id)
+{
+    for (uint8_t i = 0; i < LIN_SCHED_MAX; i++) {
+        if (g_lin_sched[i].used && g_lin_sched[i].id == id) return &g_lin_sched[i];
+    }
+    return NULL;
+}
+
+static lin_slave_t *lin_slave_find(uint8_t id)
+{
+    for (uint8_t i = 0; i < LIN_SLAVE_MAX; i++) {
+        if (g_lin_slave[i].used && g_lin_slave[i].id == id) return &g_lin_slave[i];
+    }
+    return NULL;
+}
+
+static void lin_out(const char *s, int len)
+{
+    if (len <= 0) return;
+    if (USBS_Write((const uint8_t *)s, (uint16_t)len) != (uint16_t)len) {
+        g_lin_stats.usb_drop++;
+    }
+}
+
+static void lin_print_frame(const lin_frame_t *f, const char *res)
+{
+    char line[112];
+    int n;
+
+    if (f->state < LIN_F_DATA) {
+        n = snprintf(line, sizeof(line), "LIN %10lu BRK%s\r\n", (unsigned long)f->t_brk,
+                     (f->state == LIN_F_PID) ? " SYNC" : "");
+        lin_out(line, n);
+        return;
+    }
+
+    n = snprintf(line, sizeof(line), "LIN %10lu pid=%02X id=%02X sync=+%lu pid=+%lu",
+                 (unsigned long)f->t_brk, f->pid, (unsigned)(f->pid & 0x3Fu),
+                 (unsigned long)(f->t_sync - f->t_brk), (unsigned long)(f->t_pid - f->t_brk));
+    lin_out(line, n);
+    if (f->n != 0u) {
+        n = snprintf(line, sizeof(line), " resp=+%lu end=+%lu n=%u:",
+                     (unsigned long)(f->t_first - f->t_brk), (unsigned long)(f->t_last - f->t_brk),
+                     (unsigned)(f->n - 1u));
+        lin_out(line, n);
+        for (uint8_t i = 0; i < f->n; i++) {
+            n = snprintf(line, sizeof(line), (i + 1u == f->n) ? " cs=%02X" : " %02X", f->buf[i]);
+            lin_out(line, n);
+        }
+    }
+    n = snprintf(line, sizeof(line), " %s\r\n", res);
+    lin_out(line, n);
+}
+
+static void lin_finish(void)
+{
+    lin_frame_t *f = &g_lin_frame;
+    if (!f->open) return;
+    f->open = 0u;
+    g_lin_stats.frames++;
+
+    const char *res = "HDR";
+    lin_sched_t *se = (f->state == LIN_F_DATA) ? lin_sched_find(f->pid & 0x3Fu) : NULL;
+
+    if (f->state == LIN_F_DATA && !f->pid_ok) {
+        res = "PID";
+    } else if (f->state == LIN_F_DATA && f->n == 0u) {
+        if (f->expect >= 0) {
+            g_lin_stats.no_resp++;
+            if (se) se->no_resp++;
+            res = "NORESP";
+        }
+    } else if (f->state == LIN_F_DATA) {
+        uint8_t dlen = (uint8_t)(f->n - 1u);
+        uint8_t cs = f->buf[dlen];
+        uint8_t ok = 0u;
+
+        if (f->expect >= 0) {
+            if (dlen == (uint8_t)f->expect && LIN_Checksum(f->pid, f->buf, dlen, (lin_cs_t)f->cs) == cs) {
+                ok = 1u;
+                res = (f->cs == LIN_CS_CLS) ? "CLS" : "ENH";
+            }
+        } else if (LIN_Checksum(f->pid, f->buf, dlen, LIN_CS_ENH) == cs) {
+            ok = 1u;
+            res = ((f->pid & 0x3Fu) >= 0x3Cu) ? "CLS" : "ENH";
+        } else if (LIN_Checksum(f->pid, f->buf, dlen, LIN_CS_CLS) == cs) {
+            ok = 1u;
+            res = "CLS";
+        }
+
+        if (ok) {
+            g_lin_stats.ok++;
+            if (se) se->ok++;
+        } else {
+            g_lin_stats.cs_err++;
+            if (se) se->err++;
+            res = (f->expect >= 0 && dlen != (uint8_t)f->expect) ? "LEN" : "CS";
+        }
+    }
+
+    if (g_lin_mon) lin_print_frame(f, res);
+}
+
+// Slave Antwort direkt nach der PID (UART ISR)
+static void lin_slave_respond(uint8_t pid)
+{
+    lin_slave_t *s = lin_slave_find(pid & 0x3Fu);
+    if (s == NULL) return;
+
+    // Master sendet seine PUB Frames selbst
+    lin_sched_t *e = lin_sched_find(pid & 0x3Fu);
+    if (g_lin_sched_run && e && e->dir == LIN_DIR_PUB) return;
+
+    uint8_t tx[LIN_DATA_MAX + 1u];
+    memcpy(tx, s->data, s->len);
+    tx[s->len] = LIN_Checksum(pid, s->data, s->len, (lin_cs_t)s->cs);
+
+    // TIM6 ISR schreibt ebenfalls in den TX Ring
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    (void)UARTS_Write(g_lin_ch, tx, (uint16_t)(s->len + 1u));
+    __set_PRIMASK(primask);
+
+    s->hits++;
+    g_lin_stats.slave_tx++;
+}
+
+static void lin_rx_byte(uint8_t b, uint32_t t)
+{
+    lin_frame_t *f = &g_lin_frame;
+
+    if (!f->open) {
+        g_lin_stats.stray++;
+        return;
+    }
+
+    switch (f->state) {
+    case LIN_F_SYNC:
+        if (b != 0x55u) {
+            g_lin_stats.sync_err++;
+            f->open = 0u;
+            return;
+        }
+        f->t_sync = t;
+        f->state = LIN_F_PID;
+        break;
+
+    case LIN_F_PID: {
+        f->pid = b;
+        f->t_pid = t;
+        f->t_last = t;
+        f->state = LIN_F_DATA;
+        f->pid_ok = (LIN_Pid(b) == b) ? 1u : 0u;
+        if (!f->pid_ok) {
+            g_lin_stats.pid_err++;
+            f->expect = -1;
+            break;
+        }
+
+        lin_sched_t *e = lin_sched_find(b & 0x3Fu);
+        lin_slave_t *s = lin_slave_find(b & 0x3Fu);
+        f->expect = -1;
+        if (e) { f->expect = (int8_t)e->len; f->cs = e->cs; }
+        else if (s) { f->expect = (int8_t)s->len; f->cs = s->cs; }
+        break;
+    }
+
+    case LIN_F_DATA:
+        if (f->n == 0u) f->t_first = t;
+        if (f->n < sizeof(f->buf)) f->buf[f->n++] = b;
+        f->t_last = t;
+        if (f->expect >= 0 && f->n == (uint8_t)(f->expect + 1)) lin_finish();
+        break;
+    }
+}
+
+// n Bytes aus dem Ring, das letzte endet bei t_end
+static void lin_feed(uint32_t n, uint32_t t_end)
+{
+    uint8_t buf[16];
+    uint32_t k = 0u;
+
+    while (k < n) {
+        uint16_t chunk = (uint16_t)(((n - k) > sizeof(buf)) ? sizeof(buf) : (n - k));
+        uint16_t got = UARTS_Read(g_lin_ch, buf, chunk);
+        if (got == 0u) break;
+        for (uint16_t i = 0; i < got; i++, k++) {
+            lin_rx_byte(buf[i], t_end - lin_q4_us(n - 1u - k, g_lin_char_q4));
+        }
+    }
+}
+
+void LIN_Poll(void)
+{
+    if (!g_lin_active) return;
+
+    while (g_lin_evq_tail != g_lin_evq_head) {
+        lin_event_t ev;
+        ev.type = g_lin_evq[g_lin_evq_tail].type;
+        ev.head = g_lin_evq[g_lin_evq_tail].head;
+        ev.t_us = g_lin_evq[g_lin_evq_tail].t_us;
+        g_lin_evq_tail = (uint8_t)((g_lin_evq_tail + 1u) % LIN_EVQ_SIZE);
+
+        int32_t n = (int32_t)(ev.head - UARTS_RxPos(g_lin_ch));
+        if (n < 0) n = 0;
+
+        // Byte-Ende = Event - 1 Bit (RTO) bzw. Break-Zeichen Ende
+        uint32_t t_end = ev.t_us - lin_q4_us(1u, g_lin_bit_q4);
+
+        if (ev.type == UARTS_EV_BREAK) {
+            if (n > 0) {
+                lin_feed((uint32_t)(n - 1), t_end - lin_q4_us(1u, g_lin_char_q4));
+                uint8_t brk = 0u;
+                (void)UARTS_Read(g_lin_ch, &brk, 1u);
+            }
+            lin_finish();
+
+            lin_frame_t *f = &g_lin_frame;
+            memset(f, 0, sizeof(*f));
+            f->open = 1u;
+            f->state = LIN_F_SYNC;
+            f->expect = -1;
+            f->t_brk = ev.t_us - lin_q4_us(LIN_BREAK_BITS, g_lin_bit_q4);
+        } else {
+            lin_feed((uint32_t)n, t_end);
+        }
+    }
+
+    // unbekannte Laenge oder keine Antwort: Frame nach Ruhe abschliessen
+    lin_frame_t *f = &g_lin_frame;
+    if (f->open && f->state == LIN_F_DATA &&
+        (int32_t)(TIM_Micros() - f->t_last) > (int32_t)lin_q4_us(LIN_RESP_TIMEOUT_CH, g_lin_char_q4)) {
+        lin_finish();
+    }
+}
+
+void LIN_PrintSched(void)
+{
+    cli_printf("\r\nLIN Schedule (%s):\r\n", g_lin_sched_run ? "laeuft" : "steht");
+    for (uint8_t i = 0; i < LIN_SCHED_MAX; i++) {
+        const lin_sched_t *e = &g_lin_sched[i];
+        if (!e->used) continue;
+        cli_printf("  [%2u] id=%02X pid=%02X %s len=%u %s slot=%lu us ok=%lu err=%lu noresp=%lu",
+                   (unsigned)i, (unsigned)e->id, (unsigned)LIN_Pid(e->id),
+                   (e->dir == LIN_DIR_PUB) ? "pub" : "sub", (unsigned)e->len,
+                   (e->cs == LIN_CS_CLS) ? "cls" : "enh", (unsigned long)e->slot_us,
+                   (unsigned long)e->ok, (unsigned long)e->err, (unsigned long)e->no_resp);
+        if (e->dir == LIN_DIR_PUB) {
+            cli_printf(" :");
+            for (uint8_t k = 0; k < e->len; k++) cli_printf(" %02X", e->data[k]);
+        }
+        cli_printf("\r\n");
+    }
+}
+
+void LIN_PrintSlaves(void)
+{
+    cli_printf("\r\nLIN Slave Antworten:\r\n");
+    for (uint8_t i = 0; i < LIN_SLAVE_MAX; i++) {
+        const lin_slave_t *s = &g_lin_slave[i];
+        if (!s->used) continue;
+        cli_printf("  id=%02X len=%u %s hits=%lu :", (unsigned)s->id, (unsigned)s->len,
+                   (s->cs == LIN_CS_CLS) ? "cls" : "enh", (unsigned long)s->hits);
+        for (uint8_t k = 0; k < s->len; k++) cli_printf(" %02X", s->data[k]);
+        cli_printf("\r\n");
+    }
+}
+
+void LIN_PrintStats(void)
+{
+    cli_printf("\r\nLIN: %s  %s %lu Baud  monitor=%s  schedule=%s\r\n",
+               g_lin_active ? "aktiv" : "aus",
+               (g_lin_ch == UARTS_CH_UART4) ? "UART4" : "UART8",
+               (unsigned long)UARTS_GetRealBaud(g_lin_ch), g_lin_mon ? "on" : "off",
+               g_lin_sched_run ? "laeuft" : "steht");
+    cli_printf("  frames=%lu ok=%lu cs_err=%lu noresp=%lu\r\n",
+               (unsigned long)g_lin_stats.frames, (unsigned long)g_lin_stats.ok,
+               (unsigned long)g_lin_stats.cs_err, (unsigned long)g_lin_stats.no_resp);
+    cli_printf("  sync_err=%lu pid_err=%lu stray=%lu slave_tx=%lu\r\n",
+               (unsigned long)g_lin_stats.sync_err, (unsigned long)g_lin_stats.pid_err,
+               (unsigned long)g_lin_stats.stray, (unsigned long)g_lin_stats.slave_tx);
+    cli_printf("  brk=%lu evq_lost=%lu usb_drop=%lu\r\n",
+               (unsigned long)UARTS_GetStats(g_lin_ch)->brk,
+               (unsigned long)g_lin_stats.evq_lost, (unsigned long)g_lin_stats.usb_drop);
+}
+
+void LIN_ResetStats(void)
+{
+    memset(&g_lin_stats, 0, sizeof(g_lin_stats));
+    for (uint8_t i = 0; i < LIN_SCHED_MAX; i++) {
+        g_lin_sched[i].ok = 0u;
+        g_lin_sched[i].err = 0u;
+        g_lin_sched[i].no_resp = 0u;
+    }
+    for (uint8_t i = 0; i < LIN_SLAVE_MAX; i++) g_lin_slave[i].hits = 0u;
+}
@@ -0,0 +1,565 @@
+/*
+ * modbus.c
+ *
+ *  Modbus RTU master and passive sniffer on the RS485 port (UART4).
+ */
+#include "modbus.h"
+#include "uart_stream.h"
+#include "usb_stream.h"
+#include "crc_util.h"
+#include "tim.h"
+#include "cli.h"
+#include <string.h>
+#include <stdio.h>
+
+// ============================================================
+// MODBUS RTU
+//
+// - Frame-Ende kommt von der USART: Receiver Timeout (RTOR) = t3.5,
+//   die UART ISR stellt (Schreibzeiger, Zeitstempel) in eine Queue;
+//   MB_Poll() schneidet die Frames aus dem RX Ring von uart_stream.c
+// - CRC16 ueber Tabelle (crc_util.c)
+// - Master: Einzelauftraege + Poll-Liste, naechster Request direkt nach
+//   dem Frame-Ende der Antwort (t3.5 ist durch das RTO schon erfuellt)
+// - Sniffer: jeder Frame mit 1 us Zeitstempel (TIM2) und CRC Status,
+//   Ausgabe nicht blockierend ueber usb_stream.c
+// - Eigenes Echo (RS485 Empfaenger waehrend TX aktiv) wird verworfen
+// ============================================================
+
+#define MB_CH                 UARTS_CH_UART4
+#define MB_EVQ_SIZE           (16u)
+#define MB_POLL_NONE          (0xFFu)
+
+typedef struct {
+    uint32_t head;
+    uint32_t t_us;
+} mb_event_t;
+
+typedef struct {
+    uint8_t  used;
+    uint8_t  slave;
+    uint8_t  fc;
+    uint16_t addr;
+    uint16_t count;
+    uint32_t ok;
+    uint32_t err;          // CRC / Exception / Laenge
+    uint32_t timeout;
+    uint8_t  last_exc;
+} mb_poll_t;
+
+typedef enum {
+    MB_IDLE = 0,
+    MB_WAIT_TX,            // Broadcast: nur bis TX fertig
+    MB_WAIT_RESP,
+} mb_state_t;
+
+typedef struct {
+    uint32_t frames;
+    uint32_t crc_err;
+    uint32_t too_long;
+    uint32_t evq_lost;
+    uint32_t echo;
+    uint32_t usb_drop;
+    uint32_t req;
+    uint32_t resp;
+    uint32_t timeout;
+    uint32_t exc;
+} mb_stats_t;
+
+static volatile mb_event_t g_mb_evq[MB_EVQ_SIZE];
+static volatile uint8_t g_mb_evq_head = 0u;
+static volatile uint8_t g_mb_evq_tail = 0u;
+
+static uint8_t g_mb_active = 0u;
+static uint8_t g_mb_sniff = 0u;
+static uint8_t g_mb_watch = 0u;
+static uint16_t g_mb_timeout_ms = MB_TIMEOUT_DEF_MS;
+static uint32_t g_mb_rto_us = 0u;
+static uint32_t g_mb_char_us = 0u;        // Zeichenzeit in 1/16 us
+
+static mb_poll_t g_mb_poll[MB_POLL_MAX];
+static uint8_t g_mb_poll_run = 0u;
+static uint8_t g_mb_poll_idx = 0u;
+static uint32_t g_mb_poll_cycle_ms = 0u;
+static uint32_t g_mb_poll_t0 = 0u;
+
+static mb_state_t g_mb_state = MB_IDLE;
+static uint8_t g_mb_req[MB_FRAME_MAX];
+static uint16_t g_mb_req_len = 0u;
+static uint8_t g_mb_req_poll = MB_POLL_NONE;   // Poll-Index oder Einzelauftrag
+static uint8_t g_mb_pend[MB_FRAME_MAX];        // Einzelauftrag wartet auf Bus
+static uint16_t g_mb_pend_len = 0u;
+static uint8_t g_mb_req_pending = 0u;
+static uint32_t g_mb_req_t0 = 0u;
+
+static uint8_t g_mb_frame[MB_FRAME_MAX];
+static mb_stats_t g_mb_stats;
+
+// UART ISR: Frame-Ende (t3.5 Ruhe) merken
+static void mb_rx_event(uarts_ch_t ch, uint8_t ev, uint32_t head)
+{
+    (void)ch;
+    if (ev != UARTS_EV_RTO) return;
+
+    uint8_t next = (uint8_t)((g_mb_evq_head + 1u) % MB_EVQ_SIZE);
+    if (next == g_mb_evq_tail) {
+        g_mb_stats.evq_lost++;
+        return;
+    }
+    g_mb_evq[g_mb_evq_head].head = head;
+    g_mb_evq[g_mb_evq_head].t_us = TIM_Micros() - g_mb_rto_us;   // Ende letztes Zeichen
+    g_mb_evq_head = next;
+}
+
+static void mb_out(const char *s, uint16_t len)
+{
+    if (USBS_Write((const uint8_t *)s, len) != len) {
+        g_mb_stats.usb_drop++;
+    }
+}
+
+static uint8_t mb_frame_crc_ok(const uint8_t *f, uint16_t len)
+{
+    if (len < 4u) return 0u;
+    uint16_t crc = CRC16_Modbus(f, (uint16_t)(len - 2u));
+    return (f[len - 2u] == (uint8_t)crc && f[len - 1u] == (uint8_t)(crc >> 8)) ? 1u : 0u;
+}
+
+static void mb_print_frame(const uint8_t *f, uint16_t len, uint32_t t_end, uint8_t crc_ok)
+{
+    char line[48];
+    uint32_t t_start = t_end - (uint32_t)((len * g_mb_char_us) >> 4);
+
+    int n = snprintf(line, sizeof(line), "MB %10lu %3u ", (unsigned long)t_start, (unsigned)len);
+    mb_out(line, (uint16_t)n);
+
+    for (uint16_t i = 0; i < len; i++) {
+        n = snprintf(line, sizeof(line), "%02X ", f[i]);
+        mb_out(line, (uint16_t)n);
+    }
+    n = snprintf(line, sizeof(line), "%s\r\n", crc_ok ? "OK" : "CRC");
+    mb_out(line, (uint16_t)n);
+}
+
+static void mb_timing_update(void)
+{
+    uarts_line_t line;
+    UARTS_GetLine(MB_CH, &line);
+    if (line.baud == 0u) line.baud = 9600u;
+
+    uint32_t bits = 1u + line.data_bits + ((line.parity != 'N') ? 1u : 0u) +
+                    ((line.stop == UARTS_STOP_2) ? 2u : 1u);
+
+    // t3.5: 3.5 Zeichen, ueber 19200 Baud fest 1750 us (Modbus Spec)
+    uint32_t rto_bits = (line.baud > 19200u)
+                      ? (uint32_t)(((uint64_t)1750u * line.baud + 999999u) / 1000000u)
+                      : (bits * 7u + 1u) / 2u;
+
+    g_mb_rto_us = (uint32_t)(((uint64_t)rto_bits * 1000000u) / line.baud);
+    g_mb_char_us = (uint32_t)(((uint64_t)bits * 16000000u) / line.baud);
+    UARTS_SetRxTimeout(MB_CH, rto_bits);
+}
+
+HAL_StatusTypeDef MB_Start(void)
+{
+    if (UARTS_IsWide(MB_CH)) return HAL_ERROR;      // Modbus = 8 Datenbits
+
+    if (!UARTS_IsRunning(MB_CH) && UARTS_Start(MB_CH) != HAL_OK) {
+        return HAL_ERROR;
+    }
+
+    UARTS_SetRxEventCb(MB_CH, NULL);
+    g_mb_evq_head = 0u;
+    g_mb_evq_tail = 0u;
+    UARTS_RxFlush(MB_CH);
+
+    mb_timing_update();
+    g_mb_state = MB_IDLE;
+    g_mb_req_pending = 0u;
+    g_mb_active = 1u;
+    UARTS_SetRxEventCb(MB_CH, mb_rx_event);
+    return HAL_OK;
+}
+
+void MB_Stop(void)
+{
+    if (!g_mb_active) return;
+
+    UARTS_SetRxEventCb(MB_CH, NULL);
+    UARTS_SetRxTimeout(MB_CH, UARTS_RTO_BITS_DEF);
+    g_mb_active = 0u;
+    g_mb_poll_run = 0u;
+    g_mb_req_pending = 0u;
+    g_mb_state = MB_IDLE;
+}
+
+uint8_t MB_IsActive(void)
+{
+    return g_mb_active;
+}
+
+void MB_SetSniff(uint8_t on)
+{
+    g_mb_sniff = on ? 1u : 0u;
+}
+
+void MB_SetWatch(uint8_t on)
+{
+    g_mb_watch = on ? 1u : 0u;
+}
+
+void MB_SetTimeout(uint16_t ms)
+{
+    g_mb_timeout_ms = (ms == 0u) ? MB_TIMEOUT_DEF_MS : ms;
+}
+
+static uint16_t mb_build(uint8_t *f, uint8_t slave, uint8_t fc, uint16_t addr,
+                         uint16_t count, const uint16_t *values)
+{
+    uint16_t n = 0u;
+
+    f[n++] = slave;
+    f[n++] = fc;
+    f[n++] = (uint8_t)(addr >> 8);
+    f[n++] = (uint8_t)addr;
+
+    switch (fc) {
+        case 1: case 2: case 3: case 4:
+            f[n++] = (uint8_t)(count >> 8);
+            f[n++] = (uint8_t)count;
+            break;
+        case 5:
+            f[n++] = (values && values[0]) ? 0xFFu : 0x00u;
+            f[n++] = 0x00u;
+            break;
+        case 6:
+            f[n++] = (uint8_t)(values ? (values[0] >> 8) : 0u);
+            f[n++] = (uint8_t)(values ? values[0] : 0u);
+            break;
+        case 16:
+            f[n++] = (uint8_t)(count >> 8);
+            f[n++] = (uint8_t)count;
+            f[n++] = (uint8_t)(count * 2u);
+            for (uint16_t i = 0; i < count; i++) {
+                f[n++] = (uint8_t)(values[i] >> 8);
+                f[n++] = (uint8_t)values[i];
+            }
+            break;
+        default:
+            return 0u;
+    }
+
+    uint16_t crc = CRC16_Modbus(f, n);
+    f[n++] = (uint8_t)crc;
+    f[n++] = (uint8_t)(crc >> 8);
+    return n;
+}
+
+static uint8_t mb_count_ok(uint8_t fc, uint16_t count)
+{
+    if (fc == 1u || fc == 2u) return (count >= 1u && count <= 2000u);
+    if (fc == 3u || fc == 4u) return (count >= 1u && count <= 125u);
+    if (fc == 16u) return (count >= 1u && count <= MB_REGS_MAX);
+    return (fc == 5u || fc == 6u);
+}
+
+static void mb_send(void)
+{
+    g_mb_stats.req++;
+    if (UARTS_Write(MB_CH, g_mb_req, g_mb_req_len) != g_mb_req_len) {
+        // TX Ring voll (sollte bei Einzelframes nicht passieren) -> Timeout Pfad
+        g_mb_stats.timeout++;
+    }
+    g_mb_req_t0 = HAL_GetTick();
+    g_mb_state = (g_mb_req[0] == 0u) ? MB_WAIT_TX : MB_WAIT_RESP;
+}
+
+HAL_StatusTypeDef MB_Request(uint8_t slave, uint8_t fc, uint16_t addr,
+                             uint16_t count, const uint16_t *values)
+{
+    if (!g_mb_active || g_mb_req_pending) return HAL_BUSY;
+    if (slave > 247u || !mb_count_ok(fc, count)) return HAL_ERROR;
+    if (slave == 0u && fc <= 4u) return HAL_ERROR;   // Broadcast nur schreibend
+
+    // Poll-Liste darf weiterlaufen, der Auftrag geht in die naechste Luecke
+    g_mb_pend_len = mb_build(g_mb_pend, slave, fc, addr, count, values);
+    if (g_mb_pend_len == 0u) return HAL_ERROR;
+    g_mb_req_pending = 1u;
+
+    MB_Poll();
+    return HAL_OK;
+}
+
+int MB_PollAdd(uint8_t slave, uint8_t fc, uint16_t addr, uint16_t count)
+{
+    if (slave == 0u || slave > 247u || fc < 1u || fc > 4u || !mb_count_ok(fc, count)) return -2;
+
+    for (uint8_t i = 0; i < MB_POLL_MAX; i++) {
+        mb_poll_t *p = &g_mb_poll[i];
+        if (p->used) continue;
+        memset(p, 0, sizeof(*p));
+        p->slave = slave;
+        p->fc = fc;
+        p->addr = addr;
+        p->count = count;
+        p->used = 1u;
+        return (int)i;
+    }
+    return -1;
+}
+
+HAL_StatusTypeDef MB_PollDelete(uint8_t idx)
+{
+    if (idx >= MB_POLL_MAX || !g_mb_poll[idx].used) return HAL_ERROR;
+    g_mb_poll[idx].used = 0u;
+    return HAL_OK;
+}
+
+void MB_PollClear(void)
+{
+    memset(g_mb_poll, 0, sizeof(g_mb_poll));
+    g_mb_poll_run = 0u;
+}
+
+void MB_PollRun(uint8_t on, uint32_t cycle_ms)
+{
+    g_mb_poll_run = on ? 1u : 0u;
+    g_mb_poll_cycle_ms = cycle_ms;
+    g_mb_poll_idx = 0u;
+    g_mb_poll_t0 = HAL_GetTick();
+}
+
+void MB_PrintPoll(void)
+{
+    cli_printf("\r\nModbus Poll: %s  Zyklus=%lu ms  Timeout=%u ms\r\n",
+               g_mb_poll_run ? "RUN" : "STOP", (unsigned long)g_mb_poll_cycle_ms,
+               (unsigned)g_mb_timeout_ms);
+    cli_printf("Idx Slave FC  Addr   Cnt        OK       Err   Timeout  Exc\r\n");
+
+    uint8_t count = 0u;
+    for (uint8_t i = 0; i < MB_POLL_MAX; i++) {
+        const mb_poll_t *p = &g_mb_poll[i];
+        if (!p->used) continue;
+        count++;
+        cli_printf("%3u %5u %2u  %5u  %4u  %8lu  %8lu  %8lu  %02X\r\n",
+                   (unsigned)i, (unsigned)p->slave, (unsigned)p->fc,
+                   (unsigned)p->addr, (unsigned)p->count,
+                   (unsigned long)p->ok, (unsigned long)p->err,
+                   (unsigned long)p->timeout, (unsigned)p->last_exc);
+    }
+    if (count == 0u) {
+        cli_printf("(leer)\r\n");
+    }
+}
+
+void MB_PrintStats(void)
+{
+    cli_printf("\r\nModbus: %s  sniff=%s  t3.5=%lu us\r\n",
+               g_mb_active ? "aktiv" : "aus", g_mb_sniff ? "on" : "off",
+               (unsigned long)g_mb_rto_us);
+    cli_printf("  frames=%lu crc_err=%lu too_long=%lu echo=%lu\r\n",
+               (unsigned long)g_mb_stats.frames, (unsigned long)g_mb_stats.crc_err,
+               (unsigned long)g_mb_stats.too_long, (unsigned long)g_mb_stats.echo);
+    cli_printf("  req=%lu resp=%lu timeout=%lu exc=%lu\r\n",
+               (unsigned long)g_mb_stats.req, (unsigned long)g_mb_stats.resp,
+               (unsigned long)g_mb_stats.timeout, (unsigned long)g_mb_stats.exc);
+    cli_printf("  evq_lost=%lu usb_drop=%lu\r\n",
+               (unsigned long)g_mb_stats.evq_lost, (unsigned long)g_mb_stats.usb_drop);
+}
+
+void MB_ResetStats(void)
+{
+    memset(&g_mb_stats, 0, sizeof(g_mb_stats));
+    for (uint8_t i = 0; i < MB_POLL_MAX; i++) {
+        g_mb_poll[i].ok = 0u;
+        g_mb_poll[i].err = 0u;
+        g_mb_poll[i].timeout = 0u;
+        g_mb_poll[i].last_exc = 0u;
+    }
+}
+
+// Antwort auf den laufenden Request pruefen; return 1 wenn sie passt
+static uint8_t mb_check_response(const uint8_t *f, uint16_t len, uint8_t *exc)
+{
+    uint8_t fc = g_mb_req[1];
+    *exc = 0u;
+
+    if (f[0] != g_mb_req[0]) return 0u;
+    if (f[1] == (uint8_t)(fc | 0x80u)) {
+        *exc = (len == 5u) ? f[2] : 0xFFu;
+        return 1u;
+    }
+    if (f[1] != fc) return 0u;
+
+    uint16_t cnt = (uint16_t)((g_mb_req[4] << 8) | g_mb_req[5]);
+    uint16_t expect;
+    switch (fc) {
+        case 1: case 2: expect = (uint16_t)(5u + (cnt + 7u) / 8u); break;
+        case 3: case 4: expect = (uint16_t)(5u + cnt * 2u); break;
+        default:        expect = 8u; break;   // 5, 6, 16: Echo Adresse/Wert
+    }
+    if (len != expect) *exc = 0xFEu;          // Laenge passt nicht
+    return 1u;
+}
+
+static void mb_report(const uint8_t *f, uint16_t len, uint8_t exc)
+{
+    uint8_t fc = g_mb_req[1];
+    uint16_t addr = (uint16_t)((g_mb_req[2] << 8) | g_mb_req[3]);
+    char line[64];
+    int n;
+
+    if (g_mb_req_poll != MB_POLL_NONE) {
+        if (!g_mb_watch) return;
+        n = snprintf(line, sizeof(line), "MB #%u s=%u fc=%u a=%u:", (unsigned)g_mb_req_poll,
+                     (unsigned)f[0], (unsigned)fc, (unsigned)addr);
+    } else {
+        n = snprintf(line, sizeof(line), "\r\nMB s=%u fc=%u a=%u:", (unsigned)f[0],
+                     (unsigned)fc, (unsigned)addr);
+    }
+    mb_out(line, (uint16_t)n);
+
+    if (exc == 0xFEu) {
+        n = snprintf(line, sizeof(line), " Laenge falsch (%u)", (unsigned)len);
+        mb_out(line, (uint16_t)n);
+    } else if (exc != 0u) {
+        n = snprintf(line, sizeof(line), " Exception %02X", (unsigned)exc);
+        mb_out(line, (uint16_t)n);
+    } else if (fc == 3u || fc == 4u) {
+        for (uint16_t i = 3u; (uint16_t)(i + 1u) < (uint16_t)(len - 2u); i = (uint16_t)(i + 2u)) {
+            n = snprintf(line, sizeof(line), " %04X", (unsigned)((f[i] << 8) | f[i + 1u]));
+            mb_out(line, (uint16_t)n);
+        }
+    } else if (fc == 1u || fc == 2u) {
+        uint16_t cnt = (uint16_t)((g_mb_req[4] << 8) | g_mb_req[5]);
+        mb_out(" ", 1u);
+        for (uint16_t i = 0; i < cnt; i++) {
+            mb_out((f[3u + i / 8u] & (1u << (i % 8u))) ? "1" : "0", 1u);
+        }
+    } else {
+        mb_out(" OK", 3u);
+    }
+    mb_out("\r\n", 2u);
+}
+
+static void mb_finish(uint8_t ok, uint8_t timeout, uint8_t exc)
+{
+    if (g_mb_req_poll != MB_POLL_NONE && g_mb_req_poll < MB_POLL_MAX) {
+        mb_poll_t *p = &g_mb_poll[g_mb_req_poll];
+        if (ok) p->ok++;
+        else if (timeout) p->timeout++;
+        else p->err++;
+        if (exc) p->last_exc = exc;
+    } else if (timeout) {
+        cli_printf("\r\nMB s=%u fc=%u: Timeout\r\n", (unsigned)g_mb_req[0], (unsigned)g_mb_req[1]);
+        CLI_PrintPrompt();
+    } else if (g_mb_req[0] == 0u) {
+        cli_printf("\r\nMB Broadcast gesendet\r\n");
+        CLI_PrintPrompt();
+    }
+
+    if (timeout) g_mb_stats.timeout++;
+    g_mb_state = MB_IDLE;
+}
+
+static void mb_process_frame(const uint8_t *f, uint16_t len, uint32_t t_end)
+{
+    uint8_t crc_ok = mb_frame_crc_ok(f, len);
+
+    g_mb_stats.frames++;
+    if (!crc_ok) g_mb_stats.crc_err++;
+    if (g_mb_sniff) mb_print_frame(f, len, t_end, crc_ok);
+
+    if (g_mb_state != MB_WAIT_RESP) return;
+
+    // eigenes Echo ueber den RS485 Empfaenger
+    if (len == g_mb_req_len && memcmp(f, g_mb_req, len) == 0) {
+        g_mb_stats.echo++;
+        return;
+    }
+    if (!crc_ok) return;   // gestoert -> Timeout entscheidet
+
+    uint8_t exc = 0u;
+    if (!mb_check_response(f, len, &exc)) return;
+
+    g_mb_stats.resp++;
+    if (exc != 0u && exc != 0xFEu) g_mb_stats.exc++;
+    mb_report(f, len, exc);
+    if (g_mb_req_poll == MB_POLL_NONE) CLI_PrintPrompt();
+    mb_finish(exc == 0u, 0u, exc);
+}
+
+static void mb_drain_frames(void)
+{
+    while (g_mb_evq_tail != g_mb_evq_head) {
+        uint32_t head = g_mb_evq[g_mb_evq_tail].head;
+        uint32_t t_end = g_mb_evq[g_mb_evq_tail].t_us;
+        g_mb_evq_tail = (uint8_t)((g_mb_evq_tail + 1u) % MB_EVQ_SIZE);
+
+        uint32_t len = head - UARTS_RxPos(MB_CH);
+        if (len == 0u || len > UARTS_RX_BUF_SIZE) continue;   // schon gelesen / Ring ueberholt
+
+        if (len > MB_FRAME_MAX) {
+            g_mb_stats.too_long++;
+            UARTS_RxConsume(MB_CH, (uint16_t)len);
+            continue;
+        }
+
+        uint16_t n = UARTS_Read(MB_CH, g_mb_frame, (uint16_t)len);
+        mb_process_frame(g_mb_frame, n, t_end);
+    }
+}
+
+static uint8_t mb_poll_next(void)
+{
+    for (uint8_t k = 0; k < MB_POLL_MAX; k++) {
+        uint8_t i = g_mb_poll_idx;
+        if (i >= MB_POLL_MAX) {
+            // Liste durch -> auf den naechsten Zyklus warten
+            if ((HAL_GetTick() - g_mb_poll_t0) < g_mb_poll_cycle_ms) return MB_POLL_NONE;
+            g_mb_poll_t0 = HAL_GetTick();
+            g_mb_poll_idx = 0u;
+            i = 0u;
+        }
+        g_mb_poll_idx = (uint8_t)(i + 1u);
+        if (g_mb_poll[i].used) return i;
+    }
+    return MB_POLL_NONE;
+}
+
+void MB_Poll(void)
+{
+    if (!g_mb_active) return;
+
+    mb_drain_frames();
+
+    if (g_mb_state == MB_WAIT_TX && !UARTS_TxBusy(MB_CH)) {
+        // Broadcast: Slaves brauchen Bearbeitungszeit, t3.5 reicht als Luecke
+        mb_finish(1u, 0u, 0u);
+    }
+
+    if (g_mb_state == MB_WAIT_RESP && (HAL_GetTick() - g_mb_req_t0) > g_mb_timeout_ms) {
+        mb_finish(0u, 1u, 0u);
+    }
+
+    if (g_mb_state != MB_IDLE) return;
+
+    if (g_mb_req_pending) {
+        memcpy(g_mb_req, g_mb_pend, g_mb_pend_len);
+        g_mb_req_len = g_mb_pend_len;
+        g_mb_req_pending = 0u;
+        g_mb_req_poll = MB_POLL_NONE;
+        mb_send();
+        return;
+    }
+
+    if (g_mb_poll_run) {
+        uint8_t i = mb_poll_next();
+        if (i == MB_POLL_NONE) return;
+
+        const mb_poll_t *p = &g_mb_poll[i];
+        g_mb_req_len = mb_build(g_mb_req, p->slave, p->fc, p->addr, p->count, NULL);
+        g_mb_req_poll = i;
+        mb_send();
+    }
+}
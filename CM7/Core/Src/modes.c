@@ -7,6 +7,7 @@
 #include "spi_mode.h"   // SPI Master
 #include "uart_mode.h"   // UART
 #include "can_mode.h"  // CAN
+#include "ssi_mode.h"   // SSI Absolutwertgeber
 static ubt_mode_t g_mode = MODE_NONE;
 
 ubt_mode_t MODES_GetMode(void) { return g_mode; }
@@ -40,6 +41,21 @@ static void mode_print_exit(ubt_mode_t mode)
     cli_printf("\r\nMode %s exit\r\n", mode_name(mode));
 }
 
+// Hintergrund-Engines werden nur im eigenen Mode gepollt -> beim Verlassen stoppen
+static void mode_leave(ubt_mode_t mode)
+{
+    switch (mode) {
+        case MODE_I2C:  I2C_Mode_Exit(); break;
+        case MODE_CAN:  CAN_Mode_Exit(); break;
+        case MODE_SPI:  SPI_Mode_Exit(); break;
+        case MODE_UART: UART_Mode_Exit(); break;
+        case MODE_SSI:  SSI_Mode_Exit(); break;
+        case MODE_DIO:  DIO_Mode_Exit(); break;
+        default:        break;
+    }
+    mode_print_exit(mode);
+}
+
 static void print_main_menu(void)
 {
     cli_printf("\r\nMain Menu:\r\n");
@@ -57,7 +73,7 @@ static void print_main_menu(void)
 void MODES_StartMenu(void)
 {
     if (g_mode != MODE_NONE) {
-        mode_print_exit(g_mode);
+        mode_leave(g_mode);
     }
 	g_mode = MODE_MENU;
     CLI_SetPrompt("MODE> ");
@@ -68,7 +84,7 @@ void MODES_StartMenu(void)
 void MODES_GotoMenu(void)
 {
     if (g_mode != MODE_MENU && g_mode != MODE_NONE) {
-        mode_print_exit(g_mode);
+        mode_leave(g_mode);
     }
 	// Egal woher: ins Menü
     g_mode = MODE_MENU;
@@ -83,7 +99,7 @@ void MODES_StartUartTunnel(uint8_t use_uart8)
 {
     if (g_mode != MODE_UART) {
         if (g_mode != MODE_NONE) {
-            mode_print_exit(g_mode);
+            mode_leave(g_mode);
         }
         g_mode = MODE_UART;
         CLI_SetPrompt("UART> ");
@@ -121,7 +137,7 @@ uint8_t MODES_HandleMenuChar(char ch)
     switch (ch)
     {
         case 'I':
-            mode_print_exit(g_mode);
+            mode_leave(g_mode);
             g_mode = MODE_I2C;
             CLI_SetPrompt("I2C> ");
             mode_print_entry(g_mode);
@@ -130,7 +146,7 @@ uint8_t MODES_HandleMenuChar(char ch)
             return 1;
 
         case 'C':
-            mode_print_exit(g_mode);
+            mode_leave(g_mode);
             g_mode = MODE_CAN;
             CLI_SetPrompt("CAN> ");
             mode_print_entry(g_mode);
@@ -139,7 +155,7 @@ uint8_t MODES_HandleMenuChar(char ch)
             return 1;
 
         case 'S':
-            mode_print_exit(g_mode);
+            mode_leave(g_mode);
             g_mode = MODE_SPI;
             CLI_SetPrompt("SPI> ");
             mode_print_entry(g_mode);
@@ -148,7 +164,7 @@ uint8_t MODES_HandleMenuChar(char ch)
             return 1;
 
         case 'U':
-            mode_print_exit(g_mode);
+            mode_leave(g_mode);
             g_mode = MODE_UART;
             CLI_SetPrompt("UART> ");
             mode_print_entry(g_mode);
@@ -157,16 +173,16 @@ uint8_t MODES_HandleMenuChar(char ch)
             return 1;
 
         case 'E':
-            mode_print_exit(g_mode);
+            mode_leave(g_mode);
             g_mode = MODE_SSI;
             CLI_SetPrompt("SSI> ");
             mode_print_entry(g_mode);
-            cli_printf("\r\nSSI Mode folgt.\r\n");
+            SSI_Mode_Enter();
             CLI_PrintPrompt();
             return 1;
 
         case 'D':
-            mode_print_exit(g_mode);
+            mode_leave(g_mode);
             g_mode = MODE_DIO;
             CLI_SetPrompt("DIO> ");
             mode_print_entry(g_mode);
@@ -199,6 +215,7 @@ uint8_t MODES_HandleLine(char *line)
         case MODE_SPI:   return SPI_Mode_HandleLine(line);
         case MODE_UART:  return UART_Mode_HandleLine(line);
         case MODE_CAN:   return CAN_Mode_HandleLine(line);
+        case MODE_SSI:   return SSI_Mode_HandleLine(line);
 
         default:        return 0;
     }
@@ -218,36 +235,71 @@ uint8_t MODES_HandleChar(char ch)
             return UART_Mode_HandleChar(ch);
         case MODE_CAN:
             return CAN_Mode_HandleChar(ch);
+        case MODE_SSI:
+            return SSI_Mode_HandleChar(ch);
         default:
             return 0;
     }
 }
 
 
+uint16_t MODES_HandleRaw(const uint8_t *data, uint16_t len)
+{
+    if (g_mode == MODE_UART) {
+        return UART_Mode_HandleRaw(data, len);
+    }
+    if (g_mode == MODE_SPI) {
+        return SPI_Mode_HandleRaw(data, len);
+    }
+    if (g_mode == MODE_I2C) {
+        return I2C_Mode_HandleRaw(data, len);
+    }
+    return len;
+}
+
+
 uint8_t MODES_IsRawActive(void)
 {
     if (g_mode == MODE_UART) {
         return UART_Mode_IsRawActive();
     }
+    if (g_mode == MODE_SPI) {
+        return SPI_Mode_IsRawActive();
+    }
+    if (g_mode == MODE_I2C) {
+        return I2C_Mode_IsRawActive();
+    }
     return 0;
 }
 
 
 void MODES_Poll(void)
 {
+    if (g_mode == MODE_I2C) {
+        I2C_Mode_Poll();
+    }
     if (g_mode == MODE_UART) {
         UART_Mode_Poll();
     }
+    if (g_mode == MODE_SPI) {
+        SPI_Mode_Poll();
+    }
     if (g_mode == MODE_CAN) {
             CAN_Mode_Poll();
         }
+    if (g_mode == MODE_SSI) {
+        SSI_Mode_Poll();
+    }
+    if (g_mode == MODE_DIO) {
+        DIO_Mode_Poll();
+    }
 }
 
 
 void MODES_ExitToRoot(void)
 {
     if (g_mode != MODE_NONE) {
-        mode_print_exit(g_mode);
+        mode_leave(g_mode);
     }
     g_mode = MODE_NONE;
     CLI_SetPrompt("> ");
@@ -1,4 +1,5 @@
 #include "pmic.h"
+#include "i2c_scan.h"
 #include <string.h>
 #include <ctype.h>
 
@@ -229,10 +230,14 @@ HAL_StatusTypeDef PMIC_I2C_Scan(uint8_t *out_addrs, uint32_t max_addrs, uint32_t
 {
     if (!pmic_hi2c || !out_addrs || !out_count) return HAL_ERROR;
 
+    static i2cscan_t scan;
+    HAL_StatusTypeDef st = I2CSCAN_Run(pmic_hi2c, 0x08, 0x77, &scan);
+    if (st != HAL_OK) return st;
+
     uint32_t cnt = 0;
     for (uint8_t addr = 0x08; addr <= 0x77; addr++)
     {
-        if (HAL_I2C_IsDeviceReady(pmic_hi2c, (uint16_t)(addr << 1), 1, 5) == HAL_OK)
+        if (scan.res[addr] == I2CSCAN_ACK)
         {
             if (cnt < max_addrs) out_addrs[cnt] = addr;
             cnt++;
@@ -42,5 +42,34 @@ bool ringbuf_is_empty(ringbuf_t *rb)
     return (rb->head == rb->tail);
 }
 
+uint16_t ringbuf_count(ringbuf_t *rb)
+{
+    uint16_t head = rb->head;
+    uint16_t tail = rb->tail;
+    return (head >= tail) ? (uint16_t)(head - tail) : (uint16_t)(rb->size - tail + head);
+}
+
+uint16_t ringbuf_free(ringbuf_t *rb)
+{
+    return (uint16_t)(rb->size - 1u - ringbuf_count(rb));
+}
+
+uint16_t ringbuf_peek(ringbuf_t *rb, const uint8_t **data)
+{
+    uint16_t head = rb->head;
+    uint16_t tail = rb->tail;
+    uint16_t n = (head >= tail) ? (uint16_t)(head - tail) : (uint16_t)(rb->size - tail);
+
+    if (data) *data = &rb->buf[tail];
+    return n;
+}
+
+void ringbuf_drop(ringbuf_t *rb, uint16_t len)
+{
+    uint16_t count = ringbuf_count(rb);
+    if (len > count) len = count;
+    rb->tail = (uint16_t)((rb->tail + len) % rb->size);
+}
+
 
 
@@ -0,0 +1,487 @@
+/*
+ * spi_bulk.c
+ *
+ *  DMA streaming of long SPI2 transfers (USB <-> SPI, ping-pong in D2 SRAM).
+ */
+#include "spi_bulk.h"
+#include "main.h"
+#include "cli.h"
+#include "usb_stream.h"
+#include <string.h>
+
+// ============================================================
+// SPI BULK (SPI2 Master, DMA1 Stream 4 = RX, Stream 5 = TX)
+//
+// Bus:
+//   - SPI2 als Endlos-Transfer (TSIZE = 0, CSTART einmal), die Laenge
+//     zaehlt nur die Firmware. Der Master taktet nur solange Daten im
+//     TX FIFO liegen: leerer FIFO = Takt steht, kein Underrun
+//   - MASRX: RX FIFO voll -> Master pausiert (SUSP) statt Overrun; ein
+//     langsamer Host bremst damit den Bus statt Daten zu verlieren.
+//     Weiter geht es mit CSTART sobald wieder ein RX Puffer bereit ist
+//   - 8 Bit Frames fuer die Dauer des Transfers, Clock/Mode/Frame bleiben
+//     wie vom HAL Init; CFG1/CR1 werden danach zurueckgeschrieben
+//   - CS (PI0) per Software ueber den ganzen Transfer, optional darueber
+//     hinaus (hold), z.B. mehrere bulk Abschnitte unter einem CS
+//
+// Puffer (je 2 x 4 KB in D2 SRAM):
+//   - TX: die Superloop fuellt einen Puffer (USB Rohdaten oder Prefix +
+//     Fuellbyte), der DMA sendet den anderen; der TC IRQ startet sofort
+//     den naechsten fertigen Puffer, der SPI FIFO ueberbrueckt den Wechsel
+//   - steht der TX DMA und liegen schon Bytes im Fuellpuffer, geht der
+//     angefangene Puffer sofort raus (kein Warten auf volle 4 KB)
+//   - RX: TC IRQ startet den anderen Puffer, die Superloop gibt den vollen
+//     Puffer per USBS_Write am Stueck an den Host (oder verwirft ihn)
+// ============================================================
+
+#define SPIB_SPI              SPI2
+#define SPIB_DMA_RX           DMA1_Stream4
+#define SPIB_DMA_TX           DMA1_Stream5
+#define SPIB_RX_SHIFT         (0u)      // DMA1 HISR/HIFCR Bitposition Stream 4
+#define SPIB_TX_SHIFT         (6u)      // Stream 5
+#define SPIB_DMA_FLAGS        (DMA_HISR_FEIF4 | DMA_HISR_DMEIF4 | DMA_HISR_TEIF4 | \
+                               DMA_HISR_HTIF4 | DMA_HISR_TCIF4)
+#define SPIB_SPI_IFCR_ALL     (SPI_IFCR_EOTC | SPI_IFCR_TXTFC | SPI_IFCR_UDRC | SPI_IFCR_OVRC | \
+                               SPI_IFCR_CRCEC | SPI_IFCR_TIFREC | SPI_IFCR_MODFC | \
+                               SPI_IFCR_TSERFC | SPI_IFCR_SUSPC)
+#define SPIB_SUSP_WAIT_MS     (2u)
+
+typedef struct {
+    volatile uint8_t active;
+    uint8_t src;
+    uint8_t capture;
+    uint8_t hold;
+    uint8_t fill;
+    volatile uint8_t err;           // DMA Fehler aus dem IRQ
+    uint32_t total;                 // Bytes auf dem Bus (inkl. Prefix)
+    uint32_t skip;                  // RX Bytes noch verwerfen (Prefix)
+
+    uint32_t tx_queued;             // in TX Puffer uebernommen
+    uint8_t tx_fill_idx;
+    uint16_t tx_fill_pos;
+    volatile uint16_t tx_len[2];    // 0 = frei, sonst fertig/im DMA
+    volatile uint8_t tx_dma_idx;
+    volatile uint8_t tx_busy;
+
+    volatile uint16_t rx_len[2];    // 0 = frei, sonst voll (wartet auf Host)
+    volatile uint16_t rx_cur;       // Laenge des laufenden RX DMA
+    volatile uint8_t rx_dma_idx;
+    volatile uint8_t rx_busy;
+    volatile uint32_t rx_armed;     // an den RX DMA vergeben
+    volatile uint32_t rx_done;      // geschrieben
+    uint8_t rx_out_idx;
+    uint16_t rx_out_pos;
+
+    uint32_t cfg1;                  // SPI Register vor dem Transfer
+    uint32_t cr1;
+    uint32_t t_start;
+    uint32_t t_progress;
+    uint32_t progress;
+} spib_t;
+
+typedef struct {
+    uint32_t bytes;                 // auf dem Bus
+    uint32_t to_host;
+    uint32_t ms;
+    uint32_t resumes;               // MASRX Pausen
+    uint32_t dma_err;
+    uint8_t aborted;
+} spib_stats_t;
+
+static uint8_t g_spib_tx[2][SPIB_CHUNK] D2_RAM;
+static uint8_t g_spib_rx[2][SPIB_CHUNK] D2_RAM;
+
+static spib_t g_spib;
+static spib_stats_t g_spib_stats;
+static spib_sink_t g_spib_sink;
+
+static uint32_t spib_lock(void)
+{
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    return primask;
+}
+
+static void spib_unlock(uint32_t primask)
+{
+    __set_PRIMASK(primask);
+}
+
+// ---------------- CS ----------------
+void SPIB_CsInit(void)
+{
+    GPIO_InitTypeDef gi = {0};
+
+    HAL_GPIO_WritePin(SPIB_CS_PORT, SPIB_CS_PIN, GPIO_PIN_SET);
+    gi.Pin = SPIB_CS_PIN;
+    gi.Mode = GPIO_MODE_OUTPUT_PP;
+    gi.Pull = GPIO_NOPULL;
+    gi.Speed = GPIO_SPEED_FREQ_HIGH;
+    HAL_GPIO_Init(SPIB_CS_PORT, &gi);
+}
+
+void SPIB_Cs(uint8_t active)
+{
+    SPIB_CS_PORT->BSRR = active ? ((uint32_t)SPIB_CS_PIN << 16) : (uint32_t)SPIB_CS_PIN;
+}
+
+// ---------------- DMA ----------------
+static void spib_dma_start(DMA_Stream_TypeDef *s, uint32_t shift, uint8_t *mem, uint16_t n)
+{
+    DMA1->HIFCR = SPIB_DMA_FLAGS << shift;
+    s->M0AR = (uint32_t)mem;
+    s->NDTR = n;
+    SET_BIT(s->CR, DMA_SxCR_EN);
+}
+
+static void spib_dma_off(DMA_Stream_TypeDef *s, uint32_t shift)
+{
+    CLEAR_BIT(s->CR, DMA_SxCR_EN);
+    for (uint32_t i = 0u; i < 10000u && (s->CR & DMA_SxCR_EN); i++) { }
+    DMA1->HIFCR = SPIB_DMA_FLAGS << shift;
+}
+
+// gesperrt oder aus dem IRQ: naechsten fertigen TX Puffer starten
+static void spib_tx_kick(void)
+{
+    uint8_t i = g_spib.tx_dma_idx;
+    if (g_spib.tx_busy || g_spib.tx_len[i] == 0u) return;
+
+    g_spib.tx_busy = 1u;
+    spib_dma_start(SPIB_DMA_TX, SPIB_TX_SHIFT, g_spib_tx[i], g_spib.tx_len[i]);
+}
+
+// gesperrt oder aus dem IRQ: freien RX Puffer an den DMA geben
+static void spib_rx_arm(void)
+{
+    uint8_t i = g_spib.rx_dma_idx;
+    if (g_spib.rx_busy || g_spib.rx_len[i] != 0u || g_spib.rx_armed >= g_spib.total) return;
+
+    uint32_t n = g_spib.total - g_spib.rx_armed;
+    if (n > SPIB_CHUNK) n = SPIB_CHUNK;
+
+    g_spib.rx_cur = (uint16_t)n;
+    g_spib.rx_armed += n;
+    g_spib.rx_busy = 1u;
+    spib_dma_start(SPIB_DMA_RX, SPIB_RX_SHIFT, g_spib_rx[i], (uint16_t)n);
+
+    // Master hat bei vollem RX FIFO pausiert -> weiter
+    if (SPIB_SPI->SR & SPI_SR_SUSP) {
+        SPIB_SPI->IFCR = SPI_IFCR_SUSPC;
+        SET_BIT(SPIB_SPI->CR1, SPI_CR1_CSTART);
+        g_spib_stats.resumes++;
+    }
+}
+
+// ---------------- TX Fuellpuffer ----------------
+static void spib_tx_commit(void)
+{
+    if (g_spib.tx_fill_pos == 0u) return;
+
+    uint32_t pm = spib_lock();
+    g_spib.tx_len[g_spib.tx_fill_idx] = g_spib.tx_fill_pos;
+    spib_tx_kick();
+    spib_unlock(pm);
+
+    g_spib.tx_fill_idx ^= 1u;
+    g_spib.tx_fill_pos = 0u;
+}
+
+static uint16_t spib_tx_room(void)
+{
+    if (g_spib.tx_len[g_spib.tx_fill_idx] != 0u) return 0u;   // Puffer noch im DMA
+
+    uint32_t left = g_spib.total - g_spib.tx_queued;
+    uint32_t room = SPIB_CHUNK - g_spib.tx_fill_pos;
+    return (uint16_t)((left < room) ? left : room);
+}
+
+// data == NULL: Fuellbyte
+static uint16_t spib_tx_put(const uint8_t *data, uint16_t len)
+{
+    uint16_t done = 0u;
+
+    while (done < len) {
+        uint16_t n = spib_tx_room();
+        if (n == 0u) break;
+        if (n > (uint16_t)(len - done)) n = (uint16_t)(len - done);
+
+        uint8_t *dst = &g_spib_tx[g_spib.tx_fill_idx][g_spib.tx_fill_pos];
+        if (data) memcpy(dst, &data[done], n);
+        else memset(dst, g_spib.fill, n);
+
+        g_spib.tx_fill_pos = (uint16_t)(g_spib.tx_fill_pos + n);
+        g_spib.tx_queued += n;
+        done = (uint16_t)(done + n);
+
+        if (g_spib.tx_fill_pos >= SPIB_CHUNK || g_spib.tx_queued >= g_spib.total) {
+            spib_tx_commit();
+        }
+    }
+    return done;
+}
+
+// ---------------- RX zum Host ----------------
+static void spib_rx_drain(void)
+{
+    for (;;) {
+        uint8_t i = g_spib.rx_out_idx;
+        uint16_t len = g_spib.rx_len[i];
+        if (len == 0u) return;
+
+        uint16_t pos = g_spib.rx_out_pos;
+        if (g_spib.skip > 0u) {
+            uint32_t n = (uint32_t)(len - pos);
+            if (n > g_spib.skip) n = g_spib.skip;
+            pos = (uint16_t)(pos + n);
+            g_spib.skip -= n;
+        }
+
+        if (pos < len && g_spib.capture && g_spib_sink) {
+            g_spib_sink(&g_spib_rx[i][pos], (uint16_t)(len - pos));
+            g_spib_stats.to_host += (uint32_t)(len - pos);
+        } else if (pos < len && g_spib.capture) {
+            uint16_t w = USBS_Write(&g_spib_rx[i][pos], (uint16_t)(len - pos));
+            pos = (uint16_t)(pos + w);
+            g_spib_stats.to_host += w;
+            if (pos < len) {
+                g_spib.rx_out_pos = pos;   // USB Ring voll, Bus wartet (MASRX)
+                return;
+            }
+        }
+
+        g_spib.rx_out_pos = 0u;
+        g_spib.rx_out_idx ^= 1u;
+
+        uint32_t pm = spib_lock();
+        g_spib.rx_len[i] = 0u;
+        spib_rx_arm();
+        spib_unlock(pm);
+    }
+}
+
+// ---------------- Start / Ende ----------------
+static void spib_finish(uint8_t aborted)
+{
+    SPI_TypeDef *spi = SPIB_SPI;
+
+    spib_dma_off(SPIB_DMA_TX, SPIB_TX_SHIFT);
+    spib_dma_off(SPIB_DMA_RX, SPIB_RX_SHIFT);
+    HAL_NVIC_DisableIRQ(DMA1_Stream4_IRQn);
+    HAL_NVIC_DisableIRQ(DMA1_Stream5_IRQn);
+
+    if (spi->CR1 & SPI_CR1_SPE) {
+        SET_BIT(spi->CR1, SPI_CR1_CSUSP);
+        uint32_t t0 = HAL_GetTick();
+        while (!(spi->SR & SPI_SR_SUSP) && (HAL_GetTick() - t0) < SPIB_SUSP_WAIT_MS) { }
+        CLEAR_BIT(spi->CR1, SPI_CR1_SPE);
+    }
+    spi->IFCR = SPIB_SPI_IFCR_ALL;
+    spi->CFG1 = g_spib.cfg1;
+    spi->CR1 = g_spib.cr1;
+
+    if (!g_spib.hold || aborted) SPIB_Cs(0u);
+
+    g_spib_stats.bytes = g_spib.rx_done;
+    g_spib_stats.ms = HAL_GetTick() - g_spib.t_start;
+    g_spib_stats.aborted = aborted;
+    g_spib.active = 0u;
+    if (g_spib_sink) return;
+
+    // Binaerdaten zuerst raus, dann die Abschlusszeile
+    USBS_Flush(100u);
+    cli_printf("\r\nbulk: %s, %lu Bytes, %lu ms",
+               aborted ? "ABBRUCH" : "OK",
+               (unsigned long)g_spib_stats.bytes, (unsigned long)g_spib_stats.ms);
+    if (g_spib_stats.ms > 0u) {
+        cli_printf(", %lu kB/s", (unsigned long)(g_spib_stats.bytes / g_spib_stats.ms));
+    }
+    cli_printf("\r\n");
+    CLI_PrintPrompt();
+}
+
+HAL_StatusTypeDef SPIB_Start(spib_src_t src, uint32_t total, const uint8_t *pre,
+                             uint8_t plen, uint8_t fill, uint8_t capture, uint8_t hold)
+{
+    SPI_TypeDef *spi = SPIB_SPI;
+
+    if (g_spib.active) return HAL_BUSY;
+    if (total == 0u || plen > SPIB_PRE_MAX || plen > total) return HAL_ERROR;
+    if (src != SPIB_SRC_FILL) plen = 0u;
+    if (spi->CR1 & SPI_CR1_SPE) return HAL_BUSY;
+
+    memset(&g_spib, 0, sizeof(g_spib));
+    memset(&g_spib_stats, 0, sizeof(g_spib_stats));
+    g_spib.src = (uint8_t)src;
+    g_spib.total = total;
+    g_spib.skip = plen;
+    g_spib.fill = fill;
+    g_spib.capture = capture ? 1u : 0u;
+    g_spib.hold = hold ? 1u : 0u;
+
+    // DMA1 S4: RXDR -> Speicher, S5: Speicher -> TXDR, je Byte, Direct Mode
+    spib_dma_off(SPIB_DMA_RX, SPIB_RX_SHIFT);
+    spib_dma_off(SPIB_DMA_TX, SPIB_TX_SHIFT);
+    DMAMUX1_Channel4->CCR = DMA_REQUEST_SPI2_RX;
+    DMAMUX1_Channel5->CCR = DMA_REQUEST_SPI2_TX;
+    SPIB_DMA_RX->CR = DMA_SxCR_MINC | DMA_SxCR_PL_1 | DMA_SxCR_TCIE | DMA_SxCR_TEIE;
+    SPIB_DMA_RX->PAR = (uint32_t)&spi->RXDR;
+    SPIB_DMA_RX->FCR = 0u;
+    SPIB_DMA_TX->CR = DMA_SxCR_DIR_0 | DMA_SxCR_MINC | DMA_SxCR_PL_0 | DMA_SxCR_TCIE | DMA_SxCR_TEIE;
+    SPIB_DMA_TX->PAR = (uint32_t)&spi->TXDR;
+    SPIB_DMA_TX->FCR = 0u;
+    HAL_NVIC_SetPriority(DMA1_Stream4_IRQn, SPIB_DMA_IRQ_PRIO, 0);
+    HAL_NVIC_SetPriority(DMA1_Stream5_IRQn, SPIB_DMA_IRQ_PRIO, 0);
+    HAL_NVIC_EnableIRQ(DMA1_Stream4_IRQn);
+    HAL_NVIC_EnableIRQ(DMA1_Stream5_IRQn);
+
+    // SPI: 8 Bit, FIFO Schwelle 1, Endlos-Transfer, MASRX
+    g_spib.cfg1 = spi->CFG1;
+    g_spib.cr1 = spi->CR1;
+    MODIFY_REG(spi->CFG1, SPI_CFG1_DSIZE | SPI_CFG1_FTHLV | SPI_CFG1_TXDMAEN | SPI_CFG1_RXDMAEN,
+               (7u << SPI_CFG1_DSIZE_Pos));
+    MODIFY_REG(spi->CR2, SPI_CR2_TSIZE, 0u);
+    SET_BIT(spi->CR1, SPI_CR1_MASRX);
+    spi->IFCR = SPIB_SPI_IFCR_ALL;
+
+    // Reihenfolge laut RM: RXDMAEN, DMA Streams, TXDMAEN, SPE
+    SET_BIT(spi->CFG1, SPI_CFG1_RXDMAEN);
+    uint32_t pm = spib_lock();
+    spib_rx_arm();
+    spib_unlock(pm);
+
+    if (src == SPIB_SRC_FILL) {
+        if (plen > 0u) (void)spib_tx_put(pre, plen);
+        (void)spib_tx_put(NULL, SPIB_CHUNK);
+    }
+    SET_BIT(spi->CFG1, SPI_CFG1_TXDMAEN);
+
+    SPIB_Cs(1u);
+    g_spib.active = 1u;
+    g_spib.t_start = HAL_GetTick();
+    g_spib.t_progress = g_spib.t_start;
+
+    SET_BIT(spi->CR1, SPI_CR1_SPE);
+    SET_BIT(spi->CR1, SPI_CR1_CSTART);
+    return HAL_OK;
+}
+
+void SPIB_SetSink(spib_sink_t sink)
+{
+    g_spib_sink = sink;
+}
+
+uint8_t SPIB_LastAborted(void)
+{
+    return g_spib_stats.aborted;
+}
+
+void SPIB_Stop(void)
+{
+    if (!g_spib.active) return;
+    spib_finish(1u);
+}
+
+uint8_t SPIB_IsActive(void)
+{
+    return g_spib.active;
+}
+
+uint8_t SPIB_IsRawActive(void)
+{
+    return (g_spib.active && g_spib.src == SPIB_SRC_USB &&
+            g_spib.tx_queued < g_spib.total) ? 1u : 0u;
+}
+
+uint16_t SPIB_Feed(const uint8_t *data, uint16_t len)
+{
+    if (!SPIB_IsRawActive()) return len;
+    return spib_tx_put(data, len);
+}
+
+void SPIB_Poll(void)
+{
+    if (!g_spib.active) return;
+
+    if (g_spib.err) {
+        cli_printf("\r\nbulk: DMA Fehler\r\n");
+        spib_finish(1u);
+        return;
+    }
+
+    if (g_spib.src == SPIB_SRC_FILL) {
+        while (g_spib.tx_queued < g_spib.total && spib_tx_put(NULL, SPIB_CHUNK) > 0u) { }
+    }
+
+    // DMA steht, angefangener Puffer -> sofort senden
+    if (!g_spib.tx_busy && g_spib.tx_fill_pos > 0u) {
+        spib_tx_commit();
+    }
+
+    spib_rx_drain();
+
+    if (g_spib.rx_done >= g_spib.total && g_spib.rx_len[0] == 0u && g_spib.rx_len[1] == 0u) {
+        spib_finish(0u);
+        return;
+    }
+
+    uint32_t now = HAL_GetTick();
+    uint32_t progress = g_spib.tx_queued + g_spib.rx_done + g_spib_stats.to_host;
+    if (progress != g_spib.progress) {
+        g_spib.progress = progress;
+        g_spib.t_progress = now;
+    } else if ((now - g_spib.t_progress) > SPIB_IDLE_TIMEOUT_MS) {
+        cli_printf("\r\nbulk: Timeout (%lu von %lu Bytes)\r\n",
+                   (unsigned long)g_spib.rx_done, (unsigned long)g_spib.total);
+        spib_finish(1u);
+    }
+}
+
+void SPIB_PrintStats(void)
+{
+    if (g_spib.active) {
+        cli_printf("\r\nbulk: aktiv, %lu/%lu Bytes, TX %lu, Host %lu, Pausen %lu\r\n",
+                   (unsigned long)g_spib.rx_done, (unsigned long)g_spib.total,
+                   (unsigned long)g_spib.tx_queued, (unsigned long)g_spib_stats.to_host,
+                   (unsigned long)g_spib_stats.resumes);
+        return;
+    }
+    cli_printf("\r\nbulk: letzter Transfer %s\r\n", g_spib_stats.aborted ? "ABBRUCH" : "OK");
+    cli_printf("  Bytes  : %lu (Host %lu)\r\n",
+               (unsigned long)g_spib_stats.bytes, (unsigned long)g_spib_stats.to_host);
+    cli_printf("  Zeit   : %lu ms\r\n", (unsigned long)g_spib_stats.ms);
+    cli_printf("  Pausen : %lu (RX voll)\r\n", (unsigned long)g_spib_stats.resumes);
+    cli_printf("  DMA Err: %lu\r\n", (unsigned long)g_spib_stats.dma_err);
+}
+
+// ---------------- IRQ ----------------
+void SPIB_DmaIRQHandler(uint8_t tx)
+{
+    uint32_t shift = tx ? SPIB_TX_SHIFT : SPIB_RX_SHIFT;
+    uint32_t isr = (DMA1->HISR >> shift) & SPIB_DMA_FLAGS;
+    DMA1->HIFCR = isr << shift;
+
+    if (!g_spib.active) return;
+
+    if (isr & (DMA_HISR_TEIF4 | DMA_HISR_DMEIF4)) {
+        g_spib_stats.dma_err++;
+        g_spib.err = 1u;
+        return;
+    }
+    if (!(isr & DMA_HISR_TCIF4)) return;
+
+    if (tx) {
+        uint8_t i = g_spib.tx_dma_idx;
+        g_spib.tx_len[i] = 0u;
+        g_spib.tx_dma_idx ^= 1u;
+        g_spib.tx_busy = 0u;
+        spib_tx_kick();
+    } else {
+        uint8_t i = g_spib.rx_dma_idx;
+        g_spib.rx_len[i] = g_spib.rx_cur;
+        g_spib.rx_done += g_spib.rx_cur;
+        g_spib.rx_dma_idx ^= 1u;
+        g_spib.rx_busy = 0u;
+        spib_rx_arm();
+    }
+}
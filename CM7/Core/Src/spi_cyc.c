@@ -0,0 +1,173 @@
+/*
+ * spi_cyc.c
+ *
+ *  Periodic SPI2 sampler: one transaction template fired by TIM3, streamed in blocks.
+ */
+#include "spi_cyc.h"
+#include "spi_trig.h"
+#include "usb_stream.h"
+#include "cli.h"
+#include <string.h>
+
+// ============================================================
+// SPI CYC (Sensor Streaming, SPI2 Master)
+//
+//   - Transaktion = TX Vorlage (Befehl + Dummy Bytes), laeuft per
+//     spi_trig.c: TIM3 startet sie, DMA sendet die Vorlage und legt die
+//     RX Bytes in den D2 Ring; CS per Hardware genau um die Transaktion
+//   - Superloop: nur Bloecke bauen, kein Zugriff pro Sample auf den Bus
+//   - Block zum Host: Header (sync 5AA5, Anzahl, seq des ersten Samples,
+//     little endian) + Samples am Stueck. seq zaehlt Trigger inkl.
+//     verlorener Samples, eine Luecke ist also am Host sichtbar
+//   - Block geht raus wenn SPCYC_BLOCK_MAX voll ist oder das aelteste
+//     Sample SPCYC_FLUSH_MS wartet; passt er nicht in usb_stream, bleibt
+//     er im Ring (Drop erst bei Ring Overrun)
+// ============================================================
+
+typedef struct {
+    volatile uint8_t active;
+    uint16_t rec;
+    uint32_t hz;
+    uint32_t seq;
+    uint32_t t_wait;            // seit wann liegen Samples bereit
+    uint8_t waiting;
+    uint32_t samples;
+    uint32_t blocks;
+    uint32_t drops;
+    uint32_t t_start;
+} spcyc_t;
+
+static spcyc_t g_spcyc;
+
+HAL_StatusTypeDef SPCYC_Start(uint32_t hz, const uint8_t *tx, uint16_t frames, uint8_t width,
+                              uint8_t hw_cs)
+{
+    if (g_spcyc.active) return HAL_BUSY;
+    if (hz == 0u || !tx) return HAL_ERROR;
+
+    sptrg_cfg_t tc;
+    memset(&tc, 0, sizeof(tc));
+    tc.period_us = 1000000u / hz;
+    tc.frames = frames;
+    tc.width = width;
+    tc.tx = tx;
+    tc.hw_cs = hw_cs;
+    if ((uint32_t)frames * width > SPCYC_BLOCK_MAX) return HAL_ERROR;
+
+    memset(&g_spcyc, 0, sizeof(g_spcyc));
+    g_spcyc.rec = (uint16_t)(frames * width);
+    g_spcyc.hz = hz;
+
+    HAL_StatusTypeDef st = SPTRG_Start(&tc);
+    if (st != HAL_OK) return st;
+    g_spcyc.active = 1u;
+    g_spcyc.t_start = HAL_GetTick();
+    return HAL_OK;
+}
+
+// ein Block; return 0 wenn nichts (mehr) gesendet werden kann
+static uint8_t spcyc_send_block(uint8_t force)
+{
+    uint32_t n = 0u;
+    const uint8_t *p = SPTRG_Peek(&n);
+    uint32_t max = SPCYC_BLOCK_MAX / g_spcyc.rec;
+
+    if (n == 0u) {
+        g_spcyc.waiting = 0u;
+        return 0u;
+    }
+    if (!g_spcyc.waiting) {
+        g_spcyc.waiting = 1u;
+        g_spcyc.t_wait = HAL_GetTick();
+    }
+    if (n > max) n = max;
+    // kleiner Block nur bei Timeout, Ringende oder Stop
+    if (n < max && !force && (HAL_GetTick() - g_spcyc.t_wait) < SPCYC_FLUSH_MS &&
+        SPTRG_Available() == n) {
+        return 0u;
+    }
+
+    uint32_t payload = n * g_spcyc.rec;
+    if (USBS_Free() < SPCYC_HDR_SIZE + payload) return 0u;
+
+    uint8_t hdr[SPCYC_HDR_SIZE];
+    hdr[0] = (uint8_t)(SPCYC_SYNC & 0xFFu);
+    hdr[1] = (uint8_t)(SPCYC_SYNC >> 8);
+    hdr[2] = (uint8_t)(n & 0xFFu);
+    hdr[3] = (uint8_t)(n >> 8);
+    hdr[4] = (uint8_t)(g_spcyc.seq & 0xFFu);
+    hdr[5] = (uint8_t)((g_spcyc.seq >> 8) & 0xFFu);
+    hdr[6] = (uint8_t)((g_spcyc.seq >> 16) & 0xFFu);
+    hdr[7] = (uint8_t)(g_spcyc.seq >> 24);
+    (void)USBS_Write(hdr, SPCYC_HDR_SIZE);
+    (void)USBS_Write(p, (uint16_t)payload);
+
+    SPTRG_Drop(n);
+    g_spcyc.seq += n;
+    g_spcyc.samples += n;
+    g_spcyc.blocks++;
+    g_spcyc.waiting = 0u;
+    return 1u;
+}
+
+void SPCYC_Poll(void)
+{
+    if (!g_spcyc.active) return;
+
+    uint32_t lost = SPTRG_TakeDrops();
+    if (lost) {
+        g_spcyc.drops += lost;
+        g_spcyc.seq += lost;
+    }
+
+    for (uint8_t i = 0u; i < 4u; i++) {
+        if (!spcyc_send_block(0u)) break;
+    }
+}
+
+void SPCYC_Stop(void)
+{
+    sptrg_stats_t st;
+
+    if (!g_spcyc.active) return;
+
+    SPTRG_GetStats(&st);
+    SPTRG_Stop();
+    for (uint8_t i = 0u; i < 8u; i++) {
+        uint32_t lost = SPTRG_TakeDrops();
+        g_spcyc.drops += lost;
+        g_spcyc.seq += lost;
+        if (!spcyc_send_block(1u)) break;
+    }
+    g_spcyc.active = 0u;
+    USBS_Flush(50u);
+
+    uint32_t got = st.records + st.ring_drops;
+    cli_printf("\r\ncyc: Stop, %lu Samples in %lu Bloecken, Drops %lu, Trigger verpasst %lu\r\n",
+               (unsigned long)g_spcyc.samples, (unsigned long)g_spcyc.blocks,
+               (unsigned long)g_spcyc.drops,
+               (unsigned long)((st.expected > got + 1u) ? (st.expected - got - 1u) : 0u));
+}
+
+uint8_t SPCYC_IsActive(void)
+{
+    return g_spcyc.active;
+}
+
+void SPCYC_PrintStats(void)
+{
+    sptrg_stats_t st;
+
+    if (!g_spcyc.active) {
+        cli_printf("\r\ncyc: nicht aktiv, zuletzt %lu Samples, Drops %lu\r\n",
+                   (unsigned long)g_spcyc.samples, (unsigned long)g_spcyc.drops);
+        return;
+    }
+    SPTRG_GetStats(&st);
+    cli_printf("\r\ncyc: %lu Hz, %u Bytes/Sample, %lu s\r\n", (unsigned long)g_spcyc.hz,
+               (unsigned)g_spcyc.rec, (unsigned long)((HAL_GetTick() - g_spcyc.t_start) / 1000u));
+    cli_printf("  Samples : %lu (Host %lu, %lu Bloecke)\r\n", (unsigned long)st.records,
+               (unsigned long)g_spcyc.samples, (unsigned long)g_spcyc.blocks);
+    cli_printf("  Trigger : %lu erwartet\r\n", (unsigned long)st.expected);
+    cli_printf("  Drops   : %lu (Ring voll, Host zu langsam)\r\n", (unsigned long)st.ring_drops);
+}
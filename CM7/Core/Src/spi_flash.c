@@ -0,0 +1,671 @@
+/*
+ * spi_flash.c
+ *
+ *  SPI NOR flash engine on SPI2 (JEDEC/SFDP probe, read, erase, program, CRC32).
+ */
+#include "spi_flash.h"
+#include "spi_bulk.h"
+#include "spi_trig.h"
+#include "spi.h"
+#include "cli.h"
+#include "crc_util.h"
+#include <string.h>
+
+// ============================================================
+// SPI NOR FLASH
+//
+// Erkennung:
+//   - JEDEC ID (9F), dann SFDP (5A): Basic Flash Parameter Table liefert
+//     Groesse, Adressbreite, Erase Typen (Groesse + Opcode), Page Size;
+//     bei > 16 MB 4-Byte Opcodes aus der 4BAIT Tabelle, sonst EN4B (B7)
+//   - ohne SFDP: Groesse aus dem dritten ID Byte, 256 B Pages, 4K/64K
+//   - gelesen wird immer mit Fast Read 1-1-1 (0B / 0C), nur MOSI/MISO
+//     sind verdrahtet
+//
+// Ablauf (alles nicht blockierend aus SNOR_Poll):
+//   - read/crc: ein bulk Transfer (spi_bulk.c, DMA) mit Befehl + Adresse
+//     als Prefix; crc haengt einen Sink statt USB an
+//   - write: Rohdaten vom Host laufen in 8 Page-Slots (schon an Page
+//     Grenzen geschnitten), waehrend der Flash programmiert (WIP) kommen
+//     die naechsten USB Pakete -> USB und Programmierung ueberlappen.
+//     CRC32 laeuft beim Empfang mit, Verify = CRC ueber den Flash-Inhalt
+//     auf dem Geraet, kein Readback ueber USB
+//   - erase: groesster passender Erase Typ pro Schritt (aligned), WIP
+//     Polling mit Timeout pro Typ
+// ============================================================
+
+#define SNOR_OP_WREN          (0x06u)
+#define SNOR_OP_RDSR          (0x05u)
+#define SNOR_OP_JEDEC         (0x9Fu)
+#define SNOR_OP_SFDP          (0x5Au)
+#define SNOR_OP_EN4B          (0xB7u)
+#define SNOR_OP_CHIP_ERASE    (0xC7u)
+#define SNOR_SR_WIP           (0x01u)
+#define SNOR_SR_WEL           (0x02u)
+
+#define SNOR_SFDP_SIG         (0x50444653u)   // "SFDP"
+#define SNOR_SFDP_ID_BFPT     (0xFF00u)
+#define SNOR_SFDP_ID_4BAIT    (0xFF84u)
+#define SNOR_SFDP_PH_MAX      (8u)
+#define SNOR_BFPT_DW_MAX      (16u)
+
+typedef enum {
+    SNOR_OP_IDLE = 0,
+    SNOR_OP_ERASE,
+    SNOR_OP_WRITE,
+    SNOR_OP_VERIFY,                 // CRC Readback nach write
+    SNOR_OP_CRC,
+    SNOR_OP_READ,
+} snor_op_t;
+
+typedef struct {
+    uint32_t addr;
+    uint16_t len;                   // 0 = Slot frei
+    uint16_t pos;
+    uint8_t data[SNOR_PAGE_MAX];
+} snor_slot_t;
+
+typedef struct {
+    snor_op_t op;
+    uint8_t busy;                   // Flash intern beschaeftigt (WIP)
+    uint8_t chip;                   // Chip Erase
+    uint8_t verify;
+    uint32_t start;
+    uint32_t addr;                  // naechste Adresse (erase/program)
+    uint32_t end;
+    uint32_t fed;                   // write: naechste Adresse vom Host
+    uint32_t crc;                   // write: ueber die Host-Daten
+    uint32_t crc_rd;                // Readback
+    uint32_t wait_ms;
+    uint32_t t_start;
+    uint32_t t_op;
+    uint32_t t_progress;
+    uint32_t pages;
+    uint8_t wr;
+    uint8_t rd;
+    uint8_t count;
+} snor_job_t;
+
+static snor_info_t g_snor;
+static snor_job_t g_job;
+static snor_slot_t g_snor_slot[SNOR_SLOTS];
+
+// ---------------- SPI Zugriffe (blockierend, kurz) ----------------
+static HAL_StatusTypeDef snor_xfer(const uint8_t *hdr, uint16_t hlen, uint8_t *rx, uint16_t rlen)
+{
+    HAL_StatusTypeDef st;
+
+    SPIB_Cs(1u);
+    st = HAL_SPI_Transmit(&hspi2, (uint8_t *)hdr, hlen, SNOR_SPI_TIMEOUT_MS);
+    if (st == HAL_OK && rx && rlen > 0u) {
+        st = HAL_SPI_Receive(&hspi2, rx, rlen, SNOR_SPI_TIMEOUT_MS);
+    }
+    SPIB_Cs(0u);
+    return st;
+}
+
+static HAL_StatusTypeDef snor_write_cmd(const uint8_t *hdr, uint16_t hlen, const uint8_t *data, uint16_t dlen)
+{
+    HAL_StatusTypeDef st;
+
+    SPIB_Cs(1u);
+    st = HAL_SPI_Transmit(&hspi2, (uint8_t *)hdr, hlen, SNOR_SPI_TIMEOUT_MS);
+    if (st == HAL_OK && data && dlen > 0u) {
+        st = HAL_SPI_Transmit(&hspi2, (uint8_t *)data, dlen, SNOR_SPI_TIMEOUT_MS);
+    }
+    SPIB_Cs(0u);
+    return st;
+}
+
+static int snor_rdsr(void)
+{
+    uint8_t op = SNOR_OP_RDSR;
+    uint8_t sr = 0u;
+    if (snor_xfer(&op, 1u, &sr, 1u) != HAL_OK) return -1;
+    return sr;
+}
+
+static HAL_StatusTypeDef snor_wren(void)
+{
+    uint8_t op = SNOR_OP_WREN;
+    if (snor_write_cmd(&op, 1u, NULL, 0u) != HAL_OK) return HAL_ERROR;
+    int sr = snor_rdsr();
+    if (sr < 0 || !(sr & SNOR_SR_WEL)) return HAL_ERROR;
+    return HAL_OK;
+}
+
+// Befehl + Adresse (3/4 Byte), return Laenge
+static uint8_t snor_hdr(uint8_t *b, uint8_t op, uint32_t addr)
+{
+    uint8_t n = 0u;
+    b[n++] = op;
+    if (g_snor.addr_bytes == 4u) b[n++] = (uint8_t)(addr >> 24);
+    b[n++] = (uint8_t)(addr >> 16);
+    b[n++] = (uint8_t)(addr >> 8);
+    b[n++] = (uint8_t)addr;
+    return n;
+}
+
+static HAL_StatusTypeDef snor_sfdp_read(uint32_t addr, uint8_t *buf, uint16_t len)
+{
+    uint8_t hdr[5] = { SNOR_OP_SFDP, (uint8_t)(addr >> 16), (uint8_t)(addr >> 8), (uint8_t)addr, 0u };
+    return snor_xfer(hdr, sizeof(hdr), buf, len);
+}
+
+static uint32_t snor_le32(const uint8_t *p)
+{
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static uint8_t snor_spi_ready(void)
+{
+    if (SPIB_IsActive()) {
+        cli_printf("\r\nflash: SPI2 belegt (bulk aktiv)\r\n");
+        return 0u;
+    }
+    if (SPTRG_IsActive()) {
+        cli_printf("\r\nflash: SPI2 belegt (cyc aktiv)\r\n");
+        return 0u;
+    }
+    if (hspi2.Init.DataSize != SPI_DATASIZE_8BIT) {
+        cli_printf("\r\nflash: Datasize 8 Bit noetig (Setup s -> 5)\r\n");
+        return 0u;
+    }
+    return 1u;
+}
+
+// ---------------- Erkennung ----------------
+static void snor_add_erase(uint32_t size, uint8_t op)
+{
+    if (size == 0u || op == 0u || op == 0xFFu || g_snor.n_erase >= SNOR_ERASE_TYPES) return;
+
+    uint8_t i = g_snor.n_erase++;
+    while (i > 0u && g_snor.erase[i - 1u].size > size) {
+        g_snor.erase[i] = g_snor.erase[i - 1u];
+        i--;
+    }
+    g_snor.erase[i].size = size;
+    g_snor.erase[i].op = op;
+}
+
+static void snor_defaults(void)
+{
+    uint8_t cap = g_snor.jedec[2];
+
+    g_snor.size = (cap >= 0x10u && cap <= 0x22u) ? (1u << cap) : 0u;
+    g_snor.page = 256u;
+    g_snor.addr_bytes = (g_snor.size > 0x1000000u) ? 4u : 3u;
+    g_snor.n_erase = 0u;
+    snor_add_erase(4096u, 0x20u);
+    snor_add_erase(65536u, 0xD8u);
+}
+
+static HAL_StatusTypeDef snor_parse_sfdp(void)
+{
+    uint8_t hdr[8];
+    uint8_t ph[8];
+    uint8_t bfpt[SNOR_BFPT_DW_MAX * 4u];
+    uint32_t bfpt_ptp = 0u, bfpt_len = 0u;
+    uint32_t ai_ptp = 0u, ai_len = 0u;
+
+    if (snor_sfdp_read(0u, hdr, sizeof(hdr)) != HAL_OK) return HAL_ERROR;
+    if (snor_le32(hdr) != SNOR_SFDP_SIG) return HAL_ERROR;
+
+    g_snor.sfdp_minor = hdr[4];
+    g_snor.sfdp_major = hdr[5];
+    uint8_t nph = (uint8_t)(hdr[6] + 1u);
+    if (nph > SNOR_SFDP_PH_MAX) nph = SNOR_SFDP_PH_MAX;
+
+    for (uint8_t i = 0u; i < nph; i++) {
+        if (snor_sfdp_read(8u + 8u * i, ph, sizeof(ph)) != HAL_OK) return HAL_ERROR;
+        uint16_t id = (uint16_t)(ph[0] | ((uint16_t)ph[7] << 8));
+        uint32_t ptp = (uint32_t)ph[4] | ((uint32_t)ph[5] << 8) | ((uint32_t)ph[6] << 16);
+        if (id == SNOR_SFDP_ID_BFPT && bfpt_len == 0u) { bfpt_ptp = ptp; bfpt_len = ph[3]; }
+        if (id == SNOR_SFDP_ID_4BAIT) { ai_ptp = ptp; ai_len = ph[3]; }
+    }
+    if (bfpt_len < 9u) return HAL_ERROR;       // JESD216: mindestens 9 DWORDs
+    if (bfpt_len > SNOR_BFPT_DW_MAX) bfpt_len = SNOR_BFPT_DW_MAX;
+    if (snor_sfdp_read(bfpt_ptp, bfpt, (uint16_t)(bfpt_len * 4u)) != HAL_OK) return HAL_ERROR;
+
+    uint32_t dw1 = snor_le32(&bfpt[0]);
+    uint32_t dw2 = snor_le32(&bfpt[4]);
+
+    // Dichte in Bit: Bit 31 = 2^N, sonst N+1
+    if (dw2 & 0x80000000u) {
+        uint32_t n = dw2 & 0x7FFFFFFFu;
+        g_snor.size = (n >= 3u && n < 35u) ? (1u << (n - 3u)) : 0u;
+    } else {
+        g_snor.size = (dw2 + 1u) / 8u;
+    }
+
+    uint8_t abytes = (uint8_t)((dw1 >> 17) & 0x3u);   // 0: 3, 1: 3/4, 2: 4
+    g_snor.addr_bytes = (abytes == 2u || g_snor.size > 0x1000000u) ? 4u : 3u;
+
+    g_snor.n_erase = 0u;
+    for (uint8_t t = 0u; t < SNOR_ERASE_TYPES; t++) {
+        uint32_t dw = snor_le32(&bfpt[(7u + t / 2u) * 4u]);
+        uint8_t sh = (uint8_t)((t & 1u) * 16u);
+        uint8_t n = (uint8_t)(dw >> sh);
+        uint8_t op = (uint8_t)(dw >> (sh + 8u));
+        if (n != 0u && n < 32u) snor_add_erase(1u << n, op);
+    }
+    if (g_snor.n_erase == 0u && (dw1 & 0x3u) == 0x1u) {
+        snor_add_erase(4096u, (uint8_t)(dw1 >> 8));
+    }
+
+    g_snor.page = 256u;
+    if (bfpt_len >= 11u) {
+        uint8_t n = (uint8_t)((snor_le32(&bfpt[40]) >> 4) & 0xFu);
+        if (n >= 4u && (1u << n) <= SNOR_PAGE_MAX) g_snor.page = (uint16_t)(1u << n);
+    }
+
+    // > 16 MB: eigene 4-Byte Opcodes wenn Fast Read + PP dabei sind
+    if (g_snor.addr_bytes == 4u && ai_len >= 2u) {
+        uint8_t ai[8];
+        if (snor_sfdp_read(ai_ptp, ai, sizeof(ai)) == HAL_OK) {
+            uint32_t sup = snor_le32(&ai[0]);
+            uint32_t ops = snor_le32(&ai[4]);
+            if ((sup & (1u << 1)) && (sup & (1u << 6))) {
+                snor_erase_t old[SNOR_ERASE_TYPES];
+                uint8_t n_old = g_snor.n_erase;
+                memcpy(old, g_snor.erase, sizeof(old));
+
+                g_snor.en4b = 0u;
+                g_snor.op_read = 0x0Cu;
+                g_snor.op_pp = 0x12u;
+                g_snor.n_erase = 0u;
+                for (uint8_t t = 0u; t < SNOR_ERASE_TYPES; t++) {
+                    uint32_t dw = snor_le32(&bfpt[(7u + t / 2u) * 4u]);
+                    uint8_t n = (uint8_t)(dw >> ((t & 1u) * 16u));
+                    if (n != 0u && n < 32u && (sup & (1u << (9u + t)))) {
+                        snor_add_erase(1u << n, (uint8_t)(ops >> (8u * t)));
+                    }
+                }
+                if (g_snor.n_erase == 0u) {          // nur EN4B fuer Erase
+                    g_snor.n_erase = n_old;
+                    memcpy(g_snor.erase, old, sizeof(old));
+                    g_snor.en4b = 1u;
+                    g_snor.op_read = 0x0Bu;
+                    g_snor.op_pp = 0x02u;
+                }
+            }
+        }
+    }
+
+    g_snor.sfdp = 1u;
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef SNOR_Probe(void)
+{
+    if (!snor_spi_ready()) return HAL_BUSY;
+
+    memset(&g_snor, 0, sizeof(g_snor));
+
+    uint8_t op = SNOR_OP_JEDEC;
+    if (snor_xfer(&op, 1u, g_snor.jedec, 3u) != HAL_OK) return HAL_ERROR;
+    if ((g_snor.jedec[0] == 0x00u && g_snor.jedec[1] == 0x00u) ||
+        (g_snor.jedec[0] == 0xFFu && g_snor.jedec[1] == 0xFFu)) {
+        return HAL_ERROR;
+    }
+
+    g_snor.en4b = 1u;
+    g_snor.op_read = 0x0Bu;
+    g_snor.op_pp = 0x02u;
+    if (snor_parse_sfdp() != HAL_OK) {
+        g_snor.sfdp = 0u;
+        snor_defaults();
+    }
+    if (g_snor.addr_bytes == 3u) {
+        g_snor.en4b = 0u;
+    }
+    g_snor.read_dummy = 1u;
+
+    if (g_snor.addr_bytes == 4u && g_snor.en4b) {
+        op = SNOR_OP_EN4B;
+        (void)snor_write_cmd(&op, 1u, NULL, 0u);
+    }
+
+    g_snor.valid = (g_snor.size > 0u && g_snor.n_erase > 0u) ? 1u : 0u;
+    return g_snor.valid ? HAL_OK : HAL_ERROR;
+}
+
+const snor_info_t *SNOR_Info(void)
+{
+    return &g_snor;
+}
+
+void SNOR_PrintInfo(void)
+{
+    cli_printf("\r\nJEDEC ID: %02X %02X %02X\r\n",
+               g_snor.jedec[0], g_snor.jedec[1], g_snor.jedec[2]);
+    if (g_snor.sfdp) {
+        cli_printf("SFDP    : Rev %u.%u\r\n", (unsigned)g_snor.sfdp_major, (unsigned)g_snor.sfdp_minor);
+    } else {
+        cli_printf("SFDP    : nicht vorhanden, Defaults aus JEDEC ID\r\n");
+    }
+    cli_printf("Groesse : %lu KB\r\n", (unsigned long)(g_snor.size / 1024u));
+    cli_printf("Page    : %u B\r\n", (unsigned)g_snor.page);
+    cli_printf("Adresse : %u Byte%s\r\n", (unsigned)g_snor.addr_bytes,
+               (g_snor.addr_bytes == 4u) ? (g_snor.en4b ? " (EN4B)" : " (4B Opcodes)") : "");
+    cli_printf("Read    : %02X (%u Dummy), PP %02X\r\n",
+               g_snor.op_read, (unsigned)g_snor.read_dummy, g_snor.op_pp);
+    cli_printf("Erase   :");
+    for (uint8_t i = 0u; i < g_snor.n_erase; i++) {
+        uint32_t sz = g_snor.erase[i].size;
+        if (sz >= 1024u) cli_printf(" %luK=%02X", (unsigned long)(sz / 1024u), g_snor.erase[i].op);
+        else cli_printf(" %lu=%02X", (unsigned long)sz, g_snor.erase[i].op);
+    }
+    cli_printf("\r\n");
+}
+
+// ---------------- Job Verwaltung ----------------
+static uint8_t snor_check(uint32_t addr, uint32_t len)
+{
+    if (g_job.op != SNOR_OP_IDLE) {
+        cli_printf("\r\nflash: belegt\r\n");
+        return 0u;
+    }
+    if (!snor_spi_ready()) return 0u;
+    if (!g_snor.valid && SNOR_Probe() != HAL_OK) {
+        cli_printf("\r\nflash: kein Flash erkannt\r\n");
+        return 0u;
+    }
+    if (len > 0u && (addr >= g_snor.size || len > g_snor.size - addr)) {
+        cli_printf("\r\nflash: Bereich ausserhalb (Groesse %lu)\r\n", (unsigned long)g_snor.size);
+        return 0u;
+    }
+    return 1u;
+}
+
+static void snor_crc_sink(const uint8_t *data, uint16_t len)
+{
+    g_job.crc_rd = CRC32_Update(g_job.crc_rd, data, len);
+}
+
+static HAL_StatusTypeDef snor_start_read(uint32_t addr, uint32_t len, uint8_t to_host)
+{
+    uint8_t pre[SPIB_PRE_MAX];
+    uint8_t plen = snor_hdr(pre, g_snor.op_read, addr);
+    for (uint8_t i = 0u; i < g_snor.read_dummy; i++) pre[plen++] = 0u;
+
+    g_job.crc_rd = CRC32_INIT;
+    SPIB_SetSink(to_host ? NULL : snor_crc_sink);
+    HAL_StatusTypeDef st = SPIB_Start(SPIB_SRC_FILL, len + plen, pre, plen, 0xFFu, 1u, 0u);
+    if (st != HAL_OK) SPIB_SetSink(NULL);
+    return st;
+}
+
+static void snor_done(const char *msg)
+{
+    uint32_t ms = HAL_GetTick() - g_job.t_start;
+
+    SPIB_SetSink(NULL);
+    if (msg) cli_printf("\r\nflash: %s\r\n", msg);
+    cli_printf("\r\nflash: %lu ms\r\n", (unsigned long)ms);
+    g_job.op = SNOR_OP_IDLE;
+    CLI_PrintPrompt();
+}
+
+static void snor_fail(const char *msg)
+{
+    cli_printf("\r\nflash: FEHLER %s @ 0x%08lX\r\n", msg, (unsigned long)g_job.addr);
+    if (SPIB_IsActive()) SPIB_Stop();
+    snor_done(NULL);
+}
+
+HAL_StatusTypeDef SNOR_Read(uint32_t addr, uint32_t len)
+{
+    if (len == 0u || !snor_check(addr, len)) return HAL_ERROR;
+
+    memset(&g_job, 0, sizeof(g_job));
+    g_job.t_start = HAL_GetTick();
+    cli_printf("\r\nflash read: 0x%08lX %lu Bytes\r\n", (unsigned long)addr, (unsigned long)len);
+    if (snor_start_read(addr, len, 1u) != HAL_OK) return HAL_ERROR;
+    g_job.op = SNOR_OP_READ;
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef SNOR_Crc(uint32_t addr, uint32_t len)
+{
+    if (len == 0u || !snor_check(addr, len)) return HAL_ERROR;
+
+    memset(&g_job, 0, sizeof(g_job));
+    g_job.addr = addr;
+    g_job.end = addr + len;
+    g_job.t_start = HAL_GetTick();
+    if (snor_start_read(addr, len, 0u) != HAL_OK) return HAL_ERROR;
+    g_job.op = SNOR_OP_CRC;
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef SNOR_Erase(uint32_t addr, uint32_t len)
+{
+    if (!snor_check(addr, len)) return HAL_ERROR;
+
+    uint32_t min = g_snor.erase[0].size;
+    if (len > 0u && ((addr % min) != 0u || (len % min) != 0u)) {
+        cli_printf("\r\nflash: Bereich muss auf %lu Bytes ausgerichtet sein\r\n", (unsigned long)min);
+        return HAL_ERROR;
+    }
+
+    memset(&g_job, 0, sizeof(g_job));
+    g_job.chip = (len == 0u) ? 1u : 0u;
+    g_job.addr = g_job.chip ? 0u : addr;
+    g_job.end = g_job.chip ? g_snor.size : addr + len;
+    g_job.t_start = HAL_GetTick();
+    g_job.op = SNOR_OP_ERASE;
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef SNOR_Write(uint32_t addr, uint32_t len, uint8_t verify)
+{
+    if (len == 0u || !snor_check(addr, len)) return HAL_ERROR;
+
+    memset(&g_job, 0, sizeof(g_job));
+    for (uint8_t i = 0u; i < SNOR_SLOTS; i++) g_snor_slot[i].len = 0u;
+    g_job.start = addr;
+    g_job.addr = addr;
+    g_job.fed = addr;
+    g_job.end = addr + len;
+    g_job.crc = CRC32_INIT;
+    g_job.verify = verify ? 1u : 0u;
+    g_job.t_start = HAL_GetTick();
+    g_job.t_progress = g_job.t_start;
+    g_job.op = SNOR_OP_WRITE;
+    return HAL_OK;
+}
+
+void SNOR_Stop(void)
+{
+    if (g_job.op == SNOR_OP_IDLE) return;
+    if (SPIB_IsActive()) SPIB_Stop();
+    snor_done("abgebrochen");
+}
+
+uint8_t SNOR_IsActive(void)
+{
+    return (g_job.op != SNOR_OP_IDLE) ? 1u : 0u;
+}
+
+uint8_t SNOR_IsRawActive(void)
+{
+    return (g_job.op == SNOR_OP_WRITE && g_job.fed < g_job.end) ? 1u : 0u;
+}
+
+uint16_t SNOR_Feed(const uint8_t *data, uint16_t len)
+{
+    uint16_t done = 0u;
+
+    if (!SNOR_IsRawActive()) return len;
+
+    while (done < len && g_job.fed < g_job.end && g_job.count < SNOR_SLOTS) {
+        snor_slot_t *s = &g_snor_slot[g_job.wr];
+        if (s->len == 0u) {
+            uint32_t n = g_snor.page - (g_job.fed % g_snor.page);
+            if (n > g_job.end - g_job.fed) n = g_job.end - g_job.fed;
+            s->addr = g_job.fed;
+            s->len = (uint16_t)n;
+            s->pos = 0u;
+        }
+
+        uint16_t n = (uint16_t)(s->len - s->pos);
+        if (n > (uint16_t)(len - done)) n = (uint16_t)(len - done);
+        memcpy(&s->data[s->pos], &data[done], n);
+        g_job.crc = CRC32_Update(g_job.crc, &data[done], n);
+        s->pos = (uint16_t)(s->pos + n);
+        g_job.fed += n;
+        done = (uint16_t)(done + n);
+
+        if (s->pos == s->len) {
+            g_job.wr = (uint8_t)((g_job.wr + 1u) % SNOR_SLOTS);
+            g_job.count++;
+        }
+    }
+    if (done > 0u) g_job.t_progress = HAL_GetTick();
+    return done;
+}
+
+// ---------------- Poll ----------------
+// 1 = Flash noch beschaeftigt, 0 = frei, -1 = Fehler
+static int snor_poll_wip(void)
+{
+    if (!g_job.busy) return 0;
+
+    int sr = snor_rdsr();
+    if (sr < 0) return -1;
+    if (sr & SNOR_SR_WIP) {
+        if ((HAL_GetTick() - g_job.t_op) > g_job.wait_ms) return -1;
+        return 1;
+    }
+    g_job.busy = 0u;
+    return 0;
+}
+
+static void snor_poll_erase(void)
+{
+    uint8_t hdr[5];
+    int w = snor_poll_wip();
+
+    if (w < 0) { snor_fail("Erase Timeout"); return; }
+    if (w > 0) return;
+
+    if (g_job.addr >= g_job.end) {
+        snor_done("Erase OK");
+        return;
+    }
+    if (snor_wren() != HAL_OK) { snor_fail("WEL nicht gesetzt (Schreibschutz?)"); return; }
+
+    if (g_job.chip) {
+        hdr[0] = SNOR_OP_CHIP_ERASE;
+        (void)snor_write_cmd(hdr, 1u, NULL, 0u);
+        g_job.wait_ms = SNOR_CHIP_TIMEOUT_MS;
+        g_job.addr = g_job.end;
+    } else {
+        uint8_t t = 0u;
+        for (uint8_t i = g_snor.n_erase; i > 0u; i--) {
+            uint32_t sz = g_snor.erase[i - 1u].size;
+            if ((g_job.addr % sz) == 0u && sz <= g_job.end - g_job.addr) { t = (uint8_t)(i - 1u); break; }
+        }
+        uint8_t n = snor_hdr(hdr, g_snor.erase[t].op, g_job.addr);
+        (void)snor_write_cmd(hdr, n, NULL, 0u);
+        g_job.wait_ms = SNOR_ERASE_TIMEOUT_MS;
+        g_job.addr += g_snor.erase[t].size;
+    }
+    g_job.busy = 1u;
+    g_job.t_op = HAL_GetTick();
+}
+
+static void snor_poll_write(void)
+{
+    uint8_t hdr[5];
+    int w = snor_poll_wip();
+
+    if (w < 0) { snor_fail("Program Timeout"); return; }
+    if (w > 0) return;
+
+    if (g_job.count > 0u) {
+        snor_slot_t *s = &g_snor_slot[g_job.rd];
+        if (snor_wren() != HAL_OK) { snor_fail("WEL nicht gesetzt (Schreibschutz?)"); return; }
+
+        uint8_t n = snor_hdr(hdr, g_snor.op_pp, s->addr);
+        if (snor_write_cmd(hdr, n, s->data, s->len) != HAL_OK) { snor_fail("SPI"); return; }
+
+        g_job.addr = s->addr + s->len;
+        s->len = 0u;
+        g_job.rd = (uint8_t)((g_job.rd + 1u) % SNOR_SLOTS);
+        g_job.count--;
+        g_job.pages++;
+        g_job.busy = 1u;
+        g_job.wait_ms = SNOR_PP_TIMEOUT_MS;
+        g_job.t_op = HAL_GetTick();
+        g_job.t_progress = g_job.t_op;
+        return;
+    }
+
+    if (g_job.fed < g_job.end) {
+        if ((HAL_GetTick() - g_job.t_progress) > SNOR_IDLE_TIMEOUT_MS) {
+            snor_fail("Timeout (Host Daten)");
+        }
+        return;
+    }
+
+    // alles programmiert
+    g_job.crc ^= CRC32_XOROUT;
+    uint32_t len = g_job.end - g_job.start;
+    uint32_t ms = HAL_GetTick() - g_job.t_start;
+    cli_printf("\r\nflash write: %lu Bytes, %lu Pages, CRC32 %08lX",
+               (unsigned long)len, (unsigned long)g_job.pages, (unsigned long)g_job.crc);
+    if (ms > 0u) cli_printf(", %lu kB/s", (unsigned long)(len / ms));
+    cli_printf("\r\n");
+
+    if (!g_job.verify) {
+        snor_done(NULL);
+        return;
+    }
+    if (snor_start_read(g_job.start, len, 0u) != HAL_OK) {
+        snor_fail("Verify Start");
+        return;
+    }
+    g_job.op = SNOR_OP_VERIFY;
+}
+
+void SNOR_Poll(void)
+{
+    switch (g_job.op) {
+        case SNOR_OP_ERASE:
+            snor_poll_erase();
+            break;
+
+        case SNOR_OP_WRITE:
+            snor_poll_write();
+            break;
+
+        case SNOR_OP_READ:
+            if (!SPIB_IsActive()) {
+                g_job.op = SNOR_OP_IDLE;   // Abschlusszeile kommt von bulk
+            }
+            break;
+
+        case SNOR_OP_CRC:
+        case SNOR_OP_VERIFY:
+            if (SPIB_IsActive()) break;
+            if (SPIB_LastAborted()) {
+                snor_fail("Readback");
+                break;
+            }
+            g_job.crc_rd ^= CRC32_XOROUT;
+            if (g_job.op == SNOR_OP_CRC) {
+                cli_printf("\r\nflash crc: 0x%08lX +%lu CRC32 %08lX\r\n",
+                           (unsigned long)g_job.addr, (unsigned long)(g_job.end - g_job.addr),
+                           (unsigned long)g_job.crc_rd);
+                snor_done(NULL);
+            } else {
+                snor_done((g_job.crc_rd == g_job.crc) ? "Verify OK" : "Verify FEHLER (CRC)");
+            }
+            break;
+
+        default:
+            break;
+    }
+}
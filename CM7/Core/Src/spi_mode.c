@@ -3,8 +3,15 @@
 #include "pmic.h"
 #include "setup_utils.h"
 #include "hexstream.h"
+#include "spi_bulk.h"
+#include "spi_flash.h"
+#include "spi_trig.h"
+#include "spi_cyc.h"
+#include "spi_slave.h"
+#include "ssi_enc.h"
 #include "stm32h7xx_hal.h"
 #include "usbd_cdc_if.h"
+#include "usb_stream.h"
 #include <string.h>
 #include <stdlib.h>
 
@@ -18,6 +25,12 @@
 //   - Frame Format (Motorola/TI)
 //   - Datasize (4..32 bit)
 //   - First Bit (MSB/LSB)
+//
+// CS (PI0) per Software (spi_bulk.c), aktiv ueber den ganzen w..p bzw.
+// bulk Transfer statt NSS Puls pro Frame.
+// Lange Transfers: bulk (DMA, Ping-Pong in D2 SRAM, spi_bulk.c)
+// target: SPI2 als Slave am DUT Master (spi_slave.c), solange aktiv sind
+// alle Master Befehle gesperrt
 // ============================================================
 
 static const char *voltage_spi = "buck5";
@@ -75,16 +88,25 @@ static void spi_refresh_rail(void)
     }
 }
 
-static uint32_t spi_get_pclk_hz(void)
+// Kernel Clock SPI1/2/3 (RCC_SPI123CLKSOURCE_PLL = pll1_q), nicht PCLK1
+static uint32_t spi_get_kernel_hz(void)
 {
-    return HAL_RCC_GetPCLK1Freq();
+    return HAL_RCCEx_GetPeriphCLKFreq(RCC_PERIPHCLK_SPI123);
 }
 
 static uint32_t spi_get_max_mhz(void)
 {
-    uint32_t pclk = spi_get_pclk_hz();
-    if (pclk == 0u) return 0u;
-    return (pclk / 2u) / 1000000u;
+    uint32_t kclk = spi_get_kernel_hz();
+    if (kclk == 0u) return 0u;
+    return (kclk / 2u) / 1000000u;
+}
+
+// bulk/cyc/flash/target haben SPI2 in Betrieb (hspi2.State bleibt READY)
+static uint8_t spi2_engine_busy(void)
+{
+    if (!(SPIB_IsActive() || SPTRG_IsActive() || SNOR_IsActive() || SPSL_IsActive())) return 0u;
+    cli_printf("\r\nSPI2 belegt (bulk/run/target aktiv).\r\n");
+    return 1u;
 }
 
 #ifdef HAL_SPI_MODULE_ENABLED
@@ -147,8 +169,13 @@ static void spi_apply_settings(void)
         cli_printf("\r\nSPI2 handle fehlt (hspi2 nicht definiert).\r\n");
         return;
     }
+    if (spi2_engine_busy()) return;
 
     hspi2.Init.Mode = SPI_MODE_MASTER;
+    hspi2.Init.Direction = SPI_DIRECTION_2LINES;      // SSI Mode stellt auf RX-only
+    hspi2.Init.MasterKeepIOState = SPI_MASTER_KEEP_IO_STATE_DISABLE;
+    hspi2.Init.NSS = SPI_NSS_SOFT;
+    hspi2.Init.NSSPMode = SPI_NSS_PULSE_DISABLE;
     hspi2.Init.CLKPolarity = (g_spi_mode & 0x2u) ? SPI_POLARITY_HIGH : SPI_POLARITY_LOW;
     hspi2.Init.CLKPhase = (g_spi_mode & 0x1u) ? SPI_PHASE_2EDGE : SPI_PHASE_1EDGE;
     hspi2.Init.TIMode = g_spi_frame_motorola ? SPI_TIMODE_DISABLE : SPI_TIMODE_ENABLE;
@@ -158,6 +185,7 @@ static void spi_apply_settings(void)
 
     (void)HAL_SPI_DeInit(&hspi2);
     HAL_StatusTypeDef st = HAL_SPI_Init(&hspi2);
+    SPIB_CsInit();   // MSP setzt PI0 auf AF zurueck
     if (st == HAL_OK) {
         cli_printf("\r\nSPI2 re-init OK (mode=%u, %lu Hz, %ubit)\r\n",
                    (unsigned)g_spi_mode, (unsigned long)g_spi_clk_hz, (unsigned)g_spi_datasize_bits);
@@ -180,8 +208,8 @@ static void spi_set_clock_mhz(uint32_t mhz)
 
     g_spi_req_mhz = mhz;
 
-    uint32_t pclk = spi_get_pclk_hz();
-    if (pclk == 0u) {
+    uint32_t kclk = spi_get_kernel_hz();
+    if (kclk == 0u) {
         g_spi_prescaler = 2;
         g_spi_clk_hz = mhz * 1000000u;
         spi_apply_settings();
@@ -192,11 +220,11 @@ static void spi_set_clock_mhz(uint32_t mhz)
     uint32_t target_hz = mhz * 1000000u;
 
     g_spi_prescaler = 256;
-    g_spi_clk_hz = pclk / 256u;
+    g_spi_clk_hz = kclk / 256u;
 
     for (size_t i = 0; i < (sizeof(prescalers) / sizeof(prescalers[0])); i++) {
         uint16_t presc = prescalers[i];
-        uint32_t freq = pclk / (uint32_t)presc;
+        uint32_t freq = kclk / (uint32_t)presc;
         if (freq <= target_hz) {
             g_spi_prescaler = presc;
             g_spi_clk_hz = freq;
@@ -247,6 +275,349 @@ static void spi_print_bytes(const uint8_t *b, uint16_t n)
         if (i + 1u < n) cli_printf(" ");
     }
 }
+// ---------------- bulk (DMA Streaming) ----------------
+// Zahl mit optionalem k/M Suffix (1024 / 1048576)
+static uint8_t spi_parse_len(const char *s, uint32_t *out)
+{
+    char *end = NULL;
+    if (!s || !*s) return 0u;
+    uint32_t v = strtoul(s, &end, 0);
+    if (end == s) return 0u;
+    if (*end == 'k' || *end == 'K') { v *= 1024u; end++; }
+    else if (*end == 'M') { v *= 1048576u; end++; }
+    if (*end != '\0' || v == 0u) return 0u;
+    *out = v;
+    return 1u;
+}
+
+static int spi_parse_hex(const char *s, uint8_t *out, uint16_t max)
+{
+    uint16_t n = 0u;
+    size_t len = strlen(s);
+    if (len == 0u || (len & 1u)) return -1;
+    for (size_t i = 0; i < len; i += 2u) {
+        char b[3] = { s[i], s[i + 1u], '\0' };
+        char *end = NULL;
+        unsigned long v = strtoul(b, &end, 16);
+        if (*end != '\0' || n >= max) return -1;
+        out[n++] = (uint8_t)v;
+    }
+    return (int)n;
+}
+
+static void spi_bulk_usage(void)
+{
+    cli_printf("\r\nbulk tx <LEN> [rx] [hold]             - LEN Bytes roh vom Host -> MOSI, rx = MISO zum Host\r\n");
+    cli_printf("bulk rd <LEN> [HEX] [fill=XX] [hold]  - HEX Prefix senden, dann LEN Bytes lesen -> Host\r\n");
+    cli_printf("bulk cs <0|1>                         - CS manuell (1 = aktiv)\r\n");
+    cli_printf("bulk stop | stat\r\n");
+    cli_printf("  LEN mit k/M Suffix, z.B. 16M Flash lesen: bulk rd 16M 03000000\r\n");
+    cli_printf("  8 Bit Frames, Clock/Mode aus dem Setup; Host Daten binaer, dann Statuszeile\r\n");
+    cli_printf("  bulk tx: Zeile nur mit CR abschliessen, alles danach sind schon Daten\r\n");
+}
+
+static void spi_cmd_bulk(char *args)
+{
+    char *save = NULL;
+    char *sub = strtok_r(args, " ", &save);
+
+    if (!sub) { spi_bulk_usage(); return; }
+
+    if (strcmp(sub, "stop") == 0) {
+        if (!SPIB_IsActive()) cli_printf("\r\nbulk: nicht aktiv\r\n");
+        SPIB_Stop();
+        return;
+    }
+    if (strcmp(sub, "stat") == 0) {
+        SPIB_PrintStats();
+        return;
+    }
+    if (strcmp(sub, "cs") == 0) {
+        char *v = strtok_r(NULL, " ", &save);
+        if (!v || (strcmp(v, "0") != 0 && strcmp(v, "1") != 0) || SPIB_IsActive()) {
+            spi_bulk_usage();
+            return;
+        }
+        SPIB_Cs((uint8_t)(v[0] - '0'));
+        cli_printf("\r\nCS %s\r\n", (v[0] == '1') ? "aktiv" : "inaktiv");
+        return;
+    }
+
+    uint8_t rd = (strcmp(sub, "rd") == 0) ? 1u : 0u;
+    if (!rd && strcmp(sub, "tx") != 0) { spi_bulk_usage(); return; }
+
+    uint32_t len = 0u;
+    if (!spi_parse_len(strtok_r(NULL, " ", &save), &len)) { spi_bulk_usage(); return; }
+
+    uint8_t pre[SPIB_PRE_MAX];
+    int plen = 0;
+    uint8_t fill = 0xFFu;
+    uint8_t capture = rd;
+    uint8_t hold = 0u;
+
+    char *tok;
+    while ((tok = strtok_r(NULL, " ", &save)) != NULL) {
+        if (strcmp(tok, "hold") == 0) { hold = 1u; continue; }
+        if (!rd && strcmp(tok, "rx") == 0) { capture = 1u; continue; }
+        if (rd && strncmp(tok, "fill=", 5) == 0) {
+            uint8_t f;
+            if (spi_parse_hex(tok + 5, &f, 1u) != 1) { spi_bulk_usage(); return; }
+            fill = f;
+            continue;
+        }
+        if (rd && plen == 0) {
+            plen = spi_parse_hex(tok, pre, SPIB_PRE_MAX);
+            if (plen > 0) continue;
+        }
+        cli_printf("\r\nbulk: unbekannt '%s'\r\n", tok);
+        spi_bulk_usage();
+        return;
+    }
+
+    uint32_t total = len + (uint32_t)plen;
+    cli_printf("\r\nbulk: %lu Bytes%s%s\r\n", (unsigned long)total,
+               capture ? ", RX -> Host" : "",
+               rd ? "" : ", warte auf Daten");
+    USBS_Flush(50u);
+
+    HAL_StatusTypeDef st = SPIB_Start(rd ? SPIB_SRC_FILL : SPIB_SRC_USB, total, pre,
+                                      (uint8_t)plen, fill, capture, hold);
+    if (st != HAL_OK) {
+        cli_printf("\r\nbulk: FEHLER (%s)\r\n", (st == HAL_BUSY) ? "SPI2 belegt" : "Parameter");
+    }
+}
+
+// ---------------- flash (SPI NOR) ----------------
+static void spi_flash_usage(void)
+{
+    cli_printf("\r\nflash id                     - JEDEC ID + SFDP erkennen\r\n");
+    cli_printf("flash read <ADDR> <LEN>      - binaer zum Host (DMA)\r\n");
+    cli_printf("flash crc <ADDR> <LEN>       - CRC32 auf dem Geraet\r\n");
+    cli_printf("flash erase <ADDR> <LEN>|chip\r\n");
+    cli_printf("flash write <ADDR> <LEN> [noverify] - LEN Bytes roh vom Host, danach CRC Verify\r\n");
+    cli_printf("flash stop\r\n");
+    cli_printf("  ADDR/LEN mit 0x bzw. k/M, Zeile bei write nur mit CR abschliessen\r\n");
+}
+
+static uint8_t spi_parse_addr(const char *s, uint32_t *out)
+{
+    char *end = NULL;
+    if (!s || !*s) return 0u;
+    *out = strtoul(s, &end, 0);
+    return (end != s && *end == '\0') ? 1u : 0u;
+}
+
+static void spi_cmd_flash(char *args)
+{
+    char *save = NULL;
+    char *sub = strtok_r(args, " ", &save);
+    uint32_t addr = 0u, len = 0u;
+
+    if (!sub) { spi_flash_usage(); return; }
+
+    if (strcmp(sub, "id") == 0) {
+        HAL_StatusTypeDef st = SNOR_Probe();
+        if (st == HAL_OK) SNOR_PrintInfo();
+        else if (st == HAL_ERROR) cli_printf("\r\nflash: kein Flash erkannt\r\n");
+        return;
+    }
+    if (strcmp(sub, "stop") == 0) {
+        SNOR_Stop();
+        return;
+    }
+
+    char *a = strtok_r(NULL, " ", &save);
+    char *l = strtok_r(NULL, " ", &save);
+
+    if (strcmp(sub, "erase") == 0 && a && strcmp(a, "chip") == 0) {
+        if (SNOR_Erase(0u, 0u) == HAL_OK) cli_printf("\r\nflash: Chip Erase ...\r\n");
+        return;
+    }
+    if (!spi_parse_addr(a, &addr) || !spi_parse_len(l, &len)) { spi_flash_usage(); return; }
+
+    if (strcmp(sub, "read") == 0) {
+        (void)SNOR_Read(addr, len);
+    } else if (strcmp(sub, "crc") == 0) {
+        (void)SNOR_Crc(addr, len);
+    } else if (strcmp(sub, "erase") == 0) {
+        if (SNOR_Erase(addr, len) == HAL_OK) cli_printf("\r\nflash: Erase ...\r\n");
+    } else if (strcmp(sub, "write") == 0) {
+        char *o = strtok_r(NULL, " ", &save);
+        uint8_t verify = (o && strcmp(o, "noverify") == 0) ? 0u : 1u;
+        if (SNOR_Write(addr, len, verify) == HAL_OK) {
+            cli_printf("\r\nflash write: 0x%08lX %lu Bytes, warte auf Daten\r\n",
+                       (unsigned long)addr, (unsigned long)len);
+        }
+    } else {
+        spi_flash_usage();
+    }
+}
+
+// ---------------- cyc (Timer getriggerte Samples) ----------------
+static void spi_cyc_usage(void)
+{
+    cli_printf("\r\ncyc <HZ> <HEX> [len=N] [nocs]  - HEX Vorlage mit HZ senden (max. 100 kHz), RX als Bloecke zum Host\r\n");
+    cli_printf("cyc stop | stat\r\n");
+    cli_printf("  len = Bytes pro Transaktion (Vorlage mit 00 aufgefuellt), Vielfaches der Datasize\r\n");
+    cli_printf("  CS per Hardware je Transaktion, nocs = CS bleibt inaktiv\r\n");
+    cli_printf("  Block: 5AA5, Anzahl(u16), seq(u32), dann Anzahl x len Bytes (little endian)\r\n");
+}
+
+static void spi_cmd_cyc(char *args)
+{
+    char *save = NULL;
+    char *sub = strtok_r(args, " ", &save);
+
+    if (!sub) { spi_cyc_usage(); return; }
+    if (strcmp(sub, "stop") == 0) {
+        if (!SPCYC_IsActive()) cli_printf("\r\ncyc: nicht aktiv\r\n");
+        SPCYC_Stop();
+        return;
+    }
+    if (strcmp(sub, "stat") == 0) {
+        SPCYC_PrintStats();
+        return;
+    }
+
+    uint32_t hz = strtoul(sub, NULL, 10);
+    char *hex = strtok_r(NULL, " ", &save);
+    uint8_t tx[SPTRG_TX_MAX];
+    int n = hex ? spi_parse_hex(hex, tx, SPTRG_TX_MAX) : -1;
+    uint32_t len = (n > 0) ? (uint32_t)n : 0u;
+    uint8_t hw_cs = 1u;
+
+    if (hz == 0u || n <= 0) { spi_cyc_usage(); return; }
+
+    char *tok;
+    while ((tok = strtok_r(NULL, " ", &save)) != NULL) {
+        if (strcmp(tok, "nocs") == 0) { hw_cs = 0u; continue; }
+        if (strncmp(tok, "len=", 4) == 0) {
+            uint32_t l = strtoul(tok + 4, NULL, 0);
+            if (l >= (uint32_t)n && l <= SPTRG_TX_MAX) { len = l; continue; }
+        }
+        spi_cyc_usage();
+        return;
+    }
+    memset(&tx[n], 0, SPTRG_TX_MAX - (uint32_t)n);
+
+    uint8_t width = (g_spi_datasize_bits > 16u) ? 4u : ((g_spi_datasize_bits > 8u) ? 2u : 1u);
+    if (len % width) {
+        cli_printf("\r\ncyc: len muss Vielfaches von %u Bytes sein (Datasize %u bit)\r\n",
+                   (unsigned)width, (unsigned)g_spi_datasize_bits);
+        return;
+    }
+    uint16_t frames = (uint16_t)(len / width);
+
+    // Transaktion muss vor dem naechsten Tick fertig sein
+    uint32_t bus_us = (g_spi_clk_hz > 0u)
+                    ? ((uint32_t)frames * g_spi_datasize_bits * 1000000u) / g_spi_clk_hz + 2u : 0u;
+    if (bus_us >= 1000000u / hz) {
+        cli_printf("\r\ncyc: Transaktion %lu us laenger als Periode %lu us\r\n",
+                   (unsigned long)bus_us, (unsigned long)(1000000u / hz));
+        return;
+    }
+
+    cli_printf("\r\ncyc: %lu Hz, %lu Bytes/Sample -> Host\r\n", (unsigned long)hz, (unsigned long)len);
+    USBS_Flush(50u);
+
+    HAL_StatusTypeDef st = SPCYC_Start(hz, tx, frames, width, hw_cs);
+    if (st != HAL_OK) {
+        cli_printf("\r\ncyc: FEHLER (%s)\r\n", (st == HAL_BUSY) ? "SPI2 belegt" : "Rate/Laenge");
+    }
+}
+
+// ---------------- target (SPI2 Slave) ----------------
+static uint8_t spi_target_busy(void)
+{
+    if (!SPSL_IsActive()) return 0u;
+    cli_printf("\r\nSPI2 ist Slave, erst 'target stop'\r\n");
+    return 1u;
+}
+
+static void spi_target_usage(void)
+{
+    cli_printf("\r\ntarget resp <HEX> | resp+ <HEX>       - Antwort auf MISO setzen/anhaengen (max. %u Bytes)\r\n",
+               (unsigned)SPSL_RESP_MAX);
+    cli_printf("target start [loop] [fill=XX]        - als Slave antworten, MOSI Frames -> Host\r\n");
+    cli_printf("target sniff                         - nur mithoeren (MISO bleibt Eingang)\r\n");
+    cli_printf("target stop | stat\r\n");
+    cli_printf("  SPI Mode/First Bit aus dem Setup, 8 Bit, NSS an PI0; Antwort pro Frame von vorne (loop = endlos)\r\n");
+    cli_printf("  Record: A6, flags, t_start(u32), t_end(u32), len(u16), MOSI Bytes (little endian)\r\n");
+}
+
+static void spi_cmd_target(char *args)
+{
+    char *save = NULL;
+    char *sub = strtok_r(args, " ", &save);
+
+    if (!sub) { spi_target_usage(); return; }
+
+    if (strcmp(sub, "resp") == 0 || strcmp(sub, "resp+") == 0) {
+        uint8_t buf[SPSL_RESP_MAX];
+        char *hex = strtok_r(NULL, " ", &save);
+        int n = hex ? spi_parse_hex(hex, buf, SPSL_RESP_MAX) : -1;
+        HAL_StatusTypeDef st = (n > 0) ? SPSL_SetResponse(buf, (uint16_t)n, (sub[4] == '+') ? 1u : 0u) : HAL_ERROR;
+        if (st == HAL_BUSY) {
+            cli_printf("\r\ntarget: belegt (loop laeuft, erst 'target stop')\r\n");
+            return;
+        }
+        if (st != HAL_OK) {
+            spi_target_usage();
+            return;
+        }
+        cli_printf("\r\ntarget: Antwort %u Bytes\r\n", (unsigned)SPSL_ResponseLen());
+        return;
+    }
+    if (strcmp(sub, "stop") == 0) {
+        if (!SPSL_IsActive()) {
+            cli_printf("\r\ntarget: nicht aktiv\r\n");
+            return;
+        }
+        SPSL_Stop();
+        SPSL_PrintStats();
+        spi_apply_settings();       // zurueck als Master
+        return;
+    }
+    if (strcmp(sub, "stat") == 0) {
+        SPSL_PrintStats();
+        return;
+    }
+
+    spsl_cfg_t cfg;
+    memset(&cfg, 0, sizeof(cfg));
+    cfg.mode = g_spi_mode;
+    cfg.msb = g_spi_firstbit_msb;
+    cfg.fill = 0xFFu;
+
+    if (strcmp(sub, "sniff") == 0) {
+        cfg.role = SPSL_SNIFF;
+    } else if (strcmp(sub, "start") == 0) {
+        cfg.role = SPSL_TARGET;
+        char *tok;
+        while ((tok = strtok_r(NULL, " ", &save)) != NULL) {
+            if (strcmp(tok, "loop") == 0) { cfg.loop = 1u; continue; }
+            if (strncmp(tok, "fill=", 5) == 0 && spi_parse_hex(tok + 5, &cfg.fill, 1u) == 1) continue;
+            spi_target_usage();
+            return;
+        }
+    } else {
+        spi_target_usage();
+        return;
+    }
+
+    if (SPIB_IsActive() || SPTRG_IsActive() || SNOR_IsActive()) {
+        cli_printf("\r\ntarget: SPI2 belegt\r\n");
+        return;
+    }
+    cli_printf("\r\ntarget: %s, Mode %u, Frames -> Host\r\n",
+               (cfg.role == SPSL_SNIFF) ? "sniff" : "Slave", (unsigned)cfg.mode);
+    USBS_Flush(50u);
+    if (SPSL_Start(&cfg) != HAL_OK) {
+        cli_printf("\r\ntarget: FEHLER (SPI2 Init)\r\n");
+        spi_apply_settings();
+    }
+}
+
 // ---------------- Setup UI ----------------
 static void spi_print_setting_summary(void)
 {
@@ -384,12 +755,17 @@ static void spi_print_help(void)
     cli_printf("SPI Mode Befehle:\r\n");
     cli_printf("  s           - Setup Menu\r\n");
     cli_printf("  w..p        - Write Stream: w(HEX.. )p (TXRX, RX=TX length)\r\n");
+    cli_printf("  bulk ...    - DMA Transfer beliebiger Laenge (bulk ?)\r\n");
+    cli_printf("  flash ...   - SPI NOR Flash lesen/schreiben (flash ?)\r\n");
+    cli_printf("  cyc ...     - Timer getriggerte Transaktion, Sensor Streaming (cyc ?)\r\n");
+    cli_printf("  target ...  - SPI2 als Slave: Antwort + MOSI Mitschnitt (target ?)\r\n");
     cli_printf("  ?           - Hilfe\r\n");
 }
 
 // ---------------- Public API ----------------
 void SPI_Mode_Enter(void)
 {
+    SSI_Stop();     // SPI2 gehoert wieder dem SPI Mode
     HEXS_Init(&ws_hex);
     spi_ws_reset();
     spi_set_clock_mhz(g_spi_req_mhz);
@@ -452,9 +828,64 @@ uint8_t SPI_Mode_HandleLine(char *line)
         return 1;
     }
 
+    if (strncmp(line, "target", 6) == 0 && (line[6] == '\0' || line[6] == ' ')) {
+        if (strcmp(line, "target ?") == 0) spi_target_usage();
+        else spi_cmd_target(line + 6);
+        return 1;
+    }
+
+    if (strncmp(line, "bulk", 4) == 0 && (line[4] == '\0' || line[4] == ' ')) {
+        if (strcmp(line, "bulk ?") == 0) spi_bulk_usage();
+        else if (!spi_target_busy()) spi_cmd_bulk(line + 4);
+        return 1;
+    }
+
+    if (strncmp(line, "flash", 5) == 0 && (line[5] == '\0' || line[5] == ' ')) {
+        if (strcmp(line, "flash ?") == 0) spi_flash_usage();
+        else if (!spi_target_busy()) spi_cmd_flash(line + 5);
+        return 1;
+    }
+
+    if (strncmp(line, "cyc", 3) == 0 && (line[3] == '\0' || line[3] == ' ')) {
+        if (strcmp(line, "cyc ?") == 0) spi_cyc_usage();
+        else if (!spi_target_busy()) spi_cmd_cyc(line + 3);
+        return 1;
+    }
+
     return 0;
 }
 
+uint16_t SPI_Mode_HandleRaw(const uint8_t *data, uint16_t len)
+{
+    if (SNOR_IsRawActive()) return SNOR_Feed(data, len);
+    return SPIB_Feed(data, len);
+}
+
+uint8_t SPI_Mode_IsRawActive(void)
+{
+    return (SPIB_IsRawActive() || SNOR_IsRawActive()) ? 1u : 0u;
+}
+
+// SPI2 Engines werden nur hier gepollt; bulk gibt dabei auch CS frei
+void SPI_Mode_Exit(void)
+{
+    SNOR_Stop();                    // vor bulk, ein Flash Job nutzt ihn
+    SPIB_Stop();
+    SPCYC_Stop();
+    if (SPSL_IsActive()) {
+        SPSL_Stop();
+        spi_apply_settings();       // zurueck als Master
+    }
+}
+
+void SPI_Mode_Poll(void)
+{
+    SPIB_Poll();
+    SNOR_Poll();
+    SPCYC_Poll();
+    SPSL_Poll();
+}
+
 uint8_t SPI_Mode_HandleChar(char ch)
 {
     if (g_setup_state == SPI_SETUP_CLOCK_INPUT || g_setup_state == SPI_SETUP_DATASIZE_INPUT) {
@@ -515,6 +946,7 @@ uint8_t SPI_Mode_HandleChar(char ch)
             if (ch == '?') { spi_print_help(); return 1; }
 
             if (ch == 'w' || ch == 'W') {
+                if (spi2_engine_busy()) return 1;
                 ws_active = 1;
                 HEXS_Begin(&ws_hex);
                 cli_printf("\r\nwrite: ");
@@ -552,8 +984,10 @@ uint8_t SPI_Mode_HandleChar(char ch)
             cli_printf("\r\n");
 
     #ifdef HAL_SPI_MODULE_ENABLED
+            SPIB_Cs(1u);
             HAL_StatusTypeDef st = HAL_SPI_TransmitReceive(&hspi2, tx, ws_rx, len, SPI_TX_TIMEOUT_MS);
             uint32_t err = HAL_SPI_GetError(&hspi2);
+            SPIB_Cs(0u);
 
             if (st == HAL_OK) {
                 cli_printf("SPI RX: ");
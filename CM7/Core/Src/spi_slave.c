@@ -0,0 +1,456 @@
+/*
+ * spi_slave.c
+ *
+ *  SPI2 as bus target: preloaded MISO response, NSS-framed MOSI capture to USB.
+ */
+#include "spi_slave.h"
+#include "usb_stream.h"
+#include "main.h"
+#include "tim.h"
+#include "cli.h"
+#include <string.h>
+
+// ============================================================
+// SPI SLAVE (SPI2, Takt und NSS vom DUT Master)
+//
+//   - 8 Bit Frames, NSS per Hardware (PI0 AF), kein Eingriff pro Byte:
+//     MOSI per DMA1 Stream 4 circular in einen 32 KB Ring (D2 SRAM),
+//     MISO per DMA1 Stream 5 aus dem Antwortpuffer
+//   - EXTI0 auf PI0 (beide Flanken, Pin bleibt AF): fallend = Frame
+//     Start (TIM2 Stempel + Ringposition), steigend = Frame Ende -> Event
+//     Queue; die Superloop schreibt Records wie uart_trace (nur ganze
+//     Records in usb_stream, sonst warten, Verlust erst bei Ring Overrun)
+//   - Antwort: pro Frame von vorne (NSS steigend: TX FIFO per SPE = 0
+//     leeren, TX DMA neu laden) oder loop = endlos durchlaufen. Nach dem
+//     Antwortende sendet der Slave das Fuellbyte (UDRDR)
+//   - sniff: RX-only, MISO Pin als Eingang, nur mithoeren
+//   - Reserve: zwischen NSS steigend und dem naechsten Frame brauchen
+//     der IRQ und das Neuladen ca. 1-2 us; der Bus selbst laeuft bis
+//     zum Limit des SPI Slave (> 10 MHz) ohne CPU
+// ============================================================
+
+#define SPSL_SPI              SPI2
+#define SPSL_DMA_RX           DMA1_Stream4
+#define SPSL_DMA_TX           DMA1_Stream5
+#define SPSL_DMA_FLAGS        (DMA_HISR_FEIF4 | DMA_HISR_DMEIF4 | DMA_HISR_TEIF4 | \
+                               DMA_HISR_HTIF4 | DMA_HISR_TCIF4)
+#define SPSL_RX_SHIFT         (0u)      // DMA1 HISR Stream 4
+#define SPSL_TX_SHIFT         (6u)      // Stream 5
+#define SPSL_NSS_PORT         GPIOI
+#define SPSL_NSS_PIN          GPIO_PIN_0
+#define SPSL_NSS_EXTICR       (8u)      // Port I
+#define SPSL_MISO_PIN         GPIO_PIN_2
+#define SPSL_SPI_IFCR_ALL     (SPI_IFCR_EOTC | SPI_IFCR_TXTFC | SPI_IFCR_UDRC | SPI_IFCR_OVRC | \
+                               SPI_IFCR_CRCEC | SPI_IFCR_TIFREC | SPI_IFCR_MODFC | \
+                               SPI_IFCR_TSERFC | SPI_IFCR_SUSPC)
+
+typedef struct {
+    uint32_t start;                 // absolute Ringposition
+    uint32_t end;
+    uint32_t t_start;
+    uint32_t t_end;
+    uint8_t flags;
+} spsl_ev_t;
+
+typedef struct {
+    volatile uint8_t active;
+    uint8_t role;
+    uint8_t loop;
+    uint32_t rx_last_pos;
+    volatile uint32_t head;         // absolut
+    uint32_t tail;                  // bis hier ausgegeben
+
+    // ISR: laufender Frame
+    volatile uint8_t in_frame;
+    uint32_t f_start;
+    uint32_t f_t_start;
+
+    volatile spsl_ev_t evq[SPSL_EVQ_SIZE];
+    volatile uint8_t evq_head;
+    volatile uint8_t evq_tail;
+    uint8_t lost_pending;           // naechster Record bekommt SPSL_F_LOST
+    uint32_t evq_lost_seen;
+    uint8_t open;                   // Frame teilweise ausgegeben
+
+    // Statistik
+    volatile uint32_t frames;
+    volatile uint32_t evq_lost;
+    volatile uint32_t udr;
+    volatile uint32_t ovr;
+    uint32_t bytes;
+    uint32_t ring_lost;
+} spsl_t;
+
+static uint8_t g_spsl_ring[SPSL_RING_SIZE] D2_RAM;
+static uint8_t g_spsl_resp[SPSL_RESP_MAX] D2_RAM;
+static uint16_t g_spsl_resp_len = 0u;
+static uint8_t g_spsl_resp_next[SPSL_RESP_MAX];     // nur CPU, kein DMA
+static uint16_t g_spsl_resp_next_len = 0u;
+static volatile uint8_t g_spsl_resp_pending = 0u;
+static spsl_t g_spsl;
+
+#ifdef HAL_SPI_MODULE_ENABLED
+extern SPI_HandleTypeDef hspi2;
+#endif
+
+static void spsl_stream_off(DMA_Stream_TypeDef *s)
+{
+    CLEAR_BIT(s->CR, DMA_SxCR_EN);
+    for (uint32_t i = 0u; i < 10000u && (s->CR & DMA_SxCR_EN); i++) { }
+}
+
+// Schreibzeiger aus NDTR (IRQ Kontext oder gesperrt)
+static uint32_t spsl_update_head(void)
+{
+    uint32_t pos = SPSL_RING_SIZE - SPSL_DMA_RX->NDTR;
+    if (pos >= SPSL_RING_SIZE) pos = 0u;
+
+    uint32_t delta = (pos - g_spsl.rx_last_pos) & (SPSL_RING_SIZE - 1u);
+    g_spsl.rx_last_pos = pos;
+    g_spsl.head += delta;
+    return g_spsl.head;
+}
+
+static void spsl_tx_load(void)
+{
+    spsl_stream_off(SPSL_DMA_TX);
+    DMA1->HIFCR = SPSL_DMA_FLAGS << SPSL_TX_SHIFT;
+
+    // neue Antwort erst hier, TX Stream steht
+    if (g_spsl_resp_pending) {
+        memcpy(g_spsl_resp, g_spsl_resp_next, g_spsl_resp_next_len);
+        g_spsl_resp_len = g_spsl_resp_next_len;
+        g_spsl_resp_pending = 0u;
+    }
+    if (g_spsl_resp_len == 0u) return;     // nur Fuellbyte (UDRDR)
+
+    SPSL_DMA_TX->CR = DMA_SxCR_DIR_0 | DMA_SxCR_MINC | DMA_SxCR_PL_1 |
+                      (g_spsl.loop ? DMA_SxCR_CIRC : 0u);
+    SPSL_DMA_TX->PAR = (uint32_t)&SPSL_SPI->TXDR;
+    SPSL_DMA_TX->M0AR = (uint32_t)g_spsl_resp;
+    SPSL_DMA_TX->NDTR = g_spsl_resp_len;
+    SPSL_DMA_TX->FCR = 0u;
+    SET_BIT(SPSL_DMA_TX->CR, DMA_SxCR_EN);
+}
+
+// NSS inaktiv: TX FIFO leeren und Antwort von vorne laden
+static void spsl_tx_rearm(void)
+{
+    SPI_TypeDef *spi = SPSL_SPI;
+
+    // RX FIFO erst leer laufen lassen, SPE = 0 verwirft ihn sonst
+    for (uint32_t i = 0u; i < 64u && (spi->SR & (SPI_SR_RXP | SPI_SR_RXWNE | SPI_SR_RXPLVL)); i++) { }
+
+    CLEAR_BIT(spi->CR1, SPI_CR1_SPE);
+    spsl_tx_load();
+    SET_BIT(spi->CR1, SPI_CR1_SPE);
+}
+
+static void spsl_exti_setup(uint8_t on)
+{
+    CLEAR_BIT(EXTI->IMR1, SPSL_NSS_PIN);
+    if (!on) {
+        CLEAR_BIT(EXTI->FTSR1, SPSL_NSS_PIN);
+        CLEAR_BIT(EXTI->RTSR1, SPSL_NSS_PIN);
+        HAL_NVIC_DisableIRQ(EXTI0_IRQn);
+        return;
+    }
+
+    // Pin bleibt im AF Mode (NSS Eingang), EXTI sieht trotzdem die Flanken
+    __HAL_RCC_SYSCFG_CLK_ENABLE();
+    MODIFY_REG(SYSCFG->EXTICR[0], 0xFu, SPSL_NSS_EXTICR);
+    SET_BIT(EXTI->FTSR1, SPSL_NSS_PIN);
+    SET_BIT(EXTI->RTSR1, SPSL_NSS_PIN);
+    EXTI->PR1 = SPSL_NSS_PIN;
+
+    HAL_NVIC_SetPriority(EXTI0_IRQn, SPSL_IRQ_PRIO, 0);
+    HAL_NVIC_EnableIRQ(EXTI0_IRQn);
+    SET_BIT(EXTI->IMR1, SPSL_NSS_PIN);
+}
+
+// Target aktiv: Antwort wird vorgemerkt und beim naechsten NSS Ende
+// (spsl_tx_rearm) geladen; loop laeuft ohne Rearm -> belegt
+HAL_StatusTypeDef SPSL_SetResponse(const uint8_t *data, uint16_t len, uint8_t append)
+{
+    uint8_t target = (g_spsl.active && g_spsl.role == SPSL_TARGET) ? 1u : 0u;
+    if (target && g_spsl.loop) return HAL_BUSY;
+
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    if (!g_spsl_resp_pending) {
+        memcpy(g_spsl_resp_next, g_spsl_resp, g_spsl_resp_len);
+        g_spsl_resp_next_len = g_spsl_resp_len;
+    }
+    uint16_t base = append ? g_spsl_resp_next_len : 0u;
+    if ((uint32_t)base + len > SPSL_RESP_MAX) {
+        __set_PRIMASK(primask);
+        return HAL_ERROR;
+    }
+    if (len) memcpy(&g_spsl_resp_next[base], data, len);
+    g_spsl_resp_next_len = (uint16_t)(base + len);
+    g_spsl_resp_pending = 1u;
+    if (!target) {
+        memcpy(g_spsl_resp, g_spsl_resp_next, g_spsl_resp_next_len);
+        g_spsl_resp_len = g_spsl_resp_next_len;
+        g_spsl_resp_pending = 0u;
+    }
+    __set_PRIMASK(primask);
+    return HAL_OK;
+}
+
+uint16_t SPSL_ResponseLen(void)
+{
+    return g_spsl_resp_pending ? g_spsl_resp_next_len : g_spsl_resp_len;
+}
+
+#ifdef HAL_SPI_MODULE_ENABLED
+HAL_StatusTypeDef SPSL_Start(const spsl_cfg_t *cfg)
+{
+    SPI_TypeDef *spi = SPSL_SPI;
+
+    if (!cfg || cfg->mode > 3u) return HAL_ERROR;
+    if (g_spsl.active) return HAL_BUSY;
+
+    memset(&g_spsl, 0, sizeof(g_spsl));
+    g_spsl.role = cfg->role;
+    g_spsl.loop = cfg->loop;
+
+    hspi2.Init.Mode = SPI_MODE_SLAVE;
+    hspi2.Init.Direction = (cfg->role == SPSL_SNIFF) ? SPI_DIRECTION_2LINES_RXONLY : SPI_DIRECTION_2LINES;
+    hspi2.Init.NSS = SPI_NSS_HARD_INPUT;
+    hspi2.Init.NSSPMode = SPI_NSS_PULSE_DISABLE;
+    hspi2.Init.NSSPolarity = SPI_NSS_POLARITY_LOW;
+    hspi2.Init.CLKPolarity = (cfg->mode & 0x2u) ? SPI_POLARITY_HIGH : SPI_POLARITY_LOW;
+    hspi2.Init.CLKPhase = (cfg->mode & 0x1u) ? SPI_PHASE_2EDGE : SPI_PHASE_1EDGE;
+    hspi2.Init.TIMode = SPI_TIMODE_DISABLE;
+    hspi2.Init.FirstBit = cfg->msb ? SPI_FIRSTBIT_MSB : SPI_FIRSTBIT_LSB;
+    hspi2.Init.DataSize = SPI_DATASIZE_8BIT;
+    hspi2.Init.FifoThreshold = SPI_FIFO_THRESHOLD_01DATA;
+    hspi2.Init.MasterKeepIOState = SPI_MASTER_KEEP_IO_STATE_DISABLE;
+
+    (void)HAL_SPI_DeInit(&hspi2);
+    if (HAL_SPI_Init(&hspi2) != HAL_OK) return HAL_ERROR;
+
+    if (cfg->role == SPSL_SNIFF) {
+        // MISO gehoert dem echten Slave
+        GPIO_InitTypeDef gi = {0};
+        gi.Pin = SPSL_MISO_PIN;
+        gi.Mode = GPIO_MODE_INPUT;
+        gi.Pull = GPIO_NOPULL;
+        HAL_GPIO_Init(SPSL_NSS_PORT, &gi);
+    }
+
+    CLEAR_BIT(spi->CR1, SPI_CR1_SPE);
+    spi->IFCR = SPSL_SPI_IFCR_ALL;
+    spi->UDRDR = cfg->fill;
+    MODIFY_REG(spi->CFG1, SPI_CFG1_UDRCFG, 0u);     // Underrun: UDRDR senden
+
+    // RX Ring
+    spsl_stream_off(SPSL_DMA_RX);
+    DMA1->HIFCR = SPSL_DMA_FLAGS << SPSL_RX_SHIFT;
+    DMAMUX1_Channel4->CCR = DMA_REQUEST_SPI2_RX;
+    SPSL_DMA_RX->CR = DMA_SxCR_CIRC | DMA_SxCR_MINC | DMA_SxCR_PL_1 |
+                      DMA_SxCR_HTIE | DMA_SxCR_TCIE | DMA_SxCR_TEIE;
+    SPSL_DMA_RX->PAR = (uint32_t)&spi->RXDR;
+    SPSL_DMA_RX->M0AR = (uint32_t)g_spsl_ring;
+    SPSL_DMA_RX->NDTR = SPSL_RING_SIZE;
+    SPSL_DMA_RX->FCR = 0u;
+    SET_BIT(spi->CFG1, SPI_CFG1_RXDMAEN);
+    SET_BIT(SPSL_DMA_RX->CR, DMA_SxCR_EN);
+
+    if (cfg->role == SPSL_TARGET) {
+        DMAMUX1_Channel5->CCR = DMA_REQUEST_SPI2_TX;
+        spsl_tx_load();
+        SET_BIT(spi->CFG1, SPI_CFG1_TXDMAEN);
+    }
+
+    HAL_NVIC_SetPriority(DMA1_Stream4_IRQn, SPSL_IRQ_PRIO, 0);
+    HAL_NVIC_EnableIRQ(DMA1_Stream4_IRQn);
+
+    g_spsl.active = 1u;
+    SET_BIT(spi->CR1, SPI_CR1_SPE);
+    spsl_exti_setup(1u);
+
+    // NSS schon aktiv: Frame laeuft ohne Startstempel
+    if (HAL_GPIO_ReadPin(SPSL_NSS_PORT, SPSL_NSS_PIN) == GPIO_PIN_RESET) {
+        g_spsl.in_frame = 1u;
+        g_spsl.f_t_start = TIM_Micros();
+    }
+    return HAL_OK;
+}
+#else
+HAL_StatusTypeDef SPSL_Start(const spsl_cfg_t *cfg) { (void)cfg; return HAL_ERROR; }
+#endif
+
+void SPSL_Stop(void)
+{
+    SPI_TypeDef *spi = SPSL_SPI;
+
+    if (!g_spsl.active) return;
+
+    spsl_exti_setup(0u);
+    SPSL_Poll();                    // fertige Frames noch ausgeben
+    HAL_NVIC_DisableIRQ(DMA1_Stream4_IRQn);
+    CLEAR_BIT(spi->CR1, SPI_CR1_SPE);
+    CLEAR_BIT(spi->CFG1, SPI_CFG1_RXDMAEN | SPI_CFG1_TXDMAEN);
+    spsl_stream_off(SPSL_DMA_RX);
+    spsl_stream_off(SPSL_DMA_TX);
+    DMA1->HIFCR = (SPSL_DMA_FLAGS << SPSL_RX_SHIFT) | (SPSL_DMA_FLAGS << SPSL_TX_SHIFT);
+    spi->IFCR = SPSL_SPI_IFCR_ALL;
+    g_spsl.active = 0u;
+    USBS_Flush(50u);
+    // SPI2 Init als Master macht der SPI Mode (spi_apply_settings)
+}
+
+uint8_t SPSL_IsActive(void)
+{
+    return g_spsl.active;
+}
+
+// ---------------- Ausgabe ----------------
+static uint8_t spsl_write_record(const spsl_ev_t *ev, uint32_t from, uint32_t n, uint8_t flags)
+{
+    if (USBS_Free() < SPSL_HDR_LEN + n) return 0u;
+
+    uint8_t hdr[SPSL_HDR_LEN];
+    hdr[0] = SPSL_SYNC;
+    hdr[1] = flags;
+    memcpy(&hdr[2], &ev->t_start, 4u);
+    memcpy(&hdr[6], &ev->t_end, 4u);
+    hdr[10] = (uint8_t)(n & 0xFFu);
+    hdr[11] = (uint8_t)(n >> 8);
+    (void)USBS_Write(hdr, SPSL_HDR_LEN);
+
+    uint32_t pos = from & (SPSL_RING_SIZE - 1u);
+    uint32_t first = SPSL_RING_SIZE - pos;
+    if (first > n) first = n;
+    (void)USBS_Write(&g_spsl_ring[pos], (uint16_t)first);
+    if (n > first) (void)USBS_Write(g_spsl_ring, (uint16_t)(n - first));
+    return 1u;
+}
+
+void SPSL_Poll(void)
+{
+    uint8_t done = 0u;
+
+    if (!g_spsl.active) return;
+
+    if (g_spsl.evq_lost != g_spsl.evq_lost_seen) {
+        g_spsl.evq_lost_seen = g_spsl.evq_lost;
+        g_spsl.lost_pending = 1u;
+    }
+
+    while (done < SPSL_POLL_RECORDS && g_spsl.evq_tail != g_spsl.evq_head) {
+        spsl_ev_t ev;
+        memcpy(&ev, (const void *)&g_spsl.evq[g_spsl.evq_tail], sizeof(ev));
+
+        uint32_t primask = __get_PRIMASK();
+        __disable_irq();
+        uint32_t head = spsl_update_head();
+        __set_PRIMASK(primask);
+
+        // Ring ueberholt: nur der noch vorhandene Teil geht raus
+        if (!g_spsl.open) g_spsl.tail = ev.start;
+        if (head - g_spsl.tail > SPSL_RING_SIZE) {
+            uint32_t keep = SPSL_RING_SIZE / 2u;
+            uint32_t skip = (head - keep) - g_spsl.tail;
+            g_spsl.ring_lost += skip;
+            g_spsl.tail = head - keep;
+            g_spsl.lost_pending = 1u;
+            if ((int32_t)(ev.end - g_spsl.tail) < 0) {
+                // ganzer Frame weg
+                g_spsl.evq_tail = (uint8_t)((g_spsl.evq_tail + 1u) % SPSL_EVQ_SIZE);
+                g_spsl.open = 0u;
+                continue;
+            }
+        }
+
+        uint32_t n = ev.end - g_spsl.tail;
+        uint8_t flags = ev.flags;
+        if (n > SPSL_REC_MAX) {
+            n = SPSL_REC_MAX;
+            flags |= SPSL_F_CONT;
+        }
+        if (g_spsl.lost_pending) flags |= SPSL_F_LOST;
+
+        if (!spsl_write_record(&ev, g_spsl.tail, n, flags)) break;     // USB voll
+
+        g_spsl.lost_pending = 0u;
+        g_spsl.tail += n;
+        g_spsl.bytes += n;
+        done++;
+        if (flags & SPSL_F_CONT) {
+            g_spsl.open = 1u;
+        } else {
+            g_spsl.open = 0u;
+            g_spsl.evq_tail = (uint8_t)((g_spsl.evq_tail + 1u) % SPSL_EVQ_SIZE);
+        }
+    }
+}
+
+void SPSL_PrintStats(void)
+{
+    cli_printf("\r\ntarget: %s, %s, Antwort %u Bytes%s\r\n",
+               g_spsl.active ? "aktiv" : "aus",
+               (g_spsl.role == SPSL_SNIFF) ? "sniff" : "target",
+               (unsigned)g_spsl_resp_len, g_spsl.loop ? " (loop)" : "");
+    cli_printf("  Frames : %lu (%lu Bytes zum Host)\r\n",
+               (unsigned long)g_spsl.frames, (unsigned long)g_spsl.bytes);
+    cli_printf("  Verlust: %lu Frames (Queue), %lu Bytes (Ring)\r\n",
+               (unsigned long)g_spsl.evq_lost, (unsigned long)g_spsl.ring_lost);
+    cli_printf("  UDR    : %lu  OVR: %lu\r\n", (unsigned long)g_spsl.udr, (unsigned long)g_spsl.ovr);
+}
+
+// ---------------- IRQ ----------------
+void SPSL_ExtiIRQHandler(void)
+{
+    uint32_t now = TIM_Micros();
+
+    if ((EXTI->PR1 & SPSL_NSS_PIN) == 0u) return;
+    EXTI->PR1 = SPSL_NSS_PIN;
+    if (!g_spsl.active) return;
+
+    if ((SPSL_NSS_PORT->IDR & SPSL_NSS_PIN) == 0u) {
+        // NSS fallend: Frame Start
+        g_spsl.f_start = spsl_update_head();
+        g_spsl.f_t_start = now;
+        g_spsl.in_frame = 1u;
+        return;
+    }
+
+    if (!g_spsl.in_frame) return;
+    g_spsl.in_frame = 0u;
+
+    // NSS steigend: letzte Bytes aus dem FIFO abwarten, dann Ende merken
+    SPI_TypeDef *spi = SPSL_SPI;
+    for (uint32_t i = 0u; i < 64u && (spi->SR & (SPI_SR_RXP | SPI_SR_RXWNE | SPI_SR_RXPLVL)); i++) { }
+
+    uint8_t flags = 0u;
+    uint32_t sr = spi->SR;
+    if (sr & SPI_SR_UDR) { flags |= SPSL_F_UDR; g_spsl.udr++; }
+    if (sr & SPI_SR_OVR) { flags |= SPSL_F_OVR; g_spsl.ovr++; }
+    spi->IFCR = SPI_IFCR_UDRC | SPI_IFCR_OVRC;
+
+    uint32_t end = spsl_update_head();
+    if (g_spsl.role == SPSL_TARGET && !g_spsl.loop) spsl_tx_rearm();
+    g_spsl.frames++;
+
+    uint8_t next = (uint8_t)((g_spsl.evq_head + 1u) % SPSL_EVQ_SIZE);
+    if (next == g_spsl.evq_tail) {
+        g_spsl.evq_lost++;
+        return;
+    }
+    g_spsl.evq[g_spsl.evq_head].start = g_spsl.f_start;
+    g_spsl.evq[g_spsl.evq_head].end = end;
+    g_spsl.evq[g_spsl.evq_head].t_start = g_spsl.f_t_start;
+    g_spsl.evq[g_spsl.evq_head].t_end = now;
+    g_spsl.evq[g_spsl.evq_head].flags = flags;
+    g_spsl.evq_head = next;
+}
+
+void SPSL_DmaIRQHandler(void)
+{
+    uint32_t isr = (DMA1->HISR >> SPSL_RX_SHIFT) & SPSL_DMA_FLAGS;
+    DMA1->HIFCR = isr << SPSL_RX_SHIFT;
+    if (g_spsl.active) (void)spsl_update_head();
+}
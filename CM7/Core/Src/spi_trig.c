@@ -0,0 +1,340 @@
+/*
+ * spi_trig.c
+ *
+ *  Timer-triggered SPI2 transactions (TIM3 + DMA) into a circular RX ring.
+ */
+#include "spi_trig.h"
+#include "spi_bulk.h"
+#include "spi_flash.h"
+#include "main.h"
+#include "tim.h"
+#include <string.h>
+
+// ============================================================
+// SPI TRIGGER (SPI2 Master, TIM3, keine CPU Arbeit pro Transaktion)
+//
+//   - SPI2 bleibt eingeschaltet (SPE), TSIZE = Frames pro Transaktion;
+//     nach EOT startet ein erneutes CSTART die naechste Transaktion
+//   - TIM3 Update -> DMA2 Stream 4 schreibt CR1 | CSTART nach SPI2->CR1
+//     (Start), TIM3 CC1 kurz vor dem naechsten Update -> DMA2 Stream 3
+//     schreibt IFCR (EOT/TXTF loeschen). Die CPU ist an keinem Sample
+//     beteiligt, der Abstand kommt allein vom Timer
+//   - RX: DMA1 Stream 4 circular in einen Ring aus ganzen Records
+//     (frames * width Bytes), Schreibzeiger aus NDTR wie in uart_stream
+//     (HT/TC IRQ zieht nach, damit kein Umlauf verloren geht)
+//   - TX (optional): DMA1 Stream 5 circular ueber die Vorlage; pro
+//     Transaktion gehen genau frames Frames raus, die Vorlage bleibt
+//     damit ausgerichtet. Ohne TX: Simplex Receiver (COMM = 10)
+//   - hw_cs: NSS per Hardware (SSOE, SSOM = 0): aktiv von CSTART bis EOT,
+//     also genau eine CS Phase pro Transaktion
+//   - erwartete Transaktionen aus TIM2 (us) -> Luecken am Bus erkennbar
+//
+// Teilt sich DMA1 Stream 4/5 mit spi_bulk.c, nie beide gleichzeitig.
+// ============================================================
+
+#define SPTRG_SPI             SPI2
+#define SPTRG_DMA_RX          DMA1_Stream4
+#define SPTRG_DMA_TX          DMA1_Stream5
+#define SPTRG_DMA_START       DMA2_Stream4
+#define SPTRG_DMA_CLEAR       DMA2_Stream3
+#define SPTRG_DMA_FLAGS      (DMA_HISR_FEIF4 | DMA_HISR_DMEIF4 | DMA_HISR_TEIF4 | \
+                               DMA_HISR_HTIF4 | DMA_HISR_TCIF4)
+#define SPTRG_RX_SHIFT        (0u)      // DMA1 HISR Stream 4
+#define SPTRG_TX_SHIFT        (6u)      // DMA1 HISR Stream 5
+#define SPTRG_START_SHIFT     (0u)      // DMA2 HISR Stream 4
+#define SPTRG_CLEAR_SHIFT     (22u)     // DMA2 LISR Stream 3
+#define SPTRG_CS_AF           GPIO_AF5_SPI2
+
+typedef struct {
+    volatile uint8_t active;
+    uint8_t width;
+    uint8_t hw_cs;
+    uint8_t has_tx;
+    uint16_t rec;                   // Bytes pro Record
+    uint32_t ring_len;              // Vielfaches von rec
+    uint32_t period_us;
+    uint32_t t0_us;
+    uint32_t rx_last_pos;
+    volatile uint32_t head;         // absolut
+    uint32_t tail;
+    uint32_t drops;                 // seit TakeDrops
+    uint32_t cfg1, cfg2, cr1, cr2;  // SPI vor dem Start
+    sptrg_stats_t stats;
+} sptrg_t;
+
+static uint8_t g_sptrg_ring[SPTRG_RING_SIZE] D2_RAM;
+static uint8_t g_sptrg_tx[SPTRG_TX_MAX] D2_RAM;
+// Registerwerte fuer die Timer-DMAs (DMA2 liest sie aus D2)
+static uint32_t g_sptrg_cr1_start D2_RAM;
+static uint32_t g_sptrg_ifcr D2_RAM;
+
+static sptrg_t g_sptrg;
+
+static void sptrg_stream_off(DMA_Stream_TypeDef *s)
+{
+    CLEAR_BIT(s->CR, DMA_SxCR_EN);
+    for (uint32_t i = 0u; i < 10000u && (s->CR & DMA_SxCR_EN); i++) { }
+}
+
+static uint32_t sptrg_size_bits(uint8_t width)
+{
+    if (width == 4u) return DMA_SxCR_PSIZE_1 | DMA_SxCR_MSIZE_1;
+    if (width == 2u) return DMA_SxCR_PSIZE_0 | DMA_SxCR_MSIZE_0;
+    return 0u;
+}
+
+// Schreibzeiger aus NDTR nachziehen (IRQ oder gesperrt)
+static void sptrg_update_head(void)
+{
+    if (!g_sptrg.active) return;
+
+    uint32_t pos = g_sptrg.ring_len - SPTRG_DMA_RX->NDTR * g_sptrg.width;
+    if (pos >= g_sptrg.ring_len) pos = 0u;
+
+    uint32_t delta = (pos + g_sptrg.ring_len - g_sptrg.rx_last_pos) % g_sptrg.ring_len;
+    if (delta == 0u) return;
+
+    g_sptrg.rx_last_pos = pos;
+    g_sptrg.head += delta;
+}
+
+static void sptrg_update_head_locked(void)
+{
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    sptrg_update_head();
+    __set_PRIMASK(primask);
+}
+
+// Leser zu langsam: auf die juengsten ganzen Records springen
+static void sptrg_check_overrun(void)
+{
+    uint32_t fill = g_sptrg.head - g_sptrg.tail;
+    if (fill <= g_sptrg.ring_len - g_sptrg.rec) return;
+
+    uint32_t keep = (g_sptrg.ring_len / 2u) - ((g_sptrg.ring_len / 2u) % g_sptrg.rec);
+    uint32_t head_rec = g_sptrg.head - (g_sptrg.head % g_sptrg.rec);
+    uint32_t lost = (head_rec - keep - g_sptrg.tail) / g_sptrg.rec;
+
+    g_sptrg.tail = head_rec - keep;
+    g_sptrg.drops += lost;
+    g_sptrg.stats.ring_drops += lost;
+}
+
+HAL_StatusTypeDef SPTRG_Start(const sptrg_cfg_t *cfg)
+{
+    SPI_TypeDef *spi = SPTRG_SPI;
+
+    if (!cfg || g_sptrg.active || SPIB_IsActive() || SNOR_IsActive()) return HAL_BUSY;
+    if (cfg->period_us < SPTRG_PERIOD_MIN_US || cfg->period_us > SPTRG_PERIOD_MAX_US) return HAL_ERROR;
+    if (cfg->frames == 0u) return HAL_ERROR;
+    if (cfg->width != 1u && cfg->width != 2u && cfg->width != 4u) return HAL_ERROR;
+
+    uint32_t rec = (uint32_t)cfg->frames * cfg->width;
+    if (rec > SPTRG_RING_SIZE / 4u) return HAL_ERROR;
+    if (cfg->tx && rec > SPTRG_TX_MAX) return HAL_ERROR;
+
+    // TIM3 ist 16 Bit: bis 4 ms in 1/16 us, darueber in 1 us Schritten
+    uint32_t psc = 0u;
+    uint32_t ticks = cfg->period_us * (SPTRG_TIM_CLK_HZ / 1000000u);
+    if (ticks > 0x10000u) {
+        psc = (SPTRG_TIM_CLK_HZ / 1000000u) - 1u;
+        ticks = cfg->period_us;
+    }
+    if (ticks > 0x10000u) return HAL_ERROR;
+
+    memset(&g_sptrg, 0, sizeof(g_sptrg));
+    g_sptrg.width = cfg->width;
+    g_sptrg.rec = (uint16_t)rec;
+    g_sptrg.ring_len = SPTRG_RING_SIZE - (SPTRG_RING_SIZE % rec);
+    g_sptrg.period_us = cfg->period_us;
+    g_sptrg.hw_cs = cfg->hw_cs ? 1u : 0u;
+    g_sptrg.has_tx = cfg->tx ? 1u : 0u;
+    if (cfg->tx) memcpy(g_sptrg_tx, cfg->tx, rec);
+
+    // SPI: aus, Transaktionslaenge, Richtung, NSS
+    CLEAR_BIT(spi->CR1, SPI_CR1_SPE);
+    g_sptrg.cfg1 = spi->CFG1;
+    g_sptrg.cfg2 = spi->CFG2;
+    g_sptrg.cr1 = spi->CR1;
+    g_sptrg.cr2 = spi->CR2;
+    MODIFY_REG(spi->CR2, SPI_CR2_TSIZE, (uint32_t)cfg->frames << SPI_CR2_TSIZE_Pos);
+    MODIFY_REG(spi->CFG2, SPI_CFG2_COMM, cfg->tx ? 0u : SPI_CFG2_COMM_1);
+    if (g_sptrg.hw_cs) {
+        GPIO_InitTypeDef gi = {0};
+        MODIFY_REG(spi->CFG2, SPI_CFG2_SSM | SPI_CFG2_SSOM, SPI_CFG2_SSOE);
+        gi.Pin = SPIB_CS_PIN;
+        gi.Mode = GPIO_MODE_AF_PP;
+        gi.Pull = GPIO_NOPULL;
+        gi.Speed = GPIO_SPEED_FREQ_HIGH;
+        gi.Alternate = SPTRG_CS_AF;
+        HAL_GPIO_Init(SPIB_CS_PORT, &gi);
+    }
+    spi->IFCR = SPI_IFCR_EOTC | SPI_IFCR_TXTFC | SPI_IFCR_OVRC | SPI_IFCR_UDRC | SPI_IFCR_MODFC | SPI_IFCR_SUSPC;
+
+    // RX Ring: DMA1 S4 circular
+    sptrg_stream_off(SPTRG_DMA_RX);
+    DMA1->HIFCR = SPTRG_DMA_FLAGS << SPTRG_RX_SHIFT;
+    DMAMUX1_Channel4->CCR = DMA_REQUEST_SPI2_RX;
+    SPTRG_DMA_RX->CR = DMA_SxCR_CIRC | DMA_SxCR_MINC | DMA_SxCR_PL_1 | sptrg_size_bits(cfg->width) |
+                       DMA_SxCR_HTIE | DMA_SxCR_TCIE | DMA_SxCR_TEIE;
+    SPTRG_DMA_RX->PAR = (uint32_t)&spi->RXDR;
+    SPTRG_DMA_RX->M0AR = (uint32_t)g_sptrg_ring;
+    SPTRG_DMA_RX->NDTR = g_sptrg.ring_len / cfg->width;
+    SPTRG_DMA_RX->FCR = 0u;
+    SET_BIT(spi->CFG1, SPI_CFG1_RXDMAEN);
+    SET_BIT(SPTRG_DMA_RX->CR, DMA_SxCR_EN);
+
+    if (cfg->tx) {
+        sptrg_stream_off(SPTRG_DMA_TX);
+        DMA1->HIFCR = SPTRG_DMA_FLAGS << SPTRG_TX_SHIFT;
+        DMAMUX1_Channel5->CCR = DMA_REQUEST_SPI2_TX;
+        SPTRG_DMA_TX->CR = DMA_SxCR_DIR_0 | DMA_SxCR_CIRC | DMA_SxCR_MINC | DMA_SxCR_PL_0 |
+                           sptrg_size_bits(cfg->width);
+        SPTRG_DMA_TX->PAR = (uint32_t)&spi->TXDR;
+        SPTRG_DMA_TX->M0AR = (uint32_t)g_sptrg_tx;
+        SPTRG_DMA_TX->NDTR = cfg->frames;
+        SPTRG_DMA_TX->FCR = 0u;
+        SET_BIT(SPTRG_DMA_TX->CR, DMA_SxCR_EN);
+        SET_BIT(spi->CFG1, SPI_CFG1_TXDMAEN);
+    }
+
+    SET_BIT(spi->CR1, SPI_CR1_SPE);
+    g_sptrg_cr1_start = spi->CR1 | SPI_CR1_CSTART;
+    g_sptrg_ifcr = SPI_IFCR_EOTC | SPI_IFCR_TXTFC | SPI_IFCR_SUSPC;
+
+    // Timer-DMAs: je ein Wort, circular, kein Increment
+    __HAL_RCC_DMA2_CLK_ENABLE();
+    sptrg_stream_off(SPTRG_DMA_START);
+    sptrg_stream_off(SPTRG_DMA_CLEAR);
+    DMA2->HIFCR = SPTRG_DMA_FLAGS << SPTRG_START_SHIFT;
+    DMA2->LIFCR = SPTRG_DMA_FLAGS << SPTRG_CLEAR_SHIFT;
+    DMAMUX1_Channel12->CCR = DMA_REQUEST_TIM3_UP;
+    DMAMUX1_Channel11->CCR = DMA_REQUEST_TIM3_CH1;
+
+    SPTRG_DMA_START->CR = DMA_SxCR_DIR_0 | DMA_SxCR_CIRC | DMA_SxCR_PL_1 | DMA_SxCR_PSIZE_1 | DMA_SxCR_MSIZE_1;
+    SPTRG_DMA_START->PAR = (uint32_t)&spi->CR1;
+    SPTRG_DMA_START->M0AR = (uint32_t)&g_sptrg_cr1_start;
+    SPTRG_DMA_START->NDTR = 1u;
+    SPTRG_DMA_START->FCR = 0u;
+    SPTRG_DMA_CLEAR->CR = DMA_SxCR_DIR_0 | DMA_SxCR_CIRC | DMA_SxCR_PL_1 | DMA_SxCR_PSIZE_1 | DMA_SxCR_MSIZE_1;
+    SPTRG_DMA_CLEAR->PAR = (uint32_t)&spi->IFCR;
+    SPTRG_DMA_CLEAR->M0AR = (uint32_t)&g_sptrg_ifcr;
+    SPTRG_DMA_CLEAR->NDTR = 1u;
+    SPTRG_DMA_CLEAR->FCR = 0u;
+    SET_BIT(SPTRG_DMA_START->CR, DMA_SxCR_EN);
+    SET_BIT(SPTRG_DMA_CLEAR->CR, DMA_SxCR_EN);
+
+    HAL_NVIC_SetPriority(DMA1_Stream4_IRQn, SPTRG_DMA_IRQ_PRIO, 0);
+    HAL_NVIC_EnableIRQ(DMA1_Stream4_IRQn);
+
+    g_sptrg.active = 1u;
+
+    // TIM3: Update = Start, CC1 = Flags loeschen kurz davor
+    __HAL_RCC_TIM3_CLK_ENABLE();
+    TIM3->CR1 = 0u;
+    TIM3->PSC = psc;
+    TIM3->ARR = ticks - 1u;
+    TIM3->CCR1 = ticks - 1u - SPTRG_GUARD_TICKS;
+    TIM3->CCMR1 = 0u;
+    TIM3->CNT = 0u;
+    TIM3->EGR = TIM_EGR_UG;
+    TIM3->SR = 0u;
+    TIM3->DIER = TIM_DIER_UDE | TIM_DIER_CC1DE;
+    g_sptrg.t0_us = TIM_Micros();
+    SET_BIT(TIM3->CR1, TIM_CR1_CEN);
+    return HAL_OK;
+}
+
+void SPTRG_Stop(void)
+{
+    SPI_TypeDef *spi = SPTRG_SPI;
+
+    if (!g_sptrg.active) return;
+
+    TIM3->DIER = 0u;
+    CLEAR_BIT(TIM3->CR1, TIM_CR1_CEN);
+    sptrg_stream_off(SPTRG_DMA_START);
+    sptrg_stream_off(SPTRG_DMA_CLEAR);
+
+    // laufende Transaktion noch fertig werden lassen
+    uint32_t t0 = HAL_GetTick();
+    while ((spi->CR1 & SPI_CR1_CSTART) && (HAL_GetTick() - t0) < 2u) { }
+
+    HAL_NVIC_DisableIRQ(DMA1_Stream4_IRQn);
+    sptrg_update_head();
+    sptrg_stream_off(SPTRG_DMA_RX);
+    sptrg_stream_off(SPTRG_DMA_TX);
+    DMA1->HIFCR = (SPTRG_DMA_FLAGS << SPTRG_RX_SHIFT) | (SPTRG_DMA_FLAGS << SPTRG_TX_SHIFT);
+
+    CLEAR_BIT(spi->CR1, SPI_CR1_SPE);
+    spi->IFCR = SPI_IFCR_EOTC | SPI_IFCR_TXTFC | SPI_IFCR_OVRC | SPI_IFCR_UDRC | SPI_IFCR_MODFC | SPI_IFCR_SUSPC;
+    spi->CFG1 = g_sptrg.cfg1;
+    spi->CFG2 = g_sptrg.cfg2;
+    spi->CR2 = g_sptrg.cr2;
+    spi->CR1 = g_sptrg.cr1 & ~SPI_CR1_SPE;
+
+    if (g_sptrg.hw_cs) SPIB_CsInit();
+    g_sptrg.active = 0u;
+}
+
+uint8_t SPTRG_IsActive(void)
+{
+    return g_sptrg.active;
+}
+
+uint16_t SPTRG_RecordSize(void)
+{
+    return g_sptrg.rec;
+}
+
+uint32_t SPTRG_Available(void)
+{
+    if (g_sptrg.rec == 0u) return 0u;
+
+    // nach Stop bleibt der Rest im Ring lesbar
+    if (g_sptrg.active) sptrg_update_head_locked();
+    sptrg_check_overrun();
+    return (g_sptrg.head - g_sptrg.tail) / g_sptrg.rec;
+}
+
+const uint8_t *SPTRG_Peek(uint32_t *records)
+{
+    uint32_t n = SPTRG_Available();
+    uint32_t pos = g_sptrg.tail % g_sptrg.ring_len;
+    uint32_t to_end = (g_sptrg.ring_len - pos) / g_sptrg.rec;
+
+    if (n > to_end) n = to_end;
+    if (records) *records = n;
+    return &g_sptrg_ring[pos];
+}
+
+void SPTRG_Drop(uint32_t records)
+{
+    g_sptrg.tail += records * g_sptrg.rec;
+    g_sptrg.stats.records += records;
+}
+
+uint32_t SPTRG_TakeDrops(void)
+{
+    uint32_t d = g_sptrg.drops;
+    g_sptrg.drops = 0u;
+    return d;
+}
+
+void SPTRG_GetStats(sptrg_stats_t *st)
+{
+    if (!st) return;
+    *st = g_sptrg.stats;
+    st->records += (g_sptrg.head - g_sptrg.tail) / (g_sptrg.rec ? g_sptrg.rec : 1u);
+    if (g_sptrg.active && g_sptrg.period_us > 0u) {
+        st->expected = (TIM_Micros() - g_sptrg.t0_us) / g_sptrg.period_us;
+    }
+}
+
+void SPTRG_DmaIRQHandler(void)
+{
+    uint32_t isr = (DMA1->HISR >> SPTRG_RX_SHIFT) & SPTRG_DMA_FLAGS;
+    DMA1->HIFCR = isr << SPTRG_RX_SHIFT;
+    sptrg_update_head();
+}
@@ -0,0 +1,388 @@
+/*
+ * ssi_enc.c
+ *
+ *  SSI absolute encoder reader on SPI2 (receive-only master, timer-triggered DMA).
+ */
+#include "ssi_enc.h"
+#include "spi_trig.h"
+#include "spi_bulk.h"
+#include "usb_stream.h"
+#include "tim.h"
+#include "cli.h"
+#include <string.h>
+
+// ============================================================
+// SSI ENCODER (SPI2 Master, nur RX)
+//
+//   - ein SSI Frame = ein SPI Frame: DSIZE = lead + bits + err + par
+//     (max. 32), MISO = Daten vom Geber, MOSI bleibt frei
+//   - CPOL = 1 (Takt Ruhe high), KeepIOState: SCK bleibt auch bei
+//     SPE = 0 high, damit die Monoflop Zeit des Gebers sauber ablaeuft
+//   - run: spi_trig.c startet per TIM3 + DMA alle 1/HZ eine Transaktion
+//     mit genau einem Frame, die Frames landen im D2 Ring; hier nur
+//     Dekodieren (Gray, Fehlerbits, Parity) aus der Superloop
+//   - rec: 8 Byte Record pro Sample an usb_stream, nur wenn er ganz passt;
+//     sonst bleibt er im Ring (Verlust erst bei Ring Overrun -> SSI_F_DROP,
+//     seq springt um die Anzahl verlorener Samples)
+//   - stat: pro Fenster min/max und Geschwindigkeit als Textzeile, die
+//     Position wird modulo 2^bits abgewickelt (Ueberlauf = Umdrehung)
+// ============================================================
+
+#ifdef HAL_SPI_MODULE_ENABLED
+extern SPI_HandleTypeDef hspi2;
+#endif
+
+typedef struct {
+    volatile uint8_t active;
+    uint8_t out;
+    uint8_t width;
+    uint16_t seq;
+    uint32_t period_us;
+    uint32_t stat_ms;
+    uint32_t t_win;
+    uint8_t have_last;
+    uint8_t drop_pending;           // naechster Record bekommt SSI_F_DROP
+    uint32_t last_pos;
+    // Fenster (stat)
+    uint32_t w_n;
+    uint32_t w_steps;               // Abstaende mit gueltiger Differenz
+    uint32_t w_min;
+    uint32_t w_max;
+    int64_t w_delta;
+    // gesamt
+    uint32_t samples;
+    uint32_t err;
+    uint32_t par_fail;
+    uint32_t drops;
+} ssi_run_t;
+
+static ssi_cfg_t g_ssi_cfg;
+static uint32_t g_ssi_clk_hz = 0u;
+static uint32_t g_ssi_t_last = 0u;      // Ende des letzten Einzel-Frames (us)
+static ssi_run_t g_ssi;
+
+static uint8_t ssi_total_bits(const ssi_cfg_t *c)
+{
+    return (uint8_t)(c->lead + c->bits + c->err_bits + ((c->parity != SSI_PAR_NONE) ? 1u : 0u));
+}
+
+static uint32_t ssi_mask(uint8_t bits)
+{
+    return (bits >= 32u) ? 0xFFFFFFFFu : ((1u << bits) - 1u);
+}
+
+static uint32_t ssi_gray_to_bin(uint32_t g)
+{
+    g ^= g >> 16;
+    g ^= g >> 8;
+    g ^= g >> 4;
+    g ^= g >> 2;
+    g ^= g >> 1;
+    return g;
+}
+
+static uint8_t ssi_popcount(uint32_t v)
+{
+    uint8_t n = 0u;
+    while (v) { v &= v - 1u; n++; }
+    return n;
+}
+
+static void ssi_decode(uint32_t raw, ssi_sample_t *s)
+{
+    const ssi_cfg_t *c = &g_ssi_cfg;
+    uint8_t par = (c->parity != SSI_PAR_NONE) ? 1u : 0u;
+    uint32_t data = (raw >> par) & ssi_mask((uint8_t)(c->bits + c->err_bits));
+    uint32_t pos = data >> c->err_bits;
+
+    s->raw = raw;
+    s->err = (uint8_t)(data & ssi_mask(c->err_bits));
+    s->par_fail = 0u;
+    if (par) {
+        uint8_t ones = (uint8_t)(ssi_popcount(data) + (raw & 1u));
+        s->par_fail = (c->parity == SSI_PAR_EVEN) ? (ones & 1u) : !(ones & 1u);
+    }
+    s->pos = c->gray ? ssi_gray_to_bin(pos) : pos;
+}
+
+void SSI_DefaultCfg(ssi_cfg_t *cfg)
+{
+    memset(cfg, 0, sizeof(*cfg));
+    cfg->bits = 13u;
+    cfg->parity = SSI_PAR_NONE;
+    cfg->gray = 1u;
+    cfg->mode = 3u;
+    cfg->clk_hz = SSI_CLK_DEFAULT_HZ;
+    cfg->mono_us = SSI_MONO_DEFAULT_US;
+}
+
+#ifdef HAL_SPI_MODULE_ENABLED
+static uint32_t ssi_prescaler(uint32_t kernel, uint32_t hz, uint32_t *actual)
+{
+    static const uint32_t hal[] = {
+        SPI_BAUDRATEPRESCALER_2, SPI_BAUDRATEPRESCALER_4, SPI_BAUDRATEPRESCALER_8,
+        SPI_BAUDRATEPRESCALER_16, SPI_BAUDRATEPRESCALER_32, SPI_BAUDRATEPRESCALER_64,
+        SPI_BAUDRATEPRESCALER_128, SPI_BAUDRATEPRESCALER_256,
+    };
+
+    for (uint32_t i = 0u; i < 8u; i++) {
+        uint32_t f = kernel >> (i + 1u);
+        if (f <= hz || i == 7u) {
+            *actual = f;
+            return hal[i];
+        }
+    }
+    return SPI_BAUDRATEPRESCALER_256;
+}
+
+HAL_StatusTypeDef SSI_Apply(const ssi_cfg_t *cfg)
+{
+    uint8_t total = ssi_total_bits(cfg);
+
+    if (cfg->bits == 0u || cfg->err_bits > SSI_ERR_BITS_MAX || cfg->mode > 3u) return HAL_ERROR;
+    if (total < 4u || total > SSI_BITS_MAX) return HAL_ERROR;
+    if (g_ssi.active || SPTRG_IsActive() || SPIB_IsActive()) return HAL_BUSY;
+
+    uint32_t kernel = HAL_RCCEx_GetPeriphCLKFreq(RCC_PERIPHCLK_SPI123);
+    uint32_t clk = 0u;
+
+    hspi2.Init.Mode = SPI_MODE_MASTER;
+    hspi2.Init.Direction = SPI_DIRECTION_2LINES_RXONLY;
+    hspi2.Init.NSS = SPI_NSS_SOFT;
+    hspi2.Init.NSSPMode = SPI_NSS_PULSE_DISABLE;
+    hspi2.Init.CLKPolarity = (cfg->mode & 0x2u) ? SPI_POLARITY_HIGH : SPI_POLARITY_LOW;
+    hspi2.Init.CLKPhase = (cfg->mode & 0x1u) ? SPI_PHASE_2EDGE : SPI_PHASE_1EDGE;
+    hspi2.Init.TIMode = SPI_TIMODE_DISABLE;
+    hspi2.Init.FirstBit = SPI_FIRSTBIT_MSB;
+    hspi2.Init.DataSize = (uint32_t)(total - 1u) << SPI_CFG1_DSIZE_Pos;
+    hspi2.Init.BaudRatePrescaler = ssi_prescaler(kernel, cfg->clk_hz, &clk);
+    hspi2.Init.MasterKeepIOState = SPI_MASTER_KEEP_IO_STATE_ENABLE;
+
+    (void)HAL_SPI_DeInit(&hspi2);
+    HAL_StatusTypeDef st = HAL_SPI_Init(&hspi2);
+    SPIB_CsInit();
+    if (st != HAL_OK) return st;
+
+    g_ssi_cfg = *cfg;
+    g_ssi_clk_hz = clk;
+    g_ssi_t_last = TIM_Micros();
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef SSI_Read(ssi_sample_t *s)
+{
+    uint32_t raw = 0u;
+
+    if (!s || g_ssi_clk_hz == 0u) return HAL_ERROR;
+    if (g_ssi.active || SPTRG_IsActive()) return HAL_BUSY;
+
+    while ((TIM_Micros() - g_ssi_t_last) < g_ssi_cfg.mono_us) { }
+
+    // HAL liest je nach DSIZE 8/16/32 Bit, little endian -> raw passt immer
+    HAL_StatusTypeDef st = HAL_SPI_Receive(&hspi2, (uint8_t *)&raw, 1u, SSI_READ_TIMEOUT_MS);
+    g_ssi_t_last = TIM_Micros();
+    if (st != HAL_OK) return st;
+
+    ssi_decode(raw, s);
+    return HAL_OK;
+}
+#else
+HAL_StatusTypeDef SSI_Apply(const ssi_cfg_t *cfg) { (void)cfg; return HAL_ERROR; }
+HAL_StatusTypeDef SSI_Read(ssi_sample_t *s) { (void)s; return HAL_ERROR; }
+#endif
+
+uint32_t SSI_ClockHz(void)
+{
+    return g_ssi_clk_hz;
+}
+
+// Frame + Monoflop + Startverzug, aufgerundet
+uint32_t SSI_MinPeriodUs(void)
+{
+    if (g_ssi_clk_hz == 0u) return 0u;
+    uint32_t frame_us = ((uint32_t)ssi_total_bits(&g_ssi_cfg) * 1000000u + g_ssi_clk_hz - 1u) / g_ssi_clk_hz;
+    uint32_t min = frame_us + g_ssi_cfg.mono_us + SSI_TRIG_LATENCY_US;
+    return (min < SPTRG_PERIOD_MIN_US) ? SPTRG_PERIOD_MIN_US : min;
+}
+
+static void ssi_win_reset(void)
+{
+    g_ssi.w_n = 0u;
+    g_ssi.w_steps = 0u;
+    g_ssi.w_min = 0xFFFFFFFFu;
+    g_ssi.w_max = 0u;
+    g_ssi.w_delta = 0;
+    g_ssi.t_win = HAL_GetTick();
+}
+
+HAL_StatusTypeDef SSI_Run(uint32_t hz, ssi_out_t out, uint32_t stat_ms)
+{
+    if (hz == 0u || g_ssi_clk_hz == 0u) return HAL_ERROR;
+
+    uint32_t period = 1000000u / hz;
+    if (period < SSI_MinPeriodUs() || period > SPTRG_PERIOD_MAX_US) return HAL_ERROR;
+
+    uint8_t total = ssi_total_bits(&g_ssi_cfg);
+    sptrg_cfg_t tc;
+    memset(&tc, 0, sizeof(tc));
+    tc.period_us = period;
+    tc.frames = 1u;
+    tc.width = (total > 16u) ? 4u : ((total > 8u) ? 2u : 1u);
+
+    memset(&g_ssi, 0, sizeof(g_ssi));
+    g_ssi.out = (uint8_t)out;
+    g_ssi.width = tc.width;
+    g_ssi.period_us = period;
+    g_ssi.stat_ms = stat_ms ? stat_ms : 1000u;
+    ssi_win_reset();
+
+    HAL_StatusTypeDef st = SPTRG_Start(&tc);
+    if (st != HAL_OK) return st;
+    g_ssi.active = 1u;
+    return HAL_OK;
+}
+
+static void ssi_print_stats(const sptrg_stats_t *st)
+{
+    cli_printf("\r\nssi: %lu Hz, %lu Samples, err=%lu par=%lu drop=%lu\r\n",
+               (unsigned long)(g_ssi.period_us ? 1000000u / g_ssi.period_us : 0u),
+               (unsigned long)g_ssi.samples, (unsigned long)g_ssi.err,
+               (unsigned long)g_ssi.par_fail, (unsigned long)g_ssi.drops);
+    if (st) {
+        cli_printf("  Trigger: %lu erwartet, %lu im Ring angekommen\r\n",
+                   (unsigned long)st->expected, (unsigned long)st->records);
+    }
+}
+
+void SSI_Stop(void)
+{
+    sptrg_stats_t st;
+
+    if (!g_ssi.active) return;
+
+    SSI_Poll();
+    SPTRG_GetStats(&st);
+    SPTRG_Stop();
+    g_ssi.active = 0u;
+    g_ssi_t_last = TIM_Micros();
+    if (g_ssi.out == SSI_OUT_REC) USBS_Flush(50u);
+    ssi_print_stats(&st);
+}
+
+uint8_t SSI_IsActive(void)
+{
+    return g_ssi.active;
+}
+
+static uint32_t ssi_raw_at(const uint8_t *p)
+{
+    if (g_ssi.width == 4u) return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+    if (g_ssi.width == 2u) return (uint32_t)p[0] | ((uint32_t)p[1] << 8);
+    return p[0];
+}
+
+static void ssi_stat_sample(const ssi_sample_t *s)
+{
+    if (g_ssi.have_last) {
+        // Differenz modulo 2^bits, vorzeichenrichtig (Umdrehung)
+        uint8_t bits = g_ssi_cfg.bits;
+        uint32_t d = (s->pos - g_ssi.last_pos) & ssi_mask(bits);
+        int32_t sd = (bits >= 32u) ? (int32_t)d
+                   : ((d & (1u << (bits - 1u))) ? (int32_t)(d | ~ssi_mask(bits)) : (int32_t)d);
+        g_ssi.w_delta += sd;
+        g_ssi.w_steps++;
+    }
+    if (s->pos < g_ssi.w_min) g_ssi.w_min = s->pos;
+    if (s->pos > g_ssi.w_max) g_ssi.w_max = s->pos;
+    g_ssi.w_n++;
+}
+
+static void ssi_stat_print(void)
+{
+    int32_t v = 0;
+    if (g_ssi.w_steps > 0u) {
+        // Counts/s ueber die Sample-Abstaende (Luecken nach Drops zaehlen nicht)
+        v = (int32_t)((g_ssi.w_delta * 1000000) / ((int64_t)g_ssi.w_steps * g_ssi.period_us));
+    }
+    if (g_ssi.w_n == 0u) {
+        cli_printf("\r\nssi: keine Samples\r\n");
+    } else {
+        cli_printf("\r\nssi: n=%lu min=%lu max=%lu v=%ld/s err=%lu par=%lu drop=%lu\r\n",
+                   (unsigned long)g_ssi.w_n, (unsigned long)g_ssi.w_min, (unsigned long)g_ssi.w_max,
+                   (long)v, (unsigned long)g_ssi.err, (unsigned long)g_ssi.par_fail,
+                   (unsigned long)g_ssi.drops);
+    }
+    ssi_win_reset();
+}
+
+void SSI_Poll(void)
+{
+    if (!g_ssi.active) return;
+
+    uint32_t lost = SPTRG_TakeDrops();
+    if (lost) {
+        g_ssi.drops += lost;
+        g_ssi.seq = (uint16_t)(g_ssi.seq + lost);
+        g_ssi.have_last = 0u;
+        g_ssi.drop_pending = 1u;
+    }
+
+    uint32_t done = 0u;
+    while (done < SSI_POLL_RECORDS) {
+        uint32_t n = 0u;
+        const uint8_t *p = SPTRG_Peek(&n);
+        if (n == 0u) break;
+        if (n > SSI_POLL_RECORDS - done) n = SSI_POLL_RECORDS - done;
+
+        uint32_t i;
+        for (i = 0u; i < n; i++) {
+            ssi_sample_t s;
+            ssi_decode(ssi_raw_at(p + i * g_ssi.width), &s);
+
+            if (g_ssi.out == SSI_OUT_REC) {
+                if (USBS_Free() < SSI_REC_SIZE) break;
+                uint8_t rec[SSI_REC_SIZE];
+                rec[0] = SSI_REC_SYNC;
+                rec[1] = (uint8_t)((s.err & SSI_F_ERR_MASK) | (s.par_fail ? SSI_F_PARITY : 0u) |
+                                   (g_ssi.drop_pending ? SSI_F_DROP : 0u));
+                rec[2] = (uint8_t)(g_ssi.seq & 0xFFu);
+                rec[3] = (uint8_t)(g_ssi.seq >> 8);
+                rec[4] = (uint8_t)(s.pos & 0xFFu);
+                rec[5] = (uint8_t)((s.pos >> 8) & 0xFFu);
+                rec[6] = (uint8_t)((s.pos >> 16) & 0xFFu);
+                rec[7] = (uint8_t)(s.pos >> 24);
+                (void)USBS_Write(rec, SSI_REC_SIZE);
+            } else {
+                ssi_stat_sample(&s);
+            }
+
+            g_ssi.drop_pending = 0u;
+            g_ssi.seq++;
+            g_ssi.samples++;
+            if (s.err) g_ssi.err++;
+            if (s.par_fail) g_ssi.par_fail++;
+            g_ssi.last_pos = s.pos;
+            g_ssi.have_last = 1u;
+        }
+        SPTRG_Drop(i);
+        done += i;
+        if (i < n) break;       // USB voll
+    }
+
+    if (g_ssi.out == SSI_OUT_STAT && (HAL_GetTick() - g_ssi.t_win) >= g_ssi.stat_ms) {
+        ssi_stat_print();
+        CLI_PrintPrompt();
+    }
+}
+
+void SSI_PrintStats(void)
+{
+    sptrg_stats_t st;
+
+    if (!g_ssi.active) {
+        ssi_print_stats(NULL);
+        return;
+    }
+    SPTRG_GetStats(&st);
+    ssi_print_stats(&st);
+}
@@ -0,0 +1,259 @@
+#include "ssi_mode.h"
+#include "ssi_enc.h"
+#include "spi_cyc.h"
+#include "spi_slave.h"
+#include "spi_bulk.h"
+#include "spi_flash.h"
+#include "cli.h"
+#include "usb_stream.h"
+#include "stm32h7xx_hal.h"
+#include <string.h>
+#include <stdlib.h>
+
+// ============================================================
+// SSI MODE (Absolutwertgeber an SPI2, nur RX)
+//
+//   - Takt auf SCK, Daten vom Geber auf MISO, Pegel wie im SPI Mode
+//     (BUCK5, SPI Setup); RS422 Treiber extern
+//   - cfg/clk/mono initialisieren SPI2 sofort neu (ssi_enc.c)
+//   - read: Einzelwerte als Text, run: Timer getriggert per DMA, Ausgabe
+//     binaer (rec) oder als Statistik pro Fenster (stat)
+// ============================================================
+
+static ssi_cfg_t g_ssi_mode_cfg;
+static uint8_t g_ssi_mode_init = 0u;
+
+static const char *ssi_par_str(uint8_t par)
+{
+    if (par == SSI_PAR_EVEN) return "even";
+    if (par == SSI_PAR_ODD) return "odd";
+    return "none";
+}
+
+static void ssi_print_cfg(void)
+{
+    cli_printf("\r\nSSI: %u Bit %s, err=%u par=%s lead=%u, Mode %u, %lu Hz, Monoflop %lu us\r\n",
+               (unsigned)g_ssi_mode_cfg.bits, g_ssi_mode_cfg.gray ? "gray" : "bin",
+               (unsigned)g_ssi_mode_cfg.err_bits, ssi_par_str(g_ssi_mode_cfg.parity),
+               (unsigned)g_ssi_mode_cfg.lead, (unsigned)g_ssi_mode_cfg.mode,
+               (unsigned long)SSI_ClockHz(), (unsigned long)g_ssi_mode_cfg.mono_us);
+    if (SSI_MinPeriodUs() > 0u) {
+        cli_printf("  run max. %lu Hz\r\n", (unsigned long)(1000000u / SSI_MinPeriodUs()));
+    }
+}
+
+// neue Einstellung uebernehmen; bei Fehler bleibt die alte aktiv
+static void ssi_apply(const ssi_cfg_t *cfg)
+{
+    HAL_StatusTypeDef st = SSI_Apply(cfg);
+    if (st == HAL_OK) {
+        g_ssi_mode_cfg = *cfg;
+        ssi_print_cfg();
+    } else if (st == HAL_BUSY) {
+        cli_printf("\r\nSPI2 belegt (run/bulk aktiv).\r\n");
+    } else {
+        cli_printf("\r\nssi: ungueltig (lead+bits+err+par = 4..32, err <= %u)\r\n", (unsigned)SSI_ERR_BITS_MAX);
+    }
+}
+
+static void ssi_cfg_usage(void)
+{
+    cli_printf("\r\ncfg <BITS> [err=N] [par=none|even|odd] [gray|bin] [lead=N] [mode=0..3]\r\n");
+    cli_printf("  Frame: lead Bits, Position MSB first, Fehlerbits, Parity (ueber Position + Fehlerbits)\r\n");
+}
+
+static void ssi_cmd_cfg(char *args)
+{
+    char *save = NULL;
+    char *tok = strtok_r(args, " ", &save);
+    ssi_cfg_t cfg = g_ssi_mode_cfg;
+
+    if (!tok) { ssi_print_cfg(); return; }
+
+    unsigned long bits = strtoul(tok, NULL, 10);
+    if (bits == 0u || bits > SSI_BITS_MAX) { ssi_cfg_usage(); return; }
+    cfg.bits = (uint8_t)bits;
+
+    while ((tok = strtok_r(NULL, " ", &save)) != NULL) {
+        if (strncmp(tok, "err=", 4) == 0) cfg.err_bits = (uint8_t)strtoul(tok + 4, NULL, 10);
+        else if (strncmp(tok, "lead=", 5) == 0) cfg.lead = (uint8_t)strtoul(tok + 5, NULL, 10);
+        else if (strncmp(tok, "mode=", 5) == 0) cfg.mode = (uint8_t)strtoul(tok + 5, NULL, 10);
+        else if (strcmp(tok, "par=none") == 0) cfg.parity = SSI_PAR_NONE;
+        else if (strcmp(tok, "par=even") == 0) cfg.parity = SSI_PAR_EVEN;
+        else if (strcmp(tok, "par=odd") == 0) cfg.parity = SSI_PAR_ODD;
+        else if (strcmp(tok, "gray") == 0) cfg.gray = 1u;
+        else if (strcmp(tok, "bin") == 0) cfg.gray = 0u;
+        else {
+            cli_printf("\r\nssi: unbekannt '%s'\r\n", tok);
+            ssi_cfg_usage();
+            return;
+        }
+    }
+    ssi_apply(&cfg);
+}
+
+static void ssi_cmd_read(char *args)
+{
+    unsigned long n = strtoul(args, NULL, 10);
+    if (n == 0u) n = 1u;
+    if (n > 100u) n = 100u;
+
+    for (unsigned long i = 0u; i < n; i++) {
+        ssi_sample_t s;
+        HAL_StatusTypeDef st = SSI_Read(&s);
+        if (st != HAL_OK) {
+            cli_printf("\r\nssi: read FEHLER (%s)\r\n", (st == HAL_BUSY) ? "run aktiv" : "SPI2");
+            return;
+        }
+        cli_printf("\r\npos=%lu raw=0x%08lX err=%u%s\r\n", (unsigned long)s.pos, (unsigned long)s.raw,
+                   (unsigned)s.err, s.par_fail ? " PARITY" : "");
+    }
+}
+
+static void ssi_run_usage(void)
+{
+    cli_printf("\r\nrun <HZ> [rec|stat] [MS]  - Timer getriggert lesen (TIM3 + DMA)\r\n");
+    cli_printf("  rec : 8 Byte Records binaer zum Host: A5, flags, seq(u16), pos(u32), little endian\r\n");
+    cli_printf("        flags: bit0-1 Fehlerbits, bit6 Parity falsch, bit7 Luecke davor\r\n");
+    cli_printf("  stat: alle MS (Default 1000) min/max/Geschwindigkeit als Text\r\n");
+    cli_printf("  stop beendet, danach Zusammenfassung\r\n");
+}
+
+static void ssi_cmd_run(char *args)
+{
+    char *save = NULL;
+    char *hz_s = strtok_r(args, " ", &save);
+    char *out_s = strtok_r(NULL, " ", &save);
+    char *ms_s = strtok_r(NULL, " ", &save);
+    uint32_t hz = hz_s ? strtoul(hz_s, NULL, 10) : 0u;
+    ssi_out_t out = SSI_OUT_STAT;
+
+    if (hz == 0u) { ssi_run_usage(); return; }
+    if (out_s && strcmp(out_s, "rec") == 0) out = SSI_OUT_REC;
+    else if (out_s && strcmp(out_s, "stat") != 0) { ssi_run_usage(); return; }
+
+    if (out == SSI_OUT_REC) {
+        cli_printf("\r\nssi run: %lu Hz, Records -> Host\r\n", (unsigned long)hz);
+        USBS_Flush(50u);
+    }
+
+    HAL_StatusTypeDef st = SSI_Run(hz, out, ms_s ? strtoul(ms_s, NULL, 10) : 0u);
+    if (st == HAL_BUSY) {
+        cli_printf("\r\nssi run: SPI2 belegt\r\n");
+    } else if (st != HAL_OK) {
+        uint32_t min = SSI_MinPeriodUs();
+        cli_printf("\r\nssi run: Rate ungueltig (max. %lu Hz bei Frame + Monoflop)\r\n",
+                   (unsigned long)(min ? 1000000u / min : 0u));
+    } else if (out == SSI_OUT_STAT) {
+        cli_printf("\r\nssi run: %lu Hz, Statistik\r\n", (unsigned long)hz);
+    }
+}
+
+static void ssi_print_help(void)
+{
+    if (!CLI_IsDebugEnabled()) {
+        CLI_PrintDebugRequired();
+        return;
+    }
+    cli_printf("SSI Mode Befehle:\r\n");
+    cli_printf("  cfg ...       - Frame Format (cfg ?), ohne Argument anzeigen\r\n");
+    cli_printf("  clk <kHz>     - SSI Takt\r\n");
+    cli_printf("  mono <US>     - Monoflop Zeit des Gebers\r\n");
+    cli_printf("  read [N]      - N Einzelwerte als Text\r\n");
+    cli_printf("  run ...       - Timer getriggert, binaer oder Statistik (run ?)\r\n");
+    cli_printf("  stop | stat\r\n");
+    cli_printf("  ?             - Hilfe\r\n");
+}
+
+// ---------------- Public API ----------------
+void SSI_Mode_Enter(void)
+{
+    if (!g_ssi_mode_init) {
+        SSI_DefaultCfg(&g_ssi_mode_cfg);
+        g_ssi_mode_init = 1u;
+    }
+    SSI_Stop();
+    SNOR_Stop();    // SPI2 gehoert jetzt dem SSI Mode
+    SPIB_Stop();
+    SPCYC_Stop();
+    SPSL_Stop();
+    ssi_apply(&g_ssi_mode_cfg);
+    if (CLI_IsDebugEnabled()) {
+        ssi_print_help();
+    }
+}
+
+uint8_t SSI_Mode_HandleLine(char *line)
+{
+    if (!line) return 0;
+
+    while (*line == ' ' || *line == '\t') line++;
+    if (*line == '\0') return 1;
+
+    if (strcmp(line, "?") == 0 || strcmp(line, "help") == 0) {
+        ssi_print_help();
+        return 1;
+    }
+
+    if (strcmp(line, "stop") == 0) {
+        if (!SSI_IsActive()) cli_printf("\r\nssi: nicht aktiv\r\n");
+        SSI_Stop();
+        return 1;
+    }
+
+    if (strcmp(line, "stat") == 0) {
+        SSI_PrintStats();
+        return 1;
+    }
+
+    if (strncmp(line, "cfg", 3) == 0 && (line[3] == '\0' || line[3] == ' ')) {
+        if (strcmp(line, "cfg ?") == 0) ssi_cfg_usage();
+        else ssi_cmd_cfg(line + 3);
+        return 1;
+    }
+
+    if (strncmp(line, "clk ", 4) == 0) {
+        ssi_cfg_t cfg = g_ssi_mode_cfg;
+        uint32_t khz = strtoul(line + 4, NULL, 10);
+        if (khz == 0u) { cli_printf("\r\nclk <kHz>\r\n"); return 1; }
+        cfg.clk_hz = khz * 1000u;
+        ssi_apply(&cfg);
+        return 1;
+    }
+
+    if (strncmp(line, "mono ", 5) == 0) {
+        ssi_cfg_t cfg = g_ssi_mode_cfg;
+        cfg.mono_us = strtoul(line + 5, NULL, 10);
+        ssi_apply(&cfg);
+        return 1;
+    }
+
+    if (strncmp(line, "read", 4) == 0 && (line[4] == '\0' || line[4] == ' ')) {
+        ssi_cmd_read(line + 4);
+        return 1;
+    }
+
+    if (strncmp(line, "run", 3) == 0 && (line[3] == '\0' || line[3] == ' ')) {
+        if (strcmp(line, "run ?") == 0) ssi_run_usage();
+        else ssi_cmd_run(line + 3);
+        return 1;
+    }
+
+    return 0;
+}
+
+uint8_t SSI_Mode_HandleChar(char ch)
+{
+    if (ch == '?') { ssi_print_help(); return 1; }
+    return 0;
+}
+
+void SSI_Mode_Poll(void)
+{
+    SSI_Poll();
+}
+
+void SSI_Mode_Exit(void)
+{
+    SSI_Stop();
+}
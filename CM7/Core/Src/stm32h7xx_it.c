@@ -23,6 +23,19 @@
 /* Private includes ----------------------------------------------------------*/
 /* USER CODE BEGIN Includes */
 #include "fdcan.h"
+#include "can_sim.h"
+#include "uart_stream.h"
+#include "uart_trace.h"
+#include "uart_mitm.h"
+#include "spi_bulk.h"
+#include "spi_trig.h"
+#include "spi_slave.h"
+#include "i2c_scan.h"
+#include "i2c_queue.h"
+#include "i2c_watch.h"
+#include "i2c_slave.h"
+#include "lin.h"
+#include "dio_la.h"
 /* USER CODE END Includes */
 
 /* Private typedef -----------------------------------------------------------*/
@@ -58,6 +71,10 @@
 /* External variables --------------------------------------------------------*/
 extern PCD_HandleTypeDef hpcd_USB_OTG_HS;
 extern FDCAN_HandleTypeDef hfdcan1;
+extern DMA_HandleTypeDef hdma_uart4_rx;
+extern DMA_HandleTypeDef hdma_uart8_rx;
+extern DMA_HandleTypeDef hdma_uart4_tx;
+extern DMA_HandleTypeDef hdma_uart8_tx;
 /* USER CODE BEGIN EV */
 
 /* USER CODE END EV */
@@ -189,6 +206,7 @@ void SysTick_Handler(void)
   /* USER CODE END SysTick_IRQn 0 */
   HAL_IncTick();
   /* USER CODE BEGIN SysTick_IRQn 1 */
+  CAN_Sim_Tick();
 
   /* USER CODE END SysTick_IRQn 1 */
 }
@@ -199,6 +217,83 @@ void SysTick_Handler(void)
 /* For the available peripheral interrupt handler names,                      */
 /* please refer to the startup file (startup_stm32h7xx.s).                    */
 /******************************************************************************/
+/**
+  * @brief This function handles DMA1 stream0 global interrupt.
+  */
+void DMA1_Stream0_IRQHandler(void)
+{
+  /* USER CODE BEGIN DMA1_Stream0_IRQn 0 */
+
+  /* USER CODE END DMA1_Stream0_IRQn 0 */
+  HAL_DMA_IRQHandler(&hdma_uart4_rx);
+  /* USER CODE BEGIN DMA1_Stream0_IRQn 1 */
+
+  /* USER CODE END DMA1_Stream0_IRQn 1 */
+}
+
+/**
+  * @brief This function handles DMA1 stream1 global interrupt.
+  */
+void DMA1_Stream1_IRQHandler(void)
+{
+  /* USER CODE BEGIN DMA1_Stream1_IRQn 0 */
+
+  /* USER CODE END DMA1_Stream1_IRQn 0 */
+  HAL_DMA_IRQHandler(&hdma_uart4_tx);
+  /* USER CODE BEGIN DMA1_Stream1_IRQn 1 */
+
+  /* USER CODE END DMA1_Stream1_IRQn 1 */
+}
+
+/**
+  * @brief This function handles DMA1 stream2 global interrupt.
+  */
+void DMA1_Stream2_IRQHandler(void)
+{
+  /* USER CODE BEGIN DMA1_Stream2_IRQn 0 */
+
+  /* USER CODE END DMA1_Stream2_IRQn 0 */
+  HAL_DMA_IRQHandler(&hdma_uart8_rx);
+  /* USER CODE BEGIN DMA1_Stream2_IRQn 1 */
+
+  /* USER CODE END DMA1_Stream2_IRQn 1 */
+}
+
+/**
+  * @brief This function handles DMA1 stream3 global interrupt.
+  */
+void DMA1_Stream3_IRQHandler(void)
+{
+  /* USER CODE BEGIN DMA1_Stream3_IRQn 0 */
+
+  /* USER CODE END DMA1_Stream3_IRQn 0 */
+  HAL_DMA_IRQHandler(&hdma_uart8_tx);
+  /* USER CODE BEGIN DMA1_Stream3_IRQn 1 */
+
+  /* USER CODE END DMA1_Stream3_IRQn 1 */
+}
+
+/**
+  * @brief This function handles DMA1 stream4 global interrupt.
+  *        SPI2 RX: bulk stream (spi_bulk.c), triggered ring (spi_trig.c)
+  *        or slave capture ring (spi_slave.c).
+  */
+void DMA1_Stream4_IRQHandler(void)
+{
+  if (SPTRG_IsActive()) SPTRG_DmaIRQHandler();
+  else if (SPSL_IsActive()) SPSL_DmaIRQHandler();
+  else SPIB_DmaIRQHandler(0u);
+}
+
+/**
+  * @brief This function handles DMA1 stream5 global interrupt.
+  *        SPI2 TX bulk stream (spi_bulk.c).
+  */
+void DMA1_Stream5_IRQHandler(void)
+{
+  SPIB_DmaIRQHandler(1u);
+}
+
 /**
   * @brief This function handles FDCAN1 interrupt line 0.
   */
@@ -207,6 +302,136 @@ void FDCAN1_IT0_IRQHandler(void)
   HAL_FDCAN_IRQHandler(&hfdcan1);
 }
 
+/**
+  * @brief This function handles UART4 global interrupt.
+  *        Not HAL_UART_IRQHandler: it aborts the RX DMA on RTO/ORE.
+  */
+void UART4_IRQHandler(void)
+{
+  UARTS_IRQHandler(UARTS_CH_UART4);
+}
+
+/**
+  * @brief This function handles UART8 global interrupt.
+  */
+void UART8_IRQHandler(void)
+{
+  UARTS_IRQHandler(UARTS_CH_UART8);
+}
+
+/**
+  * @brief This function handles EXTI line0 interrupt.
+  *        PI0 (SPI2_NSS) frame edges for spi_slave.c.
+  */
+void EXTI0_IRQHandler(void)
+{
+  SPSL_ExtiIRQHandler();
+}
+
+/**
+  * @brief This function handles EXTI line[9:5] interrupts.
+  *        PJ9 (UART8_RX) start bit stamp for uart_trace.c.
+  */
+void EXTI9_5_IRQHandler(void)
+{
+  UTRACE_ExtiIRQHandler();
+}
+
+/**
+  * @brief This function handles EXTI line[15:10] interrupts.
+  *        PC11 (UART4_RX) start bit stamp for uart_trace.c.
+  */
+void EXTI15_10_IRQHandler(void)
+{
+  UTRACE_ExtiIRQHandler();
+}
+
+/**
+  * @brief This function handles I2C1 event interrupt.
+  *        Target emulation (i2c_slave.c), register watch (i2c_watch.c),
+  *        transaction queue (i2c_queue.c) or bus scanner (i2c_scan.c).
+  */
+void I2C1_EV_IRQHandler(void)
+{
+  if (I2CSL_IsActive()) I2CSL_IRQHandler();
+  else if (I2CW_IsActive()) I2CW_IRQHandler();
+  else if (I2CQ_IsActive()) I2CQ_IRQHandler();
+  else I2CSCAN_IRQHandler(I2C1);
+}
+
+/**
+  * @brief This function handles I2C1 error interrupt.
+  */
+void I2C1_ER_IRQHandler(void)
+{
+  if (I2CSL_IsActive()) I2CSL_IRQHandler();
+  else if (I2CW_IsActive()) I2CW_IRQHandler();
+  else if (I2CQ_IsActive()) I2CQ_IRQHandler();
+  else I2CSCAN_IRQHandler(I2C1);
+}
+
+/**
+  * @brief This function handles I2C4 event interrupt.
+  *        Address probes of the bus scanner (i2c_scan.c).
+  */
+void I2C4_EV_IRQHandler(void)
+{
+  I2CSCAN_IRQHandler(I2C4);
+}
+
+/**
+  * @brief This function handles I2C4 error interrupt.
+  */
+void I2C4_ER_IRQHandler(void)
+{
+  I2CSCAN_IRQHandler(I2C4);
+}
+
+/**
+  * @brief This function handles TIM6 global interrupt, DAC1_CH1 and DAC1_CH2 underrun error interrupts.
+  *        LIN schedule slot timer (lin.c).
+  */
+void TIM6_DAC_IRQHandler(void)
+{
+  LIN_TimerIRQHandler();
+}
+
+/**
+  * @brief This function handles TIM7 global interrupt.
+  *        Register watch scheduler tick (i2c_watch.c).
+  */
+void TIM7_IRQHandler(void)
+{
+  I2CW_TimerIRQHandler();
+}
+
+/**
+  * @brief This function handles DMA2 stream0 global interrupt.
+  *        Logic analyzer sample ring segments (dio_la.c).
+  */
+void DMA2_Stream0_IRQHandler(void)
+{
+  DIOLA_DmaIRQHandler();
+}
+
+/**
+  * @brief This function handles DMA2 stream1 global interrupt.
+  *        UART4 -> UART8 proxy stream (uart_mitm.c).
+  */
+void DMA2_Stream1_IRQHandler(void)
+{
+  MITM_DmaIRQHandler(0u);
+}
+
+/**
+  * @brief This function handles DMA2 stream2 global interrupt.
+  *        UART8 -> UART4 proxy stream (uart_mitm.c).
+  */
+void DMA2_Stream2_IRQHandler(void)
+{
+  MITM_DmaIRQHandler(1u);
+}
+
 /**
   * @brief This function handles USB On The Go HS End Point 1 In global interrupt.
   */
@@ -0,0 +1,468 @@
+/*
+ * uart_bert.c
+ *
+ *  PRBS bit-error-rate test and baud/slew-rate sweep on UART4 (RS485).
+ */
+#include "uart_bert.h"
+#include "main.h"
+#include "cli.h"
+#include <string.h>
+#include <stdio.h>
+
+// ============================================================
+// UART BERT
+//
+// - TX: UART4 ueber den TX DMA Ring von uart_stream.c, die Superloop
+//   haelt den Ring voll -> lueckenloser Datenstrom, DE bleibt aktiv
+// - RX: UART4 (Echo des RS485 Transceivers bzw. externe Schleife) oder
+//   UART8 (zweite Schnittstelle), Pruefung aus dem RX Ring
+// - PRBS als Fibonacci LFSR, h Bit 0 = aeltestes Bit, Bitfolge auf der
+//   Leitung LSB first wie die UART:
+//     * PRBS15/23: beide Abgriffe >= 8 Bit zurueck -> ein Byte pro Schritt
+//       (byte = h ^ (h >> (n - m)))
+//     * PRBS7: bitweise
+// - Empfaenger: Register aus den ersten empfangenen Bits laden, danach
+//   frei laufend vergleichen (Fehler werden nicht vervielfacht wie bei
+//   einem selbstsynchronisierenden Pruefer); Synchronverlust (verlorenes
+//   Zeichen) ueber Fehlerquote im Fenster -> neu laden, zaehlt als resync
+// - FE/NE/PE/ORE und Ring-Ueberlauf aus den uart_stream Zaehlern
+// - Sweep: Baudraten x SLR (RS485_SLR_Control), pro Schritt Einschwingzeit
+//   ohne Auswertung, danach dwell_ms messen; Ursprungszustand am Ende
+// ============================================================
+
+#define BERT_TX_CHUNK         (64u)
+#define BERT_RX_BUDGET        (4096u)   // Bytes pro Poll
+#define BERT_LOCK_VERIFY      (4u)      // fehlerfreie Bytes nach dem Laden
+#define BERT_WIN              (64u)     // Fenster fuer Synchronverlust
+#define BERT_WIN_ERR_MAX      (BERT_WIN / 4u)
+#define BERT_STEP_MAX         (BERT_SWEEP_MAX * 2u)
+
+typedef struct {
+    uint32_t baud;
+    uint32_t real;
+    uint8_t slr;
+    uint64_t bytes;
+    uint64_t bit_err;
+    uint32_t byte_err;
+    uint32_t fe;
+    uint32_t ne;
+    uint32_t pe;
+    uint32_t ore;
+    uint32_t lost;
+    uint32_t resync;
+} bert_res_t;
+
+typedef struct {
+    uint32_t baud;
+    uint8_t slr;
+} bert_step_t;
+
+static uint8_t g_bert_active = 0u;
+static uint8_t g_bert_n = BERT_PRBS15;        // Registerlaenge
+static uint8_t g_bert_tap = 1u;               // n - m
+static uarts_ch_t g_bert_rx = UARTS_CH_UART4;
+
+static uint32_t g_bert_tx_h;
+static uint32_t g_bert_rx_h;
+static uint8_t g_bert_locked = 0u;
+static uint8_t g_bert_loaded = 0u;
+static uint8_t g_bert_verify = 0u;
+static uint8_t g_bert_win = 0u;
+static uint8_t g_bert_win_err = 0u;
+
+static bert_res_t g_bert_cur;
+static uarts_stats_t g_bert_base;             // RX Zaehler zu Schrittbeginn
+static uint32_t g_bert_t0 = 0u;
+static uint8_t g_bert_settling = 0u;
+
+static uint8_t g_bert_sweep = 0u;
+static bert_step_t g_bert_steps[BERT_STEP_MAX];
+static uint8_t g_bert_nsteps = 0u;
+static uint8_t g_bert_step = 0u;
+static uint32_t g_bert_dwell_ms = BERT_DWELL_DEF_MS;
+static bert_res_t g_bert_res[BERT_STEP_MAX];
+static uint8_t g_bert_nres = 0u;
+static uint32_t g_bert_baud_orig[UARTS_CH_COUNT];
+static uint8_t g_bert_slr_orig = 0u;
+
+// ---------------- SLR ----------------
+
+static void bert_set_slr(uint8_t en)
+{
+#if defined(RS485_SLR_Control_GPIO_Port) && defined(RS485_SLR_Control_Pin)
+    HAL_GPIO_WritePin(RS485_SLR_Control_GPIO_Port, RS485_SLR_Control_Pin, en ? GPIO_PIN_SET : GPIO_PIN_RESET);
+#else
+    (void)en;
+#endif
+}
+
+static uint8_t bert_read_slr(void)
+{
+#if defined(RS485_SLR_Control_GPIO_Port) && defined(RS485_SLR_Control_Pin)
+    return (HAL_GPIO_ReadPin(RS485_SLR_Control_GPIO_Port, RS485_SLR_Control_Pin) == GPIO_PIN_SET) ? 1u : 0u;
+#else
+    return 0u;
+#endif
+}
+
+// ---------------- PRBS ----------------
+
+static uint32_t bert_mask(void)
+{
+    return (1u << g_bert_n) - 1u;
+}
+
+static uint8_t bert_gen(uint32_t *h)
+{
+    uint32_t s = *h;
+    uint8_t out = 0u;
+
+    if (g_bert_n < 8u) {
+        for (uint8_t k = 0; k < 8u; k++) {
+            uint32_t x = (s ^ (s >> g_bert_tap)) & 1u;
+            s = (s >> 1) | (x << (g_bert_n - 1u));
+            out |= (uint8_t)(x << k);
+        }
+    } else {
+        out = (uint8_t)(s ^ (s >> g_bert_tap));
+        s = (s >> 8) | ((uint32_t)out << (g_bert_n - 8u));
+    }
+    *h = s;
+    return out;
+}
+
+// empfangenes Byte ins Pruefregister schieben (Synchronisation)
+static void bert_load(uint8_t b)
+{
+    if (g_bert_n < 8u) {
+        g_bert_rx_h = ((uint32_t)b >> (8u - g_bert_n)) & bert_mask();
+    } else {
+        g_bert_rx_h = ((g_bert_rx_h >> 8) | ((uint32_t)b << (g_bert_n - 8u))) & bert_mask();
+    }
+    g_bert_loaded++;
+    if (g_bert_loaded >= (uint8_t)((g_bert_n + 7u) / 8u)) {
+        g_bert_locked = 1u;
+        g_bert_verify = 0u;
+    }
+}
+
+static void bert_unlock(void)
+{
+    g_bert_locked = 0u;
+    g_bert_loaded = 0u;
+    g_bert_win = 0u;
+    g_bert_win_err = 0u;
+}
+
+static void bert_rx_byte(uint8_t b)
+{
+    if (!g_bert_locked) {
+        bert_load(b);
+        return;
+    }
+
+    uint8_t d = (uint8_t)(b ^ bert_gen(&g_bert_rx_h));
+
+    if (g_bert_verify < BERT_LOCK_VERIFY) {
+        if (d != 0u) {
+            // falsch geladen (Fehler im Ladefenster) -> von vorn
+            bert_unlock();
+            bert_load(b);
+        } else {
+            g_bert_verify++;
+        }
+        return;
+    }
+
+    g_bert_cur.bytes++;
+    if (d != 0u) {
+        g_bert_cur.byte_err++;
+        g_bert_cur.bit_err += (uint32_t)__builtin_popcount(d);
+        g_bert_win_err++;
+    }
+    if (++g_bert_win >= BERT_WIN) {
+        if (g_bert_win_err > BERT_WIN_ERR_MAX) {
+            g_bert_cur.resync++;
+            bert_unlock();
+            return;
+        }
+        g_bert_win = 0u;
+        g_bert_win_err = 0u;
+    }
+}
+
+// ---------------- Ablauf ----------------
+
+static void bert_snapshot(void)
+{
+    g_bert_base = *UARTS_GetStats(g_bert_rx);
+}
+
+static void bert_collect(void)
+{
+    const uarts_stats_t *s = UARTS_GetStats(g_bert_rx);
+    g_bert_cur.fe = s->fe - g_bert_base.fe;
+    g_bert_cur.ne = s->ne - g_bert_base.ne;
+    g_bert_cur.pe = s->pe - g_bert_base.pe;
+    g_bert_cur.ore = s->ore - g_bert_base.ore;
+    g_bert_cur.lost = s->rx_lost - g_bert_base.rx_lost;
+}
+
+// neuer Messabschnitt: Einschwingen, danach Zaehler ab Null
+static void bert_begin(uint32_t baud, uint8_t slr)
+{
+    memset(&g_bert_cur, 0, sizeof(g_bert_cur));
+    g_bert_cur.baud = baud;
+    g_bert_cur.real = UARTS_GetRealBaud(UARTS_CH_UART4);
+    g_bert_cur.slr = slr;
+    bert_unlock();
+    g_bert_settling = 1u;
+    g_bert_t0 = HAL_GetTick();
+}
+
+static HAL_StatusTypeDef bert_apply_step(void)
+{
+    const bert_step_t *st = &g_bert_steps[g_bert_step];
+
+    if (UARTS_SetBaud(UARTS_CH_UART4, st->baud) != HAL_OK) return HAL_ERROR;
+    if (g_bert_rx != UARTS_CH_UART4 && UARTS_SetBaud(g_bert_rx, st->baud) != HAL_OK) return HAL_ERROR;
+    bert_set_slr(st->slr);
+    bert_begin(st->baud, st->slr);
+    return HAL_OK;
+}
+
+static void bert_print_row(const bert_res_t *r);
+
+static void bert_step_done(void)
+{
+    bert_collect();
+    if (g_bert_nres < BERT_STEP_MAX) g_bert_res[g_bert_nres++] = g_bert_cur;
+    bert_print_row(&g_bert_cur);
+
+    while (++g_bert_step < g_bert_nsteps) {
+        if (bert_apply_step() == HAL_OK) return;
+        cli_printf("%8lu  Baudrate nicht moeglich\r\n", (unsigned long)g_bert_steps[g_bert_step].baud);
+    }
+    cli_printf("BERT Sweep fertig\r\n");
+    BERT_Stop();
+}
+
+static HAL_StatusTypeDef bert_setup(bert_prbs_t prbs, uarts_ch_t rx)
+{
+    BERT_Stop();
+
+    if (prbs != BERT_PRBS7 && prbs != BERT_PRBS15 && prbs != BERT_PRBS23) return HAL_ERROR;
+    if (rx >= UARTS_CH_COUNT) return HAL_ERROR;
+
+    uarts_line_t line;
+    UARTS_GetLine(UARTS_CH_UART4, &line);
+    if (line.data_bits != 8u) return HAL_ERROR;
+    if (rx != UARTS_CH_UART4) {
+        UARTS_GetLine(rx, &line);
+        if (line.data_bits != 8u) return HAL_ERROR;
+    }
+
+    for (uint8_t i = 0; i < UARTS_CH_COUNT; i++) {
+        if (!UARTS_IsRunning((uarts_ch_t)i) && UARTS_Start((uarts_ch_t)i) != HAL_OK) return HAL_ERROR;
+        g_bert_baud_orig[i] = UARTS_Handle((uarts_ch_t)i)->Init.BaudRate;
+    }
+
+    g_bert_n = (uint8_t)prbs;
+    g_bert_tap = (prbs == BERT_PRBS23) ? 5u : 1u;
+    g_bert_rx = rx;
+    g_bert_tx_h = bert_mask();
+    g_bert_slr_orig = bert_read_slr();
+    g_bert_nres = 0u;
+    UARTS_TxAbort(UARTS_CH_UART4);
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef BERT_Start(bert_prbs_t prbs, uarts_ch_t rx)
+{
+    if (bert_setup(prbs, rx) != HAL_OK) return HAL_ERROR;
+    g_bert_sweep = 0u;
+    g_bert_active = 1u;
+    bert_begin(g_bert_baud_orig[UARTS_CH_UART4], g_bert_slr_orig);
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef BERT_Sweep(bert_prbs_t prbs, uarts_ch_t rx, const uint32_t *bauds,
+                             uint8_t n, uint8_t slr_mask, uint32_t dwell_ms)
+{
+    if (bauds == NULL || n == 0u || n > BERT_SWEEP_MAX || (slr_mask & 3u) == 0u || dwell_ms == 0u) {
+        return HAL_ERROR;
+    }
+    if (bert_setup(prbs, rx) != HAL_OK) return HAL_ERROR;
+
+    g_bert_nsteps = 0u;
+    for (uint8_t i = 0; i < n; i++) {
+        for (uint8_t slr = 0; slr < 2u; slr++) {
+            if (!(slr_mask & (1u << slr))) continue;
+            g_bert_steps[g_bert_nsteps].baud = bauds[i];
+            g_bert_steps[g_bert_nsteps].slr = slr;
+            g_bert_nsteps++;
+        }
+    }
+    g_bert_dwell_ms = dwell_ms;
+    g_bert_sweep = 1u;
+    g_bert_active = 1u;
+
+    cli_printf("\r\nBERT Sweep PRBS%u, RX UART%c, %u Schritte a %lu ms\r\n", (unsigned)g_bert_n,
+               (rx == UARTS_CH_UART4) ? '4' : '8', (unsigned)g_bert_nsteps, (unsigned long)dwell_ms);
+    BERT_PrintResults();
+
+    for (g_bert_step = 0u; g_bert_step < g_bert_nsteps; g_bert_step++) {
+        if (bert_apply_step() == HAL_OK) return HAL_OK;
+        cli_printf("%8lu  Baudrate nicht moeglich\r\n", (unsigned long)g_bert_steps[g_bert_step].baud);
+    }
+    BERT_Stop();
+    return HAL_ERROR;
+}
+
+void BERT_Stop(void)
+{
+    if (!g_bert_active) return;
+    g_bert_active = 0u;
+
+    UARTS_TxAbort(UARTS_CH_UART4);
+    if (g_bert_sweep) {
+        for (uint8_t i = 0; i < UARTS_CH_COUNT; i++) {
+            (void)UARTS_SetBaud((uarts_ch_t)i, g_bert_baud_orig[i]);
+        }
+        bert_set_slr(g_bert_slr_orig);
+        g_bert_sweep = 0u;
+    }
+    for (uint8_t i = 0; i < UARTS_CH_COUNT; i++) UARTS_RxFlush((uarts_ch_t)i);
+}
+
+uint8_t BERT_IsActive(void)
+{
+    return g_bert_active;
+}
+
+void BERT_Poll(void)
+{
+    if (!g_bert_active) return;
+
+    // TX Ring voll halten
+    uint8_t buf[BERT_TX_CHUNK];
+    uint16_t free = UARTS_TxFree(UARTS_CH_UART4);
+    while (free >= BERT_TX_CHUNK) {
+        for (uint8_t i = 0; i < BERT_TX_CHUNK; i++) buf[i] = bert_gen(&g_bert_tx_h);
+        (void)UARTS_Write(UARTS_CH_UART4, buf, BERT_TX_CHUNK);
+        free = (uint16_t)(free - BERT_TX_CHUNK);
+    }
+
+    uint32_t now = HAL_GetTick();
+    if (g_bert_settling) {
+        UARTS_RxFlush(g_bert_rx);
+        if ((now - g_bert_t0) < BERT_SETTLE_MS) return;
+        g_bert_settling = 0u;
+        g_bert_t0 = now;
+        bert_snapshot();
+    }
+
+    uint32_t budget = BERT_RX_BUDGET;
+    while (budget != 0u) {
+        const uint8_t *p = NULL;
+        uint16_t k = UARTS_RxPeek(g_bert_rx, &p);
+        if (k == 0u) break;
+        if (k > budget) k = (uint16_t)budget;
+        for (uint16_t i = 0; i < k; i++) bert_rx_byte(p[i]);
+        UARTS_RxConsume(g_bert_rx, k);
+        budget -= k;
+    }
+
+    if (g_bert_sweep && (now - g_bert_t0) >= g_bert_dwell_ms) {
+        bert_step_done();
+    }
+}
+
+// ---------------- Ausgabe ----------------
+
+static const char *bert_u64_str(char *buf, size_t n, uint64_t v)
+{
+    if (v < 1000000000ull) {
+        snprintf(buf, n, "%lu", (unsigned long)v);
+    } else {
+        snprintf(buf, n, "%lu%09lu", (unsigned long)(v / 1000000000ull),
+                 (unsigned long)(v % 1000000000ull));
+    }
+    return buf;
+}
+
+// err/bits als m.mme-x, ohne Float
+static const char *bert_ber_str(char *buf, size_t n, uint64_t err, uint64_t bits)
+{
+    if (bits == 0u) {
+        snprintf(buf, n, "-");
+    } else if (err == 0u) {
+        char b[24];
+        snprintf(buf, n, "<1/%s", bert_u64_str(b, sizeof(b), bits));
+    } else {
+        uint32_t e = 0u;
+        uint64_t num = err;
+        while (num < bits) {
+            num *= 10u;
+            e++;
+        }
+        uint32_t m100 = (uint32_t)((num * 100u) / bits);
+        snprintf(buf, n, "%lu.%02lue-%lu", (unsigned long)(m100 / 100u),
+                 (unsigned long)(m100 % 100u), (unsigned long)e);
+    }
+    return buf;
+}
+
+static void bert_print_row(const bert_res_t *r)
+{
+    char by[24], be[24], ber[32];
+    cli_printf("%8lu %8lu %3u %12s %10s %-12s %8lu %6lu %6lu %6lu %6lu %6lu %6lu\r\n",
+               (unsigned long)r->baud, (unsigned long)r->real, (unsigned)r->slr,
+               bert_u64_str(by, sizeof(by), r->bytes), bert_u64_str(be, sizeof(be), r->bit_err),
+               bert_ber_str(ber, sizeof(ber), r->bit_err, r->bytes * 8u),
+               (unsigned long)r->byte_err, (unsigned long)r->fe, (unsigned long)r->ne,
+               (unsigned long)r->pe, (unsigned long)r->ore, (unsigned long)r->lost,
+               (unsigned long)r->resync);
+}
+
+void BERT_PrintResults(void)
+{
+    cli_printf("    baud     real slr        bytes    biterr ber          byteerr     fe     ne     pe    ore   lost resync\r\n");
+    for (uint8_t i = 0; i < g_bert_nres; i++) bert_print_row(&g_bert_res[i]);
+}
+
+void BERT_PrintStats(void)
+{
+    if (g_bert_active && !g_bert_settling) bert_collect();
+
+    cli_printf("\r\nBERT: %s PRBS%u, TX UART4, RX UART%c, %s, %lu s\r\n",
+               g_bert_active ? (g_bert_sweep ? "Sweep" : "Dauerlauf") : "aus",
+               (unsigned)g_bert_n, (g_bert_rx == UARTS_CH_UART4) ? '4' : '8',
+               g_bert_locked ? "synchron" : "sucht",
+               (unsigned long)(g_bert_active ? (HAL_GetTick() - g_bert_t0) / 1000u : 0u));
+    if (g_bert_sweep) {
+        cli_printf("  Schritt %u/%u\r\n", (unsigned)(g_bert_step + 1u), (unsigned)g_bert_nsteps);
+    }
+    BERT_PrintResults();
+    if (g_bert_active) {
+        cli_printf("aktuell:\r\n");
+        bert_print_row(&g_bert_cur);
+    }
+}
+
+void BERT_ResetStats(void)
+{
+    if (!g_bert_active) {
+        memset(&g_bert_cur, 0, sizeof(g_bert_cur));
+        g_bert_nres = 0u;
+        return;
+    }
+    uint32_t baud = g_bert_cur.baud;
+    uint8_t slr = g_bert_cur.slr;
+    memset(&g_bert_cur, 0, sizeof(g_bert_cur));
+    g_bert_cur.baud = baud;
+    g_bert_cur.real = UARTS_GetRealBaud(UARTS_CH_UART4);
+    g_bert_cur.slr = slr;
+    g_bert_t0 = HAL_GetTick();
+    bert_snapshot();
+}
@@ -0,0 +1,324 @@
+/*
+ * uart_bridge.c
+ *
+ *  UART4 + UART8 multiplexed over the USB CDC link with channel framing.
+ */
+#include "uart_bridge.h"
+#include "uart_stream.h"
+#include "usb_stream.h"
+#include "cli.h"
+#include <string.h>
+
+// ============================================================
+// UART BRIDGE
+//
+// - Beide UARTs gleichzeitig, jede mit eigenen RX/TX DMA Ringen, Line
+//   Settings und Zaehlern aus uart_stream.c
+// - Ein CDC Link, Kanaele ueber 2 Byte Kopf pro Frame (uart_bridge.h)
+// - Host -> UART: Parser laeuft direkt auf dem USB RX Ring (Raw Pfad in
+//   CLI_Process), volle TX Ringe bremsen den Host ueber den USB NAK
+// - UART -> Host: pro Poll abwechselnd die Kanaele, ein Frame nur wenn er
+//   ganz in usb_stream passt (sonst bleibt es im RX Ring)
+// ============================================================
+
+#define UBRG_POLL_FRAMES      (8u)
+#define UBRG_CTRL_BUF         (16u)
+
+typedef enum {
+    UBRG_RX_HDR = 0,
+    UBRG_RX_LEN,
+    UBRG_RX_DATA,
+    UBRG_RX_CTRL,
+} ubrg_rx_state_t;
+
+typedef struct {
+    uint32_t to_uart;
+    uint32_t to_host;
+    uint8_t half;              // 9 Bit: halbes Zeichen vom Host
+    uint8_t half_valid;
+} ubrg_chan_t;
+
+static uint8_t g_ubrg_active = 0u;
+static ubrg_rx_state_t g_ubrg_rx_state = UBRG_RX_HDR;
+static uint8_t g_ubrg_rx_ch = 0u;
+static uint8_t g_ubrg_rx_left = 0u;
+static uint8_t g_ubrg_ctrl[UBRG_CTRL_BUF];
+static uint8_t g_ubrg_ctrl_len = 0u;
+static uint8_t g_ubrg_next_ch = 0u;
+
+static ubrg_chan_t g_ubrg[UARTS_CH_COUNT];
+static uint32_t g_ubrg_sync_err = 0u;
+static uint32_t g_ubrg_usb_wait = 0u;
+
+static void ubrg_put_le32(uint8_t *p, uint32_t v)
+{
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+    p[2] = (uint8_t)(v >> 16);
+    p[3] = (uint8_t)(v >> 24);
+}
+
+HAL_StatusTypeDef UBRG_Start(void)
+{
+    for (uint8_t i = 0; i < UARTS_CH_COUNT; i++) {
+        uarts_ch_t ch = (uarts_ch_t)i;
+        if (!UARTS_IsRunning(ch) && UARTS_Start(ch) != HAL_OK) {
+            return HAL_ERROR;
+        }
+        UARTS_RxFlush(ch);
+        g_ubrg[i].half_valid = 0u;
+    }
+
+    g_ubrg_rx_state = UBRG_RX_HDR;
+    g_ubrg_next_ch = 0u;
+    g_ubrg_active = 1u;
+    return HAL_OK;
+}
+
+void UBRG_Stop(void)
+{
+    g_ubrg_active = 0u;
+}
+
+uint8_t UBRG_IsActive(void)
+{
+    return g_ubrg_active;
+}
+
+static void ubrg_send_ctrl(const uint8_t *p, uint8_t len)
+{
+    uint8_t hdr[2] = { (uint8_t)(UBRG_HDR | UBRG_CH_CTRL), len };
+    if (USBS_Free() < (uint16_t)(len + 2u)) {
+        g_ubrg_usb_wait++;
+        return;
+    }
+    (void)USBS_Write(hdr, 2u);
+    (void)USBS_Write(p, len);
+}
+
+static void ubrg_ctrl(void)
+{
+    const uint8_t *c = g_ubrg_ctrl;
+    uint8_t rsp[18];
+
+    if (g_ubrg_ctrl_len == 0u) return;
+
+    if (c[0] == UBRG_CTRL_EXIT) {
+        UBRG_Stop();
+        return;
+    }
+
+    if (g_ubrg_ctrl_len < 2u || c[1] >= UARTS_CH_COUNT) {
+        g_ubrg_sync_err++;
+        return;
+    }
+    uarts_ch_t ch = (uarts_ch_t)c[1];
+
+    if (c[0] == UBRG_CTRL_LINE && g_ubrg_ctrl_len >= 9u) {
+        uarts_line_t line;
+        line.baud = (uint32_t)c[2] | ((uint32_t)c[3] << 8) | ((uint32_t)c[4] << 16) | ((uint32_t)c[5] << 24);
+        line.data_bits = c[6];
+        line.parity = (char)c[7];
+        line.stop = c[8];
+
+        rsp[0] = UBRG_CTRL_LINE;
+        rsp[1] = (uint8_t)ch;
+        rsp[2] = (UARTS_SetLine(ch, &line) == HAL_OK) ? 0u : 1u;
+        ubrg_put_le32(&rsp[3], UARTS_GetRealBaud(ch));
+        g_ubrg[ch].half_valid = 0u;
+        ubrg_send_ctrl(rsp, 7u);
+        return;
+    }
+
+    if (c[0] == UBRG_CTRL_STAT) {
+        const uarts_stats_t *s = UARTS_GetStats(ch);
+        rsp[0] = UBRG_CTRL_STAT;
+        rsp[1] = (uint8_t)ch;
+        ubrg_put_le32(&rsp[2], s->rx_bytes);
+        ubrg_put_le32(&rsp[6], s->tx_bytes);
+        ubrg_put_le32(&rsp[10], s->rx_lost);
+        ubrg_put_le32(&rsp[14], s->fe + s->pe + s->ne + s->ore);
+        ubrg_send_ctrl(rsp, 18u);
+        return;
+    }
+
+    g_ubrg_sync_err++;
+}
+
+// Payload in den TX Ring; 9 Bit: ungerades Restbyte bis zum naechsten Aufruf
+static uint16_t ubrg_write(uarts_ch_t ch, const uint8_t *data, uint16_t len)
+{
+    ubrg_chan_t *b = &g_ubrg[ch];
+    uint16_t n = 0u;
+
+    if (!UARTS_IsWide(ch)) {
+        n = UARTS_Write(ch, data, len);
+        b->to_uart += n;
+        return n;
+    }
+
+    if (b->half_valid) {
+        uint8_t w[2] = { b->half, data[0] };
+        if (UARTS_Write(ch, w, 2u) != 2u) return 0u;
+        b->half_valid = 0u;
+        b->to_uart += 2u;
+        n = 1u;
+    }
+
+    uint16_t even = (uint16_t)((len - n) & ~1u);
+    if (even != 0u) {
+        uint16_t done = UARTS_Write(ch, &data[n], even);
+        b->to_uart += done;
+        n = (uint16_t)(n + done);
+        if (done < even) return n;
+    }
+
+    if (n < len) {
+        b->half = data[n];
+        b->half_valid = 1u;
+        n++;
+    }
+    return n;
+}
+
+uint16_t UBRG_HandleRaw(const uint8_t *data, uint16_t len)
+{
+    uint16_t n = 0u;
+
+    while (n < len && g_ubrg_active) {
+        switch (g_ubrg_rx_state) {
+        case UBRG_RX_HDR: {
+            uint8_t b = data[n++];
+            uint8_t ch = (uint8_t)(b & (uint8_t)~UBRG_HDR_MASK);
+            if (b == 0x1Bu) {
+                UBRG_Stop();
+            } else if ((b & UBRG_HDR_MASK) == UBRG_HDR && (ch < UARTS_CH_COUNT || ch == UBRG_CH_CTRL)) {
+                g_ubrg_rx_ch = ch;
+                g_ubrg_rx_state = UBRG_RX_LEN;
+            } else {
+                g_ubrg_sync_err++;           // resync auf das naechste Kopfbyte
+            }
+            break;
+        }
+
+        case UBRG_RX_LEN:
+            g_ubrg_rx_left = data[n++];
+            g_ubrg_ctrl_len = 0u;
+            if (g_ubrg_rx_left == 0u) {
+                g_ubrg_rx_state = UBRG_RX_HDR;
+            } else {
+                g_ubrg_rx_state = (g_ubrg_rx_ch == UBRG_CH_CTRL) ? UBRG_RX_CTRL : UBRG_RX_DATA;
+            }
+            break;
+
+        case UBRG_RX_CTRL: {
+            uint8_t b = data[n++];
+            if (g_ubrg_ctrl_len < UBRG_CTRL_BUF) g_ubrg_ctrl[g_ubrg_ctrl_len++] = b;
+            if (--g_ubrg_rx_left == 0u) {
+                g_ubrg_rx_state = UBRG_RX_HDR;
+                ubrg_ctrl();
+            }
+            break;
+        }
+
+        case UBRG_RX_DATA: {
+            uint16_t k = (uint16_t)(len - n);
+            if (k > g_ubrg_rx_left) k = g_ubrg_rx_left;
+
+            uint16_t done = ubrg_write((uarts_ch_t)g_ubrg_rx_ch, &data[n], k);
+            n = (uint16_t)(n + done);
+            g_ubrg_rx_left = (uint8_t)(g_ubrg_rx_left - done);
+            if (g_ubrg_rx_left == 0u) g_ubrg_rx_state = UBRG_RX_HDR;
+            if (done < k) return n;          // TX Ring voll -> Rest spaeter
+            break;
+        }
+
+        default:
+            g_ubrg_rx_state = UBRG_RX_HDR;
+            break;
+        }
+    }
+
+    return n;
+}
+
+// ein Frame aus dem RX Ring eines Kanals; 0 = nichts da oder kein Platz
+static uint8_t ubrg_frame_out(uarts_ch_t ch)
+{
+    uint16_t avail = UARTS_RxAvailable(ch);
+    if (avail == 0u) return 0u;
+
+    uint16_t n = (avail > UBRG_PAYLOAD_MAX) ? UBRG_PAYLOAD_MAX : avail;
+    if (UARTS_IsWide(ch)) n &= (uint16_t)~1u;
+    if (n == 0u) return 0u;
+
+    if (USBS_Free() < (uint16_t)(n + 2u)) {
+        g_ubrg_usb_wait++;
+        return 0u;
+    }
+
+    uint8_t hdr[2] = { (uint8_t)(UBRG_HDR | (uint8_t)ch), (uint8_t)n };
+    (void)USBS_Write(hdr, 2u);
+
+    uint16_t left = n;
+    while (left != 0u) {
+        const uint8_t *p = NULL;
+        uint16_t k = UARTS_RxPeek(ch, &p);
+        if (k == 0u) break;
+        if (k > left) k = left;
+        (void)USBS_Write(p, k);
+        UARTS_RxConsume(ch, k);
+        left = (uint16_t)(left - k);
+    }
+
+    g_ubrg[ch].to_host += n;
+    return 1u;
+}
+
+void UBRG_Poll(void)
+{
+    if (!g_ubrg_active) return;
+
+    for (uint8_t f = 0; f < UBRG_POLL_FRAMES; f++) {
+        uint8_t sent = 0u;
+        for (uint8_t i = 0; i < UARTS_CH_COUNT; i++) {
+            uarts_ch_t ch = (uarts_ch_t)((g_ubrg_next_ch + i) % UARTS_CH_COUNT);
+            if (ubrg_frame_out(ch)) {
+                g_ubrg_next_ch = (uint8_t)((ch + 1u) % UARTS_CH_COUNT);
+                sent = 1u;
+                break;
+            }
+        }
+        if (!sent) break;
+    }
+
+    USBS_Poll();
+}
+
+void UBRG_PrintStats(void)
+{
+    cli_printf("\r\nBridge: %s  sync_err=%lu usb_wait=%lu\r\n",
+               g_ubrg_active ? "aktiv" : "aus",
+               (unsigned long)g_ubrg_sync_err, (unsigned long)g_ubrg_usb_wait);
+    for (uint8_t i = 0; i < UARTS_CH_COUNT; i++) {
+        uarts_line_t line;
+        const uarts_stats_t *s = UARTS_GetStats((uarts_ch_t)i);
+        UARTS_GetLine((uarts_ch_t)i, &line);
+        cli_printf("  %s %lu %u%c%s: to_uart=%lu to_host=%lu rx_lost=%lu err=%lu\r\n",
+                   (i == UARTS_CH_UART4) ? "UART4" : "UART8", (unsigned long)line.baud,
+                   (unsigned)line.data_bits, line.parity,
+                   (line.stop == UARTS_STOP_2) ? "2" : (line.stop == UARTS_STOP_1_5) ? "1.5" : "1",
+                   (unsigned long)g_ubrg[i].to_uart, (unsigned long)g_ubrg[i].to_host,
+                   (unsigned long)s->rx_lost, (unsigned long)(s->fe + s->pe + s->ne + s->ore));
+    }
+}
+
+void UBRG_ResetStats(void)
+{
+    for (uint8_t i = 0; i < UARTS_CH_COUNT; i++) {
+        g_ubrg[i].to_uart = 0u;
+        g_ubrg[i].to_host = 0u;
+    }
+    g_ubrg_sync_err = 0u;
+    g_ubrg_usb_wait = 0u;
+}
@@ -0,0 +1,427 @@
+/*
+ * uart_mitm.c
+ *
+ *  UART4 <-> UART8 man-in-the-middle proxy with timestamped logging.
+ */
+#include "uart_mitm.h"
+#include "uart_stream.h"
+#include "uart_trace.h"
+#include "cli.h"
+#include <string.h>
+
+// ============================================================
+// UART MITM
+//
+// - Weiterleitung ohne CPU und ohne Superloop:
+//     RX DMA (uart_stream.c, DMA1) -> DMAMUX1 Kanal-Event (EGE) ->
+//     Request Generator -> DMA2 Stream liest dasselbe RDR und schreibt
+//     es in das TDR der Gegenseite
+//   USART FIFO der Quelle ist aus, damit RDR ein Zeichen lang gueltig
+//   bleibt; beide DMAs lesen denselben Wert, kein Wettlauf um den Ring.
+//   Latenz = Zeichenende bis TDR, wenige Buszyklen.
+// - Mitschnitt: uart_trace.c laeuft parallel auf beiden RX Ringen
+//   (Startbit ueber EXTI, Ende ueber RTO, 1 us Stempel)
+// - RS485 (UART4): DE und Echo brauchen Burst-Grenzen, keine Bytes:
+//     * Startbit auf UART8 (Trace EXTI Hook) -> DE an, UART4 -> UART8
+//       Generator aus (eigenes Echo nicht zurueckspielen)
+//     * Burst-Ende auf UART8 (RTO Hook) -> DE nach TC frei, danach
+//       Generator wieder an (UARTS tx_done Callback)
+// - Regeln (Muster ersetzen/verwerfen): die Richtung laeuft dann ueber
+//   den DMA2 TC IRQ pro Byte (RDR -> Scratch), Abgleich mit Halte-Puffer,
+//   Ausgabe ueber den TX Ring; angefangene Muster werden am Burst-Ende
+//   unveraendert weitergegeben
+// ============================================================
+
+#define MITM_DMA_IRQ_PRIO     (5u)
+#define MITM_DMA_FLAGS        (0x3Du)   // FE, DME, TE, HT, TC (pro Stream)
+#define MITM_DMA_TC           (0x20u)
+#define MITM_DMA_TE           (0x08u)
+#define MITM_MUX_EVT_MAX      (2u)      // Request Generator: nur dmamux1_evt0..2
+
+typedef struct {
+    uarts_ch_t src;
+    uarts_ch_t dst;
+    DMA_Stream_TypeDef *st;
+    DMAMUX_Channel_TypeDef *mux;
+    DMAMUX_RequestGen_TypeDef *rg;
+    uint32_t req_id;                // DMAREQ_ID des Generators
+    uint32_t flag_shift;            // DMA2 LISR/LIFCR
+    IRQn_Type irq;
+} mitm_hw_t;
+
+typedef struct {
+    uint8_t used;
+    uint8_t dirs;
+    uint8_t plen;
+    uint8_t rlen;
+    uint8_t pat[MITM_PAT_MAX];
+    uint8_t rep[MITM_PAT_MAX];
+    uint32_t hits;
+} mitm_rule_t;
+
+typedef struct {
+    volatile uint8_t scratch;       // Regel-Pfad: DMA Ziel
+    uint8_t cpu;                    // Regeln aktiv
+    uint8_t hold[MITM_PAT_MAX];
+    uint8_t hn;
+    uint32_t fwd;                   // Regel-Pfad: Bytes an die Gegenseite
+    uint32_t dropped;
+    uint32_t subst;
+    uint32_t tx_lost;               // TX Ring voll
+    uint32_t dma_err;
+} mitm_dir_t;
+
+static const mitm_hw_t g_mitm_hw[2] = {
+    { UARTS_CH_UART4, UARTS_CH_UART8, DMA2_Stream1, DMAMUX1_Channel9,
+      DMAMUX1_RequestGenerator0, DMA_REQUEST_GENERATOR0, 6u, DMA2_Stream1_IRQn },
+    { UARTS_CH_UART8, UARTS_CH_UART4, DMA2_Stream2, DMAMUX1_Channel10,
+      DMAMUX1_RequestGenerator1, DMA_REQUEST_GENERATOR1, 16u, DMA2_Stream2_IRQn },
+};
+
+static mitm_dir_t g_mitm[2];
+static mitm_rule_t g_mitm_rule[MITM_RULE_MAX];
+static uint8_t g_mitm_active = 0u;
+static volatile uint8_t g_mitm_echo_gate = 0u;   // UART4 sendet, 4->8 gesperrt
+static uint32_t g_mitm_de_bursts = 0u;
+
+static DMAMUX_Channel_TypeDef *mitm_src_mux(uint8_t i)
+{
+    DMA_HandleTypeDef *h = UARTS_Handle(g_mitm_hw[i].src)->hdmarx;
+    return (h != NULL) ? h->DMAmuxChannel : NULL;
+}
+
+static uint8_t mitm_dir_has_rules(uint8_t i)
+{
+    for (uint8_t r = 0; r < MITM_RULE_MAX; r++) {
+        if (g_mitm_rule[r].used && (g_mitm_rule[r].dirs & (1u << i))) return 1u;
+    }
+    return 0u;
+}
+
+static void mitm_gen_enable(uint8_t i, uint8_t on)
+{
+    if (on) SET_BIT(g_mitm_hw[i].rg->RGCR, DMAMUX_RGxCR_GE);
+    else CLEAR_BIT(g_mitm_hw[i].rg->RGCR, DMAMUX_RGxCR_GE);
+}
+
+static void mitm_dir_stop(uint8_t i)
+{
+    const mitm_hw_t *hw = &g_mitm_hw[i];
+
+    hw->rg->RGCR = 0u;
+    CLEAR_BIT(hw->st->CR, DMA_SxCR_EN);
+    while (hw->st->CR & DMA_SxCR_EN) {}
+    DMA2->LIFCR = MITM_DMA_FLAGS << hw->flag_shift;
+    hw->mux->CCR = 0u;
+}
+
+static void mitm_dir_setup(uint8_t i)
+{
+    const mitm_hw_t *hw = &g_mitm_hw[i];
+    mitm_dir_t *d = &g_mitm[i];
+    DMA_Stream_TypeDef *st = hw->st;
+    DMAMUX_Channel_TypeDef *src_mux = mitm_src_mux(i);
+
+    mitm_dir_stop(i);
+    d->cpu = mitm_dir_has_rules(i);
+    d->hn = 0u;
+
+    // Peripherie -> Speicher (DIR = 00), Byte, keine Inkremente, 1 Transfer
+    // circular; bei M2P wuerde der Stream im Direct Mode RDR schon beim
+    // Enable/nach jedem Transfer vorab lesen -> immer das vorige Zeichen
+    st->PAR = (uint32_t)&UARTS_Handle(hw->src)->Instance->RDR;
+    st->M0AR = d->cpu ? (uint32_t)&d->scratch
+                      : (uint32_t)&UARTS_Handle(hw->dst)->Instance->TDR;
+    st->NDTR = 1u;
+    st->FCR = 0u;
+    st->CR = DMA_SxCR_CIRC | DMA_SxCR_PL_1 | DMA_SxCR_TEIE |
+             (d->cpu ? DMA_SxCR_TCIE : 0u);
+    hw->mux->CCR = hw->req_id;
+    SET_BIT(st->CR, DMA_SxCR_EN);
+
+    // ein Request pro Kanal-Event der Quell-RX DMA, steigende Flanke
+    hw->rg->RGCR = (uint32_t)(src_mux - DMAMUX1_Channel0) | DMAMUX_RGxCR_GPOL_0;
+    SET_BIT(src_mux->CCR, DMAMUX_CxCR_EGE);
+    if (!(i == 0u && g_mitm_echo_gate)) mitm_gen_enable(i, 1u);
+}
+
+static void mitm_emit(uint8_t i, const uint8_t *p, uint8_t n)
+{
+    if (n == 0u) return;
+    mitm_dir_t *d = &g_mitm[i];
+    uint16_t done = UARTS_Write(g_mitm_hw[i].dst, p, n);
+    d->fwd += done;
+    d->tx_lost += (uint32_t)(n - done);
+}
+
+static void mitm_flush(uint8_t i)
+{
+    mitm_dir_t *d = &g_mitm[i];
+    mitm_emit(i, d->hold, d->hn);
+    d->hn = 0u;
+}
+
+// Halte-Puffer ist Anfang eines (laengeren) Musters dieser Richtung
+static uint8_t mitm_is_prefix(uint8_t dir_bit, const uint8_t *p, uint8_t n)
+{
+    for (uint8_t r = 0; r < MITM_RULE_MAX; r++) {
+        const mitm_rule_t *ru = &g_mitm_rule[r];
+        if (!ru->used || !(ru->dirs & dir_bit) || ru->plen <= n) continue;
+        if (memcmp(ru->pat, p, n) == 0) return 1u;
+    }
+    return 0u;
+}
+
+// DMA2 IRQ: ein Byte im Regel-Pfad
+static void mitm_rx_byte(uint8_t i, uint8_t b)
+{
+    mitm_dir_t *d = &g_mitm[i];
+    uint8_t dir_bit = (uint8_t)(1u << i);
+
+    d->hold[d->hn++] = b;
+
+    // Regel-Reihenfolge = Prioritaet
+    for (uint8_t r = 0; r < MITM_RULE_MAX; r++) {
+        mitm_rule_t *ru = &g_mitm_rule[r];
+        if (!ru->used || !(ru->dirs & dir_bit) || ru->plen > d->hn) continue;
+        if (memcmp(&d->hold[d->hn - ru->plen], ru->pat, ru->plen) != 0) continue;
+
+        mitm_emit(i, d->hold, (uint8_t)(d->hn - ru->plen));
+        mitm_emit(i, ru->rep, ru->rlen);
+        ru->hits++;
+        if (ru->rlen == 0u) d->dropped += ru->plen;
+        else d->subst++;
+        d->hn = 0u;
+        return;
+    }
+
+    // laengstes Suffix behalten, das noch ein Muster werden kann
+    uint8_t s = 0u;
+    while (s < d->hn && !mitm_is_prefix(dir_bit, &d->hold[s], (uint8_t)(d->hn - s))) s++;
+    mitm_emit(i, d->hold, s);
+    d->hn = (uint8_t)(d->hn - s);
+    memmove(d->hold, &d->hold[s], d->hn);
+}
+
+// UART4 TX fertig (DE frei): eigenes Echo vorbei
+static void mitm_u4_tx_done(uarts_ch_t ch)
+{
+    (void)ch;
+    if (!g_mitm_active) return;
+    g_mitm_echo_gate = 0u;
+    mitm_gen_enable(0u, 1u);
+}
+
+// uart_trace Hook (EXTI / RTO, ISR Kontext)
+static void mitm_trace_hook(uint8_t ch, uint8_t start)
+{
+    if (!g_mitm_active) return;
+
+    if (ch == UARTS_CH_UART8) {
+        if (start) {
+            // Zeichen kommt erst am Ende des Startbyte-Rahmens -> DE rechtzeitig
+            g_mitm_echo_gate = 1u;
+            mitm_gen_enable(0u, 0u);
+            UARTS_ExtTxBegin(UARTS_CH_UART4);
+            g_mitm_de_bursts++;
+        } else {
+            mitm_flush(1u);
+            UARTS_ExtTxEnd(UARTS_CH_UART4);
+        }
+    } else if (ch == UARTS_CH_UART4 && !start) {
+        mitm_flush(0u);
+    }
+}
+
+HAL_StatusTypeDef MITM_Start(void)
+{
+    MITM_Stop();
+
+    if (UTRACE_Start() != HAL_OK) return HAL_ERROR;
+    for (uint8_t i = 0; i < 2u; i++) {
+        DMAMUX_Channel_TypeDef *m = mitm_src_mux(i);
+        if (UARTS_IsWide(g_mitm_hw[i].src) || m == NULL ||
+            (uint32_t)(m - DMAMUX1_Channel0) > MITM_MUX_EVT_MAX) {
+            UTRACE_Stop();
+            return HAL_ERROR;
+        }
+    }
+
+    __HAL_RCC_DMA2_CLK_ENABLE();
+    for (uint8_t i = 0; i < 2u; i++) {
+        (void)UARTS_SetFifo(g_mitm_hw[i].src, 0u);
+        HAL_NVIC_SetPriority(g_mitm_hw[i].irq, MITM_DMA_IRQ_PRIO, 0);
+        HAL_NVIC_EnableIRQ(g_mitm_hw[i].irq);
+    }
+
+    g_mitm_echo_gate = 0u;
+    g_mitm_active = 1u;
+    UARTS_SetTxDoneCb(UARTS_CH_UART4, mitm_u4_tx_done);
+    for (uint8_t i = 0; i < 2u; i++) mitm_dir_setup(i);
+    UTRACE_SetHook(mitm_trace_hook);
+    return HAL_OK;
+}
+
+void MITM_Stop(void)
+{
+    if (!g_mitm_active) return;
+
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    g_mitm_active = 0u;
+    for (uint8_t i = 0; i < 2u; i++) {
+        mitm_dir_stop(i);
+        CLEAR_BIT(mitm_src_mux(i)->CCR, DMAMUX_CxCR_EGE);
+    }
+    __set_PRIMASK(primask);
+
+    for (uint8_t i = 0; i < 2u; i++) {
+        HAL_NVIC_DisableIRQ(g_mitm_hw[i].irq);
+        mitm_flush(i);
+        (void)UARTS_SetFifo(g_mitm_hw[i].src, 1u);
+    }
+    UTRACE_Stop();
+    UARTS_SetTxDoneCb(UARTS_CH_UART4, NULL);
+    UARTS_ExtTxEnd(UARTS_CH_UART4);
+    g_mitm_echo_gate = 0u;
+}
+
+uint8_t MITM_IsActive(void)
+{
+    return g_mitm_active;
+}
+
+// Regeln im laufenden Betrieb: Richtungen neu aufsetzen (DMA <-> IRQ Pfad)
+static void mitm_rules_changed(void)
+{
+    if (!g_mitm_active) return;
+
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    for (uint8_t i = 0; i < 2u; i++) {
+        mitm_flush(i);
+        mitm_dir_setup(i);
+    }
+    __set_PRIMASK(primask);
+}
+
+int MITM_RuleAdd(uint8_t dirs, const uint8_t *pat, uint8_t plen,
+                 const uint8_t *rep, uint8_t rlen)
+{
+    dirs &= (MITM_DIR_48 | MITM_DIR_84);
+    if (dirs == 0u || pat == NULL || plen == 0u || plen > MITM_PAT_MAX || rlen > MITM_PAT_MAX ||
+        (rlen != 0u && rep == NULL)) {
+        return -1;
+    }
+
+    for (uint8_t r = 0; r < MITM_RULE_MAX; r++) {
+        mitm_rule_t *ru = &g_mitm_rule[r];
+        if (ru->used) continue;
+        memcpy(ru->pat, pat, plen);
+        if (rlen) memcpy(ru->rep, rep, rlen);
+        ru->plen = plen;
+        ru->rlen = rlen;
+        ru->dirs = dirs;
+        ru->hits = 0u;
+        ru->used = 1u;
+        mitm_rules_changed();
+        return (int)r;
+    }
+    return -1;
+}
+
+HAL_StatusTypeDef MITM_RuleDelete(uint8_t idx)
+{
+    if (idx >= MITM_RULE_MAX || !g_mitm_rule[idx].used) return HAL_ERROR;
+    g_mitm_rule[idx].used = 0u;
+    mitm_rules_changed();
+    return HAL_OK;
+}
+
+void MITM_RuleClear(void)
+{
+    memset(g_mitm_rule, 0, sizeof(g_mitm_rule));
+    mitm_rules_changed();
+}
+
+static const char *mitm_dir_str(uint8_t dirs)
+{
+    if (dirs == (MITM_DIR_48 | MITM_DIR_84)) return "both";
+    return (dirs == MITM_DIR_48) ? "4>8" : "8>4";
+}
+
+void MITM_PrintRules(void)
+{
+    uint8_t n = 0u;
+    cli_printf("\r\n");
+    for (uint8_t r = 0; r < MITM_RULE_MAX; r++) {
+        const mitm_rule_t *ru = &g_mitm_rule[r];
+        if (!ru->used) continue;
+        n++;
+        cli_printf("  #%u %-4s ", (unsigned)r, mitm_dir_str(ru->dirs));
+        for (uint8_t k = 0; k < ru->plen; k++) cli_printf("%02X", ru->pat[k]);
+        if (ru->rlen == 0u) {
+            cli_printf(" -> drop");
+        } else {
+            cli_printf(" -> ");
+            for (uint8_t k = 0; k < ru->rlen; k++) cli_printf("%02X", ru->rep[k]);
+        }
+        cli_printf("  hits=%lu\r\n", (unsigned long)ru->hits);
+    }
+    if (n == 0u) cli_printf("  (keine Regeln)\r\n");
+}
+
+void MITM_PrintStats(void)
+{
+    cli_printf("\r\nMITM: %s, UART4 %lu Bd, UART8 %lu Bd, DE Bursts=%lu\r\n",
+               g_mitm_active ? "aktiv" : "aus",
+               (unsigned long)UARTS_GetRealBaud(UARTS_CH_UART4),
+               (unsigned long)UARTS_GetRealBaud(UARTS_CH_UART8),
+               (unsigned long)g_mitm_de_bursts);
+    for (uint8_t i = 0; i < 2u; i++) {
+        const mitm_dir_t *d = &g_mitm[i];
+        const uarts_stats_t *s = UARTS_GetStats(g_mitm_hw[i].src);
+        cli_printf("  %s: %s rx=%lu", mitm_dir_str((uint8_t)(1u << i)),
+                   mitm_dir_has_rules(i) ? "irq" : "dma", (unsigned long)s->rx_bytes);
+        if (mitm_dir_has_rules(i)) {
+            cli_printf(" fwd=%lu subst=%lu drop=%lu txlost=%lu",
+                       (unsigned long)d->fwd, (unsigned long)d->subst,
+                       (unsigned long)d->dropped, (unsigned long)d->tx_lost);
+        }
+        cli_printf(" dmaerr=%lu\r\n", (unsigned long)d->dma_err);
+    }
+    if (UARTS_GetRealBaud(UARTS_CH_UART4) != UARTS_GetRealBaud(UARTS_CH_UART8)) {
+        cli_printf("  Hinweis: DMA Pfad braucht Ziel-Baudrate >= Quell-Baudrate\r\n");
+    }
+}
+
+void MITM_ResetStats(void)
+{
+    for (uint8_t i = 0; i < 2u; i++) {
+        g_mitm[i].fwd = 0u;
+        g_mitm[i].dropped = 0u;
+        g_mitm[i].subst = 0u;
+        g_mitm[i].tx_lost = 0u;
+        g_mitm[i].dma_err = 0u;
+    }
+    for (uint8_t r = 0; r < MITM_RULE_MAX; r++) g_mitm_rule[r].hits = 0u;
+    g_mitm_de_bursts = 0u;
+}
+
+void MITM_DmaIRQHandler(uint8_t dir)
+{
+    if (dir >= 2u) return;
+    const mitm_hw_t *hw = &g_mitm_hw[dir];
+    uint32_t isr = (DMA2->LISR >> hw->flag_shift) & MITM_DMA_FLAGS;
+    DMA2->LIFCR = isr << hw->flag_shift;
+
+    if (isr & MITM_DMA_TE) {
+        // Stream ist abgeschaltet -> neu aufsetzen
+        g_mitm[dir].dma_err++;
+        if (g_mitm_active) mitm_dir_setup(dir);
+        return;
+    }
+    if ((isr & MITM_DMA_TC) && g_mitm_active && g_mitm[dir].cpu) {
+        mitm_rx_byte(dir, g_mitm[dir].scratch);
+    }
+}
@@ -3,7 +3,17 @@
 #include "main.h"
 #include "stm32h7xx_hal.h"
 #include <string.h>
+#include <stdlib.h>
 #include "usbd_cdc_if.h"
+#include "uart_stream.h"
+#include "usb_stream.h"
+#include "modbus.h"
+#include "uart_trace.h"
+#include "uart_bridge.h"
+#include "lin.h"
+#include "uart_mitm.h"
+#include "uart_trig.h"
+#include "uart_bert.h"
 
 // ============================================================
 // UART MODE (RS485/UART via THVD1424R)
@@ -11,11 +21,64 @@
 // Setup (s):
 //   - RS485 120R Termination (GPIO)
 //   - RS485 SLR Control (GPIO)
-//   - Baudrate (9600 / 115200)
+//   - Baudrate (Presets)
+//
+// Line (baud / line / autobaud):
+//   - beliebige Baudrate bis fck/8, 7/8/9 Datenbits, N/E/O, 1/1.5/2 Stopp
+//   - nur BRR -> kein DeInit/Init, RX DMA laeuft weiter
+//   - SET_LINE_CODING des Hosts wird im Tunnel automatisch uebernommen
+//   - autobaud: USART ABR Hardware, Ergebnis kommt ueber UART_Mode_Poll
 //
 // Tunnel (w):
-//   - alle Zeichen werden zur UART weitergereicht
+//   - USB Pakete werden am Stueck in den TX Ring gelegt (uart_stream.c),
+//     DMA sendet lueckenlos, RS485 DE bleibt bis zum letzten Stoppbit
+//     aktiv (TC Interrupt bzw. Hardware-DE)
 //   - beendet mit ESC
+//   - RX: Circular DMA + IDLE/RTO (uart_stream.c), weiter an USB in
+//     Bloecken ueber usb_stream.c
+//
+// Diagnose (diag):
+//   - RX Zaehler (Bytes, verloren, ORE/FE/NE/PE, IDLE/RTO)
+//   - TX Zaehler (Bytes, DE-Zyklen, DMA Fehler)
+//
+// Modbus RTU (mb ...):
+//   - Master (Einzelauftraege + Poll-Liste) und Sniffer auf UART4,
+//     Frame-Ende ueber USART Receiver Timeout = t3.5 (modbus.c)
+//
+// Bridge (bridge ...):
+//   - UART4 und UART8 gleichzeitig ueber einen CDC Link, Frames
+//     <0xB0|kanal> <len> <daten> in beide Richtungen (uart_bridge.c)
+//   - Line Settings pro Kanal vorher (bridge line) oder ueber
+//     Steuer-Frames vom Host; ESC statt Kopfbyte beendet
+//
+// LIN (lin ...):
+//   - USART LIN Mode auf UART8 (oder UART4), Master mit Schedule
+//     Tabelle (TIM6 Slots), Slave Antworttabelle, Monitor mit Zeitstempel
+//     fuer Break/Sync/PID/Daten (lin.c)
+//
+// MITM (mitm ...):
+//   - UART4 <-> UART8 weiterleiten, DMA -> DMA ueber DMAMUX Request
+//     Generator (ohne Superloop), Mitschnitt ueber den Trace, optional
+//     Muster ersetzen/verwerfen (uart_mitm.c)
+//
+// Trigger (trig ...):
+//   - bis zu 16 Muster gleichzeitig (Aho-Corasick DFA) auf den RX
+//     Streams beider UARTs, laeuft neben Tunnel/Trace/Modbus/MITM mit;
+//     Aktion pro Muster: mark, notify, Trace Ausgabe start/stop, DO Pin
+//     (uart_trig.c)
+//
+// BERT (bert ...):
+//   - PRBS7/15/23 ueber UART4 TX DMA, Pruefung auf UART4 (Echo) oder
+//     UART8, Bit-/Bytefehler + FE/NE/PE/ORE, Sweep ueber Baudraten und
+//     RS485 SLR (uart_bert.c)
+//
+// Trace (trace ...):
+//   - UART4 + UART8 RX gleichzeitig, Bursts mit 1 us Zeitstempel
+//     (Startbit ueber EXTI, Ende ueber RTO = Gap), hex oder binaer an
+//     USB (uart_trace.c)
+//
+// DE Timing (de):
+//   - Hardware-DE Assertion/Deassertion Zeit (nur mit UARTS_UART4_HW_DE)
 // ============================================================
 
 typedef enum {
@@ -30,7 +93,13 @@ static uart_setup_state_t g_setup_state = UART_SETUP_NONE;
 static uint8_t g_uart_tunnel = 0;
 static uint8_t g_rs485_120r = 0;
 static uint8_t g_rs485_slr = 0;
-static uint32_t g_uart_baud = 115200u;
+static uarts_line_t g_uart_line = { 115200u, 8u, 'N', UARTS_STOP_1 };
+static uint8_t g_uart_abr = 0;         // Autobaud laeuft
+static uint32_t g_uart_abr_t0 = 0;
+static uint8_t g_raw_half = 0;         // 9 Bit Tunnel: halbes Zeichen
+static uint8_t g_raw_half_valid = 0;
+
+#define UART_ABR_TIMEOUT_MS (10000u)
 typedef enum {
     UART_HANDLE_AUTO = 0,
     UART_HANDLE_UART4,
@@ -38,8 +107,6 @@ typedef enum {
 } uart_handle_select_t;
 static uart_handle_select_t g_uart_handle_select = UART_HANDLE_AUTO;
 
-#define UART_TX_TIMEOUT_MS (100u)
-
 #ifdef HAL_UART_MODULE_ENABLED
 __attribute__((weak)) UART_HandleTypeDef huart4;
 __attribute__((weak)) UART_HandleTypeDef huart8;
@@ -66,6 +133,8 @@ static uint8_t uart_has_slr(void)
 static void uart_set_tx_en(uint8_t en)
 {
 #if defined(UART_TX_EN_GPIO_Port) && defined(UART_TX_EN_Pin)
+    // waehrend eines TX Bursts gehoert der Pin uart_stream.c
+    if (UARTS_TxBusy(UARTS_CH_UART4)) return;
     HAL_GPIO_WritePin(UART_TX_EN_GPIO_Port, UART_TX_EN_Pin, en ? GPIO_PIN_SET : GPIO_PIN_RESET);
 #else
     (void)en;
@@ -128,6 +197,960 @@ static UART_HandleTypeDef *uart_get_handle(void)
 }
 #endif
 
+static uarts_ch_t uart_get_channel(void)
+{
+#ifdef HAL_UART_MODULE_ENABLED
+    return (uart_get_handle() == &huart8) ? UARTS_CH_UART8 : UARTS_CH_UART4;
+#else
+    return UARTS_CH_UART4;
+#endif
+}
+
+static void uart_stream_start(void)
+{
+    uarts_ch_t ch = uart_get_channel();
+    if (UARTS_Start(ch) != HAL_OK) {
+        cli_printf("\r\nUART RX DMA start FEHLER\r\n");
+    }
+}
+
+static void uart_print_diag(void)
+{
+    for (uint8_t ch = 0; ch < UARTS_CH_COUNT; ch++) {
+        const uarts_stats_t *st = UARTS_GetStats((uarts_ch_t)ch);
+        if (!st) continue;
+        cli_printf("\r\n[%s] %s\r\n", (ch == UARTS_CH_UART8) ? "UART8" : "UART4",
+                   UARTS_IsRunning((uarts_ch_t)ch) ? "RX DMA aktiv" : "RX aus");
+        cli_printf("  rx=%lu lost=%lu idle=%lu rto=%lu\r\n",
+                   (unsigned long)st->rx_bytes, (unsigned long)st->rx_lost,
+                   (unsigned long)st->idle, (unsigned long)st->rto);
+        cli_printf("  ore=%lu fe=%lu ne=%lu pe=%lu\r\n",
+                   (unsigned long)st->ore, (unsigned long)st->fe,
+                   (unsigned long)st->ne, (unsigned long)st->pe);
+        cli_printf("  tx=%lu bursts=%lu dma_err=%lu%s\r\n",
+                   (unsigned long)st->tx_bytes, (unsigned long)st->tx_bursts,
+                   (unsigned long)st->tx_dma_err,
+                   UARTS_TxBusy((uarts_ch_t)ch) ? " (TX aktiv)" : "");
+    }
+}
+
+static void uart_print_de(void)
+{
+    uarts_ch_t ch = uart_get_channel();
+
+    if (!UARTS_HasHwDe(ch)) {
+        cli_printf("\r\nDE: GPIO (UART_TX_EN), Freigabe im TC Interrupt\r\n");
+        return;
+    }
+
+    uint8_t at = 0u, dt = 0u;
+    UARTS_GetDeTiming(ch, &at, &dt);
+    cli_printf("\r\nDE: Hardware, assert=%u deassert=%u (1/16 Bit)\r\n",
+               (unsigned)at, (unsigned)dt);
+}
+
+static void uart_set_de(const char *args)
+{
+    char *end = NULL;
+    unsigned long at = strtoul(args, &end, 0);
+    if (end == args) {
+        cli_printf("\r\nSyntax: de <assert> <deassert>  (0..31)\r\n");
+        return;
+    }
+    const char *p = end;
+    unsigned long dt = strtoul(p, &end, 0);
+    if (end == p) dt = at;
+
+    if (UARTS_SetDeTiming(uart_get_channel(), (uint8_t)((at > 255u) ? 255u : at),
+                          (uint8_t)((dt > 255u) ? 255u : dt)) != HAL_OK) {
+        cli_printf("\r\nDE Timing FEHLER (kein Hardware-DE oder > 31)\r\n");
+        return;
+    }
+    uart_print_de();
+}
+
+static const char *uart_stop_str(uint8_t stop)
+{
+    if (stop == UARTS_STOP_1_5) return "1.5";
+    if (stop == UARTS_STOP_2) return "2";
+    return "1";
+}
+
+static void uart_print_line(const char *prefix)
+{
+    uarts_ch_t ch = uart_get_channel();
+    cli_printf("\r\n%s%lu %u%c%s (real %lu Baud, fck %lu Hz)\r\n", prefix,
+               (unsigned long)g_uart_line.baud, (unsigned)g_uart_line.data_bits,
+               g_uart_line.parity, uart_stop_str(g_uart_line.stop),
+               (unsigned long)UARTS_GetRealBaud(ch), (unsigned long)UARTS_KernelClock(ch));
+}
+
+// aktuelle Einstellung fuer GET_LINE_CODING
+static void uart_report_cdc(void)
+{
+    USBD_CDC_LineCodingTypeDef lc;
+    lc.bitrate = g_uart_line.baud;
+    lc.format = g_uart_line.stop;
+    lc.paritytype = (g_uart_line.parity == 'O') ? 1u : (g_uart_line.parity == 'E') ? 2u : 0u;
+    lc.datatype = g_uart_line.data_bits;
+    CDC_ReportLineCoding_HS(&lc);
+}
+
+// "8N1", "7E2", "8O1.5"
+static uint8_t uart_parse_format(const char *p, uarts_line_t *line)
+{
+    if (p[0] < '7' || p[0] > '9') return 0u;
+    line->data_bits = (uint8_t)(p[0] - '0');
+
+    char par = p[1];
+    if (par >= 'a' && par <= 'z') par = (char)(par - 'a' + 'A');
+    if (par != 'N' && par != 'E' && par != 'O') return 0u;
+    line->parity = par;
+
+    if (strcmp(&p[2], "1") == 0) line->stop = UARTS_STOP_1;
+    else if (strcmp(&p[2], "1.5") == 0) line->stop = UARTS_STOP_1_5;
+    else if (strcmp(&p[2], "2") == 0) line->stop = UARTS_STOP_2;
+    else return 0u;
+    return 1u;
+}
+
+static uint8_t uart_parse_u32(const char *s, uint32_t *out)
+{
+    char *end = NULL;
+    if (!s || !*s) return 0u;
+    uint32_t v = strtoul(s, &end, 0);
+    if (end == s || *end != '\0') return 0u;
+    *out = v;
+    return 1u;
+}
+
+// alle Protokoll-Engines auf UART4/UART8 anhalten (gegenseitig exklusiv)
+static void uart_stop_engines(void)
+{
+    MB_Stop();
+    MITM_Stop();
+    UTRACE_Stop();
+    UBRG_Stop();
+    LIN_Stop();
+    BERT_Stop();
+}
+
+static void uart_mb_usage(void)
+{
+    cli_printf("\r\nUsage: mb start|stop|stat|reset\r\n");
+    cli_printf("       mb rc|rdi|rd|ri <SLAVE> <ADDR> <N>   (FC 1/2/3/4)\r\n");
+    cli_printf("       mb wc <SLAVE> <ADDR> <0|1>           (FC 5)\r\n");
+    cli_printf("       mb wr <SLAVE> <ADDR> <VAL>           (FC 6)\r\n");
+    cli_printf("       mb wm <SLAVE> <ADDR> <VAL> [VAL..]   (FC 16)\r\n");
+    cli_printf("       mb poll add <SLAVE> <FC> <ADDR> <N> | del <IDX> | clear | run [ms] | stop\r\n");
+    cli_printf("       mb sniff on|off, mb watch on|off, mb timeout <ms>\r\n");
+}
+
+static void uart_mb_command(char *args)
+{
+    char *save = NULL;
+    char *sub = strtok_r(args, " \t", &save);
+    char *tok[MB_REGS_MAX + 3u];
+    uint16_t ntok = 0u;
+
+    if (!sub) {
+        MB_PrintStats();
+        return;
+    }
+
+    char *t;
+    while ((t = strtok_r(NULL, " \t", &save)) != NULL && ntok < (uint16_t)(sizeof(tok) / sizeof(tok[0]))) {
+        tok[ntok++] = t;
+    }
+
+    if (strcmp(sub, "start") == 0) {
+        if (g_uart_tunnel) {
+            cli_printf("\r\nTunnel aktiv, erst beenden\r\n");
+            return;
+        }
+        uart_stop_engines();
+        if (MB_Start() != HAL_OK) {
+            cli_printf("\r\nModbus start FEHLER (UART4 RX / 9 Datenbits?)\r\n");
+            return;
+        }
+        MB_PrintStats();
+        return;
+    }
+    if (strcmp(sub, "stop") == 0) {
+        MB_Stop();
+        cli_printf("\r\nModbus aus\r\n");
+        return;
+    }
+    if (strcmp(sub, "stat") == 0) {
+        MB_PrintStats();
+        MB_PrintPoll();
+        return;
+    }
+    if (strcmp(sub, "reset") == 0) {
+        MB_ResetStats();
+        cli_printf("\r\nModbus Zaehler zurueckgesetzt\r\n");
+        return;
+    }
+    if ((strcmp(sub, "sniff") == 0 || strcmp(sub, "watch") == 0) && ntok == 1u) {
+        uint8_t on = (strcmp(tok[0], "on") == 0) ? 1u : 0u;
+        if (sub[0] == 's') MB_SetSniff(on); else MB_SetWatch(on);
+        cli_printf("\r\nModbus %s %s\r\n", sub, on ? "on" : "off");
+        return;
+    }
+    if (strcmp(sub, "timeout") == 0 && ntok == 1u) {
+        uint32_t ms = 0u;
+        if (!uart_parse_u32(tok[0], &ms) || ms > 60000u) { uart_mb_usage(); return; }
+        MB_SetTimeout((uint16_t)ms);
+        cli_printf("\r\nModbus Timeout %lu ms\r\n", (unsigned long)ms);
+        return;
+    }
+
+    if (strcmp(sub, "poll") == 0) {
+        if (ntok == 0u || strcmp(tok[0], "list") == 0) { MB_PrintPoll(); return; }
+        if (strcmp(tok[0], "clear") == 0) { MB_PollClear(); cli_printf("\r\nPoll-Liste geleert\r\n"); return; }
+        if (strcmp(tok[0], "stop") == 0) { MB_PollRun(0u, 0u); cli_printf("\r\nPoll gestoppt\r\n"); return; }
+        if (strcmp(tok[0], "run") == 0) {
+            uint32_t ms = 0u;
+            if (ntok > 1u && !uart_parse_u32(tok[1], &ms)) { uart_mb_usage(); return; }
+            if (!MB_IsActive()) { cli_printf("\r\nModbus nicht aktiv ('mb start')\r\n"); return; }
+            MB_PollRun(1u, ms);
+            cli_printf("\r\nPoll laeuft (Zyklus %lu ms)\r\n", (unsigned long)ms);
+            return;
+        }
+        if (strcmp(tok[0], "del") == 0 && ntok == 2u) {
+            uint32_t idx = 0u;
+            if (!uart_parse_u32(tok[1], &idx) || idx > 255u || MB_PollDelete((uint8_t)idx) != HAL_OK) {
+                cli_printf("\r\nmb poll del: ungueltiger Index\r\n");
+                return;
+            }
+            cli_printf("\r\nPoll-Eintrag %lu geloescht\r\n", (unsigned long)idx);
+            return;
+        }
+        if (strcmp(tok[0], "add") == 0 && ntok == 5u) {
+            uint32_t sl, fc, ad, n;
+            if (!uart_parse_u32(tok[1], &sl) || !uart_parse_u32(tok[2], &fc) ||
+                !uart_parse_u32(tok[3], &ad) || !uart_parse_u32(tok[4], &n) ||
+                sl > 255u || fc > 255u || ad > 0xFFFFu || n > 0xFFFFu) {
+                uart_mb_usage();
+                return;
+            }
+            int idx = MB_PollAdd((uint8_t)sl, (uint8_t)fc, (uint16_t)ad, (uint16_t)n);
+            if (idx == -1) cli_printf("\r\nPoll-Liste voll (%u)\r\n", (unsigned)MB_POLL_MAX);
+            else if (idx < 0) cli_printf("\r\nmb poll add: nur FC 1-4, Slave 1-247, N im Limit\r\n");
+            else cli_printf("\r\nPoll-Eintrag %d angelegt\r\n", idx);
+            return;
+        }
+        uart_mb_usage();
+        return;
+    }
+
+    // Einzelauftraege
+    uint8_t fc = 0u;
+    if (strcmp(sub, "rc") == 0) fc = 1u;
+    else if (strcmp(sub, "rdi") == 0) fc = 2u;
+    else if (strcmp(sub, "rd") == 0) fc = 3u;
+    else if (strcmp(sub, "ri") == 0) fc = 4u;
+    else if (strcmp(sub, "wc") == 0) fc = 5u;
+    else if (strcmp(sub, "wr") == 0) fc = 6u;
+    else if (strcmp(sub, "wm") == 0) fc = 16u;
+
+    uint32_t sl = 0u, ad = 0u;
+    if (fc == 0u || ntok < 3u || !uart_parse_u32(tok[0], &sl) || !uart_parse_u32(tok[1], &ad) ||
+        sl > 255u || ad > 0xFFFFu) {
+        uart_mb_usage();
+        return;
+    }
+
+    uint16_t vals[MB_REGS_MAX];
+    uint16_t count = 0u;
+    for (uint16_t i = 2u; i < ntok && count < MB_REGS_MAX; i++) {
+        uint32_t v = 0u;
+        if (!uart_parse_u32(tok[i], &v) || v > 0xFFFFu) { uart_mb_usage(); return; }
+        vals[count++] = (uint16_t)v;
+    }
+    if (fc != 16u && count != 1u) { uart_mb_usage(); return; }
+
+    // FC 1-4: Wert = Anzahl, FC 5/6: Wert, FC 16: Werteliste
+    uint16_t n = (fc <= 4u) ? vals[0] : (fc == 16u) ? count : 1u;
+
+    HAL_StatusTypeDef st = MB_Request((uint8_t)sl, fc, (uint16_t)ad, n, vals);
+    if (st == HAL_BUSY) {
+        cli_printf("\r\nModbus %s\r\n", MB_IsActive() ? "belegt (Auftrag laeuft)" : "nicht aktiv ('mb start')");
+    } else if (st != HAL_OK) {
+        cli_printf("\r\nmb: ungueltiger Auftrag (Slave/Anzahl)\r\n");
+    }
+}
+
+static void uart_sync_from_handle(void);
+
+// <4|8> <BAUD> [8N1] fuer einen Kanal (bridge line / mitm line)
+static uint8_t uart_chan_line(char **save)
+{
+    char *chs = strtok_r(NULL, " \t", save);
+    char *bauds = strtok_r(NULL, " \t", save);
+    char *fmt = strtok_r(NULL, " \t", save);
+    uarts_ch_t ch;
+    uarts_line_t line;
+    uint32_t baud = 0u;
+
+    if (!chs || !bauds || !uart_parse_u32(bauds, &baud)) return 0u;
+    if (strcmp(chs, "4") == 0) ch = UARTS_CH_UART4;
+    else if (strcmp(chs, "8") == 0) ch = UARTS_CH_UART8;
+    else return 0u;
+
+    UARTS_GetLine(ch, &line);
+    line.baud = baud;
+    if (fmt && !uart_parse_format(fmt, &line)) return 0u;
+    if (UARTS_SetLine(ch, &line) != HAL_OK) {
+        cli_printf("\r\nUART%s Line FEHLER (Baudrate/Format nicht moeglich)\r\n", chs);
+        return 1u;
+    }
+    uart_sync_from_handle();
+    UTRACE_UpdateTiming();
+    return 1u;
+}
+
+static void uart_bridge_usage(void)
+{
+    cli_printf("\r\nUsage: bridge start|stat|reset\r\n");
+    cli_printf("       bridge line <4|8> <BAUD> [8N1]\r\n");
+    cli_printf("  Frame: <B0|kanal> <len> <daten>, kanal 0 = UART4, 1 = UART8, F = Steuerung\r\n");
+    cli_printf("  ESC statt Kopfbyte oder Steuer-Frame 00 beendet die Bridge\r\n");
+}
+
+static void uart_bridge_command(char *args)
+{
+    char *save = NULL;
+    char *sub = strtok_r(args, " \t", &save);
+
+    if (!sub || strcmp(sub, "stat") == 0) {
+        UBRG_PrintStats();
+        return;
+    }
+
+    if (strcmp(sub, "start") == 0) {
+        uart_stop_engines();
+        g_uart_tunnel = 0;
+        g_raw_half_valid = 0u;
+        uart_set_tx_en(0u);
+        if (UBRG_Start() != HAL_OK) {
+            cli_printf("\r\nBridge start FEHLER (UART RX DMA)\r\n");
+            return;
+        }
+        UBRG_PrintStats();
+        cli_printf("UART bridge aktiv (ESC beendet)\r\n");
+        USBS_Flush(100u);
+        return;
+    }
+    if (strcmp(sub, "reset") == 0) {
+        UBRG_ResetStats();
+        for (uint8_t i = 0; i < UARTS_CH_COUNT; i++) UARTS_ResetStats((uarts_ch_t)i);
+        cli_printf("\r\nBridge Zaehler zurueckgesetzt\r\n");
+        return;
+    }
+    if (strcmp(sub, "line") == 0) {
+        if (!uart_chan_line(&save)) uart_bridge_usage();
+        else UBRG_PrintStats();
+        return;
+    }
+
+    uart_bridge_usage();
+}
+
+static void uart_mitm_usage(void)
+{
+    cli_printf("\r\nUsage: mitm start|stop|stat|reset\r\n");
+    cli_printf("       mitm line <4|8> <BAUD> [8N1]\r\n");
+    cli_printf("       mitm rule add <48|84|both> <HEX> [HEX|drop]   (max %u Byte)\r\n",
+               (unsigned)MITM_PAT_MAX);
+    cli_printf("       mitm rule del <IDX> | clear | list\r\n");
+    cli_printf("  Log: wie trace (trace fmt/gap), U4 = von UART4, U8 = von UART8\r\n");
+}
+
+// "0102AB" -> Bytes
+static uint8_t uart_parse_hex(const char *s, uint8_t *out, uint8_t max, uint8_t *n)
+{
+    *n = 0u;
+    if ((strlen(s) & 1u) != 0u || *s == '\0') return 0u;
+    while (*s) {
+        char hex[3] = { s[0], s[1], '\0' };
+        char *end = NULL;
+        unsigned long v = strtoul(hex, &end, 16);
+        if (*n >= max || end != &hex[2]) return 0u;
+        out[(*n)++] = (uint8_t)v;
+        s += 2;
+    }
+    return 1u;
+}
+
+static void uart_mitm_rule(char **save)
+{
+    char *op = strtok_r(NULL, " \t", save);
+
+    if (!op || strcmp(op, "list") == 0) {
+        MITM_PrintRules();
+        return;
+    }
+    if (strcmp(op, "clear") == 0) {
+        MITM_RuleClear();
+        cli_printf("\r\nMITM Regeln geloescht\r\n");
+        return;
+    }
+    if (strcmp(op, "del") == 0) {
+        char *a = strtok_r(NULL, " \t", save);
+        uint32_t idx = 0u;
+        if (!a || !uart_parse_u32(a, &idx) || MITM_RuleDelete((uint8_t)idx) != HAL_OK) {
+            cli_printf("\r\nRegel nicht gefunden\r\n");
+            return;
+        }
+        MITM_PrintRules();
+        return;
+    }
+    if (strcmp(op, "add") == 0) {
+        char *ds = strtok_r(NULL, " \t", save);
+        char *ps = strtok_r(NULL, " \t", save);
+        char *rs = strtok_r(NULL, " \t", save);
+        uint8_t pat[MITM_PAT_MAX], rep[MITM_PAT_MAX];
+        uint8_t plen = 0u, rlen = 0u, dirs;
+
+        if (!ds || !ps) { uart_mitm_usage(); return; }
+        if (strcmp(ds, "48") == 0) dirs = MITM_DIR_48;
+        else if (strcmp(ds, "84") == 0) dirs = MITM_DIR_84;
+        else if (strcmp(ds, "both") == 0) dirs = MITM_DIR_48 | MITM_DIR_84;
+        else { uart_mitm_usage(); return; }
+
+        if (!uart_parse_hex(ps, pat, MITM_PAT_MAX, &plen) ||
+            (rs && strcmp(rs, "drop") != 0 && !uart_parse_hex(rs, rep, MITM_PAT_MAX, &rlen))) {
+            uart_mitm_usage();
+            return;
+        }
+        if (MITM_RuleAdd(dirs, pat, plen, rep, rlen) < 0) {
+            cli_printf("\r\nRegel-Tabelle voll (%u)\r\n", (unsigned)MITM_RULE_MAX);
+            return;
+        }
+        MITM_PrintRules();
+        return;
+    }
+    uart_mitm_usage();
+}
+
+static void uart_mitm_command(char *args)
+{
+    char *save = NULL;
+    char *sub = strtok_r(args, " \t", &save);
+
+    if (!sub || strcmp(sub, "stat") == 0) {
+        MITM_PrintStats();
+        UTRACE_PrintStats();
+        return;
+    }
+
+    if (strcmp(sub, "start") == 0) {
+        uart_stop_engines();
+        g_uart_tunnel = 0;
+        g_raw_half_valid = 0u;
+        uart_set_tx_en(0u);
+        if (MITM_Start() != HAL_OK) {
+            cli_printf("\r\nMITM start FEHLER (UART RX DMA / 9 Bit)\r\n");
+            return;
+        }
+        MITM_PrintStats();
+        return;
+    }
+    if (strcmp(sub, "stop") == 0) {
+        MITM_Stop();
+        USBS_Flush(100u);
+        cli_printf("\r\nMITM aus\r\n");
+        return;
+    }
+    if (strcmp(sub, "reset") == 0) {
+        MITM_ResetStats();
+        UTRACE_ResetStats();
+        for (uint8_t i = 0; i < UARTS_CH_COUNT; i++) UARTS_ResetStats((uarts_ch_t)i);
+        cli_printf("\r\nMITM Zaehler zurueckgesetzt\r\n");
+        return;
+    }
+    if (strcmp(sub, "line") == 0) {
+        if (!uart_chan_line(&save)) uart_mitm_usage();
+        else MITM_PrintStats();
+        return;
+    }
+    if (strcmp(sub, "rule") == 0) {
+        uart_mitm_rule(&save);
+        return;
+    }
+
+    uart_mitm_usage();
+}
+
+static void uart_trig_usage(void)
+{
+    cli_printf("\r\nUsage: trig add <4|8|both> <AKTION> <MUSTER..>   (max %u Muster, %u Byte)\r\n",
+               (unsigned)UTRIG_PAT_MAX, (unsigned)UTRIG_PAT_LEN_MAX);
+    cli_printf("       trig del <IDX> | clear | list | log | stat | reset\r\n");
+    cli_printf("       trig on|off           (scharf schalten)\r\n");
+    cli_printf("       trig cap on|off       (Trace Ausgabe von Hand)\r\n");
+    cli_printf("  AKTION: mark | notify | start | stop | do<0-7>=<0|1|t>\r\n");
+    cli_printf("  MUSTER: Rest der Zeile, Escapes \\r \\n \\t \\\\ \\xHH\r\n");
+}
+
+// Rest der Zeile mit Escapes -> Bytes
+static uint8_t uart_parse_pattern(const char *s, uint8_t *out, uint8_t max, uint8_t *n)
+{
+    *n = 0u;
+    while (*s) {
+        uint8_t b = (uint8_t)*s++;
+        if (b == '\\') {
+            char e = *s++;
+            if (e == 'r') b = '\r';
+            else if (e == 'n') b = '\n';
+            else if (e == 't') b = '\t';
+            else if (e == '\\') b = '\\';
+            else if (e == 'x' && s[0] && s[1]) {
+                char hex[3] = { s[0], s[1], '\0' };
+                char *end = NULL;
+                b = (uint8_t)strtoul(hex, &end, 16);
+                if (end != &hex[2]) return 0u;
+                s += 2;
+            } else {
+                return 0u;
+            }
+        }
+        if (*n >= max) return 0u;
+        out[(*n)++] = b;
+    }
+    return (*n != 0u) ? 1u : 0u;
+}
+
+static void uart_trig_add(char **save)
+{
+    char *chs = strtok_r(NULL, " \t", save);
+    char *acts = strtok_r(NULL, " \t", save);
+    char *pats = *save;
+    uint8_t pat[UTRIG_PAT_LEN_MAX];
+    uint8_t len = 0u, chans, do_bit = 0u, do_val = 0u;
+    utrig_act_t act;
+
+    if (!chs || !acts || !pats) { uart_trig_usage(); return; }
+    while (*pats == ' ' || *pats == '\t') pats++;
+
+    if (strcmp(chs, "4") == 0) chans = UTRIG_CH_UART4;
+    else if (strcmp(chs, "8") == 0) chans = UTRIG_CH_UART8;
+    else if (strcmp(chs, "both") == 0) chans = UTRIG_CH_UART4 | UTRIG_CH_UART8;
+    else { uart_trig_usage(); return; }
+
+    if (strcmp(acts, "mark") == 0) act = UTRIG_ACT_MARK;
+    else if (strcmp(acts, "notify") == 0) act = UTRIG_ACT_NOTIFY;
+    else if (strcmp(acts, "start") == 0) act = UTRIG_ACT_CAP_START;
+    else if (strcmp(acts, "stop") == 0) act = UTRIG_ACT_CAP_STOP;
+    else if (strncmp(acts, "do", 2) == 0 && acts[2] >= '0' && acts[2] <= '7' && acts[3] == '=' &&
+             (acts[4] == '0' || acts[4] == '1' || acts[4] == 't') && acts[5] == '\0') {
+        act = UTRIG_ACT_DO;
+        do_bit = (uint8_t)(acts[2] - '0');
+        do_val = (acts[4] == 't') ? 2u : (uint8_t)(acts[4] - '0');
+    } else { uart_trig_usage(); return; }
+
+    if (!uart_parse_pattern(pats, pat, UTRIG_PAT_LEN_MAX, &len)) { uart_trig_usage(); return; }
+    if (UTRIG_Add(chans, pat, len, act, do_bit, do_val) < 0) {
+        cli_printf("\r\nMuster nicht moeglich (Tabelle/Automat voll)\r\n");
+        return;
+    }
+    UTRIG_PrintList();
+}
+
+static void uart_trig_command(char *args)
+{
+    char *save = NULL;
+    char *sub = strtok_r(args, " \t", &save);
+
+    if (!sub || strcmp(sub, "stat") == 0) {
+        UTRIG_PrintStats();
+        return;
+    }
+    if (strcmp(sub, "add") == 0) {
+        uart_trig_add(&save);
+        return;
+    }
+    if (strcmp(sub, "list") == 0) {
+        UTRIG_PrintList();
+        return;
+    }
+    if (strcmp(sub, "log") == 0) {
+        UTRIG_PrintLog();
+        return;
+    }
+    if (strcmp(sub, "clear") == 0) {
+        UTRIG_Clear();
+        cli_printf("\r\nTrigger Muster geloescht\r\n");
+        return;
+    }
+    if (strcmp(sub, "reset") == 0) {
+        UTRIG_ResetStats();
+        cli_printf("\r\nTrigger Zaehler zurueckgesetzt\r\n");
+        return;
+    }
+
+    char *arg = strtok_r(NULL, " \t", &save);
+    if (strcmp(sub, "del") == 0 && arg) {
+        uint32_t idx = 0u;
+        if (!uart_parse_u32(arg, &idx) || UTRIG_Delete((uint8_t)idx) != HAL_OK) {
+            cli_printf("\r\nMuster nicht gefunden\r\n");
+            return;
+        }
+        UTRIG_PrintList();
+        return;
+    }
+    if (strcmp(sub, "on") == 0 || strcmp(sub, "off") == 0) {
+        if (UTRIG_Arm(sub[1] == 'n') != HAL_OK) {
+            cli_printf("\r\nTrigger FEHLER (UART RX DMA)\r\n");
+            return;
+        }
+        UTRIG_PrintStats();
+        return;
+    }
+    if (strcmp(sub, "cap") == 0 && arg && (strcmp(arg, "on") == 0 || strcmp(arg, "off") == 0)) {
+        UTRACE_SetCapture(arg[1] == 'n');
+        cli_printf("\r\nTrace capture %s\r\n", arg);
+        return;
+    }
+
+    uart_trig_usage();
+}
+
+static void uart_bert_usage(void)
+{
+    cli_printf("\r\nUsage: bert start [7|15|23] [4|8]     (Dauerlauf, RX UART4 oder UART8)\r\n");
+    cli_printf("       bert sweep <7|15|23> <4|8> <0|1|both> <MS> <BAUD..>   (SLR, Dauer/Schritt)\r\n");
+    cli_printf("       bert stop | stat | reset\r\n");
+    cli_printf("  TX immer UART4 (RS485), 8 Datenbits\r\n");
+}
+
+static uint8_t uart_bert_prbs(const char *s, bert_prbs_t *prbs)
+{
+    if (strcmp(s, "7") == 0) *prbs = BERT_PRBS7;
+    else if (strcmp(s, "15") == 0) *prbs = BERT_PRBS15;
+    else if (strcmp(s, "23") == 0) *prbs = BERT_PRBS23;
+    else return 0u;
+    return 1u;
+}
+
+static void uart_bert_command(char *args)
+{
+    char *save = NULL;
+    char *tok[BERT_SWEEP_MAX + 5u];
+    uint16_t ntok = 0u;
+    char *t;
+
+    while ((t = strtok_r(ntok ? NULL : args, " \t", &save)) != NULL &&
+           ntok < (uint16_t)(sizeof(tok) / sizeof(tok[0]))) {
+        tok[ntok++] = t;
+    }
+
+    if (ntok == 0u || strcmp(tok[0], "stat") == 0) {
+        BERT_PrintStats();
+        return;
+    }
+    if (strcmp(tok[0], "stop") == 0) {
+        BERT_Stop();
+        uart_sync_from_handle();
+        BERT_PrintStats();
+        return;
+    }
+    if (strcmp(tok[0], "reset") == 0) {
+        BERT_ResetStats();
+        cli_printf("\r\nBERT Zaehler zurueckgesetzt\r\n");
+        return;
+    }
+
+    if (strcmp(tok[0], "start") == 0 || strcmp(tok[0], "sweep") == 0) {
+        bert_prbs_t prbs = BERT_PRBS15;
+        uarts_ch_t rx = UARTS_CH_UART4;
+        uint8_t sweep = (tok[0][1] == 'w') ? 1u : 0u;
+
+        if (ntok > 1u && !uart_bert_prbs(tok[1], &prbs)) { uart_bert_usage(); return; }
+        if (ntok > 2u) {
+            if (strcmp(tok[2], "8") == 0) rx = UARTS_CH_UART8;
+            else if (strcmp(tok[2], "4") != 0) { uart_bert_usage(); return; }
+        }
+
+        uint32_t bauds[BERT_SWEEP_MAX];
+        uint8_t nb = 0u, slr = 0u;
+        uint32_t ms = 0u;
+        if (sweep) {
+            if (ntok < 6u) { uart_bert_usage(); return; }
+            if (strcmp(tok[3], "0") == 0) slr = 1u;
+            else if (strcmp(tok[3], "1") == 0) slr = 2u;
+            else if (strcmp(tok[3], "both") == 0) slr = 3u;
+            else { uart_bert_usage(); return; }
+            if (!uart_parse_u32(tok[4], &ms) || ms == 0u) { uart_bert_usage(); return; }
+            for (uint16_t i = 5u; i < ntok; i++) {
+                if (nb >= BERT_SWEEP_MAX || !uart_parse_u32(tok[i], &bauds[nb])) { uart_bert_usage(); return; }
+                nb++;
+            }
+        }
+
+        uart_stop_engines();
+        g_uart_tunnel = 0;
+        g_raw_half_valid = 0u;
+        uart_set_tx_en(0u);
+        HAL_StatusTypeDef st = sweep ? BERT_Sweep(prbs, rx, bauds, nb, slr, ms) : BERT_Start(prbs, rx);
+        if (st != HAL_OK) {
+            uart_sync_from_handle();
+            cli_printf("\r\nBERT start FEHLER (8 Datenbits / UART DMA / Baudrate)\r\n");
+            return;
+        }
+        if (!sweep) BERT_PrintStats();
+        return;
+    }
+
+    uart_bert_usage();
+}
+
+static void uart_lin_usage(void)
+{
+    cli_printf("\r\nUsage: lin start [4|8] [BAUD] | stop | stat | reset | mon on|off\r\n");
+    cli_printf("       lin sched add <ID> pub|sub <LEN> <SLOT_US> [enh|cls] [DATA..]\r\n");
+    cli_printf("       lin sched del <IDX> | clear | list\r\n");
+    cli_printf("       lin run | halt                    (Schedule, TIM6)\r\n");
+    cli_printf("       lin slave <ID> [enh|cls] <DATA..> | slave del <ID> | clear | list\r\n");
+    cli_printf("  Monitor: LIN <t_brk> pid id sync=+us pid=+us resp=+us end=+us n: DATA cs ENH|CLS|CS|LEN|NORESP\r\n");
+}
+
+// [enh|cls] + Datenbytes ab tok[i]
+static uint8_t uart_lin_data(char **tok, uint16_t ntok, uint16_t i, lin_cs_t *cs,
+                             uint8_t *data, uint8_t *len)
+{
+    *cs = LIN_CS_ENH;
+    if (i < ntok && strcmp(tok[i], "enh") == 0) { i++; }
+    else if (i < ntok && strcmp(tok[i], "cls") == 0) { *cs = LIN_CS_CLS; i++; }
+
+    *len = 0u;
+    for (; i < ntok; i++) {
+        uint32_t v = 0u;
+        if (*len >= LIN_DATA_MAX || !uart_parse_u32(tok[i], &v) || v > 0xFFu) return 0u;
+        data[(*len)++] = (uint8_t)v;
+    }
+    return 1u;
+}
+
+static void uart_lin_command(char *args)
+{
+    char *save = NULL;
+    char *tok[16];
+    uint16_t ntok = 0u;
+    char *t;
+
+    while ((t = strtok_r(ntok ? NULL : args, " \t", &save)) != NULL && ntok < 16u) {
+        tok[ntok++] = t;
+    }
+
+    if (ntok == 0u || strcmp(tok[0], "stat") == 0) {
+        LIN_PrintStats();
+        return;
+    }
+
+    if (strcmp(tok[0], "start") == 0) {
+        uarts_ch_t ch = UARTS_CH_UART8;
+        uint32_t baud = LIN_BAUD_DEF;
+        if (ntok > 1u) {
+            if (strcmp(tok[1], "4") == 0) ch = UARTS_CH_UART4;
+            else if (strcmp(tok[1], "8") != 0) { uart_lin_usage(); return; }
+        }
+        if (ntok > 2u && !uart_parse_u32(tok[2], &baud)) { uart_lin_usage(); return; }
+
+        uart_stop_engines();
+        g_uart_tunnel = 0;
+        g_raw_half_valid = 0u;
+        if (LIN_Start(ch, baud) != HAL_OK) {
+            cli_printf("\r\nLIN start FEHLER (Baudrate / UART)\r\n");
+            return;
+        }
+        uart_sync_from_handle();
+        LIN_PrintStats();
+        return;
+    }
+    if (strcmp(tok[0], "stop") == 0) {
+        LIN_Stop();
+        cli_printf("\r\nLIN aus\r\n");
+        return;
+    }
+    if (strcmp(tok[0], "reset") == 0) {
+        LIN_ResetStats();
+        cli_printf("\r\nLIN Zaehler zurueckgesetzt\r\n");
+        return;
+    }
+    if (strcmp(tok[0], "mon") == 0 && ntok == 2u) {
+        LIN_SetMonitor(strcmp(tok[1], "on") == 0 ? 1u : 0u);
+        cli_printf("\r\nLIN monitor %s\r\n", strcmp(tok[1], "on") == 0 ? "on" : "off");
+        return;
+    }
+    if (strcmp(tok[0], "run") == 0 || strcmp(tok[0], "halt") == 0) {
+        uint8_t on = (tok[0][0] == 'r') ? 1u : 0u;
+        if (LIN_SchedRun(on) != HAL_OK) {
+            cli_printf("\r\nLIN Schedule: %s\r\n", LIN_IsActive() ? "Tabelle leer" : "nicht aktiv ('lin start')");
+            return;
+        }
+        cli_printf("\r\nLIN Schedule %s\r\n", on ? "laeuft" : "angehalten");
+        return;
+    }
+
+    if (strcmp(tok[0], "sched") == 0) {
+        if (ntok == 1u || strcmp(tok[1], "list") == 0) { LIN_PrintSched(); return; }
+        if (strcmp(tok[1], "clear") == 0) { LIN_SchedClear(); cli_printf("\r\nLIN Schedule geleert\r\n"); return; }
+        if (strcmp(tok[1], "del") == 0 && ntok == 3u) {
+            uint32_t idx = 0u;
+            if (!uart_parse_u32(tok[2], &idx) || idx > 255u || LIN_SchedDelete((uint8_t)idx) != HAL_OK) {
+                cli_printf("\r\nlin sched del: ungueltiger Index\r\n");
+                return;
+            }
+            cli_printf("\r\nLIN Schedule Eintrag %lu geloescht\r\n", (unsigned long)idx);
+            return;
+        }
+        if (strcmp(tok[1], "add") == 0 && ntok >= 6u) {
+            uint32_t id, len, slot;
+            lin_dir_t dir;
+            lin_cs_t cs;
+            uint8_t data[LIN_DATA_MAX];
+            uint8_t dlen = 0u;
+
+            if (strcmp(tok[3], "pub") == 0) dir = LIN_DIR_PUB;
+            else if (strcmp(tok[3], "sub") == 0) dir = LIN_DIR_SUB;
+            else { uart_lin_usage(); return; }
+            if (!uart_parse_u32(tok[2], &id) || !uart_parse_u32(tok[4], &len) ||
+                !uart_parse_u32(tok[5], &slot) || id > 0x3Fu || len > LIN_DATA_MAX ||
+                !uart_lin_data(tok, ntok, 6u, &cs, data, &dlen)) {
+                uart_lin_usage();
+                return;
+            }
+            if (dir == LIN_DIR_PUB && dlen != len) {
+                cli_printf("\r\nlin sched add: pub braucht %lu Datenbytes\r\n", (unsigned long)len);
+                return;
+            }
+            int idx = LIN_SchedAdd((uint8_t)id, dir, (uint8_t)len, slot, cs, data);
+            if (idx == -1) cli_printf("\r\nLIN Schedule voll (%u)\r\n", (unsigned)LIN_SCHED_MAX);
+            else if (idx < 0) cli_printf("\r\nlin sched add: ID 0..0x3F, LEN 1..8, Slot %lu..%lu us\r\n",
+                                         (unsigned long)LIN_SLOT_MIN_US, (unsigned long)LIN_SLOT_MAX_US);
+            else cli_printf("\r\nLIN Schedule Eintrag %d angelegt\r\n", idx);
+            return;
+        }
+        uart_lin_usage();
+        return;
+    }
+
+    if (strcmp(tok[0], "slave") == 0) {
+        if (ntok == 1u || strcmp(tok[1], "list") == 0) { LIN_PrintSlaves(); return; }
+        if (strcmp(tok[1], "clear") == 0) { LIN_SlaveClear(); cli_printf("\r\nLIN Slave Tabelle geleert\r\n"); return; }
+        if (strcmp(tok[1], "del") == 0 && ntok == 3u) {
+            uint32_t id = 0u;
+            if (!uart_parse_u32(tok[2], &id) || id > 0x3Fu || LIN_SlaveDelete((uint8_t)id) != HAL_OK) {
+                cli_printf("\r\nlin slave del: ID nicht in der Tabelle\r\n");
+                return;
+            }
+            cli_printf("\r\nLIN Slave id=%02lX geloescht\r\n", (unsigned long)id);
+            return;
+        }
+
+        uint32_t id = 0u;
+        lin_cs_t cs;
+        uint8_t data[LIN_DATA_MAX];
+        uint8_t dlen = 0u;
+        if (!uart_parse_u32(tok[1], &id) || id > 0x3Fu ||
+            !uart_lin_data(tok, ntok, 2u, &cs, data, &dlen) || dlen == 0u) {
+            uart_lin_usage();
+            return;
+        }
+        if (LIN_SlaveSet((uint8_t)id, dlen, cs, data) != HAL_OK) {
+            cli_printf("\r\nLIN Slave Tabelle voll (%u)\r\n", (unsigned)LIN_SLAVE_MAX);
+            return;
+        }
+        cli_printf("\r\nLIN Slave id=%02lX len=%u gesetzt\r\n", (unsigned long)id, (unsigned)dlen);
+        return;
+    }
+
+    uart_lin_usage();
+}
+
+static void uart_trace_usage(void)
+{
+    cli_printf("\r\nUsage: trace start|stop|stat|reset\r\n");
+    cli_printf("       trace gap <us>        (Burst-Ende nach Ruhezeit, def %u)\r\n", (unsigned)UTRACE_GAP_DEF_US);
+    cli_printf("       trace fmt hex|bin\r\n");
+    cli_printf("       trace baud <n>        (UART4 + UART8)\r\n");
+    cli_printf("  hex: U<4|8> <t_start us> <gap us> <dauer us> <n> <C|E|S|L|-> HH ..\r\n");
+    cli_printf("  bin: A5 <kanal|flags> <t_start:4> <t_end:4> <len:2> <bytes>\r\n");
+}
+
+static void uart_trace_command(char *args)
+{
+    char *save = NULL;
+    char *sub = strtok_r(args, " \t", &save);
+    char *arg = strtok_r(NULL, " \t", &save);
+
+    if (!sub || strcmp(sub, "stat") == 0) {
+        UTRACE_PrintStats();
+        return;
+    }
+
+    if (strcmp(sub, "start") == 0) {
+        uart_stop_engines();
+        g_uart_tunnel = 0;
+        g_raw_half_valid = 0u;
+        if (UTRACE_Start() != HAL_OK) {
+            cli_printf("\r\nTrace start FEHLER (UART RX DMA)\r\n");
+            return;
+        }
+        UTRACE_PrintStats();
+        return;
+    }
+    if (strcmp(sub, "stop") == 0) {
+        MITM_Stop();
+        UTRACE_Stop();
+        USBS_Flush(100u);
+        cli_printf("\r\nTrace aus\r\n");
+        return;
+    }
+    if (strcmp(sub, "reset") == 0) {
+        UTRACE_ResetStats();
+        for (uint8_t i = 0; i < UARTS_CH_COUNT; i++) UARTS_ResetStats((uarts_ch_t)i);
+        cli_printf("\r\nTrace Zaehler zurueckgesetzt\r\n");
+        return;
+    }
+    if (strcmp(sub, "gap") == 0 && arg) {
+        uint32_t us = 0u;
+        if (!uart_parse_u32(arg, &us) || UTRACE_SetGap(us) != HAL_OK) {
+            cli_printf("\r\ntrace gap: 1..1000000 us\r\n");
+            return;
+        }
+        cli_printf("\r\nTrace gap %lu us\r\n", (unsigned long)us);
+        return;
+    }
+    if (strcmp(sub, "fmt") == 0 && arg) {
+        if (strcmp(arg, "hex") == 0) UTRACE_SetFormat(UTRACE_FMT_HEX);
+        else if (strcmp(arg, "bin") == 0) UTRACE_SetFormat(UTRACE_FMT_BIN);
+        else { uart_trace_usage(); return; }
+        cli_printf("\r\nTrace fmt %s\r\n", arg);
+        return;
+    }
+    if (strcmp(sub, "baud") == 0 && arg) {
+        uint32_t baud = 0u;
+        if (!uart_parse_u32(arg, &baud) ||
+            UARTS_SetBaud(UARTS_CH_UART4, baud) != HAL_OK ||
+            UARTS_SetBaud(UARTS_CH_UART8, baud) != HAL_OK) {
+            cli_printf("\r\nBaudrate %lu nicht moeglich\r\n", (unsigned long)baud);
+            uart_sync_from_handle();
+            return;
+        }
+        uart_sync_from_handle();
+        UTRACE_UpdateTiming();
+        cli_printf("\r\nTrace baud %lu (UART4 %lu, UART8 %lu)\r\n", (unsigned long)baud,
+                   (unsigned long)UARTS_GetRealBaud(UARTS_CH_UART4),
+                   (unsigned long)UARTS_GetRealBaud(UARTS_CH_UART8));
+        return;
+    }
+
+    uart_trace_usage();
+}
+
 static void uart_refresh_gpio_state(void)
 {
     g_rs485_120r = uart_read_120r();
@@ -135,50 +1158,154 @@ static void uart_refresh_gpio_state(void)
 }
 
 static void uart_sync_from_handle(void)
+{
+    UARTS_GetLine(uart_get_channel(), &g_uart_line);
+}
+
+// g_uart_line auf die aktive UART; quiet = keine Ausgabe (Tunnel)
+static HAL_StatusTypeDef uart_apply_line(uint8_t quiet)
 {
 #ifdef HAL_UART_MODULE_ENABLED
-    UART_HandleTypeDef *huart = uart_get_handle();
-    if (huart != NULL) {
-        g_uart_baud = huart->Init.BaudRate;
+    if (uart_get_handle() == NULL) {
+        if (!quiet) cli_printf("\r\nUART handle fehlt (huart4/huart8 nicht definiert).\r\n");
+        return HAL_ERROR;
     }
+
+    uarts_ch_t ch = uart_get_channel();
+    if (UARTS_SetLine(ch, &g_uart_line) != HAL_OK) {
+        if (!quiet) cli_printf("\r\nUART Line FEHLER (Baudrate/Format nicht moeglich)\r\n");
+        UARTS_GetLine(ch, &g_uart_line);
+        return HAL_ERROR;
+    }
+    g_raw_half_valid = 0u;
+    uart_report_cdc();
+    UTRACE_UpdateTiming();
+
+    if (!quiet) uart_print_line("UART Line: ");
+    return HAL_OK;
+#else
+    (void)quiet;
+    cli_printf("\r\nUART HAL nicht aktiviert (HAL_UART_MODULE_ENABLED).\r\n");
+    return HAL_ERROR;
 #endif
 }
 
-static void uart_apply_baud(void)
+static void uart_set_baud(uint32_t baud)
 {
-#ifdef HAL_UART_MODULE_ENABLED
-    UART_HandleTypeDef *huart = uart_get_handle();
-    if (huart == NULL) {
-        cli_printf("\r\nUART handle fehlt (huart4/huart8 nicht definiert).\r\n");
+    uarts_ch_t ch = uart_get_channel();
+    if (UARTS_SetBaud(ch, baud) != HAL_OK) {
+        cli_printf("\r\nBaudrate %lu nicht moeglich (fck %lu Hz)\r\n",
+                   (unsigned long)baud, (unsigned long)UARTS_KernelClock(ch));
         return;
     }
+    g_uart_line.baud = baud;
+    uart_report_cdc();
+    UTRACE_UpdateTiming();
+    uart_print_line("UART Line: ");
+}
 
-    huart->Init.BaudRate = g_uart_baud;
-    huart->Init.WordLength = UART_WORDLENGTH_8B;
-    huart->Init.StopBits = UART_STOPBITS_1;
-    huart->Init.Parity = UART_PARITY_NONE;
-    huart->Init.Mode = UART_MODE_TX_RX;
-    huart->Init.HwFlowCtl = UART_HWCONTROL_NONE;
-    huart->Init.OverSampling = UART_OVERSAMPLING_16;
-    huart->Init.OneBitSampling = UART_ONE_BIT_SAMPLE_DISABLE;
-    huart->Init.ClockPrescaler = UART_PRESCALER_DIV1;
-    huart->AdvancedInit.AdvFeatureInit = UART_ADVFEATURE_NO_INIT;
+static void uart_cmd_line(const char *args)
+{
+    char *end = NULL;
+    uarts_line_t line = g_uart_line;
 
-    (void)HAL_UART_DeInit(huart);
-    HAL_StatusTypeDef st = HAL_UART_Init(huart);
-    if (st != HAL_OK) {
-        cli_printf("\r\nUART re-init FEHLER\r\n");
+    unsigned long baud = strtoul(args, &end, 10);
+    if (end == args || baud == 0u) {
+        cli_printf("\r\nSyntax: line <baud> [7N1|8E1|8O2|9N1|8N1.5 ...]\r\n");
         return;
     }
+    line.baud = (uint32_t)baud;
 
-    (void)HAL_UARTEx_SetTxFifoThreshold(huart, UART_TXFIFO_THRESHOLD_1_8);
-    (void)HAL_UARTEx_SetRxFifoThreshold(huart, UART_RXFIFO_THRESHOLD_1_8);
-    (void)HAL_UARTEx_DisableFifoMode(huart);
+    while (*end == ' ') end++;
+    if (*end != '\0' && !uart_parse_format(end, &line)) {
+        cli_printf("\r\nFormat ungueltig: %s\r\n", end);
+        return;
+    }
 
-    cli_printf("\r\nUART re-init OK (%lu Baud)\r\n", (unsigned long)g_uart_baud);
-#else
-    cli_printf("\r\nUART HAL nicht aktiviert (HAL_UART_MODULE_ENABLED).\r\n");
-#endif
+    uarts_line_t old = g_uart_line;
+    g_uart_line = line;
+    if (uart_apply_line(0u) != HAL_OK) {
+        g_uart_line = old;
+    }
+}
+
+static void uart_cmd_autobaud(const char *args)
+{
+    uint8_t mode = 0u;
+    while (*args == ' ') args++;
+
+    if (strcmp(args, "stop") == 0) {
+        UARTS_AutoBaudCancel(uart_get_channel());
+        g_uart_abr = 0u;
+        cli_printf("\r\nAutobaud abgebrochen\r\n");
+        return;
+    }
+    if (strcmp(args, "7f") == 0 || strcmp(args, "7F") == 0) mode = 2u;
+    else if (strcmp(args, "55") == 0) mode = 3u;
+    else if (strcmp(args, "edge") == 0) mode = 1u;
+    else if (*args != '\0' && strcmp(args, "start") != 0) {
+        cli_printf("\r\nSyntax: autobaud [start|edge|7f|55|stop]\r\n");
+        return;
+    }
+
+    if (UARTS_AutoBaudStart(uart_get_channel(), mode) != HAL_OK) {
+        cli_printf("\r\nAutobaud FEHLER\r\n");
+        return;
+    }
+    g_uart_abr = 1u;
+    g_uart_abr_t0 = HAL_GetTick();
+    cli_printf("\r\nAutobaud aktiv (%s), warte auf Zeichen...\r\n",
+               (mode == 2u) ? "0x7F" : (mode == 3u) ? "0x55" : (mode == 1u) ? "Flanke" : "Startbit");
+}
+
+static void uart_poll_autobaud(void)
+{
+    uarts_ch_t ch = uart_get_channel();
+    uint32_t baud = 0u;
+    int8_t r = UARTS_AutoBaudPoll(ch, &baud);
+
+    if (r == 0 && (HAL_GetTick() - g_uart_abr_t0) > UART_ABR_TIMEOUT_MS) {
+        UARTS_AutoBaudCancel(ch);
+        r = -2;
+    }
+    if (r == 0) return;
+
+    g_uart_abr = 0u;
+    if (r == 1) {
+        g_uart_line.baud = baud;
+        uart_report_cdc();
+        cli_printf("\r\nAutobaud: %lu Baud\r\n", (unsigned long)baud);
+    } else {
+        cli_printf("\r\nAutobaud %s\r\n", (r == -2) ? "Timeout" : "FEHLER (ABRE)");
+    }
+    CLI_PrintPrompt();
+}
+
+// Host hat SET_LINE_CODING geschickt -> im Tunnel direkt uebernehmen.
+// Ausserhalb des Tunnels bleibt das Flag stehen: Hosts schicken die
+// Einstellung beim Oeffnen des Ports, also meist vor 'w'
+static void uart_poll_line_coding(void)
+{
+    USBD_CDC_LineCodingTypeDef lc;
+    if (!g_uart_tunnel || !CDC_TakeLineCoding_HS(&lc)) return;
+
+    uarts_line_t line = g_uart_line;
+    line.baud = lc.bitrate;
+    line.stop = lc.format;
+    if (lc.paritytype == 0u) line.parity = 'N';
+    else if (lc.paritytype == 1u) line.parity = 'O';
+    else if (lc.paritytype == 2u) line.parity = 'E';
+    else return;                        // Mark/Space kann die USART nicht
+    if (lc.datatype >= 7u && lc.datatype <= 9u) line.data_bits = lc.datatype;
+    else if (lc.datatype == 16u) line.data_bits = 9u;
+    else return;
+
+    uarts_line_t old = g_uart_line;
+    g_uart_line = line;
+    if (uart_apply_line(1u) != HAL_OK) {
+        g_uart_line = old;
+        uart_report_cdc();
+    }
 }
 
 static void uart_print_labels(void)
@@ -199,7 +1326,8 @@ static void uart_setup_show_main(void)
     cli_printf("\r\n[UART Setup]\r\n");
     cli_printf("  120R Termination: %s\r\n", uart_has_120r() ? (g_rs485_120r ? "ON" : "OFF") : "n/a");
     cli_printf("  SLR Control:      %s\r\n", uart_has_slr() ? (g_rs485_slr ? "ON" : "OFF") : "n/a");
-    cli_printf("  Baudrate:         %lu\r\n\r\n", (unsigned long)g_uart_baud);
+    cli_printf("  Line:             %lu %u%c%s\r\n\r\n", (unsigned long)g_uart_line.baud,
+               (unsigned)g_uart_line.data_bits, g_uart_line.parity, uart_stop_str(g_uart_line.stop));
 
     cli_printf("  1 - RS485 120R\r\n");
     cli_printf("  2 - RS485 SLR\r\n");
@@ -239,9 +1367,11 @@ static void uart_setup_show_baud(void)
     g_setup_state = UART_SETUP_BAUD;
 
     cli_printf("\r\n[UART Setup] Baudrate\r\n");
-    cli_printf("Aktuell: %lu\r\n\r\n", (unsigned long)g_uart_baud);
+    cli_printf("Aktuell: %lu\r\n\r\n", (unsigned long)g_uart_line.baud);
     cli_printf("  1 - 9600\r\n");
     cli_printf("  2 - 115200\r\n");
+    cli_printf("  3 - 1000000\r\n");
+    cli_printf("  (beliebig: baud <n> / line <n> 8N1)\r\n");
     cli_printf("  q - back\r\n");
     cli_printf("\r\nAuswahl: ");
 }
@@ -255,23 +1385,57 @@ static void uart_print_help(void)
     cli_printf("UART Mode Befehle:\r\n");
     cli_printf("  s        - Setup\r\n");
     cli_printf("  w        - UART Tunnel (ESC beendet)\r\n");
+    cli_printf("  diag     - RX/TX Zaehler (diag reset = loeschen)\r\n");
+    cli_printf("  de       - RS485 DE Timing (de <assert> <deassert>)\r\n");
+    cli_printf("  baud <n> - Baudrate (nur BRR)\r\n");
+    cli_printf("  line <n> [8N1] - Baudrate + Format (7/8/9, N/E/O, 1/1.5/2)\r\n");
+    cli_printf("  autobaud [edge|7f|55|stop] - Baudrate messen\r\n");
+    cli_printf("  mb ...   - Modbus RTU Master/Sniffer (mb ? = Hilfe)\r\n");
+    cli_printf("  trace ...- UART4/UART8 Sniffer mit Zeitstempel (trace ? = Hilfe)\r\n");
+    cli_printf("  bridge ..- UART4 + UART8 gleichzeitig, gerahmt (bridge ? = Hilfe)\r\n");
+    cli_printf("  lin ...  - LIN Master/Slave/Monitor (lin ? = Hilfe)\r\n");
+    cli_printf("  mitm ... - UART4 <-> UART8 Proxy mit Mitschnitt (mitm ? = Hilfe)\r\n");
+    cli_printf("  trig ... - Muster-Trigger auf den RX Streams (trig ? = Hilfe)\r\n");
+    cli_printf("  bert ... - PRBS Bitfehlertest + Baud/SLR Sweep (bert ? = Hilfe)\r\n");
     cli_printf("  ?        - diese Hilfe\r\n");
 }
 
 void UART_Mode_Enter(void)
 {
+    if (g_uart_abr) {
+        UARTS_AutoBaudCancel(uart_get_channel());
+        g_uart_abr = 0u;
+    }
+    uart_stop_engines();
     g_uart_tunnel = 0;
     g_setup_state = UART_SETUP_NONE;
     g_uart_handle_select = UART_HANDLE_AUTO;
     uart_set_tx_en(0u);
     uart_sync_from_handle();
     uart_refresh_gpio_state();
+    uart_stream_start();
     if (CLI_IsDebugEnabled()) {
         uart_print_help();
         uart_print_labels();
     }
 }
 
+// nichts laeuft ohne UART_Mode_Poll weiter (LIN Schedule, Trace, BERT ...)
+void UART_Mode_Exit(void)
+{
+    if (g_uart_abr) {
+        UARTS_AutoBaudCancel(uart_get_channel());
+        g_uart_abr = 0u;
+    }
+    uart_stop_engines();
+    (void)UTRIG_Arm(0u);
+    g_uart_tunnel = 0;
+    uart_set_tx_en(0u);
+    for (uint8_t ch = 0; ch < UARTS_CH_COUNT; ch++) {
+        UARTS_Stop((uarts_ch_t)ch);
+    }
+}
+
 void UART_Mode_StartTunnel(uint8_t use_uart8)
 {
 #ifdef HAL_UART_MODULE_ENABLED
@@ -293,8 +1457,12 @@ void UART_Mode_StartTunnel(uint8_t use_uart8)
     return;
 #endif
 
+    uart_stop_engines();
     g_uart_tunnel = 1;
+    g_raw_half_valid = 0u;
     uart_set_tx_en(0u);
+    uart_sync_from_handle();
+    uart_stream_start();
     cli_printf("\r\nUART tunnel aktiv (%s, ESC beendet)\r\n", use_uart8 ? "uart8" : "auto");
 }
 uint8_t UART_Mode_HandleLine(char *line)
@@ -308,7 +1476,9 @@ uint8_t UART_Mode_HandleLine(char *line)
     }
 
     if (strcmp(line, "w") == 0 || strcmp(line, "W") == 0) {
+        uart_stop_engines();
         g_uart_tunnel = 1;
+        g_raw_half_valid = 0u;
         uart_set_tx_en(0u);
         cli_printf("\r\nUART tunnel aktiv (ESC beendet)\r\n");
         return 1;
@@ -319,28 +1489,104 @@ uint8_t UART_Mode_HandleLine(char *line)
         return 1;
     }
 
+    if (strcmp(line, "diag") == 0) {
+        uart_print_diag();
+        return 1;
+    }
+
+    if (strcmp(line, "line") == 0) {
+        uart_print_line("UART Line: ");
+        return 1;
+    }
+
+    if (strncmp(line, "line ", 5) == 0) {
+        uart_cmd_line(&line[5]);
+        return 1;
+    }
+
+    if (strncmp(line, "baud ", 5) == 0) {
+        char *end = NULL;
+        unsigned long baud = strtoul(&line[5], &end, 10);
+        if (end == &line[5] || baud == 0u) {
+            cli_printf("\r\nSyntax: baud <n>\r\n");
+        } else {
+            uart_set_baud((uint32_t)baud);
+        }
+        return 1;
+    }
+
+    if (strcmp(line, "autobaud") == 0 || strncmp(line, "autobaud ", 9) == 0) {
+        uart_cmd_autobaud(&line[8]);
+        return 1;
+    }
+
+    if (strncmp(line, "mb", 2) == 0 && (line[2] == '\0' || line[2] == ' ')) {
+        if (strcmp(line, "mb ?") == 0) uart_mb_usage();
+        else uart_mb_command(line + 2);
+        return 1;
+    }
+
+    if (strncmp(line, "lin", 3) == 0 && (line[3] == '\0' || line[3] == ' ')) {
+        if (strcmp(line, "lin ?") == 0) uart_lin_usage();
+        else uart_lin_command(line + 3);
+        return 1;
+    }
+
+    if (strncmp(line, "bridge", 6) == 0 && (line[6] == '\0' || line[6] == ' ')) {
+        if (strcmp(line, "bridge ?") == 0) uart_bridge_usage();
+        else uart_bridge_command(line + 6);
+        return 1;
+    }
+
+    if (strncmp(line, "bert", 4) == 0 && (line[4] == '\0' || line[4] == ' ')) {
+        if (strcmp(line, "bert ?") == 0) uart_bert_usage();
+        else uart_bert_command(line + 4);
+        return 1;
+    }
+
+    if (strncmp(line, "trig", 4) == 0 && (line[4] == '\0' || line[4] == ' ')) {
+        if (strcmp(line, "trig ?") == 0) uart_trig_usage();
+        else uart_trig_command(line + 4);
+        return 1;
+    }
+
+    if (strncmp(line, "mitm", 4) == 0 && (line[4] == '\0' || line[4] == ' ')) {
+        if (strcmp(line, "mitm ?") == 0) uart_mitm_usage();
+        else uart_mitm_command(line + 4);
+        return 1;
+    }
+
+    if (strncmp(line, "trace", 5) == 0 && (line[5] == '\0' || line[5] == ' ')) {
+        if (strcmp(line, "trace ?") == 0) uart_trace_usage();
+        else uart_trace_command(line + 5);
+        return 1;
+    }
+
+    if (strcmp(line, "de") == 0) {
+        uart_print_de();
+        return 1;
+    }
+
+    if (strncmp(line, "de ", 3) == 0) {
+        uart_set_de(&line[3]);
+        return 1;
+    }
+
+    if (strcmp(line, "diag reset") == 0) {
+        UARTS_ResetStats(UARTS_CH_UART4);
+        UARTS_ResetStats(UARTS_CH_UART8);
+        cli_printf("\r\nUART Zaehler geloescht\r\n");
+        return 1;
+    }
+
     return 1;
 }
 
 uint8_t UART_Mode_HandleChar(char ch)
 {
     if (g_uart_tunnel) {
-        if ((uint8_t)ch == 0x1B) {
-            g_uart_tunnel = 0;
-            uart_set_tx_en(0u);
-            cli_printf("\r\n(UART tunnel beendet)\r\n");
-            CLI_PrintPrompt();
-            return 1;
-        }
-
-#ifdef HAL_UART_MODULE_ENABLED
-        UART_HandleTypeDef *huart = uart_get_handle();
-        if (huart != NULL) {
-        	uart_set_tx_en(1u);
-            (void)HAL_UART_Transmit(huart, (uint8_t *)&ch, 1u, UART_TX_TIMEOUT_MS);
-            uart_set_tx_en(0u);
-        }
-#endif
+        uint8_t b = (uint8_t)ch;
+        (void)UART_Mode_HandleRaw(&b, 1u);
         return 1;
     }
 
@@ -373,8 +1619,9 @@ uint8_t UART_Mode_HandleChar(char ch)
         }
 
         if (g_setup_state == UART_SETUP_BAUD) {
-            if (ch == '1') { g_uart_baud = 9600u; uart_apply_baud(); uart_setup_show_baud(); return 1; }
-            if (ch == '2') { g_uart_baud = 115200u; uart_apply_baud(); uart_setup_show_baud(); return 1; }
+            if (ch == '1') { uart_set_baud(9600u); uart_setup_show_baud(); return 1; }
+            if (ch == '2') { uart_set_baud(115200u); uart_setup_show_baud(); return 1; }
+            if (ch == '3') { uart_set_baud(1000000u); uart_setup_show_baud(); return 1; }
             if (ch == 'q' || ch == 'Q') { uart_setup_show_main(); return 1; }
             return 1;
         }
@@ -385,7 +1632,9 @@ uint8_t UART_Mode_HandleChar(char ch)
     if (ch == 's' || ch == 'S') { uart_setup_show_main(); return 1; }
     if (ch == '?') { uart_print_help(); return 1; }
     if (ch == 'w' || ch == 'W') {
+        uart_stop_engines();
         g_uart_tunnel = 1;
+        g_raw_half_valid = 0u;
         uart_set_tx_en(0u);
         cli_printf("\r\nUART tunnel aktiv (ESC beendet)\r\n");
         return 1;
@@ -394,32 +1643,158 @@ uint8_t UART_Mode_HandleChar(char ch)
     return 0;
 }
 
+static void uart_tunnel_esc(void)
+{
+    // ESC: Tunnel zu, ein laufender Burst wird noch fertig gesendet
+    g_uart_tunnel = 0;
+    g_raw_half_valid = 0u;
+    cli_printf("\r\n(UART tunnel beendet)\r\n");
+    CLI_PrintPrompt();
+}
+
+// 9 Datenbits: USB Strom = 16 Bit LE pro Zeichen, ESC = Wort 0x001B.
+// Ein ungerades Restbyte wird bis zum naechsten Paket gehalten.
+static uint16_t uart_raw_wide(uarts_ch_t ch, const uint8_t *data, uint16_t len)
+{
+    uint16_t n = 0u;
+
+    if (g_raw_half_valid) {
+        uint8_t w[2] = { g_raw_half, data[0] };
+        if (w[0] == 0x1Bu && w[1] == 0u) {
+            uart_tunnel_esc();
+            return 1u;
+        }
+        if (UARTS_Write(ch, w, 2u) != 2u) return 0u;
+        g_raw_half_valid = 0u;
+        n = 1u;
+    }
+
+    uint16_t start = n;
+    while ((uint16_t)(n + 2u) <= len && !(data[n] == 0x1Bu && data[n + 1u] == 0u)) {
+        n = (uint16_t)(n + 2u);
+    }
+
+    if (n > start) {
+        uint16_t done = UARTS_Write(ch, &data[start], (uint16_t)(n - start));
+        if (done < (uint16_t)(n - start)) return (uint16_t)(start + done);
+    }
+
+    if ((uint16_t)(n + 2u) <= len) {
+        uart_tunnel_esc();
+        return (uint16_t)(n + 2u);
+    }
+
+    if (n < len) {
+        g_raw_half = data[n];
+        g_raw_half_valid = 1u;
+        n++;
+    }
+    return n;
+}
+
+uint16_t UART_Mode_HandleRaw(const uint8_t *data, uint16_t len)
+{
+    if (UBRG_IsActive()) {
+        uint16_t done = UBRG_HandleRaw(data, len);
+        if (!UBRG_IsActive()) {
+            USBS_Flush(100u);
+            uart_sync_from_handle();
+            cli_printf("\r\n(UART bridge beendet)\r\n");
+            CLI_PrintPrompt();
+        }
+        return done;
+    }
+
+    if (!g_uart_tunnel || len == 0u) return 0u;
+
+    uarts_ch_t ch = uart_get_channel();
+    if (UARTS_IsWide(ch)) {
+        return uart_raw_wide(ch, data, len);
+    }
+
+    uint16_t n = 0u;
+    while (n < len && data[n] != 0x1Bu) n++;
+
+    if (n > 0u) {
+        uint16_t done = UARTS_Write(ch, data, n);
+        if (done < n) return done;   // TX Ring voll -> Rest spaeter
+    }
+
+    if (n < len) {
+        uart_tunnel_esc();
+        return (uint16_t)(n + 1u);
+    }
+
+    return n;
+}
+
 uint8_t UART_Mode_IsRawActive(void)
 {
-    return g_uart_tunnel ? 1u : 0u;
+    return (g_uart_tunnel || UBRG_IsActive()) ? 1u : 0u;
 }
 
 void UART_Mode_Poll(void)
 {
-    if (!g_uart_tunnel) {
+    uarts_ch_t ch = uart_get_channel();
+
+    if (g_uart_abr) {
+        uart_poll_autobaud();
+    }
+    uart_poll_line_coding();
+
+    // Notify-Zeilen nicht in Rohdaten mischen
+    UTRIG_Poll((g_uart_tunnel || UBRG_IsActive() ||
+                (UTRACE_IsActive() && UTRACE_GetFormat() == UTRACE_FMT_BIN)) ? 1u : 0u);
+
+    if (UBRG_IsActive()) {
+        UBRG_Poll();
         return;
     }
 
-#ifdef HAL_UART_MODULE_ENABLED
-    UART_HandleTypeDef *huart = uart_get_handle();
-    if (huart == NULL) {
+    if (BERT_IsActive()) {
+        BERT_Poll();
+        if (!BERT_IsActive()) uart_sync_from_handle();   // Sweep fertig
+        USBS_Poll();
         return;
     }
 
-    for (uint32_t i = 0; i < 64u; i++) {
-        if (__HAL_UART_GET_FLAG(huart, UART_FLAG_RXNE) == RESET) {
-            break;
-        }
+    if (LIN_IsActive()) {
+        LIN_Poll();
+        USBS_Poll();
+        return;
+    }
 
-        uint8_t ch = (uint8_t)(huart->Instance->RDR & 0xFFu);
-        if (CDC_Transmit_HS(&ch, 1u) == USBD_BUSY) {
-            break;
-        }
+    if (UTRACE_IsActive()) {
+        UTRACE_Poll();
+        return;
     }
-#endif
+
+    if (MB_IsActive()) {
+        MB_Poll();
+        USBS_Poll();
+        return;
+    }
+
+    if (!UARTS_IsRunning(ch)) {
+        return;
+    }
+
+    if (!g_uart_tunnel) {
+        // ausserhalb des Tunnels nichts ausgeben, Ring nicht volllaufen lassen
+        UARTS_RxFlush(ch);
+        return;
+    }
+
+    // RX Ring -> USB TX Ring, so viel wie USB gerade aufnehmen kann
+    for (uint8_t i = 0; i < 2u; i++) {
+        const uint8_t *p = NULL;
+        uint16_t n = UARTS_RxPeek(ch, &p);
+        if (n == 0u) break;
+
+        uint16_t done = USBS_Write(p, n);
+        UARTS_RxConsume(ch, done);
+        if (done < n) break;
+    }
+
+    USBS_Poll();
 }
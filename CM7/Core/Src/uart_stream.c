@@ -0,0 +1,934 @@
+/*
+ * uart_stream.c
+ *
+ *  DMA based UART receive/transmit engine (UART4 / UART8).
+ */
+#include "uart_stream.h"
+#include "usart.h"
+#include <string.h>
+
+// ============================================================
+// UART STREAM ENGINE
+//
+// RX:
+//   - Circular DMA in einen 4 KB Ring pro Kanal, USART FIFO an
+//   - Schreibposition kommt aus dem DMA Zaehler (NDTR); IDLE, RTO und
+//     DMA Half/Complete aktualisieren den absoluten Schreibzeiger, damit
+//     auch ein voller Umlauf noch erkannt wird
+//   - Eigener IRQ Handler statt HAL_UART_IRQHandler: HAL behandelt
+//     RTO/ORE als blockierende Fehler und bricht die DMA ab, hier werden
+//     sie nur gezaehlt
+//
+// TX:
+//   - TX Ring pro Kanal, DMA (normal mode) direkt ueber HAL_DMA_Start_IT;
+//     im DMA TC wird sofort der naechste Block gestartet, die USART TX
+//     FIFO ueberbrueckt den Wechsel -> Frames gehen lueckenlos raus
+//   - Ring leer -> USART TC Interrupt, dort DE (GPIO) freigeben, also
+//     erst nach dem Stoppbit des letzten Bytes
+//   - optional Hardware-DE der USART (UARTS_UART4_HW_DE)
+//
+// Line Settings:
+//   - Baudrate direkt ueber BRR (UE kurz aus), OVER8 oberhalb fck/16,
+//     kein HAL_UART_DeInit/Init und kein DMA Neustart
+//   - 7/8/9 Datenbits, Paritaet, 1/1.5/2 Stoppbits ueber CR1/CR2
+//   - 7 Datenbits + Paritaet: RDR traegt das Paritaetsbit in Bit 7,
+//     neue Bytes werden beim Nachziehen des Schreibzeigers maskiert
+//   - 9 Datenbits: DMA auf Halfword, Ringe tragen 16 Bit LE pro Zeichen
+//   - Autobaud ueber die ABR Hardware (ABREN/ABRMOD), nicht blockierend
+//   - LIN: LINEN + Break-Erkennung als RX Event, Break senden ueber SBKRQ
+// ============================================================
+
+typedef struct {
+    UART_HandleTypeDef *huart;
+    GPIO_TypeDef *de_port;         // NULL = kein DE / Hardware-DE
+    uint16_t de_pin;
+    uint8_t hw_de;
+    uint8_t de_at;                 // DEAT/DEDT in Sample-Zeiten
+    uint8_t de_dt;
+    uint8_t *tx_buf;
+    volatile uint32_t tx_head;     // absolut, geschrieben
+    volatile uint32_t tx_tail;     // absolut, an DMA uebergeben
+    volatile uint16_t tx_inflight;
+    volatile uint8_t tx_active;    // DE aktiv bis TC
+    volatile uint8_t tx_ext;       // TDR von aussen (UARTS_ExtTxBegin), DE halten
+    uint8_t *rx_buf;
+    volatile uint32_t rx_head;     // absolut, von DMA geschrieben
+    volatile uint32_t rx_tail;     // absolut, vom Leser verbraucht
+    uint16_t rx_last_pos;
+    uint32_t rto_bits;
+    volatile uint8_t running;
+    uint8_t wide;                  // 9 Datenbits: 2 Bytes pro Zeichen
+    uint8_t strip7;                // 7 Datenbits + Paritaet: Bit 7 loeschen
+    uint8_t abr_active;
+    uarts_rx_event_cb_t rx_event_cb;
+    uarts_rx_tap_t rx_tap;
+    uarts_tx_done_cb_t tx_done_cb;
+    uarts_line_t line;
+    uarts_stats_t stats;
+} uarts_chan_t;
+
+static uint8_t g_uarts_rx_buf[UARTS_CH_COUNT][UARTS_RX_BUF_SIZE] __attribute__((aligned(32)));
+static uint8_t g_uarts_tx_buf[UARTS_CH_COUNT][UARTS_TX_BUF_SIZE] __attribute__((aligned(32)));
+
+static uarts_chan_t g_uarts[UARTS_CH_COUNT] = {
+    {
+        .huart = &huart4,
+#if UARTS_UART4_HW_DE
+        .hw_de = 1u,
+        .de_at = UARTS_DE_TIME_DEF,
+        .de_dt = UARTS_DE_TIME_DEF,
+#elif defined(UART_TX_EN_GPIO_Port) && defined(UART_TX_EN_Pin)
+        .de_port = UART_TX_EN_GPIO_Port,
+        .de_pin = UART_TX_EN_Pin,
+#endif
+        .tx_buf = g_uarts_tx_buf[UARTS_CH_UART4],
+        .rx_buf = g_uarts_rx_buf[UARTS_CH_UART4],
+        .rto_bits = UARTS_RTO_BITS_DEF,
+        .line = { 115200u, 8u, 'N', UARTS_STOP_1 },
+    },
+    {
+        .huart = &huart8,
+        .tx_buf = g_uarts_tx_buf[UARTS_CH_UART8],
+        .rx_buf = g_uarts_rx_buf[UARTS_CH_UART8],
+        .rto_bits = UARTS_RTO_BITS_DEF,
+        .line = { 38400u, 8u, 'N', UARTS_STOP_1 },
+    },
+};
+
+static void uarts_tx_kick(uarts_chan_t *c);
+
+static uarts_chan_t *uarts_from_handle(UART_HandleTypeDef *huart)
+{
+    for (uint8_t i = 0; i < UARTS_CH_COUNT; i++) {
+        if (g_uarts[i].huart == huart) return &g_uarts[i];
+    }
+    return NULL;
+}
+
+// Schreibzeiger aus NDTR nachziehen. Muss mindestens alle halben Ring
+// laufen (DMA HT/TC garantiert das), sonst ist ein Umlauf nicht sichtbar.
+static void uarts_update_head(uarts_chan_t *c)
+{
+    if (!c->running || c->huart->hdmarx == NULL) return;
+
+    uint16_t pos = (uint16_t)(UARTS_RX_BUF_SIZE -
+                              (__HAL_DMA_GET_COUNTER(c->huart->hdmarx) << c->wide));
+    if (pos >= UARTS_RX_BUF_SIZE) pos = 0u;
+
+    uint16_t delta = (uint16_t)((pos - c->rx_last_pos) & (UARTS_RX_BUF_SIZE - 1u));
+    if (delta == 0u) return;
+
+    if (c->strip7) {
+        for (uint16_t i = c->rx_last_pos; i != pos; i = (uint16_t)((i + 1u) & (UARTS_RX_BUF_SIZE - 1u))) {
+            c->rx_buf[i] &= 0x7Fu;
+        }
+    }
+
+    c->rx_last_pos = pos;
+    c->rx_head += delta;
+    c->stats.rx_bytes += delta;
+
+    uint32_t fill = c->rx_head - c->rx_tail;
+    if (fill > UARTS_RX_BUF_SIZE) {
+        c->stats.rx_lost += fill - UARTS_RX_BUF_SIZE;
+        c->rx_tail = c->rx_head - UARTS_RX_BUF_SIZE;
+    }
+
+    if (c->rx_tap) c->rx_tap((uarts_ch_t)(c - g_uarts), c->rx_head);
+}
+
+static void uarts_update_head_locked(uarts_chan_t *c)
+{
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    uarts_update_head(c);
+    __set_PRIMASK(primask);
+}
+
+UART_HandleTypeDef *UARTS_Handle(uarts_ch_t ch)
+{
+    if (ch >= UARTS_CH_COUNT) return NULL;
+    return g_uarts[ch].huart;
+}
+
+HAL_StatusTypeDef UARTS_Start(uarts_ch_t ch)
+{
+    if (ch >= UARTS_CH_COUNT) return HAL_ERROR;
+    uarts_chan_t *c = &g_uarts[ch];
+    UART_HandleTypeDef *huart = c->huart;
+
+    if (huart->Instance == NULL || huart->hdmarx == NULL) return HAL_ERROR;
+
+    UARTS_Stop(ch);
+
+    // nach HAL_UART_Init ist DEM wieder aus
+    if (c->hw_de) {
+        (void)UARTS_SetDeTiming(ch, c->de_at, c->de_dt);
+    }
+
+    (void)HAL_UARTEx_SetRxFifoThreshold(huart, UART_RXFIFO_THRESHOLD_1_2);
+    (void)HAL_UARTEx_EnableFifoMode(huart);
+
+    c->rx_head = 0u;
+    c->rx_tail = 0u;
+    c->rx_last_pos = 0u;
+
+    // Size in Zeichen, bei 9 Bit also Halfwords
+    if (HAL_UART_Receive_DMA(huart, c->rx_buf, (uint16_t)(UARTS_RX_BUF_SIZE >> c->wide)) != HAL_OK) {
+        return HAL_ERROR;
+    }
+    c->running = 1u;
+
+    UARTS_SetRxTimeout(ch, c->rto_bits);
+
+    __HAL_UART_CLEAR_FLAG(huart, UART_CLEAR_IDLEF | UART_CLEAR_OREF | UART_CLEAR_FEF |
+                                 UART_CLEAR_NEF | UART_CLEAR_PEF);
+    __HAL_UART_ENABLE_IT(huart, UART_IT_IDLE);
+    __HAL_UART_ENABLE_IT(huart, UART_IT_PE);
+    __HAL_UART_ENABLE_IT(huart, UART_IT_ERR);
+
+    return HAL_OK;
+}
+
+void UARTS_Stop(uarts_ch_t ch)
+{
+    if (ch >= UARTS_CH_COUNT) return;
+    uarts_chan_t *c = &g_uarts[ch];
+    UART_HandleTypeDef *huart = c->huart;
+
+    if (!c->running) return;
+    c->running = 0u;
+
+    __HAL_UART_DISABLE_IT(huart, UART_IT_IDLE);
+    __HAL_UART_DISABLE_IT(huart, UART_IT_RTO);
+    (void)HAL_UART_AbortReceive(huart);
+}
+
+uint8_t UARTS_IsRunning(uarts_ch_t ch)
+{
+    if (ch >= UARTS_CH_COUNT) return 0u;
+    return g_uarts[ch].running;
+}
+
+void UARTS_SetRxTimeout(uarts_ch_t ch, uint32_t bits)
+{
+    if (ch >= UARTS_CH_COUNT) return;
+    uarts_chan_t *c = &g_uarts[ch];
+    UART_HandleTypeDef *huart = c->huart;
+
+    if (bits > USART_RTOR_RTO) bits = USART_RTOR_RTO;
+    c->rto_bits = bits;
+    if (!c->running) return;
+
+    if (bits == 0u) {
+        __HAL_UART_DISABLE_IT(huart, UART_IT_RTO);
+        CLEAR_BIT(huart->Instance->CR2, USART_CR2_RTOEN);
+        return;
+    }
+
+    // direkt ins Register: HAL_UART_EnableReceiverTimeout will gState READY
+    MODIFY_REG(huart->Instance->RTOR, USART_RTOR_RTO, bits);
+    SET_BIT(huart->Instance->CR2, USART_CR2_RTOEN);
+    __HAL_UART_CLEAR_FLAG(huart, UART_CLEAR_RTOF);
+    __HAL_UART_ENABLE_IT(huart, UART_IT_RTO);
+}
+
+static uarts_chan_t *uarts_from_dma(DMA_HandleTypeDef *hdma)
+{
+    for (uint8_t i = 0; i < UARTS_CH_COUNT; i++) {
+        if (g_uarts[i].huart->hdmatx == hdma) return &g_uarts[i];
+    }
+    return NULL;
+}
+
+static void uarts_de_assert(uarts_chan_t *c, uint8_t on)
+{
+    if (c->de_port != NULL) {
+        HAL_GPIO_WritePin(c->de_port, c->de_pin, on ? GPIO_PIN_SET : GPIO_PIN_RESET);
+    }
+}
+
+static void uarts_dma_tx_cplt(DMA_HandleTypeDef *hdma)
+{
+    uarts_chan_t *c = uarts_from_dma(hdma);
+    if (!c) return;
+
+    c->tx_tail += c->tx_inflight;
+    c->stats.tx_bytes += c->tx_inflight;
+    c->tx_inflight = 0u;
+
+    if (c->tx_head != c->tx_tail) {
+        uarts_tx_kick(c);
+        return;
+    }
+
+    // letzter Block in der USART FIFO -> DE erst nach TC loslassen
+    CLEAR_BIT(c->huart->Instance->CR3, USART_CR3_DMAT);
+    __HAL_UART_CLEAR_FLAG(c->huart, UART_CLEAR_TCF);
+    __HAL_UART_ENABLE_IT(c->huart, UART_IT_TC);
+}
+
+static void uarts_dma_tx_error(DMA_HandleTypeDef *hdma)
+{
+    uarts_chan_t *c = uarts_from_dma(hdma);
+    if (!c) return;
+
+    c->stats.tx_dma_err++;
+    c->tx_inflight = 0u;
+    c->tx_tail = c->tx_head;
+    CLEAR_BIT(c->huart->Instance->CR3, USART_CR3_DMAT);
+    __HAL_UART_ENABLE_IT(c->huart, UART_IT_TC);
+}
+
+// naechsten zusammenhaengenden Block an die DMA geben (IRQ gesperrt
+// oder aus der DMA ISR)
+static void uarts_tx_kick(uarts_chan_t *c)
+{
+    UART_HandleTypeDef *huart = c->huart;
+    DMA_HandleTypeDef *hdma = huart->hdmatx;
+
+    if (c->tx_inflight != 0u || hdma == NULL) return;
+
+    uint32_t pending = c->tx_head - c->tx_tail;
+    if (pending == 0u) return;
+
+    uint16_t off = (uint16_t)(c->tx_tail & (UARTS_TX_BUF_SIZE - 1u));
+    uint16_t len = (uint16_t)(UARTS_TX_BUF_SIZE - off);
+    if (len > pending) len = (uint16_t)pending;
+
+    if (!c->tx_active) {
+        c->tx_active = 1u;
+        c->stats.tx_bursts++;
+        __HAL_UART_DISABLE_IT(huart, UART_IT_TC);
+        uarts_de_assert(c, 1u);
+    }
+
+    hdma->XferCpltCallback = uarts_dma_tx_cplt;
+    hdma->XferErrorCallback = uarts_dma_tx_error;
+    hdma->XferHalfCpltCallback = NULL;
+    hdma->XferAbortCallback = NULL;
+
+    c->tx_inflight = len;
+    SET_BIT(huart->Instance->CR3, USART_CR3_DMAT);
+    if (HAL_DMA_Start_IT(hdma, (uint32_t)&c->tx_buf[off],
+                         (uint32_t)&huart->Instance->TDR, (uint32_t)len >> c->wide) != HAL_OK) {
+        uarts_dma_tx_error(hdma);
+    }
+}
+
+uint16_t UARTS_TxFree(uarts_ch_t ch)
+{
+    if (ch >= UARTS_CH_COUNT) return 0u;
+    uarts_chan_t *c = &g_uarts[ch];
+    return (uint16_t)(UARTS_TX_BUF_SIZE - (c->tx_head - c->tx_tail));
+}
+
+uint8_t UARTS_TxBusy(uarts_ch_t ch)
+{
+    if (ch >= UARTS_CH_COUNT) return 0u;
+    return g_uarts[ch].tx_active;
+}
+
+uint16_t UARTS_Write(uarts_ch_t ch, const uint8_t *data, uint16_t len)
+{
+    if (ch >= UARTS_CH_COUNT || data == NULL) return 0u;
+    uarts_chan_t *c = &g_uarts[ch];
+    if (c->huart->Instance == NULL || c->huart->hdmatx == NULL) return 0u;
+
+    uint16_t free = UARTS_TxFree(ch);
+    if (len > free) len = free;
+    if (c->wide) len &= (uint16_t)~1u;   // nur ganze 9-Bit Zeichen
+    if (len == 0u) return 0u;
+
+    uint16_t off = (uint16_t)(c->tx_head & (UARTS_TX_BUF_SIZE - 1u));
+    uint16_t first = (uint16_t)(UARTS_TX_BUF_SIZE - off);
+    if (first > len) first = len;
+
+    memcpy(&c->tx_buf[off], data, first);
+    if (len > first) {
+        memcpy(&c->tx_buf[0], &data[first], (size_t)(len - first));
+    }
+
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    c->tx_head += len;
+    uarts_tx_kick(c);
+    __set_PRIMASK(primask);
+
+    return len;
+}
+
+void UARTS_ExtTxBegin(uarts_ch_t ch)
+{
+    if (ch >= UARTS_CH_COUNT) return;
+    uarts_chan_t *c = &g_uarts[ch];
+
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    __HAL_UART_DISABLE_IT(c->huart, UART_IT_TC);
+    c->tx_ext = 1u;
+    if (!c->tx_active) {
+        c->tx_active = 1u;
+        c->stats.tx_bursts++;
+        uarts_de_assert(c, 1u);
+    }
+    __set_PRIMASK(primask);
+}
+
+void UARTS_ExtTxEnd(uarts_ch_t ch)
+{
+    if (ch >= UARTS_CH_COUNT) return;
+    uarts_chan_t *c = &g_uarts[ch];
+
+    // TC ist schon gesetzt wenn das letzte Zeichen draussen ist (TDR
+    // Schreiben loescht es) -> Freigabe im naechsten UART IRQ
+    c->tx_ext = 0u;
+    if (c->tx_active) __HAL_UART_ENABLE_IT(c->huart, UART_IT_TC);
+}
+
+void UARTS_SetTxDoneCb(uarts_ch_t ch, uarts_tx_done_cb_t cb)
+{
+    if (ch >= UARTS_CH_COUNT) return;
+    g_uarts[ch].tx_done_cb = cb;
+}
+
+void UARTS_TxAbort(uarts_ch_t ch)
+{
+    if (ch >= UARTS_CH_COUNT) return;
+    uarts_chan_t *c = &g_uarts[ch];
+    UART_HandleTypeDef *huart = c->huart;
+
+    if (huart->Instance == NULL) return;
+
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    __HAL_UART_DISABLE_IT(huart, UART_IT_TC);
+    CLEAR_BIT(huart->Instance->CR3, USART_CR3_DMAT);
+    c->tx_tail = c->tx_head;
+    c->tx_inflight = 0u;
+    __set_PRIMASK(primask);
+
+    if (huart->hdmatx != NULL) {
+        (void)HAL_DMA_Abort(huart->hdmatx);
+    }
+
+    uarts_de_assert(c, 0u);
+    c->tx_ext = 0u;
+    c->tx_active = 0u;
+}
+
+// USART Kernel-Takt nach Prescaler (wie UART_SetConfig, RCCEx kennt
+// USART234578 nicht in HAL_RCCEx_GetPeriphCLKFreq)
+uint32_t UARTS_KernelClock(uarts_ch_t ch)
+{
+    if (ch >= UARTS_CH_COUNT) return 0u;
+    UART_HandleTypeDef *huart = g_uarts[ch].huart;
+    if (huart->Instance == NULL) return 0u;
+
+    UART_ClockSourceTypeDef src = UART_CLOCKSOURCE_UNDEFINED;
+    PLL2_ClocksTypeDef pll2;
+    PLL3_ClocksTypeDef pll3;
+    uint32_t clk = 0u;
+
+    UART_GETCLOCKSOURCE(huart, src);
+    switch (src) {
+        case UART_CLOCKSOURCE_D2PCLK1: clk = HAL_RCC_GetPCLK1Freq(); break;
+        case UART_CLOCKSOURCE_D2PCLK2: clk = HAL_RCC_GetPCLK2Freq(); break;
+        case UART_CLOCKSOURCE_PLL2:
+            HAL_RCCEx_GetPLL2ClockFreq(&pll2);
+            clk = pll2.PLL2_Q_Frequency;
+            break;
+        case UART_CLOCKSOURCE_PLL3:
+            HAL_RCCEx_GetPLL3ClockFreq(&pll3);
+            clk = pll3.PLL3_Q_Frequency;
+            break;
+        case UART_CLOCKSOURCE_HSI:
+            clk = (__HAL_RCC_GET_FLAG(RCC_FLAG_HSIDIV) != 0U)
+                  ? (uint32_t)(HSI_VALUE >> (__HAL_RCC_GET_HSI_DIVIDER() >> 3U))
+                  : (uint32_t)HSI_VALUE;
+            break;
+        case UART_CLOCKSOURCE_CSI: clk = CSI_VALUE; break;
+        case UART_CLOCKSOURCE_LSE: clk = LSE_VALUE; break;
+        default: return 0u;
+    }
+
+    return clk / UARTPrescTable[huart->Init.ClockPrescaler];
+}
+
+// BRR fuer eine Baudrate: OVER16 solange USARTDIV >= 16, sonst OVER8
+// (bis fck/8). Abweichung > 3 % -> Fehler
+static HAL_StatusTypeDef uarts_calc_brr(uint32_t clk, uint32_t baud, uint32_t *brr, uint8_t *over8)
+{
+    if (clk == 0u || baud == 0u) return HAL_ERROR;
+
+    uint32_t div = (clk + baud / 2u) / baud;
+    if (div >= 16u && div <= 0xFFFFu) {
+        *brr = div;
+        *over8 = 0u;
+    } else {
+        div = (2u * clk + baud / 2u) / baud;
+        if (div < 16u || div > 0xFFFFu) return HAL_ERROR;
+        *brr = (div & 0xFFF0u) | ((div & 0x000Fu) >> 1);
+        *over8 = 1u;
+    }
+
+    uint32_t real = (*over8) ? (2u * clk) / div : clk / div;
+    uint32_t diff = (real > baud) ? (real - baud) : (baud - real);
+    return (diff * 100u > baud * 3u) ? HAL_ERROR : HAL_OK;
+}
+
+static uint32_t uarts_real_baud(uarts_chan_t *c, uint32_t clk)
+{
+    USART_TypeDef *u = c->huart->Instance;
+    uint32_t brr = u->BRR;
+
+    if (u->CR1 & USART_CR1_OVER8) {
+        uint32_t div = (brr & 0xFFF0u) | ((brr & 0x0007u) << 1);
+        return (div != 0u) ? (2u * clk) / div : 0u;
+    }
+    return (brr != 0u) ? clk / brr : 0u;
+}
+
+// Register schreiben die nur bei UE = 0 aenderbar sind; TE/RE/DMA bleiben
+static void uarts_write_disabled(USART_TypeDef *u, uint32_t cr1_mask, uint32_t cr1,
+                                 uint32_t cr2_mask, uint32_t cr2, uint32_t brr)
+{
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    CLEAR_BIT(u->CR1, USART_CR1_UE);
+    MODIFY_REG(u->CR1, cr1_mask, cr1);
+    MODIFY_REG(u->CR2, cr2_mask, cr2);
+    if (brr != 0u) u->BRR = brr;
+    SET_BIT(u->CR1, USART_CR1_UE);
+    __set_PRIMASK(primask);
+}
+
+HAL_StatusTypeDef UARTS_SetFifo(uarts_ch_t ch, uint8_t on)
+{
+    if (ch >= UARTS_CH_COUNT || g_uarts[ch].huart->Instance == NULL) return HAL_ERROR;
+    USART_TypeDef *u = g_uarts[ch].huart->Instance;
+
+    // FIFOEN nur bei UE = 0
+    uarts_write_disabled(u, USART_CR1_FIFOEN, on ? USART_CR1_FIFOEN : 0u, 0u, 0u, 0u);
+    g_uarts[ch].huart->FifoMode = on ? UART_FIFOMODE_ENABLE : UART_FIFOMODE_DISABLE;
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef UARTS_SetBaud(uarts_ch_t ch, uint32_t baud)
+{
+    if (ch >= UARTS_CH_COUNT) return HAL_ERROR;
+    uarts_chan_t *c = &g_uarts[ch];
+    UART_HandleTypeDef *huart = c->huart;
+    if (huart->Instance == NULL) return HAL_ERROR;
+
+    uint32_t brr = 0u;
+    uint8_t over8 = 0u;
+    if (uarts_calc_brr(UARTS_KernelClock(ch), baud, &brr, &over8) != HAL_OK) return HAL_ERROR;
+
+    UARTS_TxAbort(ch);
+    uarts_write_disabled(huart->Instance, USART_CR1_OVER8, over8 ? USART_CR1_OVER8 : 0u,
+                         0u, 0u, brr);
+
+    huart->Init.BaudRate = baud;
+    huart->Init.OverSampling = over8 ? UART_OVERSAMPLING_8 : UART_OVERSAMPLING_16;
+    c->line.baud = baud;
+    return HAL_OK;
+}
+
+static void uarts_dma_width(DMA_HandleTypeDef *hdma, uint8_t wide)
+{
+    if (hdma == NULL) return;
+
+    uint32_t palign = wide ? DMA_PDATAALIGN_HALFWORD : DMA_PDATAALIGN_BYTE;
+    if (hdma->Init.PeriphDataAlignment == palign) return;
+
+    hdma->Init.PeriphDataAlignment = palign;
+    hdma->Init.MemDataAlignment = wide ? DMA_MDATAALIGN_HALFWORD : DMA_MDATAALIGN_BYTE;
+    (void)HAL_DMA_Init(hdma);
+}
+
+HAL_StatusTypeDef UARTS_SetLine(uarts_ch_t ch, const uarts_line_t *line)
+{
+    if (ch >= UARTS_CH_COUNT || line == NULL) return HAL_ERROR;
+    uarts_chan_t *c = &g_uarts[ch];
+    UART_HandleTypeDef *huart = c->huart;
+    if (huart->Instance == NULL) return HAL_ERROR;
+
+    // Rahmen = Datenbits + Paritaetsbit, USART kann 7/8/9
+    uint8_t parity_bit = (line->parity == 'N') ? 0u : 1u;
+    uint8_t frame = (uint8_t)(line->data_bits + parity_bit);
+    if (line->parity != 'N' && line->parity != 'E' && line->parity != 'O') return HAL_ERROR;
+    if (frame < 7u || frame > 9u || line->data_bits < 7u) return HAL_ERROR;
+
+    uint32_t cr1 = 0u, wl = UART_WORDLENGTH_8B;
+    if (frame == 7u) { cr1 |= USART_CR1_M1; wl = UART_WORDLENGTH_7B; }
+    if (frame == 9u) { cr1 |= USART_CR1_M0; wl = UART_WORDLENGTH_9B; }
+    if (parity_bit) cr1 |= USART_CR1_PCE;
+    if (line->parity == 'O') cr1 |= USART_CR1_PS;
+
+    uint32_t cr2 = 0u, sb = UART_STOPBITS_1;
+    switch (line->stop) {
+        case UARTS_STOP_1:   break;
+        case UARTS_STOP_1_5: cr2 = USART_CR2_STOP_0 | USART_CR2_STOP_1; sb = UART_STOPBITS_1_5; break;
+        case UARTS_STOP_2:   cr2 = USART_CR2_STOP_1; sb = UART_STOPBITS_2; break;
+        default: return HAL_ERROR;
+    }
+
+    uint32_t brr = 0u;
+    uint8_t over8 = 0u;
+    if (uarts_calc_brr(UARTS_KernelClock(ch), line->baud, &brr, &over8) != HAL_OK) return HAL_ERROR;
+    if (over8) cr1 |= USART_CR1_OVER8;
+
+    // 9 Datenbits ohne Paritaet -> 16 Bit pro Zeichen in den Ringen
+    uint8_t wide = (line->data_bits == 9u) ? 1u : 0u;
+    uint8_t restart = 0u;
+
+    UARTS_TxAbort(ch);
+    if (wide != c->wide) {
+        restart = c->running;
+        UARTS_Stop(ch);
+        c->wide = wide;
+        uarts_dma_width(huart->hdmarx, wide);
+        uarts_dma_width(huart->hdmatx, wide);
+        c->tx_head = c->tx_tail = 0u;
+    }
+
+    uarts_write_disabled(huart->Instance,
+                         USART_CR1_M0 | USART_CR1_M1 | USART_CR1_PCE | USART_CR1_PS | USART_CR1_OVER8, cr1,
+                         USART_CR2_STOP, cr2, brr);
+
+    c->strip7 = (line->data_bits == 7u && parity_bit) ? 1u : 0u;
+
+    huart->Init.BaudRate = line->baud;
+    huart->Init.WordLength = wl;
+    huart->Init.StopBits = sb;
+    huart->Init.Parity = !parity_bit ? UART_PARITY_NONE
+                       : (line->parity == 'O') ? UART_PARITY_ODD : UART_PARITY_EVEN;
+    huart->Init.OverSampling = over8 ? UART_OVERSAMPLING_8 : UART_OVERSAMPLING_16;
+    c->line = *line;
+
+    if (restart) return UARTS_Start(ch);
+    return HAL_OK;
+}
+
+void UARTS_GetLine(uarts_ch_t ch, uarts_line_t *line)
+{
+    if (ch >= UARTS_CH_COUNT || line == NULL) return;
+    *line = g_uarts[ch].line;
+}
+
+uint32_t UARTS_GetRealBaud(uarts_ch_t ch)
+{
+    if (ch >= UARTS_CH_COUNT || g_uarts[ch].huart->Instance == NULL) return 0u;
+    return uarts_real_baud(&g_uarts[ch], UARTS_KernelClock(ch));
+}
+
+uint8_t UARTS_IsWide(uarts_ch_t ch)
+{
+    if (ch >= UARTS_CH_COUNT) return 0u;
+    return g_uarts[ch].wide;
+}
+
+HAL_StatusTypeDef UARTS_AutoBaudStart(uarts_ch_t ch, uint8_t mode)
+{
+    if (ch >= UARTS_CH_COUNT || mode > 3u) return HAL_ERROR;
+    uarts_chan_t *c = &g_uarts[ch];
+    USART_TypeDef *u = c->huart->Instance;
+    if (u == NULL) return HAL_ERROR;
+
+    UARTS_TxAbort(ch);
+    uarts_write_disabled(u, 0u, 0u, USART_CR2_ABREN | USART_CR2_ABRMODE,
+                         USART_CR2_ABREN | ((uint32_t)mode << USART_CR2_ABRMODE_Pos), 0u);
+    u->RQR = USART_RQR_ABRRQ;      // ABRF/ABRE loeschen, neue Messung
+    c->abr_active = 1u;
+    return HAL_OK;
+}
+
+int8_t UARTS_AutoBaudPoll(uarts_ch_t ch, uint32_t *baud)
+{
+    if (ch >= UARTS_CH_COUNT) return -1;
+    uarts_chan_t *c = &g_uarts[ch];
+    USART_TypeDef *u = c->huart->Instance;
+    if (!c->abr_active || u == NULL) return -1;
+
+    uint32_t isr = u->ISR;
+    if (!(isr & (USART_ISR_ABRF | USART_ISR_ABRE))) return 0;
+
+    if (isr & USART_ISR_ABRE) {
+        UARTS_AutoBaudCancel(ch);
+        return -1;
+    }
+
+    // BRR ist gesetzt; ABREN wieder aus, sonst misst jedes Startbit neu
+    uarts_write_disabled(u, 0u, 0u, USART_CR2_ABREN, 0u, 0u);
+    c->abr_active = 0u;
+
+    uint32_t real = uarts_real_baud(c, UARTS_KernelClock(ch));
+    c->line.baud = real;
+    c->huart->Init.BaudRate = real;
+    if (baud) *baud = real;
+    return 1;
+}
+
+void UARTS_AutoBaudCancel(uarts_ch_t ch)
+{
+    if (ch >= UARTS_CH_COUNT) return;
+    uarts_chan_t *c = &g_uarts[ch];
+    if (!c->abr_active) return;
+
+    c->abr_active = 0u;
+    uarts_write_disabled(c->huart->Instance, 0u, 0u, USART_CR2_ABREN, 0u, 0u);
+    // Messung evtl. halb fertig -> BRR der letzten Einstellung zurueck
+    (void)UARTS_SetBaud(ch, c->line.baud);
+}
+
+uint8_t UARTS_HasHwDe(uarts_ch_t ch)
+{
+    if (ch >= UARTS_CH_COUNT) return 0u;
+    return g_uarts[ch].hw_de;
+}
+
+HAL_StatusTypeDef UARTS_SetDeTiming(uarts_ch_t ch, uint8_t assert_t, uint8_t deassert_t)
+{
+    if (ch >= UARTS_CH_COUNT || !g_uarts[ch].hw_de) return HAL_ERROR;
+    if (assert_t > 31u || deassert_t > 31u) return HAL_ERROR;
+
+    USART_TypeDef *u = g_uarts[ch].huart->Instance;
+    if (u == NULL) return HAL_ERROR;
+
+    g_uarts[ch].de_at = assert_t;
+    g_uarts[ch].de_dt = deassert_t;
+
+    // DEM/DEAT/DEDT nur bei UE = 0 beschreibbar
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    CLEAR_BIT(u->CR1, USART_CR1_UE);
+    CLEAR_BIT(u->CR3, USART_CR3_DEP);
+    SET_BIT(u->CR3, USART_CR3_DEM);
+    MODIFY_REG(u->CR1, USART_CR1_DEAT | USART_CR1_DEDT,
+               ((uint32_t)assert_t << USART_CR1_DEAT_Pos) |
+               ((uint32_t)deassert_t << USART_CR1_DEDT_Pos));
+    SET_BIT(u->CR1, USART_CR1_UE);
+    __set_PRIMASK(primask);
+
+    return HAL_OK;
+}
+
+void UARTS_GetDeTiming(uarts_ch_t ch, uint8_t *assert_t, uint8_t *deassert_t)
+{
+    if (ch >= UARTS_CH_COUNT) return;
+    if (assert_t) *assert_t = g_uarts[ch].de_at;
+    if (deassert_t) *deassert_t = g_uarts[ch].de_dt;
+}
+
+uint16_t UARTS_RxAvailable(uarts_ch_t ch)
+{
+    if (ch >= UARTS_CH_COUNT) return 0u;
+    uarts_chan_t *c = &g_uarts[ch];
+
+    uarts_update_head_locked(c);
+    return (uint16_t)(c->rx_head - c->rx_tail);
+}
+
+uint16_t UARTS_RxPeek(uarts_ch_t ch, const uint8_t **data)
+{
+    if (ch >= UARTS_CH_COUNT) return 0u;
+    uarts_chan_t *c = &g_uarts[ch];
+
+    uint16_t avail = UARTS_RxAvailable(ch);
+    uint16_t off = (uint16_t)(c->rx_tail & (UARTS_RX_BUF_SIZE - 1u));
+    uint16_t span = (uint16_t)(UARTS_RX_BUF_SIZE - off);
+    if (span > avail) span = avail;
+
+    if (data) *data = &c->rx_buf[off];
+    return span;
+}
+
+void UARTS_RxConsume(uarts_ch_t ch, uint16_t len)
+{
+    if (ch >= UARTS_CH_COUNT) return;
+    uarts_chan_t *c = &g_uarts[ch];
+
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    uint32_t fill = c->rx_head - c->rx_tail;
+    c->rx_tail += (len > fill) ? fill : len;
+    __set_PRIMASK(primask);
+}
+
+uint16_t UARTS_Read(uarts_ch_t ch, uint8_t *dst, uint16_t max)
+{
+    uint16_t done = 0u;
+
+    while (done < max) {
+        const uint8_t *p = NULL;
+        uint16_t n = UARTS_RxPeek(ch, &p);
+        if (n == 0u) break;
+        if (n > (uint16_t)(max - done)) n = (uint16_t)(max - done);
+        memcpy(&dst[done], p, n);
+        UARTS_RxConsume(ch, n);
+        done = (uint16_t)(done + n);
+    }
+    return done;
+}
+
+void UARTS_RxFlush(uarts_ch_t ch)
+{
+    if (ch >= UARTS_CH_COUNT) return;
+    uarts_chan_t *c = &g_uarts[ch];
+
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    uarts_update_head(c);
+    c->rx_tail = c->rx_head;
+    __set_PRIMASK(primask);
+}
+
+uint32_t UARTS_RxPos(uarts_ch_t ch)
+{
+    if (ch >= UARTS_CH_COUNT) return 0u;
+    return g_uarts[ch].rx_tail;
+}
+
+void UARTS_SetRxTap(uarts_ch_t ch, uarts_rx_tap_t tap)
+{
+    if (ch >= UARTS_CH_COUNT) return;
+    g_uarts[ch].rx_tap = tap;
+}
+
+const uint8_t *UARTS_RxBuf(uarts_ch_t ch)
+{
+    if (ch >= UARTS_CH_COUNT) return NULL;
+    return g_uarts[ch].rx_buf;
+}
+
+void UARTS_SetRxEventCb(uarts_ch_t ch, uarts_rx_event_cb_t cb)
+{
+    if (ch >= UARTS_CH_COUNT) return;
+    g_uarts[ch].rx_event_cb = cb;
+}
+
+HAL_StatusTypeDef UARTS_SetLin(uarts_ch_t ch, uint8_t on)
+{
+    if (ch >= UARTS_CH_COUNT) return HAL_ERROR;
+    uarts_chan_t *c = &g_uarts[ch];
+    UART_HandleTypeDef *huart = c->huart;
+    if (huart->Instance == NULL) return HAL_ERROR;
+
+    // LIN verlangt 8 Datenbits, keine Paritaet, 1 Stoppbit
+    if (on && (c->line.data_bits != 8u || c->line.parity != 'N' || c->line.stop != UARTS_STOP_1)) {
+        return HAL_ERROR;
+    }
+
+    uint32_t lin = USART_CR2_LINEN | USART_CR2_LBDL | USART_CR2_LBDIE;
+    uarts_write_disabled(huart->Instance, 0u, 0u,
+                         lin | USART_CR2_CLKEN, on ? lin : 0u, 0u);
+    __HAL_UART_CLEAR_FLAG(huart, UART_CLEAR_LBDF);
+    return HAL_OK;
+}
+
+uint8_t UARTS_IsLin(uarts_ch_t ch)
+{
+    if (ch >= UARTS_CH_COUNT || g_uarts[ch].huart->Instance == NULL) return 0u;
+    return READ_BIT(g_uarts[ch].huart->Instance->CR2, USART_CR2_LINEN) ? 1u : 0u;
+}
+
+void UARTS_SendBreak(uarts_ch_t ch)
+{
+    if (ch >= UARTS_CH_COUNT) return;
+    uarts_chan_t *c = &g_uarts[ch];
+    UART_HandleTypeDef *huart = c->huart;
+    if (huart->Instance == NULL) return;
+
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    if (!c->tx_active) {
+        c->tx_active = 1u;
+        c->stats.tx_bursts++;
+        uarts_de_assert(c, 1u);
+    }
+    __HAL_UART_SEND_REQ(huart, UART_SENDBREAK_REQUEST);
+    // ohne nachfolgende Bytes gibt der TC Interrupt DE wieder frei
+    if (c->tx_inflight == 0u && c->tx_head == c->tx_tail) {
+        __HAL_UART_CLEAR_FLAG(huart, UART_CLEAR_TCF);
+        __HAL_UART_ENABLE_IT(huart, UART_IT_TC);
+    }
+    __set_PRIMASK(primask);
+}
+
+const uarts_stats_t *UARTS_GetStats(uarts_ch_t ch)
+{
+    if (ch >= UARTS_CH_COUNT) return NULL;
+    return &g_uarts[ch].stats;
+}
+
+void UARTS_ResetStats(uarts_ch_t ch)
+{
+    if (ch >= UARTS_CH_COUNT) return;
+    memset(&g_uarts[ch].stats, 0, sizeof(g_uarts[ch].stats));
+}
+
+void UARTS_IRQHandler(uarts_ch_t ch)
+{
+    if (ch >= UARTS_CH_COUNT) return;
+    uarts_chan_t *c = &g_uarts[ch];
+    USART_TypeDef *u = c->huart->Instance;
+
+    uint32_t isr = u->ISR;
+    uint32_t cr1 = u->CR1;
+
+    // Fehler nur zaehlen, DMA laeuft weiter (CR3.DDRE = 0)
+    if (isr & USART_ISR_ORE) { u->ICR = USART_ICR_ORECF; c->stats.ore++; }
+    if (isr & USART_ISR_FE)  { u->ICR = USART_ICR_FECF;  c->stats.fe++; }
+    if (isr & USART_ISR_NE)  { u->ICR = USART_ICR_NECF;  c->stats.ne++; }
+    if (isr & USART_ISR_PE)  { u->ICR = USART_ICR_PECF;  c->stats.pe++; }
+
+    if ((isr & USART_ISR_IDLE) && (cr1 & USART_CR1_IDLEIE)) {
+        u->ICR = USART_ICR_IDLECF;
+        c->stats.idle++;
+        uarts_update_head(c);
+        if (c->rx_event_cb) c->rx_event_cb((uarts_ch_t)ch, UARTS_EV_IDLE, c->rx_head);
+    }
+
+    if ((isr & USART_ISR_RTOF) && (cr1 & USART_CR1_RTOIE)) {
+        u->ICR = USART_ICR_RTOCF;
+        c->stats.rto++;
+        uarts_update_head(c);
+        if (c->rx_event_cb) c->rx_event_cb((uarts_ch_t)ch, UARTS_EV_RTO, c->rx_head);
+    }
+
+    if ((isr & USART_ISR_LBDF) && (u->CR2 & USART_CR2_LBDIE)) {
+        u->ICR = USART_ICR_LBDCF;
+        c->stats.brk++;
+        uarts_update_head(c);
+        if (c->rx_event_cb) c->rx_event_cb((uarts_ch_t)ch, UARTS_EV_BREAK, c->rx_head);
+    }
+
+    // letztes Stoppbit draussen -> Treiber abschalten
+    if ((isr & USART_ISR_TC) && (cr1 & USART_CR1_TCIE)) {
+        __HAL_UART_DISABLE_IT(c->huart, UART_IT_TC);
+        if (c->tx_head != c->tx_tail) {
+            u->ICR = USART_ICR_TCCF;
+            uarts_tx_kick(c);        // waehrend TC-Wartezeit nachgeschoben
+        } else if (!c->tx_ext) {
+            // bei tx_ext bleibt TC stehen, UARTS_ExtTxEnd gibt frei
+            u->ICR = USART_ICR_TCCF;
+            uarts_de_assert(c, 0u);
+            c->tx_active = 0u;
+            if (c->tx_done_cb) c->tx_done_cb((uarts_ch_t)ch);
+        }
+    }
+}
+
+// DMA Half/Complete (Circular) -> nur Schreibzeiger nachziehen
+void HAL_UART_RxHalfCpltCallback(UART_HandleTypeDef *huart)
+{
+    uarts_chan_t *c = uarts_from_handle(huart);
+    if (c) uarts_update_head(c);
+}
+
+void HAL_UART_RxCpltCallback(UART_HandleTypeDef *huart)
+{
+    uarts_chan_t *c = uarts_from_handle(huart);
+    if (c) uarts_update_head(c);
+}
@@ -0,0 +1,541 @@
+/*
+ * uart_trace.c
+ *
+ *  Timestamped two-channel receive sniffer (UART4 + UART8).
+ */
+#include "uart_trace.h"
+#include "uart_stream.h"
+#include "usb_stream.h"
+#include "main.h"
+#include "tim.h"
+#include "cli.h"
+#include <string.h>
+#include <stdio.h>
+
+// ============================================================
+// UART TRACE
+//
+// - Beide UARTs laufen ueber uart_stream.c (Circular DMA), es gibt also
+//   keinen Interrupt pro Byte; Zeitstempel gibt es pro Burst:
+//     * Start: EXTI Falling Edge auf dem RX Pin, wird nach jedem Burst
+//       neu scharf geschaltet und stempelt das erste Startbit (TIM2, 1 us)
+//     * Ende:  USART Receiver Timeout = Gap, Stempel im RTO Interrupt
+//       minus Gap = Ende Stoppbit des letzten Zeichens
+// - Bursts laenger als UTRACE_REC_MAX werden in Records geteilt
+//   (UTRACE_F_CONT), ohne auf das Burst-Ende zu warten
+// - Ausgabe ueber usb_stream.c, ein Record wird nur geschrieben wenn er
+//   komplett passt; sonst bleiben die Bytes im RX Ring (Verlust erst wenn
+//   der 4 KB Ring ueberlaeuft, dann UTRACE_F_LOST)
+// - Event Queue voll: Burst-Grenze geht verloren, die Bytes landen im
+//   naechsten Record, der dafuer UTRACE_F_LOST traegt
+// - Records beider Kanaele zeitlich sortiert (kleinster t_start zuerst)
+// ============================================================
+
+#define UTRACE_POLL_RECORDS   (8u)
+#define UTRACE_HEX_LINE_MAX   (48u)
+
+typedef struct {
+    uint32_t head;         // absoluter RX Schreibzeiger am Burst-Ende
+    uint32_t t_start;
+    uint32_t t_end;
+    uint8_t flags;
+} utrace_ev_t;
+
+typedef struct {
+    GPIO_TypeDef *port;
+    uint32_t port_idx;     // SYSCFG EXTICR Wert (A = 0, B = 1, ...)
+    uint16_t pin;
+    IRQn_Type irq;
+} utrace_pin_t;
+
+typedef struct {
+    volatile utrace_ev_t evq[UTRACE_EVQ_SIZE];
+    volatile uint8_t evq_head;
+    volatile uint8_t evq_tail;
+    volatile uint32_t t_first;     // EXTI Stempel des aktuellen Bursts
+    volatile uint8_t first_valid;
+    uint32_t last_head;            // ISR: Burst-Ende davor
+    uint32_t err_seen;             // ISR: FE+PE+NE+ORE beim letzten Burst
+    uint32_t rto_us;
+    uint32_t char_q4;              // Zeichenzeit in 1/16 us
+    uint8_t wide;
+    uint8_t open;                  // Burst teilweise ausgegeben
+    uint32_t t_next;               // t_start des naechsten Teil-Records
+    uint32_t lost_seen;            // uarts rx_lost beim letzten Record
+    uint32_t bursts;
+    uint32_t bytes;
+    uint32_t evq_lost;
+    uint8_t evq_lost_pending;      // ISR: naechster Record bekommt F_LOST
+} utrace_chan_t;
+
+static const utrace_pin_t g_utrace_pin[UARTS_CH_COUNT] = {
+    { UART_RX_GPIO_Port, 2u, UART_RX_Pin, EXTI15_10_IRQn },   // PC11 UART4_RX
+    { GPIOJ,             9u, GPIO_PIN_9,  EXTI9_5_IRQn },     // PJ9  UART8_RX
+};
+
+static utrace_chan_t g_utrace[UARTS_CH_COUNT];
+static uint8_t g_utrace_active = 0u;
+static uint32_t g_utrace_gap_us = UTRACE_GAP_DEF_US;
+static utrace_fmt_t g_utrace_fmt = UTRACE_FMT_HEX;
+static uint32_t g_utrace_last_end = 0u;       // fuer die Gap-Spalte (hex)
+static uint8_t g_utrace_last_valid = 0u;
+static uint32_t g_utrace_usb_wait = 0u;
+static volatile utrace_hook_t g_utrace_hook = NULL;
+static volatile uint8_t g_utrace_capture = 1u;
+static uint32_t g_utrace_skipped = 0u;
+
+static uint8_t utrace_line_of(uint16_t pin)
+{
+    return (uint8_t)__builtin_ctz(pin);
+}
+
+static void utrace_exti_arm(uarts_ch_t ch)
+{
+    uint32_t bit = g_utrace_pin[ch].pin;
+    EXTI->PR1 = bit;
+    SET_BIT(EXTI->IMR1, bit);
+}
+
+static void utrace_exti_setup(uarts_ch_t ch, uint8_t on)
+{
+    const utrace_pin_t *p = &g_utrace_pin[ch];
+    uint8_t line = utrace_line_of(p->pin);
+    uint32_t shift = (uint32_t)(line & 3u) * 4u;
+
+    CLEAR_BIT(EXTI->IMR1, p->pin);
+    if (!on) {
+        CLEAR_BIT(EXTI->FTSR1, p->pin);
+        return;
+    }
+
+    // Pin bleibt im AF Mode, EXTI sieht trotzdem den Eingang
+    __HAL_RCC_SYSCFG_CLK_ENABLE();
+    MODIFY_REG(SYSCFG->EXTICR[line >> 2], 0xFu << shift, p->port_idx << shift);
+    CLEAR_BIT(EXTI->RTSR1, p->pin);
+    SET_BIT(EXTI->FTSR1, p->pin);
+
+    HAL_NVIC_SetPriority(p->irq, 5, 0);
+    HAL_NVIC_EnableIRQ(p->irq);
+    utrace_exti_arm(ch);
+}
+
+static uint32_t utrace_line_errors(uarts_ch_t ch)
+{
+    const uarts_stats_t *s = UARTS_GetStats(ch);
+    return s->fe + s->pe + s->ne + s->ore;
+}
+
+// UART ISR: Burst-Ende
+static void utrace_rx_event(uarts_ch_t ch, uint8_t ev, uint32_t head)
+{
+    if (ev != UARTS_EV_RTO || ch >= UARTS_CH_COUNT) return;
+    utrace_chan_t *c = &g_utrace[ch];
+
+    uint32_t t_end = TIM_Micros() - c->rto_us;
+    uint32_t n = (head - c->last_head) >> c->wide;
+    uint8_t flags = 0u;
+    uint32_t t_start;
+
+    if (c->first_valid) {
+        t_start = c->t_first;
+        c->first_valid = 0u;
+    } else {
+        t_start = t_end - ((n * c->char_q4) >> 4);
+        flags |= UTRACE_F_EST;
+    }
+
+    uint32_t err = utrace_line_errors(ch);
+    if (err != c->err_seen) {
+        c->err_seen = err;
+        flags |= UTRACE_F_ERR;
+    }
+
+    c->last_head = head;
+    utrace_exti_arm(ch);
+    if (g_utrace_hook) g_utrace_hook((uint8_t)ch, 0u);
+
+    uint8_t next = (uint8_t)((c->evq_head + 1u) % UTRACE_EVQ_SIZE);
+    if (next == c->evq_tail) {
+        // Bytes bleiben im Ring und landen im naechsten Burst
+        c->evq_lost++;
+        c->evq_lost_pending = 1u;
+        return;
+    }
+    if (c->evq_lost_pending) {
+        c->evq_lost_pending = 0u;
+        flags |= UTRACE_F_LOST;
+    }
+    c->evq[c->evq_head].head = head;
+    c->evq[c->evq_head].t_start = t_start;
+    c->evq[c->evq_head].t_end = t_end;
+    c->evq[c->evq_head].flags = flags;
+    c->evq_head = next;
+}
+
+void UTRACE_ExtiIRQHandler(void)
+{
+    uint32_t now = TIM_Micros();
+
+    for (uint8_t i = 0; i < UARTS_CH_COUNT; i++) {
+        uint32_t bit = g_utrace_pin[i].pin;
+        if ((EXTI->PR1 & bit) == 0u) continue;
+
+        EXTI->PR1 = bit;
+        // nur das erste Startbit pro Burst, Rest macht die DMA
+        CLEAR_BIT(EXTI->IMR1, bit);
+        if (g_utrace_active) {
+            g_utrace[i].t_first = now;
+            g_utrace[i].first_valid = 1u;
+            if (g_utrace_hook) g_utrace_hook(i, 1u);
+        }
+    }
+}
+
+static void utrace_timing(uarts_ch_t ch)
+{
+    utrace_chan_t *c = &g_utrace[ch];
+    uarts_line_t line;
+
+    UARTS_GetLine(ch, &line);
+    uint32_t baud = UARTS_GetRealBaud(ch);
+    if (baud == 0u) baud = (line.baud != 0u) ? line.baud : 9600u;
+
+    // Zeichen in halben Bits (1.5 Stoppbits)
+    uint32_t hb = 2u * (1u + line.data_bits + ((line.parity != 'N') ? 1u : 0u)) +
+                  ((line.stop == UARTS_STOP_2) ? 4u : (line.stop == UARTS_STOP_1_5) ? 3u : 2u);
+
+    uint32_t rto_bits = (uint32_t)(((uint64_t)g_utrace_gap_us * baud + 500000u) / 1000000u);
+    if (rto_bits == 0u) rto_bits = 1u;
+    if (rto_bits > USART_RTOR_RTO) rto_bits = USART_RTOR_RTO;
+
+    c->rto_us = (uint32_t)(((uint64_t)rto_bits * 1000000u) / baud);
+    c->char_q4 = (uint32_t)(((uint64_t)hb * 8000000u) / baud);
+    c->wide = UARTS_IsWide(ch);
+    UARTS_SetRxTimeout(ch, rto_bits);
+}
+
+HAL_StatusTypeDef UTRACE_Start(void)
+{
+    UTRACE_Stop();
+
+    for (uint8_t i = 0; i < UARTS_CH_COUNT; i++) {
+        uarts_ch_t ch = (uarts_ch_t)i;
+        if (!UARTS_IsRunning(ch) && UARTS_Start(ch) != HAL_OK) {
+            for (uint8_t k = 0; k < i; k++) UARTS_SetRxEventCb((uarts_ch_t)k, NULL);
+            return HAL_ERROR;
+        }
+
+        utrace_chan_t *c = &g_utrace[ch];
+        UARTS_SetRxEventCb(ch, NULL);
+        UARTS_RxFlush(ch);
+
+        c->evq_head = 0u;
+        c->evq_tail = 0u;
+        c->evq_lost_pending = 0u;
+        c->first_valid = 0u;
+        c->open = 0u;
+        c->last_head = UARTS_RxPos(ch);
+        c->err_seen = utrace_line_errors(ch);
+        c->lost_seen = UARTS_GetStats(ch)->rx_lost;
+        utrace_timing(ch);
+
+        UARTS_SetRxEventCb(ch, utrace_rx_event);
+    }
+
+    g_utrace_last_valid = 0u;
+    g_utrace_active = 1u;
+    for (uint8_t i = 0; i < UARTS_CH_COUNT; i++) {
+        utrace_exti_setup((uarts_ch_t)i, 1u);
+    }
+    return HAL_OK;
+}
+
+void UTRACE_Stop(void)
+{
+    if (!g_utrace_active) return;
+
+    for (uint8_t i = 0; i < UARTS_CH_COUNT; i++) {
+        uarts_ch_t ch = (uarts_ch_t)i;
+        utrace_exti_setup(ch, 0u);
+        UARTS_SetRxEventCb(ch, NULL);
+        UARTS_SetRxTimeout(ch, UARTS_RTO_BITS_DEF);
+    }
+    HAL_NVIC_DisableIRQ(EXTI9_5_IRQn);
+    HAL_NVIC_DisableIRQ(EXTI15_10_IRQn);
+    g_utrace_hook = NULL;
+    g_utrace_active = 0u;
+}
+
+uint8_t UTRACE_IsActive(void)
+{
+    return g_utrace_active;
+}
+
+HAL_StatusTypeDef UTRACE_SetGap(uint32_t gap_us)
+{
+    if (gap_us == 0u || gap_us > 1000000u) return HAL_ERROR;
+    g_utrace_gap_us = gap_us;
+    UTRACE_UpdateTiming();
+    return HAL_OK;
+}
+
+uint32_t UTRACE_GetGap(void)
+{
+    return g_utrace_gap_us;
+}
+
+void UTRACE_SetFormat(utrace_fmt_t fmt)
+{
+    g_utrace_fmt = fmt;
+}
+
+void UTRACE_SetCapture(uint8_t on)
+{
+    g_utrace_capture = on ? 1u : 0u;
+}
+
+uint8_t UTRACE_GetCapture(void)
+{
+    return g_utrace_capture;
+}
+
+void UTRACE_SetHook(utrace_hook_t hook)
+{
+    g_utrace_hook = hook;
+}
+
+utrace_fmt_t UTRACE_GetFormat(void)
+{
+    return g_utrace_fmt;
+}
+
+void UTRACE_UpdateTiming(void)
+{
+    if (!g_utrace_active) return;
+    for (uint8_t i = 0; i < UARTS_CH_COUNT; i++) {
+        utrace_timing((uarts_ch_t)i);
+    }
+}
+
+static uint16_t utrace_record_size(uint16_t n, uint8_t wide)
+{
+    if (g_utrace_fmt == UTRACE_FMT_BIN) return (uint16_t)(UTRACE_HDR_LEN + n);
+    // Kopf + "HH " bzw. "HHH " pro Zeichen + CRLF
+    return (uint16_t)(UTRACE_HEX_LINE_MAX + (wide ? (n / 2u) * 4u : n * 3u) + 2u);
+}
+
+static void utrace_put_le32(uint8_t *p, uint32_t v)
+{
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+    p[2] = (uint8_t)(v >> 16);
+    p[3] = (uint8_t)(v >> 24);
+}
+
+static const char *utrace_flag_str(uint8_t flags, char *buf)
+{
+    uint8_t k = 0u;
+    if (flags & UTRACE_F_CONT) buf[k++] = 'C';
+    if (flags & UTRACE_F_ERR)  buf[k++] = 'E';
+    if (flags & UTRACE_F_EST)  buf[k++] = 'S';
+    if (flags & UTRACE_F_LOST) buf[k++] = 'L';
+    if (k == 0u) buf[k++] = '-';
+    buf[k] = '\0';
+    return buf;
+}
+
+// n Bytes ab Lesezeiger als Record ausgeben und verbrauchen
+static void utrace_emit(uarts_ch_t ch, uint16_t n, uint32_t t_start, uint32_t t_end, uint8_t flags)
+{
+    utrace_chan_t *c = &g_utrace[ch];
+
+    uint32_t lost = UARTS_GetStats(ch)->rx_lost;
+    if (lost != c->lost_seen) {
+        c->lost_seen = lost;
+        flags |= UTRACE_F_LOST;
+    }
+
+    if (g_utrace_fmt == UTRACE_FMT_BIN) {
+        uint8_t hdr[UTRACE_HDR_LEN];
+        hdr[0] = UTRACE_SYNC;
+        hdr[1] = (uint8_t)((uint8_t)ch | flags);
+        utrace_put_le32(&hdr[2], t_start);
+        utrace_put_le32(&hdr[6], t_end);
+        hdr[10] = (uint8_t)n;
+        hdr[11] = (uint8_t)(n >> 8);
+        (void)USBS_Write(hdr, UTRACE_HDR_LEN);
+
+        uint16_t left = n;
+        while (left != 0u) {
+            const uint8_t *p = NULL;
+            uint16_t k = UARTS_RxPeek(ch, &p);
+            if (k == 0u) break;
+            if (k > left) k = left;
+            (void)USBS_Write(p, k);
+            UARTS_RxConsume(ch, k);
+            left = (uint16_t)(left - k);
+        }
+    } else {
+        char line[UTRACE_HEX_LINE_MAX];
+        char fs[6];
+        int32_t gap = g_utrace_last_valid ? (int32_t)(t_start - g_utrace_last_end) : 0;
+
+        int len = snprintf(line, sizeof(line), "U%c %10lu %+7ld %6lu %4u %-4s",
+                           (ch == UARTS_CH_UART4) ? '4' : '8', (unsigned long)t_start,
+                           (long)gap, (unsigned long)(t_end - t_start),
+                           (unsigned)(n >> c->wide), utrace_flag_str(flags, fs));
+        (void)USBS_Write((const uint8_t *)line, (uint16_t)len);
+
+        uint16_t left = n;
+        while (left != 0u) {
+            const uint8_t *p = NULL;
+            uint16_t k = UARTS_RxPeek(ch, &p);
+            if (k == 0u) break;
+            if (k > left) k = left;
+            if (c->wide) k &= (uint16_t)~1u;
+            if (k == 0u) {
+                // 9 Bit Zeichen ueber das Ringende
+                uint8_t w[2];
+                (void)UARTS_Read(ch, w, 2u);
+                len = snprintf(line, sizeof(line), " %03X", (unsigned)(w[0] | ((w[1] & 1u) << 8)));
+                (void)USBS_Write((const uint8_t *)line, (uint16_t)len);
+                left = (uint16_t)(left - 2u);
+                continue;
+            }
+            for (uint16_t i = 0; i < k; i += (uint16_t)(1u + c->wide)) {
+                if (c->wide) {
+                    len = snprintf(line, sizeof(line), " %03X", (unsigned)(p[i] | ((p[i + 1u] & 1u) << 8)));
+                } else {
+                    len = snprintf(line, sizeof(line), " %02X", p[i]);
+                }
+                (void)USBS_Write((const uint8_t *)line, (uint16_t)len);
+            }
+            UARTS_RxConsume(ch, k);
+            left = (uint16_t)(left - k);
+        }
+        (void)USBS_Write((const uint8_t *)"\r\n", 2u);
+    }
+
+    if (!(flags & UTRACE_F_CONT)) {
+        c->bursts++;
+        g_utrace_last_end = t_end;
+        g_utrace_last_valid = 1u;
+    }
+    c->bytes += n;
+}
+
+// naechsten Record eines Kanals vorbereiten; 0 = nichts faellig
+static uint8_t utrace_next(uarts_ch_t ch, uint16_t *n, uint32_t *t_start, uint32_t *t_end, uint8_t *flags)
+{
+    utrace_chan_t *c = &g_utrace[ch];
+    uint32_t pos = UARTS_RxPos(ch);
+
+    if (c->evq_tail != c->evq_head) {
+        const volatile utrace_ev_t *ev = &c->evq[c->evq_tail];
+        int32_t rem = (int32_t)(ev->head - pos);
+        if (rem < 0) rem = 0;                      // Ring ueberlaufen
+
+        // F_LOST nur am ersten Record des Bursts
+        uint8_t evf = c->open ? (uint8_t)(ev->flags & ~UTRACE_F_LOST) : ev->flags;
+        *t_start = c->open ? c->t_next : ev->t_start;
+        if ((uint32_t)rem > UTRACE_REC_MAX) {
+            *n = UTRACE_REC_MAX;
+            *t_end = *t_start + ((((uint32_t)UTRACE_REC_MAX >> c->wide) * c->char_q4) >> 4);
+            *flags = (uint8_t)(UTRACE_F_CONT | (evf & (UTRACE_F_EST | UTRACE_F_LOST)));
+        } else {
+            *n = (uint16_t)rem;
+            *t_end = ev->t_end;
+            *flags = evf;
+        }
+        return 1u;
+    }
+
+    // langer Burst ohne Ende: Teil-Record sobald ein voller Block da ist
+    if (UARTS_RxAvailable(ch) < UTRACE_REC_MAX) return 0u;
+
+    if (c->open) {
+        *t_start = c->t_next;
+        *flags = UTRACE_F_CONT;
+    } else if (c->first_valid) {
+        *t_start = c->t_first;
+        *flags = UTRACE_F_CONT;
+    } else {
+        uint32_t avail = UARTS_RxAvailable(ch);
+        *t_start = TIM_Micros() - (((avail >> c->wide) * c->char_q4) >> 4);
+        *flags = (uint8_t)(UTRACE_F_CONT | UTRACE_F_EST);
+    }
+    *n = UTRACE_REC_MAX;
+    *t_end = *t_start + ((((uint32_t)UTRACE_REC_MAX >> c->wide) * c->char_q4) >> 4);
+    return 1u;
+}
+
+void UTRACE_Poll(void)
+{
+    if (!g_utrace_active) return;
+
+    for (uint8_t r = 0; r < UTRACE_POLL_RECORDS; r++) {
+        uint16_t n[UARTS_CH_COUNT];
+        uint32_t ts[UARTS_CH_COUNT], te[UARTS_CH_COUNT];
+        uint8_t fl[UARTS_CH_COUNT];
+        int8_t pick = -1;
+
+        for (uint8_t i = 0; i < UARTS_CH_COUNT; i++) {
+            if (!utrace_next((uarts_ch_t)i, &n[i], &ts[i], &te[i], &fl[i])) continue;
+            if (pick < 0 || (int32_t)(ts[i] - ts[(uint8_t)pick]) < 0) pick = (int8_t)i;
+        }
+        if (pick < 0) break;
+
+        uarts_ch_t ch = (uarts_ch_t)pick;
+        utrace_chan_t *c = &g_utrace[ch];
+
+        if (!g_utrace_capture) {
+            UARTS_RxConsume(ch, n[ch]);
+            g_utrace_skipped++;
+        } else {
+            if (USBS_Free() < utrace_record_size(n[ch], c->wide)) {
+                g_utrace_usb_wait++;
+                break;
+            }
+            utrace_emit(ch, n[ch], ts[ch], te[ch], fl[ch]);
+        }
+
+        if (fl[ch] & UTRACE_F_CONT) {
+            c->open = 1u;
+            c->t_next = te[ch];
+        } else {
+            c->open = 0u;
+            c->evq_tail = (uint8_t)((c->evq_tail + 1u) % UTRACE_EVQ_SIZE);
+        }
+    }
+
+    USBS_Poll();
+}
+
+void UTRACE_PrintStats(void)
+{
+    cli_printf("\r\nTrace: %s  gap=%lu us  fmt=%s\r\n",
+               g_utrace_active ? "aktiv" : "aus", (unsigned long)g_utrace_gap_us,
+               (g_utrace_fmt == UTRACE_FMT_BIN) ? "bin" : "hex");
+    for (uint8_t i = 0; i < UARTS_CH_COUNT; i++) {
+        const utrace_chan_t *c = &g_utrace[i];
+        const uarts_stats_t *s = UARTS_GetStats((uarts_ch_t)i);
+        cli_printf("  %s: bursts=%lu bytes=%lu rto=%lu us rx_lost=%lu evq_lost=%lu err=%lu\r\n",
+                   (i == UARTS_CH_UART4) ? "UART4" : "UART8",
+                   (unsigned long)c->bursts, (unsigned long)c->bytes, (unsigned long)c->rto_us,
+                   (unsigned long)s->rx_lost, (unsigned long)c->evq_lost,
+                   (unsigned long)(s->fe + s->pe + s->ne + s->ore));
+    }
+    cli_printf("  capture=%s skipped=%lu usb_wait=%lu\r\n", g_utrace_capture ? "an" : "aus",
+               (unsigned long)g_utrace_skipped, (unsigned long)g_utrace_usb_wait);
+}
+
+void UTRACE_ResetStats(void)
+{
+    for (uint8_t i = 0; i < UARTS_CH_COUNT; i++) {
+        g_utrace[i].bursts = 0u;
+        g_utrace[i].bytes = 0u;
+        g_utrace[i].evq_lost = 0u;
+    }
+    g_utrace_usb_wait = 0u;
+    g_utrace_skipped = 0u;
+}
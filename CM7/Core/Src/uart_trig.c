@@ -0,0 +1,397 @@
+/*
+ * uart_trig.c
+ *
+ *  Multi-pattern trigger (Aho-Corasick) on the UART4/UART8 RX streams.
+ */
+#include "uart_trig.h"
+#include "uart_stream.h"
+#include "uart_trace.h"
+#include "usb_stream.h"
+#include "dio_mode.h"
+#include "tim.h"
+#include "cli.h"
+#include <string.h>
+#include <stdio.h>
+
+// ============================================================
+// UART TRIGGER
+//
+// - bis zu 16 Byte-Muster gleichzeitig, ein Aho-Corasick Automat wird
+//   beim Konfigurieren komplett zu einer DFA aufgeloest:
+//     * Bytewerte, die in keinem Muster vorkommen, teilen sich Klasse 0
+//       (fuehrt immer zur Wurzel), die uebrigen bekommen Klassen 1..63
+//     * delta[zustand][klasse] vollstaendig gefuellt (Fail-Links schon
+//       eingerechnet), out[zustand] = Bitmaske aller endenden Muster
+//   -> pro Byte zwei Tabellenzugriffe, kein Backtracking; 3 Mbaud sind
+//      ~300 kB/s, das ist ein kleiner Teil der CPU
+// - Mitlesen ueber den RX Tap von uart_stream.c: jedes Nachziehen des
+//   DMA Schreibzeigers (IDLE, RTO, DMA HT/TC, Superloop) scannt die neuen
+//   Bytes mit eigenem Lesezeiger, der Ring-Leser (Tunnel, Trace, Modbus,
+//   MITM ...) bleibt unberuehrt
+// - Aktionen direkt im Scan (IRQ Kontext): Digital OUT, Trace Ausgabe
+//   an/aus; Log-Eintrag mit TIM2 Stempel + Stream-Position immer,
+//   Notify-Zeilen schreibt erst UTRIG_Poll
+// ============================================================
+
+#define UTRIG_NO_EDGE         (0xFFu)
+#define UTRIG_NOTIFY_MIN_FREE (64u)
+
+typedef struct {
+    uint8_t used;
+    uint8_t chans;
+    uint8_t act;
+    uint8_t do_bit;
+    uint8_t do_val;
+    uint8_t len;
+    uint8_t pat[UTRIG_PAT_LEN_MAX];
+    volatile uint32_t hits;
+} utrig_pat_t;
+
+typedef struct {
+    uint8_t idx;
+    uint8_t ch;
+    uint32_t t_us;
+    uint32_t pos;              // Stream-Position nach dem letzten Musterbyte
+} utrig_ev_t;
+
+typedef struct {
+    const uint8_t *ring;
+    uint32_t pos;              // absolut, naechstes zu scannendes Byte
+    uint8_t state;
+    uint32_t bytes;
+    uint32_t skipped;          // Ring ueberholt den Scan
+} utrig_chan_t;
+
+static utrig_pat_t g_utrig_pat[UTRIG_PAT_MAX];
+static uint8_t g_utrig_delta[UTRIG_STATE_MAX][UTRIG_CLASS_MAX];
+static uint16_t g_utrig_out[UTRIG_STATE_MAX];
+static uint8_t g_utrig_cls[256];
+static uint8_t g_utrig_nstates = 1u;
+static uint8_t g_utrig_ncls = 1u;
+static volatile uint8_t g_utrig_ready = 0u;
+static uint8_t g_utrig_armed = 0u;
+
+static utrig_chan_t g_utrig_ch[UARTS_CH_COUNT];
+static utrig_ev_t g_utrig_log[UTRIG_LOG_SIZE];
+static volatile uint32_t g_utrig_log_head = 0u;
+static uint32_t g_utrig_notify_rd = 0u;
+static uint32_t g_utrig_notify_lost = 0u;
+
+// ---------------- Automat ----------------
+
+static HAL_StatusTypeDef utrig_build(void)
+{
+    static uint8_t fail[UTRIG_STATE_MAX];
+    static uint8_t queue[UTRIG_STATE_MAX];
+    uint8_t qh = 0u, qt = 0u;
+
+    g_utrig_ready = 0u;
+
+    memset(g_utrig_cls, 0, sizeof(g_utrig_cls));
+    g_utrig_ncls = 1u;
+    for (uint8_t i = 0; i < UTRIG_PAT_MAX; i++) {
+        const utrig_pat_t *p = &g_utrig_pat[i];
+        if (!p->used) continue;
+        for (uint8_t k = 0; k < p->len; k++) {
+            if (g_utrig_cls[p->pat[k]] != 0u) continue;
+            if (g_utrig_ncls >= UTRIG_CLASS_MAX) return HAL_ERROR;
+            g_utrig_cls[p->pat[k]] = g_utrig_ncls++;
+        }
+    }
+
+    // Trie
+    memset(g_utrig_delta, UTRIG_NO_EDGE, sizeof(g_utrig_delta));
+    memset(g_utrig_out, 0, sizeof(g_utrig_out));
+    g_utrig_nstates = 1u;
+    for (uint8_t i = 0; i < UTRIG_PAT_MAX; i++) {
+        const utrig_pat_t *p = &g_utrig_pat[i];
+        if (!p->used) continue;
+        uint8_t s = 0u;
+        for (uint8_t k = 0; k < p->len; k++) {
+            uint8_t c = g_utrig_cls[p->pat[k]];
+            if (g_utrig_delta[s][c] == UTRIG_NO_EDGE) {
+                if (g_utrig_nstates >= UTRIG_STATE_MAX) return HAL_ERROR;
+                g_utrig_delta[s][c] = g_utrig_nstates++;
+            }
+            s = g_utrig_delta[s][c];
+        }
+        g_utrig_out[s] |= (uint16_t)(1u << i);
+    }
+
+    // Fail-Links in Breitensuche, fehlende Kanten direkt aufloesen
+    for (uint8_t c = 0; c < g_utrig_ncls; c++) {
+        uint8_t t = g_utrig_delta[0][c];
+        if (t == UTRIG_NO_EDGE) {
+            g_utrig_delta[0][c] = 0u;
+        } else {
+            fail[t] = 0u;
+            queue[qt++] = t;
+        }
+    }
+    while (qh != qt) {
+        uint8_t s = queue[qh++];
+        for (uint8_t c = 0; c < g_utrig_ncls; c++) {
+            uint8_t t = g_utrig_delta[s][c];
+            uint8_t f = g_utrig_delta[fail[s]][c];
+            if (t == UTRIG_NO_EDGE) {
+                g_utrig_delta[s][c] = f;
+            } else {
+                fail[t] = f;
+                g_utrig_out[t] |= g_utrig_out[f];
+                queue[qt++] = t;
+            }
+        }
+    }
+
+    for (uint8_t i = 0; i < UARTS_CH_COUNT; i++) g_utrig_ch[i].state = 0u;
+    g_utrig_ready = (g_utrig_nstates > 1u) ? 1u : 0u;
+    return HAL_OK;
+}
+
+// ---------------- Scan (IRQ Kontext) ----------------
+
+static void utrig_fire(uint8_t ch, uint16_t mask, uint32_t pos)
+{
+    uint32_t now = TIM_Micros();
+
+    for (uint8_t i = 0; i < UTRIG_PAT_MAX; i++) {
+        if (!(mask & (1u << i))) continue;
+        utrig_pat_t *p = &g_utrig_pat[i];
+        if (!(p->chans & (1u << ch))) continue;
+
+        p->hits++;
+        switch (p->act) {
+        case UTRIG_ACT_CAP_START: UTRACE_SetCapture(1u); break;
+        case UTRIG_ACT_CAP_STOP:  UTRACE_SetCapture(0u); break;
+        case UTRIG_ACT_DO:        DIO_WriteOut(p->do_bit, p->do_val); break;
+        default: break;
+        }
+
+        utrig_ev_t *e = &g_utrig_log[g_utrig_log_head % UTRIG_LOG_SIZE];
+        e->idx = i;
+        e->ch = ch;
+        e->t_us = now;
+        e->pos = pos;
+        g_utrig_log_head++;
+    }
+}
+
+static void utrig_tap(uarts_ch_t ch, uint32_t head)
+{
+    utrig_chan_t *c = &g_utrig_ch[ch];
+    uint32_t n = head - c->pos;
+
+    if (!g_utrig_ready || (int32_t)n < 0 || UARTS_IsWide(ch)) {
+        // kein Automat, UART neu gestartet oder 9 Bit
+        c->pos = head;
+        c->state = 0u;
+        return;
+    }
+    if (n > UARTS_RX_BUF_SIZE) {
+        c->skipped += n - UARTS_RX_BUF_SIZE;
+        c->pos = head - UARTS_RX_BUF_SIZE;
+        c->state = 0u;
+    }
+
+    const uint8_t *ring = c->ring;
+    uint32_t pos = c->pos;
+    uint8_t s = c->state;
+
+    c->bytes += head - pos;
+    while (pos != head) {
+        s = g_utrig_delta[s][g_utrig_cls[ring[pos & (UARTS_RX_BUF_SIZE - 1u)]]];
+        pos++;
+        if (g_utrig_out[s] != 0u) utrig_fire((uint8_t)ch, g_utrig_out[s], pos);
+    }
+    c->state = s;
+    c->pos = pos;
+}
+
+// ---------------- Konfiguration ----------------
+
+int UTRIG_Add(uint8_t chans, const uint8_t *pat, uint8_t len, utrig_act_t act,
+              uint8_t do_bit, uint8_t do_val)
+{
+    chans &= (UTRIG_CH_UART4 | UTRIG_CH_UART8);
+    if (chans == 0u || pat == NULL || len == 0u || len > UTRIG_PAT_LEN_MAX ||
+        act > UTRIG_ACT_DO || (act == UTRIG_ACT_DO && (do_bit >= 8u || do_val > 2u))) {
+        return -1;
+    }
+
+    for (uint8_t i = 0; i < UTRIG_PAT_MAX; i++) {
+        utrig_pat_t *p = &g_utrig_pat[i];
+        if (p->used) continue;
+
+        memcpy(p->pat, pat, len);
+        p->len = len;
+        p->chans = chans;
+        p->act = (uint8_t)act;
+        p->do_bit = do_bit;
+        p->do_val = do_val;
+        p->hits = 0u;
+        p->used = 1u;
+        if (utrig_build() != HAL_OK) {
+            // zu viele Zustaende/Bytewerte: Muster wieder raus
+            p->used = 0u;
+            (void)utrig_build();
+            return -1;
+        }
+        return (int)i;
+    }
+    return -1;
+}
+
+HAL_StatusTypeDef UTRIG_Delete(uint8_t idx)
+{
+    if (idx >= UTRIG_PAT_MAX || !g_utrig_pat[idx].used) return HAL_ERROR;
+    g_utrig_pat[idx].used = 0u;
+    return utrig_build();
+}
+
+void UTRIG_Clear(void)
+{
+    memset(g_utrig_pat, 0, sizeof(g_utrig_pat));
+    (void)utrig_build();
+}
+
+HAL_StatusTypeDef UTRIG_Arm(uint8_t on)
+{
+    for (uint8_t i = 0; i < UARTS_CH_COUNT; i++) UARTS_SetRxTap((uarts_ch_t)i, NULL);
+    g_utrig_armed = 0u;
+    if (!on) return HAL_OK;
+
+    for (uint8_t i = 0; i < UARTS_CH_COUNT; i++) {
+        uarts_ch_t ch = (uarts_ch_t)i;
+        utrig_chan_t *c = &g_utrig_ch[i];
+        if (!UARTS_IsRunning(ch) && UARTS_Start(ch) != HAL_OK) {
+            for (uint8_t k = 0; k < i; k++) UARTS_SetRxTap((uarts_ch_t)k, NULL);
+            return HAL_ERROR;
+        }
+        c->ring = UARTS_RxBuf(ch);
+        c->pos = UARTS_RxPos(ch) + UARTS_RxAvailable(ch);
+        c->state = 0u;
+        UARTS_SetRxTap(ch, utrig_tap);
+    }
+    g_utrig_notify_rd = g_utrig_log_head;
+    g_utrig_armed = 1u;
+    return HAL_OK;
+}
+
+uint8_t UTRIG_IsArmed(void)
+{
+    return g_utrig_armed;
+}
+
+// ---------------- Ausgabe ----------------
+
+static const char *utrig_act_str(const utrig_pat_t *p, char *buf, size_t n)
+{
+    switch (p->act) {
+    case UTRIG_ACT_NOTIFY:    return "notify";
+    case UTRIG_ACT_CAP_START: return "start";
+    case UTRIG_ACT_CAP_STOP:  return "stop";
+    case UTRIG_ACT_DO:
+        snprintf(buf, n, "do%u=%c", (unsigned)p->do_bit, (p->do_val == 2u) ? 't' : (char)('0' + p->do_val));
+        return buf;
+    default:                  return "mark";
+    }
+}
+
+static char utrig_ch_char(uint8_t ch)
+{
+    return (ch == UARTS_CH_UART4) ? '4' : '8';
+}
+
+void UTRIG_PrintList(void)
+{
+    char act[8];
+    uint8_t n = 0u;
+
+    cli_printf("\r\n");
+    for (uint8_t i = 0; i < UTRIG_PAT_MAX; i++) {
+        const utrig_pat_t *p = &g_utrig_pat[i];
+        if (!p->used) continue;
+        n++;
+        cli_printf("  #%-2u %-4s %-7s hits=%-6lu \"", (unsigned)i,
+                   (p->chans == (UTRIG_CH_UART4 | UTRIG_CH_UART8)) ? "both" :
+                   (p->chans == UTRIG_CH_UART4) ? "4" : "8",
+                   utrig_act_str(p, act, sizeof(act)), (unsigned long)p->hits);
+        for (uint8_t k = 0; k < p->len; k++) {
+            uint8_t b = p->pat[k];
+            if (b >= 0x20u && b < 0x7Fu && b != '\\' && b != '"') cli_printf("%c", b);
+            else cli_printf("\\x%02X", b);
+        }
+        cli_printf("\"\r\n");
+    }
+    if (n == 0u) cli_printf("  (keine Muster)\r\n");
+}
+
+void UTRIG_PrintLog(void)
+{
+    uint32_t head = g_utrig_log_head;
+    uint32_t n = (head > UTRIG_LOG_SIZE) ? UTRIG_LOG_SIZE : head;
+
+    cli_printf("\r\n");
+    for (uint32_t k = head - n; k != head; k++) {
+        const utrig_ev_t *e = &g_utrig_log[k % UTRIG_LOG_SIZE];
+        cli_printf("  TRIG #%u U%c t=%lu pos=%lu\r\n", (unsigned)e->idx, utrig_ch_char(e->ch),
+                   (unsigned long)e->t_us, (unsigned long)e->pos);
+    }
+    if (n == 0u) cli_printf("  (keine Treffer)\r\n");
+}
+
+void UTRIG_PrintStats(void)
+{
+    cli_printf("\r\nTrigger: %s, %u Zustaende, %u Byteklassen, Trace capture=%s\r\n",
+               g_utrig_armed ? "scharf" : "aus", (unsigned)g_utrig_nstates,
+               (unsigned)g_utrig_ncls, UTRACE_GetCapture() ? "an" : "aus");
+    for (uint8_t i = 0; i < UARTS_CH_COUNT; i++) {
+        cli_printf("  UART%c: bytes=%lu skipped=%lu\r\n", utrig_ch_char(i),
+                   (unsigned long)g_utrig_ch[i].bytes, (unsigned long)g_utrig_ch[i].skipped);
+    }
+    cli_printf("  treffer=%lu notify_lost=%lu\r\n", (unsigned long)g_utrig_log_head,
+               (unsigned long)g_utrig_notify_lost);
+}
+
+void UTRIG_ResetStats(void)
+{
+    for (uint8_t i = 0; i < UARTS_CH_COUNT; i++) {
+        g_utrig_ch[i].bytes = 0u;
+        g_utrig_ch[i].skipped = 0u;
+    }
+    for (uint8_t i = 0; i < UTRIG_PAT_MAX; i++) g_utrig_pat[i].hits = 0u;
+    g_utrig_notify_lost = 0u;
+}
+
+void UTRIG_Poll(uint8_t quiet)
+{
+    if (!g_utrig_armed) return;
+
+    // Schreibzeiger nachziehen -> Scan auch bei Dauerstrom ohne Pause
+    for (uint8_t i = 0; i < UARTS_CH_COUNT; i++) {
+        if (UARTS_IsRunning((uarts_ch_t)i)) (void)UARTS_RxAvailable((uarts_ch_t)i);
+    }
+
+    uint32_t head = g_utrig_log_head;
+    if (head - g_utrig_notify_rd > UTRIG_LOG_SIZE) {
+        g_utrig_notify_lost += head - g_utrig_notify_rd - UTRIG_LOG_SIZE;
+        g_utrig_notify_rd = head - UTRIG_LOG_SIZE;
+    }
+
+    while (g_utrig_notify_rd != head) {
+        const utrig_ev_t *e = &g_utrig_log[g_utrig_notify_rd % UTRIG_LOG_SIZE];
+        if (quiet || g_utrig_pat[e->idx].act != UTRIG_ACT_NOTIFY) {
+            g_utrig_notify_rd++;
+            continue;
+        }
+        if (USBS_Free() < UTRIG_NOTIFY_MIN_FREE) break;
+
+        char line[UTRIG_NOTIFY_MIN_FREE];
+        int len = snprintf(line, sizeof(line), "TRIG #%u U%c t=%lu pos=%lu\r\n",
+                           (unsigned)e->idx, utrig_ch_char(e->ch),
+                           (unsigned long)e->t_us, (unsigned long)e->pos);
+        (void)USBS_Write((const uint8_t *)line, (uint16_t)len);
+        g_utrig_notify_rd++;
+    }
+    USBS_Poll();
+}
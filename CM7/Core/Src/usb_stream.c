@@ -0,0 +1,89 @@
+/*
+ * usb_stream.c
+ *
+ *  Non-blocking bulk output to the USB CDC IN endpoint.
+ */
+#include "usb_stream.h"
+#include "usbd_cdc_if.h"
+#include "stm32h7xx_hal.h"
+#include <string.h>
+
+// ============================================================
+// USB STREAM
+//
+// - TX Ring fuer Datenstroeme (UART Tunnel, Dumps, ...)
+// - USBS_Poll() gibt den naechsten zusammenhaengenden Block direkt aus
+//   dem Ring an CDC_Transmit_HS (keine Kopie, keine 1-Byte Pakete)
+// - Der Block bleibt reserviert bis der CDC IN Transfer fertig ist
+// ============================================================
+
+static uint8_t g_usbs_buf[USBS_TX_BUF_SIZE] __attribute__((aligned(32)));
+static volatile uint32_t g_usbs_head = 0u;   // absolut, geschrieben
+static volatile uint32_t g_usbs_tail = 0u;   // absolut, bestaetigt gesendet
+static uint16_t g_usbs_inflight = 0u;
+
+uint16_t USBS_Pending(void)
+{
+    return (uint16_t)(g_usbs_head - g_usbs_tail);
+}
+
+uint16_t USBS_Free(void)
+{
+    return (uint16_t)(USBS_TX_BUF_SIZE - (g_usbs_head - g_usbs_tail));
+}
+
+uint16_t USBS_Write(const uint8_t *data, uint16_t len)
+{
+    uint16_t free = USBS_Free();
+    if (len > free) len = free;
+
+    uint16_t off = (uint16_t)(g_usbs_head & (USBS_TX_BUF_SIZE - 1u));
+    uint16_t first = (uint16_t)(USBS_TX_BUF_SIZE - off);
+    if (first > len) first = len;
+
+    memcpy(&g_usbs_buf[off], data, first);
+    if (len > first) {
+        memcpy(&g_usbs_buf[0], &data[first], (size_t)(len - first));
+    }
+    g_usbs_head += len;
+    return len;
+}
+
+void USBS_Poll(void)
+{
+    if (g_usbs_inflight != 0u) {
+        if (CDC_IsTxBusy_HS()) return;
+        g_usbs_tail += g_usbs_inflight;
+        g_usbs_inflight = 0u;
+    }
+
+    uint16_t pending = USBS_Pending();
+    if (pending == 0u) return;
+
+    uint16_t off = (uint16_t)(g_usbs_tail & (USBS_TX_BUF_SIZE - 1u));
+    uint16_t len = (uint16_t)(USBS_TX_BUF_SIZE - off);
+    if (len > pending) len = pending;
+    if (len > USBS_CHUNK_MAX) len = USBS_CHUNK_MAX;
+
+    uint8_t st = CDC_Transmit_HS(&g_usbs_buf[off], len);
+    if (st == USBD_OK) {
+        g_usbs_inflight = len;
+    } else if (st == USBD_FAIL) {
+        // kein Host / nicht konfiguriert -> verwerfen statt zu blockieren
+        g_usbs_tail = g_usbs_head;
+    }
+}
+
+void USBS_Flush(uint32_t timeout_ms)
+{
+    uint32_t start = HAL_GetTick();
+
+    while (USBS_Pending() != 0u) {
+        USBS_Poll();
+        if ((HAL_GetTick() - start) > timeout_ms) {
+            // Host liest nicht -> Reste verwerfen
+            g_usbs_head = g_usbs_tail + g_usbs_inflight;
+            break;
+        }
+    }
+}
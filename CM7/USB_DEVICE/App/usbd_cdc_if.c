@@ -33,7 +33,11 @@
 /* USER CODE BEGIN PV */
 /* Private variables ---------------------------------------------------------*/
 ringbuf_t g_rx_ringbuf;
-static uint8_t g_rx_storage[512];
+static uint8_t g_rx_storage[2048];
+static volatile uint8_t g_rx_paused = 0;   // OUT Endpoint nicht neu armiert
+// Line Coding des Hosts (SET_LINE_CODING), wird im UART Tunnel angewendet
+static USBD_CDC_LineCodingTypeDef g_line_coding = { 115200u, 0u, 0u, 8u };
+static volatile uint8_t g_line_coding_new = 0;
 /* USER CODE END PV */
 
 /** @addtogroup STM32_USB_OTG_DEVICE_LIBRARY
@@ -152,6 +156,7 @@ static int8_t CDC_Init_HS(void)
 {
   /* USER CODE BEGIN 8 */
   ringbuf_init(&g_rx_ringbuf, g_rx_storage, sizeof(g_rx_storage));
+  g_rx_paused = 0u;
 
   /* Set Application Buffers */
   USBD_CDC_SetTxBuffer(&hUsbDeviceHS, UserTxBufferHS, 0);
@@ -185,7 +190,6 @@ static int8_t CDC_DeInit_HS(void)
 static int8_t CDC_Control_HS(uint8_t cmd, uint8_t* pbuf, uint16_t length)
 {
   /* USER CODE BEGIN 10 */
-  UNUSED(pbuf);
   UNUSED(length);
 
   switch(cmd)
@@ -206,9 +210,22 @@ static int8_t CDC_Control_HS(uint8_t cmd, uint8_t* pbuf, uint16_t length)
       break;
 
     case CDC_SET_LINE_CODING:
+      g_line_coding.bitrate = (uint32_t)pbuf[0] | ((uint32_t)pbuf[1] << 8) |
+                              ((uint32_t)pbuf[2] << 16) | ((uint32_t)pbuf[3] << 24);
+      g_line_coding.format = pbuf[4];
+      g_line_coding.paritytype = pbuf[5];
+      g_line_coding.datatype = pbuf[6];
+      g_line_coding_new = 1u;
       break;
 
     case CDC_GET_LINE_CODING:
+      pbuf[0] = (uint8_t)(g_line_coding.bitrate);
+      pbuf[1] = (uint8_t)(g_line_coding.bitrate >> 8);
+      pbuf[2] = (uint8_t)(g_line_coding.bitrate >> 16);
+      pbuf[3] = (uint8_t)(g_line_coding.bitrate >> 24);
+      pbuf[4] = g_line_coding.format;
+      pbuf[5] = g_line_coding.paritytype;
+      pbuf[6] = g_line_coding.datatype;
       break;
 
     case CDC_SET_CONTROL_LINE_STATE:
@@ -246,7 +263,14 @@ static int8_t CDC_Receive_HS(uint8_t* Buf, uint32_t *Len)
 {
   /* USER CODE BEGIN 11 */
   for (uint32_t i = 0; i < *Len; i++) {
-    (void)ringbuf_put(&g_rx_ringbuf, Buf[i]); // wenn voll -> drop (ok für CLI)
+    (void)ringbuf_put(&g_rx_ringbuf, Buf[i]);
+  }
+
+  // Backpressure: kein Platz fuer ein weiteres Paket -> OUT Endpoint
+  // erst wieder armieren wenn CLI_Process den Ring geleert hat (NAK zum Host)
+  if (ringbuf_free(&g_rx_ringbuf) < CDC_DATA_HS_OUT_PACKET_SIZE) {
+    g_rx_paused = 1u;
+    return (USBD_OK);
   }
 
   USBD_CDC_SetRxBuffer(&hUsbDeviceHS, &Buf[0]);
@@ -307,6 +331,72 @@ static int8_t CDC_TransmitCplt_HS(uint8_t *Buf, uint32_t *Len, uint8_t epnum)
 }
 
 /* USER CODE BEGIN PRIVATE_FUNCTIONS_IMPLEMENTATION */
+/**
+  * @brief  Check if a CDC IN transfer is still in progress.
+  * @retval 1 if busy (or not configured), 0 if a new transfer can be started
+  */
+uint8_t CDC_IsTxBusy_HS(void)
+{
+  USBD_CDC_HandleTypeDef *hcdc = (USBD_CDC_HandleTypeDef*)hUsbDeviceHS.pClassData;
+
+  if (hcdc == NULL) {
+    return 0;
+  }
+  return (hcdc->TxState != 0) ? 1u : 0u;
+}
+
+/**
+  * @brief  Re-arm the OUT endpoint after CDC_Receive_HS paused it.
+  * @retval None
+  */
+void CDC_ResumeRx_HS(void)
+{
+  if (!g_rx_paused) {
+    return;
+  }
+  if (ringbuf_free(&g_rx_ringbuf) < CDC_DATA_HS_OUT_PACKET_SIZE) {
+    return;
+  }
+
+  g_rx_paused = 0u;
+  HAL_NVIC_DisableIRQ(OTG_HS_IRQn);
+  HAL_NVIC_DisableIRQ(OTG_HS_EP1_IN_IRQn);
+  USBD_CDC_SetRxBuffer(&hUsbDeviceHS, UserRxBufferHS);
+  USBD_CDC_ReceivePacket(&hUsbDeviceHS);
+  HAL_NVIC_EnableIRQ(OTG_HS_EP1_IN_IRQn);
+  HAL_NVIC_EnableIRQ(OTG_HS_IRQn);
+}
+
+/**
+  * @brief  Fetch the line coding last set by the host.
+  * @param  lc: destination
+  * @retval 1 if the host sent a new SET_LINE_CODING since the last call
+  */
+uint8_t CDC_TakeLineCoding_HS(USBD_CDC_LineCodingTypeDef *lc)
+{
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  uint8_t fresh = g_line_coding_new;
+  g_line_coding_new = 0u;
+  if (lc != NULL) {
+    *lc = g_line_coding;
+  }
+  __set_PRIMASK(primask);
+  return fresh;
+}
+
+/**
+  * @brief  Update the line coding reported by GET_LINE_CODING.
+  * @param  lc: current UART settings
+  * @retval None
+  */
+void CDC_ReportLineCoding_HS(const USBD_CDC_LineCodingTypeDef *lc)
+{
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  g_line_coding = *lc;
+  __set_PRIMASK(primask);
+}
 /* USER CODE END PRIVATE_FUNCTIONS_IMPLEMENTATION */
 
 /**
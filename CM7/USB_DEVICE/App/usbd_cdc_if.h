@@ -108,6 +108,10 @@ extern USBD_CDC_ItfTypeDef USBD_Interface_fops_HS;
 uint8_t CDC_Transmit_HS(uint8_t* Buf, uint16_t Len);
 
 /* USER CODE BEGIN EXPORTED_FUNCTIONS */
+uint8_t CDC_IsTxBusy_HS(void);
+void CDC_ResumeRx_HS(void);
+uint8_t CDC_TakeLineCoding_HS(USBD_CDC_LineCodingTypeDef *lc);
+void CDC_ReportLineCoding_HS(const USBD_CDC_LineCodingTypeDef *lc);
 
 /* USER CODE END EXPORTED_FUNCTIONS */
 
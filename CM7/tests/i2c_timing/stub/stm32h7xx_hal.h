@@ -0,0 +1,93 @@
+/*
+ * stm32h7xx_hal.h
+ *
+ *  Host stub: only what i2c_timing.c needs, registers are plain structs.
+ */
+#ifndef TESTS_STUB_STM32H7XX_HAL_H_
+#define TESTS_STUB_STM32H7XX_HAL_H_
+
+#include <stdint.h>
+
+typedef enum {
+    HAL_OK = 0x00,
+    HAL_ERROR = 0x01,
+    HAL_BUSY = 0x02,
+    HAL_TIMEOUT = 0x03,
+} HAL_StatusTypeDef;
+
+// I2C_TIMINGR Bitlagen wie stm32h745xx.h
+#define I2C_TIMINGR_SCLL_Pos          (0U)
+#define I2C_TIMINGR_SCLH_Pos          (8U)
+#define I2C_TIMINGR_SDADEL_Pos        (16U)
+#define I2C_TIMINGR_SCLDEL_Pos        (20U)
+#define I2C_TIMINGR_PRESC_Pos         (28U)
+
+typedef struct {
+    uint32_t CR1;
+    uint32_t TIMINGR;
+} I2C_TypeDef;
+
+typedef struct {
+    uint32_t Timing;
+} I2C_InitTypeDef;
+
+typedef struct {
+    I2C_TypeDef *Instance;
+    I2C_InitTypeDef Init;
+} I2C_HandleTypeDef;
+
+typedef struct {
+    uint32_t CR;
+    uint32_t D2CCIP2R;
+    uint32_t D3CCIPR;
+} RCC_TypeDef;
+
+typedef struct {
+    uint32_t PLL3_P_Frequency;
+    uint32_t PLL3_Q_Frequency;
+    uint32_t PLL3_R_Frequency;
+} PLL3_ClocksTypeDef;
+
+extern RCC_TypeDef stub_rcc;
+extern I2C_TypeDef stub_i2c4;
+#define RCC                           (&stub_rcc)
+#define I2C4                          (&stub_i2c4)
+
+#define HSI_VALUE                     (64000000UL)
+#define CSI_VALUE                     (4000000UL)
+
+#define RCC_CR_HSIRDY                 (1UL << 2)
+#define RCC_CR_HSIDIV_Pos             (3U)
+#define RCC_CR_HSIDIV                 (3UL << RCC_CR_HSIDIV_Pos)
+#define RCC_D2CCIP2R_I2C123SEL_Pos    (12U)
+#define RCC_D2CCIP2R_I2C123SEL        (3UL << RCC_D2CCIP2R_I2C123SEL_Pos)
+#define RCC_D3CCIPR_I2C4SEL_Pos       (8U)
+#define RCC_D3CCIPR_I2C4SEL           (3UL << RCC_D3CCIPR_I2C4SEL_Pos)
+#define RCC_I2C123CLKSOURCE_HSI       (2UL << RCC_D2CCIP2R_I2C123SEL_Pos)
+#define RCC_I2C4CLKSOURCE_HSI         (2UL << RCC_D3CCIPR_I2C4SEL_Pos)
+#define __HAL_RCC_I2C123_CONFIG(s)    (RCC->D2CCIP2R = (RCC->D2CCIP2R & ~RCC_D2CCIP2R_I2C123SEL) | (s))
+#define __HAL_RCC_I2C4_CONFIG(s)      (RCC->D3CCIPR = (RCC->D3CCIPR & ~RCC_D3CCIPR_I2C4SEL) | (s))
+
+#define __HAL_I2C_ENABLE(h)           ((h)->Instance->CR1 |= 1UL)
+#define __HAL_I2C_DISABLE(h)          ((h)->Instance->CR1 &= ~1UL)
+
+#define I2C_ANALOGFILTER_ENABLE       (0UL)
+#define I2C_ANALOGFILTER_DISABLE      (1UL << 12)
+#define I2C_FASTMODEPLUS_PB6          (1UL << 4)
+#define I2C_FASTMODEPLUS_PB7          (1UL << 5)
+#define I2C_FASTMODEPLUS_PB8          (1UL << 6)
+#define I2C_FASTMODEPLUS_PB9          (1UL << 7)
+#define I2C_FASTMODEPLUS_I2C1         (1UL << 0)
+#define I2C_FASTMODEPLUS_I2C4         (1UL << 3)
+
+uint32_t HAL_RCC_GetPCLK1Freq(void);
+uint32_t HAL_RCCEx_GetD3PCLK1Freq(void);
+void HAL_RCCEx_GetPLL3ClockFreq(PLL3_ClocksTypeDef *pll3);
+HAL_StatusTypeDef HAL_I2C_Init(I2C_HandleTypeDef *hi2c);
+HAL_StatusTypeDef HAL_I2C_DeInit(I2C_HandleTypeDef *hi2c);
+HAL_StatusTypeDef HAL_I2CEx_ConfigAnalogFilter(I2C_HandleTypeDef *hi2c, uint32_t af);
+HAL_StatusTypeDef HAL_I2CEx_ConfigDigitalFilter(I2C_HandleTypeDef *hi2c, uint32_t dnf);
+void HAL_I2CEx_EnableFastModePlus(uint32_t bits);
+void HAL_I2CEx_DisableFastModePlus(uint32_t bits);
+
+#endif /* TESTS_STUB_STM32H7XX_HAL_H_ */
@@ -0,0 +1,306 @@
+/*
+ * test_i2c_timing.c
+ *
+ *  Host test for I2CT_Compute / I2CT_Apply against UM10204 table 10.
+ */
+#include <stdio.h>
+#include <stdint.h>
+#include "i2c_timing.h"
+
+// ============================================================
+// TEST
+//
+//   - Sweep 10 kHz .. 1 MHz fuer 8/16/32/64 MHz Kernel Takt,
+//     Analogfilter an/aus, DNF 0 und 2
+//   - TIMINGR wird unabhaengig vom Solver zurueckgerechnet (RM0399):
+//     tLOW, tHIGH, tSU;DAT, tVD;DAT, tHD;DAT, Frequenz in [80 %, 100 %]
+//   - HAL_ERROR nur erlaubt, wenn die Brute-Force Suche ueber alle
+//     PRESC/SCLDEL/SDADEL/SCLL/SCLH ebenfalls nichts findet
+//   - Apply: Kernel Takt kommt aus RCC, Ausweichen auf HSI
+// ============================================================
+
+#define PS_PER_S        (1000000000000ll)
+#define AF_MIN_PS       (50000ll)
+#define AF_MAX_PS       (260000ll)
+
+typedef struct {
+    uint32_t freq_max;
+    int64_t hddat_min;        // ps, UM10204 Tabelle 10
+    int64_t vddat_max;
+    int64_t sudat_min;
+    int64_t low_min;
+    int64_t high_min;
+} spec_t;
+
+static const spec_t g_spec[3] = {
+    { 100000u,  0, 3450000, 250000, 4700000, 4000000 },
+    { 400000u,  0,  900000, 100000, 1300000,  600000 },
+    { 1000000u, 0,  450000,  50000,  500000,  260000 },
+};
+
+RCC_TypeDef stub_rcc;
+I2C_TypeDef stub_i2c4;
+static I2C_TypeDef g_i2c1;
+static uint32_t g_pclk1_hz;
+static uint32_t g_fmp_bits;
+static uint32_t g_fail;
+static uint32_t g_checked;
+
+uint32_t HAL_RCC_GetPCLK1Freq(void) { return g_pclk1_hz; }
+uint32_t HAL_RCCEx_GetD3PCLK1Freq(void) { return g_pclk1_hz; }
+void HAL_RCCEx_GetPLL3ClockFreq(PLL3_ClocksTypeDef *pll3) { pll3->PLL3_R_Frequency = 0u; }
+HAL_StatusTypeDef HAL_I2C_Init(I2C_HandleTypeDef *hi2c)
+{
+    // wie HAL_I2C_MspInit in i2c.c: Kernel Mux auf PCLK
+    __HAL_RCC_I2C123_CONFIG(0u);
+    hi2c->Instance->TIMINGR = hi2c->Init.Timing;
+    hi2c->Instance->CR1 |= 1u;
+    return HAL_OK;
+}
+HAL_StatusTypeDef HAL_I2C_DeInit(I2C_HandleTypeDef *hi2c) { hi2c->Instance->CR1 = 0u; return HAL_OK; }
+HAL_StatusTypeDef HAL_I2CEx_ConfigAnalogFilter(I2C_HandleTypeDef *hi2c, uint32_t af) { return HAL_OK; }
+HAL_StatusTypeDef HAL_I2CEx_ConfigDigitalFilter(I2C_HandleTypeDef *hi2c, uint32_t dnf) { return HAL_OK; }
+void HAL_I2CEx_EnableFastModePlus(uint32_t bits) { g_fmp_bits |= bits; }
+void HAL_I2CEx_DisableFastModePlus(uint32_t bits) { g_fmp_bits &= ~bits; }
+
+#define CHECK(cond, ...) do { \
+    if (!(cond)) { \
+        g_fail++; \
+        printf("FAIL %s:%d: ", __FILE__, __LINE__); \
+        printf(__VA_ARGS__); \
+        printf("\n"); \
+    } \
+} while (0)
+
+static const spec_t *spec_for(uint32_t freq_hz)
+{
+    if (freq_hz <= g_spec[0].freq_max) return &g_spec[0];
+    if (freq_hz <= g_spec[1].freq_max) return &g_spec[1];
+    return &g_spec[2];
+}
+
+typedef struct {
+    int64_t t_low;
+    int64_t t_high;
+    int64_t su_dat;
+    int64_t vd_dat;
+    int64_t hd_dat;
+    int64_t t_scl;
+    int64_t clk;
+    int64_t af_min;
+    int64_t dnf;
+} eval_t;
+
+// Zeiten nach RM0399 "I2C timings" aus den Registerfeldern
+static void eval(uint32_t kernel_hz, const i2ct_cfg_t *cfg, uint32_t presc, uint32_t scldel,
+                 uint32_t sdadel, uint32_t sclh, uint32_t scll, eval_t *e)
+{
+    const int64_t rise = (int64_t)cfg->rise_ns * 1000;
+    const int64_t fall = (int64_t)cfg->fall_ns * 1000;
+    const int64_t af_max = cfg->analog ? AF_MAX_PS : 0;
+
+    e->clk = PS_PER_S / kernel_hz;
+    e->af_min = cfg->analog ? AF_MIN_PS : 0;
+    e->dnf = (int64_t)cfg->dnf * e->clk;
+
+    const int64_t tpresc = (int64_t)(presc + 1u) * e->clk;
+
+    const int64_t tsync = e->af_min + e->dnf + 2 * e->clk;
+    const int64_t t_sdadel = (int64_t)sdadel * tpresc + e->clk;
+
+    e->t_low = (int64_t)(scll + 1u) * tpresc + tsync;
+    e->t_high = (int64_t)(sclh + 1u) * tpresc + tsync;
+    e->su_dat = (int64_t)(scldel + 1u) * tpresc - rise;
+    e->vd_dat = t_sdadel + rise + af_max + ((int64_t)cfg->dnf + 4) * e->clk;
+    e->hd_dat = t_sdadel + e->af_min + ((int64_t)cfg->dnf + 3) * e->clk - fall;
+    e->t_scl = e->t_low + e->t_high + rise + fall;
+}
+
+static int eval_ok(const spec_t *s, uint32_t freq_hz, const eval_t *e)
+{
+    const int64_t hz = PS_PER_S / e->t_scl;
+    return e->t_low >= s->low_min && e->t_high >= s->high_min &&
+           e->su_dat >= s->sudat_min && e->vd_dat <= s->vddat_max && e->hd_dat >= s->hddat_min &&
+           e->clk < (e->t_low - e->af_min - e->dnf) / 4 && e->clk < e->t_high &&
+           hz <= (int64_t)freq_hz && hz * 100 >= (int64_t)freq_hz * I2CT_RATE_MIN_PCT;
+}
+
+// gibt es ueberhaupt einen Registersatz? SCLH wird zu jedem SCLL
+// direkt bestimmt, sonst waeren es 2^24 Kombinationen pro Punkt
+static int brute_force(uint32_t kernel_hz, const i2ct_cfg_t *cfg)
+{
+    const spec_t *s = spec_for(cfg->freq_hz);
+    eval_t e;
+
+    for (uint32_t p = 0u; p < 16u; p++) {
+        int hold_ok = 0;
+        for (uint32_t l = 0u; l < 16u && !hold_ok; l++) {
+            for (uint32_t a = 0u; a < 16u && !hold_ok; a++) {
+                eval(kernel_hz, cfg, p, l, a, 255u, 255u, &e);
+                hold_ok = e.su_dat >= s->sudat_min && e.vd_dat <= s->vddat_max && e.hd_dat >= s->hddat_min;
+            }
+        }
+        if (!hold_ok) continue;
+
+        for (uint32_t lo = 0u; lo < 256u; lo++) {
+            for (uint32_t hi = 0u; hi < 256u; hi++) {
+                eval(kernel_hz, cfg, p, 15u, 0u, hi, lo, &e);
+                const int64_t hz = PS_PER_S / e.t_scl;
+                if (hz * 100 < (int64_t)cfg->freq_hz * I2CT_RATE_MIN_PCT) break;
+                if (hz > (int64_t)cfg->freq_hz) continue;
+                if (e.t_low >= s->low_min && e.t_high >= s->high_min &&
+                    e.clk < (e.t_low - e.af_min - e.dnf) / 4 && e.clk < e.t_high) return 1;
+            }
+        }
+    }
+    return 0;
+}
+
+static void check_point(uint32_t kernel_hz, const i2ct_cfg_t *cfg, uint32_t *solved)
+{
+    i2ct_res_t r;
+    const spec_t *s = spec_for(cfg->freq_hz);
+    HAL_StatusTypeDef st = I2CT_Compute(kernel_hz, cfg, &r);
+
+    g_checked++;
+    if (st != HAL_OK) {
+        CHECK(!brute_force(kernel_hz, cfg), "%lu Hz @ %lu Hz af=%u dnf=%u: HAL_ERROR, aber loesbar",
+              (unsigned long)cfg->freq_hz, (unsigned long)kernel_hz, cfg->analog, cfg->dnf);
+        return;
+    }
+    (*solved)++;
+
+    const uint32_t presc = (r.timingr >> I2C_TIMINGR_PRESC_Pos) & 0xFu;
+    const uint32_t scldel = (r.timingr >> I2C_TIMINGR_SCLDEL_Pos) & 0xFu;
+    const uint32_t sdadel = (r.timingr >> I2C_TIMINGR_SDADEL_Pos) & 0xFu;
+    const uint32_t sclh = (r.timingr >> I2C_TIMINGR_SCLH_Pos) & 0xFFu;
+    const uint32_t scll = (r.timingr >> I2C_TIMINGR_SCLL_Pos) & 0xFFu;
+    CHECK(presc == r.presc && scldel == r.scldel && sdadel == r.sdadel && sclh == r.sclh && scll == r.scll,
+          "TIMINGR 0x%08lx passt nicht zu den Feldern", (unsigned long)r.timingr);
+    CHECK((r.timingr & 0x0F000000u) == 0u, "TIMINGR 0x%08lx: reservierte Bits", (unsigned long)r.timingr);
+
+    eval_t e;
+    eval(kernel_hz, cfg, presc, scldel, sdadel, sclh, scll, &e);
+
+    const char *fmt = "%lu Hz @ %lu Hz af=%u dnf=%u: %s";
+    const unsigned long f = cfg->freq_hz, k = kernel_hz;
+    CHECK(e.t_low >= s->low_min, fmt, f, k, cfg->analog, cfg->dnf, "tLOW zu kurz");
+    CHECK(e.t_high >= s->high_min, fmt, f, k, cfg->analog, cfg->dnf, "tHIGH zu kurz");
+    CHECK(e.su_dat >= s->sudat_min, fmt, f, k, cfg->analog, cfg->dnf, "tSU;DAT zu kurz");
+    CHECK(e.vd_dat <= s->vddat_max, fmt, f, k, cfg->analog, cfg->dnf, "tVD;DAT zu lang");
+    CHECK(e.hd_dat >= s->hddat_min, fmt, f, k, cfg->analog, cfg->dnf, "tHD;DAT zu kurz");
+    CHECK(e.clk < (e.t_low - e.af_min - e.dnf) / 4 && e.clk < e.t_high, fmt, f, k, cfg->analog, cfg->dnf,
+          "I2CCLK zu langsam fuer SCL");
+    CHECK(eval_ok(s, cfg->freq_hz, &e), fmt, f, k, cfg->analog, cfg->dnf, "ausserhalb der Spezifikation");
+
+    const int64_t hz = PS_PER_S / e.t_scl;
+    CHECK(hz <= (int64_t)cfg->freq_hz, fmt, f, k, cfg->analog, cfg->dnf, "schneller als Ziel");
+    CHECK(hz * 100 >= (int64_t)cfg->freq_hz * I2CT_RATE_MIN_PCT, fmt, f, k, cfg->analog, cfg->dnf,
+          "langsamer als 80 %");
+    CHECK(hz == (int64_t)r.actual_hz, fmt, f, k, cfg->analog, cfg->dnf, "actual_hz falsch");
+    CHECK(r.kernel_hz == kernel_hz, fmt, f, k, cfg->analog, cfg->dnf, "kernel_hz falsch");
+    CHECK(r.fmp == (cfg->freq_hz > 400000u), fmt, f, k, cfg->analog, cfg->dnf, "fmp falsch");
+    CHECK(r.analog == cfg->analog, fmt, f, k, cfg->analog, cfg->dnf, "analog falsch");
+}
+
+static void test_sweep(void)
+{
+    static const uint32_t kernels[] = { 8000000u, 16000000u, 32000000u, 64000000u };
+
+    for (uint32_t k = 0u; k < sizeof(kernels) / sizeof(kernels[0]); k++) {
+        for (uint32_t af = 0u; af < 2u; af++) {
+            for (uint32_t dnf = 0u; dnf <= 2u; dnf += 2u) {
+                uint32_t solved = 0u, points = 0u;
+                for (uint32_t f = I2CT_FREQ_MIN_HZ; f <= I2CT_FREQ_MAX_HZ;
+                     f += (f < 100000u) ? 1000u : (f < 400000u) ? 5000u : 10000u) {
+                    i2ct_cfg_t cfg;
+                    I2CT_DefaultCfg(&cfg, f);
+                    cfg.analog = (uint8_t)af;
+                    cfg.dnf = (uint8_t)dnf;
+                    check_point(kernels[k], &cfg, &solved);
+                    points++;
+                }
+                printf("%2lu MHz af=%lu dnf=%lu: %lu/%lu geloest\n", (unsigned long)(kernels[k] / 1000000u),
+                       (unsigned long)af, (unsigned long)dnf, (unsigned long)solved, (unsigned long)points);
+            }
+        }
+    }
+
+    // 64 MHz (HSI) muss alles schaffen, darauf verlaesst sich Apply
+    for (uint32_t f = I2CT_FREQ_MIN_HZ; f <= I2CT_FREQ_MAX_HZ; f += 10000u) {
+        i2ct_cfg_t cfg;
+        i2ct_res_t r;
+        I2CT_DefaultCfg(&cfg, f);
+        CHECK(I2CT_Compute(64000000u, &cfg, &r) == HAL_OK, "%lu Hz @ 64 MHz nicht geloest", (unsigned long)f);
+    }
+}
+
+static void test_reject(void)
+{
+    i2ct_cfg_t cfg;
+    i2ct_res_t r;
+
+    I2CT_DefaultCfg(&cfg, I2CT_FREQ_MIN_HZ - 1u);
+    CHECK(I2CT_Compute(32000000u, &cfg, &r) == HAL_ERROR, "Frequenz unter Minimum angenommen");
+    I2CT_DefaultCfg(&cfg, I2CT_FREQ_MAX_HZ + 1u);
+    CHECK(I2CT_Compute(32000000u, &cfg, &r) == HAL_ERROR, "Frequenz ueber Maximum angenommen");
+    I2CT_DefaultCfg(&cfg, 100000u);
+    cfg.dnf = I2CT_DNF_MAX + 1u;
+    CHECK(I2CT_Compute(32000000u, &cfg, &r) == HAL_ERROR, "DNF ueber Maximum angenommen");
+    cfg.dnf = 0u;
+    CHECK(I2CT_Compute(0u, &cfg, &r) == HAL_ERROR, "Kernel 0 Hz angenommen");
+    I2CT_DefaultCfg(&cfg, 400000u);
+    cfg.rise_ns = 301u;
+    CHECK(I2CT_Compute(32000000u, &cfg, &r) == HAL_ERROR, "tr ueber Fast-mode Grenze angenommen");
+    I2CT_DefaultCfg(&cfg, 1000000u);
+    cfg.fall_ns = 121u;
+    CHECK(I2CT_Compute(64000000u, &cfg, &r) == HAL_ERROR, "tf ueber Fast-mode Plus Grenze angenommen");
+}
+
+static void test_apply(void)
+{
+    I2C_HandleTypeDef h = { .Instance = &g_i2c1 };
+    i2ct_cfg_t cfg;
+    i2ct_res_t r, ref;
+
+    // PCLK 16 MHz am Mux, HSI 64 MHz bereit
+    g_pclk1_hz = 16000000u;
+    stub_rcc.CR = RCC_CR_HSIRDY;
+    stub_rcc.D2CCIP2R = RCC_I2C123CLKSOURCE_HSI;
+
+    I2CT_DefaultCfg(&cfg, 100000u);
+    CHECK(I2CT_Apply(&h, &cfg, &r) == HAL_OK, "Apply 100 kHz");
+    CHECK(r.kernel_hz == 16000000u && !r.hsi, "100 kHz: PCLK aus RCC erwartet, %lu Hz hsi=%u",
+          (unsigned long)r.kernel_hz, r.hsi);
+    CHECK((stub_rcc.D2CCIP2R & RCC_D2CCIP2R_I2C123SEL) == 0u, "100 kHz: Mux nicht auf PCLK");
+    CHECK(g_i2c1.TIMINGR == r.timingr && h.Init.Timing == r.timingr, "100 kHz: TIMINGR nicht geschrieben");
+    CHECK(g_i2c1.CR1 & 1u, "100 kHz: PE aus");
+    CHECK(g_fmp_bits == 0u, "100 kHz: FM+ Treiber an");
+
+    I2CT_DefaultCfg(&cfg, 1000000u);
+    CHECK(I2CT_Apply(&h, &cfg, &r) == HAL_OK, "Apply 1 MHz");
+    CHECK(r.kernel_hz == 64000000u && r.hsi, "1 MHz: HSI erwartet, %lu Hz hsi=%u",
+          (unsigned long)r.kernel_hz, r.hsi);
+    CHECK((stub_rcc.D2CCIP2R & RCC_D2CCIP2R_I2C123SEL) == RCC_I2C123CLKSOURCE_HSI, "1 MHz: Mux nicht auf HSI");
+    CHECK(I2CT_Compute(64000000u, &cfg, &ref) == HAL_OK && ref.timingr == g_i2c1.TIMINGR,
+          "1 MHz: TIMINGR nicht fuer HSI gerechnet");
+    CHECK(g_fmp_bits == (I2C_FASTMODEPLUS_I2C1 | I2C_FASTMODEPLUS_PB8 | I2C_FASTMODEPLUS_PB9),
+          "1 MHz: FM+ Treiber aus");
+
+    // HSIDIV /8: HSI nur 8 MHz -> Analogfilter wird abgeschaltet
+    stub_rcc.CR = RCC_CR_HSIRDY | (3u << RCC_CR_HSIDIV_Pos);
+    g_pclk1_hz = 8000000u;
+    I2CT_DefaultCfg(&cfg, 400000u);
+    CHECK(I2CT_Apply(&h, &cfg, &r) == HAL_OK, "Apply 400 kHz @ 8 MHz");
+    CHECK(!r.analog, "400 kHz @ 8 MHz: Analogfilter haette aus sein muessen");
+}
+
+int main(void)
+{
+    test_reject();
+    test_sweep();
+    test_apply();
+
+    printf("%lu Punkte, %lu Fehler\n", (unsigned long)g_checked, (unsigned long)g_fail);
+    return g_fail ? 1 : 0;
+}